@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------
+// File: ADPCMDecoder.h
+//
+// Portable Microsoft ADPCM (WAVE_FORMAT_ADPCM) block decoder with no XAudio2 or
+// platform dependencies.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DirectX
+{
+    namespace ADPCMDecoder
+    {
+        // Layout-compatible with ADPCMCOEFSET
+        struct Coefficients
+        {
+            int16_t     coef1;
+            int16_t     coef2;
+        };
+
+        constexpr size_t c_headerBytesPerChannel = 7;
+
+        // Bytes in a block holding samplesPerBlock frames
+        constexpr size_t BlockSize(uint32_t channels, uint32_t samplesPerBlock) noexcept
+        {
+            return (c_headerBytesPerChannel * channels) + (((samplesPerBlock - 2) * channels * 4 + 7) / 8);
+        }
+
+        namespace Internal
+        {
+            struct ChannelState
+            {
+                int     coef1;
+                int     coef2;
+                int     delta;
+                int     sample1;
+                int     sample2;
+            };
+
+            inline void Store(int value, _Out_ int16_t* output) noexcept
+            {
+                *output = static_cast<int16_t>(value);
+            }
+
+            inline void Store(int value, _Out_ float* output) noexcept
+            {
+                *output = float(value) * (1.f / 32768.f);
+            }
+
+            // Decodes one 4-bit code. The adaptation table is indexed by the raw code and the prediction
+            // uses the code sign-extended, so both come from small tables rather than branches.
+            inline int DecodeNibble(ChannelState& state, unsigned int code) noexcept
+            {
+                static constexpr int s_adaptation[16] =
+                {
+                    230, 230, 230, 230, 307, 409, 512, 614,
+                    768, 614, 512, 409, 307, 230, 230, 230
+                };
+
+                static constexpr int s_signed[16] =
+                {
+                    0, 1, 2, 3, 4, 5, 6, 7,
+                    -8, -7, -6, -5, -4, -3, -2, -1
+                };
+
+                int predict = ((state.sample1 * state.coef1) + (state.sample2 * state.coef2)) >> 8;
+                predict += s_signed[code] * state.delta;
+                predict = (predict < -32768) ? -32768 : ((predict > 32767) ? 32767 : predict);
+
+                state.sample2 = state.sample1;
+                state.sample1 = predict;
+
+                const int delta = (s_adaptation[code] * state.delta) >> 8;
+                state.delta = (delta < 16) ? 16 : delta;
+
+                return predict;
+            }
+
+            template<typename T>
+            bool DecodeBlock(
+                _In_reads_bytes_(blockBytes) const uint8_t* block, size_t blockBytes,
+                uint32_t channels, uint32_t samplesPerBlock,
+                _In_reads_(numCoefs) const Coefficients* coefs, size_t numCoefs,
+                _Out_writes_(samplesPerBlock * channels) T* output) noexcept
+            {
+                if ((channels != 1 && channels != 2) || samplesPerBlock < 2 || blockBytes < BlockSize(channels, samplesPerBlock))
+                    return false;
+
+                auto read16 = [](const uint8_t* ptr) noexcept
+                {
+                    return static_cast<int>(static_cast<int16_t>(ptr[0] | (ptr[1] << 8)));
+                };
+
+                // Header fields are grouped by field, then by channel
+                ChannelState state[2] = {};
+                const uint8_t* ptr = block;
+                for (uint32_t ch = 0; ch < channels; ++ch)
+                {
+                    const size_t predictor = ptr[ch];
+                    if (predictor >= numCoefs)
+                        return false;
+
+                    state[ch].coef1 = coefs[predictor].coef1;
+                    state[ch].coef2 = coefs[predictor].coef2;
+                    state[ch].delta = read16(ptr + channels + ch * 2);
+                    state[ch].sample1 = read16(ptr + channels * 3 + ch * 2);
+                    state[ch].sample2 = read16(ptr + channels * 5 + ch * 2);
+                }
+                ptr += c_headerBytesPerChannel * channels;
+
+                // The header carries the first two frames, oldest first
+                for (uint32_t ch = 0; ch < channels; ++ch)
+                {
+                    Store(state[ch].sample2, output + ch);
+                    Store(state[ch].sample1, output + channels + ch);
+                }
+                output += channels * 2;
+
+                // Nibbles are high-first. Each stereo byte holds one frame (high nibble left); each mono byte two frames.
+                const size_t nibbles = size_t(samplesPerBlock - 2) * channels;
+                const size_t bytes = nibbles >> 1;
+                if (channels == 1)
+                {
+                    for (size_t j = 0; j < bytes; ++j, output += 2)
+                    {
+                        const unsigned int code = ptr[j];
+                        Store(DecodeNibble(state[0], code >> 4), output);
+                        Store(DecodeNibble(state[0], code & 0xF), output + 1);
+                    }
+
+                    if (nibbles & 1)
+                    {
+                        Store(DecodeNibble(state[0], ptr[bytes] >> 4u), output);
+                    }
+                }
+                else
+                {
+                    for (size_t j = 0; j < bytes; ++j, output += 2)
+                    {
+                        const unsigned int code = ptr[j];
+                        Store(DecodeNibble(state[0], code >> 4), output);
+                        Store(DecodeNibble(state[1], code & 0xF), output + 1);
+                    }
+                }
+
+                return true;
+            }
+        }
+
+        // Decodes one block (mono or stereo) into samplesPerBlock interleaved frames.
+        // Returns false if the block is too small or names a predictor outside the coefficient table.
+        inline bool DecodeBlock(
+            _In_reads_bytes_(blockBytes) const uint8_t* block, size_t blockBytes,
+            uint32_t channels, uint32_t samplesPerBlock,
+            _In_reads_(numCoefs) const Coefficients* coefs, size_t numCoefs,
+            _Out_writes_(samplesPerBlock * channels) int16_t* output) noexcept
+        {
+            return Internal::DecodeBlock(block, blockBytes, channels, samplesPerBlock, coefs, numCoefs, output);
+        }
+
+        // As above, writing float samples in the range [-1,1]
+        inline bool DecodeBlock(
+            _In_reads_bytes_(blockBytes) const uint8_t* block, size_t blockBytes,
+            uint32_t channels, uint32_t samplesPerBlock,
+            _In_reads_(numCoefs) const Coefficients* coefs, size_t numCoefs,
+            _Out_writes_(samplesPerBlock * channels) float* output) noexcept
+        {
+            return Internal::DecodeBlock(block, blockBytes, channels, samplesPerBlock, coefs, numCoefs, output);
+        }
+
+        // Decodes blockCount consecutive blocks of blockAlign bytes into 16-bit PCM. Blocks are independent,
+        // so callers may split a large range across threads. Returns false if any block fails to decode.
+        inline bool DecodeBlocks(
+            _In_reads_bytes_(blockCount * blockAlign) const uint8_t* data, size_t blockCount, size_t blockAlign,
+            uint32_t channels, uint32_t samplesPerBlock,
+            _In_reads_(numCoefs) const Coefficients* coefs, size_t numCoefs,
+            _Out_writes_(blockCount * samplesPerBlock * channels) int16_t* output) noexcept
+        {
+            const size_t samples = size_t(samplesPerBlock) * channels;
+            for (size_t j = 0; j < blockCount; ++j, data += blockAlign, output += samples)
+            {
+                if (!Internal::DecodeBlock(data, blockAlign, channels, samplesPerBlock, coefs, numCoefs, output))
+                    return false;
+            }
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,368 @@
+//--------------------------------------------------------------------------------------
+// File: AudioBackend.h
+//
+// Platform-neutral audio backend interface: a graph of source, submix and mastering voices
+// rendered into a float bus. It has no XAudio2 dependencies, so a backend can be driven
+// headless, with the mix written to a Sink instead of an audio device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SALFallback.h"
+#include "ADPCMDecoder.h"
+
+
+namespace DirectX
+{
+    namespace AudioBackend
+    {
+        // Flags and limits, matching XAudio2
+        constexpr uint32_t VOICE_NOPITCH = 0x2;
+        constexpr uint32_t VOICE_USEFILTER = 0x8;
+
+        constexpr uint32_t LOOP_INFINITE = 255;
+        constexpr uint32_t MAX_QUEUED_BUFFERS = 64;
+        constexpr uint32_t MAX_AUDIO_CHANNELS = 64;
+        constexpr uint32_t MIN_SAMPLE_RATE = 1000;
+        constexpr uint32_t MAX_SAMPLE_RATE = 200000;
+        constexpr float MIN_FREQ_RATIO = 1.f / 1024.f;
+        constexpr float MAX_FREQ_RATIO = 1024.f;
+        constexpr float MAX_VOLUME_LEVEL = 16777216.f;
+        constexpr float MAX_FILTER_FREQUENCY = 1.f;
+        constexpr float MAX_FILTER_ONEOVERQ = 1.5f;
+
+        enum class Status
+        {
+            Ok,
+            InvalidCall,    // Bad parameters, or not valid in the voice's current state
+            NotSupported,   // The backend can't decode this format
+        };
+
+        enum class SampleFormat : uint32_t
+        {
+            PCM8,           // Unsigned
+            PCM16,
+            PCM24,          // Packed in 3 bytes
+            PCM32,
+            Float32,
+            ADPCM,          // Microsoft ADPCM
+        };
+
+        struct Format
+        {
+            SampleFormat                        type;
+            uint32_t                            channels;
+            uint32_t                            sampleRate;
+            uint32_t                            blockAlign;
+            uint32_t                            samplesPerBlock;    // 1 except for ADPCM
+            const ADPCMDecoder::Coefficients*   coefficients;       // ADPCM only
+            size_t                              coefficientCount;
+        };
+
+        // Matches XAUDIO2_FILTER_TYPE
+        enum class FilterType : uint32_t
+        {
+            LowPass,
+            BandPass,
+            HighPass,
+            Notch,
+            LowPassOnePole,
+            HighPassOnePole,
+        };
+
+        struct FilterParameters
+        {
+            FilterType  type;
+            float       frequency;
+            float       oneOverQ;
+        };
+
+        constexpr FilterParameters c_defaultFilter = { FilterType::LowPass, MAX_FILTER_FREQUENCY, MAX_FILTER_ONEOVERQ };
+
+        // As XAUDIO2_BUFFER; positions and lengths are in frames, and 0 lengths mean the rest of the buffer
+        struct Buffer
+        {
+            const uint8_t*  data;
+            uint32_t        bytes;
+            uint32_t        playBegin;
+            uint32_t        playLength;
+            uint32_t        loopBegin;
+            uint32_t        loopLength;
+            uint32_t        loopCount;
+            bool            endOfStream;
+            void*           context;
+        };
+
+        struct VoiceState
+        {
+            void*       currentContext;
+            uint32_t    buffersQueued;
+            uint64_t    samplesPlayed;
+        };
+
+        struct PerformanceData
+        {
+            uint32_t    activeSourceVoices;     // Started with buffers queued
+            uint32_t    totalSourceVoices;
+            uint32_t    submixVoices;
+        };
+
+        //--------------------------------------------------------------------------------
+        // Called from Render, on the thread that calls it. Callbacks may create, destroy,
+        // and submit to voices.
+        class VoiceCallback
+        {
+        public:
+            virtual ~VoiceCallback() = default;
+
+            virtual void OnPassStart(uint32_t /*bytesRequired*/) {}
+            virtual void OnPassEnd() {}
+            virtual void OnBufferStart(_In_opt_ void* /*context*/) {}
+            virtual void OnBufferEnd(_In_opt_ void* /*context*/) {}
+            virtual void OnLoopEnd(_In_opt_ void* /*context*/) {}
+            virtual void OnStreamEnd() {}
+        };
+
+        class EngineCallback
+        {
+        public:
+            virtual ~EngineCallback() = default;
+
+            virtual void OnPassStart() {}
+            virtual void OnPassEnd() {}
+        };
+
+        //--------------------------------------------------------------------------------
+        class Voice
+        {
+        public:
+            virtual ~Voice() = default;
+
+            virtual uint32_t GetChannels() const noexcept = 0;
+            virtual uint32_t GetSampleRate() const noexcept = 0;
+            virtual uint32_t GetFlags() const noexcept = 0;
+
+            // Replaces the voice's sends. With no destinations a source or submix voice sends to the
+            // mastering voice. useFilter may be null.
+            virtual Status SetOutputs(_In_reads_(count) Voice* const* destinations, _In_reads_opt_(count) const bool* useFilter, size_t count) = 0;
+
+            virtual Status SetVolume(float volume) = 0;
+            virtual float GetVolume() const = 0;
+
+            virtual Status SetChannelVolumes(uint32_t channels, _In_reads_(channels) const float* volumes) = 0;
+            virtual void GetChannelVolumes(uint32_t channels, _Out_writes_(channels) float* volumes) const = 0;
+
+            // A null destination selects the only send.
+            virtual Status SetOutputMatrix(_In_opt_ Voice* destination, uint32_t sourceChannels, uint32_t destinationChannels,
+                _In_reads_(sourceChannels * destinationChannels) const float* matrix) = 0;
+            virtual void GetOutputMatrix(_In_opt_ Voice* destination, uint32_t sourceChannels, uint32_t destinationChannels,
+                _Out_writes_(sourceChannels * destinationChannels) float* matrix) const = 0;
+
+            // Requires VOICE_USEFILTER
+            virtual Status SetFilter(const FilterParameters& parameters) = 0;
+            virtual FilterParameters GetFilter() const = 0;
+
+            // Requires a send created with useFilter
+            virtual Status SetOutputFilter(_In_opt_ Voice* destination, const FilterParameters& parameters) = 0;
+            virtual FilterParameters GetOutputFilter(_In_opt_ Voice* destination) const = 0;
+
+            // The voice must not be used afterwards; no more callbacks are made for it.
+            virtual void Destroy() noexcept = 0;
+        };
+
+        class SourceVoice : public Voice
+        {
+        public:
+            virtual void Start() = 0;
+            virtual void Stop() = 0;
+
+            virtual Status Submit(const Buffer& buffer) = 0;
+
+            // A started voice keeps the buffer it is playing; OnBufferEnd for the rest is reported on the next pass.
+            virtual void Flush() = 0;
+            virtual void Discontinuity() = 0;
+            virtual void ExitLoop() = 0;
+
+            virtual VoiceState GetState() const = 0;
+
+            virtual Status SetFrequencyRatio(float ratio) = 0;
+            virtual float GetFrequencyRatio() const = 0;
+
+            // Only while no buffers are queued
+            virtual Status SetSourceSampleRate(uint32_t sampleRate) = 0;
+        };
+
+        //--------------------------------------------------------------------------------
+        // Receives the rendered mix as interleaved float frames at the mastering voice format.
+        class Sink
+        {
+        public:
+            virtual ~Sink() = default;
+
+            virtual bool Write(_In_reads_(frames * channels) const float* samples, size_t frames, uint32_t channels) = 0;
+        };
+
+        // Discards the mix, for load tests and benchmarks.
+        class NullSink : public Sink
+        {
+        public:
+            NullSink() noexcept : mFrames(0) {}
+
+            bool Write(const float*, size_t frames, uint32_t) override
+            {
+                mFrames += frames;
+                return true;
+            }
+
+            uint64_t GetFrames() const noexcept { return mFrames; }
+
+        private:
+            uint64_t mFrames;
+        };
+
+        // Writes the mix as a 32-bit float .wav file. The file is opened and closed by the caller;
+        // call Finish before closing it to fill in the chunk sizes.
+        class WAVFileSink : public Sink
+        {
+        public:
+            WAVFileSink(_In_ std::FILE* file, uint32_t channels, uint32_t sampleRate) :
+                mFile(file),
+                mChannels(channels),
+                mSampleRate(sampleRate),
+                mDataBytes(0),
+                mFailed(false)
+            {
+                WriteHeader();
+            }
+
+            bool Write(const float* samples, size_t frames, uint32_t channels) override
+            {
+                if (mFailed || channels != mChannels)
+                    return false;
+
+                const size_t count = frames * channels;
+                if (uint64_t(mDataBytes) + count * sizeof(float) > UINT32_MAX - c_headerBytes
+                    || std::fwrite(samples, sizeof(float), count, mFile) != count)
+                {
+                    mFailed = true;
+                    return false;
+                }
+
+                mDataBytes += static_cast<uint32_t>(count * sizeof(float));
+                return true;
+            }
+
+            bool Finish()
+            {
+                if (!mFailed)
+                {
+                    mFailed = (std::fseek(mFile, 0, SEEK_SET) != 0);
+                    WriteHeader();
+                    mFailed = mFailed || (std::fseek(mFile, 0, SEEK_END) != 0) || (std::fflush(mFile) != 0);
+                }
+                return !mFailed;
+            }
+
+            uint32_t GetDataBytes() const noexcept { return mDataBytes; }
+
+        private:
+            static constexpr uint32_t c_headerBytes = 44;
+
+            void WriteHeader()
+            {
+                const uint16_t blockAlign = static_cast<uint16_t>(mChannels * sizeof(float));
+
+                uint8_t header[c_headerBytes] = {};
+                size_t at = 0;
+                auto put32 = [&](uint32_t value) { memcpy(header + at, &value, 4); at += 4; };
+                auto put16 = [&](uint16_t value) { memcpy(header + at, &value, 2); at += 2; };
+
+                memcpy(header + at, "RIFF", 4); at += 4;
+                put32(c_headerBytes - 8 + mDataBytes);
+                memcpy(header + at, "WAVEfmt ", 8); at += 8;
+                put32(16);
+                put16(3 /* WAVE_FORMAT_IEEE_FLOAT */);
+                put16(static_cast<uint16_t>(mChannels));
+                put32(mSampleRate);
+                put32(mSampleRate * blockAlign);
+                put16(blockAlign);
+                put16(32);
+                memcpy(header + at, "data", 4); at += 4;
+                put32(mDataBytes);
+
+                if (std::fwrite(header, 1, sizeof(header), mFile) != sizeof(header))
+                    mFailed = true;
+            }
+
+            std::FILE*  mFile;
+            uint32_t    mChannels;
+            uint32_t    mSampleRate;
+            uint32_t    mDataBytes;
+            bool        mFailed;
+        };
+
+        //--------------------------------------------------------------------------------
+        class Backend
+        {
+        public:
+            virtual ~Backend() = default;
+
+            // Source and submix voices need a mastering voice; there is only one.
+            virtual Status CreateSourceVoice(const Format& format, uint32_t flags, float maxFrequencyRatio,
+                _In_opt_ VoiceCallback* callback, _Outptr_ SourceVoice** voice) = 0;
+            virtual Status CreateSubmixVoice(uint32_t channels, uint32_t sampleRate, uint32_t flags, uint32_t processingStage,
+                _Outptr_ Voice** voice) = 0;
+            virtual Status CreateMasteringVoice(uint32_t channels, uint32_t sampleRate, uint32_t flags,
+                _Outptr_ Voice** voice) = 0;
+
+            _Ret_maybenull_ virtual Voice* GetMasteringVoice() const noexcept = 0;
+
+            virtual void RegisterCallback(_In_ EngineCallback* callback) = 0;
+            virtual void UnregisterCallback(_In_ EngineCallback* callback) = 0;
+
+            virtual void Start() = 0;
+            virtual void Stop() = 0;
+
+            virtual PerformanceData GetPerformanceData() const = 0;
+
+            // Produces frames of the mix at the mastering voice format. output may be null to only advance
+            // the voices; silence is written while stopped or without a mastering voice.
+            virtual void Render(_Out_writes_opt_(_Inexpressible_("frames * channels")) float* output, size_t frames) = 0;
+
+            // Renders into sink in passes of at most blockFrames. Returns false if the sink fails.
+            bool Render(Sink& sink, size_t frames, size_t blockFrames = 4800)
+            {
+                auto master = GetMasteringVoice();
+                if (!master || !blockFrames)
+                    return false;
+
+                const uint32_t channels = master->GetChannels();
+                std::vector<float> block(std::min(frames, blockFrames) * channels);
+
+                while (frames > 0)
+                {
+                    const size_t count = std::min(frames, blockFrames);
+                    Render(block.data(), count);
+                    if (!sink.Write(block.data(), count, channels))
+                        return false;
+
+                    frames -= count;
+                }
+                return true;
+            }
+        };
+    }
+}
@@ -11,7 +11,10 @@
 #include "pch.h"
 #include "Audio.h"
 #include "SoundCommon.h"
+#include "StreamScheduler.h"
+#include "VoiceScheduler.h"
 
+#include <chrono>
 #include <unordered_map>
 
 using namespace DirectX;
@@ -101,6 +104,81 @@ namespace
         ScopedHandle mBufferEnd;
     };
 
+    // Each one-shot voice has its own callback so completion is signalled per voice; Update then only visits
+    // the voices that finished rather than scanning every one-shot in flight.
+    struct OneShotVoice : public IXAudio2VoiceCallback
+    {
+        OneShotVoice(unsigned int key, _In_ PSLIST_HEADER completed, _In_ HANDLE bufferEnd) noexcept :
+            entry{},
+            voice(nullptr),
+            voiceKey(key),
+            prev(nullptr),
+            next(nullptr),
+            active(false),
+            signalled(0),
+            mCompleted(completed),
+            mBufferEnd(bufferEnd)
+        {
+        }
+
+        OneShotVoice(OneShotVoice&&) = delete;
+        OneShotVoice& operator=(OneShotVoice&&) = delete;
+
+        OneShotVoice(const OneShotVoice&) = delete;
+        OneShotVoice& operator=(const OneShotVoice&) = delete;
+
+        virtual ~OneShotVoice() = default;
+
+        STDMETHOD_(void, OnVoiceProcessingPassStart) (UINT32) override {}
+        STDMETHOD_(void, OnVoiceProcessingPassEnd)() override {}
+        STDMETHOD_(void, OnStreamEnd)() override {}
+        STDMETHOD_(void, OnBufferStart)(void*) override {}
+
+        STDMETHOD_(void, OnBufferEnd)(void* context) override
+        {
+            if (context)
+            {
+                auto inotify = static_cast<IVoiceNotify*>(context);
+                inotify->OnBufferEnd();
+            }
+
+            Signal();
+        }
+
+        STDMETHOD_(void, OnLoopEnd)(void*) override {}
+        STDMETHOD_(void, OnVoiceError)(void*, HRESULT) override {}
+
+        void Signal() noexcept
+        {
+            if (!InterlockedExchange(&signalled, 1))
+            {
+                std::ignore = InterlockedPushEntrySList(mCompleted, &entry);
+            }
+            SetEvent(mBufferEnd);
+        }
+
+        SLIST_ENTRY             entry;
+        IXAudio2SourceVoice*    voice;
+        unsigned int            voiceKey;
+        OneShotVoice*           prev;       // Links in the in-flight list, or next in an idle pool bucket
+        OneShotVoice*           next;
+        bool                    active;
+        volatile LONG           signalled;
+
+    private:
+        PSLIST_HEADER           mCompleted;
+        HANDLE                  mBufferEnd;
+    };
+
+    // Idle one-shot voices of one reuse format
+    struct VoicePoolBucket
+    {
+        OneShotVoice*   idle;
+        size_t          idleCount;
+        size_t          lowWatermark;   // WaveBanks prewarm idle voices up to this count on load
+        size_t          highWatermark;  // Finished one-shots beyond this count are destroyed rather than pooled
+    };
+
     static const XAUDIO2FX_REVERB_I3DL2_PARAMETERS gReverbPresets[] =
     {
         XAUDIO2FX_I3DL2_PRESET_DEFAULT,             // Reverb_Off
@@ -276,6 +354,12 @@ public:
         defaultRate(44100),
         maxVoiceOneshots(SIZE_MAX),
         maxVoiceInstances(SIZE_MAX),
+        defaultLowWatermark(1),
+        defaultHighWatermark(SIZE_MAX),
+        maxRealVoices(SIZE_MAX),
+        minAudibility(0.f),
+        streamBufferCount(3),
+        streamPacketBytes(0),
         mMasterVolume(1.f),
         mX3DAudio{},
         mCriticalError(false),
@@ -283,8 +367,13 @@ public:
         mEngineFlags(AudioEngine_Default),
         mOutputFormat{},
         mCategory(AudioCategory_GameEffects),
-        mVoiceInstances(0)
+        mOneShots(nullptr),
+        mOneShotCount(0),
+        mIdleVoiceCount(0),
+        mVoiceInstances(0),
+        mLastUpdateValid(false)
     {
+        InitializeSListHead(&mCompletedOneShots);
     }
 
     ~Impl() = default;
@@ -321,9 +410,15 @@ public:
         _Outptr_result_maybenull_ IXAudio2SourceVoice** voice);
     void DestroyVoice(_In_ IXAudio2SourceVoice* voice) noexcept;
 
+    void SetVoicePoolWatermarks(size_t lowWatermark, size_t highWatermark, _In_opt_ const WAVEFORMATEX* wfx);
+    void PrewarmVoices(_In_ const WAVEFORMATEX* wfx);
+
     void RegisterNotify(_In_ IVoiceNotify* notify, bool usesUpdate);
     void UnregisterNotify(_In_ IVoiceNotify* notify, bool oneshots, bool usesUpdate);
 
+    void UpdateVirtualVoices();
+    void IssueStreamReads() noexcept;
+
     ComPtr<IXAudio2>                    xaudio2;
     IXAudio2MasteringVoice*             mMasterVoice;
     IXAudio2SubmixVoice*                mReverbVoice;
@@ -335,6 +430,12 @@ public:
     int                                 defaultRate;
     size_t                              maxVoiceOneshots;
     size_t                              maxVoiceInstances;
+    size_t                              defaultLowWatermark;
+    size_t                              defaultHighWatermark;
+    size_t                              maxRealVoices;
+    float                               minAudibility;
+    size_t                              streamBufferCount;
+    size_t                              streamPacketBytes;
     float                               mMasterVolume;
 
     X3DAUDIO_HANDLE                     mX3DAudio;
@@ -345,21 +446,52 @@ public:
     AUDIO_ENGINE_FLAGS                  mEngineFlags;
     WAVEFORMATEX                        mOutputFormat;
 
+    std::set<IVirtualVoice*>            mVirtualVoices;
+    bool                                mLastUpdateValid;
+
+    StreamScheduler::ReadQueue<IStreamReader> mStreamReads;
+
 private:
     using notifylist_t = std::set<IVoiceNotify*>;
-    using oneshotlist_t = std::list<std::pair<unsigned int, IXAudio2SourceVoice*>>;
-    using voicepool_t = std::unordered_multimap<unsigned int, IXAudio2SourceVoice*>;
+    using voicepool_t = std::unordered_map<unsigned int, VoicePoolBucket>;
+
+    VoicePoolBucket& GetVoiceBucket(unsigned int voiceKey);
+    HRESULT CreateOneShotVoice(_In_ const WAVEFORMATEX* wfx, unsigned int voiceKey, _Outptr_ OneShotVoice** result);
+    HRESULT CreateReuseVoice(_In_ const WAVEFORMATEX* wfx, unsigned int voiceKey, _Outptr_ OneShotVoice** result);
+    void LinkOneShot(_In_ OneShotVoice* oneShot) noexcept;
+    void UnlinkOneShot(_In_ OneShotVoice* oneShot) noexcept;
+    void RecycleOneShot(_In_ OneShotVoice* oneShot) noexcept;
+    void CollectOneShots() noexcept;
+    void TrimBucket(VoicePoolBucket& bucket, size_t keep) noexcept;
+    void DestroyOneShots() noexcept;
+
+    static void DestroyOneShot(_In_ OneShotVoice* oneShot) noexcept
+    {
+        assert(oneShot != nullptr);
+        if (oneShot->voice)
+        {
+            oneShot->voice->DestroyVoice();
+        }
+        std::unique_ptr<OneShotVoice> owner(oneShot);
+    }
 
+    SLIST_HEADER                        mCompletedOneShots;
     AUDIO_STREAM_CATEGORY               mCategory;
     ComPtr<IUnknown>                    mReverbEffect;
     ComPtr<IUnknown>                    mVolumeLimiter;
-    oneshotlist_t                       mOneShots;
+    OneShotVoice*                       mOneShots;
+    size_t                              mOneShotCount;
+    size_t                              mIdleVoiceCount;
     voicepool_t                         mVoicePool;
     notifylist_t                        mNotifyObjects;
     notifylist_t                        mNotifyUpdates;
     size_t                              mVoiceInstances;
     VoiceCallback                       mVoiceCallback;
     EngineCallback                      mEngineCallback;
+
+    std::chrono::steady_clock::time_point mLastUpdate;
+    std::vector<IVirtualVoice*>         mSchedulerVoices;
+    std::vector<VoiceScheduler::Candidate> mSchedulerCandidates;
 };
 
 
@@ -409,10 +541,17 @@ HRESULT AudioEngine::Impl::Reset(const WAVEFORMATEX* wfx, const wchar_t* deviceI
     //
     // Create XAudio2 engine
     //
-    HRESULT hr = XAudio2Create(xaudio2.ReleaseAndGetAddressOf(), 0u);
+    HRESULT hr = (mEngineFlags & AudioEngine_SoftwareMixer)
+        ? CreateSoftwareAudio(xaudio2.ReleaseAndGetAddressOf())
+        : XAudio2Create(xaudio2.ReleaseAndGetAddressOf(), 0u);
     if (FAILED(hr))
         return hr;
 
+    if (mEngineFlags & AudioEngine_SoftwareMixer)
+    {
+        DebugTrace("INFO: Software mixer enabled; output is produced by AudioEngine::Render\n");
+    }
+
     if (mEngineFlags & AudioEngine_Debug)
     {
         XAUDIO2_DEBUG_CONFIGURATION debug = {};
@@ -486,11 +625,20 @@ HRESULT AudioEngine::Impl::Reset(const WAVEFORMATEX* wfx, const wchar_t* deviceI
         }
     }
 
-    mOutputFormat.wFormatTag = WAVE_FORMAT_PCM;
     mOutputFormat.nChannels = static_cast<WORD>(details.InputChannels);
     mOutputFormat.nSamplesPerSec = details.InputSampleRate;
-    mOutputFormat.wBitsPerSample = 16;
-    GetDeviceOutputFormat(deviceId, mOutputFormat);
+    if (mEngineFlags & AudioEngine_SoftwareMixer)
+    {
+        // There is no device; Render writes the mastering voice's float mix directly
+        mOutputFormat.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+        mOutputFormat.wBitsPerSample = 32;
+    }
+    else
+    {
+        mOutputFormat.wFormatTag = WAVE_FORMAT_PCM;
+        mOutputFormat.wBitsPerSample = 16;
+        GetDeviceOutputFormat(deviceId, mOutputFormat);
+    }
 
     //
     // Setup mastering volume limiter (optional)
@@ -611,19 +759,7 @@ void AudioEngine::Impl::SetSilentMode()
         it->OnCriticalError();
     }
 
-    for (auto& it : mOneShots)
-    {
-        assert(it.second != nullptr);
-        it.second->DestroyVoice();
-    }
-    mOneShots.clear();
-
-    for (auto& it : mVoicePool)
-    {
-        assert(it.second != nullptr);
-        it.second->DestroyVoice();
-    }
-    mVoicePool.clear();
+    DestroyOneShots();
 
     mVoiceInstances = 0;
 
@@ -644,25 +780,16 @@ void AudioEngine::Impl::Shutdown() noexcept
         it->OnDestroyEngine();
     }
 
+    mVirtualVoices.clear();
+    mStreamReads.Clear();
+
     if (xaudio2)
     {
         xaudio2->UnregisterForCallbacks(&mEngineCallback);
 
         xaudio2->StopEngine();
 
-        for (auto& it : mOneShots)
-        {
-            assert(it.second != nullptr);
-            it.second->DestroyVoice();
-        }
-        mOneShots.clear();
-
-        for (auto& it : mVoicePool)
-        {
-            assert(it.second != nullptr);
-            it.second->DestroyVoice();
-        }
-        mVoicePool.clear();
+        DestroyOneShots();
 
         mVoiceInstances = 0;
 
@@ -703,45 +830,15 @@ bool AudioEngine::Impl::Update()
         return false;
 
     case WAIT_OBJECT_0 + 1: // OnBufferEnd
-        // Scan for completed one-shot voices
-        for (auto it = mOneShots.begin(); it != mOneShots.end(); )
-        {
-            assert(it->second != nullptr);
-
-            XAUDIO2_VOICE_STATE xstate;
-            it->second->GetState(&xstate, XAUDIO2_VOICE_NOSAMPLESPLAYED);
-
-            if (!xstate.BuffersQueued)
-            {
-                std::ignore = it->second->Stop(0);
-                if (it->first)
-                {
-                    // Put voice back into voice pool for reuse since it has a non-zero voiceKey
-                #ifdef VERBOSE_TRACE
-                    DebugTrace("INFO: One-shot voice being saved for reuse (%08X)\n", it->first);
-                #endif
-                    voicepool_t::value_type v(it->first, it->second);
-                    mVoicePool.emplace(v);
-                }
-                else
-                {
-                    // Voice is to be destroyed rather than reused
-                #ifdef VERBOSE_TRACE
-                    DebugTrace("INFO: Destroying one-shot voice\n");
-                #endif
-                    it->second->DestroyVoice();
-                }
-                it = mOneShots.erase(it);
-            }
-            else
-                ++it;
-        }
+        CollectOneShots();
         break;
 
     case WAIT_FAILED:
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "WaitForMultipleObjectsEx");
     }
 
+    UpdateVirtualVoices();
+
     //
     // Inform any notify objects of updates
     //
@@ -751,6 +848,9 @@ bool AudioEngine::Impl::Update()
         it->OnUpdate();
     }
 
+    // Reads completed during OnUpdate free slots for the most urgent queued ones
+    IssueStreamReads();
+
     return true;
 }
 
@@ -803,8 +903,8 @@ AudioStatistics AudioEngine::Impl::GetStatistics() const
 {
     AudioStatistics stats = {};
 
-    stats.allocatedVoices = stats.allocatedVoicesOneShot = mOneShots.size() + mVoicePool.size();
-    stats.allocatedVoicesIdle = mVoicePool.size();
+    stats.allocatedVoices = stats.allocatedVoicesOneShot = mOneShotCount + mIdleVoiceCount;
+    stats.allocatedVoicesIdle = mIdleVoiceCount;
 
     for (const auto it : mNotifyObjects)
     {
@@ -812,7 +912,9 @@ AudioStatistics AudioEngine::Impl::GetStatistics() const
         it->GatherStatistics(stats);
     }
 
-    assert(stats.allocatedVoices == (mOneShots.size() + mVoicePool.size() + mVoiceInstances));
+    stats.streamingReadsQueued = mStreamReads.GetQueued();
+
+    assert(stats.allocatedVoices == (mOneShotCount + mIdleVoiceCount + mVoiceInstances));
 
     return stats;
 }
@@ -828,10 +930,8 @@ void AudioEngine::Impl::TrimVoicePool()
 
     for (auto& it : mVoicePool)
     {
-        assert(it.second != nullptr);
-        it.second->DestroyVoice();
+        TrimBucket(it.second, 0);
     }
-    mVoicePool.clear();
 }
 
 
@@ -860,7 +960,7 @@ void AudioEngine::Impl::AllocateVoice(
     assert(maxFrequencyRatio <= XAUDIO2_DEFAULT_FREQ_RATIO);
 #endif
 
-    unsigned int voiceKey = 0;
+    OneShotVoice* oneShot = nullptr;
     if (oneshot)
     {
         if (flags & (SoundEffectInstance_Use3D | SoundEffectInstance_ReverbUseFilters | SoundEffectInstance_NoSetPitch))
@@ -886,22 +986,26 @@ void AudioEngine::Impl::AllocateVoice(
 
         if (!(mEngineFlags & AudioEngine_DisableVoiceReuse))
         {
-            voiceKey = makeVoiceKey(wfx);
+            const unsigned int voiceKey = makeVoiceKey(wfx);
             if (voiceKey != 0)
             {
-                auto it = mVoicePool.find(voiceKey);
-                if (it != mVoicePool.end())
+                auto& bucket = GetVoiceBucket(voiceKey);
+                if (bucket.idle)
                 {
                     // Found a matching (stopped) voice to reuse
-                    assert(it->second != nullptr);
-                    *voice = it->second;
-                    mVoicePool.erase(it);
+                    oneShot = bucket.idle;
+                    bucket.idle = oneShot->next;
+                    oneShot->next = nullptr;
+                    --bucket.idleCount;
+                    --mIdleVoiceCount;
+
+                    LinkOneShot(oneShot);
 
                     // Reset any volume/pitch-shifting
-                    HRESULT hr = (*voice)->SetVolume(1.f);
+                    HRESULT hr = oneShot->voice->SetVolume(1.f);
                     ThrowIfFailed(hr);
 
-                    hr = (*voice)->SetFrequencyRatio(1.f);
+                    hr = oneShot->voice->SetFrequencyRatio(1.f);
                     ThrowIfFailed(hr);
 
                     if (wfx->nChannels == 1 || wfx->nChannels == 2)
@@ -910,70 +1014,39 @@ void AudioEngine::Impl::AllocateVoice(
                         float matrix[16] = {};
                         ComputePan(0.f, wfx->nChannels, matrix);
 
-                        hr = (*voice)->SetOutputMatrix(nullptr, wfx->nChannels, masterChannels, matrix);
+                        hr = oneShot->voice->SetOutputMatrix(nullptr, wfx->nChannels, masterChannels, matrix);
                         ThrowIfFailed(hr);
                     }
                 }
-                else if ((mVoicePool.size() + mOneShots.size() + 1) >= maxVoiceOneshots)
+                else if ((mIdleVoiceCount + mOneShotCount + 1) >= maxVoiceOneshots)
                 {
                     DebugTrace("WARNING: Too many one-shot voices in use (%zu + %zu >= %zu); one-shot not played\n",
-                        mVoicePool.size(), mOneShots.size() + 1, maxVoiceOneshots);
+                        mIdleVoiceCount, mOneShotCount + 1, maxVoiceOneshots);
                     return;
                 }
                 else
                 {
-                    // makeVoiceKey already constrained the supported wfx formats to those supported for reuse
-
-                    char buff[64] = {};
-                    auto wfmt = reinterpret_cast<WAVEFORMATEX*>(buff);
-
-                    const uint32_t tag = GetFormatTag(wfx);
-                    switch (tag)
-                    {
-                    case WAVE_FORMAT_PCM:
-                        CreateIntegerPCM(wfmt, defaultRate, wfx->nChannels, wfx->wBitsPerSample);
-                        break;
-
-                    case WAVE_FORMAT_IEEE_FLOAT:
-                        CreateFloatPCM(wfmt, defaultRate, wfx->nChannels);
-                        break;
-
-                    case WAVE_FORMAT_ADPCM:
-                        {
-                            auto wfadpcm = reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx);
-                            CreateADPCM(wfmt, sizeof(buff), defaultRate, wfx->nChannels, wfadpcm->wSamplesPerBlock);
-                        }
-                        break;
-
-                    #ifdef DIRECTX_ENABLE_XMA2
-                    case WAVE_FORMAT_XMA2:
-                        CreateXMA2(wfmt, sizeof(buff), defaultRate, wfx->nChannels, 65536, 2, 0);
-                        break;
-                    #endif
-                    }
-
-                #ifdef VERBOSE_TRACE
-                    DebugTrace("INFO: Allocate reuse voice: Format Tag %u, %u channels, %u-bit, %u blkalign, %u Hz\n",
-                        wfmt->wFormatTag, wfmt->nChannels, wfmt->wBitsPerSample, wfmt->nBlockAlign, wfmt->nSamplesPerSec);
-                #endif
-
-                    assert(voiceKey == makeVoiceKey(wfmt));
-
-                    HRESULT hr = xaudio2->CreateSourceVoice(voice, wfmt, 0, XAUDIO2_DEFAULT_FREQ_RATIO, &mVoiceCallback, nullptr, nullptr);
+                    HRESULT hr = CreateReuseVoice(wfx, voiceKey, &oneShot);
                     if (FAILED(hr))
                     {
                         DebugTrace("ERROR: CreateSourceVoice (reuse) failed with error %08X\n", static_cast<unsigned int>(hr));
                         throw std::runtime_error("CreateSourceVoice");
                     }
+
+                    LinkOneShot(oneShot);
                 }
 
-                assert(*voice != nullptr);
-                HRESULT hr = (*voice)->SetSourceSampleRate(wfx->nSamplesPerSec);
+                assert(oneShot != nullptr && oneShot->voice != nullptr);
+                HRESULT hr = oneShot->voice->SetSourceSampleRate(wfx->nSamplesPerSec);
                 if (FAILED(hr))
                 {
                     DebugTrace("ERROR: SetSourceSampleRate failed with error %08X\n", static_cast<unsigned int>(hr));
+                    UnlinkOneShot(oneShot);
+                    DestroyOneShot(oneShot);
                     throw std::runtime_error("SetSourceSampleRate");
                 }
+
+                *voice = oneShot->voice;
             }
         }
     }
@@ -982,14 +1055,32 @@ void AudioEngine::Impl::AllocateVoice(
     {
         if (oneshot)
         {
-            if ((mVoicePool.size() + mOneShots.size() + 1) >= maxVoiceOneshots)
+            if ((mIdleVoiceCount + mOneShotCount + 1) >= maxVoiceOneshots)
             {
                 DebugTrace("WARNING: Too many one-shot voices in use (%zu + %zu >= %zu); one-shot not played; see TrimVoicePool\n",
-                    mVoicePool.size(), mOneShots.size() + 1, maxVoiceOneshots);
+                    mIdleVoiceCount, mOneShotCount + 1, maxVoiceOneshots);
                 return;
             }
+
+        #ifdef VERBOSE_TRACE
+            DebugTrace("INFO: Allocate one-use voice: Format Tag %u, %u channels, %u-bit, %u blkalign, %u Hz\n",
+                wfx->wFormatTag, wfx->nChannels, wfx->wBitsPerSample, wfx->nBlockAlign, wfx->nSamplesPerSec);
+        #endif
+
+            // A zero voiceKey means the voice is destroyed rather than reused when it finishes
+            HRESULT hr = CreateOneShotVoice(wfx, 0, &oneShot);
+            if (FAILED(hr))
+            {
+                DebugTrace("ERROR: CreateSourceVoice failed with error %08X\n", static_cast<unsigned int>(hr));
+                throw std::runtime_error("CreateSourceVoice");
+            }
+
+            LinkOneShot(oneShot);
+            *voice = oneShot->voice;
+            return;
         }
-        else if ((mVoiceInstances + 1) >= maxVoiceInstances)
+
+        if ((mVoiceInstances + 1) >= maxVoiceInstances)
         {
             DebugTrace("ERROR: Too many instance voices (%zu >= %zu); see TrimVoicePool\n",
                 mVoiceInstances + 1, maxVoiceInstances);
@@ -1030,16 +1121,8 @@ void AudioEngine::Impl::AllocateVoice(
             DebugTrace("ERROR: CreateSourceVoice failed with error %08X\n", static_cast<unsigned int>(hr));
             throw std::runtime_error("CreateSourceVoice");
         }
-        else if (!oneshot)
-        {
-            ++mVoiceInstances;
-        }
-    }
 
-    if (oneshot)
-    {
-        assert(*voice != nullptr);
-        mOneShots.emplace_back(std::make_pair(voiceKey, *voice));
+        ++mVoiceInstances;
     }
 }
 
@@ -1050,9 +1133,9 @@ void AudioEngine::Impl::DestroyVoice(_In_ IXAudio2SourceVoice* voice) noexcept
         return;
 
 #ifndef NDEBUG
-    for (const auto& it : mOneShots)
+    for (auto it = mOneShots; it != nullptr; it = it->next)
     {
-        if (it.second == voice)
+        if (it->voice == voice)
         {
             DebugTrace("ERROR: DestroyVoice should not be called for a one-shot voice\n");
             return;
@@ -1061,10 +1144,13 @@ void AudioEngine::Impl::DestroyVoice(_In_ IXAudio2SourceVoice* voice) noexcept
 
     for (const auto& it : mVoicePool)
     {
-        if (it.second == voice)
+        for (auto idle = it.second.idle; idle != nullptr; idle = idle->next)
         {
-            DebugTrace("ERROR: DestroyVoice should not be called for a one-shot voice; see TrimVoicePool\n");
-            return;
+            if (idle->voice == voice)
+            {
+                DebugTrace("ERROR: DestroyVoice should not be called for a one-shot voice; see TrimVoicePool\n");
+                return;
+            }
         }
     }
 #endif
@@ -1075,6 +1161,314 @@ void AudioEngine::Impl::DestroyVoice(_In_ IXAudio2SourceVoice* voice) noexcept
 }
 
 
+_Use_decl_annotations_
+void AudioEngine::Impl::SetVoicePoolWatermarks(size_t lowWatermark, size_t highWatermark, const WAVEFORMATEX* wfx)
+{
+    if (lowWatermark > highWatermark)
+        throw std::invalid_argument("Low watermark cannot exceed the high watermark");
+
+    if (!wfx)
+    {
+        defaultLowWatermark = lowWatermark;
+        defaultHighWatermark = highWatermark;
+
+        for (auto& it : mVoicePool)
+        {
+            it.second.lowWatermark = lowWatermark;
+            it.second.highWatermark = highWatermark;
+            TrimBucket(it.second, highWatermark);
+        }
+        return;
+    }
+
+    const unsigned int voiceKey = makeVoiceKey(wfx);
+    if (!voiceKey)
+    {
+        DebugTrace("WARNING: Voice pool watermarks ignored for a format that does not support voice reuse\n");
+        return;
+    }
+
+    auto& bucket = GetVoiceBucket(voiceKey);
+    bucket.lowWatermark = lowWatermark;
+    bucket.highWatermark = highWatermark;
+    TrimBucket(bucket, highWatermark);
+}
+
+
+_Use_decl_annotations_
+void AudioEngine::Impl::PrewarmVoices(const WAVEFORMATEX* wfx)
+{
+    if (!wfx || !xaudio2 || mCriticalError || (mEngineFlags & AudioEngine_DisableVoiceReuse))
+        return;
+
+    const unsigned int voiceKey = makeVoiceKey(wfx);
+    if (!voiceKey)
+        return;
+
+    auto& bucket = GetVoiceBucket(voiceKey);
+    while (bucket.idleCount < bucket.lowWatermark)
+    {
+        if ((mIdleVoiceCount + mOneShotCount + 1) >= maxVoiceOneshots)
+            break;
+
+        OneShotVoice* oneShot = nullptr;
+        HRESULT hr = CreateReuseVoice(wfx, voiceKey, &oneShot);
+        if (FAILED(hr))
+        {
+            DebugTrace("WARNING: Prewarming voice pool failed with error %08X\n", static_cast<unsigned int>(hr));
+            break;
+        }
+
+        oneShot->next = bucket.idle;
+        bucket.idle = oneShot;
+        ++bucket.idleCount;
+        ++mIdleVoiceCount;
+    }
+}
+
+
+VoicePoolBucket& AudioEngine::Impl::GetVoiceBucket(unsigned int voiceKey)
+{
+    assert(voiceKey != 0);
+
+    auto it = mVoicePool.find(voiceKey);
+    if (it != mVoicePool.end())
+        return it->second;
+
+    const VoicePoolBucket bucket = { nullptr, 0, defaultLowWatermark, defaultHighWatermark };
+    return mVoicePool.emplace(voiceKey, bucket).first->second;
+}
+
+
+_Use_decl_annotations_
+HRESULT AudioEngine::Impl::CreateOneShotVoice(const WAVEFORMATEX* wfx, unsigned int voiceKey, OneShotVoice** result)
+{
+    assert(result != nullptr);
+    *result = nullptr;
+
+    auto oneShot = std::make_unique<OneShotVoice>(voiceKey, &mCompletedOneShots, mVoiceCallback.mBufferEnd.get());
+
+    HRESULT hr = xaudio2->CreateSourceVoice(&oneShot->voice, wfx, 0, XAUDIO2_DEFAULT_FREQ_RATIO, oneShot.get(), nullptr, nullptr);
+    if (FAILED(hr))
+        return hr;
+
+    *result = oneShot.release();
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT AudioEngine::Impl::CreateReuseVoice(const WAVEFORMATEX* wfx, unsigned int voiceKey, OneShotVoice** result)
+{
+    // makeVoiceKey already constrained the supported wfx formats to those supported for reuse
+
+    char buff[64] = {};
+    auto wfmt = reinterpret_cast<WAVEFORMATEX*>(buff);
+
+    const uint32_t tag = GetFormatTag(wfx);
+    switch (tag)
+    {
+    case WAVE_FORMAT_PCM:
+        CreateIntegerPCM(wfmt, defaultRate, wfx->nChannels, wfx->wBitsPerSample);
+        break;
+
+    case WAVE_FORMAT_IEEE_FLOAT:
+        CreateFloatPCM(wfmt, defaultRate, wfx->nChannels);
+        break;
+
+    case WAVE_FORMAT_ADPCM:
+        {
+            auto wfadpcm = reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx);
+            CreateADPCM(wfmt, sizeof(buff), defaultRate, wfx->nChannels, wfadpcm->wSamplesPerBlock);
+        }
+        break;
+
+    #ifdef DIRECTX_ENABLE_XMA2
+    case WAVE_FORMAT_XMA2:
+        CreateXMA2(wfmt, sizeof(buff), defaultRate, wfx->nChannels, 65536, 2, 0);
+        break;
+    #endif
+    }
+
+#ifdef VERBOSE_TRACE
+    DebugTrace("INFO: Allocate reuse voice: Format Tag %u, %u channels, %u-bit, %u blkalign, %u Hz\n",
+        wfmt->wFormatTag, wfmt->nChannels, wfmt->wBitsPerSample, wfmt->nBlockAlign, wfmt->nSamplesPerSec);
+#endif
+
+    assert(voiceKey == makeVoiceKey(wfmt));
+
+    return CreateOneShotVoice(wfmt, voiceKey, result);
+}
+
+
+_Use_decl_annotations_
+void AudioEngine::Impl::LinkOneShot(OneShotVoice* oneShot) noexcept
+{
+    assert(oneShot != nullptr && !oneShot->active);
+
+    oneShot->active = true;
+    oneShot->prev = nullptr;
+    oneShot->next = mOneShots;
+    if (mOneShots)
+    {
+        mOneShots->prev = oneShot;
+    }
+    mOneShots = oneShot;
+    ++mOneShotCount;
+}
+
+
+_Use_decl_annotations_
+void AudioEngine::Impl::UnlinkOneShot(OneShotVoice* oneShot) noexcept
+{
+    assert(oneShot != nullptr && oneShot->active);
+
+    if (oneShot->prev)
+    {
+        oneShot->prev->next = oneShot->next;
+    }
+    else
+    {
+        mOneShots = oneShot->next;
+    }
+
+    if (oneShot->next)
+    {
+        oneShot->next->prev = oneShot->prev;
+    }
+
+    oneShot->active = false;
+    oneShot->prev = oneShot->next = nullptr;
+
+    assert(mOneShotCount > 0);
+    --mOneShotCount;
+}
+
+
+_Use_decl_annotations_
+void AudioEngine::Impl::RecycleOneShot(OneShotVoice* oneShot) noexcept
+{
+    assert(oneShot != nullptr && !oneShot->active);
+
+    if (oneShot->voiceKey && !(mEngineFlags & AudioEngine_DisableVoiceReuse))
+    {
+        auto it = mVoicePool.find(oneShot->voiceKey);
+        if (it != mVoicePool.end() && it->second.idleCount < it->second.highWatermark)
+        {
+            // Put voice back into voice pool for reuse since it has a non-zero voiceKey
+        #ifdef VERBOSE_TRACE
+            DebugTrace("INFO: One-shot voice being saved for reuse (%08X)\n", oneShot->voiceKey);
+        #endif
+            oneShot->next = it->second.idle;
+            it->second.idle = oneShot;
+            ++it->second.idleCount;
+            ++mIdleVoiceCount;
+            return;
+        }
+    }
+
+    // Voice is to be destroyed rather than reused
+#ifdef VERBOSE_TRACE
+    DebugTrace("INFO: Destroying one-shot voice\n");
+#endif
+    DestroyOneShot(oneShot);
+}
+
+
+void AudioEngine::Impl::CollectOneShots() noexcept
+{
+    auto entry = InterlockedFlushSList(&mCompletedOneShots);
+    while (entry)
+    {
+        auto oneShot = CONTAINING_RECORD(entry, OneShotVoice, entry);
+        entry = entry->Next;
+
+        // Clear before checking so a buffer that ends after this point signals again
+        InterlockedExchange(&oneShot->signalled, 0);
+
+        if (!oneShot->active)
+            continue;
+
+        XAUDIO2_VOICE_STATE xstate;
+        oneShot->voice->GetState(&xstate, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+
+        if (!xstate.BuffersQueued)
+        {
+            std::ignore = oneShot->voice->Stop(0);
+            UnlinkOneShot(oneShot);
+            RecycleOneShot(oneShot);
+        }
+        else
+        {
+            // OnBufferEnd can run before the voice state drops the buffer, and a one-shot has no later
+            // buffer to signal it again, so check it on the next Update
+            oneShot->Signal();
+        }
+    }
+}
+
+
+void AudioEngine::Impl::TrimBucket(VoicePoolBucket& bucket, size_t keep) noexcept
+{
+    while (bucket.idleCount > keep)
+    {
+        auto oneShot = bucket.idle;
+        assert(oneShot != nullptr);
+        bucket.idle = oneShot->next;
+        --bucket.idleCount;
+
+        assert(mIdleVoiceCount > 0);
+        --mIdleVoiceCount;
+
+        DestroyOneShot(oneShot);
+    }
+}
+
+
+void AudioEngine::Impl::DestroyOneShots() noexcept
+{
+    // DestroyVoice waits for any callback in progress, so after this no voice can push onto the completed list
+    for (auto it = mOneShots; it != nullptr; it = it->next)
+    {
+        assert(it->voice != nullptr);
+        it->voice->DestroyVoice();
+        it->voice = nullptr;
+    }
+
+    for (auto& it : mVoicePool)
+    {
+        for (auto idle = it.second.idle; idle != nullptr; idle = idle->next)
+        {
+            assert(idle->voice != nullptr);
+            idle->voice->DestroyVoice();
+            idle->voice = nullptr;
+        }
+    }
+
+    std::ignore = InterlockedFlushSList(&mCompletedOneShots);
+
+    while (mOneShots)
+    {
+        auto oneShot = mOneShots;
+        mOneShots = oneShot->next;
+        DestroyOneShot(oneShot);
+    }
+
+    for (auto& it : mVoicePool)
+    {
+        while (it.second.idle)
+        {
+            auto oneShot = it.second.idle;
+            it.second.idle = oneShot->next;
+            DestroyOneShot(oneShot);
+        }
+    }
+    mVoicePool.clear();
+
+    mOneShotCount = mIdleVoiceCount = 0;
+}
+
+
 void AudioEngine::Impl::RegisterNotify(_In_ IVoiceNotify* notify, bool usesUpdate)
 {
     assert(notify != nullptr);
@@ -1095,33 +1489,76 @@ void AudioEngine::Impl::UnregisterNotify(_In_ IVoiceNotify* notify, bool usesOne
     // Check for any pending one-shots for this notification object
     if (usesOneShots)
     {
-        bool setevent = false;
-
-        for (auto& it : mOneShots)
+        for (auto it = mOneShots; it != nullptr; it = it->next)
         {
-            assert(it.second != nullptr);
+            assert(it->voice != nullptr);
 
             XAUDIO2_VOICE_STATE state;
-            it.second->GetState(&state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+            it->voice->GetState(&state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
 
             if (state.pCurrentBufferContext == notify)
             {
-                std::ignore = it.second->Stop(0);
-                std::ignore = it.second->FlushSourceBuffers();
-                setevent = true;
+                std::ignore = it->voice->Stop(0);
+                std::ignore = it->voice->FlushSourceBuffers();
+
+                // Queue for collection on next call to Update...
+                it->Signal();
             }
         }
+    }
 
-        if (setevent)
+    if (usesUpdate)
+    {
+        mNotifyUpdates.erase(notify);
+    }
+}
+
+
+void AudioEngine::Impl::IssueStreamReads() noexcept
+{
+    std::ignore = mStreamReads.Issue([](const StreamScheduler::ReadQueue<IStreamReader>::Request& request) noexcept
         {
-            // Trigger scan on next call to Update...
-            SetEvent(mVoiceCallback.mBufferEnd.get());
+            assert(request.owner != nullptr);
+            return request.owner->IssueRead(request.packet);
+        });
+}
+
+
+void AudioEngine::Impl::UpdateVirtualVoices()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = mLastUpdateValid ? std::chrono::duration<double>(now - mLastUpdate).count() : 0.0;
+    mLastUpdate = now;
+    mLastUpdateValid = true;
+
+    if (mVirtualVoices.empty())
+        return;
+
+    mSchedulerVoices.clear();
+    mSchedulerCandidates.clear();
+
+    for (auto it : mVirtualVoices)
+    {
+        assert(it != nullptr);
+        if (!it->IsReal())
+        {
+            it->Advance(elapsed);
         }
+
+        if (!it->IsPlaying())
+            continue;
+
+        const VoiceScheduler::Candidate candidate = { it->GetPriority(), it->GetAudibility(), it->IsReal(), false };
+        mSchedulerVoices.push_back(it);
+        mSchedulerCandidates.push_back(candidate);
     }
 
-    if (usesUpdate)
+    VoiceScheduler::Schedule(mSchedulerCandidates.data(), mSchedulerCandidates.size(), maxRealVoices, minAudibility);
+
+    const size_t failed = VoiceScheduler::Apply(mSchedulerCandidates.data(), mSchedulerVoices.data(), mSchedulerVoices.size());
+    if (failed > 0)
     {
-        mNotifyUpdates.erase(notify);
+        DebugTrace("WARNING: Failed to promote %zu virtual instance(s); they remain virtual\n", failed);
     }
 }
 
@@ -1272,6 +1709,9 @@ void AudioEngine::Resume()
         DebugTrace("WARNING: Resume of the audio engine failed; running in 'silent mode'\n");
         pImpl->SetSilentMode();
     }
+
+    // Time spent suspended does not advance virtual instances
+    pImpl->mLastUpdateValid = false;
 }
 
 
@@ -1388,6 +1828,20 @@ bool AudioEngine::IsCriticalError() const noexcept
 }
 
 
+_Use_decl_annotations_
+void AudioEngine::Render(float* output, size_t frames)
+{
+    if (!(pImpl->mEngineFlags & AudioEngine_SoftwareMixer))
+        throw std::runtime_error("Render requires AudioEngine_SoftwareMixer");
+
+    // In 'silent mode' there is no mastering voice, so GetOutputChannels() is 0 and there is nothing to write
+    if (!pImpl->xaudio2)
+        return;
+
+    RenderSoftwareAudio(pImpl->xaudio2.Get(), output, frames);
+}
+
+
 // Voice management.
 void AudioEngine::SetDefaultSampleRate(int sampleRate)
 {
@@ -1408,6 +1862,40 @@ void AudioEngine::SetMaxVoicePool(size_t maxOneShots, size_t maxInstances)
 }
 
 
+_Use_decl_annotations_
+void AudioEngine::SetVoicePoolWatermarks(size_t lowWatermark, size_t highWatermark, const WAVEFORMATEX* wfx)
+{
+    pImpl->SetVoicePoolWatermarks(lowWatermark, highWatermark, wfx);
+}
+
+
+void AudioEngine::SetVirtualVoiceBudget(size_t maxRealVoices, float minAudibility)
+{
+    if (minAudibility < 0.f)
+        throw std::out_of_range("Minimum audibility cannot be negative");
+
+    pImpl->maxRealVoices = maxRealVoices;
+    pImpl->minAudibility = minAudibility;
+}
+
+
+void AudioEngine::SetStreamingParameters(size_t bufferCount, size_t packetBytes, size_t maxPendingReads)
+{
+    if (bufferCount < 2 || bufferCount > 16)
+        throw std::out_of_range("Streaming buffer count must be 2 to 16");
+
+    if (packetBytes > UINT32_MAX / bufferCount)
+        throw std::out_of_range("Streaming packet size is too large");
+
+    pImpl->streamBufferCount = bufferCount;
+    pImpl->streamPacketBytes = packetBytes;
+    pImpl->mStreamReads.SetMaxInFlight(maxPendingReads);
+
+    // Raising the limit may allow queued reads to start now
+    pImpl->IssueStreamReads();
+}
+
+
 void AudioEngine::TrimVoicePool()
 {
     pImpl->TrimVoicePool();
@@ -1431,6 +1919,12 @@ void AudioEngine::DestroyVoice(_In_ IXAudio2SourceVoice* voice) noexcept
 }
 
 
+void AudioEngine::PrewarmVoices(_In_ const WAVEFORMATEX* wfx)
+{
+    pImpl->PrewarmVoices(wfx);
+}
+
+
 void AudioEngine::RegisterNotify(_In_ IVoiceNotify* notify, bool usesUpdate)
 {
     pImpl->RegisterNotify(notify, usesUpdate);
@@ -1443,6 +1937,51 @@ void AudioEngine::UnregisterNotify(_In_ IVoiceNotify* notify, bool oneshots, boo
 }
 
 
+void AudioEngine::RegisterVirtualVoice(_In_ IVirtualVoice* voice)
+{
+    assert(voice != nullptr);
+    pImpl->mVirtualVoices.insert(voice);
+}
+
+
+void AudioEngine::UnregisterVirtualVoice(_In_ IVirtualVoice* voice) noexcept
+{
+    assert(voice != nullptr);
+    pImpl->mVirtualVoices.erase(voice);
+}
+
+
+_Use_decl_annotations_
+void AudioEngine::GetStreamingParameters(size_t* bufferCount, size_t* packetBytes) const noexcept
+{
+    assert(bufferCount != nullptr && packetBytes != nullptr);
+    *bufferCount = pImpl->streamBufferCount;
+    *packetBytes = pImpl->streamPacketBytes;
+}
+
+
+void AudioEngine::QueueStreamRead(_In_ IStreamReader* reader, uint32_t packet, uint64_t deadline)
+{
+    assert(reader != nullptr);
+    pImpl->mStreamReads.Push(reader, packet, deadline);
+    pImpl->IssueStreamReads();
+}
+
+
+void AudioEngine::CompleteStreamRead() noexcept
+{
+    pImpl->mStreamReads.Complete();
+}
+
+
+void AudioEngine::CancelStreamReads(_In_ IStreamReader* reader, size_t pendingReads) noexcept
+{
+    assert(reader != nullptr);
+    pImpl->mStreamReads.Cancel(reader);
+    pImpl->mStreamReads.Complete(pendingReads);
+}
+
+
 IXAudio2* AudioEngine::GetInterface() const noexcept
 {
     return pImpl->xaudio2.Get();
@@ -10,9 +10,16 @@
 
 #include "pch.h"
 #include "SoundCommon.h"
+#include "RingBuffer.h"
 
 using namespace DirectX;
 
+namespace
+{
+    // Ring segments in flight at once, well under XAUDIO2_MAX_QUEUED_BUFFERS
+    constexpr size_t MAX_RING_SEGMENTS = 32;
+}
+
 
 //======================================================================================
 // DynamicSoundEffectInstance
@@ -25,11 +32,17 @@ public:
     Impl(_In_ AudioEngine* engine,
         _In_ DynamicSoundEffectInstance* object,
         std::function<void(DynamicSoundEffectInstance*)>& bufferNeeded,
+        size_t ringBufferBytes,
         int sampleRate, int channels, int sampleBits,
         SOUND_EFFECT_INSTANCE_FLAGS flags) :
         mBase(),
         mBufferNeeded(nullptr),
-        mObject(object)
+        mObject(object),
+        mSegments{},
+        mSegmentHead(0),
+        mSegmentCount(0),
+        mUnderruns(0),
+        mStarved(true)
     {
         if ((sampleRate < XAUDIO2_MIN_SAMPLE_RATE)
             || (sampleRate > XAUDIO2_MAX_SAMPLE_RATE))
@@ -63,6 +76,19 @@ public:
 
         CreateIntegerPCM(&mWaveFormat, sampleRate, channels, sampleBits);
 
+        if (ringBufferBytes > 0)
+        {
+            const size_t blockAlign = mWaveFormat.nBlockAlign;
+            const size_t capacity = ((ringBufferBytes + blockAlign - 1) / blockAlign) * blockAlign;
+            if (capacity > XAUDIO2_MAX_BUFFER_BYTES)
+            {
+                DebugTrace("DynamicSoundEffectInstance ring buffer must be no larger than %u bytes\n", XAUDIO2_MAX_BUFFER_BYTES);
+                throw std::out_of_range("DynamicSoundEffectInstance ring buffer too large");
+            }
+
+            mRing = std::make_unique<RingBuffer::SPSCRing>(capacity);
+        }
+
         assert(engine != nullptr);
         engine->RegisterNotify(this, true);
 
@@ -94,6 +120,18 @@ public:
 
     void SubmitBuffer(_In_reads_bytes_(audioBytes) const uint8_t* pAudioData, uint32_t offset, size_t audioBytes);
 
+    size_t WriteRingBuffer(_In_reads_bytes_(audioBytes) const uint8_t* pAudioData, size_t audioBytes) noexcept
+    {
+        if (!mRing || !pAudioData)
+            return 0;
+
+        return mRing->Write(pAudioData, audioBytes, mWaveFormat.nBlockAlign);
+    }
+
+    size_t GetRingBufferSpace() const noexcept { return (mRing) ? mRing->GetFree() : 0; }
+    size_t GetUnderrunCount() const noexcept { return mUnderruns; }
+    size_t GetOverrunCount() const noexcept { return (mRing) ? mRing->GetOverruns() : 0; }
+
     const WAVEFORMATEX* GetFormat() const noexcept { return &mWaveFormat; }
 
     // IVoiceNotify
@@ -140,6 +178,16 @@ private:
     std::function<void(DynamicSoundEffectInstance*)>    mBufferNeeded;
     DynamicSoundEffectInstance*                         mObject;
     WAVEFORMATEX                                        mWaveFormat;
+
+    // Ring buffer mode: sizes of the runs submitted to the voice, oldest first
+    std::unique_ptr<RingBuffer::SPSCRing>               mRing;
+    uint32_t                                            mSegments[MAX_RING_SEGMENTS];
+    size_t                                              mSegmentHead;
+    size_t                                              mSegmentCount;
+    size_t                                              mUnderruns;
+    bool                                                mStarved;
+
+    void UpdateRing();
 };
 
 
@@ -150,7 +198,11 @@ void DynamicSoundEffectInstance::Impl::Play()
         mBase.AllocateVoice(&mWaveFormat);
     }
 
-    std::ignore = mBase.Play();
+    if (mBase.Play())
+    {
+        // Waiting for the first data is not an underrun
+        mStarved = true;
+    }
 
     if (mBase.voice && (mBase.state == PLAYING) && (mBase.GetPendingBufferCount() <= 2))
     {
@@ -182,6 +234,12 @@ void DynamicSoundEffectInstance::Impl::SubmitBuffer(const uint8_t* pAudioData, u
     if (audioBytes > UINT32_MAX)
         throw std::out_of_range("SubmitBuffer");
 
+    if (mRing)
+    {
+        DebugTrace("ERROR: DynamicSoundEffectInstance created with a ring buffer is fed with WriteRingBuffer\n");
+        throw std::runtime_error("SubmitBuffer");
+    }
+
     XAUDIO2_BUFFER buffer = {};
     buffer.AudioBytes = static_cast<UINT32>(audioBytes);
     buffer.pAudioData = pAudioData;
@@ -211,6 +269,12 @@ void DynamicSoundEffectInstance::Impl::SubmitBuffer(const uint8_t* pAudioData, u
 
 void DynamicSoundEffectInstance::Impl::OnUpdate()
 {
+    if (mRing)
+    {
+        UpdateRing();
+        return;
+    }
+
     const DWORD result = WaitForSingleObjectEx(mBufferEvent.get(), 0, FALSE);
     switch (result)
     {
@@ -231,6 +295,55 @@ void DynamicSoundEffectInstance::Impl::OnUpdate()
 }
 
 
+void DynamicSoundEffectInstance::Impl::UpdateRing()
+{
+    // Only ring segments are ever queued, so any beyond the voice's count have finished (or were flushed)
+    const size_t queued = static_cast<size_t>(mBase.GetPendingBufferCount());
+    while (mSegmentCount > queued)
+    {
+        mRing->Release(mSegments[mSegmentHead]);
+        mSegmentHead = (mSegmentHead + 1) % MAX_RING_SEGMENTS;
+        --mSegmentCount;
+    }
+
+    if (!mBase.voice || mBase.state == STOPPED)
+        return;
+
+    // Submit newly written data in place, one buffer per contiguous run
+    while (mSegmentCount < MAX_RING_SEGMENTS)
+    {
+        const uint8_t* data = nullptr;
+        const size_t bytes = mRing->Acquire(&data);
+        if (!bytes)
+            break;
+
+        XAUDIO2_BUFFER buffer = {};
+        buffer.AudioBytes = static_cast<UINT32>(bytes);
+        buffer.pAudioData = data;
+        buffer.pContext = this;
+
+        HRESULT hr = mBase.voice->SubmitSourceBuffer(&buffer, nullptr);
+        if (FAILED(hr))
+        {
+            DebugTrace("ERROR: DynamicSoundEffectInstance failed (%08X) when submitting ring buffer data (%zu bytes)\n",
+                static_cast<unsigned int>(hr), bytes);
+            throw std::runtime_error("SubmitSourceBuffer");
+        }
+
+        mSegments[(mSegmentHead + mSegmentCount) % MAX_RING_SEGMENTS] = static_cast<uint32_t>(bytes);
+        ++mSegmentCount;
+        mStarved = false;
+    }
+
+    if (mBase.state == PLAYING && !mSegmentCount && !mStarved)
+    {
+        // Everything written so far has played out before the producer supplied more
+        mStarved = true;
+        ++mUnderruns;
+    }
+}
+
+
 
 //--------------------------------------------------------------------------------------
 // DynamicSoundEffectInstance
@@ -247,11 +360,28 @@ DynamicSoundEffectInstance::DynamicSoundEffectInstance(
     int channels,
     int sampleBits,
     SOUND_EFFECT_INSTANCE_FLAGS flags) :
-    pImpl(std::make_unique<Impl>(engine, this, bufferNeeded, sampleRate, channels, sampleBits, flags))
+    pImpl(std::make_unique<Impl>(engine, this, bufferNeeded, 0, sampleRate, channels, sampleBits, flags))
 {
 }
 
 
+_Use_decl_annotations_
+DynamicSoundEffectInstance::DynamicSoundEffectInstance(
+    AudioEngine* engine,
+    size_t ringBufferBytes,
+    int sampleRate,
+    int channels,
+    int sampleBits,
+    SOUND_EFFECT_INSTANCE_FLAGS flags)
+{
+    if (!ringBufferBytes)
+        throw std::invalid_argument("DynamicSoundEffectInstance ring buffer size must be non-zero");
+
+    std::function<void(DynamicSoundEffectInstance*)> bufferNeeded;
+    pImpl = std::make_unique<Impl>(engine, this, bufferNeeded, ringBufferBytes, sampleRate, channels, sampleBits, flags);
+}
+
+
 DynamicSoundEffectInstance::DynamicSoundEffectInstance(DynamicSoundEffectInstance&&) noexcept = default;
 DynamicSoundEffectInstance& DynamicSoundEffectInstance::operator= (DynamicSoundEffectInstance&&) noexcept = default;
 DynamicSoundEffectInstance::~DynamicSoundEffectInstance() = default;
@@ -307,6 +437,33 @@ void DynamicSoundEffectInstance::Apply3D(const X3DAUDIO_LISTENER& listener, cons
 }
 
 
+_Use_decl_annotations_
+void DynamicSoundEffectInstance::Apply3D(
+    const X3DAUDIO_LISTENER& listener,
+    DynamicSoundEffectInstance* const* instances,
+    const X3DAUDIO_EMITTER* const* emitters,
+    size_t count,
+    bool rhcoords)
+{
+    if (!count)
+        return;
+
+    if (!instances)
+        throw std::invalid_argument("Apply3D");
+
+    std::vector<SoundEffectInstanceBase*> bases(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        if (!instances[j])
+            throw std::invalid_argument("Apply3D");
+
+        bases[j] = &instances[j]->pImpl->mBase;
+    }
+
+    SoundEffectInstanceBase::Apply3D(listener, bases.data(), emitters, count, rhcoords);
+}
+
+
 _Use_decl_annotations_
 void DynamicSoundEffectInstance::SubmitBuffer(const uint8_t* pAudioData, size_t audioBytes)
 {
@@ -321,6 +478,13 @@ void DynamicSoundEffectInstance::SubmitBuffer(const uint8_t* pAudioData, uint32_
 }
 
 
+_Use_decl_annotations_
+size_t DynamicSoundEffectInstance::WriteRingBuffer(const uint8_t* pAudioData, size_t audioBytes) noexcept
+{
+    return pImpl->WriteRingBuffer(pAudioData, audioBytes);
+}
+
+
 // Public accessors.
 SoundState DynamicSoundEffectInstance::GetState() noexcept
 {
@@ -365,6 +529,24 @@ int DynamicSoundEffectInstance::GetPendingBufferCount() const noexcept
 }
 
 
+size_t DynamicSoundEffectInstance::GetRingBufferSpace() const noexcept
+{
+    return pImpl->GetRingBufferSpace();
+}
+
+
+size_t DynamicSoundEffectInstance::GetUnderrunCount() const noexcept
+{
+    return pImpl->GetUnderrunCount();
+}
+
+
+size_t DynamicSoundEffectInstance::GetOverrunCount() const noexcept
+{
+    return pImpl->GetOverrunCount();
+}
+
+
 unsigned int DynamicSoundEffectInstance::GetChannelCount() const noexcept
 {
     return pImpl->mBase.GetChannelCount();
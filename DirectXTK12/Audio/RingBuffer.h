@@ -0,0 +1,129 @@
+//--------------------------------------------------------------------------------------
+// File: RingBuffer.h
+//
+// Lock-free single-producer/single-consumer byte ring used to feed a
+// DynamicSoundEffectInstance from a worker thread. The consumer reads data in place,
+// so it has no XAudio2 dependency beyond handing out pointers into the storage.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+
+namespace DirectX
+{
+    namespace RingBuffer
+    {
+        // The producer copies data in with Write. The consumer takes contiguous runs in place with Acquire
+        // and returns their space with Release, in the same order, once nothing reads them any more.
+        // Positions are 64-bit running totals, so they never wrap in practice.
+        class SPSCRing
+        {
+        public:
+            explicit SPSCRing(size_t capacity) :
+                mWrite(0),
+                mRelease(0),
+                mAcquire(0),
+                mCapacity(capacity),
+                mOverruns(0),
+                mData(new uint8_t[capacity])
+            {
+                assert(capacity > 0);
+            }
+
+            SPSCRing(SPSCRing const&) = delete;
+            SPSCRing& operator= (SPSCRing const&) = delete;
+
+            size_t GetCapacity() const noexcept { return mCapacity; }
+
+            // Producer: bytes that can be written now
+            size_t GetFree() const noexcept
+            {
+                const uint64_t used = mWrite.load(std::memory_order_relaxed) - mRelease.load(std::memory_order_acquire);
+                return mCapacity - static_cast<size_t>(used);
+            }
+
+            // Producer: copies as much of data as fits, in whole multiples of granularity, and returns the bytes
+            // written. Data that does not fit is dropped and counted as an overrun.
+            size_t Write(_In_reads_bytes_(bytes) const uint8_t* data, size_t bytes, size_t granularity) noexcept
+            {
+                assert(granularity > 0);
+
+                const uint64_t write = mWrite.load(std::memory_order_relaxed);
+                const auto space = mCapacity - static_cast<size_t>(write - mRelease.load(std::memory_order_acquire));
+
+                size_t count = std::min(bytes, space);
+                count -= count % granularity;
+                if (count < bytes)
+                {
+                    mOverruns.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                if (!count)
+                    return 0;
+
+                const auto offset = static_cast<size_t>(write % mCapacity);
+                const size_t first = std::min(count, mCapacity - offset);
+                memcpy(mData.get() + offset, data, first);
+                if (count > first)
+                {
+                    memcpy(mData.get(), data + first, count - first);
+                }
+
+                mWrite.store(write + count, std::memory_order_release);
+                return count;
+            }
+
+            // Consumer: bytes written but not yet acquired
+            size_t GetAvailable() const noexcept
+            {
+                return static_cast<size_t>(mWrite.load(std::memory_order_acquire) - mAcquire);
+            }
+
+            // Consumer: returns the next contiguous run of written data, which stops at the end of the storage,
+            // and marks it acquired. The data stays valid until the run is released.
+            size_t Acquire(_Outptr_ const uint8_t** data) noexcept
+            {
+                const uint64_t write = mWrite.load(std::memory_order_acquire);
+                const auto offset = static_cast<size_t>(mAcquire % mCapacity);
+                const size_t count = std::min(static_cast<size_t>(write - mAcquire), mCapacity - offset);
+
+                *data = mData.get() + offset;
+                mAcquire += count;
+                return count;
+            }
+
+            // Consumer: frees the oldest acquired bytes for the producer
+            void Release(size_t bytes) noexcept
+            {
+                const uint64_t release = mRelease.load(std::memory_order_relaxed) + bytes;
+                assert(release <= mAcquire);
+                mRelease.store(release, std::memory_order_release);
+            }
+
+            size_t GetOverruns() const noexcept { return mOverruns.load(std::memory_order_relaxed); }
+
+        private:
+            // Each position is written by one side only; keep them on separate cache lines
+            alignas(64) std::atomic<uint64_t>   mWrite;
+            alignas(64) std::atomic<uint64_t>   mRelease;
+            alignas(64) uint64_t                mAcquire;
+            size_t                              mCapacity;
+            std::atomic<size_t>                 mOverruns;
+            std::unique_ptr<uint8_t[]>          mData;
+        };
+    }
+}
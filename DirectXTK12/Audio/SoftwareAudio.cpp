@@ -0,0 +1,822 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareAudio.cpp
+//
+// IXAudio2 on top of the portable software backend for AudioEngine_SoftwareMixer. This
+// only translates XAudio2 calls and types; mixing and the voice graph live in
+// SoftwareBackend.h, which has no XAudio2 dependencies and also builds off Windows.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SoundCommon.h"
+#include "SoftwareBackend.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    static_assert(sizeof(ADPCMCOEFSET) == sizeof(ADPCMDecoder::Coefficients), "ADPCM coefficient layout mismatch");
+    static_assert(XAUDIO2_FILTER_TYPE(AudioBackend::FilterType::Notch) == NotchFilter, "Filter type mismatch");
+    static_assert(AudioBackend::VOICE_NOPITCH == XAUDIO2_VOICE_NOPITCH && AudioBackend::VOICE_USEFILTER == XAUDIO2_VOICE_USEFILTER, "Voice flag mismatch");
+    static_assert(AudioBackend::LOOP_INFINITE == XAUDIO2_LOOP_INFINITE && AudioBackend::MAX_QUEUED_BUFFERS == XAUDIO2_MAX_QUEUED_BUFFERS, "Limit mismatch");
+
+    HRESULT ToHRESULT(AudioBackend::Status status) noexcept
+    {
+        switch (status)
+        {
+        case AudioBackend::Status::Ok:              return S_OK;
+        case AudioBackend::Status::NotSupported:    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        default:                                    return XAUDIO2_E_INVALID_CALL;
+        }
+    }
+
+    AudioBackend::FilterParameters ToBackend(const XAUDIO2_FILTER_PARAMETERS& params) noexcept
+    {
+        return { static_cast<AudioBackend::FilterType>(params.Type), params.Frequency, params.OneOverQ };
+    }
+
+    XAUDIO2_FILTER_PARAMETERS FromBackend(const AudioBackend::FilterParameters& params) noexcept
+    {
+        return { static_cast<XAUDIO2_FILTER_TYPE>(params.type), params.frequency, params.oneOverQ };
+    }
+
+    // Returns S_OK if the software mixer can decode this format
+    HRESULT GetBackendFormat(_In_ const WAVEFORMATEX* wfx, AudioBackend::Format& format) noexcept
+    {
+        format = {};
+        format.channels = wfx->nChannels;
+        format.sampleRate = wfx->nSamplesPerSec;
+        format.blockAlign = wfx->nBlockAlign;
+        format.samplesPerBlock = 1;
+
+        switch (GetFormatTag(wfx))
+        {
+        case WAVE_FORMAT_PCM:
+            switch (wfx->wBitsPerSample)
+            {
+            case 8:  format.type = AudioBackend::SampleFormat::PCM8; break;
+            case 16: format.type = AudioBackend::SampleFormat::PCM16; break;
+            case 24: format.type = AudioBackend::SampleFormat::PCM24; break;
+            case 32: format.type = AudioBackend::SampleFormat::PCM32; break;
+            default: return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+            break;
+
+        case WAVE_FORMAT_IEEE_FLOAT:
+            if (wfx->wBitsPerSample != 32)
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+            format.type = AudioBackend::SampleFormat::Float32;
+            break;
+
+        case WAVE_FORMAT_ADPCM:
+            {
+                auto wfadpcm = reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx);
+                format.type = AudioBackend::SampleFormat::ADPCM;
+                format.samplesPerBlock = wfadpcm->wSamplesPerBlock;
+                format.coefficients = reinterpret_cast<const ADPCMDecoder::Coefficients*>(wfadpcm->aCoef);
+                format.coefficientCount = wfadpcm->wNumCoef;
+            }
+            break;
+
+        default:
+            // xWMA and XMA2 need the platform decoders
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        return S_OK;
+    }
+
+    class SoftwareAudio;
+    class VoiceWrapper;
+
+    void DestroyVoiceWrapper(_In_ SoftwareAudio* engine, _In_ VoiceWrapper* voice) noexcept;
+
+    //----------------------------------------------------------------------------------
+    // Adapter state shared by source, submix and mastering voices: the backend voice, and
+    // the effect chain, which the software mixer records but does not apply
+    class VoiceWrapper
+    {
+    public:
+        struct Effect
+        {
+            ComPtr<IUnknown>            effect;
+            bool                        enabled;
+            std::vector<uint8_t>        parameters;
+        };
+
+        VoiceWrapper(_In_ SoftwareAudio* engine, std::recursive_mutex& mutex) noexcept :
+            mEngine(engine),
+            mMutex(mutex),
+            mVoice(nullptr)
+        {
+        }
+
+        VoiceWrapper(VoiceWrapper&&) = delete;
+        VoiceWrapper& operator= (VoiceWrapper&&) = delete;
+
+        VoiceWrapper(VoiceWrapper const&) = delete;
+        VoiceWrapper& operator= (VoiceWrapper const&) = delete;
+
+        virtual ~VoiceWrapper() = default;
+
+        static AudioBackend::Voice* GetBackendVoice(_In_opt_ IXAudio2Voice* voice) noexcept
+        {
+            auto wrapper = dynamic_cast<VoiceWrapper*>(voice);
+            return (wrapper) ? wrapper->mVoice : nullptr;
+        }
+
+        HRESULT SetSends(_In_opt_ const XAUDIO2_VOICE_SENDS* sendList)
+        {
+            // As with XAudio2, no send list routes the voice to the mastering voice
+            if (!sendList)
+                return ToHRESULT(mVoice->SetOutputs(nullptr, nullptr, 0));
+
+            if (sendList->SendCount > 0 && !sendList->pSends)
+                return E_INVALIDARG;
+
+            const size_t count = sendList->SendCount;
+            std::vector<AudioBackend::Voice*> destinations(std::max<size_t>(count, 1), nullptr);
+            std::unique_ptr<bool[]> useFilter(new bool[std::max<size_t>(count, 1)]);
+            for (size_t j = 0; j < count; ++j)
+            {
+                destinations[j] = GetBackendVoice(sendList->pSends[j].pOutputVoice);
+                useFilter[j] = (sendList->pSends[j].Flags & XAUDIO2_SEND_USEFILTER) != 0;
+            }
+
+            // An empty list, unlike no list, leaves the voice unconnected
+            return ToHRESULT(mVoice->SetOutputs(destinations.data(), useFilter.get(), count));
+        }
+
+        HRESULT SetEffects(_In_opt_ const XAUDIO2_EFFECT_CHAIN* effectChain)
+        {
+            std::vector<Effect> effects;
+
+            if (effectChain && effectChain->EffectCount > 0)
+            {
+                if (!effectChain->pEffectDescriptors)
+                    return E_INVALIDARG;
+
+                effects.resize(effectChain->EffectCount);
+                for (uint32_t j = 0; j < effectChain->EffectCount; ++j)
+                {
+                    effects[j].effect = effectChain->pEffectDescriptors[j].pEffect;
+                    effects[j].enabled = effectChain->pEffectDescriptors[j].InitialState != FALSE;
+                }
+
+                static bool s_warned = false;
+                if (!s_warned)
+                {
+                    s_warned = true;
+                    DebugTrace("INFO: Software mixer bypasses effect chains (reverb, mastering limiter)\n");
+                }
+            }
+
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+            mEffects.swap(effects);
+            return S_OK;
+        }
+
+        SoftwareAudio*              mEngine;
+        std::recursive_mutex&       mMutex;
+        AudioBackend::Voice*        mVoice;
+        std::vector<Effect>         mEffects;
+    };
+
+
+    //----------------------------------------------------------------------------------
+    // IXAudio2Voice methods common to all voice types
+    template<typename Interface>
+    class VoiceImpl : public Interface, public VoiceWrapper
+    {
+    public:
+        using VoiceWrapper::VoiceWrapper;
+
+        STDMETHOD_(void, GetVoiceDetails) (_Out_ XAUDIO2_VOICE_DETAILS* pVoiceDetails) override
+        {
+            *pVoiceDetails = {};
+            pVoiceDetails->CreationFlags = mVoice->GetFlags();
+            pVoiceDetails->InputChannels = mVoice->GetChannels();
+            pVoiceDetails->InputSampleRate = mVoice->GetSampleRate();
+        }
+
+        STDMETHOD(SetOutputVoices) (_In_opt_ const XAUDIO2_VOICE_SENDS* pSendList) override
+        {
+            return SetSends(pSendList);
+        }
+
+        STDMETHOD(SetEffectChain) (_In_opt_ const XAUDIO2_EFFECT_CHAIN* pEffectChain) override
+        {
+            return SetEffects(pEffectChain);
+        }
+
+        STDMETHOD(EnableEffect) (UINT32 EffectIndex, UINT32) override
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            if (EffectIndex >= mEffects.size())
+                return XAUDIO2_E_INVALID_CALL;
+
+            mEffects[EffectIndex].enabled = true;
+            return S_OK;
+        }
+
+        STDMETHOD(DisableEffect) (UINT32 EffectIndex, UINT32) override
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            if (EffectIndex >= mEffects.size())
+                return XAUDIO2_E_INVALID_CALL;
+
+            mEffects[EffectIndex].enabled = false;
+            return S_OK;
+        }
+
+        STDMETHOD_(void, GetEffectState) (UINT32 EffectIndex, _Out_ BOOL* pEnabled) override
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+            *pEnabled = (EffectIndex < mEffects.size() && mEffects[EffectIndex].enabled) ? TRUE : FALSE;
+        }
+
+        STDMETHOD(SetEffectParameters) (UINT32 EffectIndex,
+            _In_reads_bytes_(ParametersByteSize) const void* pParameters, UINT32 ParametersByteSize, UINT32) override
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            if (EffectIndex >= mEffects.size() || (!pParameters && ParametersByteSize > 0))
+                return XAUDIO2_E_INVALID_CALL;
+
+            auto ptr = static_cast<const uint8_t*>(pParameters);
+            mEffects[EffectIndex].parameters.assign(ptr, ptr + ParametersByteSize);
+            return S_OK;
+        }
+
+        STDMETHOD(GetEffectParameters) (UINT32 EffectIndex,
+            _Out_writes_bytes_(ParametersByteSize) void* pParameters, UINT32 ParametersByteSize) override
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            if (EffectIndex >= mEffects.size() || !pParameters)
+                return XAUDIO2_E_INVALID_CALL;
+
+            const auto& params = mEffects[EffectIndex].parameters;
+            if (params.size() != ParametersByteSize)
+                return XAUDIO2_E_INVALID_CALL;
+
+            memcpy(pParameters, params.data(), ParametersByteSize);
+            return S_OK;
+        }
+
+        STDMETHOD(SetFilterParameters) (_In_ const XAUDIO2_FILTER_PARAMETERS* pParameters, UINT32) override
+        {
+            return ToHRESULT(mVoice->SetFilter(ToBackend(*pParameters)));
+        }
+
+        STDMETHOD_(void, GetFilterParameters) (_Out_ XAUDIO2_FILTER_PARAMETERS* pParameters) override
+        {
+            *pParameters = FromBackend(mVoice->GetFilter());
+        }
+
+        STDMETHOD(SetOutputFilterParameters) (_In_opt_ IXAudio2Voice* pDestinationVoice,
+            _In_ const XAUDIO2_FILTER_PARAMETERS* pParameters, UINT32) override
+        {
+            auto dest = GetBackendVoice(pDestinationVoice);
+            if (pDestinationVoice && !dest)
+                return XAUDIO2_E_INVALID_CALL;
+
+            return ToHRESULT(mVoice->SetOutputFilter(dest, ToBackend(*pParameters)));
+        }
+
+        STDMETHOD_(void, GetOutputFilterParameters) (_In_opt_ IXAudio2Voice* pDestinationVoice,
+            _Out_ XAUDIO2_FILTER_PARAMETERS* pParameters) override
+        {
+            *pParameters = FromBackend(mVoice->GetOutputFilter(GetBackendVoice(pDestinationVoice)));
+        }
+
+        STDMETHOD(SetVolume) (float Volume, UINT32) override
+        {
+            return ToHRESULT(mVoice->SetVolume(Volume));
+        }
+
+        STDMETHOD_(void, GetVolume) (_Out_ float* pVolume) override
+        {
+            *pVolume = mVoice->GetVolume();
+        }
+
+        STDMETHOD(SetChannelVolumes) (UINT32 Channels, _In_reads_(Channels) const float* pVolumes, UINT32) override
+        {
+            return ToHRESULT(mVoice->SetChannelVolumes(Channels, pVolumes));
+        }
+
+        STDMETHOD_(void, GetChannelVolumes) (UINT32 Channels, _Out_writes_(Channels) float* pVolumes) override
+        {
+            mVoice->GetChannelVolumes(Channels, pVolumes);
+        }
+
+        STDMETHOD(SetOutputMatrix) (_In_opt_ IXAudio2Voice* pDestinationVoice,
+            UINT32 SourceChannels, UINT32 DestinationChannels,
+            _In_reads_(SourceChannels * DestinationChannels) const float* pLevelMatrix, UINT32) override
+        {
+            auto dest = GetBackendVoice(pDestinationVoice);
+            if (pDestinationVoice && !dest)
+                return XAUDIO2_E_INVALID_CALL;
+
+            return ToHRESULT(mVoice->SetOutputMatrix(dest, SourceChannels, DestinationChannels, pLevelMatrix));
+        }
+
+        STDMETHOD_(void, GetOutputMatrix) (_In_opt_ IXAudio2Voice* pDestinationVoice,
+            UINT32 SourceChannels, UINT32 DestinationChannels,
+            _Out_writes_(SourceChannels * DestinationChannels) float* pLevelMatrix) override
+        {
+            mVoice->GetOutputMatrix(GetBackendVoice(pDestinationVoice), SourceChannels, DestinationChannels, pLevelMatrix);
+        }
+
+        STDMETHOD_(void, DestroyVoice) () override
+        {
+            DestroyVoiceWrapper(mEngine, this);
+        }
+    };
+
+
+    //----------------------------------------------------------------------------------
+    // Forwards backend voice callbacks to the XAudio2 client
+    class CallbackAdapter final : public AudioBackend::VoiceCallback
+    {
+    public:
+        explicit CallbackAdapter(_In_opt_ IXAudio2VoiceCallback* callback) noexcept : mCallback(callback) {}
+
+        void OnPassStart(uint32_t bytesRequired) override { mCallback->OnVoiceProcessingPassStart(bytesRequired); }
+        void OnPassEnd() override { mCallback->OnVoiceProcessingPassEnd(); }
+        void OnBufferStart(void* context) override { mCallback->OnBufferStart(context); }
+        void OnBufferEnd(void* context) override { mCallback->OnBufferEnd(context); }
+        void OnLoopEnd(void* context) override { mCallback->OnLoopEnd(context); }
+        void OnStreamEnd() override { mCallback->OnStreamEnd(); }
+
+    private:
+        IXAudio2VoiceCallback* mCallback;
+    };
+
+
+    class SourceVoice final : public VoiceImpl<IXAudio2SourceVoice>
+    {
+    public:
+        SourceVoice(_In_ SoftwareAudio* engine, std::recursive_mutex& mutex, _In_opt_ IXAudio2VoiceCallback* callback) :
+            VoiceImpl(engine, mutex),
+            mSource(nullptr),
+            mHasCallback(callback != nullptr),
+            mCallback(callback)
+        {
+        }
+
+        AudioBackend::VoiceCallback* GetCallback() noexcept { return (mHasCallback) ? &mCallback : nullptr; }
+
+        void Attach(_In_ AudioBackend::SourceVoice* source) noexcept
+        {
+            mSource = source;
+            mVoice = source;
+        }
+
+        STDMETHOD(Start) (UINT32, UINT32) override
+        {
+            mSource->Start();
+            return S_OK;
+        }
+
+        STDMETHOD(Stop) (UINT32, UINT32) override
+        {
+            // There are no effects to play tails through, so XAUDIO2_PLAY_TAILS stops immediately
+            mSource->Stop();
+            return S_OK;
+        }
+
+        STDMETHOD(SubmitSourceBuffer) (_In_ const XAUDIO2_BUFFER* pBuffer, _In_opt_ const XAUDIO2_BUFFER_WMA*) override
+        {
+            if (!pBuffer)
+                return XAUDIO2_E_INVALID_CALL;
+
+            AudioBackend::Buffer buffer = {};
+            buffer.data = pBuffer->pAudioData;
+            buffer.bytes = pBuffer->AudioBytes;
+            buffer.playBegin = pBuffer->PlayBegin;
+            buffer.playLength = pBuffer->PlayLength;
+            buffer.loopBegin = pBuffer->LoopBegin;
+            buffer.loopLength = pBuffer->LoopLength;
+            buffer.loopCount = pBuffer->LoopCount;
+            buffer.endOfStream = (pBuffer->Flags & XAUDIO2_END_OF_STREAM) != 0;
+            buffer.context = pBuffer->pContext;
+
+            return ToHRESULT(mSource->Submit(buffer));
+        }
+
+        STDMETHOD(FlushSourceBuffers) () override
+        {
+            mSource->Flush();
+            return S_OK;
+        }
+
+        STDMETHOD(Discontinuity) () override
+        {
+            mSource->Discontinuity();
+            return S_OK;
+        }
+
+        STDMETHOD(ExitLoop) (UINT32) override
+        {
+            mSource->ExitLoop();
+            return S_OK;
+        }
+
+        STDMETHOD_(void, GetState) (_Out_ XAUDIO2_VOICE_STATE* pVoiceState, UINT32 Flags) override
+        {
+            const auto state = mSource->GetState();
+            pVoiceState->pCurrentBufferContext = state.currentContext;
+            pVoiceState->BuffersQueued = state.buffersQueued;
+            pVoiceState->SamplesPlayed = (Flags & XAUDIO2_VOICE_NOSAMPLESPLAYED) ? 0 : state.samplesPlayed;
+        }
+
+        STDMETHOD(SetFrequencyRatio) (float Ratio, UINT32) override
+        {
+            return ToHRESULT(mSource->SetFrequencyRatio(Ratio));
+        }
+
+        STDMETHOD_(void, GetFrequencyRatio) (_Out_ float* pRatio) override
+        {
+            *pRatio = mSource->GetFrequencyRatio();
+        }
+
+        STDMETHOD(SetSourceSampleRate) (UINT32 NewSourceSampleRate) override
+        {
+            return ToHRESULT(mSource->SetSourceSampleRate(NewSourceSampleRate));
+        }
+
+    private:
+        AudioBackend::SourceVoice*  mSource;
+        bool                        mHasCallback;
+        CallbackAdapter             mCallback;
+    };
+
+
+    //----------------------------------------------------------------------------------
+    class SubmixVoice final : public VoiceImpl<IXAudio2SubmixVoice>
+    {
+    public:
+        using VoiceImpl::VoiceImpl;
+    };
+
+
+    //----------------------------------------------------------------------------------
+    class MasteringVoice final : public VoiceImpl<IXAudio2MasteringVoice>
+    {
+    public:
+        using VoiceImpl::VoiceImpl;
+
+        STDMETHOD(GetChannelMask) (_Out_ DWORD* pChannelmask) override
+        {
+            *pChannelmask = GetDefaultChannelMask(static_cast<int>(mVoice->GetChannels()));
+            return S_OK;
+        }
+    };
+
+
+    //----------------------------------------------------------------------------------
+    class EngineCallbackAdapter final : public AudioBackend::EngineCallback
+    {
+    public:
+        explicit EngineCallbackAdapter(_In_ IXAudio2EngineCallback* callback) noexcept : mCallback(callback) {}
+
+        void OnPassStart() override { mCallback->OnProcessingPassStart(); }
+        void OnPassEnd() override { mCallback->OnProcessingPassEnd(); }
+
+        IXAudio2EngineCallback* mCallback;
+    };
+
+
+    //----------------------------------------------------------------------------------
+    class SoftwareAudio final : public IXAudio2
+    {
+    public:
+        SoftwareAudio() noexcept :
+            mRefCount(1),
+            mRendering(false)
+        {
+        }
+
+        SoftwareAudio(SoftwareAudio&&) = delete;
+        SoftwareAudio& operator= (SoftwareAudio&&) = delete;
+
+        SoftwareAudio(SoftwareAudio const&) = delete;
+        SoftwareAudio& operator= (SoftwareAudio const&) = delete;
+
+        ~SoftwareAudio() = default;
+
+        // IUnknown
+        STDMETHOD(QueryInterface) (REFIID riid, _COM_Outptr_ void** ppvInterface) override
+        {
+            if (!ppvInterface)
+                return E_POINTER;
+
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(IXAudio2))
+            {
+                *ppvInterface = static_cast<IXAudio2*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *ppvInterface = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        STDMETHOD_(ULONG, AddRef) () override
+        {
+            return static_cast<ULONG>(InterlockedIncrement(&mRefCount));
+        }
+
+        STDMETHOD_(ULONG, Release) () override
+        {
+            const auto count = static_cast<ULONG>(InterlockedDecrement(&mRefCount));
+            if (!count)
+            {
+                std::unique_ptr<SoftwareAudio> owner(this);
+            }
+            return count;
+        }
+
+        // IXAudio2
+        STDMETHOD(RegisterForCallbacks) (_In_ IXAudio2EngineCallback* pCallback) override
+        {
+            if (!pCallback)
+                return E_INVALIDARG;
+
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+            if (FindCallback(pCallback) == mCallbacks.end())
+            {
+                mCallbacks.emplace_back(std::make_unique<EngineCallbackAdapter>(pCallback));
+                mBackend.RegisterCallback(mCallbacks.back().get());
+            }
+            return S_OK;
+        }
+
+        STDMETHOD_(void, UnregisterForCallbacks) (_In_ IXAudio2EngineCallback* pCallback) override
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            auto it = FindCallback(pCallback);
+            if (it != mCallbacks.end())
+            {
+                mBackend.UnregisterCallback(it->get());
+                mRetiredCallbacks.emplace_back(std::move(*it));
+                mCallbacks.erase(it);
+                Retire();
+            }
+        }
+
+        STDMETHOD(CreateSourceVoice) (_Outptr_ IXAudio2SourceVoice** ppSourceVoice,
+            _In_ const WAVEFORMATEX* pSourceFormat,
+            UINT32 Flags,
+            float MaxFrequencyRatio,
+            _In_opt_ IXAudio2VoiceCallback* pCallback,
+            _In_opt_ const XAUDIO2_VOICE_SENDS* pSendList,
+            _In_opt_ const XAUDIO2_EFFECT_CHAIN* pEffectChain) override
+        {
+            if (!ppSourceVoice || !pSourceFormat)
+                return E_INVALIDARG;
+
+            *ppSourceVoice = nullptr;
+
+            if (!IsValid(pSourceFormat))
+                return E_INVALIDARG;
+
+            AudioBackend::Format format;
+            HRESULT hr = GetBackendFormat(pSourceFormat, format);
+            if (FAILED(hr))
+                return hr;
+
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            auto voice = std::make_unique<SourceVoice>(this, mMutex, pCallback);
+
+            AudioBackend::SourceVoice* source = nullptr;
+            hr = ToHRESULT(mBackend.CreateSourceVoice(format, Flags, MaxFrequencyRatio, voice->GetCallback(), &source));
+            if (FAILED(hr))
+                return hr;
+
+            voice->Attach(source);
+
+            hr = (pSendList) ? voice->SetSends(pSendList) : S_OK;
+            if (SUCCEEDED(hr))
+                hr = voice->SetEffects(pEffectChain);
+            if (FAILED(hr))
+            {
+                source->Destroy();
+                return hr;
+            }
+
+            *ppSourceVoice = voice.get();
+            mVoices.emplace_back(std::move(voice));
+            return S_OK;
+        }
+
+        STDMETHOD(CreateSubmixVoice) (_Outptr_ IXAudio2SubmixVoice** ppSubmixVoice,
+            UINT32 InputChannels,
+            UINT32 InputSampleRate,
+            UINT32 Flags,
+            UINT32 ProcessingStage,
+            _In_opt_ const XAUDIO2_VOICE_SENDS* pSendList,
+            _In_opt_ const XAUDIO2_EFFECT_CHAIN* pEffectChain) override
+        {
+            if (!ppSubmixVoice)
+                return E_INVALIDARG;
+
+            *ppSubmixVoice = nullptr;
+
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            auto voice = std::make_unique<SubmixVoice>(this, mMutex);
+
+            AudioBackend::Voice* submix = nullptr;
+            HRESULT hr = ToHRESULT(mBackend.CreateSubmixVoice(InputChannels, InputSampleRate, Flags, ProcessingStage, &submix));
+            if (FAILED(hr))
+                return hr;
+
+            if (InputSampleRate != submix->GetSampleRate())
+            {
+                DebugTrace("WARNING: Software mixer runs submix voices at the mastering rate (%u Hz, not %u Hz)\n",
+                    submix->GetSampleRate(), InputSampleRate);
+            }
+
+            voice->mVoice = submix;
+
+            hr = (pSendList) ? voice->SetSends(pSendList) : S_OK;
+            if (SUCCEEDED(hr))
+                hr = voice->SetEffects(pEffectChain);
+            if (FAILED(hr))
+            {
+                submix->Destroy();
+                return hr;
+            }
+
+            *ppSubmixVoice = voice.get();
+            mVoices.emplace_back(std::move(voice));
+            return S_OK;
+        }
+
+        STDMETHOD(CreateMasteringVoice) (_Outptr_ IXAudio2MasteringVoice** ppMasteringVoice,
+            UINT32 InputChannels,
+            UINT32 InputSampleRate,
+            UINT32 Flags,
+            _In_opt_z_ LPCWSTR,
+            _In_opt_ const XAUDIO2_EFFECT_CHAIN* pEffectChain,
+            _In_ AUDIO_STREAM_CATEGORY) override
+        {
+            if (!ppMasteringVoice)
+                return E_INVALIDARG;
+
+            *ppMasteringVoice = nullptr;
+
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            auto voice = std::make_unique<MasteringVoice>(this, mMutex);
+
+            AudioBackend::Voice* master = nullptr;
+            HRESULT hr = ToHRESULT(mBackend.CreateMasteringVoice(InputChannels, InputSampleRate, Flags, &master));
+            if (FAILED(hr))
+                return hr;
+
+            voice->mVoice = master;
+
+            hr = voice->SetEffects(pEffectChain);
+            if (FAILED(hr))
+            {
+                master->Destroy();
+                return hr;
+            }
+
+            *ppMasteringVoice = voice.get();
+            mVoices.emplace_back(std::move(voice));
+            return S_OK;
+        }
+
+        STDMETHOD(StartEngine) () override
+        {
+            mBackend.Start();
+            return S_OK;
+        }
+
+        STDMETHOD_(void, StopEngine) () override
+        {
+            mBackend.Stop();
+        }
+
+        STDMETHOD(CommitChanges) (UINT32) override
+        {
+            // Changes are always applied immediately
+            return S_OK;
+        }
+
+        STDMETHOD_(void, GetPerformanceData) (_Out_ XAUDIO2_PERFORMANCE_DATA* pPerfData) override
+        {
+            const auto data = mBackend.GetPerformanceData();
+
+            *pPerfData = {};
+            pPerfData->ActiveSourceVoiceCount = data.activeSourceVoices;
+            pPerfData->TotalSourceVoiceCount = data.totalSourceVoices;
+            pPerfData->ActiveSubmixVoiceCount = data.submixVoices;
+        }
+
+        STDMETHOD_(void, SetDebugConfiguration) (_In_opt_ const XAUDIO2_DEBUG_CONFIGURATION*, _Reserved_ void*) override
+        {
+        }
+
+        void DestroyWrapper(_In_ VoiceWrapper* voice) noexcept
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            auto it = std::find_if(mVoices.begin(), mVoices.end(),
+                [voice](const std::unique_ptr<VoiceWrapper>& other) noexcept { return other.get() == voice; });
+            if (it == mVoices.end())
+                return;
+
+            voice->mVoice->Destroy();
+
+            // The voice may be destroyed from one of its own callbacks, so keep it until Render returns
+            mRetiredVoices.emplace_back(std::move(*it));
+            mVoices.erase(it);
+            Retire();
+        }
+
+        void Render(_Out_writes_opt_(_Inexpressible_("frames * channels")) float* output, size_t frames)
+        {
+            std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+            mRendering = true;
+            mBackend.Render(output, frames);
+            mRendering = false;
+
+            Retire();
+        }
+
+    private:
+        std::vector<std::unique_ptr<EngineCallbackAdapter>>::iterator FindCallback(_In_opt_ const IXAudio2EngineCallback* callback) noexcept
+        {
+            return std::find_if(mCallbacks.begin(), mCallbacks.end(),
+                [callback](const std::unique_ptr<EngineCallbackAdapter>& it) noexcept { return it->mCallback == callback; });
+        }
+
+        void Retire() noexcept
+        {
+            if (!mRendering)
+            {
+                mRetiredVoices.clear();
+                mRetiredCallbacks.clear();
+            }
+        }
+
+        volatile LONG                                           mRefCount;
+        bool                                                    mRendering;
+        std::recursive_mutex                                    mMutex;
+        AudioBackend::SoftwareBackend                           mBackend;
+        std::vector<std::unique_ptr<EngineCallbackAdapter>>     mCallbacks;
+        std::vector<std::unique_ptr<EngineCallbackAdapter>>     mRetiredCallbacks;
+        std::vector<std::unique_ptr<VoiceWrapper>>              mVoices;
+        std::vector<std::unique_ptr<VoiceWrapper>>              mRetiredVoices;
+    };
+
+
+    void DestroyVoiceWrapper(_In_ SoftwareAudio* engine, _In_ VoiceWrapper* voice) noexcept
+    {
+        assert(engine != nullptr && voice != nullptr);
+        engine->DestroyWrapper(voice);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::CreateSoftwareAudio(IXAudio2** xaudio2) noexcept
+{
+    if (!xaudio2)
+        return E_INVALIDARG;
+
+    *xaudio2 = nullptr;
+
+    auto engine = new (std::nothrow) SoftwareAudio;
+    if (!engine)
+        return E_OUTOFMEMORY;
+
+    *xaudio2 = engine;
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+void DirectX::RenderSoftwareAudio(IXAudio2* xaudio2, float* output, size_t frames)
+{
+    assert(xaudio2 != nullptr);
+    static_cast<SoftwareAudio*>(xaudio2)->Render(output, frames);
+}
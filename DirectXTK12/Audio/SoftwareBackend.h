@@ -0,0 +1,1004 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareBackend.h
+//
+// Portable AudioBackend built on the software mixer. It decodes PCM and ADPCM, resamples,
+// applies volumes, filters and output matrices, and mixes into float buses. There is no
+// device or audio thread: output is produced by Render on the calling thread, as fast as
+// the CPU allows, so voice graphs can be load tested headless.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "AudioBackend.h"
+#include "SoftwareMixer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace AudioBackend
+    {
+        static_assert(SoftwareMixer::FilterType(FilterType::HighPassOnePole) == SoftwareMixer::FilterType::HighPassOnePole, "Filter type mismatch");
+        static_assert(SoftwareMixer::SampleType(SampleFormat::Float32) == SoftwareMixer::SampleType::Float32, "Sample type mismatch");
+
+        class SoftwareBackend final : public Backend
+        {
+        public:
+            static constexpr uint32_t c_defaultChannels = 2;
+            static constexpr uint32_t c_defaultSampleRate = 48000;
+
+            // Processing pass length, matching the XAudio2 10 ms quantum
+            static constexpr uint32_t c_quantumsPerSecond = 100;
+
+            SoftwareBackend() noexcept :
+                mRunning(true),
+                mRendering(false),
+                mPassFrames(0)
+            {
+            }
+
+            SoftwareBackend(SoftwareBackend&&) = delete;
+            SoftwareBackend& operator= (SoftwareBackend&&) = delete;
+
+            SoftwareBackend(SoftwareBackend const&) = delete;
+            SoftwareBackend& operator= (SoftwareBackend const&) = delete;
+
+            ~SoftwareBackend() override = default;
+
+            using Backend::Render;
+
+            Status CreateSourceVoice(const Format& format, uint32_t flags, float maxFrequencyRatio,
+                VoiceCallback* callback, SourceVoice** voice) override
+            {
+                if (!voice)
+                    return Status::InvalidCall;
+
+                *voice = nullptr;
+
+                if (!IsValid(format) || maxFrequencyRatio < MIN_FREQ_RATIO || maxFrequencyRatio > MAX_FREQ_RATIO)
+                    return Status::InvalidCall;
+
+                if (format.type == SampleFormat::ADPCM && (!format.coefficients || !format.coefficientCount))
+                    return Status::NotSupported;
+
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                if (!mMaster)
+                    return Status::InvalidCall;
+
+                auto node = std::make_unique<SourceNode>(this, format, flags, maxFrequencyRatio, callback);
+                node->SetOutputs(nullptr, nullptr, 0);
+
+                *voice = node.get();
+                mSources.emplace_back(std::move(node));
+                return Status::Ok;
+            }
+
+            Status CreateSubmixVoice(uint32_t channels, uint32_t, uint32_t flags, uint32_t processingStage,
+                Voice** voice) override
+            {
+                if (!voice)
+                    return Status::InvalidCall;
+
+                *voice = nullptr;
+
+                if (!channels || channels > MAX_AUDIO_CHANNELS || processingStage >= UINT32_MAX - 1)
+                    return Status::InvalidCall;
+
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                if (!mMaster)
+                    return Status::InvalidCall;
+
+                // Submixes run at the mastering rate
+                auto node = std::make_unique<MixNode>(this, channels, mMaster->mSampleRate, flags, processingStage + 1);
+                node->SetOutputs(nullptr, nullptr, 0);
+
+                *voice = node.get();
+
+                // Keep submixes in processing order
+                auto it = std::upper_bound(mSubmixes.begin(), mSubmixes.end(), node->mStage,
+                    [](uint32_t stage, const std::unique_ptr<MixNode>& other) noexcept { return stage < other->mStage; });
+                mSubmixes.emplace(it, std::move(node));
+                return Status::Ok;
+            }
+
+            Status CreateMasteringVoice(uint32_t channels, uint32_t sampleRate, uint32_t flags,
+                Voice** voice) override
+            {
+                if (!voice)
+                    return Status::InvalidCall;
+
+                *voice = nullptr;
+
+                if (channels > MAX_AUDIO_CHANNELS
+                    || (sampleRate != 0 && (sampleRate < MIN_SAMPLE_RATE || sampleRate > MAX_SAMPLE_RATE)))
+                    return Status::InvalidCall;
+
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                if (mMaster)
+                    return Status::InvalidCall;
+
+                mMaster = std::make_unique<MixNode>(this,
+                    (channels) ? channels : c_defaultChannels,
+                    (sampleRate) ? sampleRate : c_defaultSampleRate,
+                    flags, UINT32_MAX);
+
+                *voice = mMaster.get();
+                return Status::Ok;
+            }
+
+            Voice* GetMasteringVoice() const noexcept override
+            {
+                return mMaster.get();
+            }
+
+            void RegisterCallback(EngineCallback* callback) override
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+                if (callback && std::find(mCallbacks.cbegin(), mCallbacks.cend(), callback) == mCallbacks.cend())
+                {
+                    mCallbacks.push_back(callback);
+                }
+            }
+
+            void UnregisterCallback(EngineCallback* callback) override
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+                mCallbacks.erase(std::remove(mCallbacks.begin(), mCallbacks.end(), callback), mCallbacks.end());
+            }
+
+            void Start() override
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+                mRunning = true;
+            }
+
+            void Stop() override
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+                mRunning = false;
+            }
+
+            PerformanceData GetPerformanceData() const override
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                PerformanceData data = {};
+                for (const auto& it : mSources)
+                {
+                    if (it->mDestroyed)
+                        continue;
+
+                    ++data.totalSourceVoices;
+                    if (it->IsActive())
+                    {
+                        ++data.activeSourceVoices;
+                    }
+                }
+
+                for (const auto& it : mSubmixes)
+                {
+                    if (!it->mDestroyed)
+                    {
+                        ++data.submixVoices;
+                    }
+                }
+                return data;
+            }
+
+            void Render(float* output, size_t frames) override
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                // Output is laid out for the mastering voice at the time of the call
+                const uint32_t channels = (mMaster) ? mMaster->mChannels : 0;
+
+                while (frames > 0)
+                {
+                    MixNode* master = mMaster.get();
+                    if (!master || !mRunning || mRendering || master->mChannels != channels)
+                    {
+                        if (output && channels)
+                        {
+                            memset(output, 0, frames * channels * sizeof(float));
+                        }
+                        return;
+                    }
+
+                    const uint32_t rate = master->mSampleRate;
+                    const size_t count = std::min(frames, std::max<size_t>(rate / c_quantumsPerSecond, 1));
+
+                    mRendering = true;
+                    mPassFrames = count;
+
+                    mCallbackScratch.assign(mCallbacks.cbegin(), mCallbacks.cend());
+                    for (auto it : mCallbackScratch)
+                    {
+                        it->OnPassStart();
+                    }
+
+                    for (auto& it : mSubmixes)
+                    {
+                        it->mBus.assign(count * it->mChannels, 0.f);
+                    }
+                    master->mBus.assign(count * channels, 0.f);
+
+                    // Callbacks may create or destroy voices. Voices created during the pass start on the
+                    // next one, and destroyed voices are only marked until the pass is over.
+                    const size_t sources = mSources.size();
+                    for (size_t j = 0; j < sources; ++j)
+                    {
+                        auto voice = mSources[j].get();
+                        if (!voice->mDestroyed)
+                        {
+                            voice->Process(count, rate);
+                        }
+                    }
+
+                    for (auto& it : mSubmixes)
+                    {
+                        if (!it->mDestroyed)
+                        {
+                            it->Output(it->mBus.data(), count);
+                        }
+                    }
+
+                    float* bus = master->mBus.data();
+                    if (master->mDestroyed)
+                    {
+                        memset(bus, 0, count * channels * sizeof(float));
+                    }
+                    else
+                    {
+                        master->ApplyFilterAndVolume(bus, count);
+                    }
+
+                    if (output)
+                    {
+                        memcpy(output, bus, count * channels * sizeof(float));
+                        output += count * channels;
+                    }
+
+                    for (auto it : mCallbackScratch)
+                    {
+                        it->OnPassEnd();
+                    }
+
+                    mRendering = false;
+                    mPassFrames = 0;
+                    Compact();
+
+                    frames -= count;
+                }
+            }
+
+        private:
+            class NodeState;
+
+            struct Send
+            {
+                NodeState*              dest;
+                bool                    useFilter;
+                std::vector<float>      matrix;
+                FilterParameters        filterParams;
+                SoftwareMixer::Filter   filter;
+            };
+
+            //----------------------------------------------------------------------------
+            // Graph state shared by source, submix and mastering voices
+            class NodeState
+            {
+            public:
+                NodeState(_In_ SoftwareBackend* engine, uint32_t channels, uint32_t sampleRate, uint32_t flags, uint32_t stage) :
+                    mEngine(engine),
+                    mChannels(channels),
+                    mSampleRate(sampleRate),
+                    mFlags(flags),
+                    mStage(stage),
+                    mDestroyed(false),
+                    mVolume(1.f),
+                    mChannelVolumesSet(false),
+                    mFilterParams(c_defaultFilter)
+                {
+                    mChannelVolumes.assign(channels, 1.f);
+                    mBus.assign(engine->mPassFrames * channels, 0.f);
+                }
+
+                NodeState(NodeState&&) = delete;
+                NodeState& operator= (NodeState&&) = delete;
+
+                NodeState(NodeState const&) = delete;
+                NodeState& operator= (NodeState const&) = delete;
+
+                virtual ~NodeState() = default;
+
+                Send* FindSend(_In_opt_ Voice* destination) noexcept
+                {
+                    if (!destination)
+                    {
+                        return (mSends.size() == 1) ? &mSends[0] : nullptr;
+                    }
+
+                    auto dest = dynamic_cast<NodeState*>(destination);
+                    for (auto& it : mSends)
+                    {
+                        if (it.dest == dest)
+                            return &it;
+                    }
+
+                    return nullptr;
+                }
+
+                void RemoveSendsTo(_In_ const NodeState* dest) noexcept
+                {
+                    mSends.erase(std::remove_if(mSends.begin(), mSends.end(),
+                        [dest](const Send& send) noexcept { return send.dest == dest; }), mSends.end());
+                }
+
+                void ApplyFilterAndVolume(_Inout_updates_(frames * mChannels) float* samples, size_t frames)
+                {
+                    if (mFlags & VOICE_USEFILTER)
+                    {
+                        mFilter.Apply(samples, frames, mChannels);
+                    }
+
+                    SoftwareMixer::ApplyVolume(samples, frames, mChannels, mVolume,
+                        mChannelVolumesSet ? mChannelVolumes.data() : nullptr);
+                }
+
+                // Applies this voice's filter and volume to one pass of input, then mixes it into the send buses
+                void Output(_Inout_updates_(frames * mChannels) float* samples, size_t frames)
+                {
+                    ApplyFilterAndVolume(samples, frames);
+
+                    for (auto& it : mSends)
+                    {
+                        assert(it.dest != nullptr);
+                        const uint32_t destChannels = it.dest->mChannels;
+                        assert(it.dest->mBus.size() >= frames * destChannels);
+
+                        if (it.useFilter)
+                        {
+                            mSendScratch.assign(frames * destChannels, 0.f);
+                            SoftwareMixer::MixMatrix(samples, frames, mChannels, it.matrix.data(), mSendScratch.data(), destChannels);
+                            it.filter.Apply(mSendScratch.data(), frames, destChannels);
+
+                            float* bus = it.dest->mBus.data();
+                            for (size_t j = 0; j < mSendScratch.size(); ++j)
+                            {
+                                bus[j] += mSendScratch[j];
+                            }
+                        }
+                        else
+                        {
+                            SoftwareMixer::MixMatrix(samples, frames, mChannels, it.matrix.data(), it.dest->mBus.data(), destChannels);
+                        }
+                    }
+                }
+
+                SoftwareBackend*        mEngine;
+                uint32_t                mChannels;
+                uint32_t                mSampleRate;
+                uint32_t                mFlags;
+                uint32_t                mStage;     // Sources are 0, submixes 1 + processingStage, mastering is last
+                bool                    mDestroyed;
+                float                   mVolume;
+                bool                    mChannelVolumesSet;
+                std::vector<float>      mChannelVolumes;
+                FilterParameters        mFilterParams;
+                SoftwareMixer::Filter   mFilter;
+                std::vector<Send>       mSends;
+                std::vector<float>      mBus;       // Mixed input for the current pass (submix and mastering voices)
+
+            protected:
+                void InitializeSend(Send& send, _In_ NodeState* dest, bool useFilter)
+                {
+                    send.dest = dest;
+                    send.useFilter = useFilter;
+                    send.matrix.resize(size_t(mChannels) * dest->mChannels);
+                    SoftwareMixer::DefaultMatrix(mChannels, dest->mChannels, send.matrix.data());
+                    send.filterParams = c_defaultFilter;
+                }
+
+            private:
+                std::vector<float>      mSendScratch;
+            };
+
+            //----------------------------------------------------------------------------
+            // Voice methods common to all voice types
+            template<typename Interface>
+            class NodeImpl : public Interface, public NodeState
+            {
+            public:
+                using NodeState::NodeState;
+
+                uint32_t GetChannels() const noexcept override { return mChannels; }
+                uint32_t GetSampleRate() const noexcept override { return mSampleRate; }
+                uint32_t GetFlags() const noexcept override { return mFlags; }
+
+                Status SetOutputs(Voice* const* destinations, const bool* useFilter, size_t count) override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    std::vector<Send> sends;
+
+                    if (destinations)
+                    {
+                        sends.resize(count);
+                        for (size_t j = 0; j < count; ++j)
+                        {
+                            auto dest = dynamic_cast<NodeState*>(destinations[j]);
+                            if (!dest || dest->mEngine != mEngine || dest->mDestroyed || dest->mStage <= mStage)
+                                return Status::InvalidCall;
+
+                            InitializeSend(sends[j], dest, useFilter && useFilter[j]);
+                        }
+                    }
+                    else if (mEngine->mMaster && mStage != UINT32_MAX)
+                    {
+                        sends.resize(1);
+                        InitializeSend(sends[0], mEngine->mMaster.get(), false);
+                    }
+
+                    mSends.swap(sends);
+                    return Status::Ok;
+                }
+
+                Status SetVolume(float volume) override
+                {
+                    if (volume < -MAX_VOLUME_LEVEL || volume > MAX_VOLUME_LEVEL)
+                        return Status::InvalidCall;
+
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+                    mVolume = volume;
+                    return Status::Ok;
+                }
+
+                float GetVolume() const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+                    return mVolume;
+                }
+
+                Status SetChannelVolumes(uint32_t channels, const float* volumes) override
+                {
+                    if (channels != mChannels || !volumes)
+                        return Status::InvalidCall;
+
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    mChannelVolumes.assign(volumes, volumes + channels);
+                    mChannelVolumesSet = std::any_of(mChannelVolumes.cbegin(), mChannelVolumes.cend(),
+                        [](float v) noexcept { return v != 1.f; });
+                    return Status::Ok;
+                }
+
+                void GetChannelVolumes(uint32_t channels, float* volumes) const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    for (uint32_t j = 0; j < channels; ++j)
+                    {
+                        volumes[j] = (j < mChannelVolumes.size()) ? mChannelVolumes[j] : 1.f;
+                    }
+                }
+
+                Status SetOutputMatrix(Voice* destination, uint32_t sourceChannels, uint32_t destinationChannels,
+                    const float* matrix) override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    auto send = FindSend(destination);
+                    if (!send || !matrix
+                        || sourceChannels != mChannels || destinationChannels != send->dest->mChannels)
+                        return Status::InvalidCall;
+
+                    send->matrix.assign(matrix, matrix + size_t(sourceChannels) * destinationChannels);
+                    return Status::Ok;
+                }
+
+                void GetOutputMatrix(Voice* destination, uint32_t sourceChannels, uint32_t destinationChannels,
+                    float* matrix) const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    const size_t count = size_t(sourceChannels) * destinationChannels;
+                    auto send = const_cast<NodeImpl*>(this)->FindSend(destination);
+                    if (send && send->matrix.size() == count)
+                    {
+                        memcpy(matrix, send->matrix.data(), count * sizeof(float));
+                    }
+                    else
+                    {
+                        memset(matrix, 0, count * sizeof(float));
+                    }
+                }
+
+                Status SetFilter(const FilterParameters& parameters) override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    if (!(mFlags & VOICE_USEFILTER))
+                        return Status::InvalidCall;
+
+                    mFilterParams = parameters;
+                    mFilter.SetParameters(static_cast<SoftwareMixer::FilterType>(parameters.type),
+                        parameters.frequency, parameters.oneOverQ);
+                    return Status::Ok;
+                }
+
+                FilterParameters GetFilter() const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+                    return mFilterParams;
+                }
+
+                Status SetOutputFilter(Voice* destination, const FilterParameters& parameters) override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    auto send = FindSend(destination);
+                    if (!send || !send->useFilter)
+                        return Status::InvalidCall;
+
+                    send->filterParams = parameters;
+                    send->filter.SetParameters(static_cast<SoftwareMixer::FilterType>(parameters.type),
+                        parameters.frequency, parameters.oneOverQ);
+                    return Status::Ok;
+                }
+
+                FilterParameters GetOutputFilter(Voice* destination) const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    auto send = const_cast<NodeImpl*>(this)->FindSend(destination);
+                    return (send) ? send->filterParams : c_defaultFilter;
+                }
+
+                void Destroy() noexcept override
+                {
+                    mEngine->DestroyNode(this);
+                }
+            };
+
+            using MixNode = NodeImpl<Voice>;
+
+            //----------------------------------------------------------------------------
+            class SourceNode final : public NodeImpl<SourceVoice>
+            {
+            public:
+                SourceNode(_In_ SoftwareBackend* engine, const Format& format, uint32_t flags, float maxFrequencyRatio,
+                    _In_opt_ VoiceCallback* callback) :
+                    NodeImpl(engine, format.channels, format.sampleRate, flags, 0),
+                    mType(SoftwareMixer::SampleType::PCM16),
+                    mADPCM(format.type == SampleFormat::ADPCM),
+                    mBlockAlign(format.blockAlign),
+                    mSamplesPerBlock(mADPCM ? format.samplesPerBlock : 1),
+                    mCallback(callback),
+                    mFrequencyRatio(1.f),
+                    mMaxFrequencyRatio(maxFrequencyRatio),
+                    mStarted(false),
+                    mSamplesPlayed(0),
+                    mCachedBlock(nullptr)
+                {
+                    if (mADPCM)
+                    {
+                        mCoefficients.assign(format.coefficients, format.coefficients + format.coefficientCount);
+                        mBlockCache.resize(size_t(mSamplesPerBlock) * mChannels);
+                    }
+                    else
+                    {
+                        mType = static_cast<SoftwareMixer::SampleType>(format.type);
+                    }
+
+                    mResampler.Reset(mChannels);
+                }
+
+                void Start() override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+                    mStarted = true;
+                }
+
+                void Stop() override
+                {
+                    // There are no effects to play tails through, so this stops immediately
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+                    mStarted = false;
+                }
+
+                Status Submit(const Buffer& buffer) override
+                {
+                    if (!buffer.data || !buffer.bytes)
+                        return Status::InvalidCall;
+
+                    const uint32_t blocks = buffer.bytes / mBlockAlign;
+                    const uint32_t totalFrames = blocks * mSamplesPerBlock;
+
+                    QueuedBuffer queued = {};
+                    queued.data = buffer.data;
+                    queued.context = buffer.context;
+                    queued.endOfStream = buffer.endOfStream;
+                    queued.position = buffer.playBegin;
+                    queued.playEnd = (buffer.playLength > 0) ? buffer.playBegin + buffer.playLength : totalFrames;
+
+                    if (queued.playEnd > totalFrames || queued.position >= queued.playEnd)
+                        return Status::InvalidCall;
+
+                    if (buffer.loopCount > 0)
+                    {
+                        queued.loopBegin = buffer.loopBegin;
+                        queued.loopEnd = (buffer.loopLength > 0) ? buffer.loopBegin + buffer.loopLength : queued.playEnd;
+                        queued.loopsLeft = buffer.loopCount;
+
+                        if (queued.loopBegin >= queued.loopEnd || queued.loopEnd > queued.playEnd || queued.position >= queued.loopEnd)
+                            return Status::InvalidCall;
+                    }
+
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    if (mBuffers.size() >= MAX_QUEUED_BUFFERS)
+                        return Status::InvalidCall;
+
+                    mBuffers.push_back(queued);
+                    return Status::Ok;
+                }
+
+                void Flush() override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    const size_t keep = (mStarted && !mBuffers.empty()) ? 1u : 0u;
+                    while (mBuffers.size() > keep)
+                    {
+                        mFlushed.push_back(mBuffers.back().context);
+                        mBuffers.pop_back();
+                    }
+
+                    if (!keep)
+                    {
+                        mResampler.Reset(mChannels);
+                    }
+                }
+
+                void Discontinuity() override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    if (!mBuffers.empty())
+                    {
+                        mBuffers.back().endOfStream = true;
+                    }
+                }
+
+                void ExitLoop() override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    if (!mBuffers.empty())
+                    {
+                        mBuffers.front().loopsLeft = 0;
+                    }
+                }
+
+                VoiceState GetState() const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    VoiceState state;
+                    state.currentContext = (mBuffers.empty()) ? nullptr : mBuffers.front().context;
+                    state.buffersQueued = static_cast<uint32_t>(mBuffers.size());
+                    state.samplesPlayed = mSamplesPlayed;
+                    return state;
+                }
+
+                Status SetFrequencyRatio(float ratio) override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    if (mFlags & VOICE_NOPITCH)
+                        return Status::InvalidCall;
+
+                    mFrequencyRatio = std::max(MIN_FREQ_RATIO, std::min(ratio, mMaxFrequencyRatio));
+                    return Status::Ok;
+                }
+
+                float GetFrequencyRatio() const override
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+                    return mFrequencyRatio;
+                }
+
+                Status SetSourceSampleRate(uint32_t sampleRate) override
+                {
+                    if (sampleRate < MIN_SAMPLE_RATE || sampleRate > MAX_SAMPLE_RATE)
+                        return Status::InvalidCall;
+
+                    std::lock_guard<std::recursive_mutex> lock(mEngine->mMutex);
+
+                    if (!mBuffers.empty())
+                        return Status::InvalidCall;
+
+                    mSampleRate = sampleRate;
+                    return Status::Ok;
+                }
+
+                bool IsActive() const noexcept { return !mBuffers.empty(); }
+
+                // Decodes, resamples and mixes one processing pass. Stops as soon as a callback destroys the voice.
+                void Process(size_t frames, uint32_t outputRate)
+                {
+                    DeliverFlushed();
+
+                    if (!mStarted || mDestroyed)
+                        return;
+
+                    const double step = double(mSampleRate) * double(mFrequencyRatio) / double(outputRate);
+
+                    const size_t required = mResampler.InputRequired(frames, step);
+
+                    if (mCallback)
+                    {
+                        const size_t bytes = (required + mSamplesPerBlock - 1) / mSamplesPerBlock * mBlockAlign;
+                        mCallback->OnPassStart(static_cast<uint32_t>(bytes));
+                        if (mDestroyed)
+                            return;
+                    }
+
+                    Read(mResampler.Append(required), required);
+                    if (mDestroyed)
+                        return;
+
+                    mOutput.resize(frames * mChannels);
+                    mResampler.Process(mOutput.data(), frames, step);
+
+                    Output(mOutput.data(), frames);
+
+                    if (mCallback)
+                    {
+                        mCallback->OnPassEnd();
+                    }
+                }
+
+            private:
+                struct QueuedBuffer
+                {
+                    const uint8_t*  data;
+                    void*           context;
+                    bool            endOfStream;
+                    uint32_t        position;
+                    uint32_t        playEnd;
+                    uint32_t        loopBegin;
+                    uint32_t        loopEnd;
+                    uint32_t        loopsLeft;
+                    bool            started;
+                };
+
+                // Reports OnBufferEnd for buffers removed by Flush
+                void DeliverFlushed()
+                {
+                    while (!mFlushed.empty() && !mDestroyed)
+                    {
+                        void* context = mFlushed.front();
+                        mFlushed.pop_front();
+
+                        if (mCallback)
+                        {
+                            mCallback->OnBufferEnd(context);
+                        }
+                    }
+                }
+
+                // Decodes frames from the buffer queue, handling loops and buffer callbacks; pads with silence when starved
+                void Read(_Out_writes_(frames * mChannels) float* dest, size_t frames)
+                {
+                    while (frames > 0)
+                    {
+                        if (mBuffers.empty() || mDestroyed)
+                        {
+                            memset(dest, 0, frames * mChannels * sizeof(float));
+                            return;
+                        }
+
+                        QueuedBuffer& buffer = mBuffers.front();
+                        if (!buffer.started)
+                        {
+                            buffer.started = true;
+
+                            // A new buffer may reuse the address of an earlier one, so never trust a block decoded before it
+                            mCachedBlock = nullptr;
+
+                            if (mCallback)
+                            {
+                                // The callback may submit or flush, so re-examine the queue afterwards
+                                mCallback->OnBufferStart(buffer.context);
+                                continue;
+                            }
+                        }
+
+                        const uint32_t end = (buffer.loopsLeft > 0) ? buffer.loopEnd : buffer.playEnd;
+                        const auto count = static_cast<uint32_t>(std::min<size_t>(frames, end - buffer.position));
+
+                        Decode(buffer.data, buffer.position, count, dest);
+
+                        buffer.position += count;
+                        dest += size_t(count) * mChannels;
+                        frames -= count;
+                        mSamplesPlayed += count;
+
+                        if (buffer.position < end)
+                            continue;
+
+                        void* context = buffer.context;
+                        if (buffer.loopsLeft > 0)
+                        {
+                            buffer.position = buffer.loopBegin;
+                            if (buffer.loopsLeft != LOOP_INFINITE)
+                            {
+                                --buffer.loopsLeft;
+                            }
+
+                            if (mCallback)
+                            {
+                                mCallback->OnLoopEnd(context);
+                            }
+                        }
+                        else
+                        {
+                            const bool endOfStream = buffer.endOfStream;
+                            mBuffers.pop_front();
+
+                            if (mCallback)
+                            {
+                                mCallback->OnBufferEnd(context);
+                                if (endOfStream && !mDestroyed)
+                                {
+                                    mCallback->OnStreamEnd();
+                                }
+                            }
+                        }
+                    }
+                }
+
+                void Decode(_In_ const uint8_t* data, uint32_t position, uint32_t frames, _Out_writes_(frames * mChannels) float* dest)
+                {
+                    if (!mADPCM)
+                    {
+                        SoftwareMixer::ConvertToFloat(mType, data + size_t(position) * mBlockAlign, size_t(frames) * mChannels, dest);
+                        return;
+                    }
+
+                    while (frames > 0)
+                    {
+                        const uint32_t offset = position % mSamplesPerBlock;
+                        const uint8_t* block = data + size_t(position / mSamplesPerBlock) * mBlockAlign;
+
+                        if (block != mCachedBlock)
+                        {
+                            mCachedBlock = block;
+                            if (!ADPCMDecoder::DecodeBlock(block, mBlockAlign, mChannels, mSamplesPerBlock,
+                                mCoefficients.data(), mCoefficients.size(), mBlockCache.data()))
+                            {
+                                std::fill(mBlockCache.begin(), mBlockCache.end(), 0.f);
+                            }
+                        }
+
+                        const uint32_t count = std::min(frames, mSamplesPerBlock - offset);
+                        memcpy(dest, mBlockCache.data() + size_t(offset) * mChannels, size_t(count) * mChannels * sizeof(float));
+
+                        position += count;
+                        frames -= count;
+                        dest += size_t(count) * mChannels;
+                    }
+                }
+
+                SoftwareMixer::SampleType               mType;
+                bool                                    mADPCM;
+                uint32_t                                mBlockAlign;
+                uint32_t                                mSamplesPerBlock;
+                std::vector<ADPCMDecoder::Coefficients> mCoefficients;
+                VoiceCallback*                          mCallback;
+                float                                   mFrequencyRatio;
+                float                                   mMaxFrequencyRatio;
+                bool                                    mStarted;
+                uint64_t                                mSamplesPlayed;
+                std::deque<QueuedBuffer>                mBuffers;
+                std::deque<void*>                       mFlushed;
+                SoftwareMixer::Resampler                mResampler;
+                std::vector<float>                      mOutput;
+                std::vector<float>                      mBlockCache;
+                const uint8_t*                          mCachedBlock;
+            };
+
+            //----------------------------------------------------------------------------
+            static bool IsValid(const Format& format) noexcept
+            {
+                if (!format.channels || format.channels > MAX_AUDIO_CHANNELS
+                    || format.sampleRate < MIN_SAMPLE_RATE || format.sampleRate > MAX_SAMPLE_RATE)
+                    return false;
+
+                uint32_t bytesPerSample = 0;
+                switch (format.type)
+                {
+                case SampleFormat::PCM8:    bytesPerSample = 1; break;
+                case SampleFormat::PCM16:   bytesPerSample = 2; break;
+                case SampleFormat::PCM24:   bytesPerSample = 3; break;
+                case SampleFormat::PCM32:
+                case SampleFormat::Float32: bytesPerSample = 4; break;
+
+                case SampleFormat::ADPCM:
+                    // Each block starts with a 7 byte header per channel holding the first two samples
+                    return format.blockAlign >= 7 * format.channels && format.samplesPerBlock >= 2;
+
+                default:
+                    return false;
+                }
+
+                return format.blockAlign == bytesPerSample * format.channels;
+            }
+
+            // Destroyed voices stop mixing at once, but stay allocated until the current pass is over
+            void DestroyNode(_In_ NodeState* node) noexcept
+            {
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                if (node->mDestroyed)
+                    return;
+
+                node->mDestroyed = true;
+
+                for (auto& it : mSources)
+                    it->RemoveSendsTo(node);
+
+                for (auto& it : mSubmixes)
+                    it->RemoveSendsTo(node);
+
+                if (node == mMaster.get())
+                {
+                    mDestroyedMaster = std::move(mMaster);
+                }
+
+                if (!mRendering)
+                {
+                    Compact();
+                }
+            }
+
+            void Compact() noexcept
+            {
+                mSources.erase(std::remove_if(mSources.begin(), mSources.end(),
+                    [](const std::unique_ptr<SourceNode>& it) noexcept { return it->mDestroyed; }), mSources.end());
+
+                mSubmixes.erase(std::remove_if(mSubmixes.begin(), mSubmixes.end(),
+                    [](const std::unique_ptr<MixNode>& it) noexcept { return it->mDestroyed; }), mSubmixes.end());
+
+                mDestroyedMaster.reset();
+            }
+
+            mutable std::recursive_mutex                mMutex;
+            bool                                        mRunning;
+            bool                                        mRendering;
+            size_t                                      mPassFrames;
+            std::vector<EngineCallback*>                mCallbacks;
+            std::vector<EngineCallback*>                mCallbackScratch;
+            std::vector<std::unique_ptr<SourceNode>>    mSources;
+            std::vector<std::unique_ptr<MixNode>>       mSubmixes;
+            std::unique_ptr<MixNode>                    mMaster;
+            std::unique_ptr<MixNode>                    mDestroyedMaster;
+        };
+    }
+}
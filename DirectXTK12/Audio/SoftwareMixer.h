@@ -0,0 +1,335 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareMixer.h
+//
+// Portable mixing primitives for the software audio backend (AudioEngine_SoftwareMixer):
+// sample conversion, resampling, voice filters and output matrices. None of this depends
+// on XAudio2, so the signal path can be exercised without an audio device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace SoftwareMixer
+    {
+        enum class SampleType : uint32_t
+        {
+            PCM8,       // Unsigned
+            PCM16,
+            PCM24,      // Packed in 3 bytes
+            PCM32,
+            Float32,
+        };
+
+        // Converts interleaved samples to float in the range [-1,1]
+        inline void ConvertToFloat(SampleType type,
+            _In_ const uint8_t* source, size_t samples, _Out_writes_(samples) float* dest) noexcept
+        {
+            switch (type)
+            {
+            case SampleType::PCM8:
+                for (size_t j = 0; j < samples; ++j)
+                    dest[j] = float(int(source[j]) - 128) * (1.f / 128.f);
+                break;
+
+            case SampleType::PCM16:
+                for (size_t j = 0; j < samples; ++j)
+                {
+                    int16_t value;
+                    memcpy(&value, source + j * 2, sizeof(value));
+                    dest[j] = float(value) * (1.f / 32768.f);
+                }
+                break;
+
+            case SampleType::PCM24:
+                for (size_t j = 0; j < samples; ++j)
+                {
+                    const uint8_t* ptr = source + j * 3;
+                    const auto value = static_cast<int32_t>((uint32_t(ptr[0]) << 8) | (uint32_t(ptr[1]) << 16) | (uint32_t(ptr[2]) << 24));
+                    dest[j] = float(value >> 8) * (1.f / 8388608.f);
+                }
+                break;
+
+            case SampleType::PCM32:
+                for (size_t j = 0; j < samples; ++j)
+                {
+                    int32_t value;
+                    memcpy(&value, source + j * 4, sizeof(value));
+                    dest[j] = float(value) * (1.f / 2147483648.f);
+                }
+                break;
+
+            case SampleType::Float32:
+                memcpy(dest, source, samples * sizeof(float));
+                break;
+            }
+        }
+
+        // Linear-interpolating sample rate converter. Input frames are appended to an internal
+        // history, so the read position may span calls without discontinuities.
+        class Resampler
+        {
+        public:
+            Resampler() noexcept : mChannels(0), mFrames(0), mPhase(0.0) {}
+
+            void Reset(uint32_t channels)
+            {
+                mChannels = channels;
+                mFrames = 1;
+                mPhase = 0.0;
+                mHistory.assign(channels, 0.f);
+            }
+
+            // Number of new input frames needed to produce 'frames' output frames advancing 'step' input frames per output frame
+            size_t InputRequired(size_t frames, double step) const noexcept
+            {
+                if (!frames)
+                    return 0;
+
+                const double lastRead = std::floor(mPhase + double(frames - 1) * step) + 1.0;
+                const double advance = std::floor(mPhase + double(frames) * step);
+                const auto needed = static_cast<size_t>(((lastRead > advance) ? lastRead : advance)) + 1;
+                return (needed > mFrames) ? needed - mFrames : 0;
+            }
+
+            // Space for 'frames' new input frames
+            float* Append(size_t frames)
+            {
+                mHistory.resize((mFrames + frames) * mChannels);
+                float* ptr = mHistory.data() + mFrames * mChannels;
+                mFrames += frames;
+                return ptr;
+            }
+
+            void Process(_Out_writes_(frames * mChannels) float* output, size_t frames, double step) noexcept
+            {
+                const float* input = mHistory.data();
+
+                if (step == 1.0 && mPhase == 0.0)
+                {
+                    memcpy(output, input, frames * mChannels * sizeof(float));
+                }
+                else
+                {
+                    for (size_t j = 0; j < frames; ++j)
+                    {
+                        const double pos = mPhase + double(j) * step;
+                        const auto index = static_cast<size_t>(pos);
+                        const auto frac = static_cast<float>(pos - double(index));
+
+                        const float* a = input + index * mChannels;
+                        const float* b = a + mChannels;
+                        for (uint32_t ch = 0; ch < mChannels; ++ch)
+                        {
+                            *output++ = a[ch] + (b[ch] - a[ch]) * frac;
+                        }
+                    }
+                }
+
+                const double end = mPhase + double(frames) * step;
+                auto advance = static_cast<size_t>(end);
+                if (advance >= mFrames)
+                    advance = mFrames - 1;
+
+                mPhase = end - double(advance);
+                mFrames -= advance;
+                memmove(mHistory.data(), mHistory.data() + advance * mChannels, mFrames * mChannels * sizeof(float));
+            }
+
+        private:
+            std::vector<float>  mHistory;
+            uint32_t            mChannels;
+            size_t              mFrames;
+            double              mPhase;
+        };
+
+        // Matches XAUDIO2_FILTER_TYPE
+        enum class FilterType : uint32_t
+        {
+            LowPass,
+            BandPass,
+            HighPass,
+            Notch,
+            LowPassOnePole,
+            HighPassOnePole,
+        };
+
+        // State-variable filter with the XAudio2 coefficient conventions (frequency is 2*sin(pi*f/rate))
+        class Filter
+        {
+        public:
+            Filter() noexcept : mType(FilterType::LowPass), mFrequency(1.f), mOneOverQ(1.f) {}
+
+            void SetParameters(FilterType type, float frequency, float oneOverQ) noexcept
+            {
+                mType = type;
+                mFrequency = frequency;
+                mOneOverQ = oneOverQ;
+            }
+
+            void Apply(_Inout_updates_(frames * channels) float* samples, size_t frames, uint32_t channels)
+            {
+                if (mState.size() < size_t(channels) * 2)
+                    mState.resize(size_t(channels) * 2, 0.f);
+
+                if (mType == FilterType::LowPassOnePole || mType == FilterType::HighPassOnePole)
+                {
+                    const bool highPass = (mType == FilterType::HighPassOnePole);
+                    for (size_t j = 0; j < frames; ++j)
+                    {
+                        for (uint32_t ch = 0; ch < channels; ++ch)
+                        {
+                            float& low = mState[ch];
+                            float& x = samples[j * channels + ch];
+                            low += mFrequency * (x - low);
+                            x = highPass ? x - low : low;
+                        }
+                    }
+                    return;
+                }
+
+                for (size_t j = 0; j < frames; ++j)
+                {
+                    for (uint32_t ch = 0; ch < channels; ++ch)
+                    {
+                        float& low = mState[ch * 2];
+                        float& band = mState[ch * 2 + 1];
+                        float& x = samples[j * channels + ch];
+
+                        low += mFrequency * band;
+                        const float high = x - low - mOneOverQ * band;
+                        band += mFrequency * high;
+
+                        switch (mType)
+                        {
+                        case FilterType::LowPass:   x = low; break;
+                        case FilterType::BandPass:  x = band; break;
+                        case FilterType::HighPass:  x = high; break;
+                        default:                    x = low + high; break;
+                        }
+                    }
+                }
+            }
+
+            void Reset() noexcept
+            {
+                std::fill(mState.begin(), mState.end(), 0.f);
+            }
+
+        private:
+            std::vector<float>  mState;
+            FilterType          mType;
+            float               mFrequency;
+            float               mOneOverQ;
+        };
+
+        // Fills the matrix used for a send before SetOutputMatrix is called, laid out as
+        // matrix[dest * sourceChannels + source] like XAudio2
+        inline void DefaultMatrix(uint32_t sourceChannels, uint32_t destChannels,
+            _Out_writes_(sourceChannels * destChannels) float* matrix) noexcept
+        {
+            memset(matrix, 0, sizeof(float) * sourceChannels * destChannels);
+
+            if (sourceChannels == 1 && destChannels >= 2)
+            {
+                matrix[0] = matrix[1] = 0.707107f;
+            }
+            else if (sourceChannels == 2 && destChannels == 1)
+            {
+                matrix[0] = matrix[1] = 0.5f;
+            }
+            else
+            {
+                const uint32_t count = (sourceChannels < destChannels) ? sourceChannels : destChannels;
+                for (uint32_t ch = 0; ch < count; ++ch)
+                {
+                    matrix[ch * sourceChannels + ch] = 1.f;
+                }
+            }
+        }
+
+        // Accumulates source frames into dest through the level matrix
+        inline void MixMatrix(
+            _In_reads_(frames * sourceChannels) const float* source, size_t frames, uint32_t sourceChannels,
+            _In_reads_(sourceChannels * destChannels) const float* matrix,
+            _Inout_updates_(frames * destChannels) float* dest, uint32_t destChannels) noexcept
+        {
+            if (sourceChannels == 1 && destChannels == 2)
+            {
+                const float l = matrix[0];
+                const float r = matrix[1];
+                for (size_t j = 0; j < frames; ++j, dest += 2)
+                {
+                    dest[0] += source[j] * l;
+                    dest[1] += source[j] * r;
+                }
+                return;
+            }
+
+            if (sourceChannels == 2 && destChannels == 2)
+            {
+                const float ll = matrix[0];
+                const float rl = matrix[1];
+                const float lr = matrix[2];
+                const float rr = matrix[3];
+                for (size_t j = 0; j < frames; ++j, source += 2, dest += 2)
+                {
+                    dest[0] += source[0] * ll + source[1] * rl;
+                    dest[1] += source[0] * lr + source[1] * rr;
+                }
+                return;
+            }
+
+            for (size_t j = 0; j < frames; ++j, source += sourceChannels, dest += destChannels)
+            {
+                for (uint32_t d = 0; d < destChannels; ++d)
+                {
+                    const float* row = matrix + d * sourceChannels;
+                    float sum = 0.f;
+                    for (uint32_t s = 0; s < sourceChannels; ++s)
+                    {
+                        sum += source[s] * row[s];
+                    }
+                    dest[d] += sum;
+                }
+            }
+        }
+
+        // Scales frames by an overall volume and optional per-channel volumes
+        inline void ApplyVolume(_Inout_updates_(frames * channels) float* samples, size_t frames, uint32_t channels,
+            float volume, _In_reads_opt_(channels) const float* channelVolumes) noexcept
+        {
+            if (!channelVolumes)
+            {
+                if (volume != 1.f)
+                {
+                    for (size_t j = 0; j < frames * channels; ++j)
+                        samples[j] *= volume;
+                }
+                return;
+            }
+
+            for (size_t j = 0; j < frames; ++j, samples += channels)
+            {
+                for (uint32_t ch = 0; ch < channels; ++ch)
+                {
+                    samples[ch] *= volume * channelVolumes[ch];
+                }
+            }
+        }
+    }
+}
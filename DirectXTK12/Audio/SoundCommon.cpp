@@ -10,6 +10,7 @@
 
 #include "pch.h"
 #include "SoundCommon.h"
+#include "Spatializer.h"
 
 using namespace DirectX;
 
@@ -746,7 +747,8 @@ void SoundEffectInstanceBase::SetPan(float pan)
 
 void SoundEffectInstanceBase::Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAUDIO_EMITTER& emitter, bool rhcoords)
 {
-    if (!voice)
+    // Virtual instances still need their attenuation for voice scheduling.
+    if (!voice && !(IsVirtual() && engine && engine->IsAudioDevicePresent()))
         return;
 
     if (!(mFlags & SoundEffectInstance_Use3D))
@@ -800,30 +802,78 @@ void SoundEffectInstanceBase::Apply3D(const X3DAUDIO_LISTENER& listener, const X
 
     mDSPSettings.pMatrixCoefficients = nullptr;
 
-    std::ignore = voice->SetFrequencyRatio(mFreqRatio * mDSPSettings.DopplerFactor);
+    const DSPResults results = {
+        mDSPSettings.DopplerFactor, mDSPSettings.ReverbLevel,
+        mDSPSettings.LPFDirectCoefficient, mDSPSettings.LPFReverbCoefficient };
+    Apply3DResults(results, matrix);
+}
+
+
+_Use_decl_annotations_
+void SoundEffectInstanceBase::Apply3DResults(const DSPResults& results, const float* matrix)
+{
+    const size_t count = size_t(mDSPSettings.SrcChannelCount) * size_t(mDSPSettings.DstChannelCount);
+
+    float gain = 0.f;
+    for (size_t j = 0; j < count; ++j)
+    {
+        gain = std::max(gain, fabsf(matrix[j]));
+    }
+    m3DGain = gain;
+    mLast3D = results;
+
+    if (voice)
+    {
+        mLast3DMatrix.clear();
+        ApplyToVoice(results, matrix);
+    }
+    else
+    {
+        mLast3DMatrix.assign(matrix, matrix + count);
+    }
+}
+
+
+void SoundEffectInstanceBase::ApplyLast3D() noexcept
+{
+    if (voice && !mLast3DMatrix.empty())
+    {
+        ApplyToVoice(mLast3D, mLast3DMatrix.data());
+    }
+}
+
+
+_Use_decl_annotations_
+void SoundEffectInstanceBase::ApplyToVoice(const DSPResults& results, const float* matrix) noexcept
+{
+    assert(voice != nullptr);
+
+    std::ignore = voice->SetFrequencyRatio(mFreqRatio * results.dopplerFactor);
 
     auto direct = mDirectVoice;
     assert(direct != nullptr);
     std::ignore = voice->SetOutputMatrix(direct, mDSPSettings.SrcChannelCount, mDSPSettings.DstChannelCount, matrix);
 
+    auto reverb = mReverbVoice;
     if (reverb)
     {
+        float levels[XAUDIO2_MAX_AUDIO_CHANNELS];
         for (size_t j = 0; (j < mDSPSettings.SrcChannelCount) && (j < XAUDIO2_MAX_AUDIO_CHANNELS); ++j)
         {
-            matrix[j] = mDSPSettings.ReverbLevel;
+            levels[j] = results.reverbLevel;
         }
-        std::ignore = voice->SetOutputMatrix(reverb, mDSPSettings.SrcChannelCount, 1, matrix);
+        std::ignore = voice->SetOutputMatrix(reverb, mDSPSettings.SrcChannelCount, 1, levels);
     }
 
     if (mFlags & SoundEffectInstance_ReverbUseFilters)
     {
-        XAUDIO2_FILTER_PARAMETERS filterDirect = { LowPassFilter, 2.0f * sinf(X3DAUDIO_PI / 6.0f * mDSPSettings.LPFDirectCoefficient), 1.0f };
+        XAUDIO2_FILTER_PARAMETERS filterDirect = { LowPassFilter, 2.0f * sinf(X3DAUDIO_PI / 6.0f * results.lpfDirect), 1.0f };
         // see XAudio2CutoffFrequencyToRadians() in XAudio2.h for more information on the formula used here
         std::ignore = voice->SetOutputFilterParameters(direct, &filterDirect);
 
         if (reverb)
         {
-            XAUDIO2_FILTER_PARAMETERS filterReverb = { LowPassFilter, 2.0f * sinf(X3DAUDIO_PI / 6.0f * mDSPSettings.LPFReverbCoefficient), 1.0f };
+            XAUDIO2_FILTER_PARAMETERS filterReverb = { LowPassFilter, 2.0f * sinf(X3DAUDIO_PI / 6.0f * results.lpfReverb), 1.0f };
             // see XAudio2CutoffFrequencyToRadians() in XAudio2.h for more information on the formula used here
             std::ignore = voice->SetOutputFilterParameters(reverb, &filterReverb);
         }
@@ -831,6 +881,130 @@ void SoundEffectInstanceBase::Apply3D(const X3DAUDIO_LISTENER& listener, const X
 }
 
 
+namespace
+{
+    static_assert(sizeof(Spatializer::CurvePoint) == sizeof(X3DAUDIO_DISTANCE_CURVE_POINT), "Spatializer curve point mismatch");
+    static_assert(sizeof(Spatializer::Curve) == sizeof(X3DAUDIO_DISTANCE_CURVE), "Spatializer curve mismatch");
+    static_assert(sizeof(Spatializer::Cone) == sizeof(X3DAUDIO_CONE), "Spatializer cone mismatch");
+
+    inline XMFLOAT3 ToLeftHanded(const X3DAUDIO_VECTOR& v, bool rhcoords) noexcept
+    {
+        return XMFLOAT3(v.x, v.y, rhcoords ? -v.z : v.z);
+    }
+
+    Spatializer::Emitter ToSpatializer(const X3DAUDIO_EMITTER& emitter, bool rhcoords) noexcept
+    {
+        Spatializer::Emitter result;
+        result.front = ToLeftHanded(emitter.OrientFront, rhcoords);
+        result.position = ToLeftHanded(emitter.Position, rhcoords);
+        result.velocity = ToLeftHanded(emitter.Velocity, rhcoords);
+        result.cone = reinterpret_cast<const Spatializer::Cone*>(emitter.pCone);
+        result.innerRadius = emitter.InnerRadius;
+        result.curveDistanceScaler = emitter.CurveDistanceScaler;
+        result.dopplerScaler = emitter.DopplerScaler;
+        result.volumeCurve = reinterpret_cast<const Spatializer::Curve*>(emitter.pVolumeCurve);
+        result.lfeCurve = reinterpret_cast<const Spatializer::Curve*>(emitter.pLFECurve);
+        result.lpfDirectCurve = reinterpret_cast<const Spatializer::Curve*>(emitter.pLPFDirectCurve);
+        result.lpfReverbCurve = reinterpret_cast<const Spatializer::Curve*>(emitter.pLPFReverbCurve);
+        result.reverbCurve = reinterpret_cast<const Spatializer::Curve*>(emitter.pReverbCurve);
+        return result;
+    }
+}
+
+_Use_decl_annotations_
+void SoundEffectInstanceBase::Apply3D(
+    const X3DAUDIO_LISTENER& listener,
+    SoundEffectInstanceBase* const* instances,
+    const X3DAUDIO_EMITTER* const* emitters,
+    size_t count,
+    bool rhcoords)
+{
+    if (!count)
+        return;
+
+    if (!instances || !emitters)
+        throw std::invalid_argument("Apply3D");
+
+    // Mono emitters on mono sources are computed together; anything else goes through X3DAudioCalculate.
+    AudioEngine* engine = nullptr;
+    Spatializer::Speakers speakers = {};
+    bool batched = false;
+
+    std::vector<SoundEffectInstanceBase*> batchInstances;
+    std::vector<Spatializer::Emitter> batchEmitters;
+    batchInstances.reserve(count);
+    batchEmitters.reserve(count);
+
+    for (size_t j = 0; j < count; ++j)
+    {
+        auto instance = instances[j];
+        auto emitter = emitters[j];
+        if (!instance || !emitter)
+            throw std::invalid_argument("Apply3D");
+
+        if (!instance->voice && !instance->IsVirtual())
+            continue;
+
+        if (!(instance->mFlags & SoundEffectInstance_Use3D))
+        {
+            DebugTrace("ERROR: Apply3D called for an instance created without SoundEffectInstance_Use3D set\n");
+            throw std::runtime_error("Apply3D");
+        }
+
+        if (!instance->voice && !(instance->engine && instance->engine->IsAudioDevicePresent()))
+            continue;
+
+        if (!engine)
+        {
+            engine = instance->engine;
+            assert(engine != nullptr);
+            batched = Spatializer::InitializeSpeakers(engine->GetChannelMask(), engine->GetOutputChannels(), speakers);
+        }
+
+        if (!batched
+            || instance->engine != engine
+            || emitter->ChannelCount != 1
+            || instance->mDSPSettings.SrcChannelCount != 1
+            || instance->mDSPSettings.DstChannelCount != speakers.channels)
+        {
+            instance->Apply3D(listener, *emitter, rhcoords);
+            continue;
+        }
+
+        batchInstances.push_back(instance);
+        batchEmitters.push_back(ToSpatializer(*emitter, rhcoords));
+    }
+
+    if (batchInstances.empty())
+        return;
+
+    Spatializer::Listener lhListener;
+    lhListener.front = ToLeftHanded(listener.OrientFront, rhcoords);
+    lhListener.top = ToLeftHanded(listener.OrientTop, rhcoords);
+    lhListener.position = ToLeftHanded(listener.Position, rhcoords);
+    lhListener.velocity = ToLeftHanded(listener.Velocity, rhcoords);
+    lhListener.cone = reinterpret_cast<const Spatializer::Cone*>(listener.pCone);
+
+    std::vector<Spatializer::Result> results(batchInstances.size());
+    Spatializer::Calculate(lhListener, speakers, batchEmitters.data(), batchEmitters.size(),
+        X3DAUDIO_SPEED_OF_SOUND, true, results.data());
+
+    for (size_t j = 0; j < batchInstances.size(); ++j)
+    {
+        auto instance = batchInstances[j];
+        auto& result = results[j];
+
+        if (!(instance->mFlags & SoundEffectInstance_UseRedirectLFE) && speakers.lfe != Spatializer::c_noChannel)
+        {
+            result.matrix[speakers.lfe] = 0.f;
+        }
+
+        const DSPResults dsp = { result.dopplerFactor, result.reverbLevel, result.lpfDirect, result.lpfReverb };
+        instance->Apply3DResults(dsp, result.matrix);
+    }
+}
+
+
 //======================================================================================
 // AudioListener/Emitter helpers
 //======================================================================================
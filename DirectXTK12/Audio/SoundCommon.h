@@ -81,6 +81,57 @@ namespace DirectX
     // Helper for computing pan volume matrix
     bool ComputePan(float pan, unsigned int channels, _Out_writes_(16) float* matrix) noexcept;
 
+    // Software mixer used in place of XAudio2 for AudioEngine_SoftwareMixer
+    HRESULT CreateSoftwareAudio(_COM_Outptr_ IXAudio2** xaudio2) noexcept;
+    void RenderSoftwareAudio(_In_ IXAudio2* xaudio2, _Out_writes_opt_(_Inexpressible_("frames * channels")) float* output, size_t frames);
+
+    // Interface for instances that can give up their voice while playing (SoundEffectInstance_Virtualize)
+    class IVirtualVoice
+    {
+    public:
+        virtual ~IVirtualVoice() = default;
+
+        IVirtualVoice(const IVirtualVoice&) = delete;
+        IVirtualVoice& operator=(const IVirtualVoice&) = delete;
+
+        IVirtualVoice(IVirtualVoice&&) = default;
+        IVirtualVoice& operator=(IVirtualVoice&&) = default;
+
+        virtual bool __cdecl IsPlaying() noexcept = 0;
+        virtual bool __cdecl IsReal() const noexcept = 0;
+        virtual int __cdecl GetPriority() const noexcept = 0;
+        virtual float __cdecl GetAudibility() const noexcept = 0;
+
+        virtual void __cdecl Advance(double seconds) noexcept = 0;
+            // Moves the playback position of a virtual instance forward
+
+        virtual bool __cdecl Promote() noexcept = 0;
+        virtual void __cdecl Demote() noexcept = 0;
+            // Acquire a voice and resume at the tracked position, or record the position and release the voice
+
+    protected:
+        IVirtualVoice() = default;
+    };
+
+    // Interface for streams whose packet reads are ordered by the engine (see AudioEngine::SetStreamingParameters)
+    class IStreamReader
+    {
+    public:
+        virtual ~IStreamReader() = default;
+
+        IStreamReader(const IStreamReader&) = delete;
+        IStreamReader& operator=(const IStreamReader&) = delete;
+
+        IStreamReader(IStreamReader&&) = default;
+        IStreamReader& operator=(IStreamReader&&) = default;
+
+        virtual bool __cdecl IssueRead(uint32_t packet) noexcept = 0;
+            // Starts the asynchronous read of a packet passed to QueueStreamRead; returns false if it failed to start
+
+    protected:
+        IStreamReader() = default;
+    };
+
     // Helper class for implementing SoundEffectInstance
     class SoundEffectInstanceBase
     {
@@ -93,10 +144,12 @@ namespace DirectX
             mPitch(0.f),
             mFreqRatio(1.f),
             mPan(0.f),
+            m3DGain(1.f),
             mFlags(SoundEffectInstance_Default),
             mDirectVoice(nullptr),
             mReverbVoice(nullptr),
-            mDSPSettings{}
+            mDSPSettings{},
+            mLast3D{ 1.f, 0.f, 1.f, 1.f }
         {
         }
 
@@ -148,6 +201,16 @@ namespace DirectX
             }
         }
 
+        void ReleaseVoice() noexcept
+        {
+            if (voice)
+            {
+                std::ignore = voice->Stop(0);
+                std::ignore = voice->FlushSourceBuffers();
+                DestroyVoice();
+            }
+        }
+
         bool Play() // Returns true if STOPPED -> PLAYING
         {
             if (voice)
@@ -221,6 +284,10 @@ namespace DirectX
 
                 std::ignore = voice->Stop(0);
             }
+            else if (IsVirtual())
+            {
+                state = PAUSED;
+            }
         }
 
         void Resume()
@@ -231,6 +298,10 @@ namespace DirectX
                 ThrowIfFailed(hr);
                 state = PLAYING;
             }
+            else if (IsVirtual())
+            {
+                state = PLAYING;
+            }
         }
 
         void SetVolume(float volume)
@@ -271,6 +342,11 @@ namespace DirectX
 
         void Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAUDIO_EMITTER& emitter, bool rhcoords);
 
+        static void Apply3D(const X3DAUDIO_LISTENER& listener,
+            _In_reads_(count) SoundEffectInstanceBase* const* instances,
+            _In_reads_(count) const X3DAUDIO_EMITTER* const* emitters,
+            size_t count, bool rhcoords);
+
         SoundState GetState(bool autostop) noexcept
         {
             if (autostop && voice && (state == PLAYING))
@@ -304,6 +380,23 @@ namespace DirectX
             return mDSPSettings.SrcChannelCount;
         }
 
+        bool IsVirtual() const noexcept
+        {
+            return !voice && (state != STOPPED) && (mFlags & SoundEffectInstance_Virtualize);
+        }
+
+        float GetAudibility() const noexcept
+        {
+            return m3DGain * fabsf(mVolume);
+        }
+
+        float GetFrequencyRatio() const noexcept
+        {
+            return mFreqRatio * ((mFlags & SoundEffectInstance_Use3D) ? mLast3D.dopplerFactor : 1.f);
+        }
+
+        void ApplyLast3D() noexcept;
+
         void OnCriticalError() noexcept
         {
             if (voice)
@@ -367,6 +460,11 @@ namespace DirectX
                 if (state == PLAYING)
                     ++stats.playingInstances;
             }
+            else if (IsVirtual() && state == PLAYING)
+            {
+                ++stats.playingInstances;
+                ++stats.virtualInstances;
+            }
         }
 
         IXAudio2SourceVoice*        voice;
@@ -374,14 +472,30 @@ namespace DirectX
         AudioEngine*                engine;
 
     private:
+        struct DSPResults
+        {
+            float dopplerFactor;
+            float reverbLevel;
+            float lpfDirect;
+            float lpfReverb;
+        };
+
+        void Apply3DResults(const DSPResults& results, _In_reads_(mDSPSettings.SrcChannelCount * mDSPSettings.DstChannelCount) const float* matrix);
+        void ApplyToVoice(const DSPResults& results, _In_reads_(mDSPSettings.SrcChannelCount * mDSPSettings.DstChannelCount) const float* matrix) noexcept;
+
         float                       mVolume;
         float                       mPitch;
         float                       mFreqRatio;
         float                       mPan;
+        float                       m3DGain;
         SOUND_EFFECT_INSTANCE_FLAGS mFlags;
         IXAudio2Voice*              mDirectVoice;
         IXAudio2Voice*              mReverbVoice;
         X3DAUDIO_DSP_SETTINGS       mDSPSettings;
+
+        // Last 3D results, kept while virtual so a promoted voice starts with the right matrix
+        DSPResults                  mLast3D;
+        std::vector<float>          mLast3DMatrix;
     };
 
     struct WaveBankSeekData
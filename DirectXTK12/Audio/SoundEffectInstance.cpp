@@ -19,7 +19,7 @@ using namespace DirectX;
 //======================================================================================
 
 // Internal object implementation class.
-class SoundEffectInstance::Impl : public IVoiceNotify
+class SoundEffectInstance::Impl : public IVoiceNotify, public IVirtualVoice
 {
 public:
     Impl(_In_ AudioEngine* engine, _In_ SoundEffect* effect, SOUND_EFFECT_INSTANCE_FLAGS flags) :
@@ -27,13 +27,25 @@ public:
         mEffect(effect),
         mWaveBank(nullptr),
         mIndex(0),
-        mLooped(false)
+        mLooped(false),
+        mVirtualize(false),
+        mFresh(false),
+        mPriority(0),
+        mSampleRate(0),
+        mAlignment(1),
+        mTotalSamples(0),
+        mLoopBegin(0),
+        mLoopEnd(0),
+        mStartPosition(0),
+        mSamplesBaseline(0),
+        mPosition(0.0)
     {
         assert(engine != nullptr);
         engine->RegisterNotify(this, false);
 
         assert(mEffect != nullptr);
-        mBase.Initialize(engine, effect->GetFormat(), flags);
+        const WAVEFORMATEX* wfx = effect->GetFormat();
+        mBase.Initialize(engine, wfx, InitializeVirtual(engine, wfx, flags));
     }
 
     Impl(_In_ AudioEngine* engine, _In_ WaveBank* waveBank, uint32_t index, SOUND_EFFECT_INSTANCE_FLAGS flags) :
@@ -41,7 +53,18 @@ public:
         mEffect(nullptr),
         mWaveBank(waveBank),
         mIndex(index),
-        mLooped(false)
+        mLooped(false),
+        mVirtualize(false),
+        mFresh(false),
+        mPriority(0),
+        mSampleRate(0),
+        mAlignment(1),
+        mTotalSamples(0),
+        mLoopBegin(0),
+        mLoopEnd(0),
+        mStartPosition(0),
+        mSamplesBaseline(0),
+        mPosition(0.0)
     {
         assert(engine != nullptr);
         engine->RegisterNotify(this, false);
@@ -49,7 +72,8 @@ public:
         char buff[64] = {};
         auto wfx = reinterpret_cast<WAVEFORMATEX*>(buff);
         assert(mWaveBank != nullptr);
-        mBase.Initialize(engine, mWaveBank->GetFormat(index, wfx, sizeof(buff)), flags);
+        mWaveBank->GetFormat(index, wfx, sizeof(buff));
+        mBase.Initialize(engine, wfx, InitializeVirtual(engine, wfx, flags));
     }
 
     Impl(Impl&&) = default;
@@ -64,6 +88,11 @@ public:
 
         if (mBase.engine)
         {
+            if (mVirtualize)
+            {
+                mBase.engine->UnregisterVirtualVoice(this);
+            }
+
             mBase.engine->UnregisterNotify(this, false, false);
             mBase.engine = nullptr;
         }
@@ -111,40 +140,204 @@ public:
 
     void __cdecl OnDestroyParent() noexcept override
     {
+        if (mVirtualize && mBase.engine)
+        {
+            mBase.engine->UnregisterVirtualVoice(this);
+            mVirtualize = false;
+        }
+
         mBase.OnDestroy();
         mWaveBank = nullptr;
         mEffect = nullptr;
     }
 
+    // IVirtualVoice
+    bool __cdecl IsPlaying() noexcept override
+    {
+        return mBase.GetState(true) == PLAYING;
+    }
+
+    bool __cdecl IsReal() const noexcept override
+    {
+        return mBase.voice != nullptr;
+    }
+
+    int __cdecl GetPriority() const noexcept override
+    {
+        return mPriority;
+    }
+
+    float __cdecl GetAudibility() const noexcept override
+    {
+        return mBase.GetAudibility();
+    }
+
+    void __cdecl Advance(double seconds) noexcept override;
+    bool __cdecl Promote() noexcept override;
+    void __cdecl Demote() noexcept override;
+
     SoundEffectInstanceBase         mBase;
     SoundEffect*                    mEffect;
     WaveBank*                       mWaveBank;
     uint32_t                        mIndex;
     bool                            mLooped;
+    bool                            mVirtualize;
+    bool                            mFresh;
+    int                             mPriority;
+
+private:
+    SOUND_EFFECT_INSTANCE_FLAGS InitializeVirtual(_In_ AudioEngine* engine, _In_ const WAVEFORMATEX* wfx, SOUND_EFFECT_INSTANCE_FLAGS flags);
+    void AllocateVoice();
+    void PlayVirtual(bool loop);
+    void SubmitBuffer(bool loop, uint32_t playBegin);
+    void WrapPosition() noexcept;
+
+    // Playback position tracking for SoundEffectInstance_Virtualize, in samples
+    uint32_t                        mSampleRate;
+    uint32_t                        mAlignment;
+    uint32_t                        mTotalSamples;
+    uint32_t                        mLoopBegin;
+    uint32_t                        mLoopEnd;
+    uint32_t                        mStartPosition;
+    uint64_t                        mSamplesBaseline;
+    double                          mPosition;
 };
 
 
+_Use_decl_annotations_
+SOUND_EFFECT_INSTANCE_FLAGS SoundEffectInstance::Impl::InitializeVirtual(AudioEngine* engine, const WAVEFORMATEX* wfx, SOUND_EFFECT_INSTANCE_FLAGS flags)
+{
+    if (!(flags & SoundEffectInstance_Virtualize))
+        return flags;
+
+    // Resuming a virtual instance needs a PlayBegin position, which XAudio2 constrains per format
+    switch (GetFormatTag(wfx))
+    {
+    case WAVE_FORMAT_PCM:
+    case WAVE_FORMAT_IEEE_FLOAT:
+        mAlignment = 1;
+        break;
+
+    case WAVE_FORMAT_ADPCM:
+        mAlignment = reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx)->wSamplesPerBlock;
+        break;
+
+    #ifdef DIRECTX_ENABLE_XMA2
+    case WAVE_FORMAT_XMA2:
+        mAlignment = XMA_SAMPLES_PER_SUBFRAME;
+        break;
+    #endif
+
+    default:
+        DebugTrace("WARNING: SoundEffectInstance_Virtualize is not supported for this format (%u); ignored\n", GetFormatTag(wfx));
+        return flags & ~SoundEffectInstance_Virtualize;
+    }
+
+    if (!mAlignment)
+        mAlignment = 1;
+
+    mSampleRate = wfx->nSamplesPerSec;
+    mVirtualize = true;
+    engine->RegisterVirtualVoice(this);
+
+    return flags;
+}
+
+
+void SoundEffectInstance::Impl::AllocateVoice()
+{
+    if (mBase.voice)
+        return;
+
+    if (mWaveBank)
+    {
+        char buff[64] = {};
+        auto wfx = reinterpret_cast<WAVEFORMATEX*>(buff);
+        mBase.AllocateVoice(mWaveBank->GetFormat(mIndex, wfx, sizeof(buff)));
+    }
+    else
+    {
+        assert(mEffect != nullptr);
+        mBase.AllocateVoice(mEffect->GetFormat());
+    }
+}
+
+
 void SoundEffectInstance::Impl::Play(bool loop)
 {
-    if (!mBase.voice)
+    if (mVirtualize)
     {
-        if (mWaveBank)
-        {
-            char buff[64] = {};
-            auto wfx = reinterpret_cast<WAVEFORMATEX*>(buff);
-            mBase.AllocateVoice(mWaveBank->GetFormat(mIndex, wfx, sizeof(buff)));
-        }
-        else
-        {
-            assert(mEffect != nullptr);
-            mBase.AllocateVoice(mEffect->GetFormat());
-        }
+        PlayVirtual(loop);
+        return;
     }
 
+    AllocateVoice();
+
     if (!mBase.Play())
         return;
 
     // Submit audio data for STOPPED -> PLAYING state transition
+    SubmitBuffer(loop, 0);
+}
+
+
+void SoundEffectInstance::Impl::PlayVirtual(bool loop)
+{
+    if (mBase.state == PAUSED)
+    {
+        mBase.Resume();
+        return;
+    }
+
+    if (mBase.state == PLAYING || !mBase.engine || !mBase.engine->IsAudioDevicePresent())
+        return;
+
+    // STOPPED -> PLAYING starts virtually; the next AudioEngine::Update gives it a voice if it ranks within the budget
+    mBase.ReleaseVoice();
+
+    mTotalSamples = static_cast<uint32_t>((mWaveBank) ? mWaveBank->GetSampleDuration(mIndex) : mEffect->GetSampleDuration());
+    if (!mTotalSamples)
+        return;
+
+    XAUDIO2_BUFFER buffer = {};
+#ifdef DIRECTX_ENABLE_XWMA
+    XAUDIO2_BUFFER_WMA wmaBuffer = {};
+    if (mWaveBank)
+    {
+        std::ignore = mWaveBank->FillSubmitBuffer(mIndex, buffer, wmaBuffer);
+    }
+    else
+    {
+        std::ignore = mEffect->FillSubmitBuffer(buffer, wmaBuffer);
+    }
+#else
+    if (mWaveBank)
+    {
+        mWaveBank->FillSubmitBuffer(mIndex, buffer);
+    }
+    else
+    {
+        mEffect->FillSubmitBuffer(buffer);
+    }
+#endif
+
+    mLoopBegin = buffer.LoopBegin;
+    mLoopEnd = (buffer.LoopLength > 0) ? buffer.LoopBegin + buffer.LoopLength : mTotalSamples;
+    if (mLoopEnd <= mLoopBegin || mLoopEnd > mTotalSamples)
+    {
+        mLoopBegin = 0;
+        mLoopEnd = mTotalSamples;
+    }
+
+    mLooped = loop;
+    mPosition = 0.0;
+    mFresh = true;
+    mBase.state = PLAYING;
+}
+
+
+void SoundEffectInstance::Impl::SubmitBuffer(bool loop, uint32_t playBegin)
+{
     XAUDIO2_BUFFER buffer = {};
 
 #ifdef DIRECTX_ENABLE_XWMA
@@ -176,6 +369,7 @@ void SoundEffectInstance::Impl::Play(bool loop)
 #endif
 
     buffer.Flags = XAUDIO2_END_OF_STREAM;
+    buffer.PlayBegin = playBegin;
     if (loop)
     {
         mLooped = true;
@@ -220,6 +414,97 @@ void SoundEffectInstance::Impl::Play(bool loop)
 }
 
 
+void SoundEffectInstance::Impl::WrapPosition() noexcept
+{
+    if (mLooped)
+    {
+        if (mPosition >= double(mLoopEnd))
+        {
+            mPosition = double(mLoopBegin) + fmod(mPosition - double(mLoopBegin), double(mLoopEnd - mLoopBegin));
+        }
+    }
+    else if (mPosition >= double(mTotalSamples))
+    {
+        mPosition = 0.0;
+        mBase.state = STOPPED;
+    }
+}
+
+
+void SoundEffectInstance::Impl::Advance(double seconds) noexcept
+{
+    if (!mBase.IsVirtual() || mBase.state != PLAYING)
+        return;
+
+    if (mFresh)
+    {
+        // Started since the last update, so it begins from the start of the sound
+        mFresh = false;
+        return;
+    }
+
+    mPosition += seconds * double(mSampleRate) * double(mBase.GetFrequencyRatio());
+    WrapPosition();
+}
+
+
+bool SoundEffectInstance::Impl::Promote() noexcept
+{
+    if (mBase.voice)
+        return true;
+
+    if (mBase.state != PLAYING)
+        return false;
+
+    mFresh = false;
+
+    try
+    {
+        AllocateVoice();
+        if (!mBase.voice)
+            return false;
+
+        XAUDIO2_VOICE_STATE xstate;
+        mBase.voice->GetState(&xstate, 0);
+        mSamplesBaseline = xstate.SamplesPlayed;
+
+        auto position = static_cast<uint32_t>(mPosition);
+        position -= position % mAlignment;
+        mStartPosition = position;
+
+        mBase.state = STOPPED;
+        std::ignore = mBase.Play();
+        mBase.ApplyLast3D();
+        SubmitBuffer(mLooped, position);
+        return true;
+    }
+    catch (...)
+    {
+        mBase.ReleaseVoice();
+        mBase.state = PLAYING;
+        return false;
+    }
+}
+
+
+void SoundEffectInstance::Impl::Demote() noexcept
+{
+    if (!mBase.voice)
+        return;
+
+    if (mBase.state == PLAYING)
+    {
+        XAUDIO2_VOICE_STATE xstate;
+        mBase.voice->GetState(&xstate, 0);
+
+        mPosition = double(mStartPosition) + double(xstate.SamplesPlayed - mSamplesBaseline);
+        WrapPosition();
+    }
+
+    mBase.ReleaseVoice();
+}
+
+
 //--------------------------------------------------------------------------------------
 // SoundEffectInstance
 //--------------------------------------------------------------------------------------
@@ -306,12 +591,45 @@ void SoundEffectInstance::SetPan(float pan)
 }
 
 
+void SoundEffectInstance::SetPriority(int priority) noexcept
+{
+    pImpl->mPriority = priority;
+}
+
+
 void SoundEffectInstance::Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAUDIO_EMITTER& emitter, bool rhcoords)
 {
     pImpl->mBase.Apply3D(listener, emitter, rhcoords);
 }
 
 
+_Use_decl_annotations_
+void SoundEffectInstance::Apply3D(
+    const X3DAUDIO_LISTENER& listener,
+    SoundEffectInstance* const* instances,
+    const X3DAUDIO_EMITTER* const* emitters,
+    size_t count,
+    bool rhcoords)
+{
+    if (!count)
+        return;
+
+    if (!instances)
+        throw std::invalid_argument("Apply3D");
+
+    std::vector<SoundEffectInstanceBase*> bases(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        if (!instances[j])
+            throw std::invalid_argument("Apply3D");
+
+        bases[j] = &instances[j]->pImpl->mBase;
+    }
+
+    SoundEffectInstanceBase::Apply3D(listener, bases.data(), emitters, count, rhcoords);
+}
+
+
 // Public accessors.
 bool SoundEffectInstance::IsLooped() const noexcept
 {
@@ -331,6 +649,12 @@ unsigned int SoundEffectInstance::GetChannelCount() const noexcept
 }
 
 
+bool SoundEffectInstance::IsVirtual() const noexcept
+{
+    return pImpl->mBase.IsVirtual();
+}
+
+
 IVoiceNotify* SoundEffectInstance::GetVoiceNotify() const noexcept
 {
     return pImpl.get();
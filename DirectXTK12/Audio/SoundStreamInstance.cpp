@@ -13,6 +13,7 @@
 #include "WaveBankReader.h"
 #include "PlatformHelpers.h"
 #include "SoundCommon.h"
+#include "StreamScheduler.h"
 
 #if (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
 #ifdef __clang__
@@ -41,7 +42,6 @@ namespace
 {
     constexpr size_t DVD_SECTOR_SIZE = 2048;
     constexpr size_t ADVANCED_FORMAT_SECTOR_SIZE = 4096;
-    constexpr size_t MAX_BUFFER_COUNT = 3;
 
 #ifdef DIRECTX_ENABLE_SEEK_TABLES
     constexpr size_t MAX_STREAMING_SEEK_PACKETS = 2048;
@@ -53,12 +53,12 @@ namespace
     struct apu_deleter { void operator()(void* p) noexcept { if (p) ApuFree(p); } };
 #endif
 
-    size_t ComputeAsyncPacketSize(_In_ const WAVEFORMATEX* wfx, uint32_t tag, uint32_t alignment)
+    size_t ComputeAsyncPacketSize(_In_ const WAVEFORMATEX* wfx, uint32_t tag, uint32_t alignment, size_t packetBytes)
     {
         if (!wfx)
             return 0;
 
-        size_t buffer = size_t(wfx->nAvgBytesPerSec) * 2u;
+        size_t buffer = (packetBytes > 0) ? packetBytes : size_t(wfx->nAvgBytesPerSec) * 2u;
 
     #ifdef DIRECTX_ENABLE_XMA2
         if (tag == WAVE_FORMAT_XMA2)
@@ -83,7 +83,7 @@ namespace
 //======================================================================================
 
 // Internal object implementation class.
-class SoundStreamInstance::Impl : public IVoiceNotify
+class SoundStreamInstance::Impl : public IVoiceNotify, public IStreamReader
 {
 public:
     Impl(_In_ AudioEngine* engine,
@@ -98,7 +98,8 @@ public:
         mEndStream(false),
         mPrefetch(false),
         mSitching(false),
-        mPackets{},
+        mStarved(false),
+        mBufferCount(0),
         mCurrentDiskReadBuffer(0),
         mCurrentPlayBuffer(0),
         mBlockAlign(0),
@@ -107,7 +108,11 @@ public:
         mOffsetBytes(0),
         mLengthInBytes(0),
         mPacketSize(0),
-        mTotalSize(0)
+        mTotalSize(0),
+        mBytesPerSecond(0),
+        mPendingReads(0),
+        mStarvations(0),
+        mReadResult(S_OK)
     #ifdef DIRECTX_ENABLE_SEEK_TABLES
         , mSeekCount(0),
         mSeekTable(nullptr),
@@ -146,10 +151,17 @@ public:
             throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
         }
 
-        ThrowIfFailed(AllocateStreamingBuffers(wfx));
+        size_t bufferCount = 0;
+        size_t packetBytes = 0;
+        engine->GetStreamingParameters(&bufferCount, &packetBytes);
+
+        mBufferCount = static_cast<uint32_t>(bufferCount);
+        mPackets = std::make_unique<Packets[]>(bufferCount);
+
+        ThrowIfFailed(AllocateStreamingBuffers(wfx, packetBytes));
 
     #ifdef VERBOSE_TRACE
-        DebugTrace("INFO (Streaming): packet size %zu, play length %zu\n", mPacketSize, mLengthInBytes);
+        DebugTrace("INFO (Streaming): %u packets of %zu bytes, play length %zu\n", mBufferCount, mPacketSize, mLengthInBytes);
     #endif
 
         mPrefetch = true;
@@ -160,9 +172,11 @@ public:
     {
         mBase.DestroyVoice();
 
+        CancelReads();
+
         if (mWaveBank && mWaveBank->GetAsyncHandle())
         {
-            for (size_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+            for (size_t j = 0; j < mBufferCount; ++j)
             {
                 std::ignore = CancelIoEx(mWaveBank->GetAsyncHandle(), &mPackets[j].request);
             }
@@ -174,7 +188,7 @@ public:
             mBase.engine = nullptr;
         }
 
-        for (size_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+        for (size_t j = 0; j < mBufferCount; ++j)
         {
             mPackets[j] = {};
         }
@@ -232,7 +246,14 @@ public:
     virtual void __cdecl OnUpdate() override
     {
         if (!mPlaying)
+        {
+            // Collect prefetch reads so they do not hold scheduler slots until Play
+            if (mPendingReads > 0)
+            {
+                ThrowIfFailed(PlayBuffers());
+            }
             return;
+        }
 
         HANDLE events[] = { mBufferRead.get(), mBufferEnd.get() };
         switch (WaitForMultipleObjectsEx(static_cast<DWORD>(std::size(events)), events, FALSE, 0, FALSE))
@@ -243,7 +264,7 @@ public:
         case WAIT_OBJECT_0: // Read completed
         #ifdef VERBOSE_TRACE
             DebugTrace("INFO (Streaming): Playing... (readpos %zu) [", mCurrentPosition);
-            for (uint32_t k = 0; k < MAX_BUFFER_COUNT; ++k)
+            for (uint32_t k = 0; k < mBufferCount; ++k)
             {
                 DebugTrace("%ls ", s_debugState[static_cast<int>(mPackets[k].state)]);
             }
@@ -256,13 +277,14 @@ public:
         case (WAIT_OBJECT_0 + 1): // Play completed
         #ifdef VERBOSE_TRACE
             DebugTrace("INFO (Streaming): Reading... (readpos %zu) [", mCurrentPosition);
-            for (uint32_t k = 0; k < MAX_BUFFER_COUNT; ++k)
+            for (uint32_t k = 0; k < mBufferCount; ++k)
             {
                 DebugTrace("%ls ", s_debugState[static_cast<int>(mPackets[k].state)]);
             }
             DebugTrace("]\n");
         #endif
             ThrowIfFailed(ReadBuffers());
+            CheckStarvation();
             break;
 
         case WAIT_FAILED:
@@ -272,6 +294,7 @@ public:
 
     virtual void __cdecl OnDestroyEngine() noexcept override
     {
+        CancelReads();
         mBase.OnDestroy();
     }
 
@@ -284,15 +307,20 @@ public:
     {
         mBase.GatherStatistics(stats);
 
-        stats.streamingBytes += mPacketSize * MAX_BUFFER_COUNT;
+        stats.streamingBytes += mPacketSize * mBufferCount;
+        stats.streamingStarvations += mStarvations;
     }
 
     virtual void __cdecl OnDestroyParent() noexcept override
     {
+        CancelReads();
         mBase.OnDestroy();
         mWaveBank = nullptr;
     }
 
+    // IStreamReader
+    virtual bool __cdecl IssueRead(uint32_t packet) noexcept override;
+
     SoundEffectInstanceBase         mBase;
     WaveBank*                       mWaveBank;
     uint32_t                        mIndex;
@@ -301,6 +329,7 @@ public:
     bool                            mEndStream;
     bool                            mPrefetch;
     bool                            mSitching;
+    bool                            mStarved;
 
     ScopedHandle                    mBufferEnd;
     ScopedHandle                    mBufferRead;
@@ -308,13 +337,14 @@ public:
     enum class State : uint32_t
     {
         FREE = 0,
+        QUEUED,
         PENDING,
         READY,
         PLAYING,
     };
 
 #ifdef VERBOSE_TRACE
-    static const wchar_t* s_debugState[4];
+    static const wchar_t* s_debugState[5];
 #endif
 
     struct BufferNotify : public IVoiceNotify
@@ -365,9 +395,10 @@ public:
             notify{} {}
     };
 
-    Packets                         mPackets[MAX_BUFFER_COUNT];
+    std::unique_ptr<Packets[]>      mPackets;
 
 private:
+    uint32_t                        mBufferCount;
     uint32_t                        mCurrentDiskReadBuffer;
     uint32_t                        mCurrentPlayBuffer;
     uint32_t                        mBlockAlign;
@@ -380,6 +411,11 @@ private:
     size_t                          mTotalSize;
     std::unique_ptr<uint8_t[], virtual_deleter> mStreamBuffer;
 
+    uint32_t                        mBytesPerSecond;
+    size_t                          mPendingReads;
+    size_t                          mStarvations;
+    HRESULT                         mReadResult;
+
 #ifdef DIRECTX_ENABLE_SEEK_TABLES
     uint32_t                        mSeekCount;
     const uint32_t*                 mSeekTable;
@@ -390,29 +426,59 @@ private:
     std::unique_ptr<uint8_t[], apu_deleter> mXMAMemory;
 #endif
 
-    HRESULT AllocateStreamingBuffers(const WAVEFORMATEX* wfx) noexcept;
+    HRESULT AllocateStreamingBuffers(const WAVEFORMATEX* wfx, size_t packetBytes) noexcept;
     HRESULT ReadBuffers() noexcept;
     HRESULT PlayBuffers() noexcept;
+    HRESULT QueueRead(uint32_t entry) noexcept;
+    void CancelReads() noexcept;
+    void CheckStarvation() noexcept;
+
+    void ReleaseRead() noexcept
+    {
+        if (!mPendingReads)
+            return; // Already released by CancelReads
+
+        --mPendingReads;
+
+        if (mBase.engine)
+        {
+            mBase.engine->CompleteStreamRead();
+        }
+    }
 };
 
 
-HRESULT SoundStreamInstance::Impl::AllocateStreamingBuffers(const WAVEFORMATEX* wfx) noexcept
+HRESULT SoundStreamInstance::Impl::AllocateStreamingBuffers(const WAVEFORMATEX* wfx, size_t packetBytes) noexcept
 {
     if (!wfx)
         return E_INVALIDARG;
 
     const uint32_t tag = GetFormatTag(wfx);
 
-    size_t packetSize = ComputeAsyncPacketSize(wfx, tag, mAsyncAlign);
+    size_t packetSize = ComputeAsyncPacketSize(wfx, tag, mAsyncAlign, packetBytes);
     if (!packetSize)
         return E_UNEXPECTED;
 
-    uint64_t totalSize = uint64_t(packetSize) * uint64_t(MAX_BUFFER_COUNT);
+#ifdef DIRECTX_ENABLE_SEEK_TABLES
+    if (mSeekCount > 0 && wfx->nBlockAlign > 0)
+    {
+        // Each xWMA submission copies the seek entries for its packets into mSeekTableCopy
+        const size_t maxSize = size_t(wfx->nBlockAlign) * MAX_STREAMING_SEEK_PACKETS;
+        if (packetSize > maxSize)
+        {
+            const size_t alignment = size_t(mAsyncAlign) * 2;
+            packetSize = std::max(alignment, (maxSize / alignment) * alignment);
+        }
+    }
+#endif
+
+    uint64_t totalSize = uint64_t(packetSize) * uint64_t(mBufferCount);
     if (totalSize > UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
     mPacketSize = packetSize;
     mBlockAlign = wfx->nBlockAlign;
+    mBytesPerSecond = wfx->nAvgBytesPerSec;
     mSitching = false;
 
     size_t stitchSize = 0;
@@ -421,7 +487,7 @@ HRESULT SoundStreamInstance::Impl::AllocateStreamingBuffers(const WAVEFORMATEX*
         mSitching = true;
 
         stitchSize = AlignUp<size_t>(wfx->nBlockAlign, mAsyncAlign);
-        totalSize += uint64_t(stitchSize) * uint64_t(MAX_BUFFER_COUNT);
+        totalSize += uint64_t(stitchSize) * uint64_t(mBufferCount);
         if (totalSize > UINT32_MAX)
             return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
     }
@@ -469,7 +535,7 @@ HRESULT SoundStreamInstance::Impl::AllocateStreamingBuffers(const WAVEFORMATEX*
     #else
         uint8_t* ptr = mStreamBuffer.get();
     #endif
-        for (size_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+        for (size_t j = 0; j < mBufferCount; ++j)
         {
             mPackets[j].buffer = ptr;
             mPackets[j].stitchBuffer = nullptr;
@@ -480,7 +546,7 @@ HRESULT SoundStreamInstance::Impl::AllocateStreamingBuffers(const WAVEFORMATEX*
 
         if (stitchSize > 0)
         {
-            for (size_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+            for (size_t j = 0; j < mBufferCount; ++j)
             {
                 mPackets[j].stitchBuffer = ptr;
                 ptr += stitchSize;
@@ -509,14 +575,13 @@ HRESULT SoundStreamInstance::Impl::ReadBuffers() noexcept
         mCurrentPosition = 0;
     }
 
-    HANDLE async = mWaveBank->GetAsyncHandle();
-    if (!async)
+    if (!mWaveBank || !mWaveBank->GetAsyncHandle())
         return E_POINTER;
 
     const uint32_t readBuffer = mCurrentDiskReadBuffer;
-    for (uint32_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+    for (uint32_t j = 0; j < mBufferCount; ++j)
     {
-        uint32_t entry = (j + readBuffer) % uint32_t(MAX_BUFFER_COUNT);
+        uint32_t entry = (j + readBuffer) % mBufferCount;
         if (mPackets[entry].state == State::FREE)
         {
             if (mCurrentPosition < mLengthInBytes)
@@ -528,27 +593,13 @@ HRESULT SoundStreamInstance::Impl::ReadBuffers() noexcept
                 mPackets[entry].startPosition = static_cast<uint32_t>(mCurrentPosition);
                 mPackets[entry].request.Offset = static_cast<DWORD>(mOffsetBytes + mCurrentPosition);
 
-                if (!ReadFile(async, mPackets[entry].buffer, uint32_t(mPacketSize), nullptr, &mPackets[entry].request))
-                {
-                    const DWORD error = GetLastError();
-                    if (error != ERROR_IO_PENDING)
-                    {
-                    #ifdef _DEBUG
-                        if (error == ERROR_INVALID_PARAMETER)
-                        {
-                            // May be due to Advanced Format (4Kn) vs. DVD sector size. See the xwbtool -af switch.
-                            OutputDebugStringA("ERROR: non-buffered async I/O failed: check disk sector size vs. streaming wave bank alignment!\n");
-                        }
-                    #endif
-                        return HRESULT_FROM_WIN32(error);
-                    }
-                }
+                HRESULT hr = QueueRead(entry);
+                if (FAILED(hr))
+                    return hr;
 
                 mCurrentPosition += cbValid;
 
-                mCurrentDiskReadBuffer = (entry + 1) % uint32_t(MAX_BUFFER_COUNT);
-
-                mPackets[entry].state = State::PENDING;
+                mCurrentDiskReadBuffer = (entry + 1) % mBufferCount;
 
                 if ((cbValid < mPacketSize) && mLooped)
                 {
@@ -561,17 +612,135 @@ HRESULT SoundStreamInstance::Impl::ReadBuffers() noexcept
         }
     }
 
-    return S_OK;
+    // Reads the engine issued later from its queue may also have failed to start
+    const HRESULT hr = mReadResult;
+    mReadResult = S_OK;
+    return hr;
+}
+
+
+HRESULT SoundStreamInstance::Impl::QueueRead(uint32_t entry) noexcept
+{
+    mPackets[entry].state = State::QUEUED;
+
+    if (!mBase.engine)
+    {
+        std::ignore = IssueRead(entry);
+    }
+    else
+    {
+        // Packets buffered or being read ahead of this one
+        size_t ahead = 0;
+        for (uint32_t j = 0; j < mBufferCount; ++j)
+        {
+            if (j != entry && mPackets[j].state != State::FREE)
+                ++ahead;
+        }
+
+        const uint64_t deadline = StreamScheduler::ComputeDeadline(StreamScheduler::GetTime(), ahead, mPacketSize, mBytesPerSecond);
+
+        try
+        {
+            // May issue the read right away if a slot is free
+            mBase.engine->QueueStreamRead(this, entry, deadline);
+        }
+        catch (const std::bad_alloc&)
+        {
+            mPackets[entry].state = State::FREE;
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    const HRESULT hr = mReadResult;
+    mReadResult = S_OK;
+    return hr;
+}
+
+
+bool SoundStreamInstance::Impl::IssueRead(uint32_t packet) noexcept
+{
+    assert(packet < mBufferCount);
+    auto& entry = mPackets[packet];
+    assert(entry.state == State::QUEUED);
+
+    HANDLE async = (mWaveBank) ? mWaveBank->GetAsyncHandle() : nullptr;
+    if (!async)
+    {
+        entry.state = State::FREE;
+        mReadResult = E_POINTER;
+        return false;
+    }
+
+    if (!ReadFile(async, entry.buffer, uint32_t(mPacketSize), nullptr, &entry.request))
+    {
+        const DWORD error = GetLastError();
+        if (error != ERROR_IO_PENDING)
+        {
+        #ifdef _DEBUG
+            if (error == ERROR_INVALID_PARAMETER)
+            {
+                // May be due to Advanced Format (4Kn) vs. DVD sector size. See the xwbtool -af switch.
+                OutputDebugStringA("ERROR: non-buffered async I/O failed: check disk sector size vs. streaming wave bank alignment!\n");
+            }
+        #endif
+            entry.state = State::FREE;
+            mReadResult = HRESULT_FROM_WIN32(error);
+            return false;
+        }
+    }
+
+    entry.state = State::PENDING;
+    ++mPendingReads;
+    return true;
+}
+
+
+void SoundStreamInstance::Impl::CancelReads() noexcept
+{
+    if (mBase.engine)
+    {
+        mBase.engine->CancelStreamReads(this, mPendingReads);
+    }
+    mPendingReads = 0;
+
+    for (uint32_t j = 0; j < mBufferCount; ++j)
+    {
+        if (mPackets[j].state == State::QUEUED)
+        {
+            mPackets[j].state = State::FREE;
+        }
+    }
+}
+
+
+void SoundStreamInstance::Impl::CheckStarvation() noexcept
+{
+    if (mEndStream || mBase.state != PLAYING)
+        return;
+
+    // Every submitted packet has finished, so the voice is silent until the next read completes
+    if (!mBase.GetPendingBufferCount())
+    {
+        if (!mStarved)
+        {
+            mStarved = true;
+            ++mStarvations;
+
+        #ifdef VERBOSE_TRACE
+            DebugTrace("INFO (Streaming): Starved (readpos %zu)\n", mCurrentPosition);
+        #endif
+        }
+    }
 }
 
 
 HRESULT SoundStreamInstance::Impl::PlayBuffers() noexcept
 {
-    HANDLE async = mWaveBank->GetAsyncHandle();
+    HANDLE async = (mWaveBank) ? mWaveBank->GetAsyncHandle() : nullptr;
     if (!async)
         return E_POINTER;
 
-    for (uint32_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+    for (uint32_t j = 0; j < mBufferCount; ++j)
     {
         if (mPackets[j].state == State::PENDING)
         {
@@ -584,12 +753,14 @@ HRESULT SoundStreamInstance::Impl::PlayBuffers() noexcept
             if (result)
             {
                 mPackets[j].state = State::READY;
+                ReleaseRead();
             }
             else
             {
                 const DWORD error = GetLastError();
                 if (error != ERROR_IO_INCOMPLETE)
                 {
+                    ReleaseRead();
                     ThrowIfFailed(HRESULT_FROM_WIN32(error));
                 }
             }
@@ -599,7 +770,7 @@ HRESULT SoundStreamInstance::Impl::PlayBuffers() noexcept
     if (!mBase.voice || !mPlaying)
         return S_FALSE;
 
-    for (uint32_t j = 0; j < MAX_BUFFER_COUNT; ++j)
+    for (uint32_t j = 0; j < mBufferCount; ++j)
     {
         if (mPackets[mCurrentPlayBuffer].state != State::READY)
             break;
@@ -629,7 +800,7 @@ HRESULT SoundStreamInstance::Impl::PlayBuffers() noexcept
                 // Compute how many bytes at the start of our current packet are the tail of the partial block.
                 thisFrameStitch = mBlockAlign - prevFrameStitch;
 
-                const uint32_t k = (mCurrentPlayBuffer + MAX_BUFFER_COUNT - 1) % MAX_BUFFER_COUNT;
+                const uint32_t k = (mCurrentPlayBuffer + mBufferCount - 1) % mBufferCount;
                 if (mPackets[k].state == State::READY || mPackets[k].state == State::PLAYING)
                 {
                     // Compute how many bytes at the start of the previous packet were the tail of the previous stitch block.
@@ -731,16 +902,18 @@ HRESULT SoundStreamInstance::Impl::PlayBuffers() noexcept
         }
 
         mPackets[mCurrentPlayBuffer].state = State::PLAYING;
-        mCurrentPlayBuffer = (mCurrentPlayBuffer + 1) % uint32_t(MAX_BUFFER_COUNT);
+        mCurrentPlayBuffer = (mCurrentPlayBuffer + 1) % mBufferCount;
+        mStarved = false;
     }
 
     return S_OK;
 }
 
 #ifdef VERBOSE_TRACE
-const wchar_t* SoundStreamInstance::Impl::s_debugState[4] =
+const wchar_t* SoundStreamInstance::Impl::s_debugState[5] =
 {
     L"FREE",
+    L"QUEUED",
     L"PENDING",
     L"READY",
     L"PLAYING"
@@ -830,6 +1003,33 @@ void SoundStreamInstance::Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAU
 }
 
 
+_Use_decl_annotations_
+void SoundStreamInstance::Apply3D(
+    const X3DAUDIO_LISTENER& listener,
+    SoundStreamInstance* const* instances,
+    const X3DAUDIO_EMITTER* const* emitters,
+    size_t count,
+    bool rhcoords)
+{
+    if (!count)
+        return;
+
+    if (!instances)
+        throw std::invalid_argument("Apply3D");
+
+    std::vector<SoundEffectInstanceBase*> bases(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        if (!instances[j])
+            throw std::invalid_argument("Apply3D");
+
+        bases[j] = &instances[j]->pImpl->mBase;
+    }
+
+    SoundEffectInstanceBase::Apply3D(listener, bases.data(), emitters, count, rhcoords);
+}
+
+
 // Public accessors.
 bool SoundStreamInstance::IsLooped() const noexcept
 {
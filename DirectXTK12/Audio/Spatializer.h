@@ -0,0 +1,707 @@
+//--------------------------------------------------------------------------------------
+// File: Spatializer.h
+//
+// Batched positional audio for mono emitters around a single listener. Covers the part
+// of X3DAudioCalculate used by Apply3D (matrix, doppler, LPF and reverb send) but works
+// on four emitters at a time in structure-of-arrays form. Only DirectXMath is required,
+// and CalculateReference provides a scalar version of the same math for validation.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include <DirectXMath.h>
+
+#include "SALFallback.h"
+
+
+namespace DirectX
+{
+    namespace Spatializer
+    {
+        constexpr uint32_t c_maxChannels = 8;
+        constexpr uint32_t c_noChannel = UINT32_MAX;
+
+        // These are layout-compatible with X3DAUDIO_DISTANCE_CURVE_POINT, X3DAUDIO_DISTANCE_CURVE,
+        // and X3DAUDIO_CONE so emitters can point at the caller's data directly.
+        struct CurvePoint
+        {
+            float distance;
+            float value;
+        };
+
+        struct Curve
+        {
+            const CurvePoint* points;
+            uint32_t pointCount;
+        };
+
+        struct Cone
+        {
+            float innerAngle;
+            float outerAngle;
+            float innerVolume;
+            float outerVolume;
+            float innerLPF;
+            float outerLPF;
+            float innerReverb;
+            float outerReverb;
+        };
+
+        // Left-handed coordinates, as with X3DAudio.
+        struct Listener
+        {
+            XMFLOAT3 front;
+            XMFLOAT3 top;
+            XMFLOAT3 position;
+            XMFLOAT3 velocity;
+            const Cone* cone;
+        };
+
+        // A null volume or LFE curve uses the inverse distance law; the other null curves use the X3DAudio defaults.
+        struct Emitter
+        {
+            XMFLOAT3 front;
+            XMFLOAT3 position;
+            XMFLOAT3 velocity;
+            const Cone* cone;
+            float innerRadius;
+            float curveDistanceScaler;
+            float dopplerScaler;
+            const Curve* volumeCurve;
+            const Curve* lfeCurve;
+            const Curve* lpfDirectCurve;
+            const Curve* lpfReverbCurve;
+            const Curve* reverbCurve;
+        };
+
+        // Destination speaker layout, built once per batch from the mastering voice channel mask.
+        struct Speakers
+        {
+            uint32_t channels;
+            uint32_t lfe;
+            uint32_t count;
+            uint32_t index[c_maxChannels];
+            float azimuth[c_maxChannels];
+            float spanLeft[c_maxChannels];
+            float spanRight[c_maxChannels];
+        };
+
+        struct Result
+        {
+            float matrix[c_maxChannels];
+            float dopplerFactor;
+            float lpfDirect;
+            float lpfReverb;
+            float reverbLevel;
+        };
+
+        namespace Internal
+        {
+            constexpr float c_2pi = XM_2PI;
+
+            // Clockwise from the listener's front, matching c_channelAzimuths in SoundCommon.cpp.
+            // Indexed by bit position in the channel mask; negative entries have no position.
+            constexpr float c_speakerAzimuths[18] =
+            {
+                7.f * XM_PI / 4.f,      // SPEAKER_FRONT_LEFT
+                XM_PI / 4.f,            // SPEAKER_FRONT_RIGHT
+                0.f,                    // SPEAKER_FRONT_CENTER
+                -1.f,                   // SPEAKER_LOW_FREQUENCY
+                5.f * XM_PI / 4.f,      // SPEAKER_BACK_LEFT
+                3.f * XM_PI / 4.f,      // SPEAKER_BACK_RIGHT
+                15.f * XM_PI / 8.f,     // SPEAKER_FRONT_LEFT_OF_CENTER
+                XM_PI / 8.f,            // SPEAKER_FRONT_RIGHT_OF_CENTER
+                XM_PI,                  // SPEAKER_BACK_CENTER
+                3.f * XM_PI / 2.f,      // SPEAKER_SIDE_LEFT
+                XM_PI / 2.f,            // SPEAKER_SIDE_RIGHT
+                -1.f, -1.f, -1.f, -1.f, -1.f, -1.f, -1.f, // SPEAKER_TOP_*
+            };
+
+            constexpr uint32_t c_lowFrequencyBit = 3;
+
+            // Defaults X3DAudioCalculate uses when an emitter curve is null.
+            constexpr CurvePoint c_defaultLPFDirectPoints[2] = { { 0.f, 1.f }, { 1.f, 0.75f } };
+            constexpr CurvePoint c_defaultLPFReverbPoints[2] = { { 0.f, 0.75f }, { 1.f, 0.75f } };
+            constexpr CurvePoint c_defaultReverbPoints[2] = { { 0.f, 1.f }, { 1.f, 0.f } };
+
+            constexpr Curve c_defaultLPFDirectCurve = { c_defaultLPFDirectPoints, 2 };
+            constexpr Curve c_defaultLPFReverbCurve = { c_defaultLPFReverbPoints, 2 };
+            constexpr Curve c_defaultReverbCurve = { c_defaultReverbPoints, 2 };
+
+            // Half-angle of pi always falls inside the inner cone, so this leaves all three factors at 1.
+            constexpr Cone c_noCone = { c_2pi, c_2pi, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f };
+
+            constexpr float c_epsilon = 1e-7f;
+
+            //----------------------------------------------------------------------------
+            // Scalar helpers
+
+            inline float WrapAngle(float angle) noexcept
+            {
+                return (angle < 0.f) ? angle + c_2pi : angle;
+            }
+
+            inline float EvaluateCurve(_In_opt_ const Curve* curve, float distance) noexcept
+            {
+                if (!curve || !curve->pointCount)
+                    return 1.f / std::max(distance, 1.f);
+
+                // A zero-width segment steps the value; from its distance on, the later point applies.
+                const CurvePoint* points = curve->points;
+                if (distance < points[0].distance)
+                    return points[0].value;
+
+                for (uint32_t j = 1; j < curve->pointCount; ++j)
+                {
+                    if (distance < points[j].distance)
+                    {
+                        const float t = (distance - points[j - 1].distance) / (points[j].distance - points[j - 1].distance);
+                        return points[j - 1].value + t * (points[j].value - points[j - 1].value);
+                    }
+                }
+
+                return points[curve->pointCount - 1].value;
+            }
+
+            // Returns the interpolation weight between the inner and outer cone values.
+            inline float ConeWeight(const Cone& cone, float cosAngle) noexcept
+            {
+                const float angle = std::acos(std::min(std::max(cosAngle, -1.f), 1.f));
+                const float inner = cone.innerAngle * 0.5f;
+                const float range = cone.outerAngle * 0.5f - inner;
+                if (range <= c_epsilon)
+                    return (angle > inner) ? 1.f : 0.f;
+
+                return std::min(std::max((angle - inner) / range, 0.f), 1.f);
+            }
+
+            inline float PanGain(const Speakers& speakers, uint32_t speaker, float azimuth) noexcept
+            {
+                if (speakers.count == 1)
+                    return 1.f;
+
+                const float right = WrapAngle(azimuth - speakers.azimuth[speaker]);
+                const float left = WrapAngle(speakers.azimuth[speaker] - azimuth);
+
+                // Both angles are zero when the emitter is in line with the speaker, which must count only once.
+                if (right < speakers.spanRight[speaker])
+                    return std::cos(right / speakers.spanRight[speaker] * XM_PIDIV2);
+                if (left < speakers.spanLeft[speaker])
+                    return std::cos(left / speakers.spanLeft[speaker] * XM_PIDIV2);
+                return 0.f;
+            }
+
+            //----------------------------------------------------------------------------
+            // SIMD helpers (one lane per emitter)
+
+            inline XMVECTOR XM_CALLCONV LaneMask(uint32_t lanes) noexcept
+            {
+                return XMVectorSelectControl(lanes & 1, (lanes >> 1) & 1, (lanes >> 2) & 1, (lanes >> 3) & 1);
+            }
+
+            inline XMVECTOR XM_CALLCONV WrapAngle(FXMVECTOR angle) noexcept
+            {
+                const XMVECTOR wrapped = XMVectorAdd(angle, XMVectorReplicate(c_2pi));
+                return XMVectorSelect(angle, wrapped, XMVectorLess(angle, XMVectorZero()));
+            }
+
+            // Each segment overrides the result for distances past its start, and clamping the last segment
+            // holds its end value, so the curve is evaluated without branching on the distance.
+            inline XMVECTOR XM_CALLCONV EvaluateCurve(_In_opt_ const Curve* curve, FXMVECTOR distance) noexcept
+            {
+                if (!curve || !curve->pointCount)
+                    return XMVectorReciprocal(XMVectorMax(distance, XMVectorSplatOne()));
+
+                const CurvePoint* points = curve->points;
+                XMVECTOR result = XMVectorReplicate(points[0].value);
+
+                for (uint32_t j = 1; j < curve->pointCount; ++j)
+                {
+                    const XMVECTOR start = XMVectorReplicate(points[j - 1].distance);
+                    const float width = points[j].distance - points[j - 1].distance;
+
+                    XMVECTOR value;
+                    if (width > 0.f)
+                    {
+                        const XMVECTOR slope = XMVectorReplicate((points[j].value - points[j - 1].value) / width);
+                        const XMVECTOR d = XMVectorSubtract(XMVectorClamp(distance, start, XMVectorReplicate(points[j].distance)), start);
+                        value = XMVectorMultiplyAdd(d, slope, XMVectorReplicate(points[j - 1].value));
+                    }
+                    else
+                    {
+                        value = XMVectorReplicate(points[j].value);
+                    }
+
+                    const XMVECTOR past = (width > 0.f)
+                        ? XMVectorGreater(distance, start)
+                        : XMVectorGreaterOrEqual(distance, start);
+                    result = XMVectorSelect(result, value, past);
+                }
+
+                return result;
+            }
+
+            // Lanes usually share the same curve, so each distinct curve is evaluated once across all four.
+            inline XMVECTOR XM_CALLCONV EvaluateCurves(_In_reads_(4) const Curve* const* curves, FXMVECTOR distance) noexcept
+            {
+                XMVECTOR result = XMVectorZero();
+                uint32_t done = 0;
+                for (uint32_t lane = 0; lane < 4; ++lane)
+                {
+                    if (done & (1u << lane))
+                        continue;
+
+                    uint32_t lanes = 0;
+                    for (uint32_t j = lane; j < 4; ++j)
+                    {
+                        if (curves[j] == curves[lane])
+                            lanes |= 1u << j;
+                    }
+                    done |= lanes;
+
+                    result = XMVectorSelect(result, EvaluateCurve(curves[lane], distance), LaneMask(lanes));
+                }
+                return result;
+            }
+
+            inline XMVECTOR XM_CALLCONV ConeWeight(FXMVECTOR innerAngle, FXMVECTOR outerAngle, FXMVECTOR cosAngle) noexcept
+            {
+                const XMVECTOR angle = XMVectorACos(XMVectorClamp(cosAngle, XMVectorNegate(XMVectorSplatOne()), XMVectorSplatOne()));
+                const XMVECTOR half = XMVectorReplicate(0.5f);
+                const XMVECTOR inner = XMVectorMultiply(innerAngle, half);
+                const XMVECTOR range = XMVectorSubtract(XMVectorMultiply(outerAngle, half), inner);
+
+                const XMVECTOR hasRange = XMVectorGreater(range, XMVectorReplicate(c_epsilon));
+                const XMVECTOR weight = XMVectorSaturate(XMVectorDivide(XMVectorSubtract(angle, inner),
+                    XMVectorSelect(XMVectorSplatOne(), range, hasRange)));
+                const XMVECTOR step = XMVectorSelect(XMVectorZero(), XMVectorSplatOne(), XMVectorGreater(angle, inner));
+                return XMVectorSelect(step, weight, hasRange);
+            }
+
+            struct ConeFactors
+            {
+                XMVECTOR volume;
+                XMVECTOR lpf;
+                XMVECTOR reverb;
+            };
+
+            inline ConeFactors XM_CALLCONV EvaluateCones(_In_reads_(4) const Cone* const* cones, FXMVECTOR cosAngle) noexcept
+            {
+                XMFLOAT4A values[8];
+                for (uint32_t lane = 0; lane < 4; ++lane)
+                {
+                    const float* src = &cones[lane]->innerAngle;
+                    for (uint32_t j = 0; j < 8; ++j)
+                    {
+                        reinterpret_cast<float*>(&values[j])[lane] = src[j];
+                    }
+                }
+
+                const XMVECTOR weight = ConeWeight(XMLoadFloat4A(&values[0]), XMLoadFloat4A(&values[1]), cosAngle);
+
+                ConeFactors result;
+                result.volume = XMVectorLerpV(XMLoadFloat4A(&values[2]), XMLoadFloat4A(&values[3]), weight);
+                result.lpf = XMVectorLerpV(XMLoadFloat4A(&values[4]), XMLoadFloat4A(&values[5]), weight);
+                result.reverb = XMVectorLerpV(XMLoadFloat4A(&values[6]), XMLoadFloat4A(&values[7]), weight);
+                return result;
+            }
+
+            inline ConeFactors XM_CALLCONV EvaluateCone(const Cone& cone, FXMVECTOR cosAngle) noexcept
+            {
+                const Cone* cones[4] = { &cone, &cone, &cone, &cone };
+                return EvaluateCones(cones, cosAngle);
+            }
+        }
+
+        //--------------------------------------------------------------------------------
+        // Builds the speaker layout for a destination channel mask. Returns false if the mask does not
+        // describe 'channels' channels or there are too many for the batched path, in which case callers
+        // should use X3DAudioCalculate instead.
+        inline bool InitializeSpeakers(uint32_t channelMask, uint32_t channels, Speakers& speakers) noexcept
+        {
+            memset(&speakers, 0, sizeof(Speakers));
+            speakers.lfe = c_noChannel;
+
+            if (!channels || channels > c_maxChannels)
+                return false;
+
+            uint32_t channel = 0;
+            for (uint32_t bit = 0; bit < 32; ++bit)
+            {
+                if (!(channelMask & (1u << bit)))
+                    continue;
+
+                if (channel >= channels)
+                    return false;
+
+                if (bit == Internal::c_lowFrequencyBit)
+                {
+                    speakers.lfe = channel;
+                }
+                else if (bit < std::size(Internal::c_speakerAzimuths) && Internal::c_speakerAzimuths[bit] >= 0.f)
+                {
+                    // Insertion sort by azimuth so neighbors are adjacent.
+                    const float azimuth = Internal::c_speakerAzimuths[bit];
+                    uint32_t j = speakers.count++;
+                    for (; j > 0 && speakers.azimuth[j - 1] > azimuth; --j)
+                    {
+                        speakers.azimuth[j] = speakers.azimuth[j - 1];
+                        speakers.index[j] = speakers.index[j - 1];
+                    }
+                    speakers.azimuth[j] = azimuth;
+                    speakers.index[j] = channel;
+                }
+
+                ++channel;
+            }
+
+            if (channel != channels)
+                return false;
+
+            speakers.channels = channels;
+
+            for (uint32_t j = 0; j < speakers.count; ++j)
+            {
+                const uint32_t next = (j + 1) % speakers.count;
+                float span = speakers.azimuth[next] - speakers.azimuth[j];
+                if (span <= 0.f)
+                    span += Internal::c_2pi;
+
+                speakers.spanRight[j] = span;
+                speakers.spanLeft[next] = span;
+            }
+
+            return true;
+        }
+
+        //--------------------------------------------------------------------------------
+        // Scalar implementation, one emitter at a time.
+        inline void CalculateReference(
+            const Listener& listener,
+            const Speakers& speakers,
+            _In_reads_(count) const Emitter* emitters,
+            size_t count,
+            float speedOfSound,
+            bool redirectToLFE,
+            _Out_writes_(count) Result* results) noexcept
+        {
+            using namespace Internal;
+
+            const XMVECTOR front = XMVector3Normalize(XMLoadFloat3(&listener.front));
+            const XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&listener.top), front));
+
+            XMFLOAT3 lf, lr;
+            XMStoreFloat3(&lf, front);
+            XMStoreFloat3(&lr, right);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Emitter& emitter = emitters[i];
+                Result& result = results[i];
+                memset(&result, 0, sizeof(Result));
+
+                const float dx = emitter.position.x - listener.position.x;
+                const float dy = emitter.position.y - listener.position.y;
+                const float dz = emitter.position.z - listener.position.z;
+                const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+                const float invDistance = (distance > c_epsilon) ? 1.f / distance : 0.f;
+                const float ux = dx * invDistance;
+                const float uy = dy * invDistance;
+                const float uz = dz * invDistance;
+
+                const float scaled = distance / emitter.curveDistanceScaler;
+
+                float volume = EvaluateCurve(emitter.volumeCurve, scaled);
+                const float lfe = EvaluateCurve(emitter.lfeCurve, scaled);
+                float lpfDirect = EvaluateCurve(emitter.lpfDirectCurve ? emitter.lpfDirectCurve : &c_defaultLPFDirectCurve, scaled);
+                float lpfReverb = EvaluateCurve(emitter.lpfReverbCurve ? emitter.lpfReverbCurve : &c_defaultLPFReverbCurve, scaled);
+                float reverb = EvaluateCurve(emitter.reverbCurve ? emitter.reverbCurve : &c_defaultReverbCurve, scaled);
+
+                // Emitter cone faces the listener; listener cone faces the emitter.
+                {
+                    const Cone& cone = emitter.cone ? *emitter.cone : c_noCone;
+                    const float cosAngle = (distance > c_epsilon)
+                        ? -(emitter.front.x * ux + emitter.front.y * uy + emitter.front.z * uz)
+                        : 1.f;
+                    const float t = ConeWeight(cone, cosAngle);
+                    volume *= cone.innerVolume + t * (cone.outerVolume - cone.innerVolume);
+                    const float lpf = cone.innerLPF + t * (cone.outerLPF - cone.innerLPF);
+                    lpfDirect *= lpf;
+                    lpfReverb *= lpf;
+                    reverb *= cone.innerReverb + t * (cone.outerReverb - cone.innerReverb);
+                }
+
+                if (listener.cone)
+                {
+                    const Cone& cone = *listener.cone;
+                    const float cosAngle = (distance > c_epsilon)
+                        ? (lf.x * ux + lf.y * uy + lf.z * uz)
+                        : 1.f;
+                    const float t = ConeWeight(cone, cosAngle);
+                    volume *= cone.innerVolume + t * (cone.outerVolume - cone.innerVolume);
+                    const float lpf = cone.innerLPF + t * (cone.outerLPF - cone.innerLPF);
+                    lpfDirect *= lpf;
+                    lpfReverb *= lpf;
+                    reverb *= cone.innerReverb + t * (cone.outerReverb - cone.innerReverb);
+                }
+
+                result.lpfDirect = std::min(std::max(lpfDirect, 0.f), 1.f);
+                result.lpfReverb = std::min(std::max(lpfReverb, 0.f), 1.f);
+                result.reverbLevel = std::min(std::max(reverb, 0.f), 2.f);
+
+                // Doppler, using the velocity components along the emitter-to-listener direction.
+                result.dopplerFactor = 1.f;
+                if (emitter.dopplerScaler > 0.f)
+                {
+                    const float scaledSpeed = speedOfSound / emitter.dopplerScaler;
+                    const float listenerSpeed = std::min(-(listener.velocity.x * ux + listener.velocity.y * uy + listener.velocity.z * uz), scaledSpeed);
+                    const float emitterSpeed = std::min(-(emitter.velocity.x * ux + emitter.velocity.y * uy + emitter.velocity.z * uz), scaledSpeed);
+                    result.dopplerFactor = (speedOfSound - emitter.dopplerScaler * listenerSpeed)
+                        / std::max(speedOfSound - emitter.dopplerScaler * emitterSpeed, c_epsilon);
+                }
+
+                // Constant-power pan between the two speakers either side of the emitter, blended toward
+                // an even spread while the listener is inside the emitter's inner radius.
+                const float azimuth = WrapAngle(std::atan2(dx * lr.x + dy * lr.y + dz * lr.z, dx * lf.x + dy * lf.y + dz * lf.z));
+                const float spread = (emitter.innerRadius > 0.f)
+                    ? std::min(std::max(1.f - distance / emitter.innerRadius, 0.f), 1.f)
+                    : 0.f;
+
+                for (uint32_t s = 0; s < speakers.count; ++s)
+                {
+                    const float gain = PanGain(speakers, s, azimuth);
+                    const float blended = std::sqrt((1.f - spread) * gain * gain + spread / float(speakers.count));
+                    result.matrix[speakers.index[s]] = blended * volume;
+                }
+
+                if (redirectToLFE && speakers.lfe != c_noChannel)
+                {
+                    result.matrix[speakers.lfe] = lfe;
+                }
+            }
+        }
+
+        //--------------------------------------------------------------------------------
+        // SIMD implementation, four emitters at a time.
+        inline void Calculate(
+            const Listener& listener,
+            const Speakers& speakers,
+            _In_reads_(count) const Emitter* emitters,
+            size_t count,
+            float speedOfSound,
+            bool redirectToLFE,
+            _Out_writes_(count) Result* results) noexcept
+        {
+            using namespace Internal;
+
+            const XMVECTOR front = XMVector3Normalize(XMLoadFloat3(&listener.front));
+            const XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&listener.top), front));
+
+            const XMVECTOR lfx = XMVectorSplatX(front);
+            const XMVECTOR lfy = XMVectorSplatY(front);
+            const XMVECTOR lfz = XMVectorSplatZ(front);
+            const XMVECTOR lrx = XMVectorSplatX(right);
+            const XMVECTOR lry = XMVectorSplatY(right);
+            const XMVECTOR lrz = XMVectorSplatZ(right);
+            const XMVECTOR lvx = XMVectorReplicate(listener.velocity.x);
+            const XMVECTOR lvy = XMVectorReplicate(listener.velocity.y);
+            const XMVECTOR lvz = XMVectorReplicate(listener.velocity.z);
+
+            const XMVECTOR zero = XMVectorZero();
+            const XMVECTOR one = XMVectorSplatOne();
+            const XMVECTOR epsilon = XMVectorReplicate(c_epsilon);
+            const XMVECTOR speed = XMVectorReplicate(speedOfSound);
+            const XMVECTOR halfPi = XMVectorReplicate(XM_PIDIV2);
+            const XMVECTOR invCount = XMVectorReplicate(speakers.count ? 1.f / float(speakers.count) : 0.f);
+
+            for (size_t base = 0; base < count; base += 4)
+            {
+                const size_t lanes = std::min<size_t>(4, count - base);
+
+                // Transpose the emitters into one vector per field; short groups repeat the last emitter.
+                XMFLOAT4A px, py, pz, fx, fy, fz, vx, vy, vz, scaler, doppler, innerRadius;
+                const Cone* cones[4];
+                const Curve* volumeCurves[4];
+                const Curve* lfeCurves[4];
+                const Curve* lpfDirectCurves[4];
+                const Curve* lpfReverbCurves[4];
+                const Curve* reverbCurves[4];
+
+                for (size_t lane = 0; lane < 4; ++lane)
+                {
+                    const Emitter& e = emitters[base + std::min(lane, lanes - 1)];
+                    auto set = [lane](XMFLOAT4A& v, float value) noexcept { reinterpret_cast<float*>(&v)[lane] = value; };
+                    set(px, e.position.x - listener.position.x);
+                    set(py, e.position.y - listener.position.y);
+                    set(pz, e.position.z - listener.position.z);
+                    set(fx, e.front.x);
+                    set(fy, e.front.y);
+                    set(fz, e.front.z);
+                    set(vx, e.velocity.x);
+                    set(vy, e.velocity.y);
+                    set(vz, e.velocity.z);
+                    set(scaler, e.curveDistanceScaler);
+                    set(doppler, e.dopplerScaler);
+                    set(innerRadius, e.innerRadius);
+                    cones[lane] = e.cone ? e.cone : &c_noCone;
+                    volumeCurves[lane] = e.volumeCurve;
+                    lfeCurves[lane] = e.lfeCurve;
+                    lpfDirectCurves[lane] = e.lpfDirectCurve ? e.lpfDirectCurve : &c_defaultLPFDirectCurve;
+                    lpfReverbCurves[lane] = e.lpfReverbCurve ? e.lpfReverbCurve : &c_defaultLPFReverbCurve;
+                    reverbCurves[lane] = e.reverbCurve ? e.reverbCurve : &c_defaultReverbCurve;
+                }
+
+                const XMVECTOR dx = XMLoadFloat4A(&px);
+                const XMVECTOR dy = XMLoadFloat4A(&py);
+                const XMVECTOR dz = XMLoadFloat4A(&pz);
+
+                const XMVECTOR distance = XMVectorSqrt(XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz))));
+                const XMVECTOR apart = XMVectorGreater(distance, epsilon);
+                const XMVECTOR invDistance = XMVectorSelect(zero, XMVectorReciprocal(XMVectorSelect(one, distance, apart)), apart);
+                const XMVECTOR ux = XMVectorMultiply(dx, invDistance);
+                const XMVECTOR uy = XMVectorMultiply(dy, invDistance);
+                const XMVECTOR uz = XMVectorMultiply(dz, invDistance);
+
+                const XMVECTOR scaled = XMVectorDivide(distance, XMLoadFloat4A(&scaler));
+
+                XMVECTOR volume = EvaluateCurves(volumeCurves, scaled);
+                const XMVECTOR lfe = EvaluateCurves(lfeCurves, scaled);
+                XMVECTOR lpfDirect = EvaluateCurves(lpfDirectCurves, scaled);
+                XMVECTOR lpfReverb = EvaluateCurves(lpfReverbCurves, scaled);
+                XMVECTOR reverb = EvaluateCurves(reverbCurves, scaled);
+
+                // Emitter cone faces the listener; listener cone faces the emitter.
+                {
+                    XMVECTOR cosAngle = XMVectorNegate(XMVectorMultiplyAdd(XMLoadFloat4A(&fx), ux,
+                        XMVectorMultiplyAdd(XMLoadFloat4A(&fy), uy, XMVectorMultiply(XMLoadFloat4A(&fz), uz))));
+                    cosAngle = XMVectorSelect(one, cosAngle, apart);
+
+                    const ConeFactors factors = EvaluateCones(cones, cosAngle);
+                    volume = XMVectorMultiply(volume, factors.volume);
+                    lpfDirect = XMVectorMultiply(lpfDirect, factors.lpf);
+                    lpfReverb = XMVectorMultiply(lpfReverb, factors.lpf);
+                    reverb = XMVectorMultiply(reverb, factors.reverb);
+                }
+
+                if (listener.cone)
+                {
+                    XMVECTOR cosAngle = XMVectorMultiplyAdd(lfx, ux, XMVectorMultiplyAdd(lfy, uy, XMVectorMultiply(lfz, uz)));
+                    cosAngle = XMVectorSelect(one, cosAngle, apart);
+
+                    const ConeFactors factors = EvaluateCone(*listener.cone, cosAngle);
+                    volume = XMVectorMultiply(volume, factors.volume);
+                    lpfDirect = XMVectorMultiply(lpfDirect, factors.lpf);
+                    lpfReverb = XMVectorMultiply(lpfReverb, factors.lpf);
+                    reverb = XMVectorMultiply(reverb, factors.reverb);
+                }
+
+                lpfDirect = XMVectorSaturate(lpfDirect);
+                lpfReverb = XMVectorSaturate(lpfReverb);
+                reverb = XMVectorClamp(reverb, zero, XMVectorReplicate(2.f));
+
+                // Doppler, using the velocity components along the emitter-to-listener direction.
+                XMVECTOR dopplerFactor;
+                {
+                    const XMVECTOR scalerV = XMLoadFloat4A(&doppler);
+                    const XMVECTOR enabled = XMVectorGreater(scalerV, zero);
+                    const XMVECTOR scaledSpeed = XMVectorDivide(speed, XMVectorSelect(one, scalerV, enabled));
+
+                    XMVECTOR listenerSpeed = XMVectorNegate(XMVectorMultiplyAdd(lvx, ux, XMVectorMultiplyAdd(lvy, uy, XMVectorMultiply(lvz, uz))));
+                    XMVECTOR emitterSpeed = XMVectorNegate(XMVectorMultiplyAdd(XMLoadFloat4A(&vx), ux,
+                        XMVectorMultiplyAdd(XMLoadFloat4A(&vy), uy, XMVectorMultiply(XMLoadFloat4A(&vz), uz))));
+                    listenerSpeed = XMVectorMin(listenerSpeed, scaledSpeed);
+                    emitterSpeed = XMVectorMin(emitterSpeed, scaledSpeed);
+
+                    const XMVECTOR numerator = XMVectorNegativeMultiplySubtract(scalerV, listenerSpeed, speed);
+                    const XMVECTOR denominator = XMVectorMax(XMVectorNegativeMultiplySubtract(scalerV, emitterSpeed, speed), epsilon);
+                    dopplerFactor = XMVectorSelect(one, XMVectorDivide(numerator, denominator), enabled);
+                }
+
+                // Constant-power pan between the two speakers either side of the emitter, blended toward
+                // an even spread while the listener is inside the emitter's inner radius.
+                const XMVECTOR azimuth = WrapAngle(XMVectorATan2(
+                    XMVectorMultiplyAdd(dx, lrx, XMVectorMultiplyAdd(dy, lry, XMVectorMultiply(dz, lrz))),
+                    XMVectorMultiplyAdd(dx, lfx, XMVectorMultiplyAdd(dy, lfy, XMVectorMultiply(dz, lfz)))));
+
+                XMVECTOR spread;
+                {
+                    const XMVECTOR radius = XMLoadFloat4A(&innerRadius);
+                    const XMVECTOR hasRadius = XMVectorGreater(radius, zero);
+                    spread = XMVectorSaturate(XMVectorSubtract(one, XMVectorDivide(distance, XMVectorSelect(one, radius, hasRadius))));
+                    spread = XMVectorSelect(zero, spread, hasRadius);
+                }
+
+                const XMVECTOR focus = XMVectorSubtract(one, spread);
+                const XMVECTOR even = XMVectorMultiply(spread, invCount);
+
+                XMFLOAT4A gains[c_maxChannels];
+                for (uint32_t s = 0; s < speakers.count; ++s)
+                {
+                    XMVECTOR gain = one;
+                    if (speakers.count > 1)
+                    {
+                        const XMVECTOR speaker = XMVectorReplicate(speakers.azimuth[s]);
+                        const XMVECTOR spanRight = XMVectorReplicate(speakers.spanRight[s]);
+                        const XMVECTOR spanLeft = XMVectorReplicate(speakers.spanLeft[s]);
+
+                        const XMVECTOR rightAngle = WrapAngle(XMVectorSubtract(azimuth, speaker));
+                        const XMVECTOR leftAngle = WrapAngle(XMVectorSubtract(speaker, azimuth));
+
+                        const XMVECTOR rightGain = XMVectorCos(XMVectorMultiply(XMVectorDivide(rightAngle, spanRight), halfPi));
+                        const XMVECTOR leftGain = XMVectorCos(XMVectorMultiply(XMVectorDivide(leftAngle, spanLeft), halfPi));
+
+                        gain = XMVectorSelect(
+                            XMVectorSelect(zero, leftGain, XMVectorLess(leftAngle, spanLeft)),
+                            rightGain, XMVectorLess(rightAngle, spanRight));
+                    }
+
+                    gain = XMVectorSqrt(XMVectorMultiplyAdd(XMVectorMultiply(gain, gain), focus, even));
+                    XMStoreFloat4A(&gains[s], XMVectorMultiply(gain, volume));
+                }
+
+                XMFLOAT4A lfeOut, dopplerOut, lpfDirectOut, lpfReverbOut, reverbOut;
+                XMStoreFloat4A(&lfeOut, lfe);
+                XMStoreFloat4A(&dopplerOut, dopplerFactor);
+                XMStoreFloat4A(&lpfDirectOut, lpfDirect);
+                XMStoreFloat4A(&lpfReverbOut, lpfReverb);
+                XMStoreFloat4A(&reverbOut, reverb);
+
+                for (size_t lane = 0; lane < lanes; ++lane)
+                {
+                    auto get = [lane](const XMFLOAT4A& v) noexcept { return reinterpret_cast<const float*>(&v)[lane]; };
+
+                    Result& result = results[base + lane];
+                    memset(&result, 0, sizeof(Result));
+
+                    for (uint32_t s = 0; s < speakers.count; ++s)
+                    {
+                        result.matrix[speakers.index[s]] = get(gains[s]);
+                    }
+
+                    if (redirectToLFE && speakers.lfe != c_noChannel)
+                    {
+                        result.matrix[speakers.lfe] = get(lfeOut);
+                    }
+
+                    result.dopplerFactor = get(dopplerOut);
+                    result.lpfDirect = get(lpfDirectOut);
+                    result.lpfReverb = get(lpfReverbOut);
+                    result.reverbLevel = get(reverbOut);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// File: StreamScheduler.h
+//
+// Orders asynchronous packet reads from all streaming instances by deadline, the time at
+// which each stream would run out of buffered audio. The queue does no I/O itself so it
+// can be driven by a simulated disk.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SALFallback.h"
+
+
+namespace DirectX
+{
+    namespace StreamScheduler
+    {
+        // Milliseconds on the clock deadlines are measured against
+        inline uint64_t GetTime() noexcept
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // When playback reaches a packet if no more data arrives: each of the packetsAhead packets
+        // already buffered or being read ahead of it plays for packetBytes / bytesPerSecond.
+        inline uint64_t ComputeDeadline(uint64_t now, size_t packetsAhead, size_t packetBytes, uint32_t bytesPerSecond) noexcept
+        {
+            const uint64_t packetTime = (bytesPerSecond > 0) ? (uint64_t(packetBytes) * 1000u / bytesPerSecond) : 0;
+            return now + uint64_t(packetsAhead) * packetTime;
+        }
+
+        template<typename T>
+        class ReadQueue
+        {
+        public:
+            struct Request
+            {
+                T*          owner;
+                uint32_t    packet;
+                uint64_t    deadline;
+            };
+
+            ReadQueue() noexcept : mMaxInFlight(0), mInFlight(0) {}
+
+            // Limits how many issued reads may be outstanding at once (0 for unlimited)
+            void SetMaxInFlight(size_t maxInFlight) noexcept { mMaxInFlight = maxInFlight; }
+
+            // Requests with equal deadlines are issued in the order they were pushed
+            void Push(_In_ T* owner, uint32_t packet, uint64_t deadline)
+            {
+                // Kept sorted latest-first so the next request to issue is at the back
+                auto it = std::lower_bound(mQueue.begin(), mQueue.end(), deadline,
+                    [](const Request& request, uint64_t value) noexcept { return request.deadline > value; });
+                mQueue.insert(it, Request{ owner, packet, deadline });
+            }
+
+            // Hands queued requests to issue(request) earliest deadline first while the in-flight limit allows.
+            // issue returns false if the read could not be started, in which case it does not take a slot.
+            template<typename F>
+            size_t Issue(F&& issue)
+            {
+                size_t count = 0;
+                while (!mQueue.empty() && (!mMaxInFlight || mInFlight < mMaxInFlight))
+                {
+                    const Request request = mQueue.back();
+                    mQueue.pop_back();
+
+                    if (issue(request))
+                    {
+                        ++mInFlight;
+                        ++count;
+                    }
+                }
+                return count;
+            }
+
+            // Releases the slots of reads that have finished or were cancelled
+            void Complete(size_t count = 1) noexcept
+            {
+                mInFlight = (count < mInFlight) ? (mInFlight - count) : 0;
+            }
+
+            // Drops any requests from owner that have not been issued yet
+            void Cancel(_In_ const T* owner)
+            {
+                mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(),
+                    [owner](const Request& request) noexcept { return request.owner == owner; }), mQueue.end());
+            }
+
+            void Clear() noexcept
+            {
+                mQueue.clear();
+                mInFlight = 0;
+            }
+
+            size_t GetQueued() const noexcept { return mQueue.size(); }
+            size_t GetInFlight() const noexcept { return mInFlight; }
+
+        private:
+            std::vector<Request>    mQueue;
+            size_t                  mMaxInFlight;
+            size_t                  mInFlight;
+        };
+    }
+}
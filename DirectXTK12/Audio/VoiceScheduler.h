@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------
+// File: VoiceScheduler.h
+//
+// Chooses which virtualizable instances own a real XAudio2 voice. The policy has no
+// XAudio2 dependency so it can be driven by a stub backend.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SALFallback.h"
+
+
+namespace DirectX
+{
+    namespace VoiceScheduler
+    {
+        struct Candidate
+        {
+            int         priority;
+            float       audibility;     // Peak output gain from volume and 3D attenuation
+            bool        isReal;         // Currently owns a voice
+            bool        makeReal;       // Set by Schedule
+        };
+
+        // Candidates that already own a voice are ranked as if this much louder, so emitters with
+        // near-equal audibility do not trade voices every frame.
+        constexpr float c_hysteresis = 1.25f;
+
+        // Marks makeReal on the candidates that should own a voice: those at or above minAudibility,
+        // ranked by priority and then audibility, up to maxReal of them. Returns the number marked.
+        inline size_t Schedule(_Inout_updates_(count) Candidate* candidates, size_t count, size_t maxReal, float minAudibility)
+        {
+            auto score = [candidates](size_t index) noexcept
+            {
+                const Candidate& c = candidates[index];
+                return c.isReal ? c.audibility * c_hysteresis : c.audibility;
+            };
+
+            std::vector<size_t> order;
+            order.reserve(count);
+
+            for (size_t j = 0; j < count; ++j)
+            {
+                candidates[j].makeReal = false;
+
+                if (score(j) >= minAudibility)
+                {
+                    order.push_back(j);
+                }
+            }
+
+            if (order.size() > maxReal)
+            {
+                auto better = [candidates, &score](size_t a, size_t b) noexcept
+                {
+                    if (candidates[a].priority != candidates[b].priority)
+                        return candidates[a].priority > candidates[b].priority;
+
+                    const float sa = score(a);
+                    const float sb = score(b);
+                    if (sa != sb)
+                        return sa > sb;
+
+                    return a < b;
+                };
+
+                std::nth_element(order.begin(), order.begin() + static_cast<ptrdiff_t>(maxReal), order.end(), better);
+                order.resize(maxReal);
+            }
+
+            for (auto j : order)
+            {
+                candidates[j].makeReal = true;
+            }
+
+            return order.size();
+        }
+
+        // Applies a Schedule result: demotes every voice losing its slot, then promotes the rest, so the
+        // promotions have the demoted voices to spare. TVoice provides Demote() and bool Promote().
+        // Returns the number of promotions which failed; those instances stay virtual.
+        template<typename TVoice>
+        size_t Apply(_In_reads_(count) const Candidate* candidates, _In_reads_(count) TVoice* const* voices, size_t count)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (candidates[j].isReal && !candidates[j].makeReal)
+                {
+                    voices[j]->Demote();
+                }
+            }
+
+            size_t failed = 0;
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (!candidates[j].isReal && candidates[j].makeReal)
+                {
+                    if (!voices[j]->Promote())
+                        ++failed;
+                }
+            }
+
+            return failed;
+        }
+    }
+}
@@ -0,0 +1,438 @@
+//--------------------------------------------------------------------------------------
+// File: WAVChunkParser.h
+//
+// Locates the format, data, loop, and seek table chunks of a RIFF .wav file in one pass
+// over the chunk headers. The file is reached through a Source, so the same parsing
+// serves the Win32 reader, mapped views, and files held in memory. Chunk bodies are only
+// read for the chunks that are asked for; the audio data can be left in the file.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "SALFallback.h"
+
+
+namespace DirectX
+{
+    namespace WAVChunkParser
+    {
+        constexpr uint32_t MakeFourCC(char a, char b, char c, char d) noexcept
+        {
+            return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+        }
+
+        constexpr uint32_t FOURCC_RIFF_TAG = MakeFourCC('R', 'I', 'F', 'F');
+        constexpr uint32_t FOURCC_FORMAT_TAG = MakeFourCC('f', 'm', 't', ' ');
+        constexpr uint32_t FOURCC_DATA_TAG = MakeFourCC('d', 'a', 't', 'a');
+        constexpr uint32_t FOURCC_WAVE_FILE_TAG = MakeFourCC('W', 'A', 'V', 'E');
+        constexpr uint32_t FOURCC_XWMA_FILE_TAG = MakeFourCC('X', 'W', 'M', 'A');
+        constexpr uint32_t FOURCC_DLS_SAMPLE = MakeFourCC('w', 's', 'm', 'p');
+        constexpr uint32_t FOURCC_MIDI_SAMPLE = MakeFourCC('s', 'm', 'p', 'l');
+        constexpr uint32_t FOURCC_XWMA_DPDS = MakeFourCC('d', 'p', 'd', 's');
+        constexpr uint32_t FOURCC_XMA_SEEK = MakeFourCC('s', 'e', 'e', 'k');
+
+        // sizeof(WAVEFORMAT), which is all the 'fmt ' chunk of the smallest valid file holds
+        constexpr size_t SIZEOF_WAVEFORMAT = 14;
+
+    #pragma pack(push, 1)
+        struct RIFFChunk
+        {
+            uint32_t tag;
+            uint32_t size;
+        };
+
+        struct RIFFChunkHeader
+        {
+            uint32_t tag;
+            uint32_t size;
+            uint32_t riff;
+        };
+
+        struct DLSLoop
+        {
+            static constexpr uint32_t LOOP_TYPE_FORWARD = 0x00000000;
+            static constexpr uint32_t LOOP_TYPE_RELEASE = 0x00000001;
+
+            uint32_t size;
+            uint32_t loopType;
+            uint32_t loopStart;
+            uint32_t loopLength;
+        };
+
+        struct RIFFDLSSample
+        {
+            static constexpr uint32_t OPTIONS_NOTRUNCATION = 0x00000001;
+            static constexpr uint32_t OPTIONS_NOCOMPRESSION = 0x00000002;
+
+            uint32_t    size;
+            uint16_t    unityNote;
+            int16_t     fineTune;
+            int32_t     gain;
+            uint32_t    options;
+            uint32_t    loopCount;
+        };
+
+        struct MIDILoop
+        {
+            static constexpr uint32_t LOOP_TYPE_FORWARD = 0x00000000;
+            static constexpr uint32_t LOOP_TYPE_ALTERNATING = 0x00000001;
+            static constexpr uint32_t LOOP_TYPE_BACKWARD = 0x00000002;
+
+            uint32_t cuePointId;
+            uint32_t type;
+            uint32_t start;
+            uint32_t end;
+            uint32_t fraction;
+            uint32_t playCount;
+        };
+
+        struct RIFFMIDISample
+        {
+            uint32_t        manufacturerId;
+            uint32_t        productId;
+            uint32_t        samplePeriod;
+            uint32_t        unityNode;
+            uint32_t        pitchFraction;
+            uint32_t        SMPTEFormat;
+            uint32_t        SMPTEOffset;
+            uint32_t        loopCount;
+            uint32_t        samplerData;
+        };
+    #pragma pack(pop)
+
+        static_assert(sizeof(RIFFChunk) == 8, "structure size mismatch");
+        static_assert(sizeof(RIFFChunkHeader) == 12, "structure size mismatch");
+        static_assert(sizeof(DLSLoop) == 16, "structure size mismatch");
+        static_assert(sizeof(RIFFDLSSample) == 20, "structure size mismatch");
+        static_assert(sizeof(MIDILoop) == 24, "structure size mismatch");
+        static_assert(sizeof(RIFFMIDISample) == 36, "structure size mismatch");
+
+        //--------------------------------------------------------------------------------
+        // Where the file is read from. Offsets are from the start of the file.
+        class Source
+        {
+        public:
+            virtual ~Source() = default;
+
+            virtual uint64_t GetSize() const noexcept = 0;
+
+            // Reads exactly size bytes, or returns false.
+            virtual bool Read(uint64_t offset, _Out_writes_bytes_(size) void* buffer, size_t size) noexcept = 0;
+        };
+
+        // A whole file image in memory, such as a mapped view.
+        class MemorySource : public Source
+        {
+        public:
+            MemorySource(_In_reads_bytes_(size) const uint8_t* data, size_t size) noexcept :
+                mData(data),
+                mSize(size)
+            {
+            }
+
+            uint64_t GetSize() const noexcept override { return mSize; }
+
+            bool Read(uint64_t offset, void* buffer, size_t size) noexcept override
+            {
+                if (offset > mSize || size > mSize - offset)
+                    return false;
+
+                memcpy(buffer, mData + offset, size);
+                return true;
+            }
+
+        private:
+            const uint8_t*  mData;
+            size_t          mSize;
+        };
+
+        enum class Status
+        {
+            Ok,
+            ReadFailed,     // The source failed
+            InvalidData,    // Not a .wav file, or a chunk is malformed
+            EndOfFile,      // A chunk runs past the end of the file
+            OutOfMemory,
+        };
+
+        enum CHUNK_INDEX : uint32_t
+        {
+            CHUNK_FORMAT = 0,
+            CHUNK_DATA,
+            CHUNK_DLS_SAMPLE,
+            CHUNK_MIDI_SAMPLE,
+            CHUNK_XWMA_DPDS,
+            CHUNK_XMA_SEEK,
+            CHUNK_COUNT
+        };
+
+        struct Chunk
+        {
+            uint64_t        offset;     // Start of the chunk body, or 0 if the file has no such chunk
+            uint32_t        size;
+            const uint8_t*  data;       // Chunk body, if it has been loaded or mapped
+        };
+
+        struct Chunks
+        {
+            uint64_t        fileSize;
+            uint32_t        riff;       // FOURCC_WAVE_FILE_TAG or FOURCC_XWMA_FILE_TAG
+            Chunk           chunks[CHUNK_COUNT];
+
+            bool IsComplete(CHUNK_INDEX index) const noexcept
+            {
+                return (chunks[index].offset + chunks[index].size) <= fileSize;
+            }
+        };
+
+        //--------------------------------------------------------------------------------
+        // Locates every chunk of interest in one pass, keeping the first of each kind. Only
+        // the 8-byte chunk headers are read, so the audio payload is never touched.
+        inline Status FindChunks(Source& source, _Out_ Chunks& chunks) noexcept
+        {
+            memset(&chunks, 0, sizeof(chunks));
+
+            const uint64_t end = source.GetSize();
+            chunks.fileSize = end;
+
+            if (end < (sizeof(RIFFChunk) * 2 + sizeof(uint32_t) + SIZEOF_WAVEFORMAT))
+                return Status::InvalidData;
+
+            // Locate RIFF 'WAVE'
+            uint64_t offset = 0;
+            RIFFChunk header = {};
+            for (;;)
+            {
+                if (((offset + sizeof(RIFFChunk)) >= end) || !source.Read(offset, &header, sizeof(header)))
+                    return Status::InvalidData;
+
+                if (header.tag == FOURCC_RIFF_TAG)
+                    break;
+
+                offset += uint64_t(header.size) + sizeof(RIFFChunk);
+            }
+
+            if (header.size < 4)
+                return Status::InvalidData;
+
+            RIFFChunkHeader riffHeader = {};
+            if (!source.Read(offset, &riffHeader, sizeof(riffHeader)))
+                return Status::EndOfFile;
+
+            if (riffHeader.riff != FOURCC_WAVE_FILE_TAG && riffHeader.riff != FOURCC_XWMA_FILE_TAG)
+                return Status::InvalidData;
+
+            chunks.riff = riffHeader.riff;
+
+            // Walk the sub-chunks
+            offset += sizeof(RIFFChunkHeader);
+            if ((offset + sizeof(RIFFChunk)) > end)
+                return Status::EndOfFile;
+
+            const uint64_t riffEnd = std::min<uint64_t>(offset + riffHeader.size, end);
+            while (riffEnd > (offset + sizeof(RIFFChunk)))
+            {
+                if (!source.Read(offset, &header, sizeof(header)))
+                    return Status::ReadFailed;
+
+                uint32_t index = CHUNK_COUNT;
+                switch (header.tag)
+                {
+                case FOURCC_FORMAT_TAG:     index = CHUNK_FORMAT; break;
+                case FOURCC_DATA_TAG:       index = CHUNK_DATA; break;
+                case FOURCC_DLS_SAMPLE:     index = CHUNK_DLS_SAMPLE; break;
+                case FOURCC_MIDI_SAMPLE:    index = CHUNK_MIDI_SAMPLE; break;
+                case FOURCC_XWMA_DPDS:      index = CHUNK_XWMA_DPDS; break;
+                case FOURCC_XMA_SEEK:       index = CHUNK_XMA_SEEK; break;
+                default:                    break;
+                }
+
+                if (index < CHUNK_COUNT && !chunks.chunks[index].offset)
+                {
+                    chunks.chunks[index].offset = offset + sizeof(RIFFChunk);
+                    chunks.chunks[index].size = header.size;
+                }
+
+                offset += uint64_t(header.size) + sizeof(RIFFChunk);
+            }
+
+            return Status::Ok;
+        }
+
+        //--------------------------------------------------------------------------------
+        // Points the chunks that lie within a whole file image straight into it.
+        inline void MapChunks(_In_reads_bytes_(size) const uint8_t* image, size_t size, Chunks& chunks) noexcept
+        {
+            for (auto& it : chunks.chunks)
+            {
+                if (it.offset && (it.offset + it.size) <= size)
+                {
+                    it.data = image + it.offset;
+                }
+            }
+        }
+
+        //--------------------------------------------------------------------------------
+        // Reads the bodies of the complete chunks into one block, each at 4-byte alignment for
+        // the tables, and points the chunks at them. The 'data' chunk is only read if
+        // includeData is set, and goes last; otherwise the audio is left in the file.
+        inline Status LoadChunks(Source& source, bool includeData, std::unique_ptr<uint8_t[]>& buffer, Chunks& chunks) noexcept
+        {
+            uint64_t totalSize = 0;
+            for (uint32_t j = 0; j < CHUNK_COUNT; ++j)
+            {
+                if ((includeData || j != CHUNK_DATA) && chunks.chunks[j].offset && chunks.IsComplete(static_cast<CHUNK_INDEX>(j)))
+                {
+                    totalSize += (uint64_t(chunks.chunks[j].size) + 3) & ~uint64_t(3);
+                }
+            }
+
+            if (totalSize > SIZE_MAX)
+                return Status::OutOfMemory;
+
+            buffer.reset(new (std::nothrow) uint8_t[std::max<size_t>(static_cast<size_t>(totalSize), 1)]);
+            if (!buffer)
+                return Status::OutOfMemory;
+
+            uint8_t* ptr = buffer.get();
+            for (uint32_t j = 0; j < CHUNK_COUNT; ++j)
+            {
+                if (j == CHUNK_DATA)
+                    continue;
+
+                Chunk& chunk = chunks.chunks[j];
+                if (chunk.offset && chunks.IsComplete(static_cast<CHUNK_INDEX>(j)))
+                {
+                    if (!source.Read(chunk.offset, ptr, chunk.size))
+                        return Status::ReadFailed;
+
+                    chunk.data = ptr;
+                    ptr += (size_t(chunk.size) + 3) & ~size_t(3);
+                }
+            }
+
+            Chunk& dataChunk = chunks.chunks[CHUNK_DATA];
+            if (includeData && dataChunk.offset && chunks.IsComplete(CHUNK_DATA))
+            {
+                if (!source.Read(dataChunk.offset, ptr, dataChunk.size))
+                    return Status::ReadFailed;
+
+                dataChunk.data = ptr;
+            }
+
+            return Status::Ok;
+        }
+
+        //--------------------------------------------------------------------------------
+        // Returns the first forward loop from the 'wsmp' chunk, else from the 'smpl' chunk.
+        inline Status FindLoopInfo(const Chunks& chunks, _Out_ uint32_t& loopStart, _Out_ uint32_t& loopLength) noexcept
+        {
+            loopStart = 0;
+            loopLength = 0;
+
+            if (chunks.riff == FOURCC_XWMA_FILE_TAG)
+            {
+                // xWMA files do not contain loop information
+                return Status::Ok;
+            }
+
+            // 'wsmp' (DLS Chunk)
+            const Chunk& dlsChunk = chunks.chunks[CHUNK_DLS_SAMPLE];
+            if (dlsChunk.offset)
+            {
+                if (!chunks.IsComplete(CHUNK_DLS_SAMPLE))
+                    return Status::EndOfFile;
+
+                if (dlsChunk.size >= sizeof(RIFFDLSSample))
+                {
+                    auto dlsSample = reinterpret_cast<const RIFFDLSSample*>(dlsChunk.data);
+
+                    if (dlsChunk.size >= (uint64_t(dlsSample->size) + uint64_t(dlsSample->loopCount) * sizeof(DLSLoop)))
+                    {
+                        auto loops = reinterpret_cast<const DLSLoop*>(dlsChunk.data + dlsSample->size);
+                        for (uint32_t j = 0; j < dlsSample->loopCount; ++j)
+                        {
+                            if ((loops[j].loopType == DLSLoop::LOOP_TYPE_FORWARD || loops[j].loopType == DLSLoop::LOOP_TYPE_RELEASE))
+                            {
+                                // Return 'forward' loop
+                                loopStart = loops[j].loopStart;
+                                loopLength = loops[j].loopLength;
+                                return Status::Ok;
+                            }
+                        }
+                    }
+                }
+            }
+
+            // 'smpl' (Sample Chunk)
+            const Chunk& midiChunk = chunks.chunks[CHUNK_MIDI_SAMPLE];
+            if (midiChunk.offset)
+            {
+                if (!chunks.IsComplete(CHUNK_MIDI_SAMPLE))
+                    return Status::EndOfFile;
+
+                if (midiChunk.size >= sizeof(RIFFMIDISample))
+                {
+                    auto midiSample = reinterpret_cast<const RIFFMIDISample*>(midiChunk.data);
+
+                    if (midiChunk.size >= (sizeof(RIFFMIDISample) + uint64_t(midiSample->loopCount) * sizeof(MIDILoop)))
+                    {
+                        auto loops = reinterpret_cast<const MIDILoop*>(midiChunk.data + sizeof(RIFFMIDISample));
+                        for (uint32_t j = 0; j < midiSample->loopCount; ++j)
+                        {
+                            if (loops[j].type == MIDILoop::LOOP_TYPE_FORWARD)
+                            {
+                                // Return 'forward' loop
+                                loopStart = loops[j].start;
+                                loopLength = loops[j].end - loops[j].start + 1;
+                                return Status::Ok;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return Status::Ok;
+        }
+
+        //--------------------------------------------------------------------------------
+        // Returns the 'dpds' or 'seek' table, or null if the file has none.
+        inline Status FindTable(
+            const Chunks& chunks,
+            CHUNK_INDEX index,
+            _Outptr_result_maybenull_ const uint32_t*& table,
+            _Out_ uint32_t& count) noexcept
+        {
+            table = nullptr;
+            count = 0;
+
+            const Chunk& tableChunk = chunks.chunks[index];
+            if (tableChunk.offset)
+            {
+                if (!chunks.IsComplete(index))
+                    return Status::EndOfFile;
+
+                if ((tableChunk.size % sizeof(uint32_t)) != 0)
+                    return Status::InvalidData;
+
+                table = reinterpret_cast<const uint32_t*>(tableChunk.data);
+                count = tableChunk.size / 4;
+            }
+
+            return Status::Ok;
+        }
+    }
+}
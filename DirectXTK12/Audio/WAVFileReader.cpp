@@ -13,202 +13,145 @@
 #include "pch.h"
 #include "PlatformHelpers.h"
 #include "WAVFileReader.h"
+#include "WAVChunkParser.h"
 
 using namespace DirectX;
+using namespace DirectX::WAVChunkParser;
 
 
 namespace
 {
-    //---------------------------------------------------------------------------------
-    // .WAV files
-    //---------------------------------------------------------------------------------
-    constexpr uint32_t FOURCC_RIFF_TAG = MAKEFOURCC('R', 'I', 'F', 'F');
-    constexpr uint32_t FOURCC_FORMAT_TAG = MAKEFOURCC('f', 'm', 't', ' ');
-    constexpr uint32_t FOURCC_DATA_TAG = MAKEFOURCC('d', 'a', 't', 'a');
-    constexpr uint32_t FOURCC_WAVE_FILE_TAG = MAKEFOURCC('W', 'A', 'V', 'E');
-    constexpr uint32_t FOURCC_XWMA_FILE_TAG = MAKEFOURCC('X', 'W', 'M', 'A');
-    constexpr uint32_t FOURCC_DLS_SAMPLE = MAKEFOURCC('w', 's', 'm', 'p');
-    constexpr uint32_t FOURCC_MIDI_SAMPLE = MAKEFOURCC('s', 'm', 'p', 'l');
-    constexpr uint32_t FOURCC_XWMA_DPDS = MAKEFOURCC('d', 'p', 'd', 's');
-    constexpr uint32_t FOURCC_XMA_SEEK = MAKEFOURCC('s', 'e', 'e', 'k');
-
     constexpr size_t SIZEOF_XMA2WAVEFORMATEX = 52;
 
     constexpr uint16_t MSADPCM_FORMAT_EXTRA_BYTES = 32;
 
-#pragma pack(push,1)
-    struct RIFFChunk
+    // Seekable file, keeping the error for the caller. The first few KB, where the headers of most files are,
+    // come from a single read.
+    class FileSource : public Source
     {
-        uint32_t tag;
-        uint32_t size;
-    };
+    public:
+        FileSource(_In_ HANDLE hFile, uint64_t size) noexcept :
+            mFile(hFile),
+            mSize(size),
+            mError(S_OK),
+            mPrefixBytes(0),
+            mPrefix{}
+        {
+        }
 
-    struct RIFFChunkHeader
-    {
-        uint32_t tag;
-        uint32_t size;
-        uint32_t riff;
-    };
+        HRESULT Initialize() noexcept
+        {
+            const auto bytes = static_cast<size_t>(std::min<uint64_t>(mSize, sizeof(mPrefix)));
+            if (!ReadAt(0, mPrefix, bytes))
+                return mError;
 
-    struct DLSLoop
-    {
-        static constexpr uint32_t LOOP_TYPE_FORWARD = 0x00000000;
-        static constexpr uint32_t LOOP_TYPE_RELEASE = 0x00000001;
+            mPrefixBytes = bytes;
+            return S_OK;
+        }
 
-        uint32_t size;
-        uint32_t loopType;
-        uint32_t loopStart;
-        uint32_t loopLength;
-    };
+        uint64_t GetSize() const noexcept override { return mSize; }
 
-    struct RIFFDLSSample
-    {
-        static constexpr uint32_t OPTIONS_NOTRUNCATION = 0x00000001;
-        static constexpr uint32_t OPTIONS_NOCOMPRESSION = 0x00000002;
-
-        uint32_t    size;
-        uint16_t    unityNote;
-        int16_t     fineTune;
-        int32_t     gain;
-        uint32_t    options;
-        uint32_t    loopCount;
-    };
+        bool Read(uint64_t offset, void* buffer, size_t size) noexcept override
+        {
+            if (offset > mSize || size > mSize - offset)
+            {
+                mError = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                return false;
+            }
 
-    struct MIDILoop
-    {
-        static constexpr uint32_t LOOP_TYPE_FORWARD = 0x00000000;
-        static constexpr uint32_t LOOP_TYPE_ALTERNATING = 0x00000001;
-        static constexpr uint32_t LOOP_TYPE_BACKWARD = 0x00000002;
-
-        uint32_t cuePointId;
-        uint32_t type;
-        uint32_t start;
-        uint32_t end;
-        uint32_t fraction;
-        uint32_t playCount;
-    };
+            if (offset + size <= mPrefixBytes)
+            {
+                memcpy(buffer, mPrefix + offset, size);
+                return true;
+            }
 
-    struct RIFFMIDISample
-    {
-        uint32_t        manufacturerId;
-        uint32_t        productId;
-        uint32_t        samplePeriod;
-        uint32_t        unityNode;
-        uint32_t        pitchFraction;
-        uint32_t        SMPTEFormat;
-        uint32_t        SMPTEOffset;
-        uint32_t        loopCount;
-        uint32_t        samplerData;
-    };
-#pragma pack(pop)
+            return ReadAt(offset, buffer, size);
+        }
 
-    static_assert(sizeof(RIFFChunk) == 8, "structure size mismatch");
-    static_assert(sizeof(RIFFChunkHeader) == 12, "structure size mismatch");
-    static_assert(sizeof(DLSLoop) == 16, "structure size mismatch");
-    static_assert(sizeof(RIFFDLSSample) == 20, "structure size mismatch");
-    static_assert(sizeof(MIDILoop) == 24, "structure size mismatch");
-    static_assert(sizeof(RIFFMIDISample) == 36, "structure size mismatch");
+        HRESULT GetError() const noexcept { return mError; }
 
-    //---------------------------------------------------------------------------------
-    const RIFFChunk* FindChunk(
-        _In_reads_bytes_(sizeBytes) const uint8_t* data,
-        _In_ size_t sizeBytes,
-        _In_ const uint8_t* upperBound,
-        _In_ uint32_t tag) noexcept
-    {
-        if (!data)
-            return nullptr;
+    private:
+        // Works for handles opened with or without FILE_FLAG_OVERLAPPED
+        bool ReadAt(uint64_t offset, _Out_writes_bytes_(size) void* buffer, size_t size) noexcept
+        {
+            if (size > UINT32_MAX)
+            {
+                mError = HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+                return false;
+            }
 
-        if (sizeBytes < sizeof(RIFFChunk))
-            return nullptr;
+            OVERLAPPED request = {};
+            request.Offset = static_cast<DWORD>(offset);
+            request.OffsetHigh = static_cast<DWORD>(offset >> 32);
 
-        const uint8_t* ptr = data;
-        const uint8_t* end = data + sizeBytes;
+            if (!ReadFile(mFile, buffer, static_cast<DWORD>(size), nullptr, &request))
+            {
+                const DWORD error = GetLastError();
+                if (error != ERROR_IO_PENDING)
+                {
+                    mError = HRESULT_FROM_WIN32(error);
+                    return false;
+                }
+            }
 
-        while (end > (ptr + sizeof(RIFFChunk)))
-        {
-            auto header = reinterpret_cast<const RIFFChunk*>(ptr);
-            if (header->tag == tag)
-                return header;
+            DWORD bytesRead = 0;
+            if (!GetOverlappedResult(mFile, &request, &bytesRead, TRUE))
+            {
+                mError = HRESULT_FROM_WIN32(GetLastError());
+                return false;
+            }
 
-            const uint64_t offset = static_cast<uint64_t>(header->size) + sizeof(RIFFChunk);
-            if (offset >= UINT32_MAX)
-                return nullptr;
+            if (bytesRead != size)
+            {
+                mError = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                return false;
+            }
+
+            return true;
+        }
 
-            ptr += static_cast<size_t>(offset);
+        HANDLE      mFile;
+        uint64_t    mSize;
+        HRESULT     mError;
+        size_t      mPrefixBytes;
+        uint8_t     mPrefix[4096];
+    };
 
-            if (ptr >= upperBound)
-                return nullptr;
+    HRESULT ToHRESULT(Status status) noexcept
+    {
+        switch (status)
+        {
+        case Status::Ok:            return S_OK;
+        case Status::ReadFailed:    return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        case Status::EndOfFile:     return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        case Status::OutOfMemory:   return E_OUTOFMEMORY;
+        default:                    return E_FAIL;
         }
+    }
 
-        return nullptr;
+    HRESULT ToHRESULT(Status status, const FileSource& source) noexcept
+    {
+        if (status == Status::ReadFailed && FAILED(source.GetError()))
+            return source.GetError();
+
+        return ToHRESULT(status);
     }
 
 
     //---------------------------------------------------------------------------------
-    HRESULT WaveFindFormatAndData(
-        _In_reads_bytes_(wavDataSize) const uint8_t* wavData,
-        _In_ size_t wavDataSize,
-        _Outptr_ const WAVEFORMATEX** pwfx,
-        _Outptr_ const uint8_t** pdata,
-        _Out_ uint32_t* dataSize,
+    HRESULT WaveValidateFormat(
+        _In_reads_bytes_(fmtSize) const uint8_t* ptr,
+        _In_ uint32_t fmtSize,
         _Out_ bool& dpds,
         _Out_ bool& seek) noexcept
     {
-        if (!wavData || !pwfx)
-            return E_POINTER;
-
         dpds = seek = false;
 
-        if (wavDataSize < (sizeof(RIFFChunk) * 2 + sizeof(uint32_t) + sizeof(WAVEFORMAT)))
-        {
-            return E_FAIL;
-        }
-
-        const uint8_t* wavEnd = wavData + wavDataSize;
-
-        // Locate RIFF 'WAVE'
-        auto riffChunk = FindChunk(wavData, wavDataSize, wavEnd, FOURCC_RIFF_TAG);
-        if (!riffChunk || riffChunk->size < 4)
-        {
-            return E_FAIL;
-        }
-
-        if ((reinterpret_cast<const uint8_t*>(riffChunk) + sizeof(RIFFChunkHeader)) > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        auto riffHeader = reinterpret_cast<const RIFFChunkHeader*>(riffChunk);
-        if (riffHeader->riff != FOURCC_WAVE_FILE_TAG && riffHeader->riff != FOURCC_XWMA_FILE_TAG)
+        if (fmtSize < sizeof(PCMWAVEFORMAT))
         {
             return E_FAIL;
         }
 
-        // Locate 'fmt '
-        auto ptr = reinterpret_cast<const uint8_t*>(riffHeader) + sizeof(RIFFChunkHeader);
-        if ((ptr + sizeof(RIFFChunk)) > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        auto fmtChunk = FindChunk(ptr, riffHeader->size, wavEnd, FOURCC_FORMAT_TAG);
-        if (!fmtChunk || fmtChunk->size < sizeof(PCMWAVEFORMAT))
-        {
-            return E_FAIL;
-        }
-
-        ptr = reinterpret_cast<const uint8_t*>(fmtChunk) + sizeof(RIFFChunk);
-        if (ptr + fmtChunk->size > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        if ((ptr + sizeof(PCMWAVEFORMAT)) > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
         auto wf = reinterpret_cast<const WAVEFORMAT*>(ptr);
 
         // Validate WAVEFORMAT (focused on chunk size and format tag, not other data that XAUDIO2 will validate)
@@ -222,28 +165,18 @@ namespace
 
         default:
             {
-                if (fmtChunk->size < sizeof(WAVEFORMATEX))
+                if (fmtSize < sizeof(WAVEFORMATEX))
                 {
                     return E_FAIL;
                 }
 
-                if ((ptr + sizeof(WAVEFORMATEX)) > wavEnd)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                }
-
                 auto wfx = reinterpret_cast<const WAVEFORMATEX*>(ptr);
 
-                if (fmtChunk->size < (sizeof(WAVEFORMATEX) + wfx->cbSize))
+                if (fmtSize < (sizeof(WAVEFORMATEX) + wfx->cbSize))
                 {
                     return E_FAIL;
                 }
 
-                if ((ptr + (sizeof(WAVEFORMATEX) + wfx->cbSize)) > wavEnd)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                }
-
                 switch (wfx->wFormatTag)
                 {
                 case WAVE_FORMAT_WMAUDIO2:
@@ -252,33 +185,23 @@ namespace
                     break;
 
                 case  0x166 /*WAVE_FORMAT_XMA2*/: // XMA2 is supported by Xbox One & Xbox Series X|S
-                    if ((fmtChunk->size < SIZEOF_XMA2WAVEFORMATEX) || (wfx->cbSize < (SIZEOF_XMA2WAVEFORMATEX - sizeof(WAVEFORMATEX))))
+                    if ((fmtSize < SIZEOF_XMA2WAVEFORMATEX) || (wfx->cbSize < (SIZEOF_XMA2WAVEFORMATEX - sizeof(WAVEFORMATEX))))
                     {
                         return E_FAIL;
                     }
 
-                    if ((ptr + SIZEOF_XMA2WAVEFORMATEX) > wavEnd)
-                    {
-                        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                    }
-
                     seek = true;
                     break;
 
                 case WAVE_FORMAT_ADPCM:
-                    if ((fmtChunk->size < (sizeof(WAVEFORMATEX) + MSADPCM_FORMAT_EXTRA_BYTES)) || (wfx->cbSize < MSADPCM_FORMAT_EXTRA_BYTES))
+                    if ((fmtSize < (sizeof(WAVEFORMATEX) + MSADPCM_FORMAT_EXTRA_BYTES)) || (wfx->cbSize < MSADPCM_FORMAT_EXTRA_BYTES))
                     {
                         return E_FAIL;
                     }
-
-                    if ((ptr + sizeof(WAVEFORMATEX) + MSADPCM_FORMAT_EXTRA_BYTES) > wavEnd)
-                    {
-                        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                    }
                     break;
 
                 case WAVE_FORMAT_EXTENSIBLE:
-                    if ((fmtChunk->size < sizeof(WAVEFORMATEXTENSIBLE)) || (wfx->cbSize < (sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX))))
+                    if ((fmtSize < sizeof(WAVEFORMATEXTENSIBLE)) || (wfx->cbSize < (sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX))))
                     {
                         return E_FAIL;
                     }
@@ -286,11 +209,6 @@ namespace
                     {
                         static const GUID s_wfexBase = { 0x00000000, 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 } };
 
-                        if ((ptr + sizeof(WAVEFORMATEXTENSIBLE)) > wavEnd)
-                        {
-                            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                        }
-
                         auto wfex = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(ptr);
 
                         if (memcmp(reinterpret_cast<const BYTE*>(&wfex->SubFormat) + sizeof(DWORD),
@@ -325,214 +243,110 @@ namespace
             }
         }
 
-        // Locate 'data'
-        ptr = reinterpret_cast<const uint8_t*>(riffHeader) + sizeof(RIFFChunkHeader);
-        if ((ptr + sizeof(RIFFChunk)) > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        auto dataChunk = FindChunk(ptr, riffChunk->size, wavEnd, FOURCC_DATA_TAG);
-        if (!dataChunk || !dataChunk->size)
-        {
-            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-        }
-
-        ptr = reinterpret_cast<const uint8_t*>(dataChunk) + sizeof(RIFFChunk);
-        if (ptr + dataChunk->size > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        *pwfx = reinterpret_cast<const WAVEFORMATEX*>(wf);
-        *pdata = ptr;
-        *dataSize = dataChunk->size;
         return S_OK;
     }
 
 
     //---------------------------------------------------------------------------------
-    HRESULT WaveFindLoopInfo(
-        _In_reads_bytes_(wavDataSize) const uint8_t* wavData,
-        _In_ size_t wavDataSize,
-        _Out_ uint32_t* pLoopStart,
-        _Out_ uint32_t* pLoopLength) noexcept
+    // Fills in result from chunks whose bodies are available (other than 'data', which
+    // may be left unloaded). Loop points and seek tables are only needed for the Ex functions.
+    HRESULT WaveParseChunks(
+        const Chunks& chunks,
+        bool loopsAndTables,
+        _Out_ WAVData& result,
+        _Out_ bool& dpds,
+        _Out_ bool& seek) noexcept
     {
-        if (!wavData || !pLoopStart || !pLoopLength)
-            return E_POINTER;
+        dpds = seek = false;
 
-        if (wavDataSize < (sizeof(RIFFChunk) + sizeof(uint32_t)))
+        const Chunk& fmtChunk = chunks.chunks[CHUNK_FORMAT];
+        if (!fmtChunk.offset || fmtChunk.size < sizeof(PCMWAVEFORMAT))
         {
             return E_FAIL;
         }
 
-        *pLoopStart = 0;
-        *pLoopLength = 0;
-
-        const uint8_t* wavEnd = wavData + wavDataSize;
-
-        // Locate RIFF 'WAVE'
-        auto riffChunk = FindChunk(wavData, wavDataSize, wavEnd, FOURCC_RIFF_TAG);
-        if (!riffChunk || riffChunk->size < 4)
+        if (!chunks.IsComplete(CHUNK_FORMAT))
         {
-            return E_FAIL;
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
         }
 
-        auto riffHeader = reinterpret_cast<const RIFFChunkHeader*>(riffChunk);
-        if (riffHeader->riff == FOURCC_XWMA_FILE_TAG)
-        {
-            // xWMA files do not contain loop information
-            return S_OK;
-        }
+        HRESULT hr = WaveValidateFormat(fmtChunk.data, fmtChunk.size, dpds, seek);
+        if (FAILED(hr))
+            return hr;
 
-        if (riffHeader->riff != FOURCC_WAVE_FILE_TAG)
+        const Chunk& dataChunk = chunks.chunks[CHUNK_DATA];
+        if (!dataChunk.offset || !dataChunk.size)
         {
-            return E_FAIL;
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
         }
 
-        // Locate 'wsmp' (DLS Chunk)
-        auto ptr = reinterpret_cast<const uint8_t*>(riffHeader) + sizeof(RIFFChunkHeader);
-        if ((ptr + sizeof(RIFFChunk)) > wavEnd)
+        if (!chunks.IsComplete(CHUNK_DATA))
         {
             return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
         }
 
-        auto dlsChunk = FindChunk(ptr, riffChunk->size, wavEnd, FOURCC_DLS_SAMPLE);
-        if (dlsChunk)
-        {
-            ptr = reinterpret_cast<const uint8_t*>(dlsChunk) + sizeof(RIFFChunk);
-            if (ptr + dlsChunk->size > wavEnd)
-            {
-                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-            }
+        result.wfx = reinterpret_cast<const WAVEFORMATEX*>(fmtChunk.data);
+        result.startAudio = dataChunk.data;
+        result.audioBytes = dataChunk.size;
+        result.dataOffset = dataChunk.offset;
 
-            if (dlsChunk->size >= sizeof(RIFFDLSSample))
-            {
-                auto dlsSample = reinterpret_cast<const RIFFDLSSample*>(ptr);
-
-                if (dlsChunk->size >= (dlsSample->size + dlsSample->loopCount * sizeof(DLSLoop)))
-                {
-                    auto loops = reinterpret_cast<const DLSLoop*>(ptr + dlsSample->size);
-                    for (uint32_t j = 0; j < dlsSample->loopCount; ++j)
-                    {
-                        if ((loops[j].loopType == DLSLoop::LOOP_TYPE_FORWARD || loops[j].loopType == DLSLoop::LOOP_TYPE_RELEASE))
-                        {
-                            // Return 'forward' loop
-                            *pLoopStart = loops[j].loopStart;
-                            *pLoopLength = loops[j].loopLength;
-                            return S_OK;
-                        }
-                    }
-                }
-            }
-        }
+        if (!loopsAndTables)
+            return S_OK;
 
-        // Locate 'smpl' (Sample Chunk)
-        auto midiChunk = FindChunk(ptr, riffChunk->size, wavEnd, FOURCC_MIDI_SAMPLE);
-        if (midiChunk)
+        Status status = FindLoopInfo(chunks, result.loopStart, result.loopLength);
+        if (status == Status::Ok)
         {
-            ptr = reinterpret_cast<const uint8_t*>(midiChunk) + sizeof(RIFFChunk);
-            if (ptr + midiChunk->size > wavEnd)
+            if (dpds)
             {
-                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                status = FindTable(chunks, CHUNK_XWMA_DPDS, result.seek, result.seekCount);
             }
-
-            if (midiChunk->size >= sizeof(RIFFMIDISample))
+            else if (seek)
             {
-                auto midiSample = reinterpret_cast<const RIFFMIDISample*>(ptr);
-
-                if (midiChunk->size >= (sizeof(RIFFMIDISample) + midiSample->loopCount * sizeof(MIDILoop)))
-                {
-                    auto loops = reinterpret_cast<const MIDILoop*>(ptr + sizeof(RIFFMIDISample));
-                    for (uint32_t j = 0; j < midiSample->loopCount; ++j)
-                    {
-                        if (loops[j].type == MIDILoop::LOOP_TYPE_FORWARD)
-                        {
-                            // Return 'forward' loop
-                            *pLoopStart = loops[j].start;
-                            *pLoopLength = loops[j].end - loops[j].start + 1;
-                            return S_OK;
-                        }
-                    }
-                }
+                status = FindTable(chunks, CHUNK_XMA_SEEK, result.seek, result.seekCount);
             }
         }
 
-        return S_OK;
+        return ToHRESULT(status);
     }
 
 
     //---------------------------------------------------------------------------------
-    HRESULT WaveFindTable(
+    HRESULT WaveParseInMemory(
         _In_reads_bytes_(wavDataSize) const uint8_t* wavData,
         _In_ size_t wavDataSize,
-        _In_ uint32_t tag,
-        _Outptr_result_maybenull_ const uint32_t** pData,
-        _Out_ uint32_t* dataCount) noexcept
+        bool loopsAndTables,
+        _Out_ WAVData& result,
+        _Out_ bool& dpds,
+        _Out_ bool& seek) noexcept
     {
-        if (!wavData || !pData || !dataCount)
-            return E_POINTER;
-
-        if (wavDataSize < (sizeof(RIFFChunk) + sizeof(uint32_t)))
-        {
-            return E_FAIL;
-        }
-
-        *pData = nullptr;
-        *dataCount = 0;
-
-        const uint8_t* wavEnd = wavData + wavDataSize;
-
-        // Locate RIFF 'WAVE'
-        auto riffChunk = FindChunk(wavData, wavDataSize, wavEnd, FOURCC_RIFF_TAG);
-        if (!riffChunk || riffChunk->size < 4)
-        {
-            return E_FAIL;
-        }
-
-        auto riffHeader = reinterpret_cast<const RIFFChunkHeader*>(riffChunk);
-        if (riffHeader->riff != FOURCC_WAVE_FILE_TAG && riffHeader->riff != FOURCC_XWMA_FILE_TAG)
-        {
-            return E_FAIL;
-        }
-
-        // Locate tag
-        auto ptr = reinterpret_cast<const uint8_t*>(riffHeader) + sizeof(RIFFChunkHeader);
-        if ((ptr + sizeof(RIFFChunk)) > wavEnd)
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
+        dpds = seek = false;
 
-        auto tableChunk = FindChunk(ptr, riffChunk->size, wavEnd, tag);
-        if (tableChunk)
-        {
-            ptr = reinterpret_cast<const uint8_t*>(tableChunk) + sizeof(RIFFChunk);
-            if (ptr + tableChunk->size > wavEnd)
-            {
-                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-            }
+        MemorySource source(wavData, wavDataSize);
 
-            if ((tableChunk->size % sizeof(uint32_t)) != 0)
-            {
-                return E_FAIL;
-            }
+        Chunks chunks;
+        const Status status = FindChunks(source, chunks);
+        if (status != Status::Ok)
+            return ToHRESULT(status);
 
-            *pData = reinterpret_cast<const uint32_t*>(ptr);
-            *dataCount = tableChunk->size / 4;
-        }
+        // Everything is already in memory, so results point straight into the file image
+        MapChunks(wavData, wavDataSize, chunks);
 
-        return S_OK;
+        return WaveParseChunks(chunks, loopsAndTables, result, dpds, seek);
     }
 
 
     //---------------------------------------------------------------------------------
-    HRESULT LoadAudioFromFile(
+    // Reads only the chunks that WaveParseChunks uses, so large metadata chunks and
+    // anything past the audio are never read.
+    HRESULT WaveParseFromFile(
         _In_z_ const wchar_t* szFileName,
+        bool loopsAndTables,
         _Inout_ std::unique_ptr<uint8_t[]>& wavData,
-        _Out_ DWORD* bytesRead) noexcept
+        _Out_ WAVData& result,
+        _Out_ bool& dpds,
+        _Out_ bool& seek) noexcept
     {
-        if (!szFileName)
-            return E_INVALIDARG;
+        dpds = seek = false;
 
         // open the file
     #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
@@ -561,37 +375,22 @@ namespace
             return HRESULT_FROM_WIN32(GetLastError());
         }
 
-        // File is too big for 32-bit allocation, so reject read
-        if (fileInfo.EndOfFile.HighPart > 0)
-        {
-            return E_FAIL;
-        }
-
-        // Need at least enough data to have a valid minimal WAV file
-        if (fileInfo.EndOfFile.LowPart < (sizeof(RIFFChunk) * 2 + sizeof(DWORD) + sizeof(WAVEFORMAT)))
-        {
-            return E_FAIL;
-        }
+        FileSource source(hFile.get(), static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart));
+        HRESULT hr = source.Initialize();
+        if (FAILED(hr))
+            return hr;
 
-        // create enough space for the file data
-        wavData.reset(new (std::nothrow) uint8_t[fileInfo.EndOfFile.LowPart]);
-        if (!wavData)
+        Chunks chunks;
+        Status status = FindChunks(source, chunks);
+        if (status == Status::Ok)
         {
-            return E_OUTOFMEMORY;
+            status = LoadChunks(source, true, wavData, chunks);
         }
 
-        // read the data in
-        if (!ReadFile(hFile.get(),
-            wavData.get(),
-            fileInfo.EndOfFile.LowPart,
-            bytesRead,
-            nullptr
-        ))
-        {
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
+        if (status != Status::Ok)
+            return ToHRESULT(status, source);
 
-        return (*bytesRead < fileInfo.EndOfFile.LowPart) ? E_FAIL : S_OK;
+        return WaveParseChunks(chunks, loopsAndTables, result, dpds, seek);
     }
 }
 
@@ -611,17 +410,16 @@ HRESULT DirectX::LoadWAVAudioInMemory(
     *startAudio = nullptr;
     *audioBytes = 0;
 
-    // Need at least enough data to have a valid minimal WAV file
-    if (wavDataSize < (sizeof(RIFFChunk) * 2 + sizeof(DWORD) + sizeof(WAVEFORMAT)))
-    {
-        return E_FAIL;
-    }
-
+    WAVData result = {};
     bool dpds, seek;
-    HRESULT hr = WaveFindFormatAndData(wavData, wavDataSize, wfx, startAudio, audioBytes, dpds, seek);
+    HRESULT hr = WaveParseInMemory(wavData, wavDataSize, false, result, dpds, seek);
     if (FAILED(hr))
         return hr;
 
+    *wfx = result.wfx;
+    *startAudio = result.startAudio;
+    *audioBytes = result.audioBytes;
+
     return (dpds || seek) ? E_FAIL : S_OK;
 }
 
@@ -642,18 +440,16 @@ HRESULT DirectX::LoadWAVAudioFromFile(
     *startAudio = nullptr;
     *audioBytes = 0;
 
-    DWORD bytesRead = 0;
-    HRESULT hr = LoadAudioFromFile(szFileName, wavData, &bytesRead);
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
+    WAVData result = {};
     bool dpds, seek;
-    hr = WaveFindFormatAndData(wavData.get(), bytesRead, wfx, startAudio, audioBytes, dpds, seek);
+    HRESULT hr = WaveParseFromFile(szFileName, false, wavData, result, dpds, seek);
     if (FAILED(hr))
         return hr;
 
+    *wfx = result.wfx;
+    *startAudio = result.startAudio;
+    *audioBytes = result.audioBytes;
+
     return (dpds || seek) ? E_FAIL : S_OK;
 }
 
@@ -670,35 +466,8 @@ HRESULT DirectX::LoadWAVAudioInMemoryEx(
 
     memset(&result, 0, sizeof(result));
 
-    // Need at least enough data to have a valid minimal WAV file
-    if (wavDataSize < (sizeof(RIFFChunk) * 2 + sizeof(DWORD) + sizeof(WAVEFORMAT)))
-    {
-        return E_FAIL;
-    }
-
     bool dpds, seek;
-    HRESULT hr = WaveFindFormatAndData(wavData, wavDataSize, &result.wfx, &result.startAudio, &result.audioBytes, dpds, seek);
-    if (FAILED(hr))
-        return hr;
-
-    hr = WaveFindLoopInfo(wavData, wavDataSize, &result.loopStart, &result.loopLength);
-    if (FAILED(hr))
-        return hr;
-
-    if (dpds)
-    {
-        hr = WaveFindTable(wavData, wavDataSize, FOURCC_XWMA_DPDS, &result.seek, &result.seekCount);
-        if (FAILED(hr))
-            return hr;
-    }
-    else if (seek)
-    {
-        hr = WaveFindTable(wavData, wavDataSize, FOURCC_XMA_SEEK, &result.seek, &result.seekCount);
-        if (FAILED(hr))
-            return hr;
-    }
-
-    return S_OK;
+    return WaveParseInMemory(wavData, wavDataSize, true, result, dpds, seek);
 }
 
 
@@ -714,34 +483,6 @@ HRESULT DirectX::LoadWAVAudioFromFileEx(
 
     memset(&result, 0, sizeof(result));
 
-    DWORD bytesRead = 0;
-    HRESULT hr = LoadAudioFromFile(szFileName, wavData, &bytesRead);
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
     bool dpds, seek;
-    hr = WaveFindFormatAndData(wavData.get(), bytesRead, &result.wfx, &result.startAudio, &result.audioBytes, dpds, seek);
-    if (FAILED(hr))
-        return hr;
-
-    hr = WaveFindLoopInfo(wavData.get(), bytesRead, &result.loopStart, &result.loopLength);
-    if (FAILED(hr))
-        return hr;
-
-    if (dpds)
-    {
-        hr = WaveFindTable(wavData.get(), bytesRead, FOURCC_XWMA_DPDS, &result.seek, &result.seekCount);
-        if (FAILED(hr))
-            return hr;
-    }
-    else if (seek)
-    {
-        hr = WaveFindTable(wavData.get(), bytesRead, FOURCC_XMA_SEEK, &result.seek, &result.seekCount);
-        if (FAILED(hr))
-            return hr;
-    }
-
-    return S_OK;
+    return WaveParseFromFile(szFileName, true, wavData, result, dpds, seek);
 }
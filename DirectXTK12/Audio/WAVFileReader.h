@@ -28,6 +28,8 @@ namespace DirectX
         _Outptr_ const uint8_t** startAudio,
         _Out_ uint32_t* audioBytes) noexcept;
 
+    // The FromFile functions read only the format, data, loop, and seek table chunks; other chunks are skipped.
+    // wavData holds those chunk bodies rather than the whole file.
     HRESULT LoadWAVAudioFromFile(
         _In_z_ const wchar_t* szFileName,
         _Inout_ std::unique_ptr<uint8_t[]>& wavData,
@@ -44,6 +46,7 @@ namespace DirectX
         uint32_t loopLength;
         const uint32_t* seek;       // Note: XMA Seek data is Big-Endian
         uint32_t seekCount;
+        uint64_t dataOffset;        // Offset of the audio data from the start of the file
     };
 
     HRESULT LoadWAVAudioInMemoryEx(
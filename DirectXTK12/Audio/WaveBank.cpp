@@ -12,6 +12,8 @@
 #include "Audio.h"
 #include "WaveBankReader.h"
 #include "SoundCommon.h"
+#include "ADPCMDecoder.h"
+#include "ParallelHelpers.h"
 #include "PlatformHelpers.h"
 
 #include <list>
@@ -31,7 +33,8 @@ public:
         mEngine(engine),
         mOneShots(0),
         mPrepared(false),
-        mStreaming(false)
+        mStreaming(false),
+        mDecodedBytes(0)
     {
         assert(mEngine != nullptr);
         mEngine->RegisterNotify(this, false);
@@ -72,7 +75,16 @@ public:
         }
     }
 
-    HRESULT Initialize(_In_ const AudioEngine* engine, _In_z_ const wchar_t* wbFileName) noexcept;
+    HRESULT Initialize(_In_ const AudioEngine* engine, _In_z_ const wchar_t* wbFileName, WAVE_BANK_FLAGS flags) noexcept;
+
+    void PrewarmVoices();
+
+    void DecompressADPCM();
+
+    // Reader accessors that substitute the PCM copy for entries decompressed by DecompressADPCM
+    HRESULT GetFormat(uint32_t index, _Out_writes_bytes_(maxsize) WAVEFORMATEX* wfx, size_t maxsize) const noexcept;
+    HRESULT GetWaveData(uint32_t index, _Outptr_ const uint8_t** pData, _Out_ uint32_t& dataSize) const noexcept;
+    HRESULT GetMetadata(uint32_t index, _Out_ WaveBankReader::Metadata& metadata) const noexcept;
 
     void Play(unsigned int index, float volume, float pitch, float pan);
 
@@ -115,7 +127,7 @@ public:
 
         if (!mStreaming)
         {
-            stats.audioBytes += mReader.BankAudioSize();
+            stats.audioBytes += mReader.BankAudioSize() + mDecodedBytes;
 
         #ifdef DIRECTX_ENABLE_XMA2
             if (mReader.HasXMA())
@@ -128,22 +140,31 @@ public:
     {
     }
 
+    struct DecodedWave
+    {
+        std::unique_ptr<int16_t[]>  data;
+        uint32_t                    dataSize;
+        WAVEFORMATEX                wfx;
+    };
+
     AudioEngine*                        mEngine;
     std::list<IVoiceNotify*>            mInstances;
     WaveBankReader                      mReader;
     uint32_t                            mOneShots;
     bool                                mPrepared;
     bool                                mStreaming;
+    std::vector<DecodedWave>            mDecoded;       // Indexed by entry; empty until DecompressADPCM is called
+    size_t                              mDecodedBytes;
 };
 
 
 _Use_decl_annotations_
-HRESULT WaveBank::Impl::Initialize(const AudioEngine* engine, const wchar_t* wbFileName) noexcept
+HRESULT WaveBank::Impl::Initialize(const AudioEngine* engine, const wchar_t* wbFileName, WAVE_BANK_FLAGS flags) noexcept
 {
     if (!engine || !wbFileName)
         return E_INVALIDARG;
 
-    HRESULT hr = mReader.Open(wbFileName);
+    HRESULT hr = mReader.Open(wbFileName, (flags & WaveBank_MemoryMapped) != 0);
     if (FAILED(hr))
         return hr;
 
@@ -153,6 +174,203 @@ HRESULT WaveBank::Impl::Initialize(const AudioEngine* engine, const wchar_t* wbF
 }
 
 
+void WaveBank::Impl::PrewarmVoices()
+{
+    // Only in-memory banks play one-shots; the engine skips formats that are already warm
+    if (mStreaming || !mEngine)
+        return;
+
+    const uint32_t count = mReader.Count();
+    for (uint32_t j = 0; j < count; ++j)
+    {
+        char wfxbuff[64] = {};
+        auto wfx = reinterpret_cast<WAVEFORMATEX*>(wfxbuff);
+        if (SUCCEEDED(GetFormat(j, wfx, sizeof(wfxbuff))))
+        {
+            mEngine->PrewarmVoices(wfx);
+        }
+    }
+}
+
+
+void WaveBank::Impl::DecompressADPCM()
+{
+    if (mStreaming)
+    {
+        DebugTrace("ERROR: Only in-memory wave banks can be decompressed\n");
+        throw std::runtime_error("WaveBank::DecompressADPCM");
+    }
+
+    if (mOneShots > 0 || !mInstances.empty())
+    {
+        DebugTrace("ERROR: WaveBank \"%hs\" cannot be decompressed while it is in use\n", mReader.BankName());
+        throw std::runtime_error("WaveBank::DecompressADPCM");
+    }
+
+    if (!mDecoded.empty())
+        return;
+
+    if (!mPrepared)
+    {
+        mReader.WaitOnPrepare();
+        mPrepared = true;
+    }
+
+    struct DecodeRange
+    {
+        const uint8_t*                          source;
+        size_t                                  firstBlock;     // Offset of this entry in the bank-wide block range
+        size_t                                  blockCount;
+        uint32_t                                blockAlign;
+        uint32_t                                channels;
+        uint32_t                                samplesPerBlock;
+        std::vector<ADPCMDecoder::Coefficients> coefs;
+        int16_t*                                dest;
+    };
+
+    const uint32_t count = mReader.Count();
+    std::vector<DecodedWave> decoded(count);
+    std::vector<DecodeRange> ranges;
+    size_t totalBlocks = 0;
+    size_t totalBytes = 0;
+
+    for (uint32_t j = 0; j < count; ++j)
+    {
+        char wfxbuff[64] = {};
+        auto wfx = reinterpret_cast<WAVEFORMATEX*>(wfxbuff);
+        HRESULT hr = mReader.GetFormat(j, wfx, sizeof(wfxbuff));
+        ThrowIfFailed(hr);
+
+        if (GetFormatTag(wfx) != WAVE_FORMAT_ADPCM)
+            continue;
+
+        const uint8_t* data = nullptr;
+        uint32_t dataSize = 0;
+        hr = mReader.GetWaveData(j, &data, dataSize);
+        ThrowIfFailed(hr);
+
+        const size_t blockCount = (wfx->nBlockAlign > 0) ? dataSize / wfx->nBlockAlign : 0;
+        if (!blockCount)
+            continue;
+
+        auto adpcmFmt = reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx);
+
+        DecodeRange range = {};
+        range.source = data;
+        range.firstBlock = totalBlocks;
+        range.blockCount = blockCount;
+        range.blockAlign = wfx->nBlockAlign;
+        range.channels = wfx->nChannels;
+        range.samplesPerBlock = adpcmFmt->wSamplesPerBlock;
+
+        auto coefs = reinterpret_cast<const ADPCMDecoder::Coefficients*>(adpcmFmt->aCoef);
+        range.coefs.assign(coefs, coefs + adpcmFmt->wNumCoef);
+
+        const uint64_t samples = uint64_t(range.blockCount) * range.samplesPerBlock * range.channels;
+        if (samples * sizeof(int16_t) > UINT32_MAX)
+            throw std::overflow_error("WaveBank::DecompressADPCM");
+
+        auto& entry = decoded[j];
+        entry.data.reset(new int16_t[static_cast<size_t>(samples)]);
+        entry.dataSize = static_cast<uint32_t>(samples * sizeof(int16_t));
+        CreateIntegerPCM(&entry.wfx, static_cast<int>(wfx->nSamplesPerSec), wfx->nChannels, 16);
+
+        range.dest = entry.data.get();
+        totalBlocks += range.blockCount;
+        totalBytes += entry.dataSize;
+
+        ranges.emplace_back(std::move(range));
+    }
+
+    if (ranges.empty())
+        return;
+
+    // Blocks decode independently, so split the whole bank rather than each entry to keep long waves from
+    // serializing on one thread
+    std::atomic<bool> failed(false);
+    ParallelHelpers::ParallelFor(totalBlocks, 256, [&](size_t begin, size_t end)
+        {
+            auto it = std::upper_bound(ranges.cbegin(), ranges.cend(), begin,
+                [](size_t block, const DecodeRange& range) noexcept { return block < range.firstBlock; }) - 1;
+
+            for (; begin < end; ++it)
+            {
+                const size_t first = begin - it->firstBlock;
+                const size_t blocks = std::min(end, it->firstBlock + it->blockCount) - begin;
+
+                if (!ADPCMDecoder::DecodeBlocks(it->source + first * it->blockAlign, blocks, it->blockAlign,
+                    it->channels, it->samplesPerBlock, it->coefs.data(), it->coefs.size(),
+                    it->dest + first * it->samplesPerBlock * it->channels))
+                {
+                    failed = true;
+                }
+
+                begin += blocks;
+            }
+        });
+
+    if (failed)
+    {
+        DebugTrace("ERROR: WaveBank \"%hs\" contains invalid ADPCM data\n", mReader.BankName());
+        throw std::runtime_error("WaveBank::DecompressADPCM");
+    }
+
+    mDecoded.swap(decoded);
+    mDecodedBytes = totalBytes;
+
+    DebugTrace("INFO: WaveBank \"%hs\" decompressed %zu ADPCM entries to %zu bytes of PCM\n",
+        mReader.BankName(), ranges.size(), totalBytes);
+
+    PrewarmVoices();
+}
+
+
+_Use_decl_annotations_
+HRESULT WaveBank::Impl::GetFormat(uint32_t index, WAVEFORMATEX* wfx, size_t maxsize) const noexcept
+{
+    if (index < mDecoded.size() && mDecoded[index].data)
+    {
+        if (!wfx || maxsize < sizeof(WAVEFORMATEX))
+            return E_INVALIDARG;
+
+        memcpy(wfx, &mDecoded[index].wfx, sizeof(WAVEFORMATEX));
+        return S_OK;
+    }
+
+    return mReader.GetFormat(index, wfx, maxsize);
+}
+
+
+_Use_decl_annotations_
+HRESULT WaveBank::Impl::GetWaveData(uint32_t index, const uint8_t** pData, uint32_t& dataSize) const noexcept
+{
+    if (index < mDecoded.size() && mDecoded[index].data)
+    {
+        if (!pData)
+            return E_INVALIDARG;
+
+        *pData = reinterpret_cast<const uint8_t*>(mDecoded[index].data.get());
+        dataSize = mDecoded[index].dataSize;
+        return S_OK;
+    }
+
+    return mReader.GetWaveData(index, pData, dataSize);
+}
+
+
+_Use_decl_annotations_
+HRESULT WaveBank::Impl::GetMetadata(uint32_t index, WaveBankReader::Metadata& metadata) const noexcept
+{
+    HRESULT hr = mReader.GetMetadata(index, metadata);
+    if (SUCCEEDED(hr) && index < mDecoded.size() && mDecoded[index].data)
+    {
+        metadata.lengthBytes = mDecoded[index].dataSize;
+    }
+
+    return hr;
+}
+
+
 void WaveBank::Impl::Play(unsigned int index, float volume, float pitch, float pan)
 {
     assert(volume >= -XAUDIO2_MAX_VOLUME_LEVEL && volume <= XAUDIO2_MAX_VOLUME_LEVEL);
@@ -180,7 +398,7 @@ void WaveBank::Impl::Play(unsigned int index, float volume, float pitch, float p
 
     char wfxbuff[64] = {};
     auto wfx = reinterpret_cast<WAVEFORMATEX*>(wfxbuff);
-    HRESULT hr = mReader.GetFormat(index, wfx, sizeof(wfxbuff));
+    HRESULT hr = GetFormat(index, wfx, sizeof(wfxbuff));
     ThrowIfFailed(hr);
 
     IXAudio2SourceVoice* voice = nullptr;
@@ -217,11 +435,11 @@ void WaveBank::Impl::Play(unsigned int index, float volume, float pitch, float p
     ThrowIfFailed(hr);
 
     XAUDIO2_BUFFER buffer = {};
-    hr = mReader.GetWaveData(index, &buffer.pAudioData, buffer.AudioBytes);
+    hr = GetWaveData(index, &buffer.pAudioData, buffer.AudioBytes);
     ThrowIfFailed(hr);
 
     WaveBankReader::Metadata metadata;
-    hr = mReader.GetMetadata(index, metadata);
+    hr = GetMetadata(index, metadata);
     ThrowIfFailed(hr);
 
     buffer.Flags = XAUDIO2_END_OF_STREAM;
@@ -262,10 +480,10 @@ void WaveBank::Impl::Play(unsigned int index, float volume, float pitch, float p
 
 // Public constructors.
 _Use_decl_annotations_
-WaveBank::WaveBank(AudioEngine* engine, const wchar_t* wbFileName)
+WaveBank::WaveBank(AudioEngine* engine, const wchar_t* wbFileName, WAVE_BANK_FLAGS flags)
     : pImpl(std::make_unique<Impl>(engine))
 {
-    HRESULT hr = pImpl->Initialize(engine, wbFileName);
+    HRESULT hr = pImpl->Initialize(engine, wbFileName, flags);
     if (FAILED(hr))
     {
         DebugTrace("ERROR: WaveBank failed (%08X) to intialize from .xwb file \"%ls\"\n",
@@ -273,6 +491,8 @@ WaveBank::WaveBank(AudioEngine* engine, const wchar_t* wbFileName)
         throw std::runtime_error("WaveBank");
     }
 
+    pImpl->PrewarmVoices();
+
     DebugTrace("INFO: WaveBank \"%hs\" with %u entries loaded from .xwb file \"%ls\"\n",
         pImpl->mReader.BankName(), pImpl->mReader.Count(), wbFileName);
 }
@@ -450,13 +670,19 @@ bool WaveBank::IsAdvancedFormat() const noexcept
 }
 
 
+void WaveBank::DecompressADPCM()
+{
+    pImpl->DecompressADPCM();
+}
+
+
 size_t WaveBank::GetSampleSizeInBytes(unsigned int index) const noexcept
 {
     if (index >= pImpl->mReader.Count())
         return 0;
 
     WaveBankReader::Metadata metadata;
-    HRESULT hr = pImpl->mReader.GetMetadata(index, metadata);
+    HRESULT hr = pImpl->GetMetadata(index, metadata);
     if (FAILED(hr))
         return 0;
 
@@ -504,7 +730,7 @@ const WAVEFORMATEX* WaveBank::GetFormat(unsigned int index, WAVEFORMATEX* wfx, s
     if (index >= pImpl->mReader.Count())
         return nullptr;
 
-    HRESULT hr = pImpl->mReader.GetFormat(index, wfx, maxsize);
+    HRESULT hr = pImpl->GetFormat(index, wfx, maxsize);
     if (FAILED(hr))
         return nullptr;
 
@@ -519,6 +745,12 @@ int WaveBank::Find(const char* name) const
 }
 
 
+int WaveBank::Find(uint64_t nameHash) const noexcept
+{
+    return static_cast<int>(pImpl->mReader.Find(nameHash));
+}
+
+
 #ifdef DIRECTX_ENABLE_XWMA
 
 _Use_decl_annotations_
@@ -527,11 +759,11 @@ bool WaveBank::FillSubmitBuffer(unsigned int index, XAUDIO2_BUFFER& buffer, XAUD
     memset(&buffer, 0, sizeof(buffer));
     memset(&wmaBuffer, 0, sizeof(wmaBuffer));
 
-    HRESULT hr = pImpl->mReader.GetWaveData(index, &buffer.pAudioData, buffer.AudioBytes);
+    HRESULT hr = pImpl->GetWaveData(index, &buffer.pAudioData, buffer.AudioBytes);
     ThrowIfFailed(hr);
 
     WaveBankReader::Metadata metadata;
-    hr = pImpl->mReader.GetMetadata(index, metadata);
+    hr = pImpl->GetMetadata(index, metadata);
     ThrowIfFailed(hr);
 
     buffer.LoopBegin = metadata.loopStart;
@@ -551,11 +783,11 @@ void WaveBank::FillSubmitBuffer(unsigned int index, XAUDIO2_BUFFER& buffer) cons
 {
     memset(&buffer, 0, sizeof(buffer));
 
-    HRESULT hr = pImpl->mReader.GetWaveData(index, &buffer.pAudioData, buffer.AudioBytes);
+    HRESULT hr = pImpl->GetWaveData(index, &buffer.pAudioData, buffer.AudioBytes);
     ThrowIfFailed(hr);
 
     WaveBankReader::Metadata metadata;
-    hr = pImpl->mReader.GetMetadata(index, metadata);
+    hr = pImpl->GetMetadata(index, metadata);
     ThrowIfFailed(hr);
 
     buffer.LoopBegin = metadata.loopStart;
@@ -590,7 +822,7 @@ bool WaveBank::GetPrivateData(unsigned int index, void* data, size_t datasize)
         case sizeof(WaveBankReader::Metadata) :
         {
             auto ptr = reinterpret_cast<WaveBankReader::Metadata*>(data);
-            return SUCCEEDED(pImpl->mReader.GetMetadata(index, *ptr));
+            return SUCCEEDED(pImpl->GetMetadata(index, *ptr));
         }
 
         case sizeof(WaveBankSeekData) :
@@ -610,8 +842,8 @@ bool WaveBank::GetPrivateData(unsigned int index, void* data, size_t datasize)
 #if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
 
 _Use_decl_annotations_
-WaveBank::WaveBank(AudioEngine* engine, const __wchar_t* wbFileName) :
-    WaveBank(engine, reinterpret_cast<const unsigned short*>(wbFileName))
+WaveBank::WaveBank(AudioEngine* engine, const __wchar_t* wbFileName, WAVE_BANK_FLAGS flags) :
+    WaveBank(engine, reinterpret_cast<const unsigned short*>(wbFileName), flags)
 {
 }
 
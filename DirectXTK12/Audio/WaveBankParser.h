@@ -0,0 +1,724 @@
+//--------------------------------------------------------------------------------------
+// File: WaveBankParser.h
+//
+// Reads and validates the header, bank data, entry metadata, names, and seek tables of
+// an XACT3 wave bank (.xwb). The file itself is reached through a Source, so the same
+// parsing serves the Win32 reader and banks held in memory. The wave data segment is
+// left to the caller to read, map, or stream.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "SALFallback.h"
+
+
+namespace DirectX
+{
+    namespace WaveBankParser
+    {
+        inline uint32_t ByteSwap(uint32_t value) noexcept
+        {
+        #ifdef _MSC_VER
+            return _byteswap_ulong(value);
+        #else
+            return __builtin_bswap32(value);
+        #endif
+        }
+
+        constexpr uint32_t MakeFourCC(char a, char b, char c, char d) noexcept
+        {
+            return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+        }
+
+    #pragma pack(push, 1)
+
+        constexpr size_t DVD_SECTOR_SIZE = 2048;
+        constexpr size_t DVD_BLOCK_SIZE = DVD_SECTOR_SIZE * 16;
+
+        constexpr size_t ALIGNMENT_MIN = 4;
+        constexpr size_t ALIGNMENT_DVD = DVD_SECTOR_SIZE;
+
+        constexpr size_t MAX_DATA_SEGMENT_SIZE = 0xFFFFFFFF;
+        constexpr size_t MAX_COMPACT_DATA_SEGMENT_SIZE = 0x001FFFFF;
+
+        struct REGION
+        {
+            uint32_t    dwOffset;   // Region offset, in bytes.
+            uint32_t    dwLength;   // Region length, in bytes.
+
+            void BigEndian() noexcept
+            {
+                dwOffset = ByteSwap(dwOffset);
+                dwLength = ByteSwap(dwLength);
+            }
+        };
+
+        struct SAMPLEREGION
+        {
+            uint32_t    dwStartSample;  // Start sample for the region.
+            uint32_t    dwTotalSamples; // Region length in samples.
+
+            void BigEndian() noexcept
+            {
+                dwStartSample = ByteSwap(dwStartSample);
+                dwTotalSamples = ByteSwap(dwTotalSamples);
+            }
+        };
+
+        struct HEADER
+        {
+            static constexpr uint32_t SIGNATURE = MakeFourCC('W', 'B', 'N', 'D');
+            static constexpr uint32_t BE_SIGNATURE = MakeFourCC('D', 'N', 'B', 'W');
+            static constexpr uint32_t VERSION = 44;
+
+            enum SEGIDX
+            {
+                SEGIDX_BANKDATA = 0,       // Bank data
+                SEGIDX_ENTRYMETADATA,      // Entry meta-data
+                SEGIDX_SEEKTABLES,         // Storage for seek tables for the encoded waves.
+                SEGIDX_ENTRYNAMES,         // Entry friendly names
+                SEGIDX_ENTRYWAVEDATA,      // Entry wave data
+                SEGIDX_COUNT
+            };
+
+            uint32_t    dwSignature;            // File signature
+            uint32_t    dwVersion;              // Version of the tool that created the file
+            uint32_t    dwHeaderVersion;        // Version of the file format
+            REGION      Segments[SEGIDX_COUNT]; // Segment lookup table
+
+            void BigEndian() noexcept
+            {
+                // Leave dwSignature alone as indicator of BE vs. LE
+
+                dwVersion = ByteSwap(dwVersion);
+                dwHeaderVersion = ByteSwap(dwHeaderVersion);
+                for (size_t j = 0; j < SEGIDX_COUNT; ++j)
+                {
+                    Segments[j].BigEndian();
+                }
+            }
+        };
+
+    #ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning( disable : 4201 4203 )
+    #endif
+
+        union MINIWAVEFORMAT
+        {
+            static constexpr uint32_t TAG_PCM = 0x0;
+            static constexpr uint32_t TAG_XMA = 0x1;
+            static constexpr uint32_t TAG_ADPCM = 0x2;
+            static constexpr uint32_t TAG_WMA = 0x3;
+
+            static constexpr uint32_t BITDEPTH_8 = 0x0; // PCM only
+            static constexpr uint32_t BITDEPTH_16 = 0x1; // PCM only
+
+            static constexpr size_t ADPCM_BLOCKALIGN_CONVERSION_OFFSET = 22;
+
+            struct
+            {
+                uint32_t       wFormatTag : 2;        // Format tag
+                uint32_t       nChannels : 3;        // Channel count (1 - 6)
+                uint32_t       nSamplesPerSec : 18;       // Sampling rate
+                uint32_t       wBlockAlign : 8;        // Block alignment.  For WMA, lower 6 bits block alignment index, upper 2 bits bytes-per-second index.
+                uint32_t       wBitsPerSample : 1;        // Bits per sample (8 vs. 16, PCM only); WMAudio2/WMAudio3 (for WMA)
+            };
+
+            uint32_t           dwValue;
+
+            void BigEndian() noexcept
+            {
+                dwValue = ByteSwap(dwValue);
+            }
+
+            uint16_t BitsPerSample() const noexcept
+            {
+                if (wFormatTag == TAG_XMA)
+                    return 16; // XMA_OUTPUT_SAMPLE_BITS == 16
+                if (wFormatTag == TAG_WMA)
+                    return 16;
+                if (wFormatTag == TAG_ADPCM)
+                    return 4; // MSADPCM_BITS_PER_SAMPLE == 4
+
+                // wFormatTag must be TAG_PCM (2 bits can only represent 4 different values)
+                return (wBitsPerSample == BITDEPTH_16) ? 16u : 8u;
+            }
+
+            uint32_t BlockAlign() const noexcept
+            {
+                switch (wFormatTag)
+                {
+                case TAG_PCM:
+                    return wBlockAlign;
+
+                case TAG_XMA:
+                    return (nChannels * 16 / 8); // XMA_OUTPUT_SAMPLE_BITS = 16
+
+                case TAG_ADPCM:
+                    return (wBlockAlign + ADPCM_BLOCKALIGN_CONVERSION_OFFSET) * nChannels;
+
+                case TAG_WMA:
+                    {
+                        static const uint32_t aWMABlockAlign[17] =
+                        {
+                            929,
+                            1487,
+                            1280,
+                            2230,
+                            8917,
+                            8192,
+                            4459,
+                            5945,
+                            2304,
+                            1536,
+                            1485,
+                            1008,
+                            2731,
+                            4096,
+                            6827,
+                            5462,
+                            1280
+                        };
+
+                        const uint32_t dwBlockAlignIndex = wBlockAlign & 0x1F;
+                        if (dwBlockAlignIndex < 17)
+                            return aWMABlockAlign[dwBlockAlignIndex];
+                    }
+                    break;
+                }
+
+                return 0;
+            }
+
+            uint32_t AvgBytesPerSec() const noexcept
+            {
+                switch (wFormatTag)
+                {
+                case TAG_PCM:
+                    return nSamplesPerSec * wBlockAlign;
+
+                case TAG_XMA:
+                    return nSamplesPerSec * BlockAlign();
+
+                case TAG_ADPCM:
+                    {
+                        const uint32_t blockAlign = BlockAlign();
+                        const uint32_t samplesPerAdpcmBlock = AdpcmSamplesPerBlock();
+                        return blockAlign * nSamplesPerSec / samplesPerAdpcmBlock;
+                    }
+
+                case TAG_WMA:
+                    {
+                        static const uint32_t aWMAAvgBytesPerSec[7] =
+                        {
+                            12000,
+                            24000,
+                            4000,
+                            6000,
+                            8000,
+                            20000,
+                            2500
+                        };
+                        // bitrate = entry * 8
+
+                        const uint32_t dwBytesPerSecIndex = wBlockAlign >> 5;
+                        if (dwBytesPerSecIndex < 7)
+                            return aWMAAvgBytesPerSec[dwBytesPerSecIndex];
+                    }
+                    break;
+                }
+
+                return 0;
+            }
+
+            uint32_t AdpcmSamplesPerBlock() const noexcept
+            {
+                const uint32_t nBlockAlign = (wBlockAlign + ADPCM_BLOCKALIGN_CONVERSION_OFFSET) * nChannels;
+                return nBlockAlign * 2 / uint32_t(nChannels) - 12;
+            }
+        };
+
+        struct BANKDATA
+        {
+            static constexpr size_t BANKNAME_LENGTH = 64;
+
+            static constexpr uint32_t TYPE_BUFFER = 0x00000000;
+            static constexpr uint32_t TYPE_STREAMING = 0x00000001;
+            static constexpr uint32_t TYPE_MASK = 0x00000001;
+
+            static constexpr uint32_t FLAGS_ENTRYNAMES = 0x00010000;
+            static constexpr uint32_t FLAGS_COMPACT = 0x00020000;
+            static constexpr uint32_t FLAGS_SYNC_DISABLED = 0x00040000;
+            static constexpr uint32_t FLAGS_SEEKTABLES = 0x00080000;
+            static constexpr uint32_t FLAGS_MASK = 0x000F0000;
+
+            struct BUILDTIME
+            {
+                uint32_t    dwLowDateTime;
+                uint32_t    dwHighDateTime;
+            };
+
+            uint32_t        dwFlags;                        // Bank flags
+            uint32_t        dwEntryCount;                   // Number of entries in the bank
+            char            szBankName[BANKNAME_LENGTH];    // Bank friendly name
+            uint32_t        dwEntryMetaDataElementSize;     // Size of each entry meta-data element, in bytes
+            uint32_t        dwEntryNameElementSize;         // Size of each entry name element, in bytes
+            uint32_t        dwAlignment;                    // Entry alignment, in bytes
+            MINIWAVEFORMAT  CompactFormat;                  // Format data for compact bank
+            BUILDTIME       BuildTime;                      // Build timestamp, as a FILETIME
+
+            void BigEndian() noexcept
+            {
+                dwFlags = ByteSwap(dwFlags);
+                dwEntryCount = ByteSwap(dwEntryCount);
+                dwEntryMetaDataElementSize = ByteSwap(dwEntryMetaDataElementSize);
+                dwEntryNameElementSize = ByteSwap(dwEntryNameElementSize);
+                dwAlignment = ByteSwap(dwAlignment);
+                CompactFormat.BigEndian();
+                BuildTime.dwLowDateTime = ByteSwap(BuildTime.dwLowDateTime);
+                BuildTime.dwHighDateTime = ByteSwap(BuildTime.dwHighDateTime);
+            }
+        };
+
+        struct ENTRY
+        {
+            static constexpr uint32_t FLAGS_READAHEAD = 0x00000001;     // Enable stream read-ahead
+            static constexpr uint32_t FLAGS_LOOPCACHE = 0x00000002;     // One or more looping sounds use this wave
+            static constexpr uint32_t FLAGS_REMOVELOOPTAIL = 0x00000004;// Remove data after the end of the loop region
+            static constexpr uint32_t FLAGS_IGNORELOOP = 0x00000008;    // Used internally when the loop region can't be used
+            static constexpr uint32_t FLAGS_MASK = 0x00000008;
+
+            union
+            {
+                struct
+                {
+                    // Entry flags
+                    uint32_t                   dwFlags : 4;
+
+                    // Duration of the wave, in units of one sample.
+                    // For instance, a ten second long wave sampled
+                    // at 48KHz would have a duration of 480,000.
+                    // This value is not affected by the number of
+                    // channels, the number of bits per sample, or the
+                    // compression format of the wave.
+                    uint32_t                   Duration : 28;
+                };
+                uint32_t dwFlagsAndDuration;
+            };
+
+            MINIWAVEFORMAT  Format;         // Entry format.
+            REGION          PlayRegion;     // Region within the wave data segment that contains this entry.
+            SAMPLEREGION    LoopRegion;     // Region within the wave data (in samples) that should loop.
+
+            void BigEndian() noexcept
+            {
+                dwFlagsAndDuration = ByteSwap(dwFlagsAndDuration);
+                Format.BigEndian();
+                PlayRegion.BigEndian();
+                LoopRegion.BigEndian();
+            }
+        };
+
+        struct ENTRYCOMPACT
+        {
+            uint32_t       dwOffset : 21;       // Data offset, in multiplies of the bank alignment
+            uint32_t       dwLengthDeviation : 11;       // Data length deviation, in bytes
+
+            void BigEndian() noexcept
+            {
+                uint32_t value;
+                memcpy(&value, this, sizeof(value));
+                value = ByteSwap(value);
+                memcpy(this, &value, sizeof(value));
+            }
+
+            void ComputeLocations(uint32_t& offset, uint32_t& length, uint32_t index, const HEADER& header, const BANKDATA& data, const ENTRYCOMPACT* entries) const noexcept
+            {
+                offset = dwOffset * data.dwAlignment;
+
+                if (index < (data.dwEntryCount - 1))
+                {
+                    length = (entries[index + 1].dwOffset * data.dwAlignment) - offset - dwLengthDeviation;
+                }
+                else
+                {
+                    length = header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength - offset - dwLengthDeviation;
+                }
+            }
+
+            static uint32_t GetDuration(uint32_t length, const BANKDATA& data, _In_opt_ const uint32_t* seekTable) noexcept
+            {
+                switch (data.CompactFormat.wFormatTag)
+                {
+                case MINIWAVEFORMAT::TAG_ADPCM:
+                    {
+                        uint32_t duration = (length / data.CompactFormat.BlockAlign()) * data.CompactFormat.AdpcmSamplesPerBlock();
+                        const uint32_t partial = length % data.CompactFormat.BlockAlign();
+                        if (partial)
+                        {
+                            if (partial >= (7u * data.CompactFormat.nChannels))
+                                duration += (partial * 2 / data.CompactFormat.nChannels - 12);
+                        }
+                        return duration;
+                    }
+
+                case MINIWAVEFORMAT::TAG_WMA:
+                    if (seekTable)
+                    {
+                        const uint32_t seekCount = *seekTable;
+                        if (seekCount > 0)
+                        {
+                            return seekTable[seekCount] / uint32_t(2 * data.CompactFormat.nChannels);
+                        }
+                    }
+                    return 0;
+
+                case MINIWAVEFORMAT::TAG_XMA:
+                    if (seekTable)
+                    {
+                        const uint32_t seekCount = *seekTable;
+                        if (seekCount > 0)
+                        {
+                            return seekTable[seekCount];
+                        }
+                    }
+                    return 0;
+
+                default:
+                    return uint32_t((uint64_t(length) * 8)
+                        / (uint64_t(data.CompactFormat.BitsPerSample()) * uint64_t(data.CompactFormat.nChannels)));
+                }
+            }
+        };
+
+    #ifdef _MSC_VER
+    #pragma warning(pop)
+    #endif
+
+    #pragma pack(pop)
+
+        static_assert(sizeof(REGION) == 8, "Mismatch with xact3wb.h");
+        static_assert(sizeof(SAMPLEREGION) == 8, "Mismatch with xact3wb.h");
+        static_assert(sizeof(HEADER) == 52, "Mismatch with xact3wb.h");
+        static_assert(sizeof(ENTRY) == 24, "Mismatch with xact3wb.h");
+        static_assert(sizeof(MINIWAVEFORMAT) == 4, "Mismatch with xact3wb.h");
+        static_assert(sizeof(ENTRYCOMPACT) == 4, "Mismatch with xact3wb.h");
+        static_assert(sizeof(BANKDATA) == 96, "Mismatch with xact3wb.h");
+
+        //--------------------------------------------------------------------------------
+        // Where the bank is read from. Offsets are from the start of the file.
+        class Source
+        {
+        public:
+            virtual ~Source() = default;
+
+            // Reads exactly size bytes, or returns false.
+            virtual bool Read(uint32_t offset, _Out_writes_bytes_(size) void* buffer, uint32_t size) noexcept = 0;
+        };
+
+        // A bank already in memory.
+        class MemorySource : public Source
+        {
+        public:
+            MemorySource(_In_reads_bytes_(size) const uint8_t* data, size_t size) noexcept :
+                mData(data),
+                mSize(size)
+            {
+            }
+
+            bool Read(uint32_t offset, void* buffer, uint32_t size) noexcept override
+            {
+                if (offset > mSize || size > mSize - offset)
+                    return false;
+
+                memcpy(buffer, mData + offset, size);
+                return true;
+            }
+
+        private:
+            const uint8_t*  mData;
+            size_t          mSize;
+        };
+
+        enum class Status
+        {
+            Ok,
+            ReadFailed,     // The source failed or ended early
+            InvalidData,    // Not a wave bank, or inconsistent
+            NoData,         // No entries or no wave data
+            OutOfMemory,
+        };
+
+        struct EntryInfo
+        {
+            uint32_t    duration;
+            uint32_t    loopStart;
+            uint32_t    loopLength;
+            uint32_t    offsetBytes;    // From the start of the wave data segment
+            uint32_t    lengthBytes;
+        };
+
+        //--------------------------------------------------------------------------------
+        // Everything in the bank except the wave data, in native byte order.
+        struct Bank
+        {
+            static constexpr size_t c_nameStride = 64;
+
+            HEADER                      header;
+            BANKDATA                    data;
+            bool                        bigEndian;
+            std::unique_ptr<uint8_t[]>  entries;
+            std::unique_ptr<uint8_t[]>  seekData;
+            std::unique_ptr<char[]>     names;  // Null-terminated entry names, c_nameStride bytes apart; null if the bank has none
+
+            Bank() noexcept : header{}, data{}, bigEndian(false) {}
+
+            void Clear() noexcept
+            {
+                memset(&header, 0, sizeof(HEADER));
+                memset(&data, 0, sizeof(BANKDATA));
+                bigEndian = false;
+                entries.reset();
+                seekData.reset();
+                names.reset();
+            }
+
+            bool IsStreaming() const noexcept { return (data.dwFlags & BANKDATA::TYPE_STREAMING) != 0; }
+            bool IsCompact() const noexcept { return (data.dwFlags & BANKDATA::FLAGS_COMPACT) != 0; }
+            bool IsValidIndex(uint32_t index) const noexcept { return entries && index < data.dwEntryCount; }
+
+            const REGION& WaveData() const noexcept { return header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA]; }
+
+            _Ret_maybenull_ const char* GetName(uint32_t index) const noexcept
+            {
+                return (names && index < data.dwEntryCount) ? &names[size_t(index) * c_nameStride] : nullptr;
+            }
+
+            // Index must be valid.
+            const MINIWAVEFORMAT& GetFormat(uint32_t index) const noexcept
+            {
+                return IsCompact() ? data.CompactFormat : reinterpret_cast<const ENTRY*>(entries.get())[index].Format;
+            }
+
+            // Returns the entry's seek table (count, then count values), or null.
+            _Ret_maybenull_ const uint32_t* FindSeekTable(uint32_t index) const noexcept
+            {
+                if (!seekData || index >= data.dwEntryCount)
+                    return nullptr;
+
+                const uint32_t seekSize = header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength;
+
+                if ((uint64_t(index) + 1) * sizeof(uint32_t) > seekSize)
+                    return nullptr;
+
+                auto table = reinterpret_cast<const uint32_t*>(seekData.get());
+                uint64_t offset = table[index];
+                if (offset == uint32_t(-1) || (offset % sizeof(uint32_t)))
+                    return nullptr;
+
+                offset += sizeof(uint32_t) * uint64_t(data.dwEntryCount);
+
+                if (offset + sizeof(uint32_t) > seekSize)
+                    return nullptr;
+
+                auto seekTable = reinterpret_cast<const uint32_t*>(seekData.get() + offset);
+                if (offset + (uint64_t(*seekTable) + 1) * sizeof(uint32_t) > seekSize)
+                    return nullptr;
+
+                return seekTable;
+            }
+
+            // Index must be valid.
+            EntryInfo GetEntry(uint32_t index) const noexcept
+            {
+                EntryInfo info = {};
+
+                if (IsCompact())
+                {
+                    auto compact = reinterpret_cast<const ENTRYCOMPACT*>(entries.get());
+                    compact[index].ComputeLocations(info.offsetBytes, info.lengthBytes, index, header, data, compact);
+                    info.duration = ENTRYCOMPACT::GetDuration(info.lengthBytes, data, FindSeekTable(index));
+                }
+                else
+                {
+                    auto& entry = reinterpret_cast<const ENTRY*>(entries.get())[index];
+                    info.duration = entry.Duration;
+                    info.loopStart = entry.LoopRegion.dwStartSample;
+                    info.loopLength = entry.LoopRegion.dwTotalSamples;
+                    info.offsetBytes = entry.PlayRegion.dwOffset;
+                    info.lengthBytes = entry.PlayRegion.dwLength;
+                }
+
+                return info;
+            }
+
+            // False if the entry's bytes don't lie within the wave data segment.
+            bool IsInWaveData(const EntryInfo& info) const noexcept
+            {
+                return (uint64_t(info.offsetBytes) + uint64_t(info.lengthBytes)) <= uint64_t(WaveData().dwLength);
+            }
+        };
+
+        //--------------------------------------------------------------------------------
+        // Reads everything but the wave data into bank.
+        inline Status Parse(Source& source, Bank& bank) noexcept
+        {
+            bank.Clear();
+
+            // Read and verify header
+            if (!source.Read(0, &bank.header, sizeof(HEADER)))
+                return Status::ReadFailed;
+
+            if (bank.header.dwSignature != HEADER::SIGNATURE && bank.header.dwSignature != HEADER::BE_SIGNATURE)
+                return Status::InvalidData;
+
+            bank.bigEndian = (bank.header.dwSignature == HEADER::BE_SIGNATURE);
+            if (bank.bigEndian)
+                bank.header.BigEndian();
+
+            if (bank.header.dwHeaderVersion != HEADER::VERSION)
+                return Status::InvalidData;
+
+            // Load bank data
+            if (!source.Read(bank.header.Segments[HEADER::SEGIDX_BANKDATA].dwOffset, &bank.data, sizeof(BANKDATA)))
+                return Status::ReadFailed;
+
+            if (bank.bigEndian)
+                bank.data.BigEndian();
+
+            bank.data.szBankName[BANKDATA::BANKNAME_LENGTH - 1] = 0;
+
+            const uint32_t count = bank.data.dwEntryCount;
+            if (!count)
+                return Status::NoData;
+
+            if (bank.data.dwFlags & BANKDATA::TYPE_STREAMING)
+            {
+                if (bank.data.dwAlignment < ALIGNMENT_DVD)
+                    return Status::InvalidData;
+                if (bank.data.dwAlignment % DVD_SECTOR_SIZE)
+                    return Status::InvalidData;
+            }
+            else if (bank.data.dwAlignment < ALIGNMENT_MIN)
+            {
+                return Status::InvalidData;
+            }
+
+            if (bank.data.dwFlags & BANKDATA::FLAGS_COMPACT)
+            {
+                if (bank.data.dwEntryMetaDataElementSize != sizeof(ENTRYCOMPACT))
+                    return Status::InvalidData;
+
+                if (bank.header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength > (MAX_COMPACT_DATA_SEGMENT_SIZE * bank.data.dwAlignment))
+                {
+                    // Data segment is too large to be valid compact wavebank
+                    return Status::InvalidData;
+                }
+            }
+            else if (bank.data.dwEntryMetaDataElementSize != sizeof(ENTRY))
+            {
+                return Status::InvalidData;
+            }
+
+            const uint32_t metadataBytes = bank.header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwLength;
+            if (uint64_t(metadataBytes) != uint64_t(count) * bank.data.dwEntryMetaDataElementSize)
+                return Status::InvalidData;
+
+            // Load names
+            const uint32_t namesBytes = bank.header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwLength;
+            const uint64_t nameElements = uint64_t(bank.data.dwEntryNameElementSize) * count;
+            if (namesBytes > 0 && bank.data.dwEntryNameElementSize > 0 && namesBytes >= nameElements)
+            {
+                std::unique_ptr<char[]> temp(new (std::nothrow) char[namesBytes]);
+                if (!temp)
+                    return Status::OutOfMemory;
+
+                if (!source.Read(bank.header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwOffset, temp.get(), namesBytes))
+                    return Status::ReadFailed;
+
+                bank.names.reset(new (std::nothrow) char[size_t(count) * Bank::c_nameStride]);
+                if (!bank.names)
+                    return Status::OutOfMemory;
+
+                // Names need not be terminated within their element, so stop at the element or stride.
+                const size_t limit = std::min<size_t>(bank.data.dwEntryNameElementSize, Bank::c_nameStride - 1);
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    const char* src = &temp[size_t(bank.data.dwEntryNameElementSize) * j];
+                    char* name = &bank.names[size_t(j) * Bank::c_nameStride];
+                    memset(name, 0, Bank::c_nameStride);
+
+                    size_t length = 0;
+                    while (length < limit && src[length])
+                        ++length;
+                    memcpy(name, src, length);
+                }
+            }
+
+            // Load entries
+            bank.entries.reset(new (std::nothrow) uint8_t[metadataBytes]);
+            if (!bank.entries)
+                return Status::OutOfMemory;
+
+            if (!source.Read(bank.header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset, bank.entries.get(), metadataBytes))
+                return Status::ReadFailed;
+
+            if (bank.bigEndian)
+            {
+                if (bank.data.dwFlags & BANKDATA::FLAGS_COMPACT)
+                {
+                    auto ptr = reinterpret_cast<ENTRYCOMPACT*>(bank.entries.get());
+                    for (size_t j = 0; j < count; ++j, ++ptr)
+                        ptr->BigEndian();
+                }
+                else
+                {
+                    auto ptr = reinterpret_cast<ENTRY*>(bank.entries.get());
+                    for (size_t j = 0; j < count; ++j, ++ptr)
+                        ptr->BigEndian();
+                }
+            }
+
+            // Load seek tables (XMA2 / xWMA)
+            const uint32_t seekLen = bank.header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength;
+            if (seekLen > 0)
+            {
+                bank.seekData.reset(new (std::nothrow) uint8_t[seekLen]);
+                if (!bank.seekData)
+                    return Status::OutOfMemory;
+
+                if (!source.Read(bank.header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset, bank.seekData.get(), seekLen))
+                    return Status::ReadFailed;
+
+                if (bank.bigEndian)
+                {
+                    auto ptr = reinterpret_cast<uint32_t*>(bank.seekData.get());
+                    for (size_t j = 0; j + 4 <= seekLen; j += 4, ++ptr)
+                    {
+                        *ptr = ByteSwap(*ptr);
+                    }
+                }
+            }
+
+            if (!bank.header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength)
+                return Status::NoData;
+
+            return Status::Ok;
+        }
+    }
+}
@@ -12,6 +12,7 @@
 
 #include "pch.h"
 #include "WaveBankReader.h"
+#include "WaveBankParser.h"
 #include "Audio.h"
 #include "PlatformHelpers.h"
 #include "SoundCommon.h"
@@ -26,405 +27,101 @@
 #endif
 
 
+using namespace DirectX::WaveBankParser;
+
 namespace
 {
-#pragma pack(push, 1)
-
     constexpr uint16_t MSADPCM_FORMAT_EXTRA_BYTES = 32;
     constexpr uint16_t MSADPCM_NUM_COEFFICIENTS = 7;
 
-    constexpr size_t DVD_SECTOR_SIZE = 2048;
-    constexpr size_t DVD_BLOCK_SIZE = DVD_SECTOR_SIZE * 16;
-
-    constexpr size_t ALIGNMENT_MIN = 4;
-    constexpr size_t ALIGNMENT_DVD = DVD_SECTOR_SIZE;
-
-    constexpr size_t MAX_DATA_SEGMENT_SIZE = 0xFFFFFFFF;
-    constexpr size_t MAX_COMPACT_DATA_SEGMENT_SIZE = 0x001FFFFF;
-
-    struct REGION
-    {
-        uint32_t    dwOffset;   // Region offset, in bytes.
-        uint32_t    dwLength;   // Region length, in bytes.
-
-        void BigEndian() noexcept
-        {
-            dwOffset = _byteswap_ulong(dwOffset);
-            dwLength = _byteswap_ulong(dwLength);
-        }
-    };
-
-    struct SAMPLEREGION
-    {
-        uint32_t    dwStartSample;  // Start sample for the region.
-        uint32_t    dwTotalSamples; // Region length in samples.
-
-        void BigEndian() noexcept
-        {
-            dwStartSample = _byteswap_ulong(dwStartSample);
-            dwTotalSamples = _byteswap_ulong(dwTotalSamples);
-        }
-    };
-
-    struct HEADER
+    void AdpcmFillCoefficientTable(ADPCMWAVEFORMAT *fmt) noexcept
     {
-        static constexpr uint32_t SIGNATURE = MAKEFOURCC('W', 'B', 'N', 'D');
-        static constexpr uint32_t BE_SIGNATURE = MAKEFOURCC('D', 'N', 'B', 'W');
-        static constexpr uint32_t VERSION = 44;
-
-        enum SEGIDX
-        {
-            SEGIDX_BANKDATA = 0,       // Bank data
-            SEGIDX_ENTRYMETADATA,      // Entry meta-data
-            SEGIDX_SEEKTABLES,         // Storage for seek tables for the encoded waves.
-            SEGIDX_ENTRYNAMES,         // Entry friendly names
-            SEGIDX_ENTRYWAVEDATA,      // Entry wave data
-            SEGIDX_COUNT
-        };
-
-        uint32_t    dwSignature;            // File signature
-        uint32_t    dwVersion;              // Version of the tool that created the file
-        uint32_t    dwHeaderVersion;        // Version of the file format
-        REGION      Segments[SEGIDX_COUNT]; // Segment lookup table
-
-        void BigEndian() noexcept
-        {
-            // Leave dwSignature alone as indicator of BE vs. LE
+        // These are fixed since we are always using MS ADPCM
+        fmt->wNumCoef = MSADPCM_NUM_COEFFICIENTS;
 
-            dwVersion = _byteswap_ulong(dwVersion);
-            dwHeaderVersion = _byteswap_ulong(dwHeaderVersion);
-            for (size_t j = 0; j < SEGIDX_COUNT; ++j)
-            {
-                Segments[j].BigEndian();
-            }
-        }
-    };
-
-#pragma warning( disable : 4201 4203 )
+        static ADPCMCOEFSET aCoef[7] = { { 256, 0}, {512, -256}, {0,0}, {192,64}, {240,0}, {460, -208}, {392,-232} };
+        memcpy(&fmt->aCoef, aCoef, sizeof(aCoef));
+    }
 
-    union MINIWAVEFORMAT
+    // Blocking reads through an overlapped file handle, keeping the error for the caller.
+    class FileSource : public Source
     {
-        static constexpr uint32_t TAG_PCM = 0x0;
-        static constexpr uint32_t TAG_XMA = 0x1;
-        static constexpr uint32_t TAG_ADPCM = 0x2;
-        static constexpr uint32_t TAG_WMA = 0x3;
-
-        static constexpr uint32_t BITDEPTH_8 = 0x0; // PCM only
-        static constexpr uint32_t BITDEPTH_16 = 0x1; // PCM only
-
-        static constexpr size_t ADPCM_BLOCKALIGN_CONVERSION_OFFSET = 22;
-
-        struct
-        {
-            uint32_t       wFormatTag : 2;        // Format tag
-            uint32_t       nChannels : 3;        // Channel count (1 - 6)
-            uint32_t       nSamplesPerSec : 18;       // Sampling rate
-            uint32_t       wBlockAlign : 8;        // Block alignment.  For WMA, lower 6 bits block alignment index, upper 2 bits bytes-per-second index.
-            uint32_t       wBitsPerSample : 1;        // Bits per sample (8 vs. 16, PCM only); WMAudio2/WMAudio3 (for WMA)
-        };
-
-        uint32_t           dwValue;
-
-        void BigEndian() noexcept
+    public:
+        FileSource(_In_ HANDLE hFile, _In_ HANDLE hEvent) noexcept :
+            mFile(hFile),
+            mEvent(hEvent),
+            mError(S_OK)
         {
-            dwValue = _byteswap_ulong(dwValue);
         }
 
-        WORD BitsPerSample() const noexcept
+        bool Read(uint32_t offset, void* buffer, uint32_t size) noexcept override
         {
-            if (wFormatTag == TAG_XMA)
-                return 16; // XMA_OUTPUT_SAMPLE_BITS == 16
-            if (wFormatTag == TAG_WMA)
-                return 16;
-            if (wFormatTag == TAG_ADPCM)
-                return 4; // MSADPCM_BITS_PER_SAMPLE == 4
-
-            // wFormatTag must be TAG_PCM (2 bits can only represent 4 different values)
-            return (wBitsPerSample == BITDEPTH_16) ? 16u : 8u;
-        }
+            OVERLAPPED request = {};
+            request.Offset = offset;
+            request.hEvent = mEvent;
 
-        DWORD BlockAlign() const noexcept
-        {
-            switch (wFormatTag)
+            bool wait = false;
+            if (!ReadFile(mFile, buffer, size, nullptr, &request))
             {
-            case TAG_PCM:
-                return wBlockAlign;
-
-            case TAG_XMA:
-                return (nChannels * 16 / 8); // XMA_OUTPUT_SAMPLE_BITS = 16
-
-            case TAG_ADPCM:
-                return (wBlockAlign + ADPCM_BLOCKALIGN_CONVERSION_OFFSET) * nChannels;
-
-            case TAG_WMA:
+                const DWORD error = GetLastError();
+                if (error != ERROR_IO_PENDING)
                 {
-                    static const uint32_t aWMABlockAlign[17] =
-                    {
-                        929,
-                        1487,
-                        1280,
-                        2230,
-                        8917,
-                        8192,
-                        4459,
-                        5945,
-                        2304,
-                        1536,
-                        1485,
-                        1008,
-                        2731,
-                        4096,
-                        6827,
-                        5462,
-                        1280
-                    };
-
-                    const uint32_t dwBlockAlignIndex = wBlockAlign & 0x1F;
-                    if (dwBlockAlignIndex < 17)
-                        return aWMABlockAlign[dwBlockAlignIndex];
+                    mError = HRESULT_FROM_WIN32(error);
+                    return false;
                 }
-                break;
+                wait = true;
             }
 
-            return 0;
-        }
+            DWORD bytes;
+        #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+            std::ignore = wait;
 
-        DWORD AvgBytesPerSec() const noexcept
-        {
-            switch (wFormatTag)
+            const BOOL result = GetOverlappedResultEx(mFile, &request, &bytes, INFINITE, FALSE);
+        #else
+            if (wait)
             {
-            case TAG_PCM:
-                return nSamplesPerSec * wBlockAlign;
-
-            case TAG_XMA:
-                return nSamplesPerSec * BlockAlign();
-
-            case TAG_ADPCM:
-                {
-                    const uint32_t blockAlign = BlockAlign();
-                    const uint32_t samplesPerAdpcmBlock = AdpcmSamplesPerBlock();
-                    return blockAlign * nSamplesPerSec / samplesPerAdpcmBlock;
-                }
-
-            case TAG_WMA:
-                {
-                    static const uint32_t aWMAAvgBytesPerSec[7] =
-                    {
-                        12000,
-                        24000,
-                        4000,
-                        6000,
-                        8000,
-                        20000,
-                        2500
-                    };
-                    // bitrate = entry * 8
-
-                    const uint32_t dwBytesPerSecIndex = wBlockAlign >> 5;
-                    if (dwBytesPerSecIndex < 7)
-                        return aWMAAvgBytesPerSec[dwBytesPerSecIndex];
-                }
-                break;
+                std::ignore = WaitForSingleObject(mEvent, INFINITE);
             }
 
-            return 0;
-        }
-
-        DWORD AdpcmSamplesPerBlock() const noexcept
-        {
-            const uint32_t nBlockAlign = (wBlockAlign + ADPCM_BLOCKALIGN_CONVERSION_OFFSET) * nChannels;
-            return nBlockAlign * 2 / uint32_t(nChannels) - 12;
-        }
-
-        void AdpcmFillCoefficientTable(ADPCMWAVEFORMAT *fmt) const noexcept
-        {
-            // These are fixed since we are always using MS ADPCM
-            fmt->wNumCoef = MSADPCM_NUM_COEFFICIENTS;
-
-            static ADPCMCOEFSET aCoef[7] = { { 256, 0}, {512, -256}, {0,0}, {192,64}, {240,0}, {460, -208}, {392,-232} };
-            memcpy(&fmt->aCoef, aCoef, sizeof(aCoef));
-        }
-    };
-
-    struct BANKDATA
-    {
-        static constexpr size_t BANKNAME_LENGTH = 64;
-
-        static constexpr uint32_t TYPE_BUFFER = 0x00000000;
-        static constexpr uint32_t TYPE_STREAMING = 0x00000001;
-        static constexpr uint32_t TYPE_MASK = 0x00000001;
-
-        static constexpr uint32_t FLAGS_ENTRYNAMES = 0x00010000;
-        static constexpr uint32_t FLAGS_COMPACT = 0x00020000;
-        static constexpr uint32_t FLAGS_SYNC_DISABLED = 0x00040000;
-        static constexpr uint32_t FLAGS_SEEKTABLES = 0x00080000;
-        static constexpr uint32_t FLAGS_MASK = 0x000F0000;
-
-        uint32_t        dwFlags;                        // Bank flags
-        uint32_t        dwEntryCount;                   // Number of entries in the bank
-        char            szBankName[BANKNAME_LENGTH];    // Bank friendly name
-        uint32_t        dwEntryMetaDataElementSize;     // Size of each entry meta-data element, in bytes
-        uint32_t        dwEntryNameElementSize;         // Size of each entry name element, in bytes
-        uint32_t        dwAlignment;                    // Entry alignment, in bytes
-        MINIWAVEFORMAT  CompactFormat;                  // Format data for compact bank
-        FILETIME        BuildTime;                      // Build timestamp
-
-        void BigEndian() noexcept
-        {
-            dwFlags = _byteswap_ulong(dwFlags);
-            dwEntryCount = _byteswap_ulong(dwEntryCount);
-            dwEntryMetaDataElementSize = _byteswap_ulong(dwEntryMetaDataElementSize);
-            dwEntryNameElementSize = _byteswap_ulong(dwEntryNameElementSize);
-            dwAlignment = _byteswap_ulong(dwAlignment);
-            CompactFormat.BigEndian();
-            BuildTime.dwLowDateTime = _byteswap_ulong(BuildTime.dwLowDateTime);
-            BuildTime.dwHighDateTime = _byteswap_ulong(BuildTime.dwHighDateTime);
-        }
-    };
-
-    struct ENTRY
-    {
-        static constexpr uint32_t FLAGS_READAHEAD = 0x00000001;     // Enable stream read-ahead
-        static constexpr uint32_t FLAGS_LOOPCACHE = 0x00000002;     // One or more looping sounds use this wave
-        static constexpr uint32_t FLAGS_REMOVELOOPTAIL = 0x00000004;// Remove data after the end of the loop region
-        static constexpr uint32_t FLAGS_IGNORELOOP = 0x00000008;    // Used internally when the loop region can't be used
-        static constexpr uint32_t FLAGS_MASK = 0x00000008;
-
-        union
-        {
-            struct
-            {
-                // Entry flags
-                uint32_t                   dwFlags : 4;
-
-                // Duration of the wave, in units of one sample.
-                // For instance, a ten second long wave sampled
-                // at 48KHz would have a duration of 480,000.
-                // This value is not affected by the number of
-                // channels, the number of bits per sample, or the
-                // compression format of the wave.
-                uint32_t                   Duration : 28;
-            };
-            uint32_t dwFlagsAndDuration;
-        };
-
-        MINIWAVEFORMAT  Format;         // Entry format.
-        REGION          PlayRegion;     // Region within the wave data segment that contains this entry.
-        SAMPLEREGION    LoopRegion;     // Region within the wave data (in samples) that should loop.
-
-        void BigEndian() noexcept
-        {
-            dwFlagsAndDuration = _byteswap_ulong(dwFlagsAndDuration);
-            Format.BigEndian();
-            PlayRegion.BigEndian();
-            LoopRegion.BigEndian();
-        }
-    };
-
-    struct ENTRYCOMPACT
-    {
-        uint32_t       dwOffset : 21;       // Data offset, in multiplies of the bank alignment
-        uint32_t       dwLengthDeviation : 11;       // Data length deviation, in bytes
-
-        void BigEndian() noexcept
-        {
-            *reinterpret_cast<uint32_t*>(this) = _byteswap_ulong(*reinterpret_cast<const uint32_t*>(this));
-        }
-
-        void ComputeLocations(DWORD& offset, DWORD& length, uint32_t index, const HEADER& header, const BANKDATA& data, const ENTRYCOMPACT* entries) const noexcept
-        {
-            offset = dwOffset * data.dwAlignment;
+            const BOOL result = GetOverlappedResult(mFile, &request, &bytes, FALSE);
+        #endif
 
-            if (index < (data.dwEntryCount - 1))
-            {
-                length = (entries[index + 1].dwOffset * data.dwAlignment) - offset - dwLengthDeviation;
-            }
-            else
+            if (!result)
             {
-                length = header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength - offset - dwLengthDeviation;
+                mError = HRESULT_FROM_WIN32(GetLastError());
+                return false;
             }
-        }
 
-        static uint32_t GetDuration(DWORD length, const BANKDATA& data, _In_opt_ const uint32_t* seekTable) noexcept
-        {
-            switch (data.CompactFormat.wFormatTag)
+            if (bytes != size)
             {
-            case MINIWAVEFORMAT::TAG_ADPCM:
-                {
-                    uint32_t duration = (length / data.CompactFormat.BlockAlign()) * data.CompactFormat.AdpcmSamplesPerBlock();
-                    const uint32_t partial = length % data.CompactFormat.BlockAlign();
-                    if (partial)
-                    {
-                        if (partial >= (7u * data.CompactFormat.nChannels))
-                            duration += (partial * 2 / data.CompactFormat.nChannels - 12);
-                    }
-                    return duration;
-                }
+                mError = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                return false;
+            }
 
-            case MINIWAVEFORMAT::TAG_WMA:
-                if (seekTable)
-                {
-                    const uint32_t seekCount = *seekTable;
-                    if (seekCount > 0)
-                    {
-                        return seekTable[seekCount] / uint32_t(2 * data.CompactFormat.nChannels);
-                    }
-                }
-                return 0;
+            return true;
+        }
 
-            case MINIWAVEFORMAT::TAG_XMA:
-                if (seekTable)
-                {
-                    const uint32_t seekCount = *seekTable;
-                    if (seekCount > 0)
-                    {
-                        return seekTable[seekCount];
-                    }
-                }
-                return 0;
+        HRESULT GetError() const noexcept { return mError; }
 
-            default:
-                return uint32_t((uint64_t(length) * 8)
-                    / (uint64_t(data.CompactFormat.BitsPerSample()) * uint64_t(data.CompactFormat.nChannels)));
-            }
-        }
+    private:
+        HANDLE  mFile;
+        HANDLE  mEvent;
+        HRESULT mError;
     };
 
-#pragma pack(pop)
-
-    inline const uint32_t* FindSeekTable(uint32_t index, _In_opt_ const uint8_t* seekTable, const HEADER& header, const BANKDATA& data) noexcept
+    HRESULT ToHRESULT(Status status, const FileSource& source) noexcept
     {
-        if (!seekTable || index >= data.dwEntryCount)
-            return nullptr;
-
-        const uint32_t seekSize = header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength;
-
-        if ((index * sizeof(uint32_t)) > seekSize)
-            return nullptr;
-
-        auto table = reinterpret_cast<const uint32_t*>(seekTable);
-        uint32_t offset = table[index];
-        if (offset == uint32_t(-1))
-            return nullptr;
-
-        offset += sizeof(uint32_t) * data.dwEntryCount;
-
-        if (offset > seekSize)
-            return nullptr;
-
-        return reinterpret_cast<const uint32_t*>(seekTable + offset);
+        switch (status)
+        {
+        case Status::Ok:            return S_OK;
+        case Status::ReadFailed:    return FAILED(source.GetError()) ? source.GetError() : E_FAIL;
+        case Status::NoData:        return HRESULT_FROM_WIN32(ERROR_NO_DATA);
+        case Status::OutOfMemory:   return E_OUTOFMEMORY;
+        default:                    return E_FAIL;
+        }
     }
 }
 
-static_assert(sizeof(REGION) == 8, "Mismatch with xact3wb.h");
-static_assert(sizeof(SAMPLEREGION) == 8, "Mismatch with xact3wb.h");
-static_assert(sizeof(HEADER) == 52, "Mismatch with xact3wb.h");
-static_assert(sizeof(ENTRY) == 24, "Mismatch with xact3wb.h");
-static_assert(sizeof(MINIWAVEFORMAT) == 4, "Mismatch with xact3wb.h");
-static_assert(sizeof(ENTRY) == 24, "Mismatch with xact3wb.h");
-static_assert(sizeof(ENTRYCOMPACT) == 4, "Mismatch with xact3wb.h");
-static_assert(sizeof(BANKDATA) == 96, "Mismatch with xact3wb.h");
-
 using namespace DirectX;
 
 //--------------------------------------------------------------------------------------
@@ -435,8 +132,8 @@ public:
         m_async(INVALID_HANDLE_VALUE),
         m_request{},
         m_prepared(false),
-        m_header{},
-        m_data{}
+        m_mappedView(nullptr),
+        m_mappedWaveData(nullptr)
     #ifdef DIRECTX_ENABLE_XMA2
         , m_xmaMemory(nullptr)
     #endif
@@ -451,9 +148,11 @@ public:
 
     ~Impl() { Close(); }
 
-    HRESULT Open(_In_z_ const wchar_t* szFileName) noexcept(false);
+    HRESULT Open(_In_z_ const wchar_t* szFileName, bool memoryMapped) noexcept(false);
     void Close() noexcept;
 
+    HRESULT MapWaveData(_In_ HANDLE hFile, uint32_t offset, uint32_t length) noexcept;
+
     HRESULT GetFormat(_In_ uint32_t index, _Out_writes_bytes_(maxsize) WAVEFORMATEX* pFormat, _In_ size_t maxsize) const noexcept;
 
     HRESULT GetWaveData(_In_ uint32_t index, _Outptr_ const uint8_t** pData, _Out_ uint32_t& dataSize) const noexcept;
@@ -464,14 +163,14 @@ public:
 
     bool UpdatePrepared() noexcept;
 
+    void BuildNameIndex(uint32_t count);
+    uint32_t FindName(_In_z_ const char* name) const noexcept;
+    uint32_t FindName(uint64_t nameHash) const noexcept;
+
     void Clear() noexcept
     {
-        memset(&m_header, 0, sizeof(HEADER));
-        memset(&m_data, 0, sizeof(BANKDATA));
-
+        m_bank.Clear();
         m_names.clear();
-        m_entries.reset();
-        m_seekData.reset();
         m_waveData.reset();
 
     #ifdef DIRECTX_ENABLE_XMA2
@@ -488,15 +187,23 @@ public:
     OVERLAPPED                          m_request;
     bool                                m_prepared;
 
-    HEADER                              m_header;
-    BANKDATA                            m_data;
-    std::map<std::string, uint32_t>     m_names;
+    struct NameIndex
+    {
+        uint64_t    hash;
+        uint32_t    index;
+    };
+
+    WaveBankParser::Bank                m_bank;         // Everything but the wave data
+    std::vector<NameIndex>              m_names;        // Sorted by WaveBankNameHash
 
 private:
-    std::unique_ptr<uint8_t[]>          m_entries;
-    std::unique_ptr<uint8_t[]>          m_seekData;
     std::unique_ptr<uint8_t[]>          m_waveData;
 
+    // Read-only view of the wave data segment for memory-mapped in-memory banks
+    ScopedHandle                        m_mapping;
+    void*                               m_mappedView;
+    const uint8_t*                      m_mappedWaveData;
+
 #ifdef DIRECTX_ENABLE_XMA2
 public:
     void*                               m_xmaMemory;
@@ -505,7 +212,7 @@ public:
 
 
 _Use_decl_annotations_
-HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
+HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName, bool memoryMapped) noexcept(false)
 {
     Close();
     Clear();
@@ -540,294 +247,27 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
         return HRESULT_FROM_WIN32(GetLastError());
     }
 
-    // Read and verify header
-    OVERLAPPED request = {};
-    request.hEvent = m_event.get();
-
-    bool wait = false;
-    if (!ReadFile(hFile.get(), &m_header, sizeof(m_header), nullptr, &request))
-    {
-        const DWORD error = GetLastError();
-        if (error != ERROR_IO_PENDING)
-            return HRESULT_FROM_WIN32(error);
-        wait = true;
-    }
-
-    DWORD bytes;
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    std::ignore = wait;
-
-    BOOL result = GetOverlappedResultEx(hFile.get(), &request, &bytes, INFINITE, FALSE);
-#else
-    if (wait)
+    // Header, bank data, names, entries, and seek tables
+    FileSource source(hFile.get(), m_event.get());
+    const Status status = Parse(source, m_bank);
+    if (status != Status::Ok)
     {
-        std::ignore = WaitForSingleObject(m_event.get(), INFINITE);
+        return ToHRESULT(status, source);
     }
 
-    BOOL result = GetOverlappedResult(hFile.get(), &request, &bytes, FALSE);
-#endif
-
-    if (!result || (bytes != sizeof(m_header)))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    if (m_header.dwSignature != HEADER::SIGNATURE && m_header.dwSignature != HEADER::BE_SIGNATURE)
-    {
-        return E_FAIL;
-    }
-
-    const bool be = (m_header.dwSignature == HEADER::BE_SIGNATURE);
-    if (be)
+    if (m_bank.bigEndian)
     {
         DebugTrace("INFO: \"%ls\" is a big-endian (Xbox 360) wave bank\n", szFileName);
-        m_header.BigEndian();
     }
 
-    if (m_header.dwHeaderVersion != HEADER::VERSION)
+    if (m_bank.names)
     {
-        return E_FAIL;
+        BuildNameIndex(m_bank.data.dwEntryCount);
     }
 
-    // Load bank data
-    memset(&request, 0, sizeof(request));
-    request.Offset = m_header.Segments[HEADER::SEGIDX_BANKDATA].dwOffset;
-    request.hEvent = m_event.get();
+    const uint32_t waveLen = m_bank.WaveData().dwLength;
 
-    wait = false;
-    if (!ReadFile(hFile.get(), &m_data, sizeof(m_data), nullptr, &request))
-    {
-        const DWORD error = GetLastError();
-        if (error != ERROR_IO_PENDING)
-            return HRESULT_FROM_WIN32(error);
-        wait = true;
-    }
-
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    result = GetOverlappedResultEx(hFile.get(), &request, &bytes, INFINITE, FALSE);
-#else
-    if (wait)
-    {
-        std::ignore = WaitForSingleObject(m_event.get(), INFINITE);
-    }
-
-    result = GetOverlappedResult(hFile.get(), &request, &bytes, FALSE);
-#endif
-
-    if (!result || (bytes != sizeof(m_data)))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    if (be)
-        m_data.BigEndian();
-
-    if (!m_data.dwEntryCount)
-    {
-        return HRESULT_FROM_WIN32(ERROR_NO_DATA);
-    }
-
-    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
-    {
-        if (m_data.dwAlignment < ALIGNMENT_DVD)
-            return E_FAIL;
-        if (m_data.dwAlignment % DVD_SECTOR_SIZE)
-            return E_FAIL;
-    }
-    else if (m_data.dwAlignment < ALIGNMENT_MIN)
-    {
-        return E_FAIL;
-    }
-
-    if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
-    {
-        if (m_data.dwEntryMetaDataElementSize != sizeof(ENTRYCOMPACT))
-        {
-            return E_FAIL;
-        }
-
-        if (m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength > (MAX_COMPACT_DATA_SEGMENT_SIZE * m_data.dwAlignment))
-        {
-            // Data segment is too large to be valid compact wavebank
-            return E_FAIL;
-        }
-    }
-    else
-    {
-        if (m_data.dwEntryMetaDataElementSize != sizeof(ENTRY))
-        {
-            return E_FAIL;
-        }
-    }
-
-    const DWORD metadataBytes = m_header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwLength;
-    if (metadataBytes != (m_data.dwEntryCount * m_data.dwEntryMetaDataElementSize))
-    {
-        return E_FAIL;
-    }
-
-    // Load names
-    const DWORD namesBytes = m_header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwLength;
-    if (namesBytes > 0)
-    {
-        if (namesBytes >= (m_data.dwEntryNameElementSize * m_data.dwEntryCount))
-        {
-            std::unique_ptr<char[]> temp(new (std::nothrow) char[namesBytes]);
-            if (!temp)
-                return E_OUTOFMEMORY;
-
-            memset(&request, 0, sizeof(request));
-            request.Offset = m_header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwOffset;
-            request.hEvent = m_event.get();
-
-            wait = false;
-            if (!ReadFile(hFile.get(), temp.get(), namesBytes, nullptr, &request))
-            {
-                const DWORD error = GetLastError();
-                if (error != ERROR_IO_PENDING)
-                    return HRESULT_FROM_WIN32(error);
-                wait = true;
-            }
-
-        #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-            result = GetOverlappedResultEx(hFile.get(), &request, &bytes, INFINITE, FALSE);
-        #else
-            if (wait)
-            {
-                std::ignore = WaitForSingleObject(m_event.get(), INFINITE);
-            }
-
-            result = GetOverlappedResult(hFile.get(), &request, &bytes, FALSE);
-        #endif
-
-            if (!result || (namesBytes != bytes))
-            {
-                return HRESULT_FROM_WIN32(GetLastError());
-            }
-
-            for (uint32_t j = 0; j < m_data.dwEntryCount; ++j)
-            {
-                const DWORD n = m_data.dwEntryNameElementSize * j;
-
-                char name[64] = {};
-                strncpy_s(name, &temp[n], sizeof(name));
-
-                m_names[name] = j;
-            }
-        }
-    }
-
-    // Load entries
-    if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
-    {
-        m_entries.reset(reinterpret_cast<uint8_t*>(new (std::nothrow) ENTRYCOMPACT[m_data.dwEntryCount]));
-    }
-    else
-    {
-        m_entries.reset(reinterpret_cast<uint8_t*>(new (std::nothrow) ENTRY[m_data.dwEntryCount]));
-    }
-    if (!m_entries)
-        return E_OUTOFMEMORY;
-
-    memset(&request, 0, sizeof(request));
-    request.Offset = m_header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset;
-    request.hEvent = m_event.get();
-
-    wait = false;
-    if (!ReadFile(hFile.get(), m_entries.get(), metadataBytes, nullptr, &request))
-    {
-        const DWORD error = GetLastError();
-        if (error != ERROR_IO_PENDING)
-            return HRESULT_FROM_WIN32(error);
-        wait = true;
-    }
-
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    result = GetOverlappedResultEx(hFile.get(), &request, &bytes, INFINITE, FALSE);
-#else
-    if (wait)
-    {
-        std::ignore = WaitForSingleObject(m_event.get(), INFINITE);
-    }
-
-    result = GetOverlappedResult(hFile.get(), &request, &bytes, FALSE);
-#endif
-
-    if (!result || (metadataBytes != bytes))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    if (be)
-    {
-        if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
-        {
-            auto ptr = reinterpret_cast<ENTRYCOMPACT*>(m_entries.get());
-            for (size_t j = 0; j < m_data.dwEntryCount; ++j, ++ptr)
-                ptr->BigEndian();
-        }
-        else
-        {
-            auto ptr = reinterpret_cast<ENTRY*>(m_entries.get());
-            for (size_t j = 0; j < m_data.dwEntryCount; ++j, ++ptr)
-                ptr->BigEndian();
-        }
-    }
-
-    // Load seek tables (XMA2 / xWMA)
-    const DWORD seekLen = m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength;
-    if (seekLen > 0)
-    {
-        m_seekData.reset(new (std::nothrow) uint8_t[seekLen]);
-        if (!m_seekData)
-            return E_OUTOFMEMORY;
-
-        memset(&request, 0, sizeof(OVERLAPPED));
-        request.Offset = m_header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset;
-        request.hEvent = m_event.get();
-
-        wait = false;
-        if (!ReadFile(hFile.get(), m_seekData.get(), seekLen, nullptr, &request))
-        {
-            const DWORD error = GetLastError();
-            if (error != ERROR_IO_PENDING)
-                return HRESULT_FROM_WIN32(error);
-            wait = true;
-        }
-
-    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-        result = GetOverlappedResultEx(hFile.get(), &request, &bytes, INFINITE, FALSE);
-    #else
-        if (wait)
-        {
-            std::ignore = WaitForSingleObject(m_event.get(), INFINITE);
-        }
-
-        result = GetOverlappedResult(hFile.get(), &request, &bytes, FALSE);
-    #endif
-
-        if (!result || (seekLen != bytes))
-        {
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        if (be)
-        {
-            auto ptr = reinterpret_cast<uint32_t*>(m_seekData.get());
-            for (size_t j = 0; j < seekLen; j += 4, ++ptr)
-            {
-                *ptr = _byteswap_ulong(*ptr);
-            }
-        }
-    }
-
-    const DWORD waveLen = m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength;
-    if (!waveLen)
-    {
-        return HRESULT_FROM_WIN32(ERROR_NO_DATA);
-    }
-
-    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
+    if (m_bank.IsStreaming())
     {
         // If streaming, reopen without buffering
         hFile.reset();
@@ -865,26 +305,22 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
 
     #ifdef DIRECTX_ENABLE_XMA2
         bool xma = false;
-        if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
+        for (uint32_t j = 0; j < m_bank.data.dwEntryCount; ++j)
         {
-            if (m_data.CompactFormat.wFormatTag == MINIWAVEFORMAT::TAG_XMA)
-                xma = true;
-        }
-        else
-        {
-            for (uint32_t j = 0; j < m_data.dwEntryCount; ++j)
+            if (m_bank.GetFormat(j).wFormatTag == MINIWAVEFORMAT::TAG_XMA)
             {
-                auto& entry = reinterpret_cast<const ENTRY*>(m_entries.get())[j];
-                if (entry.Format.wFormatTag == MINIWAVEFORMAT::TAG_XMA)
-                {
-                    xma = true;
-                    break;
-                }
+                xma = true;
+                break;
             }
         }
 
         if (xma)
         {
+            if (memoryMapped)
+            {
+                DebugTrace("INFO: XMA wave data must be in APU memory, so \"%ls\" is read rather than memory-mapped\n", szFileName);
+            }
+
             HRESULT hr = ApuAlloc(&m_xmaMemory, nullptr, waveLen, SHAPE_XMA_INPUT_BUFFER_ALIGNMENT);
             if (FAILED(hr))
             {
@@ -896,6 +332,17 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
         }
         else
         #endif // XMA2
+        if (memoryMapped)
+        {
+            // The mapping keeps the file open, and the bank is usable as soon as the view exists
+            HRESULT hr = MapWaveData(hFile.get(), m_bank.WaveData().dwOffset, waveLen);
+            if (FAILED(hr))
+                return hr;
+
+            m_prepared = true;
+            return S_OK;
+        }
+        else
         {
             m_waveData.reset(new (std::nothrow) uint8_t[waveLen]);
             if (!m_waveData)
@@ -905,7 +352,7 @@ HRESULT WaveBankReader::Impl::Open(const wchar_t* szFileName) noexcept(false)
         }
 
         memset(&m_request, 0, sizeof(OVERLAPPED));
-        m_request.Offset = m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset;
+        m_request.Offset = m_bank.WaveData().dwOffset;
         m_request.hEvent = m_event.get();
 
         if (!ReadFile(hFile.get(), dest, waveLen, nullptr, &m_request))
@@ -948,6 +395,14 @@ void WaveBankReader::Impl::Close() noexcept
     }
     m_event.reset();
 
+    if (m_mappedView)
+    {
+        std::ignore = UnmapViewOfFile(m_mappedView);
+        m_mappedView = nullptr;
+        m_mappedWaveData = nullptr;
+    }
+    m_mapping.reset();
+
 #ifdef DIRECTX_ENABLE_XMA2
     if (m_xmaMemory)
     {
@@ -964,12 +419,12 @@ HRESULT WaveBankReader::Impl::GetFormat(uint32_t index, WAVEFORMATEX* pFormat, s
     if (!pFormat || !maxsize)
         return E_INVALIDARG;
 
-    if (index >= m_data.dwEntryCount || !m_entries)
+    if (!m_bank.IsValidIndex(index))
     {
         return E_FAIL;
     }
 
-    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries.get())[index].Format);
+    auto& miniFmt = m_bank.GetFormat(index);
 
     switch (miniFmt.wFormatTag)
     {
@@ -994,7 +449,7 @@ HRESULT WaveBankReader::Impl::GetFormat(uint32_t index, WAVEFORMATEX* pFormat, s
         {
             auto adpcmFmt = reinterpret_cast<ADPCMWAVEFORMAT*>(pFormat);
             adpcmFmt->wSamplesPerBlock = static_cast<WORD>(miniFmt.AdpcmSamplesPerBlock());
-            miniFmt.AdpcmFillCoefficientTable(adpcmFmt);
+            AdpcmFillCoefficientTable(adpcmFmt);
         }
         break;
 
@@ -1020,7 +475,7 @@ HRESULT WaveBankReader::Impl::GetFormat(uint32_t index, WAVEFORMATEX* pFormat, s
             xmaFmt->BytesPerBlock = 65536 /* XACT_FIXED_XMA_BLOCK_SIZE */;
             xmaFmt->EncoderVersion = 4 /* XMAENCODER_VERSION_XMA2 */;
 
-            auto seekTable = FindSeekTable(index, m_seekData.get(), m_header, m_data);
+            auto seekTable = m_bank.FindSeekTable(index);
             if (seekTable)
             {
                 xmaFmt->BlockCount = static_cast<WORD>(*seekTable);
@@ -1043,21 +498,16 @@ HRESULT WaveBankReader::Impl::GetFormat(uint32_t index, WAVEFORMATEX* pFormat, s
             default: xmaFmt->ChannelMask = DWORD(-1); break;
             }
 
-            if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
+            if (m_bank.IsCompact())
             {
-                auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get())[index];
-
-                DWORD dwOffset, dwLength;
-                entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get()));
-
-                xmaFmt->SamplesEncoded = entry.GetDuration(dwLength, m_data, seekTable);
+                xmaFmt->SamplesEncoded = m_bank.GetEntry(index).duration;
 
                 xmaFmt->PlayBegin = xmaFmt->PlayLength =
                     xmaFmt->LoopBegin = xmaFmt->LoopLength = xmaFmt->LoopCount = 0;
             }
             else
             {
-                auto& entry = reinterpret_cast<const ENTRY*>(m_entries.get())[index];
+                auto& entry = reinterpret_cast<const ENTRY*>(m_bank.entries.get())[index];
 
                 xmaFmt->SamplesEncoded = entry.Duration;
                 xmaFmt->PlayBegin = 0;
@@ -1100,21 +550,22 @@ HRESULT WaveBankReader::Impl::GetWaveData(uint32_t index, const uint8_t** pData,
     if (!pData)
         return E_INVALIDARG;
 
-    if (index >= m_data.dwEntryCount || !m_entries)
+    if (!m_bank.IsValidIndex(index))
     {
         return E_FAIL;
     }
 
 #ifdef DIRECTX_ENABLE_XMA2
-    const uint8_t* waveData = (m_xmaMemory) ? reinterpret_cast<uint8_t*>(m_xmaMemory) : m_waveData.get();
+    const uint8_t* waveData = (m_xmaMemory) ? reinterpret_cast<uint8_t*>(m_xmaMemory)
+        : ((m_mappedWaveData) ? m_mappedWaveData : m_waveData.get());
 #else
-    const uint8_t* waveData = m_waveData.get();
+    const uint8_t* waveData = (m_mappedWaveData) ? m_mappedWaveData : m_waveData.get();
 #endif
 
     if (!waveData)
         return E_FAIL;
 
-    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
+    if (m_bank.IsStreaming())
     {
         return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
     }
@@ -1124,33 +575,14 @@ HRESULT WaveBankReader::Impl::GetWaveData(uint32_t index, const uint8_t** pData,
         return HRESULT_FROM_WIN32(ERROR_IO_INCOMPLETE);
     }
 
-    if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
+    const EntryInfo entry = m_bank.GetEntry(index);
+    if (!m_bank.IsInWaveData(entry))
     {
-        auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get())[index];
-
-        DWORD dwOffset, dwLength;
-        entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get()));
-
-        if ((uint64_t(dwOffset) + uint64_t(dwLength)) > uint64_t(m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength))
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        *pData = &waveData[dwOffset];
-        dataSize = dwLength;
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
     }
-    else
-    {
-        auto& entry = reinterpret_cast<const ENTRY*>(m_entries.get())[index];
 
-        if ((uint64_t(entry.PlayRegion.dwOffset) + uint64_t(entry.PlayRegion.dwLength)) > uint64_t(m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength))
-        {
-            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-        }
-
-        *pData = &waveData[entry.PlayRegion.dwOffset];
-        dataSize = entry.PlayRegion.dwLength;
-    }
+    *pData = &waveData[entry.offsetBytes];
+    dataSize = entry.lengthBytes;
 
     return S_OK;
 }
@@ -1166,15 +598,15 @@ HRESULT WaveBankReader::Impl::GetSeekTable(uint32_t index, const uint32_t** pDat
     dataCount = 0;
     tag = 0;
 
-    if (index >= m_data.dwEntryCount || !m_entries)
+    if (!m_bank.IsValidIndex(index))
     {
         return E_FAIL;
     }
 
-    if (!m_seekData)
+    if (!m_bank.seekData)
         return S_OK;
 
-    auto& miniFmt = (m_data.dwFlags & BANKDATA::FLAGS_COMPACT) ? m_data.CompactFormat : (reinterpret_cast<const ENTRY*>(m_entries.get())[index].Format);
+    auto& miniFmt = m_bank.GetFormat(index);
 
     switch (miniFmt.wFormatTag)
     {
@@ -1190,7 +622,7 @@ HRESULT WaveBankReader::Impl::GetSeekTable(uint32_t index, const uint32_t** pDat
         return S_OK;
     }
 
-    auto seekTable = FindSeekTable(index, m_seekData.get(), m_header, m_data);
+    auto seekTable = m_bank.FindSeekTable(index);
     if (!seekTable)
         return S_OK;
 
@@ -1204,59 +636,133 @@ HRESULT WaveBankReader::Impl::GetSeekTable(uint32_t index, const uint32_t** pDat
 _Use_decl_annotations_
 HRESULT WaveBankReader::Impl::GetMetadata(uint32_t index, Metadata& metadata) const noexcept
 {
-    if (index >= m_data.dwEntryCount || !m_entries)
+    if (!m_bank.IsValidIndex(index))
     {
         return E_FAIL;
     }
 
-    if (m_data.dwFlags & BANKDATA::FLAGS_COMPACT)
+    const EntryInfo entry = m_bank.GetEntry(index);
+    metadata.duration = entry.duration;
+    metadata.loopStart = entry.loopStart;
+    metadata.loopLength = entry.loopLength;
+    metadata.offsetBytes = entry.offsetBytes;
+    metadata.lengthBytes = entry.lengthBytes;
+
+    if (m_bank.IsStreaming())
+    {
+        const uint64_t offset = uint64_t(metadata.offsetBytes) + uint64_t(m_bank.WaveData().dwOffset);
+        if (offset > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        metadata.offsetBytes = static_cast<uint32_t>(offset);
+    }
+
+    return S_OK;
+}
+
+
+_Use_decl_annotations_
+HRESULT WaveBankReader::Impl::MapWaveData(HANDLE hFile, uint32_t offset, uint32_t length) noexcept
+{
+    // Views must start on the allocation granularity, which is coarser than the bank's wave alignment
+    SYSTEM_INFO info = {};
+    GetSystemInfo(&info);
+
+    const uint32_t granularity = (info.dwAllocationGranularity > 0) ? info.dwAllocationGranularity : 65536u;
+    const uint32_t viewOffset = offset - (offset % granularity);
+    const SIZE_T viewSize = SIZE_T(offset - viewOffset) + length;
+
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    m_mapping.reset(CreateFileMappingFromApp(hFile, nullptr, PAGE_READONLY, 0, nullptr));
+#else
+    m_mapping.reset(CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr));
+#endif
+    if (!m_mapping)
     {
-        auto& entry = reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get())[index];
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    m_mappedView = MapViewOfFileFromApp(m_mapping.get(), FILE_MAP_READ, viewOffset, viewSize);
+#else
+    m_mappedView = MapViewOfFile(m_mapping.get(), FILE_MAP_READ, 0, viewOffset, viewSize);
+#endif
+    if (!m_mappedView)
+    {
+        const DWORD error = GetLastError();
+        m_mapping.reset();
+        return HRESULT_FROM_WIN32(error);
+    }
+
+    m_mappedWaveData = static_cast<const uint8_t*>(m_mappedView) + (offset - viewOffset);
+    return S_OK;
+}
+
 
-        DWORD dwOffset, dwLength;
-        entry.ComputeLocations(dwOffset, dwLength, index, m_header, m_data, reinterpret_cast<const ENTRYCOMPACT*>(m_entries.get()));
+void WaveBankReader::Impl::BuildNameIndex(uint32_t count)
+{
+    m_names.resize(count);
+    for (uint32_t j = 0; j < count; ++j)
+    {
+        m_names[j].hash = WaveBankNameHash(m_bank.GetName(j));
+        m_names[j].index = j;
+    }
 
-        if (m_seekData)
+    // Ties are ordered by descending index, so a name used by several entries finds the last of them
+    std::sort(m_names.begin(), m_names.end(), [](const NameIndex& a, const NameIndex& b) noexcept
         {
-            auto seekTable = FindSeekTable(index, m_seekData.get(), m_header, m_data);
-            if (seekTable)
-            {
-                metadata.duration = entry.GetDuration(dwLength, m_data, seekTable);
-            }
-            else
-            {
-                metadata.duration = entry.GetDuration(dwLength, m_data, nullptr);
-            }
-        }
-        else
+            return (a.hash != b.hash) ? (a.hash < b.hash) : (a.index > b.index);
+        });
+
+#ifdef _DEBUG
+    for (size_t j = 1; j < m_names.size(); ++j)
+    {
+        const char* a = m_bank.GetName(m_names[j - 1].index);
+        const char* b = m_bank.GetName(m_names[j].index);
+        if (m_names[j - 1].hash == m_names[j].hash && strcmp(a, b) != 0)
         {
-            metadata.duration = entry.GetDuration(dwLength, m_data, nullptr);
+            DebugTrace("WARNING: Wave bank entry names '%hs' and '%hs' have the same hash\n", a, b);
         }
-        metadata.loopStart = metadata.loopLength = 0;
-        metadata.offsetBytes = dwOffset;
-        metadata.lengthBytes = dwLength;
     }
-    else
-    {
-        auto& entry = reinterpret_cast<const ENTRY*>(m_entries.get())[index];
+#endif
+}
 
-        metadata.duration = entry.Duration;
-        metadata.loopStart = entry.LoopRegion.dwStartSample;
-        metadata.loopLength = entry.LoopRegion.dwTotalSamples;
-        metadata.offsetBytes = entry.PlayRegion.dwOffset;
-        metadata.lengthBytes = entry.PlayRegion.dwLength;
-    }
 
-    if (m_data.dwFlags & BANKDATA::TYPE_STREAMING)
+_Use_decl_annotations_
+uint32_t WaveBankReader::Impl::FindName(const char* name) const noexcept
+{
+    const uint64_t hash = WaveBankNameHash(name);
+
+    auto it = std::lower_bound(m_names.cbegin(), m_names.cend(), hash,
+        [](const NameIndex& entry, uint64_t value) noexcept { return entry.hash < value; });
+
+    for (; it != m_names.cend() && it->hash == hash; ++it)
     {
-        const uint64_t offset = uint64_t(metadata.offsetBytes) + uint64_t(m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset);
-        if (offset > UINT32_MAX)
-            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+        if (strcmp(m_bank.GetName(it->index), name) == 0)
+            return it->index;
+    }
 
-        metadata.offsetBytes = static_cast<uint32_t>(offset);
+    return uint32_t(-1);
+}
+
+
+uint32_t WaveBankReader::Impl::FindName(uint64_t nameHash) const noexcept
+{
+    auto it = std::lower_bound(m_names.cbegin(), m_names.cend(), nameHash,
+        [](const NameIndex& entry, uint64_t value) noexcept { return entry.hash < value; });
+
+    if (it == m_names.cend() || it->hash != nameHash)
+        return uint32_t(-1);
+
+    // A hash shared by different names can't be resolved without the name itself
+    const char* name = m_bank.GetName(it->index);
+    for (auto next = it + 1; next != m_names.cend() && next->hash == nameHash; ++next)
+    {
+        if (strcmp(m_bank.GetName(next->index), name) != 0)
+            return uint32_t(-1);
     }
 
-    return S_OK;
+    return it->index;
 }
 
 
@@ -1303,22 +809,22 @@ WaveBankReader::~WaveBankReader()
 
 
 _Use_decl_annotations_
-HRESULT WaveBankReader::Open(const wchar_t* szFileName) noexcept
+HRESULT WaveBankReader::Open(const wchar_t* szFileName, bool memoryMapped) noexcept
 {
-    return pImpl->Open(szFileName);
+    return pImpl->Open(szFileName, memoryMapped);
 }
 
 
 _Use_decl_annotations_
 uint32_t WaveBankReader::Find(const char* name) const
 {
-    auto it = pImpl->m_names.find(name);
-    if (it != pImpl->m_names.cend())
-    {
-        return it->second;
-    }
+    return pImpl->FindName(name);
+}
 
-    return uint32_t(-1);
+
+uint32_t WaveBankReader::Find(uint64_t nameHash) const noexcept
+{
+    return pImpl->FindName(nameHash);
 }
 
 
@@ -1353,7 +859,7 @@ bool WaveBankReader::HasNames() const noexcept
 
 bool WaveBankReader::IsStreamingBank() const noexcept
 {
-    return (pImpl->m_data.dwFlags  & BANKDATA::TYPE_STREAMING) != 0;
+    return pImpl->m_bank.IsStreaming();
 }
 
 
@@ -1367,19 +873,19 @@ bool WaveBankReader::HasXMA() const noexcept
 
 const char* WaveBankReader::BankName() const noexcept
 {
-    return pImpl->m_data.szBankName;
+    return pImpl->m_bank.data.szBankName;
 }
 
 
 uint32_t WaveBankReader::Count() const noexcept
 {
-    return pImpl->m_data.dwEntryCount;
+    return pImpl->m_bank.data.dwEntryCount;
 }
 
 
 uint32_t WaveBankReader::BankAudioSize() const noexcept
 {
-    return pImpl->m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength;
+    return pImpl->m_bank.WaveData().dwLength;
 }
 
 
@@ -1413,11 +919,11 @@ HRESULT WaveBankReader::GetMetadata(uint32_t index, Metadata& metadata) const no
 
 HANDLE WaveBankReader::GetAsyncHandle() const noexcept
 {
-    return (pImpl->m_data.dwFlags & BANKDATA::TYPE_STREAMING) ? pImpl->m_async : INVALID_HANDLE_VALUE;
+    return pImpl->m_bank.IsStreaming() ? pImpl->m_async : INVALID_HANDLE_VALUE;
 }
 
 
 uint32_t WaveBankReader::GetWaveAlignment() const noexcept
 {
-    return pImpl->m_data.dwAlignment;
+    return pImpl->m_bank.data.dwAlignment;
 }
@@ -34,9 +34,10 @@ namespace DirectX
 
         ~WaveBankReader();
 
-        HRESULT Open(_In_z_ const wchar_t* szFileName) noexcept;
+        HRESULT Open(_In_z_ const wchar_t* szFileName, bool memoryMapped = false) noexcept;
 
         uint32_t Find(_In_z_ const char* name) const;
+        uint32_t Find(uint64_t nameHash) const noexcept;
 
         bool IsPrepared() noexcept;
         void WaitOnPrepare() noexcept;
@@ -68,12 +68,15 @@ namespace DirectX
 {
     class SoundEffectInstance;
     class SoundStreamInstance;
+    class IVirtualVoice;
+    class IStreamReader;
 
     //----------------------------------------------------------------------------------
     struct AudioStatistics
     {
         size_t  playingOneShots;        // Number of one-shot sounds currently playing
         size_t  playingInstances;       // Number of sound effect instances currently playing
+        size_t  virtualInstances;       // Number of playing instances without a voice (see SetVirtualVoiceBudget)
         size_t  allocatedInstances;     // Number of SoundEffectInstance allocated
         size_t  allocatedVoices;        // Number of XAudio2 voices allocated (standard, 3D, one-shots, and idle one-shots)
         size_t  allocatedVoices3d;      // Number of XAudio2 voices allocated for 3D
@@ -84,6 +87,8 @@ namespace DirectX
         size_t  xmaAudioBytes;          // Total wave data (in bytes) in SoundEffects and in-memory WaveBanks allocated with ApuAlloc
     #endif
         size_t  streamingBytes;         // Total size of streaming buffers (in bytes) in streaming WaveBanks
+        size_t  streamingStarvations;   // Number of times a playing SoundStreamInstance ran out of data before its next read completed
+        size_t  streamingReadsQueued;   // Number of streaming reads waiting to be issued (see SetStreamingParameters)
     };
 
 
@@ -140,6 +145,7 @@ namespace DirectX
         AudioEngine_Debug = 0x10000,
         AudioEngine_ThrowOnNoAudioHW = 0x20000,
         AudioEngine_DisableVoiceReuse = 0x40000,
+        AudioEngine_SoftwareMixer = 0x80000,
     };
 
     enum SOUND_EFFECT_INSTANCE_FLAGS : uint32_t
@@ -149,10 +155,18 @@ namespace DirectX
         SoundEffectInstance_Use3D = 0x1,
         SoundEffectInstance_ReverbUseFilters = 0x2,
         SoundEffectInstance_NoSetPitch = 0x4,
+        SoundEffectInstance_Virtualize = 0x8,
 
         SoundEffectInstance_UseRedirectLFE = 0x10000,
     };
 
+    enum WAVE_BANK_FLAGS : uint32_t
+    {
+        WaveBank_Default = 0x0,
+
+        WaveBank_MemoryMapped = 0x1,
+    };
+
     enum AUDIO_ENGINE_REVERB : unsigned int
     {
         Reverb_Off,
@@ -259,6 +273,11 @@ namespace DirectX
         bool __cdecl IsCriticalError() const noexcept;
             // Returns true if the audio graph is halted due to a critical error (which also places the engine into 'silent mode')
 
+        void __cdecl Render(_Out_writes_opt_(_Inexpressible_("frames * GetOutputChannels()")) float* output, size_t frames);
+            // Mixes the next 'frames' frames of interleaved float output (null discards them) when created with
+            // AudioEngine_SoftwareMixer, which has no output device and only advances when this is called
+            // Note: effect chains such as reverb and the mastering limiter are bypassed by the software mixer
+
         // Voice pool management.
         void __cdecl SetDefaultSampleRate(int sampleRate);
             // Sample rate for voices in the reuse pool (defaults to 44100)
@@ -270,6 +289,22 @@ namespace DirectX
         void __cdecl TrimVoicePool();
             // Releases any currently unused voices
 
+        void __cdecl SetVoicePoolWatermarks(size_t lowWatermark, size_t highWatermark, _In_opt_ const WAVEFORMATEX* wfx = nullptr);
+            // Idle one-shot voices kept per reuse format: WaveBanks prewarm up to the low watermark (defaults to 1) when
+            // loaded, and finished one-shots beyond the high watermark (defaults to unlimited) are released
+            // Note: with no format this sets the defaults and applies them to every format
+
+        void __cdecl SetVirtualVoiceBudget(size_t maxRealVoices, float minAudibility = 0.f);
+            // Instances created with SoundEffectInstance_Virtualize only own a voice while they rank within maxRealVoices
+            // (by priority, then audibility) and their peak gain is at least minAudibility; the rest keep playing
+            // virtually, and each Update promotes or demotes them
+
+        void __cdecl SetStreamingParameters(size_t bufferCount, size_t packetBytes = 0, size_t maxPendingReads = 0);
+            // Packets each SoundStreamInstance created afterwards reads ahead (2 to 16, defaults to 3) and their size in
+            // bytes (0 picks two seconds of audio; sizes are rounded up to the wave bank alignment with a 64K minimum)
+            // Note: reads from all streams are issued most urgent first, by how soon each stream would run out of data,
+            // with at most maxPendingReads outstanding (0 for unlimited); a limit helps on slow or seek-bound media
+
         // Internal-use functions
         void __cdecl AllocateVoice(_In_ const WAVEFORMATEX* wfx,
             SOUND_EFFECT_INSTANCE_FLAGS flags, bool oneshot, _Outptr_result_maybenull_ IXAudio2SourceVoice** voice);
@@ -277,9 +312,24 @@ namespace DirectX
         void __cdecl DestroyVoice(_In_ IXAudio2SourceVoice* voice) noexcept;
             // Should only be called for instance voices, not one-shots
 
+        void __cdecl PrewarmVoices(_In_ const WAVEFORMATEX* wfx);
+            // Creates idle one-shot voices for the format until its pool holds the low watermark, within the
+            // maxVoiceOneshots limit; finished one-shots beyond the high watermark are destroyed rather than pooled
+            // Note: does nothing if AudioEngine_DisableVoiceReuse is set
+
         void __cdecl RegisterNotify(_In_ IVoiceNotify* notify, bool usesUpdate);
         void __cdecl UnregisterNotify(_In_ IVoiceNotify* notify, bool usesOneShots, bool usesUpdate);
 
+        void __cdecl RegisterVirtualVoice(_In_ IVirtualVoice* voice);
+        void __cdecl UnregisterVirtualVoice(_In_ IVirtualVoice* voice) noexcept;
+
+        void __cdecl GetStreamingParameters(_Out_ size_t* bufferCount, _Out_ size_t* packetBytes) const noexcept;
+
+        void __cdecl QueueStreamRead(_In_ IStreamReader* reader, uint32_t packet, uint64_t deadline);
+        void __cdecl CompleteStreamRead() noexcept;
+        void __cdecl CancelStreamReads(_In_ IStreamReader* reader, size_t pendingReads) noexcept;
+            // Deadlines are in milliseconds on the std::chrono::steady_clock
+
         // XAudio2 interface access
         IXAudio2* __cdecl GetInterface() const noexcept;
         IXAudio2MasteringVoice* __cdecl GetMasterVoice() const noexcept;
@@ -314,10 +364,25 @@ namespace DirectX
 
 
     //----------------------------------------------------------------------------------
+    // FNV-1a hash of a wave bank entry name for WaveBank::Find, which hot call sites can compute at compile time:
+    //     constexpr uint64_t c_explosion = WaveBankNameHash("Explosion");
+    constexpr uint64_t WaveBankNameHash(_In_z_ const char* name) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (; *name; ++name)
+        {
+            hash ^= static_cast<uint8_t>(*name);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
     class WaveBank
     {
     public:
-        WaveBank(_In_ AudioEngine* engine, _In_z_ const wchar_t* wbFileName);
+        WaveBank(_In_ AudioEngine* engine, _In_z_ const wchar_t* wbFileName, WAVE_BANK_FLAGS flags = WaveBank_Default);
+        // WaveBank_MemoryMapped maps the wave data of an in-memory bank rather than reading it, so the bank is
+        // prepared at once and only the waves that are played are paged in (XMA banks are always read)
 
         WaveBank(WaveBank&&) noexcept;
         WaveBank& operator= (WaveBank&&) noexcept;
@@ -348,6 +413,10 @@ namespace DirectX
         bool __cdecl IsStreamingBank() const noexcept;
         bool __cdecl IsAdvancedFormat() const noexcept;
 
+        void __cdecl DecompressADPCM();
+        // Decodes every MS-ADPCM entry of an in-memory bank to 16-bit PCM at load, trading memory for playback CPU
+        // Note: waits for the bank to finish loading, and throws if there are any instances or playing one-shots
+
         size_t __cdecl GetSampleSizeInBytes(unsigned int index) const noexcept;
         // Returns size of wave audio data
 
@@ -360,6 +429,9 @@ namespace DirectX
         const WAVEFORMATEX* __cdecl GetFormat(unsigned int index, _Out_writes_bytes_(maxsize) WAVEFORMATEX* wfx, size_t maxsize) const noexcept;
 
         int __cdecl Find(_In_z_ const char* name) const;
+        int __cdecl Find(uint64_t nameHash) const noexcept;
+        // Returns the index of the named entry, or -1 if there is none; nameHash is WaveBankNameHash(name)
+        // The hash lookup also returns -1 when different names in the bank share that hash; use the name instead
 
     #ifdef USING_XAUDIO2_9
         bool __cdecl FillSubmitBuffer(unsigned int index, _Out_ XAUDIO2_BUFFER& buffer, _Out_ XAUDIO2_BUFFER_WMA& wmaBuffer) const;
@@ -374,7 +446,7 @@ namespace DirectX
         bool __cdecl GetPrivateData(unsigned int index, _Out_writes_bytes_(datasize) void* data, size_t datasize);
 
 #if defined(_MSC_VER) && !defined(_NATIVE_WCHAR_T_DEFINED)
-        WaveBank(_In_ AudioEngine* engine, _In_z_ const __wchar_t* wbFileName);
+        WaveBank(_In_ AudioEngine* engine, _In_z_ const __wchar_t* wbFileName, WAVE_BANK_FLAGS flags = WaveBank_Default);
 #endif
 
     private:
@@ -686,6 +758,18 @@ namespace DirectX
 
         void __cdecl Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAUDIO_EMITTER& emitter, bool rhcoords = true);
 
+        static void __cdecl Apply3D(const X3DAUDIO_LISTENER& listener,
+            _In_reads_(count) SoundEffectInstance* const* instances,
+            _In_reads_(count) const X3DAUDIO_EMITTER* const* emitters,
+            size_t count, bool rhcoords = true);
+            // Spatializes many instances against one listener; mono emitters are computed together in one SIMD pass
+
+        void __cdecl SetPriority(int priority) noexcept;
+            // Ranking used for voice scheduling with SoundEffectInstance_Virtualize (higher is kept first)
+
+        bool __cdecl IsVirtual() const noexcept;
+            // Returns true if the instance is playing without a voice
+
         bool __cdecl IsLooped() const noexcept;
 
         SoundState __cdecl GetState() noexcept;
@@ -732,6 +816,12 @@ namespace DirectX
 
         void __cdecl Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAUDIO_EMITTER& emitter, bool rhcoords = true);
 
+        static void __cdecl Apply3D(const X3DAUDIO_LISTENER& listener,
+            _In_reads_(count) SoundStreamInstance* const* instances,
+            _In_reads_(count) const X3DAUDIO_EMITTER* const* emitters,
+            size_t count, bool rhcoords = true);
+            // Spatializes many instances against one listener; mono emitters are computed together in one SIMD pass
+
         bool __cdecl IsLooped() const noexcept;
 
         SoundState __cdecl GetState() noexcept;
@@ -762,6 +852,12 @@ namespace DirectX
             int sampleRate, int channels, int sampleBits = 16,
             SOUND_EFFECT_INSTANCE_FLAGS flags = SoundEffectInstance_Default);
 
+        DynamicSoundEffectInstance(_In_ AudioEngine* engine, size_t ringBufferBytes,
+            int sampleRate, int channels, int sampleBits = 16,
+            SOUND_EFFECT_INSTANCE_FLAGS flags = SoundEffectInstance_Default);
+            // Plays audio written with WriteRingBuffer instead of SubmitBuffer. The ring is sized in bytes (rounded up
+            // to whole samples), and each AudioEngine::Update submits newly written data to the voice in place.
+
         DynamicSoundEffectInstance(DynamicSoundEffectInstance&&) noexcept;
         DynamicSoundEffectInstance& operator= (DynamicSoundEffectInstance&&) noexcept;
 
@@ -781,9 +877,28 @@ namespace DirectX
 
         void __cdecl Apply3D(const X3DAUDIO_LISTENER& listener, const X3DAUDIO_EMITTER& emitter, bool rhcoords = true);
 
+        static void __cdecl Apply3D(const X3DAUDIO_LISTENER& listener,
+            _In_reads_(count) DynamicSoundEffectInstance* const* instances,
+            _In_reads_(count) const X3DAUDIO_EMITTER* const* emitters,
+            size_t count, bool rhcoords = true);
+            // Spatializes many instances against one listener; mono emitters are computed together in one SIMD pass
+
         void __cdecl SubmitBuffer(_In_reads_bytes_(audioBytes) const uint8_t* pAudioData, size_t audioBytes);
         void __cdecl SubmitBuffer(_In_reads_bytes_(audioBytes) const uint8_t* pAudioData, uint32_t offset, size_t audioBytes);
 
+        size_t __cdecl WriteRingBuffer(_In_reads_bytes_(audioBytes) const uint8_t* pAudioData, size_t audioBytes) noexcept;
+            // Copies whole samples into the ring buffer and returns the bytes written; what does not fit is dropped
+            // Note: lock-free and safe to call from one producer thread while the engine is updated on another
+
+        size_t __cdecl GetRingBufferSpace() const noexcept;
+            // Returns how many bytes WriteRingBuffer can accept now (space is freed as the voice finishes with data)
+
+        size_t __cdecl GetUnderrunCount() const noexcept;
+            // Returns how many times the voice ran out of ring buffer data while playing
+
+        size_t __cdecl GetOverrunCount() const noexcept;
+            // Returns how many WriteRingBuffer calls dropped data because the ring buffer was full
+
         SoundState __cdecl GetState() noexcept;
 
         size_t __cdecl GetSampleDuration(size_t bytes) const noexcept;
@@ -815,6 +930,7 @@ namespace DirectX
 
     DEFINE_ENUM_FLAG_OPERATORS(AUDIO_ENGINE_FLAGS);
     DEFINE_ENUM_FLAG_OPERATORS(SOUND_EFFECT_INSTANCE_FLAGS);
+    DEFINE_ENUM_FLAG_OPERATORS(WAVE_BANK_FLAGS);
 
 #ifdef __clang__
 #pragma clang diagnostic pop
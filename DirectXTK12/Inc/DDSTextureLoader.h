@@ -58,6 +58,21 @@ namespace DirectX
             DDS_LOADER_MIP_AUTOGEN = 0x8,
             DDS_LOADER_MIP_RESERVE = 0x10,
         };
+
+        // Description of a DDS file, as the loaders would create it without a maxsize.
+        struct DDSMetadata
+        {
+            D3D12_RESOURCE_DIMENSION dimension;
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t arraySize;     // Includes the six faces of each cubemap
+            uint32_t mipLevels;
+            DXGI_FORMAT format;
+            DDS_ALPHA_MODE alphaMode;
+            bool isCubeMap;
+            uint64_t dataSize;      // Bytes of image data following the header
+        };
     }
 
     // Standard version
@@ -116,6 +131,20 @@ namespace DirectX
         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
         _Out_opt_ bool* isCubeMap = nullptr);
 
+    // Legacy 24bpp files are expanded to R8G8B8A8; the subresources then point into decodedData.
+    HRESULT __cdecl LoadDDSTextureFromMemoryEx(
+        _In_ ID3D12Device* d3dDevice,
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        size_t ddsDataSize,
+        size_t maxsize,
+        D3D12_RESOURCE_FLAGS resFlags,
+        DDS_LOADER_FLAGS loadFlags,
+        _Outptr_ ID3D12Resource** texture,
+        std::unique_ptr<uint8_t[]>& decodedData,
+        std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
+        _Out_opt_ bool* isCubeMap = nullptr);
+
     HRESULT __cdecl LoadDDSTextureFromFileEx(
         _In_ ID3D12Device* d3dDevice,
         _In_z_ const wchar_t* szFileName,
@@ -152,6 +181,25 @@ namespace DirectX
         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
         _Out_opt_ bool* isCubeMap = nullptr);
 
+
+    // Metadata only. The file versions read just the header, not the image data.
+    HRESULT __cdecl GetDDSMetadataFromMemory(
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        size_t ddsDataSize,
+        _Out_ DDSMetadata& metadata) noexcept;
+
+    HRESULT __cdecl GetDDSMetadataFromFile(
+        _In_z_ const wchar_t* szFileName,
+        _Out_ DDSMetadata& metadata) noexcept;
+
+    // Scans the files in parallel. results receives the HRESULT for each file; the return value only
+    // reports failures of the scan itself.
+    HRESULT __cdecl GetDDSMetadataFromFiles(
+        _In_reads_(count) const wchar_t* const* szFileNames,
+        size_t count,
+        _Out_writes_(count) DDSMetadata* metadata,
+        _Out_writes_(count) HRESULT* results) noexcept;
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-dynamic-exception-spec"
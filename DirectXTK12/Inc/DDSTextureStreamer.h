@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// File: DDSTextureStreamer.h
+//
+// Streams DDS textures in the background, delivering the mip chain coarsest first so a
+// low-resolution version of each texture is usable as soon as possible.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _GAMING_XBOX_SCARLETT
+#include <d3d12_xs.h>
+#elif (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
+#include <d3d12_x.h>
+#elif defined(USING_DIRECTX_HEADERS)
+#include <directx/d3d12.h>
+#include <dxguids/dxguids.h>
+#else
+#include <d3d12.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "DDSTextureLoader.h"
+
+
+namespace DirectX
+{
+    class ResourceUploadBatch;
+
+    inline namespace DX12
+    {
+        class DDSTextureStreamer
+        {
+        public:
+            static constexpr uint64_t DefaultUploadBudget = 16 * 1024 * 1024;
+            static constexpr uint64_t DefaultTailSize = 64 * 1024;
+
+            // ioThreads reads run concurrently. The smallest mips, up to tailSize bytes, are read and uploaded together.
+            explicit DDSTextureStreamer(_In_ ID3D12Device* device,
+                size_t ioThreads = 2,
+                uint64_t uploadBudget = DefaultUploadBudget,
+                uint64_t tailSize = DefaultTailSize);
+
+            DDSTextureStreamer(DDSTextureStreamer&&) noexcept;
+            DDSTextureStreamer& operator= (DDSTextureStreamer&&) noexcept;
+
+            DDSTextureStreamer(DDSTextureStreamer const&) = delete;
+            DDSTextureStreamer& operator= (DDSTextureStreamer const&) = delete;
+
+            virtual ~DDSTextureStreamer();
+
+            // Queues a DDS file for streaming, returning its texture index. The resource is created once the header
+            // has been read. Mips larger than maxsize are skipped, as with CreateDDSTextureFromFileEx.
+            size_t __cdecl Load(_In_z_ const wchar_t* fileName, size_t maxsize = 0, DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT);
+
+            // Records uploads for mips read since the last call, coarsest first across all textures, stopping once
+            // the per-frame byte budget is reached. Call between ResourceUploadBatch::Begin and End, and submit the
+            // batch before rendering with the new mips. Returns the number of bytes uploaded.
+            uint64_t __cdecl Update(ResourceUploadBatch& resourceUpload);
+
+            void __cdecl SetUploadBudget(uint64_t bytesPerFrame) noexcept;
+            uint64_t __cdecl GetUploadBudget() const noexcept;
+
+            // S_FALSE while streaming, S_OK once every mip is resident, or the error that stopped the load.
+            HRESULT __cdecl GetStatus(size_t texture) const;
+
+            // Null until the header has been read.
+            ID3D12Resource* __cdecl GetResource(size_t texture) const;
+
+            // Most detailed resident mip of the resource, or its mip count if no mips have been uploaded yet.
+            uint32_t __cdecl GetResidentMip(size_t texture) const;
+
+            bool __cdecl IsCubeMap(size_t texture) const;
+            DDS_ALPHA_MODE __cdecl GetAlphaMode(size_t texture) const;
+
+            size_t __cdecl GetTextureCount() const noexcept;
+
+            // Creates a view restricted to the resident mips. Recreate it as GetResidentMip changes.
+            void __cdecl CreateShaderResourceView(size_t texture, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const;
+
+        private:
+            // Private implementation.
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
+}
@@ -713,6 +713,14 @@ namespace DirectX
 
             virtual size_t __cdecl CreateTexture(_In_z_ const wchar_t* name, int descriptorIndex) = 0;
 
+            // Creates names[i] in descriptor descriptorOffset + i, returning its slot in slots[i] if given.
+            // The default calls CreateTexture for each name in turn.
+            virtual void __cdecl CreateTextures(
+                _In_reads_(count) const wchar_t* const* names,
+                size_t count,
+                int descriptorOffset,
+                _Out_writes_opt_(count) size_t* slots);
+
         protected:
             IEffectTextureFactory() = default;
             IEffectTextureFactory(IEffectTextureFactory&&) = default;
@@ -720,6 +728,14 @@ namespace DirectX
         };
 
 
+        struct EffectTextureFactoryStatistics
+        {
+            size_t texturesCreated;     // Textures loaded from a file
+            size_t nameMatches;         // Requests found in the cache by name
+            size_t contentMatches;      // Files whose contents matched an existing texture
+            uint64_t bytesSaved;        // File bytes of the content matches, which were not uploaded again
+        };
+
         // Factory for sharing texture resources
         class EffectTextureFactory : public IEffectTextureFactory
         {
@@ -745,6 +761,14 @@ namespace DirectX
 
             size_t __cdecl CreateTexture(_In_z_ const wchar_t* name, int descriptorIndex) override;
 
+            // Reads and decodes the files in parallel on worker threads. Only recording the uploads and creating
+            // the descriptors are serialized.
+            void __cdecl CreateTextures(
+                _In_reads_(count) const wchar_t* const* names,
+                size_t count,
+                int descriptorOffset,
+                _Out_writes_opt_(count) size_t* slots) override;
+
             ID3D12DescriptorHeap* __cdecl Heap() const noexcept;
 
             // Shorthand accessors for the descriptor heap
@@ -762,11 +786,19 @@ namespace DirectX
 
             void __cdecl SetSharing(bool enabled) noexcept;
 
+            // Also shares textures whose files have identical contents under different names. Files are hashed
+            // as they are read. Has no effect unless sharing is enabled.
+            void __cdecl SetContentSharing(bool enabled) noexcept;
+
             void __cdecl EnableForceSRGB(bool forceSRGB) noexcept;
             void __cdecl EnableAutoGenMips(bool generateMips) noexcept;
 
             void __cdecl SetDirectory(_In_opt_z_ const wchar_t* path) noexcept;
 
+            // Statistics
+            EffectTextureFactoryStatistics __cdecl GetStatistics() const;
+            void __cdecl ResetStatistics();
+
         private:
             // Private implementation
             class Impl;
@@ -53,8 +53,12 @@ namespace DirectX
                 void __cdecl End();
 
             protected:
-                // Internal, untyped drawing method.
+                // Internal, untyped drawing methods.
                 void __cdecl Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, _In_opt_count_(indexCount) uint16_t const* indices, size_t indexCount, size_t vertexCount, _Outptr_ void** pMappedVertices);
+                void __cdecl Draw(D3D_PRIMITIVE_TOPOLOGY topology, _In_reads_(indexCount) uint32_t const* indices, size_t indexCount, size_t vertexCount, _Outptr_ void** pMappedVertices);
+
+                // Internal bulk append for list topologies. Maps as many whole primitives as fit in the current page, returning the vertex count mapped.
+                size_t __cdecl Append(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, _Outptr_ void** pMappedVertices);
 
             private:
                 // Private implementation.
@@ -106,6 +110,34 @@ namespace DirectX
             }
 
 
+            // 32-bit index version, for batches using more than 65536 vertices per draw.
+            void DrawIndexed(D3D_PRIMITIVE_TOPOLOGY topology, _In_reads_(indexCount) uint32_t const* indices, size_t indexCount, _In_reads_(vertexCount) TVertex const* vertices, size_t vertexCount)
+            {
+                void* mappedVertices;
+
+                PrimitiveBatchBase::Draw(topology, indices, indexCount, vertexCount, &mappedVertices);
+
+                memcpy(mappedVertices, vertices, vertexCount * sizeof(TVertex));
+            }
+
+
+            // Copies a span of list primitives of any length, one page-sized chunk at a time.
+            void DrawList(D3D_PRIMITIVE_TOPOLOGY topology, _In_reads_(vertexCount) TVertex const* vertices, size_t vertexCount)
+            {
+                while (vertexCount > 0)
+                {
+                    void* mappedVertices;
+
+                    const size_t count = PrimitiveBatchBase::Append(topology, vertexCount, &mappedVertices);
+
+                    memcpy(mappedVertices, vertices, count * sizeof(TVertex));
+
+                    vertices += count;
+                    vertexCount -= count;
+                }
+            }
+
+
             void DrawLine(TVertex const& v1, TVertex const& v2)
             {
                 TVertex* mappedVertices;
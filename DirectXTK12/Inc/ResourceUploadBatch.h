@@ -35,6 +35,12 @@ namespace DirectX
     class ResourceUploadBatch
     {
     public:
+        enum class CpuMipFilter : uint32_t
+        {
+            Box,
+            Kaiser,
+        };
+
         explicit ResourceUploadBatch(_In_ ID3D12Device* device) noexcept(false);
 
         ResourceUploadBatch(ResourceUploadBatch&&) noexcept;
@@ -61,10 +67,30 @@ namespace DirectX
             const SharedGraphicsResource& buffer
         );
 
+        // Asynchronously copies consecutive subresources from another texture of the same format and size, such as the
+        // mips kept when a texture is recreated with a different mip count. The resource must be in the COPY_DEST state.
+        // The source is moved from sourceState for the copy and back, and kept alive until the copy completes.
+        void __cdecl CopySubresources(
+            _In_ ID3D12Resource* resource,
+            uint32_t destSubresourceStart,
+            _In_ ID3D12Resource* source,
+            uint32_t sourceSubresourceStart,
+            uint32_t numSubresources,
+            D3D12_RESOURCE_STATES sourceState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
         // Asynchronously generate mips from a resource.
         // Resource must be in the PIXEL_SHADER_RESOURCE state
         void __cdecl GenerateMips(_In_ ID3D12Resource* resource);
 
+        // Generates the rest of the mip chain on the CPU from mip 0 of each array slice, then uploads every subresource.
+        // Unlike GenerateMips this works on any queue type, and with texture arrays and cubemaps.
+        // The resource must be in the COPY_DEST state.
+        void __cdecl UploadAndGenerateMips(
+            _In_ ID3D12Resource* resource,
+            _In_reads_(numSlices) const D3D12_SUBRESOURCE_DATA* subRes,
+            uint32_t numSlices,
+            CpuMipFilter filter = CpuMipFilter::Box);
+
         // Transition a resource once you're done with it
         void __cdecl Transition(
             _In_ ID3D12Resource* resource,
@@ -79,6 +105,9 @@ namespace DirectX
         // Validates if the given DXGI format is supported for autogen mipmaps
         bool __cdecl IsSupportedForGenerateMips(DXGI_FORMAT format) noexcept;
 
+        // Validates if the given DXGI format is supported by UploadAndGenerateMips
+        static bool __cdecl IsSupportedForCpuGenerateMips(DXGI_FORMAT format) noexcept;
+
     private:
         // Private implementation.
         class Impl;
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// File: RetainedLineList.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _GAMING_XBOX_SCARLETT
+#include <d3d12_xs.h>
+#elif (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
+#include <d3d12_x.h>
+#elif defined(USING_DIRECTX_HEADERS)
+#include <directx/d3d12.h>
+#include <dxguids/dxguids.h>
+#else
+#include <d3d12.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+
+namespace DirectX
+{
+    inline namespace DX12
+    {
+        namespace Private
+        {
+            // Base class, not to be used directly: clients should access this via the derived RetainedLineList<T>.
+            class RetainedLineListBase
+            {
+            protected:
+                RetainedLineListBase(_In_ ID3D12Device* device, size_t maxLines, size_t linesPerPage, float fullUpdateThreshold, size_t vertexSize);
+
+                RetainedLineListBase(RetainedLineListBase&&) noexcept;
+                RetainedLineListBase& operator= (RetainedLineListBase&&) noexcept;
+
+                RetainedLineListBase(RetainedLineListBase const&) = delete;
+                RetainedLineListBase& operator= (RetainedLineListBase const&) = delete;
+
+                virtual ~RetainedLineListBase();
+
+            public:
+                // Copies the pages modified since the last call into the GPU vertex buffer.
+                void __cdecl Update(_In_ ID3D12GraphicsCommandList* commandList);
+
+                // Draws all lines. The pipeline state must already be set; Update must have been called after any changes.
+                void __cdecl Draw(_In_ ID3D12GraphicsCommandList* commandList) const;
+
+                size_t __cdecl GetLineCount() const noexcept;
+                size_t __cdecl GetMaxLines() const noexcept;
+
+                // Pages waiting for the next Update.
+                size_t __cdecl GetDirtyPageCount() const noexcept;
+
+                // Removes lines from the end of the list; the remaining lines are unchanged.
+                void __cdecl SetLineCount(size_t lineCount);
+                void __cdecl Clear() noexcept;
+
+            protected:
+                // Internal, untyped access to the CPU copy of the vertices. Write marks the lines as dirty.
+                void* __cdecl Write(size_t firstLine, size_t lineCount);
+                void const* __cdecl GetVertices() const noexcept;
+
+            private:
+                // Private implementation.
+                class Impl;
+
+                std::unique_ptr<Impl> pImpl;
+            };
+        }
+
+        // Line list kept in a persistent default heap vertex buffer, for debug geometry such as grids and gizmos
+        // that changes rarely. Only the pages containing modified lines are uploaded, falling back to a full
+        // rewrite once more than fullUpdateThreshold of the pages in use are dirty.
+        template<typename TVertex>
+        class RetainedLineList : public Private::RetainedLineListBase
+        {
+            static constexpr size_t DefaultLinesPerPage = 1024;
+
+        public:
+            explicit RetainedLineList(_In_ ID3D12Device* device,
+                size_t maxLines,
+                size_t linesPerPage = DefaultLinesPerPage,
+                float fullUpdateThreshold = 0.5f)
+                : RetainedLineListBase(device, maxLines, linesPerPage, fullUpdateThreshold, sizeof(TVertex))
+            {
+            }
+
+            RetainedLineList(RetainedLineList&&) = default;
+            RetainedLineList& operator= (RetainedLineList&&) = default;
+
+            RetainedLineList(RetainedLineList const&) = delete;
+            RetainedLineList& operator= (RetainedLineList const&) = delete;
+
+            // Appends a line, returning its index.
+            size_t AddLine(TVertex const& v1, TVertex const& v2)
+            {
+                const size_t index = GetLineCount();
+
+                SetLine(index, v1, v2);
+
+                return index;
+            }
+
+            // Replaces an existing line, or appends one if index equals GetLineCount().
+            void SetLine(size_t index, TVertex const& v1, TVertex const& v2)
+            {
+                auto mappedVertices = static_cast<TVertex*>(RetainedLineListBase::Write(index, 1));
+
+                mappedVertices[0] = v1;
+                mappedVertices[1] = v2;
+            }
+
+            // Replaces or appends lineCount lines, given as pairs of vertices.
+            void SetLines(size_t firstLine, _In_reads_(lineCount * 2) TVertex const* vertices, size_t lineCount)
+            {
+                void* mappedVertices = RetainedLineListBase::Write(firstLine, lineCount);
+
+                memcpy(mappedVertices, vertices, lineCount * 2 * sizeof(TVertex));
+            }
+
+            TVertex const* GetVertices() const noexcept
+            {
+                return static_cast<TVertex const*>(RetainedLineListBase::GetVertices());
+            }
+        };
+    }
+}
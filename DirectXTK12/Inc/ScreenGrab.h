@@ -27,7 +27,9 @@
 #include <d3d12.h>
 #endif
 
+#include <cstddef>
 #include <functional>
+#include <memory>
 
 #if defined(NTDDI_WIN10_FE) || defined(__MINGW32__)
 #include <ocidl.h>
@@ -47,6 +49,16 @@ namespace DirectX
         D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET,
         D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET) noexcept;
 
+    // Block-compresses the capture on the CPU before writing it. compressFormat is BC1, BC3, BC4, BC5, or BC7, and the
+    // _SRGB variant is written when the source is sRGB. The source must be an 8-bit RGBA/BGRA or float RGBA format.
+    HRESULT __cdecl SaveDDSTextureToFile(
+        _In_ ID3D12CommandQueue* pCommandQueue,
+        _In_ ID3D12Resource* pSource,
+        _In_z_ const wchar_t* fileName,
+        DXGI_FORMAT compressFormat,
+        D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET) noexcept;
+
     HRESULT __cdecl SaveWICTextureToFile(
         _In_ ID3D12CommandQueue* pCommandQ,
         _In_ ID3D12Resource* pSource,
@@ -57,4 +69,72 @@ namespace DirectX
         _In_opt_ const GUID* targetFormat = nullptr,
         _In_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
         bool forceSRGB = false);
+
+    inline namespace DX12
+    {
+        // Captures without blocking the calling thread. The copy is submitted to the command queue and the file is
+        // converted and written on a worker thread once the GPU has finished it. ringSize readback buffers are kept
+        // and reused, each growing to the largest texture captured through it.
+        class AsyncScreenGrab
+        {
+        public:
+            static constexpr size_t DefaultRingSize = 3;
+
+            explicit AsyncScreenGrab(_In_ ID3D12Device* device, size_t ringSize = DefaultRingSize);
+
+            AsyncScreenGrab(AsyncScreenGrab&&) noexcept;
+            AsyncScreenGrab& operator= (AsyncScreenGrab&&) noexcept;
+
+            AsyncScreenGrab(AsyncScreenGrab const&) = delete;
+            AsyncScreenGrab& operator= (AsyncScreenGrab const&) = delete;
+
+            // Waits for any captures still in flight.
+            virtual ~AsyncScreenGrab();
+
+            // These return HRESULT_FROM_WIN32(ERROR_BUSY) without capturing if every readback buffer is still in use.
+            // onComplete is called on the worker thread with the result of writing the file.
+            // The methods may be called from any thread, but onComplete must not call back into the same object.
+            HRESULT __cdecl SaveDDSTextureToFile(
+                _In_ ID3D12CommandQueue* pCommandQueue,
+                _In_ ID3D12Resource* pSource,
+                _In_z_ const wchar_t* fileName,
+                D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+                D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+                _In_ std::function<void __cdecl(HRESULT)> onComplete = nullptr);
+
+            // Block-compresses the capture on the worker thread, as the SaveDDSTextureToFile overload above.
+            HRESULT __cdecl SaveDDSTextureToFile(
+                _In_ ID3D12CommandQueue* pCommandQueue,
+                _In_ ID3D12Resource* pSource,
+                _In_z_ const wchar_t* fileName,
+                DXGI_FORMAT compressFormat,
+                D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+                D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+                _In_ std::function<void __cdecl(HRESULT)> onComplete = nullptr);
+
+            HRESULT __cdecl SaveWICTextureToFile(
+                _In_ ID3D12CommandQueue* pCommandQueue,
+                _In_ ID3D12Resource* pSource,
+                REFGUID guidContainerFormat,
+                _In_z_ const wchar_t* fileName,
+                D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+                D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET,
+                _In_opt_ const GUID* targetFormat = nullptr,
+                _In_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
+                bool forceSRGB = false,
+                _In_ std::function<void __cdecl(HRESULT)> onComplete = nullptr);
+
+            // Number of captures waiting for the GPU or still being written.
+            size_t __cdecl GetPendingCount() const;
+
+            // Blocks until every capture has been written. Rethrows any exception from an onComplete callback.
+            void __cdecl WaitForCompletion();
+
+        private:
+            // Private implementation.
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
 }
@@ -14,6 +14,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 
 namespace DirectX
@@ -24,6 +25,7 @@ namespace DirectX
         {
         public:
             struct Glyph;
+            class TextLayout;
 
             SpriteFont(ID3D12Device* device, ResourceUploadBatch& upload,
                 _In_z_ wchar_t const* fileName,
@@ -81,6 +83,18 @@ namespace DirectX
             D3D12_GPU_DESCRIPTOR_HANDLE __cdecl GetSpriteSheet() const noexcept;
             XMUINT2 __cdecl GetSpriteSheetSize() const noexcept;
 
+            // Pre-computed layout for text that is drawn repeatedly
+            TextLayout __cdecl PrepareString(_In_z_ wchar_t const* text) const;
+            TextLayout __cdecl PrepareString(_In_z_ char const* text) const;
+
+            void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, TextLayout const& layout, XMFLOAT2 const& position, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, float scale = 1, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0) const;
+            void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, TextLayout const& layout, FXMVECTOR position, FXMVECTOR color = Colors::White, float rotation = 0, FXMVECTOR origin = g_XMZero, GXMVECTOR scale = g_XMOne, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0) const;
+
+            // Least-recently-used layout cache for the immediate-mode DrawString/MeasureString (0 disables, which is the default)
+            void __cdecl SetLayoutCacheSize(size_t maxEntries);
+            size_t __cdecl GetLayoutCacheSize() const noexcept;
+            void __cdecl ClearLayoutCache() noexcept;
+
             // Describes a single character glyph.
             struct Glyph
             {
@@ -120,5 +134,44 @@ namespace DirectX
 
             static const XMFLOAT2 Float2Zero;
         };
+
+        // Glyph positions, source rectangles, and bounds of a string, computed once by SpriteFont::PrepareString.
+        // A layout is only valid for the SpriteFont which created it, and only until that font's line spacing or default character changes.
+        class SpriteFont::TextLayout
+        {
+        public:
+            TextLayout() noexcept;
+
+            TextLayout(TextLayout&&) = default;
+            TextLayout& operator= (TextLayout&&) = default;
+
+            TextLayout(TextLayout const&) = default;
+            TextLayout& operator= (TextLayout const&) = default;
+
+            ~TextLayout() = default;
+
+            // Equivalent to SpriteFont::MeasureString with ignoreWhitespace = true.
+            XMVECTOR XM_CALLCONV GetSize() const noexcept;
+
+            // Equivalent to SpriteFont::MeasureDrawBounds with ignoreWhitespace = true.
+            RECT __cdecl GetDrawBounds(XMFLOAT2 const& position) const noexcept;
+
+            size_t __cdecl GetGlyphCount() const noexcept { return items.size(); }
+
+        private:
+            friend class SpriteFont;
+            friend class SpriteFont::Impl;
+
+            struct Item
+            {
+                RECT subrect;
+                XMFLOAT2 offset;
+                XMFLOAT2 extent;
+            };
+
+            std::vector<Item> items;
+            XMFLOAT2 size;
+            XMFLOAT4 bounds;
+        };
     }
 }
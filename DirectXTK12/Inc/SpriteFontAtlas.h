@@ -0,0 +1,85 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteFontAtlas.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpriteFont.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+namespace DirectX
+{
+    inline namespace DX12
+    {
+        // Merges the glyph sheets of several SpriteFonts, plus optional sprite images, into a single
+        // texture so that mixed-font text does not break SpriteBatch batching on texture changes.
+        class SpriteFontAtlas
+        {
+        public:
+            explicit SpriteFontAtlas(uint32_t maxTextureSize = D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION, uint32_t padding = 1);
+
+            SpriteFontAtlas(SpriteFontAtlas&&) noexcept;
+            SpriteFontAtlas& operator= (SpriteFontAtlas&&) noexcept;
+
+            SpriteFontAtlas(SpriteFontAtlas const&) = delete;
+            SpriteFontAtlas& operator= (SpriteFontAtlas const&) = delete;
+
+            virtual ~SpriteFontAtlas();
+
+            // Adds a font created by the MakeSpriteFont utility, returning its font index.
+            size_t __cdecl AddFont(_In_z_ wchar_t const* fileName);
+            size_t __cdecl AddFont(_In_reads_bytes_(dataSize) uint8_t const* dataBlob, size_t dataSize);
+
+            // Adds a plain image, returning its image index. All fonts and images must use the same uncompressed format.
+            size_t __cdecl AddImage(uint32_t width, uint32_t height, DXGI_FORMAT format, uint32_t stride, _In_reads_bytes_(stride * height) uint8_t const* pixels);
+
+            // Packs everything added so far, rewriting each glyph's Subrect to its location in the atlas.
+            void __cdecl Pack();
+
+            // Packed results.
+            XMUINT2 __cdecl GetTextureSize() const noexcept;
+            DXGI_FORMAT __cdecl GetTextureFormat() const noexcept;
+
+            SpriteFont::Glyph const* __cdecl GetGlyphs(size_t font, _Out_ size_t* glyphCount) const;
+            float __cdecl GetLineSpacing(size_t font) const;
+            wchar_t __cdecl GetDefaultCharacter(size_t font) const;
+
+            RECT __cdecl GetImageRect(size_t image) const;
+
+            HRESULT __cdecl CreateTextureResource(_In_ ID3D12Device* device, ResourceUploadBatch& upload, _COM_Outptr_ ID3D12Resource** texture) const noexcept;
+
+            // The returned font draws from the atlas texture; its descriptor must stay valid while it is in use.
+            std::unique_ptr<SpriteFont> __cdecl CreateSpriteFont(size_t font, D3D12_GPU_DESCRIPTOR_HANDLE texture) const;
+
+            // Estimates SpriteBatch draw batches for a sequence of strings, drawn with separate font textures versus the shared atlas.
+            struct TextRun
+            {
+                size_t font;
+                _Field_z_ wchar_t const* text;
+            };
+
+            struct BatchStatistics
+            {
+                size_t separateTextures;
+                size_t sharedAtlas;
+            };
+
+            BatchStatistics __cdecl EstimateBatches(_In_reads_(runCount) TextRun const* runs, size_t runCount) const;
+
+        private:
+            // Private implementation.
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
+}
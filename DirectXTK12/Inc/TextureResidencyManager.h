@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// File: TextureResidencyManager.h
+//
+// Keeps a set of DDS textures resident at reduced top mips, raising or lowering each one
+// from the screen-space demand reported by the app while staying within a memory budget.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _GAMING_XBOX_SCARLETT
+#include <d3d12_xs.h>
+#elif (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
+#include <d3d12_x.h>
+#elif defined(USING_DIRECTX_HEADERS)
+#include <directx/d3d12.h>
+#include <dxguids/dxguids.h>
+#else
+#include <d3d12.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DDSTextureLoader.h"
+
+
+namespace DirectX
+{
+    class ResourceUploadBatch;
+
+    inline namespace DX12
+    {
+        class TextureResidencyManager
+        {
+        public:
+            static constexpr uint64_t DefaultUploadBudget = 16 * 1024 * 1024;
+            static constexpr uint64_t DefaultTailSize = 64 * 1024;
+
+            // The smallest mips of each texture, up to tailSize bytes, stay resident even if they exceed memoryBudget.
+            // uploadBudget limits the bytes read and uploaded by each call to Update.
+            TextureResidencyManager(_In_ ID3D12Device* device,
+                uint64_t memoryBudget,
+                uint64_t uploadBudget = DefaultUploadBudget,
+                uint64_t tailSize = DefaultTailSize);
+
+            TextureResidencyManager(TextureResidencyManager&&) noexcept;
+            TextureResidencyManager& operator= (TextureResidencyManager&&) noexcept;
+
+            TextureResidencyManager(TextureResidencyManager const&) = delete;
+            TextureResidencyManager& operator= (TextureResidencyManager const&) = delete;
+
+            // Waits for the GPU to finish with replaced resources that are still pending release.
+            virtual ~TextureResidencyManager();
+
+            // Reads the header of a DDS file and returns its texture index. The file is kept open so mips can be read
+            // on demand; nothing is resident until the next Update. Mips larger than maxsize are never loaded.
+            size_t __cdecl Load(_In_z_ const wchar_t* fileName, size_t maxsize = 0, DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT);
+
+            // Reports the size in pixels the texture covers on screen. Demand persists until replaced or cleared, and
+            // textures without demand fall back to their mip tail.
+            void __cdecl SetScreenSize(size_t texture, float screenWidth, float screenHeight, float priority = 1.f);
+            void __cdecl SetDesiredMip(size_t texture, uint32_t mip, float priority = 1.f);
+            void __cdecl ClearDemand() noexcept;
+
+            // Rebuilds textures whose resident mips should change, recording the uploads into resourceUpload. Call
+            // between ResourceUploadBatch::Begin and End. Rebuilt textures get a new resource, so any views of them
+            // must be recreated; their indices are appended to rebuiltTextures. Mips that were already resident are
+            // copied on the GPU, so only mips read from the file count against the upload budget.
+            // Returns the number of bytes read and uploaded.
+            uint64_t __cdecl Update(ResourceUploadBatch& resourceUpload, _Out_opt_ std::vector<size_t>* rebuiltTextures = nullptr);
+
+            // Call once per frame after submitting the frame's command lists. Resources replaced by Update are released
+            // once the GPU has finished this frame's work on commandQueue.
+            void __cdecl Commit(_In_ ID3D12CommandQueue* commandQueue);
+
+            void __cdecl SetMemoryBudget(uint64_t bytes) noexcept;
+            uint64_t __cdecl GetMemoryBudget() const noexcept;
+
+            void __cdecl SetUploadBudget(uint64_t bytesPerUpdate) noexcept;
+            uint64_t __cdecl GetUploadBudget() const noexcept;
+
+            // Texture data currently resident, not counting replaced resources waiting for Commit.
+            uint64_t __cdecl GetResidentBytes() const noexcept;
+
+            // Null until the first Update after Load.
+            ID3D12Resource* __cdecl GetResource(size_t texture) const;
+
+            // Mip of the file stored as mip 0 of the resource.
+            uint32_t __cdecl GetTopMip(size_t texture) const;
+
+            bool __cdecl IsCubeMap(size_t texture) const;
+            DDS_ALPHA_MODE __cdecl GetAlphaMode(size_t texture) const;
+
+            size_t __cdecl GetTextureCount() const noexcept;
+
+            void __cdecl CreateShaderResourceView(size_t texture, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const;
+
+        private:
+            // Private implementation.
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
+}
@@ -52,6 +52,8 @@ namespace DirectX
             WIC_LOADER_FIT_POW2 = 0x20,
             WIC_LOADER_MAKE_SQUARE = 0x40,
             WIC_LOADER_FORCE_RGBA32 = 0x80,
+            WIC_LOADER_FORCE_RGBA16F = 0x100,
+            WIC_LOADER_PREMULTIPLY_ALPHA = 0x200,
         };
     }
 
@@ -135,6 +137,18 @@ namespace DirectX
         WIC_LOADER_FLAGS loadFlags,
         _Outptr_ ID3D12Resource** texture);
 
+    // Format the loaders pick for the first frame, before any WIC_LOADER_FORCE_SRGB, WIC_LOADER_FORCE_RGBA32 or
+    // WIC_LOADER_FORCE_RGBA16F adjustment.
+    // Only the image header is decoded.
+    HRESULT __cdecl GetWICTextureFormatFromMemory(
+        _In_reads_bytes_(wicDataSize) const uint8_t* wicData,
+        size_t wicDataSize,
+        _Out_ DXGI_FORMAT* format) noexcept;
+
+    HRESULT __cdecl GetWICTextureFormatFromFile(
+        _In_z_ const wchar_t* szFileName,
+        _Out_ DXGI_FORMAT* format) noexcept;
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-dynamic-exception-spec"
@@ -0,0 +1,299 @@
+//--------------------------------------------------------------------------------------
+// File: AtlasPackerTest.cpp
+//
+// Parses synthetic .spritefont data and checks the atlas packer's placement and copies.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "AtlasPacker.h"
+#include "TestHelpers.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX::AtlasPacker;
+
+namespace
+{
+    void Append(std::vector<uint8_t>& data, const void* value, size_t bytes)
+    {
+        auto ptr = static_cast<const uint8_t*>(value);
+        data.insert(data.end(), ptr, ptr + bytes);
+    }
+
+    void AppendUInt(std::vector<uint8_t>& data, uint32_t value)
+    {
+        Append(data, &value, sizeof(value));
+    }
+
+    // Writes the MakeSpriteFont layout: magic, glyphs, line spacing, default character, then the sheet.
+    std::vector<uint8_t> MakeSpriteFont(
+        std::vector<Glyph> const& glyphs,
+        uint32_t width, uint32_t height, uint32_t format, uint32_t stride, uint32_t rows,
+        std::vector<uint8_t> const& pixels)
+    {
+        std::vector<uint8_t> data;
+        Append(data, "DXTKfont", 8);
+        AppendUInt(data, static_cast<uint32_t>(glyphs.size()));
+        Append(data, glyphs.data(), glyphs.size() * sizeof(Glyph));
+        const float lineSpacing = 12.5f;
+        Append(data, &lineSpacing, sizeof(lineSpacing));
+        AppendUInt(data, '?');
+        AppendUInt(data, width);
+        AppendUInt(data, height);
+        AppendUInt(data, format);
+        AppendUInt(data, stride);
+        AppendUInt(data, rows);
+        data.insert(data.end(), pixels.begin(), pixels.end());
+        return data;
+    }
+
+    Glyph MakeGlyph(uint32_t character, int32_t left, int32_t top, int32_t right, int32_t bottom)
+    {
+        Glyph glyph = {};
+        glyph.Character = character;
+        glyph.Subrect = Rect{ left, top, right, bottom };
+        glyph.XAdvance = 1.f;
+        return glyph;
+    }
+
+    // An R8 sheet where each pixel holds a value derived from its position.
+    Image MakeSheet(uint32_t width, uint32_t height, uint8_t seed)
+    {
+        Image image = { width, height, c_formatR8_UNORM, width, {} };
+        image.pixels.resize(size_t(width) * height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                image.pixels[size_t(y) * width + x] = static_cast<uint8_t>(seed + x * 7 + y * 13);
+            }
+        }
+        return image;
+    }
+
+    bool Overlaps(Rect const& a, Rect const& b)
+    {
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+    }
+
+    bool SamePixels(Image const& source, Rect const& sourceRect, Image const& atlas, Rect const& atlasRect)
+    {
+        if (sourceRect.Width() != atlasRect.Width() || sourceRect.Height() != atlasRect.Height())
+            return false;
+
+        for (int32_t y = 0; y < sourceRect.Height(); ++y)
+        {
+            const uint8_t* src = source.pixels.data() + size_t(sourceRect.top + y) * source.stride + size_t(sourceRect.left);
+            const uint8_t* dest = atlas.pixels.data() + size_t(atlasRect.top + y) * atlas.stride + size_t(atlasRect.left);
+            if (memcmp(src, dest, size_t(sourceRect.Width())) != 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    void TestParse()
+    {
+        const std::vector<Glyph> glyphs = { MakeGlyph('A', 0, 0, 4, 5), MakeGlyph('B', 4, 0, 8, 5) };
+        const Image sheet = MakeSheet(8, 5, 1);
+
+        auto data = MakeSpriteFont(glyphs, 8, 5, c_formatR8_UNORM, 8, 5, sheet.pixels);
+        const Font font = ParseSpriteFont(data.data(), data.size());
+
+        VERIFY(font.glyphs.size() == 2);
+        VERIFY(font.glyphs[1].Character == 'B' && font.glyphs[1].Subrect.left == 4);
+        VERIFY(font.lineSpacing == 12.5f);
+        VERIFY(font.defaultCharacter == '?');
+        VERIFY(font.sheet.width == 8 && font.sheet.height == 5 && font.sheet.stride == 8);
+        VERIFY(font.sheet.pixels == sheet.pixels);
+
+        // Every truncation of a valid file is rejected.
+        for (size_t size = 0; size < data.size(); ++size)
+        {
+            VERIFY_THROWS(ParseSpriteFont(data.data(), size), std::runtime_error);
+        }
+
+        auto badMagic = data;
+        badMagic[0] = 'X';
+        VERIFY_THROWS(ParseSpriteFont(badMagic.data(), badMagic.size()), std::runtime_error);
+
+        // The pixel data must cover the sheet.
+        auto shortStride = MakeSpriteFont(glyphs, 8, 5, c_formatR8_UNORM, 7, 5, std::vector<uint8_t>(35));
+        VERIFY_THROWS(ParseSpriteFont(shortStride.data(), shortStride.size()), std::runtime_error);
+
+        auto shortRows = MakeSpriteFont(glyphs, 8, 5, c_formatR8_UNORM, 8, 4, std::vector<uint8_t>(32));
+        VERIFY_THROWS(ParseSpriteFont(shortRows.data(), shortRows.size()), std::runtime_error);
+
+        // A BC3 sheet is sized in 4x4 blocks of 16 bytes.
+        auto bc3 = MakeSpriteFont(glyphs, 8, 5, 77, 32, 2, std::vector<uint8_t>(64));
+        VERIFY(ParseSpriteFont(bc3.data(), bc3.size()).sheet.pixels.size() == 64);
+
+        auto bc3Short = MakeSpriteFont(glyphs, 8, 5, 77, 32, 1, std::vector<uint8_t>(32));
+        VERIFY_THROWS(ParseSpriteFont(bc3Short.data(), bc3Short.size()), std::runtime_error);
+
+        // An absurd glyph count must fail before allocating.
+        std::vector<uint8_t> hugeCount;
+        Append(hugeCount, "DXTKfont", 8);
+        AppendUInt(hugeCount, UINT32_MAX);
+        VERIFY_THROWS(ParseSpriteFont(hugeCount.data(), hugeCount.size()), std::runtime_error);
+    }
+
+    void TestMaxRectsBin()
+    {
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<uint32_t> size(1, 24);
+
+        MaxRectsBin bin(128, 128);
+        std::vector<Rect> placed;
+        for (int j = 0; j < 200; ++j)
+        {
+            Rect r;
+            if (!bin.Insert(size(rng), size(rng), r))
+                continue;
+
+            VERIFY(r.left >= 0 && r.top >= 0 && r.right <= 128 && r.bottom <= 128);
+            for (auto const& other : placed)
+            {
+                VERIFY(!Overlaps(r, other));
+            }
+            placed.push_back(r);
+        }
+
+        VERIFY(placed.size() > 20);
+
+        // Exact fit, then no room.
+        MaxRectsBin exact(32, 32);
+        Rect r;
+        for (int j = 0; j < 4; ++j)
+        {
+            VERIFY(exact.Insert(16, 16, r));
+        }
+        VERIFY(!exact.Insert(1, 1, r));
+    }
+
+    void TestPack()
+    {
+        std::vector<Font> fonts(2);
+
+        fonts[0].sheet = MakeSheet(32, 16, 3);
+        fonts[0].glyphs = {
+            MakeGlyph(' ', 0, 0, 0, 0),             // No pixels
+            MakeGlyph('A', 0, 0, 10, 12),
+            MakeGlyph('B', 10, 0, 20, 12),
+            MakeGlyph('C', 0, 0, 10, 12),           // Same pixels as 'A'
+        };
+
+        fonts[1].sheet = MakeSheet(16, 16, 90);
+        fonts[1].glyphs = {
+            MakeGlyph('a', 0, 0, 7, 9),
+            MakeGlyph('b', 7, 0, 16, 16),
+        };
+
+        const Font original0 = fonts[0];
+        const Font original1 = fonts[1];
+
+        std::vector<Image> images = { MakeSheet(20, 5, 200) };
+
+        Image atlas;
+        std::vector<Rect> imageRects;
+        Pack(fonts, images, 1, 4096, atlas, imageRects);
+
+        VERIFY(atlas.format == c_formatR8_UNORM);
+        VERIFY(atlas.stride == atlas.width);
+        VERIFY(atlas.pixels.size() == size_t(atlas.width) * atlas.height);
+        VERIFY(imageRects.size() == 1);
+
+        auto const& g0 = fonts[0].glyphs;
+        VERIFY(g0[0].Subrect.left == 0 && g0[0].Subrect.Width() == 0 && g0[0].Subrect.Height() == 0);
+        VERIFY(g0[3].Subrect.left == g0[1].Subrect.left && g0[3].Subrect.top == g0[1].Subrect.top);
+
+        std::vector<Rect> used = { g0[1].Subrect, g0[2].Subrect, fonts[1].glyphs[0].Subrect, fonts[1].glyphs[1].Subrect, imageRects[0] };
+        for (size_t i = 0; i < used.size(); ++i)
+        {
+            VERIFY(used[i].right <= int32_t(atlas.width) && used[i].bottom <= int32_t(atlas.height));
+            for (size_t j = i + 1; j < used.size(); ++j)
+            {
+                // Padding keeps neighbors at least one texel apart.
+                Rect padded = { used[i].left, used[i].top, used[i].right + 1, used[i].bottom + 1 };
+                VERIFY(!Overlaps(padded, used[j]));
+            }
+        }
+
+        VERIFY(SamePixels(original0.sheet, original0.glyphs[1].Subrect, atlas, g0[1].Subrect));
+        VERIFY(SamePixels(original0.sheet, original0.glyphs[2].Subrect, atlas, g0[2].Subrect));
+        VERIFY(SamePixels(original1.sheet, original1.glyphs[0].Subrect, atlas, fonts[1].glyphs[0].Subrect));
+        VERIFY(SamePixels(original1.sheet, original1.glyphs[1].Subrect, atlas, fonts[1].glyphs[1].Subrect));
+        VERIFY(SamePixels(images[0], Rect{ 0, 0, 20, 5 }, atlas, imageRects[0]));
+
+        // The sheets are released once copied.
+        VERIFY(fonts[0].sheet.pixels.empty() && fonts[1].sheet.pixels.empty());
+
+        // Errors
+        std::vector<Font> none;
+        std::vector<Image> noImages;
+        VERIFY_THROWS(Pack(none, noImages, 0, 4096, atlas, imageRects), std::invalid_argument);
+
+        std::vector<Image> big = { MakeSheet(100, 100, 0) };
+        VERIFY_THROWS(Pack(none, big, 0, 64, atlas, imageRects), std::length_error);
+
+        std::vector<Image> mixed = { MakeSheet(4, 4, 0), MakeSheet(4, 4, 0) };
+        mixed[1].format = c_formatR8G8B8A8_UNORM;
+        VERIFY_THROWS(Pack(none, mixed, 0, 4096, atlas, imageRects), std::invalid_argument);
+
+        std::vector<Font> outside(1);
+        outside[0].sheet = MakeSheet(8, 8, 0);
+        outside[0].glyphs = { MakeGlyph('A', 4, 4, 12, 8) };
+        VERIFY_THROWS(Pack(outside, noImages, 0, 4096, atlas, imageRects), std::out_of_range);
+    }
+
+    void TestCountSprites()
+    {
+        VERIFY(IsWhitespace(' '));
+        VERIFY(IsWhitespace('\t'));
+
+        // U+10020 must not be truncated to a space.
+        VERIFY(!IsWhitespace(0x10020));
+
+        Font font = {};
+        font.defaultCharacter = 0;
+        font.glyphs = {
+            MakeGlyph(' ', 0, 0, 1, 1),
+            MakeGlyph('A', 0, 0, 8, 8),
+            MakeGlyph(0x10020, 0, 0, 1, 1),
+        };
+
+        const wchar_t text[] = { 'A', ' ', 'A', '\n', 'Z', 0 };
+        VERIFY(CountSprites(font, text) == 2);
+
+        if (sizeof(wchar_t) == 4)
+        {
+            const wchar_t astral[] = { wchar_t(0x10020), ' ', 0 };
+            VERIFY(CountSprites(font, astral) == 1);
+        }
+
+        std::vector<Font> fonts = { font, font };
+        const wchar_t a[] = { 'A', 'A', 'A', 0 };
+        const TextRun runs[] = { { 0, a }, { 1, a }, { 0, a } };
+        auto estimate = EstimateBatches(fonts, runs, 3, 4);
+        VERIFY(estimate.separateTextures == 3);
+        VERIFY(estimate.sharedAtlas == 3);
+    }
+}
+
+int main()
+{
+    TestParse();
+    TestMaxRectsBin();
+    TestPack();
+    TestCountSprites();
+
+    return TestHelpers::Finish("AtlasPackerTest");
+}
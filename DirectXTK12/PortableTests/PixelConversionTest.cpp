@@ -0,0 +1,341 @@
+//--------------------------------------------------------------------------------------
+// File: PixelConversionTest.cpp
+//
+// Checks the PixelConversion kernels against per-pixel references at lengths that exercise
+// both the SIMD loops and their scalar tails, then reports their throughput in GB/s.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "PixelConversion.h"
+
+#include "TestHelpers.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PixelConversion;
+
+namespace
+{
+    const size_t c_lengths[] = { 0, 1, 3, 4, 5, 7, 8, 15, 16, 17, 63, 64, 65, 1003 };
+
+    std::vector<uint8_t> RandomBytes(size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> bytes(count);
+        for (auto& b : bytes)
+        {
+            b = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    }
+
+    std::vector<uint16_t> RandomWords(size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint16_t> words(count);
+        for (auto& w : words)
+        {
+            w = static_cast<uint16_t>(rng());
+        }
+        return words;
+    }
+
+    double SRGBToLinear(double x)
+    {
+        return (x <= 0.04045) ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+    }
+
+    double LinearToSRGB(double x)
+    {
+        return (x <= 0.0031308) ? x * 12.92 : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055;
+    }
+
+    uint8_t Expand5(uint32_t v) { return static_cast<uint8_t>((v << 3) | (v >> 2)); }
+    uint8_t Expand6(uint32_t v) { return static_cast<uint8_t>((v << 2) | (v >> 4)); }
+
+    //----------------------------------------------------------------------------------
+    void Test24bpp()
+    {
+        for (const size_t n : c_lengths)
+        {
+            const auto src = RandomBytes(n * 4, 1);
+            std::vector<uint8_t> dest(n * 4 + 1, 0xCD);
+
+            size_t bad = 0;
+            ConvertBGR24ToRGBA8(dest.data(), src.data(), n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint8_t* s = &src[i * 3];
+                const uint8_t* d = &dest[i * 4];
+                bad += (d[0] != s[2] || d[1] != s[1] || d[2] != s[0] || d[3] != 0xFF);
+            }
+
+            ConvertRGB24ToRGBA8(dest.data(), src.data(), n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint8_t* s = &src[i * 3];
+                const uint8_t* d = &dest[i * 4];
+                bad += (d[0] != s[0] || d[1] != s[1] || d[2] != s[2] || d[3] != 0xFF);
+            }
+
+            ConvertRGBA8ToBGR24(dest.data(), src.data(), n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint8_t* s = &src[i * 4];
+                const uint8_t* d = &dest[i * 3];
+                bad += (d[0] != s[2] || d[1] != s[1] || d[2] != s[0]);
+            }
+
+            ConvertBGRA8ToBGR24(dest.data(), src.data(), n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                bad += (memcmp(&dest[i * 3], &src[i * 4], 3) != 0);
+            }
+
+            VERIFY(bad == 0);
+            VERIFY(dest[n * 4] == 0xCD);
+        }
+    }
+
+    void TestSwapRedBlue()
+    {
+        for (const size_t n : c_lengths)
+        {
+            const auto src = RandomBytes(n * 4, 2);
+
+            for (const bool opaque : { false, true })
+            {
+                std::vector<uint8_t> dest(n * 4);
+                SwapRedBlue8(dest.data(), src.data(), n, opaque);
+
+                size_t bad = 0;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const uint8_t* s = &src[i * 4];
+                    const uint8_t* d = &dest[i * 4];
+                    bad += (d[0] != s[2] || d[1] != s[1] || d[2] != s[0] || d[3] != (opaque ? 0xFF : s[3]));
+                }
+                VERIFY(bad == 0);
+
+                // In place gives the same result
+                auto inPlace = src;
+                SwapRedBlue8(inPlace.data(), inPlace.data(), n, opaque);
+                VERIFY(inPlace == dest);
+            }
+        }
+    }
+
+    void Test16bpp()
+    {
+        for (const size_t n : c_lengths)
+        {
+            const auto src = RandomWords(n, 3);
+            std::vector<uint8_t> dest(n * 4);
+
+            size_t bad = 0;
+            ConvertB5G6R5ToRGBA8(dest.data(), src.data(), n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint32_t v = src[i];
+                const uint8_t* d = &dest[i * 4];
+                bad += (d[0] != Expand5(v >> 11) || d[1] != Expand6((v >> 5) & 0x3F) || d[2] != Expand5(v & 0x1F) || d[3] != 0xFF);
+            }
+
+            ConvertB5G5R5A1ToRGBA8(dest.data(), src.data(), n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint32_t v = src[i];
+                const uint8_t* d = &dest[i * 4];
+                bad += (d[0] != Expand5((v >> 10) & 0x1F) || d[1] != Expand5((v >> 5) & 0x1F) || d[2] != Expand5(v & 0x1F)
+                    || d[3] != ((v & 0x8000) ? 0xFF : 0));
+            }
+
+            VERIFY(bad == 0);
+        }
+    }
+
+    void TestPremultiply()
+    {
+        for (const size_t n : c_lengths)
+        {
+            const auto src = RandomBytes(n * 4, 4);
+            std::vector<uint8_t> dest(n * 4);
+            PremultiplyAlpha8(dest.data(), src.data(), n);
+
+            size_t bad = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint8_t* s = &src[i * 4];
+                const uint8_t* d = &dest[i * 4];
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    bad += (d[c] != static_cast<uint8_t>(std::lround(s[c] * s[3] / 255.0)));
+                }
+                bad += (d[3] != s[3]);
+            }
+            VERIFY(bad == 0);
+
+            auto inPlace = src;
+            PremultiplyAlpha8(inPlace.data(), inPlace.data(), n);
+            VERIFY(inPlace == dest);
+        }
+
+        // Opaque and transparent pixels are exact
+        const uint8_t edge[] = { 200, 100, 50, 255, 200, 100, 50, 0, 255, 255, 255, 255, 1, 2, 3, 128 };
+        uint8_t out[sizeof(edge)];
+        PremultiplyAlpha8(out, edge, 4);
+        VERIFY(memcmp(out, edge, 4) == 0);
+        VERIFY(out[4] == 0 && out[5] == 0 && out[6] == 0 && out[7] == 0);
+        VERIFY(out[8] == 255 && out[11] == 255);
+        VERIFY(out[12] == 1 && out[13] == 1 && out[14] == 2 && out[15] == 128);
+    }
+
+    void TestSRGB()
+    {
+        std::vector<uint8_t> ramp(256 * 4);
+        for (size_t j = 0; j < 256; ++j)
+        {
+            ramp[j * 4] = ramp[j * 4 + 1] = ramp[j * 4 + 2] = static_cast<uint8_t>(j);
+            ramp[j * 4 + 3] = static_cast<uint8_t>(255 - j);
+        }
+
+        std::vector<uint8_t> linear(ramp.size());
+        ConvertSRGBToLinear8(linear.data(), ramp.data(), 256);
+
+        std::vector<uint8_t> encoded(ramp.size());
+        ConvertLinearToSRGB8(encoded.data(), ramp.data(), 256);
+
+        size_t bad = 0;
+        for (size_t j = 0; j < 256; ++j)
+        {
+            const long toLinear = std::lround(SRGBToLinear(j / 255.0) * 255.0);
+            const long toSRGB = std::lround(LinearToSRGB(j / 255.0) * 255.0);
+            for (size_t c = 0; c < 3; ++c)
+            {
+                bad += (std::abs(linear[j * 4 + c] - toLinear) > 1);
+                bad += (std::abs(encoded[j * 4 + c] - toSRGB) > 1);
+            }
+            bad += (linear[j * 4 + 3] != ramp[j * 4 + 3] || encoded[j * 4 + 3] != ramp[j * 4 + 3]);
+        }
+        VERIFY(bad == 0);
+        VERIFY(linear[0] == 0 && linear[255 * 4] == 255);
+        VERIFY(encoded[0] == 0 && encoded[255 * 4] == 255);
+
+        XMFLOAT4 f[2] = { { 0.5f, 0.f, 1.f, 0.25f }, { 0.04f, 0.2f, 0.8f, 1.f } };
+        ConvertSRGBToLinear(f, 2);
+        VERIFY(std::fabs(f[0].x - SRGBToLinear(0.5)) < 1e-3 && f[0].y == 0.f && std::fabs(f[0].z - 1.f) < 1e-3 && f[0].w == 0.25f);
+        ConvertLinearToSRGB(f, 2);
+        VERIFY(std::fabs(f[0].x - 0.5f) < 1e-3 && std::fabs(f[1].x - 0.04f) < 1e-3 && std::fabs(f[1].z - 0.8f) < 1e-3);
+        VERIFY(f[0].w == 0.25f && f[1].w == 1.f);
+    }
+
+    void TestHalf()
+    {
+        for (const size_t n : c_lengths)
+        {
+            const auto src = RandomBytes(n * 4, 5);
+
+            for (const bool fromSRGB : { false, true })
+            {
+                std::vector<uint16_t> dest(n * 4);
+                ConvertRGBA8ToRGBA16F(dest.data(), src.data(), n, fromSRGB);
+
+                size_t bad = 0;
+                for (size_t i = 0; i < n * 4; ++i)
+                {
+                    double expected = src[i] / 255.0;
+                    if (fromSRGB && (i % 4) != 3)
+                    {
+                        expected = SRGBToLinear(expected);
+                    }
+
+                    // Half has an 11-bit significand
+                    const double actual = PackedVector::XMConvertHalfToFloat(dest[i]);
+                    bad += (std::fabs(actual - expected) > std::max(expected, 1.0 / 1024.0) / 1024.0);
+                }
+                VERIFY(bad == 0);
+            }
+        }
+
+        uint16_t one[4] = {};
+        const uint8_t white[4] = { 255, 255, 255, 255 };
+        ConvertRGBA8ToRGBA16F(one, white, 1, true);
+        VERIFY(one[0] == 0x3C00 && one[1] == 0x3C00 && one[2] == 0x3C00 && one[3] == 0x3C00);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Throughput counts the bytes read and written, over an image large enough to miss the cache.
+    template<typename TConvert>
+    void Benchmark(const char* name, size_t srcBpp, size_t destBpp, TConvert&& convert)
+    {
+        constexpr size_t c_width = 2048;
+        constexpr size_t c_height = 1024;
+
+        const auto src = RandomBytes(c_width * c_height * srcBpp, 6);
+        std::vector<uint8_t> dest(c_width * c_height * destBpp);
+
+        // Not a constant, or GCC warns about the kernels' scalar tails with -O2
+        const size_t width = dest.size() / (c_height * destBpp);
+
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        size_t passes = 0;
+        double seconds = 0;
+        do
+        {
+            for (size_t y = 0; y < c_height; ++y)
+            {
+                convert(&dest[y * width * destBpp], &src[y * width * srcBpp], width);
+            }
+            ++passes;
+            seconds = std::chrono::duration<double>(clock::now() - start).count();
+        } while (seconds < 0.25);
+
+        const double bytes = double(passes) * double(c_width * c_height) * double(srcBpp + destBpp);
+        printf("%-24s %7.2f GB/s\n", name, bytes / seconds / 1e9);
+    }
+
+    void BenchmarkThroughput()
+    {
+        Benchmark("ConvertBGR24ToRGBA8", 3, 4,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertBGR24ToRGBA8(d, s, n); });
+        Benchmark("ConvertRGBA8ToBGR24", 4, 3,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertRGBA8ToBGR24(d, s, n); });
+        Benchmark("SwapRedBlue8", 4, 4,
+            [](uint8_t* d, const uint8_t* s, size_t n) { SwapRedBlue8(d, s, n); });
+        Benchmark("ConvertB5G6R5ToRGBA8", 2, 4,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertB5G6R5ToRGBA8(d, reinterpret_cast<const uint16_t*>(s), n); });
+        Benchmark("ConvertB5G5R5A1ToRGBA8", 2, 4,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertB5G5R5A1ToRGBA8(d, reinterpret_cast<const uint16_t*>(s), n); });
+        Benchmark("PremultiplyAlpha8", 4, 4,
+            [](uint8_t* d, const uint8_t* s, size_t n) { PremultiplyAlpha8(d, s, n); });
+        Benchmark("ConvertSRGBToLinear8", 4, 4,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertSRGBToLinear8(d, s, n); });
+        Benchmark("ConvertRGBA8ToRGBA16F", 4, 8,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertRGBA8ToRGBA16F(reinterpret_cast<uint16_t*>(d), s, n); });
+        Benchmark("  from sRGB", 4, 8,
+            [](uint8_t* d, const uint8_t* s, size_t n) { ConvertRGBA8ToRGBA16F(reinterpret_cast<uint16_t*>(d), s, n, true); });
+    }
+}
+
+int main()
+{
+    Test24bpp();
+    TestSwapRedBlue();
+    Test16bpp();
+    TestPremultiply();
+    TestSRGB();
+    TestHalf();
+
+    BenchmarkThroughput();
+
+    return TestHelpers::Finish("PixelConversionTest");
+}
@@ -0,0 +1,492 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareBackendTest.cpp
+//
+// Renders voice graphs through the portable software backend with no audio device, and
+// measures how many voices it mixes per second of CPU.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "SoftwareBackend.h"
+#include "TestHelpers.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::AudioBackend;
+
+namespace
+{
+    bool Near(float a, float b, float tolerance = 1e-4f) noexcept
+    {
+        return std::fabs(a - b) <= tolerance;
+    }
+
+    Format MakeFormat(SampleFormat type, uint32_t channels, uint32_t sampleRate, uint32_t bytesPerSample)
+    {
+        Format format = {};
+        format.type = type;
+        format.channels = channels;
+        format.sampleRate = sampleRate;
+        format.blockAlign = channels * bytesPerSample;
+        format.samplesPerBlock = 1;
+        return format;
+    }
+
+    Buffer MakeBuffer(const void* data, size_t bytes, bool endOfStream = true)
+    {
+        Buffer buffer = {};
+        buffer.data = static_cast<const uint8_t*>(data);
+        buffer.bytes = static_cast<uint32_t>(bytes);
+        buffer.endOfStream = endOfStream;
+        return buffer;
+    }
+
+    struct CountingCallback : public VoiceCallback
+    {
+        size_t passStarts = 0;
+        size_t passEnds = 0;
+        size_t bufferStarts = 0;
+        size_t bufferEnds = 0;
+        size_t loopEnds = 0;
+        size_t streamEnds = 0;
+        std::function<void()> onBufferEnd;
+
+        void OnPassStart(uint32_t) override { ++passStarts; }
+        void OnPassEnd() override { ++passEnds; }
+        void OnBufferStart(void*) override { ++bufferStarts; }
+        void OnLoopEnd(void*) override { ++loopEnds; }
+        void OnStreamEnd() override { ++streamEnds; }
+
+        void OnBufferEnd(void*) override
+        {
+            ++bufferEnds;
+            if (onBufferEnd)
+            {
+                onBufferEnd();
+            }
+        }
+    };
+
+    //----------------------------------------------------------------------------------
+    // A mono PCM voice panned to stereo by the default matrix, with its buffer callbacks
+    void TestPCM()
+    {
+        SoftwareBackend backend;
+
+        Voice* master = nullptr;
+        VERIFY(backend.CreateMasteringVoice(2, 48000, 0, &master) == Status::Ok);
+        VERIFY(master != nullptr && master->GetChannels() == 2);
+
+        const std::vector<int16_t> samples(480, 16384);
+
+        CountingCallback callback;
+        SourceVoice* voice = nullptr;
+        VERIFY(backend.CreateSourceVoice(MakeFormat(SampleFormat::PCM16, 1, 48000, 2), 0, 2.f, &callback, &voice) == Status::Ok);
+        VERIFY(voice->Submit(MakeBuffer(samples.data(), samples.size() * sizeof(int16_t))) == Status::Ok);
+        VERIFY(backend.GetPerformanceData().activeSourceVoices == 1);
+
+        std::vector<float> output(960 * 2, -1.f);
+
+        // Not started: silence, and nothing consumed
+        backend.Render(output.data(), 480);
+        VERIFY(output[0] == 0.f && output[959] == 0.f);
+        VERIFY(callback.passStarts == 0 && voice->GetState().samplesPlayed == 0);
+
+        voice->Start();
+        backend.Render(output.data(), 960);
+
+        // The resampler starts from one silent frame of history
+        VERIFY(output[0] == 0.f && output[1] == 0.f);
+        VERIFY(Near(output[2], 0.5f * 0.707107f) && Near(output[3], 0.5f * 0.707107f));
+        VERIFY(Near(output[480 * 2], 0.5f * 0.707107f));
+        VERIFY(output[481 * 2] == 0.f && output[959 * 2 + 1] == 0.f);
+
+        VERIFY(callback.passStarts == 2 && callback.passEnds == 2);
+        VERIFY(callback.bufferStarts == 1 && callback.bufferEnds == 1 && callback.streamEnds == 1);
+
+        const auto state = voice->GetState();
+        VERIFY(state.buffersQueued == 0 && state.samplesPlayed == 480);
+        VERIFY(backend.GetPerformanceData().activeSourceVoices == 0);
+
+        // Stopping the engine renders silence
+        VERIFY(voice->Submit(MakeBuffer(samples.data(), samples.size() * sizeof(int16_t))) == Status::Ok);
+        backend.Stop();
+        backend.Render(output.data(), 480);
+        VERIFY(output[0] == 0.f && voice->GetState().samplesPlayed == 480);
+        backend.Start();
+        backend.Render(output.data(), 480);
+        VERIFY(output[2] != 0.f);
+
+        // Formats the mixer can't read safely
+        SourceVoice* bad = nullptr;
+        VERIFY(backend.CreateSourceVoice(MakeFormat(SampleFormat::PCM16, 1, 48000, 4), 0, 2.f, nullptr, &bad) == Status::InvalidCall);
+        VERIFY(backend.CreateSourceVoice(MakeFormat(SampleFormat::PCM16, 1, 100, 2), 0, 2.f, nullptr, &bad) == Status::InvalidCall);
+        VERIFY(bad == nullptr);
+
+        Format adpcm = MakeFormat(SampleFormat::ADPCM, 1, 48000, 1);
+        adpcm.blockAlign = 8;
+        adpcm.samplesPerBlock = 4;
+        VERIFY(backend.CreateSourceVoice(adpcm, 0, 2.f, nullptr, &bad) == Status::NotSupported);
+    }
+
+    // Float stereo through a submix with a swapped output matrix and a volume
+    void TestSubmix()
+    {
+        SoftwareBackend backend;
+
+        Voice* master = nullptr;
+        VERIFY(backend.CreateMasteringVoice(2, 48000, 0, &master) == Status::Ok);
+
+        Voice* submix = nullptr;
+        VERIFY(backend.CreateSubmixVoice(2, 44100, 0, 0, &submix) == Status::Ok);
+        VERIFY(submix->GetSampleRate() == 48000);
+        VERIFY(submix->SetVolume(0.5f) == Status::Ok);
+
+        std::vector<float> samples(480 * 2);
+        for (size_t j = 0; j < samples.size(); j += 2)
+        {
+            samples[j] = 1.f;
+        }
+
+        SourceVoice* voice = nullptr;
+        VERIFY(backend.CreateSourceVoice(MakeFormat(SampleFormat::Float32, 2, 48000, 4), 0, 1.f, nullptr, &voice) == Status::Ok);
+
+        // Sends must go to a later stage
+        Voice* self = voice;
+        VERIFY(submix->SetOutputs(&self, nullptr, 1) == Status::InvalidCall);
+        VERIFY(voice->SetOutputs(&submix, nullptr, 1) == Status::Ok);
+
+        const float swap[4] = { 0.f, 1.f, 1.f, 0.f };
+        VERIFY(voice->SetOutputMatrix(submix, 2, 2, swap) == Status::Ok);
+        VERIFY(voice->SetOutputMatrix(master, 2, 2, swap) == Status::InvalidCall);
+
+        float matrix[4] = {};
+        voice->GetOutputMatrix(nullptr, 2, 2, matrix);
+        VERIFY(memcmp(matrix, swap, sizeof(swap)) == 0);
+
+        VERIFY(voice->Submit(MakeBuffer(samples.data(), samples.size() * sizeof(float))) == Status::Ok);
+        voice->Start();
+
+        std::vector<float> output(480 * 2);
+        backend.Render(output.data(), 480);
+        VERIFY(Near(output[2], 0.f) && Near(output[3], 0.5f));
+        VERIFY(Near(output[958], 0.f) && Near(output[959], 0.5f));
+
+        // Destroying the submix drops the send to it
+        submix->Destroy();
+        VERIFY(backend.GetPerformanceData().submixVoices == 0);
+        VERIFY(voice->Submit(MakeBuffer(samples.data(), samples.size() * sizeof(float))) == Status::Ok);
+        backend.Render(output.data(), 480);
+        VERIFY(output[0] == 0.f && output[1] == 0.f);
+    }
+
+    // ADPCM decode, loops, and resampling a 24 kHz source to 48 kHz
+    void TestADPCMLoops()
+    {
+        SoftwareBackend backend;
+
+        Voice* master = nullptr;
+        VERIFY(backend.CreateMasteringVoice(1, 48000, 0, &master) == Status::Ok);
+
+        // Each block: predictor 0 (coefficients 256,0), delta 16, then 8192 and 4096 stored newest first.
+        // Zero codes repeat the last sample, so blocks decode as 4096, 8192, 8192, 8192.
+        static const ADPCMDecoder::Coefficients coefs[] = { { 256, 0 } };
+        std::vector<uint8_t> data;
+        for (size_t block = 0; block < 25; ++block)
+        {
+            const uint8_t header[8] = { 0, 16, 0, 0x00, 0x20, 0x00, 0x10, 0 };
+            data.insert(data.end(), header, header + sizeof(header));
+        }
+
+        Format format = MakeFormat(SampleFormat::ADPCM, 1, 24000, 1);
+        format.blockAlign = 8;
+        format.samplesPerBlock = 4;
+        format.coefficients = coefs;
+        format.coefficientCount = 1;
+
+        CountingCallback callback;
+        SourceVoice* voice = nullptr;
+        VERIFY(backend.CreateSourceVoice(format, 0, 2.f, &callback, &voice) == Status::Ok);
+
+        Buffer buffer = MakeBuffer(data.data(), data.size());
+        buffer.loopCount = 2;
+        VERIFY(voice->Submit(buffer) == Status::Ok);
+        voice->Start();
+
+        std::vector<float> output(960);
+        backend.Render(output.data(), 960);
+
+        // Resampled 2:1 with linear interpolation from a silent history frame
+        VERIFY(Near(output[0], 0.f) && Near(output[1], 0.0625f) && Near(output[2], 0.125f));
+        VERIFY(Near(output[3], 0.1875f) && Near(output[4], 0.25f) && Near(output[6], 0.25f));
+        VERIFY(Near(output[8], 0.25f) && Near(output[10], 0.125f));
+
+        // 100 frames played three times take 600 output frames
+        VERIFY(callback.loopEnds == 2 && callback.bufferEnds == 1 && callback.streamEnds == 1);
+        VERIFY(voice->GetState().samplesPlayed == 300);
+        VERIFY(Near(output[598], 0.25f) && Near(output[700], 0.f));
+
+        // Frequency ratio is clamped to the maximum given at creation
+        VERIFY(voice->SetFrequencyRatio(8.f) == Status::Ok);
+        VERIFY(voice->GetFrequencyRatio() == 2.f);
+
+        SourceVoice* fixed = nullptr;
+        VERIFY(backend.CreateSourceVoice(format, VOICE_NOPITCH, 1.f, nullptr, &fixed) == Status::Ok);
+        VERIFY(fixed->SetFrequencyRatio(0.5f) == Status::InvalidCall);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Callbacks that destroy and create voices while Render walks the source list
+    void TestDestroyInCallback()
+    {
+        SoftwareBackend backend;
+
+        Voice* master = nullptr;
+        VERIFY(backend.CreateMasteringVoice(2, 48000, 0, &master) == Status::Ok);
+
+        const std::vector<int16_t> shortSamples(100, 8192);
+        const std::vector<int16_t> longSamples(48000, 8192);
+        const Format format = MakeFormat(SampleFormat::PCM16, 1, 48000, 2);
+
+        constexpr size_t c_voices = 8;
+        CountingCallback callbacks[c_voices];
+        SourceVoice* voices[c_voices] = {};
+        for (size_t j = 0; j < c_voices; ++j)
+        {
+            VERIFY(backend.CreateSourceVoice(format, 0, 1.f, &callbacks[j], &voices[j]) == Status::Ok);
+            voices[j]->Start();
+        }
+
+        // Voice 0 ends its buffer first and destroys itself, the last voice, and creates a replacement
+        std::vector<CountingCallback> created(4);
+        SourceVoice* replacement = nullptr;
+        callbacks[0].onBufferEnd = [&]()
+            {
+                voices[0]->Destroy();
+                voices[c_voices - 1]->Destroy();
+                VERIFY(backend.CreateSourceVoice(format, 0, 1.f, &created[0], &replacement) == Status::Ok);
+                replacement->Start();
+                VERIFY(replacement->Submit(MakeBuffer(longSamples.data(), longSamples.size() * sizeof(int16_t))) == Status::Ok);
+            };
+
+        // Voice 1 destroys itself from OnBufferEnd while its stream is still queued after it
+        callbacks[1].onBufferEnd = [&]() { voices[1]->Destroy(); };
+
+        VERIFY(voices[0]->Submit(MakeBuffer(shortSamples.data(), shortSamples.size() * sizeof(int16_t))) == Status::Ok);
+        VERIFY(voices[1]->Submit(MakeBuffer(shortSamples.data(), shortSamples.size() * sizeof(int16_t), false)) == Status::Ok);
+        VERIFY(voices[1]->Submit(MakeBuffer(shortSamples.data(), shortSamples.size() * sizeof(int16_t))) == Status::Ok);
+        for (size_t j = 2; j < c_voices; ++j)
+        {
+            VERIFY(voices[j]->Submit(MakeBuffer(longSamples.data(), longSamples.size() * sizeof(int16_t))) == Status::Ok);
+        }
+
+        std::vector<float> output(480 * 2);
+        backend.Render(output.data(), 480);
+
+        // No callbacks after a voice is destroyed, and the voice destroyed ahead of its turn never ran
+        VERIFY(callbacks[0].bufferEnds == 1 && callbacks[0].streamEnds == 0 && callbacks[0].passEnds == 0);
+        VERIFY(callbacks[1].bufferEnds == 1 && callbacks[1].bufferStarts == 1 && callbacks[1].passEnds == 0);
+        VERIFY(callbacks[c_voices - 1].passStarts == 0);
+        for (size_t j = 2; j < c_voices - 1; ++j)
+        {
+            VERIFY(callbacks[j].passStarts == 1 && callbacks[j].passEnds == 1);
+        }
+
+        // The replacement starts on the next pass
+        VERIFY(created[0].passStarts == 0);
+        VERIFY(backend.GetPerformanceData().totalSourceVoices == c_voices - 2);
+
+        // Five voices of 0.25 at 0.707 each
+        VERIFY(Near(output[479 * 2], 5.f * 0.25f * 0.707107f));
+
+        backend.Render(output.data(), 480);
+        VERIFY(created[0].passStarts == 1);
+        VERIFY(Near(output[2], 6.f * 0.25f * 0.707107f));
+
+        // Destroying the mastering voice from a callback silences the rest of the call
+        callbacks[2].onBufferEnd = [&]() { master->Destroy(); };
+        voices[2]->Flush();
+        voices[2]->Stop();
+        voices[2]->Flush();
+
+        output.assign(960 * 2, -1.f);
+        backend.Render(output.data(), 960);
+        VERIFY(backend.GetMasteringVoice() == nullptr);
+        VERIFY(output[0] == 0.f && output[959 * 2 + 1] == 0.f);
+
+        SourceVoice* orphan = nullptr;
+        VERIFY(backend.CreateSourceVoice(format, 0, 1.f, nullptr, &orphan) == Status::InvalidCall);
+
+        // A new mastering voice picks up where the old one left off
+        VERIFY(backend.CreateMasteringVoice(2, 48000, 0, &master) == Status::Ok);
+        VERIFY(voices[3]->SetOutputs(nullptr, nullptr, 0) == Status::Ok);
+        backend.Render(output.data(), 480);
+        VERIFY(Near(output[0], 0.25f * 0.707107f));
+    }
+
+    // Renders to the null and .wav file sinks
+    void TestSinks()
+    {
+        SoftwareBackend backend;
+
+        NullSink nullSink;
+        VERIFY(!backend.Render(nullSink, 480));
+
+        Voice* master = nullptr;
+        VERIFY(backend.CreateMasteringVoice(2, 44100, 0, &master) == Status::Ok);
+
+        const std::vector<int16_t> samples(44100, 16384);
+        SourceVoice* voice = nullptr;
+        VERIFY(backend.CreateSourceVoice(MakeFormat(SampleFormat::PCM16, 1, 44100, 2), 0, 1.f, nullptr, &voice) == Status::Ok);
+        VERIFY(voice->Submit(MakeBuffer(samples.data(), samples.size() * sizeof(int16_t))) == Status::Ok);
+        voice->Start();
+
+        VERIFY(backend.Render(nullSink, 1000, 256));
+        VERIFY(nullSink.GetFrames() == 1000);
+        VERIFY(voice->GetState().samplesPlayed == 1000);
+
+        std::FILE* file = std::tmpfile();
+        VERIFY(file != nullptr);
+        if (!file)
+            return;
+
+        WAVFileSink fileSink(file, 2, 44100);
+        VERIFY(backend.Render(fileSink, 1000));
+        VERIFY(fileSink.GetDataBytes() == 1000 * 2 * sizeof(float));
+        VERIFY(fileSink.Finish());
+
+        std::vector<uint8_t> bytes(44 + 1000 * 2 * sizeof(float) + 1);
+        std::rewind(file);
+        const size_t size = std::fread(bytes.data(), 1, bytes.size(), file);
+        std::fclose(file);
+
+        VERIFY(size == bytes.size() - 1);
+
+        uint32_t riffSize, dataSize;
+        uint16_t tag, channels;
+        memcpy(&riffSize, bytes.data() + 4, 4);
+        memcpy(&tag, bytes.data() + 20, 2);
+        memcpy(&channels, bytes.data() + 22, 2);
+        memcpy(&dataSize, bytes.data() + 40, 4);
+        VERIFY(memcmp(bytes.data(), "RIFF", 4) == 0 && memcmp(bytes.data() + 8, "WAVEfmt ", 8) == 0);
+        VERIFY(memcmp(bytes.data() + 36, "data", 4) == 0);
+        VERIFY(riffSize == size - 8 && dataSize == 1000 * 2 * sizeof(float));
+        VERIFY(tag == 3 && channels == 2);
+
+        float first;
+        memcpy(&first, bytes.data() + 44, sizeof(first));
+        VERIFY(Near(first, 0.5f * 0.707107f));
+    }
+
+    //----------------------------------------------------------------------------------
+    // Mixes looping voices into a 48 kHz stereo bus rendered to the null sink. Sources are
+    // 44.1 kHz, so every voice is resampled. "x realtime" is seconds of audio per second
+    // of CPU, and "us/voice" is CPU time per voice per second of audio.
+    void Benchmark(const char* name, size_t voiceCount, const Format& format, const std::vector<uint8_t>& data)
+    {
+        SoftwareBackend backend;
+
+        Voice* master = nullptr;
+        VERIFY(backend.CreateMasteringVoice(2, 48000, 0, &master) == Status::Ok);
+
+        for (size_t j = 0; j < voiceCount; ++j)
+        {
+            SourceVoice* voice = nullptr;
+            VERIFY(backend.CreateSourceVoice(format, 0, 2.f, nullptr, &voice) == Status::Ok);
+            if (!voice)
+                return;
+
+            Buffer buffer = MakeBuffer(data.data(), data.size());
+            buffer.loopCount = LOOP_INFINITE;
+            VERIFY(voice->Submit(buffer) == Status::Ok);
+            VERIFY(voice->SetVolume(1.f / float(voiceCount)) == Status::Ok);
+            VERIFY(voice->SetFrequencyRatio(1.f + float(j % 7) * 0.01f) == Status::Ok);
+            voice->Start();
+        }
+
+        NullSink sink;
+
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        double seconds = 0;
+        do
+        {
+            VERIFY(backend.Render(sink, 48000));
+            seconds = std::chrono::duration<double>(clock::now() - start).count();
+        } while (seconds < 0.25);
+
+        const double audioSeconds = double(sink.GetFrames()) / 48000.0;
+        printf("%-12s %5zu voices %10.1fx realtime %8.2f us/voice\n", name, voiceCount,
+            audioSeconds / seconds, seconds * 1e6 / (audioSeconds * double(voiceCount)));
+    }
+
+    void BenchmarkVoices()
+    {
+        std::vector<uint8_t> pcm(44100 * 2 * sizeof(int16_t));
+        for (size_t j = 0; j < pcm.size() / sizeof(int16_t); ++j)
+        {
+            const auto value = static_cast<int16_t>(8000.0 * std::sin(double(j / 2) * 0.0627));
+            memcpy(pcm.data() + j * sizeof(int16_t), &value, sizeof(value));
+        }
+
+        static const ADPCMDecoder::Coefficients coefs[] =
+        {
+            { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 }, { 240, 0 }, { 460, -208 }, { 392, -232 }
+        };
+
+        // Stereo, 512 samples per block
+        std::vector<uint8_t> adpcm(ADPCMDecoder::BlockSize(2, 512) * 86);
+        for (size_t j = 0; j < adpcm.size(); ++j)
+        {
+            adpcm[j] = static_cast<uint8_t>(j * 37 + 11);
+        }
+        for (size_t block = 0; block < adpcm.size(); block += ADPCMDecoder::BlockSize(2, 512))
+        {
+            adpcm[block] = 1;
+            adpcm[block + 1] = 1;
+        }
+
+        const Format pcmFormat = MakeFormat(SampleFormat::PCM16, 2, 44100, 2);
+
+        Format adpcmFormat = MakeFormat(SampleFormat::ADPCM, 2, 44100, 1);
+        adpcmFormat.blockAlign = static_cast<uint32_t>(ADPCMDecoder::BlockSize(2, 512));
+        adpcmFormat.samplesPerBlock = 512;
+        adpcmFormat.coefficients = coefs;
+        adpcmFormat.coefficientCount = 7;
+
+        for (size_t voices : { 16u, 64u, 256u })
+        {
+            Benchmark("PCM16", voices, pcmFormat, pcm);
+        }
+
+        for (size_t voices : { 16u, 64u, 256u })
+        {
+            Benchmark("ADPCM", voices, adpcmFormat, adpcm);
+        }
+    }
+}
+
+int main()
+{
+    TestPCM();
+    TestSubmix();
+    TestADPCMLoops();
+    TestDestroyInCallback();
+    TestSinks();
+
+    BenchmarkVoices();
+
+    return TestHelpers::Finish("SoftwareBackendTest");
+}
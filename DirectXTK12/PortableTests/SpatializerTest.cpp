@@ -0,0 +1,301 @@
+//--------------------------------------------------------------------------------------
+// File: SpatializerTest.cpp
+//
+// Compares the four-wide Spatializer::Calculate against the scalar CalculateReference
+// over randomized listeners and emitters, covering curves, cones, and Doppler.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "Spatializer.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::Spatializer;
+
+namespace
+{
+    // The SIMD path uses DirectXMath's polynomial acos/atan2/cos and fused multiply-adds, so it only
+    // matches the scalar path to within a few ulps of those approximations.
+    constexpr float c_tolerance = 2e-3f;
+
+    constexpr uint32_t c_layouts[][2] =
+    {
+        { 0x4, 1 },         // Mono
+        { 0x3, 2 },         // Stereo
+        { 0x33, 4 },        // Quad
+        { 0x3F, 6 },        // 5.1
+        { 0x63F, 8 },       // 7.1
+    };
+
+    bool Near(float a, float b)
+    {
+        return std::fabs(a - b) <= c_tolerance * std::max(1.f, std::fabs(b));
+    }
+
+    class Generator
+    {
+    public:
+        explicit Generator(uint32_t seed) : mRng(seed) {}
+
+        float Uniform(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(mRng); }
+        bool Chance(float p) { return Uniform(0.f, 1.f) < p; }
+
+        XMFLOAT3 Vector(float extent)
+        {
+            return XMFLOAT3(Uniform(-extent, extent), Uniform(-extent, extent), Uniform(-extent, extent));
+        }
+
+        XMFLOAT3 Direction()
+        {
+            for (;;)
+            {
+                const XMFLOAT3 v = Vector(1.f);
+                const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+                if (length > 0.1f)
+                    return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+            }
+        }
+
+        // Inner and outer angles stay clear of each other so the weight isn't dominated by acos error.
+        Cone MakeCone()
+        {
+            Cone cone;
+            cone.innerAngle = Uniform(0.f, XM_PI);
+            cone.outerAngle = cone.innerAngle + Uniform(0.5f, XM_2PI - cone.innerAngle);
+            cone.innerVolume = Uniform(0.5f, 1.f);
+            cone.outerVolume = Uniform(0.f, 0.5f);
+            cone.innerLPF = Uniform(0.5f, 1.f);
+            cone.outerLPF = Uniform(0.f, 1.f);
+            cone.innerReverb = Uniform(0.f, 2.f);
+            cone.outerReverb = Uniform(0.f, 2.f);
+            return cone;
+        }
+
+        // Includes zero-width segments, which step the value.
+        std::vector<CurvePoint> MakeCurve()
+        {
+            std::vector<CurvePoint> points;
+            const int count = std::uniform_int_distribution<int>(1, 6)(mRng);
+            float distance = 0.f;
+            for (int j = 0; j < count; ++j)
+            {
+                if (j > 0 && !Chance(0.15f))
+                    distance += Uniform(0.05f, 0.4f);
+                points.push_back(CurvePoint{ distance, Uniform(0.f, 1.f) });
+            }
+            return points;
+        }
+
+    private:
+        std::mt19937 mRng;
+    };
+
+    size_t Compare(
+        const Listener& listener, const Speakers& speakers, const std::vector<Emitter>& emitters,
+        float speedOfSound, bool redirectToLFE)
+    {
+        std::vector<Result> expected(emitters.size());
+        std::vector<Result> actual(emitters.size());
+
+        CalculateReference(listener, speakers, emitters.data(), emitters.size(), speedOfSound, redirectToLFE, expected.data());
+        Calculate(listener, speakers, emitters.data(), emitters.size(), speedOfSound, redirectToLFE, actual.data());
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < emitters.size(); ++i)
+        {
+            const Result& e = expected[i];
+            const Result& a = actual[i];
+
+            bool same = Near(a.dopplerFactor, e.dopplerFactor)
+                && Near(a.lpfDirect, e.lpfDirect)
+                && Near(a.lpfReverb, e.lpfReverb)
+                && Near(a.reverbLevel, e.reverbLevel);
+
+            for (uint32_t c = 0; c < c_maxChannels; ++c)
+                same = same && Near(a.matrix[c], e.matrix[c]);
+
+            if (!same)
+            {
+                if (!mismatches)
+                {
+                    printf("Emitter %zu: doppler %f/%f lpf %f/%f %f/%f reverb %f/%f\n", i,
+                        double(a.dopplerFactor), double(e.dopplerFactor),
+                        double(a.lpfDirect), double(e.lpfDirect),
+                        double(a.lpfReverb), double(e.lpfReverb),
+                        double(a.reverbLevel), double(e.reverbLevel));
+                    for (uint32_t c = 0; c < speakers.channels; ++c)
+                        printf("  [%u] %f/%f\n", c, double(a.matrix[c]), double(e.matrix[c]));
+                }
+                ++mismatches;
+            }
+        }
+
+        return mismatches;
+    }
+
+    void TestRandomized()
+    {
+        Generator gen(2024);
+
+        size_t total = 0;
+        size_t mismatches = 0;
+
+        for (int trial = 0; trial < 400; ++trial)
+        {
+            const auto& layout = c_layouts[trial % std::size(c_layouts)];
+            Speakers speakers;
+            VERIFY(InitializeSpeakers(layout[0], layout[1], speakers));
+
+            // Listener with an orthogonal front and top.
+            Listener listener = {};
+            listener.front = gen.Direction();
+            const XMFLOAT3 up = gen.Direction();
+            {
+                const XMVECTOR front = XMLoadFloat3(&listener.front);
+                XMVECTOR top = XMLoadFloat3(&up);
+                top = XMVector3Normalize(XMVectorSubtract(top, XMVectorMultiply(XMVector3Dot(top, front), front)));
+                XMStoreFloat3(&listener.top, top);
+            }
+            listener.position = gen.Vector(20.f);
+            listener.velocity = gen.Chance(0.7f) ? gen.Vector(30.f) : XMFLOAT3(0.f, 0.f, 0.f);
+
+            Cone listenerCone = gen.MakeCone();
+            listener.cone = gen.Chance(0.5f) ? &listenerCone : nullptr;
+
+            // Emitters draw from small pools, so lanes often share a curve or cone as emitters built from one template would.
+            std::vector<std::vector<CurvePoint>> points;
+            for (int j = 0; j < 24; ++j)
+                points.push_back(gen.MakeCurve());
+
+            std::vector<Curve> curves;
+            for (auto const& p : points)
+                curves.push_back(Curve{ p.data(), static_cast<uint32_t>(p.size()) });
+
+            std::vector<Cone> cones;
+            for (int j = 0; j < 16; ++j)
+                cones.push_back(gen.MakeCone());
+
+            auto pickCurve = [&]() -> const Curve*
+                {
+                    if (gen.Chance(0.3f))
+                        return nullptr;
+                    return &curves[size_t(gen.Uniform(0.f, float(curves.size()) - 0.01f))];
+                };
+
+            const size_t count = 1 + size_t(gen.Uniform(0.f, 13.99f));
+            std::vector<Emitter> emitters(count);
+            for (auto& emitter : emitters)
+            {
+                emitter = {};
+                emitter.front = gen.Direction();
+                emitter.position = gen.Chance(0.05f) ? listener.position : gen.Vector(50.f);
+                emitter.velocity = gen.Chance(0.7f) ? gen.Vector(30.f) : XMFLOAT3(0.f, 0.f, 0.f);
+                emitter.cone = gen.Chance(0.6f) ? &cones[size_t(gen.Uniform(0.f, 15.99f))] : nullptr;
+                emitter.innerRadius = gen.Chance(0.4f) ? gen.Uniform(0.5f, 20.f) : 0.f;
+                emitter.curveDistanceScaler = gen.Uniform(0.5f, 30.f);
+                emitter.dopplerScaler = gen.Chance(0.8f) ? gen.Uniform(0.25f, 2.f) : 0.f;
+                emitter.volumeCurve = pickCurve();
+                emitter.lfeCurve = pickCurve();
+                emitter.lpfDirectCurve = pickCurve();
+                emitter.lpfReverbCurve = pickCurve();
+                emitter.reverbCurve = pickCurve();
+            }
+
+            mismatches += Compare(listener, speakers, emitters, 343.5f, gen.Chance(0.5f));
+            total += count;
+        }
+
+        printf("Randomized: %zu of %zu emitters differ\n", mismatches, total);
+        VERIFY(mismatches == 0);
+    }
+
+    // Hand-picked cases where the lanes diverge in which branch they would take.
+    void TestEdges()
+    {
+        Speakers speakers;
+        VERIFY(InitializeSpeakers(0x3F, 6, speakers));
+        VERIFY(speakers.lfe == 3 && speakers.count == 5);
+
+        Listener listener = {};
+        listener.front = XMFLOAT3(0.f, 0.f, 1.f);
+        listener.top = XMFLOAT3(0.f, 1.f, 0.f);
+
+        const CurvePoint stepPoints[] = { { 0.f, 1.f }, { 0.5f, 1.f }, { 0.5f, 0.25f }, { 1.f, 0.f } };
+        const Curve step = { stepPoints, 4 };
+
+        // Cone with equal inner and outer angles: a hard edge.
+        const Cone hard = { XM_PIDIV2, XM_PIDIV2, 1.f, 0.f, 1.f, 0.5f, 1.f, 0.f };
+
+        std::vector<Emitter> emitters(7);
+        for (auto& e : emitters)
+        {
+            e = {};
+            e.front = XMFLOAT3(0.f, 0.f, -1.f);
+            e.curveDistanceScaler = 10.f;
+            e.dopplerScaler = 1.f;
+        }
+
+        emitters[0].position = XMFLOAT3(0.f, 0.f, 0.f);                 // On top of the listener
+        emitters[1].position = XMFLOAT3(0.f, 0.f, 3.f);                 // Before the curve step...
+        emitters[1].volumeCurve = &step;
+        emitters[2].position = XMFLOAT3(0.f, 0.f, 7.f);                 // ...and after it
+        emitters[2].volumeCurve = &step;
+        emitters[3].position = XMFLOAT3(0.f, 0.f, 200.f);               // Past the last point
+        emitters[3].volumeCurve = &step;
+        emitters[4].position = XMFLOAT3(4.f, 0.f, 4.f);                 // Inside the hard cone
+        emitters[4].cone = &hard;
+        emitters[4].front = XMFLOAT3(-0.6f, 0.f, -0.8f);
+        emitters[5].position = XMFLOAT3(0.f, 0.f, -5.f);                // Behind, approaching fast
+        emitters[5].velocity = XMFLOAT3(0.f, 0.f, 200.f);
+        emitters[5].dopplerScaler = 1.5f;
+        emitters[6].position = XMFLOAT3(-2.f, 0.f, 1.f);                // Inside the inner radius
+        emitters[6].innerRadius = 5.f;
+
+        VERIFY(Compare(listener, speakers, emitters, 343.5f, true) == 0);
+
+        std::vector<Result> results(emitters.size());
+        Calculate(listener, speakers, emitters.data(), emitters.size(), 343.5f, true, results.data());
+
+        VERIFY(Near(results[1].matrix[2], 1.f));                        // Dead ahead: all center
+        VERIFY(Near(results[2].matrix[2], 0.15f));
+        VERIFY(Near(results[3].matrix[2], 0.f));
+        VERIFY(results[5].dopplerFactor > 1.f);                         // Approaching raises pitch
+
+        // Moving away lowers it.
+        emitters[5].velocity = XMFLOAT3(0.f, 0.f, -50.f);
+        Calculate(listener, speakers, emitters.data(), emitters.size(), 343.5f, true, results.data());
+        VERIFY(results[5].dopplerFactor < 1.f);
+        VERIFY(Compare(listener, speakers, emitters, 343.5f, true) == 0);
+
+        // A listener moving toward the emitter also raises it.
+        emitters[5].velocity = XMFLOAT3(0.f, 0.f, 0.f);
+        listener.velocity = XMFLOAT3(0.f, 0.f, -40.f);
+        Calculate(listener, speakers, emitters.data(), emitters.size(), 343.5f, true, results.data());
+        VERIFY(results[5].dopplerFactor > 1.f);
+        VERIFY(Compare(listener, speakers, emitters, 343.5f, true) == 0);
+
+        // Layouts the batched path can't take.
+        Speakers unused;
+        VERIFY(!InitializeSpeakers(0x3, 3, unused));
+        VERIFY(!InitializeSpeakers(0x3FF, 10, unused));
+        VERIFY(!InitializeSpeakers(0x3F, 0, unused));
+    }
+}
+
+int main()
+{
+    TestRandomized();
+    TestEdges();
+
+    return TestHelpers::Finish("SpatializerTest");
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------
+// File: TestHelpers.h
+//
+// Minimal checks for the platform-neutral tests. Each test keeps going after a failure
+// and main returns nonzero if any check failed.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdio>
+
+
+namespace TestHelpers
+{
+    inline int& FailureCount() noexcept
+    {
+        static int s_failures = 0;
+        return s_failures;
+    }
+
+    inline void Fail(const char* what, const char* file, int line) noexcept
+    {
+        printf("FAILED: %s (%s:%d)\n", what, file, line);
+        ++FailureCount();
+    }
+
+    inline int Finish(const char* name) noexcept
+    {
+        if (FailureCount())
+        {
+            printf("%s: %d check(s) failed\n", name, FailureCount());
+            return 1;
+        }
+
+        printf("%s: passed\n", name);
+        return 0;
+    }
+}
+
+#define VERIFY(expr) \
+    do { if (!(expr)) TestHelpers::Fail(#expr, __FILE__, __LINE__); } while (0)
+
+#define VERIFY_THROWS(expr, type) \
+    do { bool thrown_ = false; try { expr; } catch (const type&) { thrown_ = true; } \
+         if (!thrown_) TestHelpers::Fail(#expr " did not throw " #type, __FILE__, __LINE__); } while (0)
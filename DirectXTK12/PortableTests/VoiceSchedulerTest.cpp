@@ -0,0 +1,306 @@
+//--------------------------------------------------------------------------------------
+// File: VoiceSchedulerTest.cpp
+//
+// Drives the virtual voice scheduler against a stub backend with a fixed voice budget.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "VoiceScheduler.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+using namespace DirectX::VoiceScheduler;
+
+namespace
+{
+    // Stands in for the XAudio2 voice pool: a promotion takes a voice, a demotion returns it.
+    struct StubBackend
+    {
+        size_t available;
+        size_t promotions;
+        size_t demotions;
+    };
+
+    struct StubVoice
+    {
+        StubBackend* backend;
+        int priority;
+        float audibility;
+        bool real;
+
+        bool Promote()
+        {
+            if (!backend->available)
+                return false;
+
+            --backend->available;
+            ++backend->promotions;
+            real = true;
+            return true;
+        }
+
+        void Demote()
+        {
+            ++backend->available;
+            ++backend->demotions;
+            real = false;
+        }
+    };
+
+    // One AudioEngine::Update: schedule, then apply. Returns the failed promotions.
+    size_t Update(std::vector<StubVoice>& voices, size_t maxReal, float minAudibility)
+    {
+        std::vector<Candidate> candidates;
+        std::vector<StubVoice*> pointers;
+        for (auto& voice : voices)
+        {
+            candidates.push_back(Candidate{ voice.priority, voice.audibility, voice.real, false });
+            pointers.push_back(&voice);
+        }
+
+        Schedule(candidates.data(), candidates.size(), maxReal, minAudibility);
+        return Apply(candidates.data(), pointers.data(), pointers.size());
+    }
+
+    std::vector<bool> Chosen(std::vector<Candidate> const& candidates)
+    {
+        std::vector<bool> result;
+        for (auto const& c : candidates)
+            result.push_back(c.makeReal);
+        return result;
+    }
+
+    void TestRanking()
+    {
+        std::vector<Candidate> candidates = {
+            { 0, 0.9f, false, false },
+            { 1, 0.2f, false, false },      // Higher priority beats louder
+            { 0, 0.5f, false, false },
+            { 1, 0.3f, false, false },
+            { 0, 0.7f, false, false },
+            { -1, 1.0f, false, false },
+        };
+
+        size_t count = Schedule(candidates.data(), candidates.size(), 3, 0.f);
+        VERIFY(count == 3);
+        VERIFY((Chosen(candidates) == std::vector<bool>{ true, true, false, true, false, false }));
+
+        // Room for everyone
+        count = Schedule(candidates.data(), candidates.size(), 10, 0.f);
+        VERIFY(count == 6);
+
+        // Equal scores fall back to the lower index.
+        std::vector<Candidate> ties(4, Candidate{ 0, 0.5f, false, false });
+        count = Schedule(ties.data(), ties.size(), 2, 0.f);
+        VERIFY(count == 2);
+        VERIFY((Chosen(ties) == std::vector<bool>{ true, true, false, false }));
+
+        // Stale makeReal values are cleared.
+        std::vector<Candidate> stale = { { 0, 0.5f, false, true }, { 0, 0.6f, false, true } };
+        count = Schedule(stale.data(), stale.size(), 0, 0.f);
+        VERIFY(count == 0);
+        VERIFY(!stale[0].makeReal && !stale[1].makeReal);
+
+        VERIFY(Schedule(nullptr, 0, 4, 0.f) == 0);
+    }
+
+    void TestHysteresis()
+    {
+        // The current owner keeps its voice unless the challenger is more than c_hysteresis louder.
+        std::vector<Candidate> candidates = {
+            { 0, 0.5f, true, false },
+            { 0, 0.5f * c_hysteresis * 0.99f, false, false },
+        };
+
+        Schedule(candidates.data(), candidates.size(), 1, 0.f);
+        VERIFY(candidates[0].makeReal && !candidates[1].makeReal);
+
+        candidates[1].audibility = 0.5f * c_hysteresis * 1.01f;
+        Schedule(candidates.data(), candidates.size(), 1, 0.f);
+        VERIFY(!candidates[0].makeReal && candidates[1].makeReal);
+
+        // Priority still wins outright.
+        candidates = { { 0, 1.0f, true, false }, { 1, 0.1f, false, false } };
+        Schedule(candidates.data(), candidates.size(), 1, 0.f);
+        VERIFY(!candidates[0].makeReal && candidates[1].makeReal);
+
+        // Two emitters wobbling around the same loudness must not trade the voice every frame.
+        StubBackend backend = { 1, 0, 0 };
+        std::vector<StubVoice> voices = {
+            { &backend, 0, 0.5f, false },
+            { &backend, 0, 0.5f, false },
+        };
+
+        VERIFY(Update(voices, 1, 0.f) == 0);
+        VERIFY(voices[0].real && !voices[1].real);
+
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            const float wobble = (frame & 1) ? 0.1f : -0.1f;
+            voices[0].audibility = 0.5f * (1.f + wobble);
+            voices[1].audibility = 0.5f * (1.f - wobble);
+            VERIFY(Update(voices, 1, 0.f) == 0);
+        }
+
+        VERIFY(voices[0].real && !voices[1].real);
+        VERIFY(backend.promotions == 1 && backend.demotions == 0);
+    }
+
+    void TestMinAudibility()
+    {
+        const float minAudibility = 0.1f;
+
+        // Below the cutoff nothing is promoted, even with voices to spare.
+        std::vector<Candidate> candidates = {
+            { 0, 0.09f, false, false },
+            { 5, 0.0f, false, false },
+            { 0, 0.1f, false, false },
+        };
+        size_t count = Schedule(candidates.data(), candidates.size(), 8, minAudibility);
+        VERIFY(count == 1);
+        VERIFY((Chosen(candidates) == std::vector<bool>{ false, false, true }));
+
+        // A real voice is held within the hysteresis margin of the cutoff, then released below it.
+        candidates = { { 0, minAudibility / c_hysteresis * 1.01f, true, false } };
+        Schedule(candidates.data(), candidates.size(), 8, minAudibility);
+        VERIFY(candidates[0].makeReal);
+
+        candidates = { { 0, minAudibility / c_hysteresis * 0.99f, true, false } };
+        Schedule(candidates.data(), candidates.size(), 8, minAudibility);
+        VERIFY(!candidates[0].makeReal);
+
+        // Through the stub backend, a fading voice gives its slot back.
+        StubBackend backend = { 4, 0, 0 };
+        std::vector<StubVoice> voices = { { &backend, 0, 1.f, false } };
+        Update(voices, 4, minAudibility);
+        VERIFY(voices[0].real && backend.available == 3);
+
+        voices[0].audibility = 0.f;
+        Update(voices, 4, minAudibility);
+        VERIFY(!voices[0].real && backend.available == 4);
+    }
+
+    void TestApply()
+    {
+        // With exactly maxReal voices, demoting first lets every promotion succeed.
+        StubBackend backend = { 2, 0, 0 };
+        std::vector<StubVoice> voices = {
+            { &backend, 0, 0.9f, false },
+            { &backend, 0, 0.8f, false },
+            { &backend, 0, 0.1f, false },
+            { &backend, 0, 0.2f, false },
+        };
+
+        VERIFY(Update(voices, 2, 0.f) == 0);
+        VERIFY(voices[0].real && voices[1].real);
+
+        voices[0].audibility = voices[1].audibility = 0.01f;
+        VERIFY(Update(voices, 2, 0.f) == 0);
+        VERIFY(!voices[0].real && !voices[1].real && voices[2].real && voices[3].real);
+        VERIFY(backend.available == 0);
+
+        // A backend with fewer voices than maxReal reports the promotions it could not make.
+        StubBackend small = { 1, 0, 0 };
+        std::vector<StubVoice> more = {
+            { &small, 0, 0.9f, false },
+            { &small, 0, 0.8f, false },
+            { &small, 0, 0.7f, false },
+        };
+        VERIFY(Update(more, 3, 0.f) == 2);
+        VERIFY(small.available == 0);
+    }
+
+    // Compares against a full sort over many random frames with a persistent voice pool.
+    void TestRandomized()
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> loudness(0.f, 1.f);
+        std::uniform_int_distribution<int> priority(0, 2);
+
+        const size_t maxReal = 8;
+        const float minAudibility = 0.05f;
+
+        StubBackend backend = { maxReal, 0, 0 };
+        std::vector<StubVoice> voices(40);
+        for (auto& voice : voices)
+        {
+            voice = StubVoice{ &backend, priority(rng), loudness(rng), false };
+        }
+
+        for (int frame = 0; frame < 500; ++frame)
+        {
+            for (auto& voice : voices)
+            {
+                voice.audibility = std::min(1.f, std::max(0.f, voice.audibility + (loudness(rng) - 0.5f) * 0.2f));
+            }
+
+            std::vector<Candidate> candidates;
+            for (auto const& voice : voices)
+            {
+                candidates.push_back(Candidate{ voice.priority, voice.audibility, voice.real, false });
+            }
+
+            std::vector<Candidate> expected = candidates;
+            Schedule(candidates.data(), candidates.size(), maxReal, minAudibility);
+
+            std::vector<size_t> order;
+            for (size_t j = 0; j < expected.size(); ++j)
+            {
+                const float s = expected[j].isReal ? expected[j].audibility * c_hysteresis : expected[j].audibility;
+                if (s >= minAudibility)
+                    order.push_back(j);
+            }
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                {
+                    if (expected[a].priority != expected[b].priority)
+                        return expected[a].priority > expected[b].priority;
+                    const float sa = expected[a].isReal ? expected[a].audibility * c_hysteresis : expected[a].audibility;
+                    const float sb = expected[b].isReal ? expected[b].audibility * c_hysteresis : expected[b].audibility;
+                    if (sa != sb)
+                        return sa > sb;
+                    return a < b;
+                });
+            if (order.size() > maxReal)
+                order.resize(maxReal);
+            for (auto j : order)
+                expected[j].makeReal = true;
+
+            VERIFY(Chosen(candidates) == Chosen(expected));
+
+            std::vector<StubVoice*> pointers;
+            for (auto& voice : voices)
+                pointers.push_back(&voice);
+
+            VERIFY(Apply(candidates.data(), pointers.data(), pointers.size()) == 0);
+
+            size_t real = 0;
+            for (size_t j = 0; j < voices.size(); ++j)
+            {
+                VERIFY(voices[j].real == candidates[j].makeReal);
+                if (voices[j].real)
+                    ++real;
+            }
+            VERIFY(real + backend.available == maxReal);
+        }
+    }
+}
+
+int main()
+{
+    TestRanking();
+    TestHysteresis();
+    TestMinAudibility();
+    TestApply();
+    TestRandomized();
+
+    return TestHelpers::Finish("VoiceSchedulerTest");
+}
@@ -0,0 +1,574 @@
+//--------------------------------------------------------------------------------------
+// File: WAVChunkParserTest.cpp
+//
+// Builds .wav files in memory and checks the chunks, loop points, and tables the parser
+// finds. Loading without the audio must never read the 'data' chunk, and damaged files
+// must be rejected or leave truncated chunks unloaded. Also times parsing a corpus of
+// large files by reading the whole image, the used chunks, or just the headers.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "WAVChunkParser.h"
+#include "TestHelpers.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX::WAVChunkParser;
+
+namespace
+{
+    constexpr uint32_t FOURCC_LIST_TAG = MakeFourCC('L', 'I', 'S', 'T');
+    constexpr uint32_t FOURCC_JUNK_TAG = MakeFourCC('J', 'U', 'N', 'K');
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& file, const T& value)
+    {
+        const size_t at = file.size();
+        file.resize(at + sizeof(T));
+        memcpy(&file[at], &value, sizeof(T));
+    }
+
+    // Appends a chunk of size bytes, copied from body if given, else filled with fill. Returns the body offset.
+    size_t AddChunk(std::vector<uint8_t>& file, uint32_t tag, const void* body, size_t size, uint8_t fill = 0)
+    {
+        Append(file, RIFFChunk{ tag, static_cast<uint32_t>(size) });
+
+        const size_t at = file.size();
+        file.resize(at + size, fill);
+        if (body && size)
+            memcpy(&file[at], body, size);
+        return at;
+    }
+
+    template<typename T>
+    size_t AddChunk(std::vector<uint8_t>& file, uint32_t tag, const std::vector<T>& body)
+    {
+        return AddChunk(file, tag, body.data(), body.size() * sizeof(T));
+    }
+
+    std::vector<uint8_t> BeginFile(uint32_t riff)
+    {
+        std::vector<uint8_t> file;
+        Append(file, RIFFChunkHeader{ FOURCC_RIFF_TAG, 0, riff });
+        return file;
+    }
+
+    void EndFile(std::vector<uint8_t>& file)
+    {
+        const auto size = static_cast<uint32_t>(file.size() - sizeof(RIFFChunk));
+        memcpy(&file[offsetof(RIFFChunkHeader, size)], &size, sizeof(size));
+    }
+
+    // 16-bit stereo PCMWAVEFORMAT
+    std::vector<uint8_t> PCMFormat()
+    {
+        const uint16_t fmt[8] = { 1, 2, 0xAC44, 0, 0xB110, 0x2, 4, 16 };
+        return std::vector<uint8_t>(reinterpret_cast<const uint8_t*>(fmt), reinterpret_cast<const uint8_t*>(fmt) + sizeof(fmt));
+    }
+
+    std::vector<uint8_t> MIDISample(std::vector<MIDILoop> const& loops)
+    {
+        RIFFMIDISample sample = {};
+        sample.loopCount = static_cast<uint32_t>(loops.size());
+
+        std::vector<uint8_t> body(sizeof(sample) + loops.size() * sizeof(MIDILoop));
+        memcpy(body.data(), &sample, sizeof(sample));
+        if (!loops.empty())
+            memcpy(body.data() + sizeof(sample), loops.data(), loops.size() * sizeof(MIDILoop));
+        return body;
+    }
+
+    std::vector<uint8_t> DLSSample(std::vector<DLSLoop> const& loops)
+    {
+        RIFFDLSSample sample = {};
+        sample.size = sizeof(RIFFDLSSample);
+        sample.loopCount = static_cast<uint32_t>(loops.size());
+
+        std::vector<uint8_t> body(sizeof(sample) + loops.size() * sizeof(DLSLoop));
+        memcpy(body.data(), &sample, sizeof(sample));
+        if (!loops.empty())
+            memcpy(body.data() + sizeof(sample), loops.data(), loops.size() * sizeof(DLSLoop));
+        return body;
+    }
+
+    // Records every read so tests can check which bytes were touched.
+    class CountingSource : public MemorySource
+    {
+    public:
+        CountingSource(const std::vector<uint8_t>& file, uint64_t avoidStart = 0, uint64_t avoidEnd = 0) noexcept :
+            MemorySource(file.data(), file.size()),
+            bytesRead(0),
+            reads(0),
+            touchedAvoided(false),
+            mAvoidStart(avoidStart),
+            mAvoidEnd(avoidEnd)
+        {
+        }
+
+        bool Read(uint64_t offset, void* buffer, size_t size) noexcept override
+        {
+            bytesRead += size;
+            ++reads;
+            if (offset < mAvoidEnd && offset + size > mAvoidStart)
+                touchedAvoided = true;
+
+            return MemorySource::Read(offset, buffer, size);
+        }
+
+        uint64_t bytesRead;
+        size_t reads;
+        bool touchedAvoided;
+
+    private:
+        uint64_t mAvoidStart;
+        uint64_t mAvoidEnd;
+    };
+
+    // fmt, a metadata LIST, data, then a smpl chunk after the audio as many tools write it.
+    struct TestFile
+    {
+        std::vector<uint8_t> bytes;
+        size_t fmtOffset;
+        size_t dataOffset;
+        size_t dataSize;
+    };
+
+    TestFile MakeStandardFile(size_t dataSize, size_t listSize = 100)
+    {
+        TestFile file = {};
+        file.bytes = BeginFile(FOURCC_WAVE_FILE_TAG);
+        file.fmtOffset = AddChunk(file.bytes, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(file.bytes, FOURCC_LIST_TAG, nullptr, listSize, 0x4C);
+        file.dataOffset = AddChunk(file.bytes, FOURCC_DATA_TAG, nullptr, dataSize, 0xDA);
+        file.dataSize = dataSize;
+        AddChunk(file.bytes, FOURCC_MIDI_SAMPLE, MIDISample({ { 0, MIDILoop::LOOP_TYPE_FORWARD, 10, 109, 0, 0 } }));
+        EndFile(file.bytes);
+        return file;
+    }
+
+    void TestStandard()
+    {
+        const auto file = MakeStandardFile(1000);
+
+        MemorySource source(file.bytes.data(), file.bytes.size());
+        Chunks chunks;
+        VERIFY(FindChunks(source, chunks) == Status::Ok);
+        VERIFY(chunks.riff == FOURCC_WAVE_FILE_TAG);
+        VERIFY(chunks.fileSize == file.bytes.size());
+        VERIFY(chunks.chunks[CHUNK_FORMAT].offset == file.fmtOffset);
+        VERIFY(chunks.chunks[CHUNK_FORMAT].size == 16);
+        VERIFY(chunks.chunks[CHUNK_DATA].offset == file.dataOffset);
+        VERIFY(chunks.chunks[CHUNK_DATA].size == 1000);
+        VERIFY(chunks.chunks[CHUNK_MIDI_SAMPLE].offset != 0);
+        VERIFY(chunks.chunks[CHUNK_DLS_SAMPLE].offset == 0);
+        VERIFY(chunks.chunks[CHUNK_XWMA_DPDS].offset == 0);
+
+        // Nothing is loaded until asked for
+        for (auto const& it : chunks.chunks)
+            VERIFY(it.data == nullptr);
+
+        MapChunks(file.bytes.data(), file.bytes.size(), chunks);
+        VERIFY(chunks.chunks[CHUNK_DATA].data == file.bytes.data() + file.dataOffset);
+
+        uint32_t loopStart = 0;
+        uint32_t loopLength = 0;
+        VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+        VERIFY(loopStart == 10);
+        VERIFY(loopLength == 100);
+
+        const uint32_t* table = nullptr;
+        uint32_t count = 0;
+        VERIFY(FindTable(chunks, CHUNK_XWMA_DPDS, table, count) == Status::Ok);
+        VERIFY(table == nullptr && count == 0);
+    }
+
+    void TestHeaderOnly()
+    {
+        const auto file = MakeStandardFile(100000);
+
+        // Without the audio, nothing in the 'data' chunk body is read
+        {
+            CountingSource source(file.bytes, file.dataOffset, file.dataOffset + file.dataSize);
+            Chunks chunks;
+            VERIFY(FindChunks(source, chunks) == Status::Ok);
+
+            std::unique_ptr<uint8_t[]> buffer;
+            VERIFY(LoadChunks(source, false, buffer, chunks) == Status::Ok);
+            VERIFY(!source.touchedAvoided);
+            VERIFY(source.bytesRead < 256);
+
+            VERIFY(chunks.chunks[CHUNK_DATA].data == nullptr);
+            VERIFY(chunks.chunks[CHUNK_DATA].offset == file.dataOffset);
+            VERIFY(chunks.chunks[CHUNK_FORMAT].data != nullptr);
+            VERIFY(memcmp(chunks.chunks[CHUNK_FORMAT].data, PCMFormat().data(), 16) == 0);
+
+            uint32_t loopStart = 0;
+            uint32_t loopLength = 0;
+            VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+            VERIFY(loopStart == 10 && loopLength == 100);
+        }
+
+        // With the audio, only the used chunks are read; the LIST chunk is skipped
+        {
+            CountingSource source(file.bytes, file.fmtOffset + 16 + sizeof(RIFFChunk), file.dataOffset - sizeof(RIFFChunk));
+            Chunks chunks;
+            VERIFY(FindChunks(source, chunks) == Status::Ok);
+
+            std::unique_ptr<uint8_t[]> buffer;
+            VERIFY(LoadChunks(source, true, buffer, chunks) == Status::Ok);
+            VERIFY(!source.touchedAvoided);
+
+            auto const& data = chunks.chunks[CHUNK_DATA];
+            VERIFY(data.data != nullptr);
+            VERIFY(data.size == file.dataSize);
+            VERIFY(memcmp(data.data, file.bytes.data() + file.dataOffset, file.dataSize) == 0);
+
+            // Tables are read as uint32_t, so every loaded chunk is 4-byte aligned
+            for (auto const& it : chunks.chunks)
+            {
+                if (it.data)
+                    VERIFY(((it.data - buffer.get()) % 4) == 0);
+            }
+        }
+    }
+
+    void TestLoops()
+    {
+        // 'wsmp' takes precedence over 'smpl', and release loops count as forward
+        auto file = BeginFile(FOURCC_WAVE_FILE_TAG);
+        AddChunk(file, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(file, FOURCC_MIDI_SAMPLE, MIDISample({ { 0, MIDILoop::LOOP_TYPE_FORWARD, 1, 2, 0, 0 } }));
+        AddChunk(file, FOURCC_DLS_SAMPLE, DLSSample({
+            { sizeof(DLSLoop), 7, 100, 200 },
+            { sizeof(DLSLoop), DLSLoop::LOOP_TYPE_RELEASE, 300, 400 } }));
+        AddChunk(file, FOURCC_DATA_TAG, nullptr, 64);
+        EndFile(file);
+
+        MemorySource source(file.data(), file.size());
+        Chunks chunks;
+        VERIFY(FindChunks(source, chunks) == Status::Ok);
+        MapChunks(file.data(), file.size(), chunks);
+
+        uint32_t loopStart = 0;
+        uint32_t loopLength = 0;
+        VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+        VERIFY(loopStart == 300 && loopLength == 400);
+
+        // Only non-forward 'smpl' loops: no loop
+        file = BeginFile(FOURCC_WAVE_FILE_TAG);
+        AddChunk(file, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(file, FOURCC_DATA_TAG, nullptr, 64);
+        AddChunk(file, FOURCC_MIDI_SAMPLE, MIDISample({ { 0, MIDILoop::LOOP_TYPE_BACKWARD, 1, 2, 0, 0 } }));
+        EndFile(file);
+
+        MemorySource source2(file.data(), file.size());
+        VERIFY(FindChunks(source2, chunks) == Status::Ok);
+        MapChunks(file.data(), file.size(), chunks);
+        VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+        VERIFY(loopStart == 0 && loopLength == 0);
+
+        // A loop count larger than the chunk is ignored
+        auto sample = MIDISample({ { 0, MIDILoop::LOOP_TYPE_FORWARD, 1, 2, 0, 0 } });
+        const uint32_t loopCount = 1000;
+        memcpy(sample.data() + offsetof(RIFFMIDISample, loopCount), &loopCount, sizeof(loopCount));
+
+        file = BeginFile(FOURCC_WAVE_FILE_TAG);
+        AddChunk(file, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(file, FOURCC_DATA_TAG, nullptr, 64);
+        AddChunk(file, FOURCC_MIDI_SAMPLE, sample);
+        EndFile(file);
+
+        MemorySource source3(file.data(), file.size());
+        VERIFY(FindChunks(source3, chunks) == Status::Ok);
+        MapChunks(file.data(), file.size(), chunks);
+        VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+        VERIFY(loopStart == 0 && loopLength == 0);
+    }
+
+    void TestTables()
+    {
+        // xWMA: the 'dpds' table is found, and loops are never reported
+        const std::vector<uint32_t> dpds = { 4096, 8192, 12288, 16384, 20480 };
+
+        auto file = BeginFile(FOURCC_XWMA_FILE_TAG);
+        AddChunk(file, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(file, FOURCC_XWMA_DPDS, dpds);
+        AddChunk(file, FOURCC_DATA_TAG, nullptr, 128);
+        AddChunk(file, FOURCC_MIDI_SAMPLE, MIDISample({ { 0, MIDILoop::LOOP_TYPE_FORWARD, 1, 2, 0, 0 } }));
+        EndFile(file);
+
+        CountingSource source(file);
+        Chunks chunks;
+        VERIFY(FindChunks(source, chunks) == Status::Ok);
+        VERIFY(chunks.riff == FOURCC_XWMA_FILE_TAG);
+
+        std::unique_ptr<uint8_t[]> buffer;
+        VERIFY(LoadChunks(source, false, buffer, chunks) == Status::Ok);
+
+        const uint32_t* table = nullptr;
+        uint32_t count = 0;
+        VERIFY(FindTable(chunks, CHUNK_XWMA_DPDS, table, count) == Status::Ok);
+        VERIFY(count == dpds.size());
+        VERIFY(table && memcmp(table, dpds.data(), dpds.size() * sizeof(uint32_t)) == 0);
+
+        uint32_t loopStart = 0;
+        uint32_t loopLength = 0;
+        VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+        VERIFY(loopStart == 0 && loopLength == 0);
+
+        // A table that isn't a whole number of entries is rejected
+        file = BeginFile(FOURCC_WAVE_FILE_TAG);
+        AddChunk(file, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(file, FOURCC_XMA_SEEK, nullptr, 6);
+        AddChunk(file, FOURCC_DATA_TAG, nullptr, 128);
+        EndFile(file);
+
+        MemorySource source2(file.data(), file.size());
+        VERIFY(FindChunks(source2, chunks) == Status::Ok);
+        MapChunks(file.data(), file.size(), chunks);
+        VERIFY(FindTable(chunks, CHUNK_XMA_SEEK, table, count) == Status::InvalidData);
+        VERIFY(table == nullptr && count == 0);
+    }
+
+    void TestInvalid()
+    {
+        auto const good = MakeStandardFile(256);
+        Chunks chunks;
+
+        // Too small to be a .wav file
+        {
+            MemorySource source(good.bytes.data(), 20);
+            VERIFY(FindChunks(source, chunks) == Status::InvalidData);
+        }
+
+        // Not RIFF 'WAVE'
+        {
+            auto file = good.bytes;
+            const uint32_t avi = MakeFourCC('A', 'V', 'I', ' ');
+            memcpy(&file[offsetof(RIFFChunkHeader, riff)], &avi, sizeof(avi));
+
+            MemorySource source(file.data(), file.size());
+            VERIFY(FindChunks(source, chunks) == Status::InvalidData);
+        }
+
+        // No RIFF chunk at all
+        {
+            auto file = good.bytes;
+            memcpy(&file[0], &FOURCC_JUNK_TAG, sizeof(uint32_t));
+
+            MemorySource source(file.data(), file.size());
+            VERIFY(FindChunks(source, chunks) == Status::InvalidData);
+        }
+
+        // Chunks before the RIFF chunk are skipped
+        {
+            std::vector<uint8_t> file;
+            AddChunk(file, FOURCC_JUNK_TAG, nullptr, 32);
+            const size_t riffOffset = file.size();
+            file.insert(file.end(), good.bytes.begin(), good.bytes.end());
+
+            MemorySource source(file.data(), file.size());
+            VERIFY(FindChunks(source, chunks) == Status::Ok);
+            VERIFY(chunks.chunks[CHUNK_DATA].offset == riffOffset + good.dataOffset);
+        }
+
+        // Audio cut short: the 'data' chunk is found but incomplete, so it is never loaded
+        {
+            std::vector<uint8_t> file(good.bytes.begin(), good.bytes.begin() + static_cast<ptrdiff_t>(good.dataOffset + 100));
+
+            CountingSource source(file);
+            VERIFY(FindChunks(source, chunks) == Status::Ok);
+            VERIFY(chunks.chunks[CHUNK_DATA].offset == good.dataOffset);
+            VERIFY(!chunks.IsComplete(CHUNK_DATA));
+            VERIFY(chunks.chunks[CHUNK_MIDI_SAMPLE].offset == 0);
+
+            std::unique_ptr<uint8_t[]> buffer;
+            VERIFY(LoadChunks(source, true, buffer, chunks) == Status::Ok);
+            VERIFY(chunks.chunks[CHUNK_DATA].data == nullptr);
+            VERIFY(chunks.chunks[CHUNK_FORMAT].data != nullptr);
+        }
+
+        // Loop chunk cut short
+        {
+            std::vector<uint8_t> file(good.bytes.begin(), good.bytes.end() - 8);
+
+            MemorySource source(file.data(), file.size());
+            VERIFY(FindChunks(source, chunks) == Status::Ok);
+            MapChunks(file.data(), file.size(), chunks);
+
+            uint32_t loopStart = 0;
+            uint32_t loopLength = 0;
+            VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::EndOfFile);
+        }
+    }
+
+    // Randomly truncated and corrupted files must parse without reading out of bounds.
+    void TestDamaged()
+    {
+        std::mt19937 rng(5);
+
+        auto good = BeginFile(FOURCC_WAVE_FILE_TAG);
+        AddChunk(good, FOURCC_FORMAT_TAG, PCMFormat());
+        AddChunk(good, FOURCC_DLS_SAMPLE, DLSSample({ { sizeof(DLSLoop), DLSLoop::LOOP_TYPE_FORWARD, 5, 6 } }));
+        AddChunk(good, FOURCC_XMA_SEEK, std::vector<uint32_t>{ 1, 2, 3 });
+        AddChunk(good, FOURCC_DATA_TAG, nullptr, 512, 0xDA);
+        AddChunk(good, FOURCC_MIDI_SAMPLE, MIDISample({ { 0, MIDILoop::LOOP_TYPE_FORWARD, 10, 109, 0, 0 } }));
+        EndFile(good);
+
+        size_t parsed = 0;
+        for (int trial = 0; trial < 2000; ++trial)
+        {
+            auto file = good;
+
+            const int corruptions = int(rng() % 4);
+            for (int j = 0; j < corruptions; ++j)
+            {
+                file[rng() % file.size()] = static_cast<uint8_t>(rng());
+            }
+
+            if (rng() % 2)
+            {
+                file.resize(rng() % file.size());
+            }
+
+            CountingSource source(file);
+            Chunks chunks;
+            if (FindChunks(source, chunks) != Status::Ok)
+                continue;
+
+            std::unique_ptr<uint8_t[]> buffer;
+            if (LoadChunks(source, (trial % 2) != 0, buffer, chunks) != Status::Ok)
+                continue;
+
+            ++parsed;
+
+            for (uint32_t j = 0; j < CHUNK_COUNT; ++j)
+            {
+                auto const& chunk = chunks.chunks[j];
+                if (chunk.data)
+                {
+                    VERIFY(chunks.IsComplete(static_cast<CHUNK_INDEX>(j)));
+                    VERIFY(chunk.offset + chunk.size <= file.size());
+                }
+            }
+
+            uint32_t loopStart = 0;
+            uint32_t loopLength = 0;
+            std::ignore = FindLoopInfo(chunks, loopStart, loopLength);
+
+            const uint32_t* table = nullptr;
+            uint32_t count = 0;
+            if (FindTable(chunks, CHUNK_XMA_SEEK, table, count) == Status::Ok && count)
+            {
+                VERIFY(uint64_t(count) * sizeof(uint32_t) == chunks.chunks[CHUNK_XMA_SEEK].size);
+            }
+        }
+
+        VERIFY(parsed > 0);
+    }
+
+    //----------------------------------------------------------------------------------
+    // Parses each file of a corpus of long ambience-style files: a large metadata LIST
+    // chunk, the audio, then a 'smpl' chunk. "whole file" is the old loader, which read
+    // the complete image and parsed it in place.
+    template<typename TParse>
+    void Benchmark(const char* name, const std::vector<TestFile>& corpus, TParse&& parse)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        size_t files = 0;
+        uint64_t bytesRead = 0;
+        double seconds = 0;
+        do
+        {
+            for (auto const& file : corpus)
+            {
+                bytesRead += parse(file);
+                ++files;
+            }
+            seconds = std::chrono::duration<double>(clock::now() - start).count();
+        } while (seconds < 0.25);
+
+        printf("%-14s %10.1f us/file %12.1f KB read/file\n", name,
+            seconds * 1e6 / double(files), double(bytesRead) / 1024.0 / double(files));
+    }
+
+    void BenchmarkParse()
+    {
+        std::vector<TestFile> corpus;
+        for (size_t megabytes : { 1u, 4u, 16u, 48u })
+        {
+            corpus.emplace_back(MakeStandardFile(megabytes * 1024 * 1024, 256 * 1024));
+        }
+
+        Benchmark("whole file", corpus, [](const TestFile& file) -> uint64_t
+            {
+                std::unique_ptr<uint8_t[]> image(new uint8_t[file.bytes.size()]);
+                memcpy(image.get(), file.bytes.data(), file.bytes.size());
+
+                MemorySource source(image.get(), file.bytes.size());
+                Chunks chunks;
+                VERIFY(FindChunks(source, chunks) == Status::Ok);
+                MapChunks(image.get(), file.bytes.size(), chunks);
+
+                uint32_t loopStart, loopLength;
+                VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+                return file.bytes.size();
+            });
+
+        Benchmark("used chunks", corpus, [](const TestFile& file) -> uint64_t
+            {
+                CountingSource source(file.bytes);
+                Chunks chunks;
+                VERIFY(FindChunks(source, chunks) == Status::Ok);
+
+                std::unique_ptr<uint8_t[]> buffer;
+                VERIFY(LoadChunks(source, true, buffer, chunks) == Status::Ok);
+
+                uint32_t loopStart, loopLength;
+                VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+                return source.bytesRead;
+            });
+
+        Benchmark("header only", corpus, [](const TestFile& file) -> uint64_t
+            {
+                CountingSource source(file.bytes);
+                Chunks chunks;
+                VERIFY(FindChunks(source, chunks) == Status::Ok);
+
+                std::unique_ptr<uint8_t[]> buffer;
+                VERIFY(LoadChunks(source, false, buffer, chunks) == Status::Ok);
+
+                uint32_t loopStart, loopLength;
+                VERIFY(FindLoopInfo(chunks, loopStart, loopLength) == Status::Ok);
+                VERIFY(source.bytesRead < 1024);
+                return source.bytesRead;
+            });
+    }
+}
+
+int main()
+{
+    TestStandard();
+    TestHeaderOnly();
+    TestLoops();
+    TestTables();
+    TestInvalid();
+    TestDamaged();
+
+    BenchmarkParse();
+
+    return TestHelpers::Finish("WAVChunkParserTest");
+}
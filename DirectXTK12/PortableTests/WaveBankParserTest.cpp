@@ -0,0 +1,486 @@
+//--------------------------------------------------------------------------------------
+// File: WaveBankParserTest.cpp
+//
+// Builds small wave banks in memory, in both byte orders and both entry layouts, and
+// checks what the parser reads back. Damaged and truncated banks must be rejected or
+// parse to entries that stay within their segments.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "WaveBankParser.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX::WaveBankParser;
+
+namespace
+{
+    struct TestEntry
+    {
+        MINIWAVEFORMAT format;
+        uint32_t duration;
+        uint32_t length;
+        uint32_t loopStart;
+        uint32_t loopLength;
+        std::string name;
+        std::vector<uint32_t> seek;     // Empty for no seek table
+    };
+
+    struct TestBank
+    {
+        uint32_t flags;
+        uint32_t alignment;
+        bool bigEndian;
+        bool names;
+        std::vector<TestEntry> entries;
+    };
+
+    MINIWAVEFORMAT MakeFormat(uint32_t tag, uint32_t channels, uint32_t rate, uint32_t blockAlign, uint32_t bits)
+    {
+        MINIWAVEFORMAT format = {};
+        format.wFormatTag = tag;
+        format.nChannels = channels;
+        format.nSamplesPerSec = rate;
+        format.wBlockAlign = blockAlign;
+        format.wBitsPerSample = bits;
+        return format;
+    }
+
+    MINIWAVEFORMAT PCM16(uint32_t channels, uint32_t rate)
+    {
+        return MakeFormat(MINIWAVEFORMAT::TAG_PCM, channels, rate, channels * 2, MINIWAVEFORMAT::BITDEPTH_16);
+    }
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    template<typename T>
+    void Put(std::vector<uint8_t>& file, size_t offset, T value)
+    {
+        if (file.size() < offset + sizeof(T))
+            file.resize(offset + sizeof(T));
+        memcpy(&file[offset], &value, sizeof(T));
+    }
+
+    // Lays the bank out as the XACT tools do: header, bank data, entries, seek tables, names, then wave data.
+    std::vector<uint8_t> Build(const TestBank& desc)
+    {
+        const bool compact = (desc.flags & BANKDATA::FLAGS_COMPACT) != 0;
+        const auto count = static_cast<uint32_t>(desc.entries.size());
+
+        // Wave data placement
+        std::vector<uint32_t> offsets;
+        size_t waveLength = 0;
+        for (auto const& entry : desc.entries)
+        {
+            waveLength = AlignUp(waveLength, desc.alignment);
+            offsets.push_back(static_cast<uint32_t>(waveLength));
+            waveLength += entry.length;
+        }
+
+        // Seek tables: one offset per entry, then each table as a count and its values
+        std::vector<uint32_t> seek;
+        bool anySeek = false;
+        for (auto const& entry : desc.entries)
+            anySeek = anySeek || !entry.seek.empty();
+        if (anySeek)
+        {
+            std::vector<uint32_t> tables;
+            for (auto const& entry : desc.entries)
+            {
+                if (entry.seek.empty())
+                {
+                    seek.push_back(uint32_t(-1));
+                    continue;
+                }
+                seek.push_back(static_cast<uint32_t>(tables.size() * sizeof(uint32_t)));
+                tables.push_back(static_cast<uint32_t>(entry.seek.size()));
+                tables.insert(tables.end(), entry.seek.begin(), entry.seek.end());
+            }
+            seek.insert(seek.end(), tables.begin(), tables.end());
+        }
+
+        const uint32_t entrySize = compact ? sizeof(ENTRYCOMPACT) : sizeof(ENTRY);
+        const uint32_t nameSize = 64;
+
+        HEADER header = {};
+        header.dwSignature = HEADER::SIGNATURE;
+        header.dwVersion = 46;
+        header.dwHeaderVersion = HEADER::VERSION;
+
+        uint32_t offset = sizeof(HEADER);
+        header.Segments[HEADER::SEGIDX_BANKDATA] = { offset, sizeof(BANKDATA) };
+        offset += sizeof(BANKDATA);
+        header.Segments[HEADER::SEGIDX_ENTRYMETADATA] = { offset, entrySize * count };
+        offset += entrySize * count;
+        header.Segments[HEADER::SEGIDX_SEEKTABLES] = { offset, static_cast<uint32_t>(seek.size() * sizeof(uint32_t)) };
+        offset += static_cast<uint32_t>(seek.size() * sizeof(uint32_t));
+        header.Segments[HEADER::SEGIDX_ENTRYNAMES] = { offset, desc.names ? nameSize * count : 0u };
+        offset += desc.names ? nameSize * count : 0u;
+        offset = static_cast<uint32_t>(AlignUp(offset, desc.alignment));
+        header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA] = { offset, static_cast<uint32_t>(waveLength) };
+
+        BANKDATA data = {};
+        data.dwFlags = desc.flags | (desc.names ? BANKDATA::FLAGS_ENTRYNAMES : 0u) | (anySeek ? BANKDATA::FLAGS_SEEKTABLES : 0u);
+        data.dwEntryCount = count;
+        strcpy(data.szBankName, "TestBank");
+        data.dwEntryMetaDataElementSize = entrySize;
+        data.dwEntryNameElementSize = desc.names ? nameSize : 0u;
+        data.dwAlignment = desc.alignment;
+        if (compact && count)
+            data.CompactFormat = desc.entries[0].format;
+
+        std::vector<uint8_t> file(offset + waveLength, 0);
+
+        for (uint32_t j = 0; j < count; ++j)
+        {
+            auto const& entry = desc.entries[j];
+            const size_t at = header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset + size_t(j) * entrySize;
+            if (compact)
+            {
+                const size_t next = (j + 1 < count) ? offsets[j + 1] : waveLength;
+                ENTRYCOMPACT e = {};
+                e.dwOffset = offsets[j] / desc.alignment;
+                e.dwLengthDeviation = static_cast<uint32_t>(next - offsets[j] - entry.length);
+                if (desc.bigEndian)
+                    e.BigEndian();
+                Put(file, at, e);
+            }
+            else
+            {
+                ENTRY e = {};
+                e.Duration = entry.duration;
+                e.Format = entry.format;
+                e.PlayRegion = { offsets[j], entry.length };
+                e.LoopRegion = { entry.loopStart, entry.loopLength };
+                if (desc.bigEndian)
+                    e.BigEndian();
+                Put(file, at, e);
+            }
+
+            if (desc.names)
+            {
+                const size_t nameAt = header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwOffset + size_t(j) * nameSize;
+                memcpy(&file[nameAt], entry.name.c_str(), std::min<size_t>(entry.name.size(), nameSize));
+            }
+
+            // Recognizable wave bytes: the entry index
+            memset(&file[header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset + offsets[j]], int(j + 1), entry.length);
+        }
+
+        for (size_t j = 0; j < seek.size(); ++j)
+        {
+            Put(file, header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset + j * sizeof(uint32_t),
+                desc.bigEndian ? ByteSwap(seek[j]) : seek[j]);
+        }
+
+        if (desc.bigEndian)
+        {
+            header.BigEndian();
+            header.dwSignature = HEADER::BE_SIGNATURE;
+            data.BigEndian();
+        }
+
+        Put(file, 0, header);
+        Put(file, sizeof(HEADER), data);
+        return file;
+    }
+
+    Status ParseBytes(const std::vector<uint8_t>& file, Bank& bank)
+    {
+        MemorySource source(file.data(), file.size());
+        return Parse(source, bank);
+    }
+
+    TestBank MakeStandardBank(bool bigEndian)
+    {
+        TestBank desc = { BANKDATA::TYPE_BUFFER, 4, bigEndian, true, {} };
+        desc.entries.push_back({ PCM16(2, 44100), 1000, 4000, 100, 500, "Explosion", {} });
+        desc.entries.push_back({ PCM16(1, 22050), 300, 601, 0, 0, "Footstep", {} });
+        desc.entries.push_back({ MakeFormat(MINIWAVEFORMAT::TAG_WMA, 2, 48000, 0x20 | 3, 0), 4800, 8000, 0, 0, "Music",
+            { 3, 4096, 8192, 19200 } });
+        return desc;
+    }
+
+    void CheckStandardBank(const Bank& bank, const std::vector<uint8_t>& file)
+    {
+        VERIFY(!bank.IsCompact() && !bank.IsStreaming());
+        VERIFY(bank.data.dwEntryCount == 3);
+        VERIFY(strcmp(bank.data.szBankName, "TestBank") == 0);
+
+        VERIFY(bank.GetName(0) && strcmp(bank.GetName(0), "Explosion") == 0);
+        VERIFY(bank.GetName(2) && strcmp(bank.GetName(2), "Music") == 0);
+        VERIFY(bank.GetName(3) == nullptr);
+
+        auto& pcm = bank.GetFormat(0);
+        VERIFY(pcm.wFormatTag == MINIWAVEFORMAT::TAG_PCM);
+        VERIFY(pcm.nChannels == 2 && pcm.nSamplesPerSec == 44100);
+        VERIFY(pcm.BitsPerSample() == 16 && pcm.BlockAlign() == 4 && pcm.AvgBytesPerSec() == 176400);
+
+        auto& wma = bank.GetFormat(2);
+        VERIFY(wma.wFormatTag == MINIWAVEFORMAT::TAG_WMA);
+        VERIFY(wma.BlockAlign() == 2230 && wma.AvgBytesPerSec() == 24000);
+
+        const EntryInfo e0 = bank.GetEntry(0);
+        VERIFY(e0.duration == 1000 && e0.loopStart == 100 && e0.loopLength == 500);
+        VERIFY(e0.offsetBytes == 0 && e0.lengthBytes == 4000);
+
+        // Entries start on the bank alignment.
+        const EntryInfo e1 = bank.GetEntry(1);
+        VERIFY(e1.offsetBytes == 4000 && e1.lengthBytes == 601);
+        const EntryInfo e2 = bank.GetEntry(2);
+        VERIFY(e2.offsetBytes == 4604 && e2.lengthBytes == 8000);
+
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const EntryInfo info = bank.GetEntry(j);
+            VERIFY(bank.IsInWaveData(info));
+            VERIFY(file[bank.WaveData().dwOffset + info.offsetBytes] == j + 1);
+            VERIFY(file[bank.WaveData().dwOffset + info.offsetBytes + info.lengthBytes - 1] == j + 1);
+        }
+
+        VERIFY(bank.FindSeekTable(0) == nullptr);
+        const uint32_t* table = bank.FindSeekTable(2);
+        VERIFY(table && table[0] == 4 && table[1] == 3 && table[4] == 19200);
+        VERIFY(bank.FindSeekTable(3) == nullptr);
+    }
+
+    void TestStandard()
+    {
+        for (bool bigEndian : { false, true })
+        {
+            const auto file = Build(MakeStandardBank(bigEndian));
+
+            Bank bank;
+            VERIFY(ParseBytes(file, bank) == Status::Ok);
+            VERIFY(bank.bigEndian == bigEndian);
+            CheckStandardBank(bank, file);
+        }
+
+        // Names are optional.
+        auto desc = MakeStandardBank(false);
+        desc.names = false;
+        Bank bank;
+        VERIFY(ParseBytes(Build(desc), bank) == Status::Ok);
+        VERIFY(!bank.names && bank.GetName(0) == nullptr);
+
+        // A name filling its whole element is cut at the element, not run on into the next.
+        desc = MakeStandardBank(false);
+        desc.entries[0].name = std::string(64, 'x');
+        VERIFY(ParseBytes(Build(desc), bank) == Status::Ok);
+        VERIFY(strlen(bank.GetName(0)) == 63 && strcmp(bank.GetName(1), "Footstep") == 0);
+    }
+
+    void TestCompact()
+    {
+        // ADPCM mono: 256-byte blocks of 500 samples
+        const MINIWAVEFORMAT adpcm = MakeFormat(MINIWAVEFORMAT::TAG_ADPCM, 1, 22050, 256 - 22, 0);
+
+        for (bool bigEndian : { false, true })
+        {
+            TestBank desc = { BANKDATA::FLAGS_COMPACT, 256, bigEndian, false, {} };
+            desc.entries.push_back({ adpcm, 0, 512, 0, 0, {}, {} });
+            desc.entries.push_back({ adpcm, 0, 300, 0, 0, {}, {} });     // A partial block
+            desc.entries.push_back({ adpcm, 0, 256, 0, 0, {}, {} });
+
+            const auto file = Build(desc);
+
+            Bank bank;
+            VERIFY(ParseBytes(file, bank) == Status::Ok);
+            VERIFY(bank.IsCompact());
+            VERIFY(bank.GetFormat(1).wFormatTag == MINIWAVEFORMAT::TAG_ADPCM);
+            VERIFY(bank.GetFormat(1).BlockAlign() == 256 && bank.GetFormat(1).AdpcmSamplesPerBlock() == 500);
+
+            const EntryInfo e0 = bank.GetEntry(0);
+            VERIFY(e0.offsetBytes == 0 && e0.lengthBytes == 512 && e0.duration == 1000);
+
+            const EntryInfo e1 = bank.GetEntry(1);
+            VERIFY(e1.offsetBytes == 512 && e1.lengthBytes == 300);
+            VERIFY(e1.duration == 500 + (44 * 2 - 12));
+
+            // The last entry's length comes from the end of the segment.
+            const EntryInfo e2 = bank.GetEntry(2);
+            VERIFY(e2.offsetBytes == 1024 && e2.lengthBytes == 256 && e2.duration == 500);
+
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                const EntryInfo info = bank.GetEntry(j);
+                VERIFY(bank.IsInWaveData(info));
+                VERIFY(file[bank.WaveData().dwOffset + info.offsetBytes] == j + 1);
+            }
+        }
+
+        // Compact PCM durations follow from the length.
+        TestBank desc = { BANKDATA::FLAGS_COMPACT, 4, false, false, {} };
+        desc.entries.push_back({ PCM16(2, 48000), 0, 4800, 0, 0, {}, {} });
+        Bank bank;
+        VERIFY(ParseBytes(Build(desc), bank) == Status::Ok);
+        VERIFY(bank.GetEntry(0).duration == 1200);
+    }
+
+    void TestStreaming()
+    {
+        TestBank desc = { BANKDATA::TYPE_STREAMING, 2048, false, true, {} };
+        desc.entries.push_back({ PCM16(2, 48000), 2000, 8000, 0, 0, "A", {} });
+        desc.entries.push_back({ PCM16(2, 48000), 1000, 4000, 0, 0, "B", {} });
+
+        Bank bank;
+        VERIFY(ParseBytes(Build(desc), bank) == Status::Ok);
+        VERIFY(bank.IsStreaming());
+        VERIFY(bank.WaveData().dwOffset % 2048 == 0);
+        VERIFY(bank.GetEntry(1).offsetBytes == 8192);
+
+        // Streaming banks must be sector aligned.
+        auto file = Build(desc);
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwAlignment), uint32_t(1024));
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwAlignment), uint32_t(3000));
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+    }
+
+    void TestInvalid()
+    {
+        const auto good = Build(MakeStandardBank(false));
+        Bank bank;
+
+        auto file = good;
+        file[0] = 'X';
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+
+        file = good;
+        Put(file, offsetof(HEADER, dwHeaderVersion), uint32_t(43));
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+
+        file = good;
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwEntryCount), uint32_t(0));
+        VERIFY(ParseBytes(file, bank) == Status::NoData);
+
+        // The metadata segment must hold exactly the entries.
+        file = good;
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwEntryCount), uint32_t(4));
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+
+        file = good;
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwEntryMetaDataElementSize), uint32_t(20));
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+
+        // Element size times count must not wrap around.
+        file = good;
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwEntryCount), uint32_t(0x40000000) + 3);
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+
+        file = good;
+        Put(file, sizeof(HEADER) + offsetof(BANKDATA, dwAlignment), uint32_t(2));
+        VERIFY(ParseBytes(file, bank) == Status::InvalidData);
+
+        const size_t waveSegment = offsetof(HEADER, Segments) + HEADER::SEGIDX_ENTRYWAVEDATA * sizeof(REGION);
+        file = good;
+        Put(file, waveSegment + offsetof(REGION, dwLength), uint32_t(0));
+        VERIFY(ParseBytes(file, bank) == Status::NoData);
+
+        // Every truncation short of the wave data fails to read.
+        const size_t waveOffset = Build(MakeStandardBank(false)).size() - (4604 + 8000);
+        for (size_t size = 0; size < waveOffset; size += 7)
+        {
+            const std::vector<uint8_t> truncated(good.begin(), good.begin() + std::ptrdiff_t(size));
+            const Status status = ParseBytes(truncated, bank);
+            VERIFY(status == Status::ReadFailed);
+        }
+
+        // An entry claiming more than the segment holds is caught before its data is used.
+        file = good;
+        const size_t entry1 = sizeof(HEADER) + sizeof(BANKDATA) + sizeof(ENTRY) + offsetof(ENTRY, PlayRegion);
+        Put(file, entry1 + offsetof(REGION, dwLength), uint32_t(0x7FFFFFFF));
+        VERIFY(ParseBytes(file, bank) == Status::Ok);
+        VERIFY(!bank.IsInWaveData(bank.GetEntry(1)));
+
+        // Seek table offsets past the segment are ignored.
+        file = good;
+        const size_t seekAt = sizeof(HEADER) + sizeof(BANKDATA) + 3 * sizeof(ENTRY);
+        Put(file, seekAt + 2 * sizeof(uint32_t), uint32_t(4096));
+        VERIFY(ParseBytes(file, bank) == Status::Ok);
+        VERIFY(bank.FindSeekTable(2) == nullptr);
+
+        // ...as are tables whose count runs past it.
+        file = good;
+        Put(file, seekAt + 3 * sizeof(uint32_t), uint32_t(1000));
+        VERIFY(ParseBytes(file, bank) == Status::Ok);
+        VERIFY(bank.FindSeekTable(2) == nullptr);
+    }
+
+    // Random damage to the metadata must never lead outside the parsed buffers.
+    void TestDamaged()
+    {
+        std::mt19937 rng(11);
+
+        const std::vector<std::vector<uint8_t>> banks = {
+            Build(MakeStandardBank(false)),
+            Build(MakeStandardBank(true)),
+        };
+
+        size_t parsed = 0;
+        for (int trial = 0; trial < 2000; ++trial)
+        {
+            auto file = banks[size_t(trial) % banks.size()];
+            const size_t metadataEnd = file.size() - (4604 + 8000);
+
+            const int flips = 1 + int(rng() % 4);
+            for (int j = 0; j < flips; ++j)
+            {
+                file[rng() % metadataEnd] = static_cast<uint8_t>(rng());
+            }
+
+            Bank bank;
+            if (ParseBytes(file, bank) != Status::Ok)
+                continue;
+
+            ++parsed;
+            for (uint32_t j = 0; j < bank.data.dwEntryCount; ++j)
+            {
+                const char* name = bank.GetName(j);
+                if (name)
+                    VERIFY(strlen(name) < Bank::c_nameStride);
+
+                const uint32_t* table = bank.FindSeekTable(j);
+                if (table)
+                {
+                    const auto* begin = reinterpret_cast<const uint32_t*>(bank.seekData.get());
+                    const size_t words = bank.header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength / sizeof(uint32_t);
+                    VERIFY(table >= begin && size_t(table - begin) + *table < words);
+                }
+
+                const EntryInfo info = bank.GetEntry(j);
+                if (bank.IsInWaveData(info))
+                    VERIFY(uint64_t(info.offsetBytes) + info.lengthBytes <= bank.WaveData().dwLength);
+            }
+        }
+
+        printf("Damaged banks: %zu of 2000 still parsed\n", parsed);
+        VERIFY(parsed > 0);
+    }
+}
+
+int main()
+{
+    TestStandard();
+    TestCompact();
+    TestStreaming();
+    TestInvalid();
+    TestDamaged();
+
+    return TestHelpers::Finish("WaveBankParserTest");
+}
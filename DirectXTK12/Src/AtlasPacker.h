@@ -0,0 +1,605 @@
+//--------------------------------------------------------------------------------------
+// File: AtlasPacker.h
+//
+// CPU-only helpers for merging SpriteFont glyph sheets and sprite images into a
+// single texture atlas. This header has no Direct3D dependencies.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "SALFallback.h"
+
+
+namespace DirectX
+{
+    namespace AtlasPacker
+    {
+        // Matches the layout of RECT.
+        struct Rect
+        {
+            int32_t left;
+            int32_t top;
+            int32_t right;
+            int32_t bottom;
+
+            int32_t Width() const noexcept { return right - left; }
+            int32_t Height() const noexcept { return bottom - top; }
+        };
+
+        // Matches the layout of SpriteFont::Glyph and the .spritefont glyph record.
+        struct Glyph
+        {
+            uint32_t Character;
+            Rect Subrect;
+            float XOffset;
+            float YOffset;
+            float XAdvance;
+        };
+
+        static_assert(sizeof(Glyph) == 32, "Glyph size mismatch with .spritefont format");
+
+        // wint_t is only 16 bits on Windows; no whitespace lies outside the BMP.
+        inline bool IsWhitespace(uint32_t character) noexcept
+        {
+            return (character <= 0xFFFF) && iswspace(static_cast<wint_t>(character));
+        }
+
+        // DXGI_FORMAT values of the uncompressed formats the packer can copy.
+        constexpr uint32_t c_formatR8G8B8A8_UNORM = 28;
+        constexpr uint32_t c_formatR8G8B8A8_UNORM_SRGB = 29;
+        constexpr uint32_t c_formatR8_UNORM = 61;
+        constexpr uint32_t c_formatA8_UNORM = 65;
+        constexpr uint32_t c_formatB8G8R8A8_UNORM = 87;
+        constexpr uint32_t c_formatB8G8R8A8_UNORM_SRGB = 91;
+        constexpr uint32_t c_formatB4G4R4A4_UNORM = 115;
+
+        // Returns 0 for formats which cannot be packed (such as the BC2 output of MakeSpriteFont /TextureFormat:CompressedMono).
+        inline uint32_t BytesPerPixel(uint32_t format) noexcept
+        {
+            switch (format)
+            {
+            case c_formatR8G8B8A8_UNORM:
+            case c_formatR8G8B8A8_UNORM_SRGB:
+            case c_formatB8G8R8A8_UNORM:
+            case c_formatB8G8R8A8_UNORM_SRGB:
+                return 4;
+
+            case c_formatB4G4R4A4_UNORM:
+                return 2;
+
+            case c_formatR8_UNORM:
+            case c_formatA8_UNORM:
+                return 1;
+
+            default:
+                return 0;
+            }
+        }
+
+        // Returns the bytes per 4x4 block of a BC format, or 0 if the format is not block compressed.
+        inline uint32_t BytesPerBlock(uint32_t format) noexcept
+        {
+            if ((format >= 70 && format <= 72)          // BC1
+                || (format >= 79 && format <= 81))      // BC4
+                return 8;
+
+            if ((format >= 73 && format <= 78)          // BC2, BC3
+                || (format >= 82 && format <= 84)       // BC5
+                || (format >= 94 && format <= 99))      // BC6H, BC7
+                return 16;
+
+            return 0;
+        }
+
+        // CPU copy of a glyph sheet, sprite image, or the packed atlas.
+        struct Image
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t format;
+            uint32_t stride;
+            std::vector<uint8_t> pixels;
+        };
+
+        struct Font
+        {
+            std::vector<Glyph> glyphs;
+            float lineSpacing;
+            uint32_t defaultCharacter;
+            Image sheet;
+        };
+
+
+        //--------------------------------------------------------------------------------------
+        // Parses the binary format written by the MakeSpriteFont utility.
+        //--------------------------------------------------------------------------------------
+        inline Font ParseSpriteFont(_In_reads_bytes_(dataSize) uint8_t const* data, size_t dataSize)
+        {
+            static const char c_magic[] = "DXTKfont";
+
+            size_t offset = 0;
+            auto read = [&](void* dest, size_t bytes)
+                {
+                    if (bytes > dataSize - offset)
+                        throw std::runtime_error("End of file");
+
+                    memcpy(dest, data + offset, bytes);
+                    offset += bytes;
+                };
+            auto readUInt = [&]() -> uint32_t
+                {
+                    uint32_t value;
+                    read(&value, sizeof(value));
+                    return value;
+                };
+
+            char magic[sizeof(c_magic) - 1];
+            read(magic, sizeof(magic));
+            if (memcmp(magic, c_magic, sizeof(magic)) != 0)
+                throw std::runtime_error("Not a MakeSpriteFont output binary");
+
+            Font font = {};
+
+            const uint32_t glyphCount = readUInt();
+            if (glyphCount > (dataSize - offset) / sizeof(Glyph))
+                throw std::runtime_error("End of file");
+
+            font.glyphs.resize(glyphCount);
+            read(font.glyphs.data(), sizeof(Glyph) * glyphCount);
+
+            read(&font.lineSpacing, sizeof(float));
+            font.defaultCharacter = readUInt();
+
+            auto& sheet = font.sheet;
+            sheet.width = readUInt();
+            sheet.height = readUInt();
+            sheet.format = readUInt();
+            sheet.stride = readUInt();
+            const uint32_t rows = readUInt();
+
+            const uint64_t sheetBytes = uint64_t(sheet.stride) * uint64_t(rows);
+            if (sheetBytes > UINT32_MAX)
+                throw std::overflow_error("Invalid .spritefont file");
+
+            // The pixel data must cover the whole sheet so glyph subrects can be copied from it.
+            uint64_t minStride = 0;
+            uint64_t minRows = 0;
+            if (const uint32_t bpp = BytesPerPixel(sheet.format))
+            {
+                minStride = uint64_t(sheet.width) * bpp;
+                minRows = sheet.height;
+            }
+            else if (const uint32_t blockBytes = BytesPerBlock(sheet.format))
+            {
+                minStride = ((uint64_t(sheet.width) + 3) / 4) * blockBytes;
+                minRows = (uint64_t(sheet.height) + 3) / 4;
+            }
+
+            if (sheet.stride < minStride || rows < minRows)
+                throw std::runtime_error("Invalid .spritefont file");
+
+            sheet.pixels.resize(static_cast<size_t>(sheetBytes));
+            read(sheet.pixels.data(), sheet.pixels.size());
+
+            return font;
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // MaxRects bin packer using the best-short-side-fit heuristic.
+        //--------------------------------------------------------------------------------------
+        class MaxRectsBin
+        {
+        public:
+            MaxRectsBin(uint32_t width, uint32_t height) :
+                mFreeRects{ Rect{ 0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height) } }
+            {
+            }
+
+            // Places a width x height rectangle, returning false if there is no room.
+            bool Insert(uint32_t width, uint32_t height, Rect& result)
+            {
+                const auto w = static_cast<int32_t>(width);
+                const auto h = static_cast<int32_t>(height);
+
+                int32_t bestShortSide = INT32_MAX;
+                int32_t bestLongSide = INT32_MAX;
+                const Rect* best = nullptr;
+
+                for (auto const& free : mFreeRects)
+                {
+                    if (free.Width() < w || free.Height() < h)
+                        continue;
+
+                    const int32_t dx = free.Width() - w;
+                    const int32_t dy = free.Height() - h;
+                    const int32_t shortSide = std::min(dx, dy);
+                    const int32_t longSide = std::max(dx, dy);
+
+                    if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+                    {
+                        best = &free;
+                        bestShortSide = shortSide;
+                        bestLongSide = longSide;
+                    }
+                }
+
+                if (!best)
+                    return false;
+
+                result = Rect{ best->left, best->top, best->left + w, best->top + h };
+
+                SplitFreeRects(result);
+                PruneFreeRects();
+
+                return true;
+            }
+
+        private:
+            static bool Intersects(Rect const& a, Rect const& b) noexcept
+            {
+                return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+            }
+
+            static bool Contains(Rect const& outer, Rect const& inner) noexcept
+            {
+                return inner.left >= outer.left && inner.top >= outer.top
+                    && inner.right <= outer.right && inner.bottom <= outer.bottom;
+            }
+
+            // Replaces every free rectangle overlapping 'used' with up to four maximal leftovers.
+            void SplitFreeRects(Rect const& used)
+            {
+                std::vector<Rect> next;
+                next.reserve(mFreeRects.size() + 4);
+
+                for (auto const& free : mFreeRects)
+                {
+                    if (!Intersects(free, used))
+                    {
+                        next.push_back(free);
+                        continue;
+                    }
+
+                    if (used.left > free.left)
+                        next.push_back(Rect{ free.left, free.top, used.left, free.bottom });
+
+                    if (used.right < free.right)
+                        next.push_back(Rect{ used.right, free.top, free.right, free.bottom });
+
+                    if (used.top > free.top)
+                        next.push_back(Rect{ free.left, free.top, free.right, used.top });
+
+                    if (used.bottom < free.bottom)
+                        next.push_back(Rect{ free.left, used.bottom, free.right, free.bottom });
+                }
+
+                mFreeRects.swap(next);
+            }
+
+            // Removes free rectangles wholly contained by another.
+            void PruneFreeRects()
+            {
+                for (size_t i = 0; i < mFreeRects.size(); ++i)
+                {
+                    for (size_t j = i + 1; j < mFreeRects.size(); )
+                    {
+                        if (Contains(mFreeRects[i], mFreeRects[j]))
+                        {
+                            mFreeRects.erase(mFreeRects.begin() + static_cast<ptrdiff_t>(j));
+                        }
+                        else if (Contains(mFreeRects[j], mFreeRects[i]))
+                        {
+                            mFreeRects.erase(mFreeRects.begin() + static_cast<ptrdiff_t>(i));
+                            --i;
+                            break;
+                        }
+                        else
+                        {
+                            ++j;
+                        }
+                    }
+                }
+            }
+
+            std::vector<Rect> mFreeRects;
+        };
+
+
+        //--------------------------------------------------------------------------------------
+        // Packs the glyphs of every font plus the images into one atlas. Glyph subrects are
+        // rewritten in place; glyphs sharing the same source pixels share one atlas location.
+        // The atlas starts at a power of two estimated from the total area and grows up to maxSize.
+        //--------------------------------------------------------------------------------------
+        inline void Pack(
+            std::vector<Font>& fonts,
+            std::vector<Image> const& images,
+            uint32_t padding,
+            uint32_t maxSize,
+            Image& atlas,
+            std::vector<Rect>& imageRects)
+        {
+            if (fonts.empty() && images.empty())
+                throw std::invalid_argument("Nothing to pack");
+
+            const uint32_t format = !fonts.empty() ? fonts[0].sheet.format : images[0].format;
+            const uint32_t bpp = BytesPerPixel(format);
+            if (!bpp)
+                throw std::invalid_argument("Atlas packing requires an uncompressed pixel format");
+
+            struct Item
+            {
+                Image const* source;
+                Rect sourceRect;
+                Rect atlasRect;
+            };
+
+            std::vector<Item> items;
+
+            // Per font, maps each glyph to its item, or SIZE_MAX if it has no pixels.
+            std::vector<std::vector<size_t>> glyphItems(fonts.size());
+
+            for (size_t f = 0; f < fonts.size(); ++f)
+            {
+                auto const& sheet = fonts[f].sheet;
+                if (sheet.format != format)
+                    throw std::invalid_argument("All fonts and images must share the same pixel format");
+
+                std::map<std::tuple<int32_t, int32_t, int32_t, int32_t>, size_t> unique;
+
+                for (auto const& glyph : fonts[f].glyphs)
+                {
+                    auto const& r = glyph.Subrect;
+                    if (r.Width() <= 0 || r.Height() <= 0)
+                    {
+                        glyphItems[f].push_back(SIZE_MAX);
+                        continue;
+                    }
+
+                    if (r.left < 0 || r.top < 0
+                        || uint32_t(r.right) > sheet.width || uint32_t(r.bottom) > sheet.height)
+                        throw std::out_of_range("Glyph subrect outside of sprite sheet");
+
+                    auto key = std::make_tuple(r.left, r.top, r.right, r.bottom);
+                    auto it = unique.find(key);
+                    if (it == unique.end())
+                    {
+                        it = unique.emplace(key, items.size()).first;
+                        items.push_back(Item{ &sheet, r, Rect{} });
+                    }
+                    glyphItems[f].push_back(it->second);
+                }
+            }
+
+            const size_t firstImage = items.size();
+            for (auto const& image : images)
+            {
+                if (image.format != format)
+                    throw std::invalid_argument("All fonts and images must share the same pixel format");
+
+                items.push_back(Item{ &image, Rect{ 0, 0, int32_t(image.width), int32_t(image.height) }, Rect{} });
+            }
+
+            // Place big items first.
+            std::vector<size_t> order(items.size());
+            uint64_t totalArea = 0;
+            for (size_t j = 0; j < items.size(); ++j)
+            {
+                order[j] = j;
+                totalArea += uint64_t(items[j].sourceRect.Width() + padding) * uint64_t(items[j].sourceRect.Height() + padding);
+            }
+
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                {
+                    auto const& ra = items[a].sourceRect;
+                    auto const& rb = items[b].sourceRect;
+                    return std::max(ra.Width(), ra.Height()) > std::max(rb.Width(), rb.Height());
+                });
+
+            uint32_t width = 64;
+            uint32_t height = 64;
+            while (uint64_t(width) * uint64_t(height) < totalArea)
+            {
+                if (width <= height)
+                    width <<= 1;
+                else
+                    height <<= 1;
+            }
+
+            for (;;)
+            {
+                if (width > maxSize || height > maxSize)
+                    throw std::length_error("Atlas exceeds the maximum texture size");
+
+                MaxRectsBin bin(width, height);
+
+                bool fits = true;
+                for (size_t j : order)
+                {
+                    auto& item = items[j];
+
+                    // Padding goes to the right and bottom of each item, separating it from its neighbors.
+                    Rect placed;
+                    if (!bin.Insert(uint32_t(item.sourceRect.Width()) + padding, uint32_t(item.sourceRect.Height()) + padding, placed))
+                    {
+                        fits = false;
+                        break;
+                    }
+
+                    item.atlasRect = Rect{ placed.left, placed.top, placed.left + item.sourceRect.Width(), placed.top + item.sourceRect.Height() };
+                }
+
+                if (fits)
+                    break;
+
+                if (width <= height)
+                    width <<= 1;
+                else
+                    height <<= 1;
+            }
+
+            // Copy the pixels.
+            atlas.width = width;
+            atlas.height = height;
+            atlas.format = format;
+            atlas.stride = width * bpp;
+            atlas.pixels.assign(size_t(atlas.stride) * height, 0);
+
+            for (auto const& item : items)
+            {
+                const size_t rowBytes = size_t(item.sourceRect.Width()) * bpp;
+                for (int32_t y = 0; y < item.sourceRect.Height(); ++y)
+                {
+                    auto src = item.source->pixels.data()
+                        + size_t(item.sourceRect.top + y) * item.source->stride
+                        + size_t(item.sourceRect.left) * bpp;
+                    auto dest = atlas.pixels.data()
+                        + size_t(item.atlasRect.top + y) * atlas.stride
+                        + size_t(item.atlasRect.left) * bpp;
+                    memcpy(dest, src, rowBytes);
+                }
+            }
+
+            // Rewrite the glyph subrects.
+            for (size_t f = 0; f < fonts.size(); ++f)
+            {
+                auto& glyphs = fonts[f].glyphs;
+                for (size_t g = 0; g < glyphs.size(); ++g)
+                {
+                    const size_t index = glyphItems[f][g];
+                    if (index == SIZE_MAX)
+                    {
+                        const Rect& r = glyphs[g].Subrect;
+                        glyphs[g].Subrect = Rect{ 0, 0, std::max(r.Width(), 0), std::max(r.Height(), 0) };
+                    }
+                    else
+                    {
+                        glyphs[g].Subrect = items[index].atlasRect;
+                    }
+                }
+
+                fonts[f].sheet.pixels.clear();
+                fonts[f].sheet.pixels.shrink_to_fit();
+            }
+
+            imageRects.clear();
+            for (size_t j = firstImage; j < items.size(); ++j)
+            {
+                imageRects.push_back(items[j].atlasRect);
+            }
+        }
+
+
+        //--------------------------------------------------------------------------------------
+        // Estimates SpriteBatch draw batches for a sequence of text runs, with each font on its
+        // own texture versus all fonts sharing one atlas. SpriteBatch starts a new batch on
+        // every texture change and every maxBatchSize sprites.
+        //--------------------------------------------------------------------------------------
+        struct TextRun
+        {
+            size_t font;
+            wchar_t const* text;
+        };
+
+        struct BatchEstimate
+        {
+            size_t separateTextures;
+            size_t sharedAtlas;
+        };
+
+        // Counts the sprites SpriteFont::DrawString would emit for the text.
+        inline size_t CountSprites(Font const& font, _In_z_ wchar_t const* text)
+        {
+            auto find = [&](uint32_t character) -> Glyph const*
+                {
+                    auto it = std::lower_bound(font.glyphs.begin(), font.glyphs.end(), character,
+                        [](Glyph const& glyph, uint32_t c) { return glyph.Character < c; });
+                    if (it != font.glyphs.end() && it->Character == character)
+                        return &*it;
+
+                    if (character != font.defaultCharacter && font.defaultCharacter != 0)
+                    {
+                        it = std::lower_bound(font.glyphs.begin(), font.glyphs.end(), font.defaultCharacter,
+                            [](Glyph const& glyph, uint32_t c) { return glyph.Character < c; });
+                        if (it != font.glyphs.end() && it->Character == font.defaultCharacter)
+                            return &*it;
+                    }
+
+                    return nullptr;
+                };
+
+            size_t count = 0;
+            for (; *text; ++text)
+            {
+                const auto character = static_cast<uint32_t>(*text);
+                if (character == '\r' || character == '\n')
+                    continue;
+
+                auto glyph = find(character);
+                if (!glyph)
+                    continue;
+
+                if (!IsWhitespace(character)
+                    || glyph->Subrect.Width() > 1
+                    || glyph->Subrect.Height() > 1)
+                {
+                    ++count;
+                }
+            }
+
+            return count;
+        }
+
+        inline BatchEstimate EstimateBatches(
+            std::vector<Font> const& fonts,
+            _In_reads_(runCount) TextRun const* runs,
+            size_t runCount,
+            size_t maxBatchSize = 2048)
+        {
+            auto batchesFor = [=](size_t sprites) { return (sprites + maxBatchSize - 1) / maxBatchSize; };
+
+            BatchEstimate result = {};
+
+            size_t currentFont = SIZE_MAX;
+            size_t segmentSprites = 0;
+            size_t totalSprites = 0;
+
+            for (size_t j = 0; j < runCount; ++j)
+            {
+                const size_t sprites = CountSprites(fonts.at(runs[j].font), runs[j].text);
+                if (!sprites)
+                    continue;
+
+                if (runs[j].font != currentFont)
+                {
+                    result.separateTextures += batchesFor(segmentSprites);
+                    segmentSprites = 0;
+                    currentFont = runs[j].font;
+                }
+
+                segmentSprites += sprites;
+                totalSprites += sprites;
+            }
+
+            result.separateTextures += batchesFor(segmentSprites);
+            result.sharedAtlas = batchesFor(totalSprites);
+
+            return result;
+        }
+    }
+}
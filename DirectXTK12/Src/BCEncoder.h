@@ -0,0 +1,465 @@
+//--------------------------------------------------------------------------------------
+// File: BCEncoder.h
+//
+// Fast CPU block compression for writing BCn textures. Endpoints come from the principal
+// axis of each block rather than an exhaustive search, so quality is below DirectXTex's
+// encoders but throughput is high enough for captures.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <DirectXMath.h>
+
+#include "ParallelHelpers.h"
+
+
+namespace DirectX
+{
+    namespace BCEncode
+    {
+        enum class Format
+        {
+            BC1,    // RGB, with 1-bit alpha if any texel in the block has alpha below 128
+            BC3,    // RGBA
+            BC4,    // R
+            BC5,    // RG
+            BC7,    // RGBA, using mode 6 only
+        };
+
+        constexpr size_t BlockSize(Format format) noexcept
+        {
+            return (format == Format::BC1 || format == Format::BC4) ? 8u : 16u;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Implementation details
+        //--------------------------------------------------------------------------------------
+        namespace Internal
+        {
+            constexpr size_t c_minBlocksPerTask = 256;
+
+            // Finds the line through the points along which they vary most, and returns its extent
+            // pulled in by 1/16 at each end, which lowers the average error of the interpolated palette.
+            inline void FitEndpoints(_In_reads_(count) const XMVECTOR* points, size_t count, XMVECTOR& e0, XMVECTOR& e1) noexcept
+            {
+                XMVECTOR mean = XMVectorZero();
+                XMVECTOR vmin = points[0];
+                XMVECTOR vmax = points[0];
+                for (size_t i = 0; i < count; ++i)
+                {
+                    mean = XMVectorAdd(mean, points[i]);
+                    vmin = XMVectorMin(vmin, points[i]);
+                    vmax = XMVectorMax(vmax, points[i]);
+                }
+                mean = XMVectorScale(mean, 1.f / float(count));
+
+                XMMATRIX cov(XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero());
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const XMVECTOR d = XMVectorSubtract(points[i], mean);
+                    cov.r[0] = XMVectorMultiplyAdd(d, XMVectorSplatX(d), cov.r[0]);
+                    cov.r[1] = XMVectorMultiplyAdd(d, XMVectorSplatY(d), cov.r[1]);
+                    cov.r[2] = XMVectorMultiplyAdd(d, XMVectorSplatZ(d), cov.r[2]);
+                    cov.r[3] = XMVectorMultiplyAdd(d, XMVectorSplatW(d), cov.r[3]);
+                }
+
+                // Power iteration, starting from the bounding box diagonal. The matrix is symmetric,
+                // so transforming by it is the same as multiplying by it.
+                XMVECTOR axis = XMVectorSubtract(vmax, vmin);
+                if (XMVectorGetX(XMVector4LengthSq(axis)) < 1e-12f)
+                {
+                    e0 = e1 = mean;
+                    return;
+                }
+
+                for (size_t j = 0; j < 8; ++j)
+                {
+                    const XMVECTOR next = XMVector4Transform(axis, cov);
+                    if (XMVectorGetX(XMVector4LengthSq(next)) < 1e-24f)
+                        break;
+                    axis = XMVector4Normalize(next);
+                }
+                axis = XMVector4Normalize(axis);
+
+                float tmin = 0.f;
+                float tmax = 0.f;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(points[i], mean), axis));
+                    tmin = std::min(tmin, t);
+                    tmax = std::max(tmax, t);
+                }
+
+                const float inset = (tmax - tmin) / 16.f;
+                e0 = XMVectorSaturate(XMVectorMultiplyAdd(axis, XMVectorReplicate(tmin + inset), mean));
+                e1 = XMVectorSaturate(XMVectorMultiplyAdd(axis, XMVectorReplicate(tmax - inset), mean));
+            }
+
+            inline size_t XM_CALLCONV FindNearest(FXMVECTOR value, _In_reads_(count) const XMVECTOR* palette, size_t count) noexcept
+            {
+                size_t best = 0;
+                float bestError = XMVectorGetX(XMVector4LengthSq(XMVectorSubtract(value, palette[0])));
+                for (size_t j = 1; j < count; ++j)
+                {
+                    const float error = XMVectorGetX(XMVector4LengthSq(XMVectorSubtract(value, palette[j])));
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = j;
+                    }
+                }
+                return best;
+            }
+
+            inline uint16_t XM_CALLCONV Pack565(FXMVECTOR color) noexcept
+            {
+                XMFLOAT4 f;
+                XMStoreFloat4(&f, color);
+                const auto r = static_cast<uint32_t>(f.x * 31.f + 0.5f);
+                const auto g = static_cast<uint32_t>(f.y * 63.f + 0.5f);
+                const auto b = static_cast<uint32_t>(f.z * 31.f + 0.5f);
+                return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+            }
+
+            inline XMVECTOR Unpack565(uint16_t color) noexcept
+            {
+                const uint32_t r = (color >> 11) & 0x1f;
+                const uint32_t g = (color >> 5) & 0x3f;
+                const uint32_t b = color & 0x1f;
+                return XMVectorSet(
+                    float((r << 3) | (r >> 2)) / 255.f,
+                    float((g << 2) | (g >> 4)) / 255.f,
+                    float((b << 3) | (b >> 2)) / 255.f,
+                    0.f);
+            }
+
+            inline void StoreLE16(uint8_t* dest, uint16_t value) noexcept
+            {
+                dest[0] = static_cast<uint8_t>(value);
+                dest[1] = static_cast<uint8_t>(value >> 8);
+            }
+
+            // Writes fields to a 128-bit block, least significant bit first.
+            class BitWriter
+            {
+            public:
+                explicit BitWriter(uint8_t* dest) noexcept : mDest(dest), mPosition(0)
+                {
+                    memset(mDest, 0, 16);
+                }
+
+                void Write(uint32_t value, size_t bits) noexcept
+                {
+                    for (size_t j = 0; j < bits; ++j, ++mPosition)
+                    {
+                        if (value & (1u << j))
+                        {
+                            mDest[mPosition >> 3] |= static_cast<uint8_t>(1u << (mPosition & 7));
+                        }
+                    }
+                }
+
+            private:
+                uint8_t*    mDest;
+                size_t      mPosition;
+            };
+
+            //----------------------------------------------------------------------------------
+            // Color block shared by BC1 and BC3. BC3 always decodes it in four-color mode.
+            inline void EncodeColorBlock(_In_reads_(64) const uint8_t* rgba, _Out_writes_(8) uint8_t* dest, bool allowTransparent) noexcept
+            {
+                XMVECTOR points[16];
+                bool transparent[16] = {};
+                size_t count = 0;
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    const uint8_t* texel = rgba + i * 4;
+                    if (allowTransparent && texel[3] < 128)
+                    {
+                        transparent[i] = true;
+                        continue;
+                    }
+
+                    points[count++] = XMVectorSet(float(texel[0]) / 255.f, float(texel[1]) / 255.f, float(texel[2]) / 255.f, 0.f);
+                }
+
+                if (!count)
+                {
+                    // Every texel is transparent
+                    StoreLE16(dest, 0);
+                    StoreLE16(dest + 2, 0);
+                    memset(dest + 4, 0xff, 4);
+                    return;
+                }
+
+                const bool threeColor = (count < 16);
+
+                XMVECTOR e0, e1;
+                FitEndpoints(points, count, e0, e1);
+
+                uint16_t c0 = Pack565(e0);
+                uint16_t c1 = Pack565(e1);
+
+                // Four-color mode is selected by c0 > c1, and three-color mode by c0 <= c1.
+                if (threeColor ? (c0 > c1) : (c0 < c1))
+                {
+                    std::swap(c0, c1);
+                }
+
+                XMVECTOR palette[4];
+                palette[0] = Unpack565(c0);
+                palette[1] = Unpack565(c1);
+
+                size_t paletteSize;
+                if (threeColor)
+                {
+                    palette[2] = XMVectorLerp(palette[0], palette[1], 0.5f);
+                    paletteSize = 3;
+                }
+                else if (c0 == c1)
+                {
+                    paletteSize = 1;
+                }
+                else
+                {
+                    palette[2] = XMVectorLerp(palette[0], palette[1], 1.f / 3.f);
+                    palette[3] = XMVectorLerp(palette[0], palette[1], 2.f / 3.f);
+                    paletteSize = 4;
+                }
+
+                uint32_t indices = 0;
+                for (size_t i = 0, j = 0; i < 16; ++i)
+                {
+                    uint32_t index = 3;
+                    if (!transparent[i])
+                    {
+                        index = static_cast<uint32_t>(FindNearest(points[j++], palette, paletteSize));
+                    }
+                    indices |= index << (i * 2);
+                }
+
+                StoreLE16(dest, c0);
+                StoreLE16(dest + 2, c1);
+                StoreLE16(dest + 4, static_cast<uint16_t>(indices));
+                StoreLE16(dest + 6, static_cast<uint16_t>(indices >> 16));
+            }
+
+            //----------------------------------------------------------------------------------
+            // Single channel block used by BC3 alpha, BC4 and BC5. Always uses the eight-value mode.
+            inline void EncodeChannelBlock(_In_reads_(64) const uint8_t* rgba, size_t channel, _Out_writes_(8) uint8_t* dest) noexcept
+            {
+                uint32_t vmin = 255;
+                uint32_t vmax = 0;
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    const uint32_t v = rgba[i * 4 + channel];
+                    vmin = std::min(vmin, v);
+                    vmax = std::max(vmax, v);
+                }
+
+                dest[0] = static_cast<uint8_t>(vmax);
+                dest[1] = static_cast<uint8_t>(vmin);
+
+                uint64_t indices = 0;
+                if (vmax > vmin)
+                {
+                    // Palette entry k, counting from max to min, is index 0 for k = 0, 1 for k = 7, else k + 1.
+                    const uint32_t range = vmax - vmin;
+                    for (size_t i = 0; i < 16; ++i)
+                    {
+                        const uint32_t v = rgba[i * 4 + channel];
+                        const uint32_t k = ((vmax - v) * 7 + range / 2) / range;
+                        const uint64_t index = (k == 0) ? 0 : ((k == 7) ? 1 : k + 1);
+                        indices |= index << (i * 3);
+                    }
+                }
+
+                for (size_t j = 0; j < 6; ++j)
+                {
+                    dest[2 + j] = static_cast<uint8_t>(indices >> (j * 8));
+                }
+            }
+
+            //----------------------------------------------------------------------------------
+            // BC7 mode 6: one subset, RGBA 7-bit endpoints each with a p-bit, 4-bit indices.
+            inline void QuantizeMode6Endpoint(FXMVECTOR endpoint, uint8_t quantized[4], uint32_t& pbit, XMVECTOR& reconstructed) noexcept
+            {
+                XMFLOAT4 f;
+                XMStoreFloat4(&f, XMVectorScale(endpoint, 255.f));
+                const float v[4] = { f.x, f.y, f.z, f.w };
+
+                float bestError = 0.f;
+                for (uint32_t p = 0; p < 2; ++p)
+                {
+                    uint8_t q[4];
+                    float error = 0.f;
+                    for (size_t c = 0; c < 4; ++c)
+                    {
+                        const int value = static_cast<int>((v[c] - float(p)) * 0.5f + 0.5f);
+                        q[c] = static_cast<uint8_t>(std::min(std::max(value, 0), 127));
+                        const float d = float(q[c] * 2u + p) - v[c];
+                        error += d * d;
+                    }
+
+                    if (p == 0 || error < bestError)
+                    {
+                        bestError = error;
+                        pbit = p;
+                        memcpy(quantized, q, 4);
+                    }
+                }
+
+                reconstructed = XMVectorSet(
+                    float(quantized[0] * 2u + pbit),
+                    float(quantized[1] * 2u + pbit),
+                    float(quantized[2] * 2u + pbit),
+                    float(quantized[3] * 2u + pbit));
+            }
+
+            inline void EncodeBC7Block(_In_reads_(64) const uint8_t* rgba, _Out_writes_(16) uint8_t* dest) noexcept
+            {
+                static constexpr uint32_t s_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+                XMVECTOR points[16];
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    const uint8_t* texel = rgba + i * 4;
+                    points[i] = XMVectorSet(float(texel[0]), float(texel[1]), float(texel[2]), float(texel[3]));
+                }
+
+                XMVECTOR e0, e1;
+                {
+                    XMVECTOR normalized[16];
+                    for (size_t i = 0; i < 16; ++i)
+                    {
+                        normalized[i] = XMVectorScale(points[i], 1.f / 255.f);
+                    }
+                    FitEndpoints(normalized, 16, e0, e1);
+                }
+
+                uint8_t q0[4], q1[4];
+                uint32_t p0 = 0, p1 = 0;
+                XMVECTOR r0, r1;
+                QuantizeMode6Endpoint(e0, q0, p0, r0);
+                QuantizeMode6Endpoint(e1, q1, p1, r1);
+
+                // Interpolation matches the decoder: ((64 - w) * e0 + w * e1 + 32) >> 6.
+                XMVECTOR palette[16];
+                for (size_t j = 0; j < 16; ++j)
+                {
+                    const XMVECTOR w = XMVectorReplicate(float(s_weights[j]));
+                    const XMVECTOR sum = XMVectorMultiplyAdd(r1, w, XMVectorMultiply(r0, XMVectorSubtract(XMVectorReplicate(64.f), w)));
+                    palette[j] = XMVectorFloor(XMVectorScale(XMVectorAdd(sum, XMVectorReplicate(32.f)), 1.f / 64.f));
+                }
+
+                uint32_t indices[16];
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    indices[i] = static_cast<uint32_t>(FindNearest(points[i], palette, 16));
+                }
+
+                // The anchor index is stored with its top bit implied zero.
+                if (indices[0] & 8)
+                {
+                    std::swap(q0, q1);
+                    std::swap(p0, p1);
+                    for (auto& it : indices)
+                    {
+                        it = 15 - it;
+                    }
+                }
+
+                BitWriter writer(dest);
+                writer.Write(1u << 6, 7);
+                for (size_t c = 0; c < 4; ++c)
+                {
+                    writer.Write(q0[c], 7);
+                    writer.Write(q1[c], 7);
+                }
+                writer.Write(p0, 1);
+                writer.Write(p1, 1);
+                writer.Write(indices[0], 3);
+                for (size_t i = 1; i < 16; ++i)
+                {
+                    writer.Write(indices[i], 4);
+                }
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Encodes one 4x4 block of RGBA8 texels, stored row by row.
+        inline void EncodeBlock(Format format, _In_reads_(64) const uint8_t* rgba, _Out_writes_(BlockSize(format)) uint8_t* dest) noexcept
+        {
+            switch (format)
+            {
+            case Format::BC1:
+                Internal::EncodeColorBlock(rgba, dest, true);
+                break;
+
+            case Format::BC3:
+                Internal::EncodeChannelBlock(rgba, 3, dest);
+                Internal::EncodeColorBlock(rgba, dest + 8, false);
+                break;
+
+            case Format::BC4:
+                Internal::EncodeChannelBlock(rgba, 0, dest);
+                break;
+
+            case Format::BC5:
+                Internal::EncodeChannelBlock(rgba, 0, dest);
+                Internal::EncodeChannelBlock(rgba, 1, dest + 8);
+                break;
+
+            case Format::BC7:
+                Internal::EncodeBC7Block(rgba, dest);
+                break;
+            }
+        }
+
+        // Encodes an RGBA8 image, in parallel over blocks. Partial blocks at the right and bottom edges
+        // repeat the last column and row. destRowPitch is the distance between rows of blocks.
+        inline void EncodeImage(Format format,
+            _In_ const uint8_t* rgba, size_t width, size_t height, size_t rowPitch,
+            _Out_ uint8_t* dest, size_t destRowPitch)
+        {
+            if (!width || !height)
+                return;
+
+            const size_t blocksWide = (width + 3) / 4;
+            const size_t blocksHigh = (height + 3) / 4;
+            const size_t blockSize = BlockSize(format);
+
+            ParallelHelpers::ParallelFor(blocksWide * blocksHigh, Internal::c_minBlocksPerTask, [&](size_t begin, size_t end)
+                {
+                    uint8_t block[64];
+                    for (size_t n = begin; n < end; ++n)
+                    {
+                        const size_t bx = n % blocksWide;
+                        const size_t by = n / blocksWide;
+
+                        for (size_t y = 0; y < 4; ++y)
+                        {
+                            const uint8_t* row = rgba + std::min(by * 4 + y, height - 1) * rowPitch;
+                            for (size_t x = 0; x < 4; ++x)
+                            {
+                                memcpy(block + (y * 4 + x) * 4, row + std::min(bx * 4 + x, width - 1) * 4, 4);
+                            }
+                        }
+
+                        EncodeBlock(format, block, dest + by * destRowPitch + bx * blockSize);
+                    }
+                });
+        }
+    }
+}
@@ -0,0 +1,415 @@
+//--------------------------------------------------------------------------------------
+// File: CpuMipGenerator.h
+//
+// Generates mip chains on the CPU, as a fallback for GenerateMips where compute shaders
+// can't be used, such as on copy queues
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include "ParallelHelpers.h"
+
+
+namespace DirectX
+{
+    namespace CpuMips
+    {
+        // The 8-bit formats also cover BGRA, since every channel is filtered independently and
+        // the sRGB curve is never applied to alpha.
+        enum class Format
+        {
+            R8G8B8A8_UNORM,
+            R8G8B8A8_UNORM_SRGB,
+            R16G16B16A16_FLOAT,
+            R32G32B32A32_FLOAT,
+        };
+
+        enum class Filter
+        {
+            Box,        // Average of the source texels each destination texel covers
+            Kaiser,     // Kaiser-windowed sinc, sharper than Box
+        };
+
+        // Mip 0 of one array slice.
+        struct Image
+        {
+            uint32_t width;
+            uint32_t height;
+            size_t rowPitch;
+            const void* pixels;
+        };
+
+        struct Surface
+        {
+            uint32_t width;
+            uint32_t height;
+            size_t rowPitch;
+            size_t offset;
+        };
+
+        // Every mip of slice 0, then every mip of slice 1, and so on, which is Direct3D subresource order.
+        struct MipChain
+        {
+            size_t mipLevels;
+            size_t arraySize;
+            std::vector<Surface> surfaces;
+            std::unique_ptr<uint8_t[]> pixels;
+
+            const uint8_t* GetPixels(size_t subresource) const { return pixels.get() + surfaces.at(subresource).offset; }
+        };
+
+        inline size_t BytesPerPixel(Format format) noexcept
+        {
+            switch (format)
+            {
+            case Format::R16G16B16A16_FLOAT: return 8;
+            case Format::R32G32B32A32_FLOAT: return 16;
+            default: return 4;
+            }
+        }
+
+        inline size_t CountMips(uint32_t width, uint32_t height) noexcept
+        {
+            size_t mipLevels = 1;
+            while (width > 1 || height > 1)
+            {
+                width = std::max<uint32_t>(width >> 1, 1);
+                height = std::max<uint32_t>(height >> 1, 1);
+                ++mipLevels;
+            }
+            return mipLevels;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Implementation details
+        //--------------------------------------------------------------------------------------
+        namespace Internal
+        {
+            inline XMVECTOR XM_CALLCONV LoadPixel(Format format, const uint8_t* pixel) noexcept
+            {
+                switch (format)
+                {
+                case Format::R8G8B8A8_UNORM:
+                    return PackedVector::XMLoadUByteN4(reinterpret_cast<const PackedVector::XMUBYTEN4*>(pixel));
+
+                case Format::R8G8B8A8_UNORM_SRGB:
+                    return XMColorSRGBToRGB(PackedVector::XMLoadUByteN4(reinterpret_cast<const PackedVector::XMUBYTEN4*>(pixel)));
+
+                case Format::R16G16B16A16_FLOAT:
+                    return PackedVector::XMLoadHalf4(reinterpret_cast<const PackedVector::XMHALF4*>(pixel));
+
+                default:
+                    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pixel));
+                }
+            }
+
+            inline void XM_CALLCONV StorePixel(Format format, uint8_t* pixel, FXMVECTOR value) noexcept
+            {
+                switch (format)
+                {
+                case Format::R8G8B8A8_UNORM:
+                    PackedVector::XMStoreUByteN4(reinterpret_cast<PackedVector::XMUBYTEN4*>(pixel), value);
+                    break;
+
+                case Format::R8G8B8A8_UNORM_SRGB:
+                    PackedVector::XMStoreUByteN4(reinterpret_cast<PackedVector::XMUBYTEN4*>(pixel), XMColorRGBToSRGB(value));
+                    break;
+
+                case Format::R16G16B16A16_FLOAT:
+                    PackedVector::XMStoreHalf4(reinterpret_cast<PackedVector::XMHALF4*>(pixel), value);
+                    break;
+
+                default:
+                    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pixel), value);
+                    break;
+                }
+            }
+
+            // Zeroth order modified Bessel function of the first kind.
+            inline double BesselI0(double x) noexcept
+            {
+                double sum = 1.0;
+                double term = 1.0;
+                const double halfX = x * 0.5;
+                for (int k = 1; k < 32; ++k)
+                {
+                    term *= halfX / k;
+                    sum += term * term;
+                    if (term * term < sum * 1e-12)
+                        break;
+                }
+                return sum;
+            }
+
+            constexpr double c_kaiserAlpha = 4.0;
+            constexpr double c_kaiserRadius = 3.0;
+
+            inline double KaiserSinc(double x) noexcept
+            {
+                const double t = x / c_kaiserRadius;
+                if (t <= -1.0 || t >= 1.0)
+                    return 0.0;
+
+                const double window = BesselI0(c_kaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(c_kaiserAlpha);
+                const double sinc = (x == 0.0) ? 1.0 : std::sin(XM_PI * x) / (XM_PI * x);
+                return sinc * window;
+            }
+
+            // Source texels contributing to each destination texel along one axis. The first tap may lie
+            // outside the source, in which case the edge texel is repeated.
+            struct FilterTaps
+            {
+                std::vector<ptrdiff_t> first;
+                std::vector<size_t> count;
+                std::vector<size_t> weightOffset;
+                std::vector<float> weights;
+
+                FilterTaps(size_t srcSize, size_t dstSize, Filter filter)
+                {
+                    first.resize(dstSize);
+                    count.resize(dstSize);
+                    weightOffset.resize(dstSize);
+
+                    const double scale = double(srcSize) / double(dstSize);
+
+                    for (size_t x = 0; x < dstSize; ++x)
+                    {
+                        ptrdiff_t lo = 0;
+                        ptrdiff_t hi = 0;
+                        const double center = (double(x) + 0.5) * scale;
+
+                        if (filter == Filter::Box)
+                        {
+                            lo = static_cast<ptrdiff_t>(std::floor(double(x) * scale));
+                            hi = static_cast<ptrdiff_t>(std::ceil(double(x + 1) * scale));
+                        }
+                        else
+                        {
+                            const double support = c_kaiserRadius * scale;
+                            lo = static_cast<ptrdiff_t>(std::floor(center - support));
+                            hi = static_cast<ptrdiff_t>(std::ceil(center + support));
+                        }
+
+                        first[x] = lo;
+                        count[x] = static_cast<size_t>(hi - lo);
+                        weightOffset[x] = weights.size();
+
+                        double total = 0.0;
+                        for (ptrdiff_t i = lo; i < hi; ++i)
+                        {
+                            double w = 0.0;
+                            if (filter == Filter::Box)
+                            {
+                                w = std::min(double(x + 1) * scale, double(i + 1)) - std::max(double(x) * scale, double(i));
+                            }
+                            else
+                            {
+                                w = KaiserSinc((double(i) + 0.5 - center) / scale);
+                            }
+
+                            weights.push_back(static_cast<float>(w));
+                            total += w;
+                        }
+
+                        for (size_t j = weightOffset[x]; j < weights.size(); ++j)
+                        {
+                            weights[j] = static_cast<float>(weights[j] / total);
+                        }
+                    }
+                }
+            };
+
+            inline size_t ClampIndex(ptrdiff_t i, size_t size) noexcept
+            {
+                return (i < 0) ? 0 : std::min(static_cast<size_t>(i), size - 1);
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Filters in linear space, keeping each level at full float precision for the next one
+        //--------------------------------------------------------------------------------------
+        inline void GenerateMipChain(
+            const Image* slices,
+            size_t arraySize,
+            size_t mipLevels,
+            Format format,
+            Filter filter,
+            MipChain& result)
+        {
+            using namespace Internal;
+
+            constexpr size_t c_minRowsPerTask = 16;
+
+            if (!slices || !arraySize)
+                throw std::invalid_argument("CpuMips::GenerateMipChain requires at least one slice");
+
+            const uint32_t width = slices[0].width;
+            const uint32_t height = slices[0].height;
+            if (!width || !height)
+                throw std::invalid_argument("CpuMips::GenerateMipChain requires a non-empty image");
+
+            for (size_t slice = 1; slice < arraySize; ++slice)
+            {
+                if (slices[slice].width != width || slices[slice].height != height)
+                    throw std::invalid_argument("CpuMips::GenerateMipChain requires slices of the same size");
+            }
+
+            const size_t maxMips = CountMips(width, height);
+            if (!mipLevels || mipLevels > maxMips)
+            {
+                mipLevels = maxMips;
+            }
+
+            // Lay out the chain.
+            const size_t bpp = BytesPerPixel(format);
+
+            result.mipLevels = mipLevels;
+            result.arraySize = arraySize;
+            result.surfaces.resize(mipLevels * arraySize);
+
+            size_t totalBytes = 0;
+            for (size_t slice = 0; slice < arraySize; ++slice)
+            {
+                uint32_t w = width;
+                uint32_t h = height;
+                for (size_t mip = 0; mip < mipLevels; ++mip)
+                {
+                    auto& surface = result.surfaces[slice * mipLevels + mip];
+                    surface.width = w;
+                    surface.height = h;
+                    surface.rowPitch = size_t(w) * bpp;
+                    surface.offset = totalBytes;
+
+                    totalBytes += surface.rowPitch * h;
+
+                    w = std::max<uint32_t>(w >> 1, 1);
+                    h = std::max<uint32_t>(h >> 1, 1);
+                }
+            }
+
+            result.pixels.reset(new uint8_t[totalBytes]);
+
+            // Copy mip 0 as is, and convert it to linear floats.
+            std::vector<std::vector<XMFLOAT4>> current(arraySize);
+            for (auto& it : current)
+            {
+                it.resize(size_t(width) * height);
+            }
+
+            ParallelHelpers::ParallelFor(arraySize * height, c_minRowsPerTask, [&](size_t begin, size_t end)
+                {
+                    for (size_t row = begin; row < end; ++row)
+                    {
+                        const size_t slice = row / height;
+                        const size_t y = row % height;
+
+                        auto const& surface = result.surfaces[slice * mipLevels];
+                        const uint8_t* src = static_cast<const uint8_t*>(slices[slice].pixels) + y * slices[slice].rowPitch;
+
+                        memcpy(result.pixels.get() + surface.offset + y * surface.rowPitch, src, surface.rowPitch);
+
+                        XMFLOAT4* dest = current[slice].data() + y * width;
+                        for (size_t x = 0; x < width; ++x)
+                        {
+                            XMStoreFloat4(&dest[x], LoadPixel(format, src + x * bpp));
+                        }
+                    }
+                });
+
+            // Each level is filtered horizontally, then vertically, from the previous one.
+            std::vector<std::vector<XMFLOAT4>> horizontal(arraySize);
+            std::vector<std::vector<XMFLOAT4>> next(arraySize);
+
+            uint32_t srcWidth = width;
+            uint32_t srcHeight = height;
+            for (size_t mip = 1; mip < mipLevels; ++mip)
+            {
+                const uint32_t dstWidth = std::max<uint32_t>(srcWidth >> 1, 1);
+                const uint32_t dstHeight = std::max<uint32_t>(srcHeight >> 1, 1);
+
+                const FilterTaps tapsX(srcWidth, dstWidth, filter);
+                const FilterTaps tapsY(srcHeight, dstHeight, filter);
+
+                for (size_t slice = 0; slice < arraySize; ++slice)
+                {
+                    horizontal[slice].resize(size_t(dstWidth) * srcHeight);
+                    next[slice].resize(size_t(dstWidth) * dstHeight);
+                }
+
+                ParallelHelpers::ParallelFor(arraySize * srcHeight, c_minRowsPerTask, [&](size_t begin, size_t end)
+                    {
+                        for (size_t row = begin; row < end; ++row)
+                        {
+                            const size_t slice = row / srcHeight;
+                            const size_t y = row % srcHeight;
+
+                            const XMFLOAT4* src = current[slice].data() + y * srcWidth;
+                            XMFLOAT4* dest = horizontal[slice].data() + y * dstWidth;
+
+                            for (size_t x = 0; x < dstWidth; ++x)
+                            {
+                                const float* weights = tapsX.weights.data() + tapsX.weightOffset[x];
+
+                                XMVECTOR sum = XMVectorZero();
+                                for (size_t k = 0; k < tapsX.count[x]; ++k)
+                                {
+                                    const size_t i = ClampIndex(tapsX.first[x] + ptrdiff_t(k), srcWidth);
+                                    sum = XMVectorMultiplyAdd(XMLoadFloat4(&src[i]), XMVectorReplicate(weights[k]), sum);
+                                }
+                                XMStoreFloat4(&dest[x], sum);
+                            }
+                        }
+                    });
+
+                ParallelHelpers::ParallelFor(arraySize * dstHeight, c_minRowsPerTask, [&](size_t begin, size_t end)
+                    {
+                        for (size_t row = begin; row < end; ++row)
+                        {
+                            const size_t slice = row / dstHeight;
+                            const size_t y = row % dstHeight;
+
+                            const float* weights = tapsY.weights.data() + tapsY.weightOffset[y];
+                            const XMFLOAT4* src = horizontal[slice].data();
+                            XMFLOAT4* dest = next[slice].data() + y * dstWidth;
+
+                            auto const& surface = result.surfaces[slice * mipLevels + mip];
+                            uint8_t* pixels = result.pixels.get() + surface.offset + y * surface.rowPitch;
+
+                            for (size_t x = 0; x < dstWidth; ++x)
+                            {
+                                XMVECTOR sum = XMVectorZero();
+                                for (size_t k = 0; k < tapsY.count[y]; ++k)
+                                {
+                                    const size_t i = ClampIndex(tapsY.first[y] + ptrdiff_t(k), srcHeight);
+                                    sum = XMVectorMultiplyAdd(XMLoadFloat4(&src[i * dstWidth + x]), XMVectorReplicate(weights[k]), sum);
+                                }
+                                XMStoreFloat4(&dest[x], sum);
+                                StorePixel(format, pixels + x * bpp, sum);
+                            }
+                        }
+                    });
+
+                std::swap(current, next);
+                srcWidth = dstWidth;
+                srcHeight = dstHeight;
+            }
+        }
+    }
+}
@@ -0,0 +1,301 @@
+//--------------------------------------------------------------------------------------
+// File: DDSStreamingHelpers.h
+//
+// Helper functions for loaders which read a DDS file one mip range at a time
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "DDS.h"
+#include "DirectXHelpers.h"
+#include "LoaderHelpers.h"
+#include "MipChainLayout.h"
+#include "PixelConversion.h"
+#include "PlatformHelpers.h"
+#include "ResourceUploadBatch.h"
+
+
+namespace DirectX
+{
+    namespace StreamingHelpers
+    {
+        // Largest possible header: magic value, DDS_HEADER, and DDS_HEADER_DXT10.
+        constexpr size_t c_maxHeaderSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+        using TextureInfo = LoaderHelpers::DDSTextureInfo;
+
+        // Bytes a run of surfaces takes once loaded, given its size in the file.
+        inline uint64_t GetLoadedBytes(TextureInfo const& info, uint64_t fileBytes) noexcept
+        {
+            return info.expandRGB24 ? fileBytes / 3 * 4 : fileBytes;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Reads from an absolute file offset, so several threads can share one handle
+        //--------------------------------------------------------------------------------------
+        inline HRESULT ReadAt(HANDLE hFile, uint64_t offset, _Out_writes_bytes_(size) uint8_t* buffer, uint64_t size) noexcept
+        {
+            while (size > 0)
+            {
+                const DWORD request = static_cast<DWORD>(std::min<uint64_t>(size, UINT32_MAX));
+
+                OVERLAPPED ov = {};
+                ov.Offset = static_cast<DWORD>(offset);
+                ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+                DWORD bytesRead = 0;
+                if (!ReadFile(hFile, buffer, request, &bytesRead, &ov))
+                    return HRESULT_FROM_WIN32(GetLastError());
+
+                if (!bytesRead)
+                    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+                offset += bytesRead;
+                buffer += bytesRead;
+                size -= bytesRead;
+            }
+
+            return S_OK;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Opens a DDS file for reading with ReadAt
+        //--------------------------------------------------------------------------------------
+        inline HRESULT OpenFile(_In_z_ const wchar_t* fileName, ScopedHandle& file) noexcept
+        {
+        #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+            file.reset(safe_handle(CreateFile2(
+                fileName,
+                GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+                nullptr)));
+        #else
+            file.reset(safe_handle(CreateFileW(
+                fileName,
+                GENERIC_READ, FILE_SHARE_READ,
+                nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                nullptr)));
+        #endif
+
+            if (!file)
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            return S_OK;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Reads and validates the header, and computes where every mip is stored in the file
+        //--------------------------------------------------------------------------------------
+        inline HRESULT ReadLayout(
+            HANDLE hFile,
+            _In_ ID3D12Device* device,
+            TextureInfo& info,
+            MipChainLayout& layout,
+            DDS_ALPHA_MODE& alphaMode) noexcept
+        {
+            FILE_STANDARD_INFO fileInfo;
+            if (!GetFileInformationByHandleEx(hFile, FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            const uint64_t fileSize = static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart);
+
+            uint8_t headerData[c_maxHeaderSize] = {};
+            const size_t headerSize = static_cast<size_t>(std::min<uint64_t>(fileSize, c_maxHeaderSize));
+
+            HRESULT hr = ReadAt(hFile, 0, headerData, headerSize);
+            if (FAILED(hr))
+                return hr;
+
+            const DDS_HEADER* header = nullptr;
+            const uint8_t* bitData = nullptr;
+            size_t bitSize = 0;
+            hr = LoaderHelpers::LoadTextureDataFromMemory(headerData, headerSize, &header, &bitData, &bitSize);
+            if (FAILED(hr))
+                return hr;
+
+            hr = LoaderHelpers::GetDDSTextureInfo(header, info);
+            if (FAILED(hr))
+                return hr;
+
+            if (D3D12GetFormatPlaneCount(device, info.format) != 1)
+            {
+                DebugTrace("ERROR: Streaming does not support planar formats (%u)\n", static_cast<uint32_t>(info.format));
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+
+            hr = LoaderHelpers::GetDDSLayout(info, static_cast<uint64_t>(bitData - headerData), layout);
+            if (FAILED(hr))
+                return hr;
+
+            if (layout.GetFileSize() > fileSize)
+                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+            alphaMode = LoaderHelpers::GetAlphaMode(header);
+
+            return S_OK;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Returns the first mip which fits in maxsize, skipping larger ones as FillInitData does
+        //--------------------------------------------------------------------------------------
+        inline size_t GetTopMip(MipChainLayout const& layout, size_t maxsize)
+        {
+            size_t topMip = 0;
+            if (maxsize)
+            {
+                while (topMip + 1 < layout.GetMipCount())
+                {
+                    auto const& mip = layout.GetMip(topMip);
+                    if (mip.width <= maxsize && mip.height <= maxsize && mip.depth <= maxsize)
+                        break;
+
+                    ++topMip;
+                }
+            }
+
+            return topMip;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Creates a texture holding mips [topMip, mipCount) in the COPY_DEST state
+        //--------------------------------------------------------------------------------------
+        inline HRESULT CreateTexture(
+            _In_ ID3D12Device* device,
+            TextureInfo const& info,
+            MipChainLayout const& layout,
+            size_t topMip,
+            DDS_LOADER_FLAGS loadFlags,
+            _COM_Outptr_ ID3D12Resource** texture) noexcept
+        {
+            if (!texture)
+                return E_POINTER;
+
+            *texture = nullptr;
+
+            auto const& top = layout.GetMip(topMip);
+
+            DXGI_FORMAT format = info.format;
+            if (loadFlags & DDS_LOADER_FORCE_SRGB)
+            {
+                format = LoaderHelpers::MakeSRGB(format);
+            }
+            else if (loadFlags & DDS_LOADER_IGNORE_SRGB)
+            {
+                format = LoaderHelpers::MakeLinear(format);
+            }
+
+            D3D12_RESOURCE_DESC desc = {};
+            desc.Width = top.width;
+            desc.Height = top.height;
+            desc.MipLevels = static_cast<UINT16>(info.mipCount - topMip);
+            desc.DepthOrArraySize = (info.resDim == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? static_cast<UINT16>(top.depth) : static_cast<UINT16>(info.arraySize);
+            desc.Format = format;
+            desc.SampleDesc.Count = 1;
+            desc.Dimension = info.resDim;
+
+            const CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+
+            return device->CreateCommittedResource(
+                &defaultHeapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                c_initialCopyTargetState,
+                nullptr,
+                IID_GRAPHICS_PPV_ARGS(texture));
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Reads mips [firstMip, firstMip + mipCount) of every array slice into one buffer,
+        // expanding legacy 24bpp data as the loaders do
+        //--------------------------------------------------------------------------------------
+        inline HRESULT ReadMips(
+            HANDLE hFile,
+            TextureInfo const& info,
+            MipChainLayout const& layout,
+            size_t firstMip,
+            size_t mipCount,
+            std::unique_ptr<uint8_t[]>& data) noexcept
+        {
+            const uint64_t totalBytes = GetLoadedBytes(info, layout.GetBytes(firstMip, mipCount));
+            if (totalBytes > SIZE_MAX)
+                return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+            data.reset(new (std::nothrow) uint8_t[static_cast<size_t>(totalBytes)]);
+            if (!data)
+                return E_OUTOFMEMORY;
+
+            std::unique_ptr<uint8_t[]> packed;
+            if (info.expandRGB24)
+            {
+                packed.reset(new (std::nothrow) uint8_t[static_cast<size_t>(layout.GetRange(0, firstMip, mipCount).size)]);
+                if (!packed)
+                    return E_OUTOFMEMORY;
+            }
+
+            // One contiguous read per array slice.
+            uint8_t* dest = data.get();
+            for (size_t slice = 0; slice < layout.GetArraySize(); ++slice)
+            {
+                auto const bytes = layout.GetRange(slice, firstMip, mipCount);
+
+                HRESULT hr = ReadAt(hFile, bytes.offset, packed ? packed.get() : dest, bytes.size);
+                if (FAILED(hr))
+                    return hr;
+
+                if (packed)
+                {
+                    // Every surface is tightly packed, so the range converts as one run of pixels.
+                    PixelConversion::ConvertBGR24ToRGBA8(dest, packed.get(), static_cast<size_t>(bytes.size / 3));
+                }
+
+                dest += GetLoadedBytes(info, bytes.size);
+            }
+
+            return S_OK;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Uploads data from ReadMips into a texture created for mips [topMip, mipCount)
+        //--------------------------------------------------------------------------------------
+        inline void UploadMips(
+            ResourceUploadBatch& resourceUpload,
+            _In_ ID3D12Resource* resource,
+            TextureInfo const& info,
+            MipChainLayout const& layout,
+            size_t topMip,
+            size_t firstMip,
+            size_t mipCount,
+            _In_ const uint8_t* data)
+        {
+            const size_t resourceMips = layout.GetMipCount() - topMip;
+            const uint64_t firstOffset = layout.GetMip(firstMip).offset;
+            const uint64_t sliceBytes = GetLoadedBytes(info, layout.GetRange(0, firstMip, mipCount).size);
+
+            std::vector<D3D12_SUBRESOURCE_DATA> subresources(mipCount);
+            for (size_t slice = 0; slice < layout.GetArraySize(); ++slice)
+            {
+                const uint8_t* sliceData = data + slice * sliceBytes;
+
+                for (size_t j = 0; j < mipCount; ++j)
+                {
+                    auto const& mip = layout.GetMip(firstMip + j);
+
+                    subresources[j].pData = sliceData + GetLoadedBytes(info, mip.offset - firstOffset);
+                    subresources[j].RowPitch = static_cast<LONG_PTR>(GetLoadedBytes(info, mip.rowBytes));
+                    subresources[j].SlicePitch = static_cast<LONG_PTR>(GetLoadedBytes(info, mip.surfaceBytes));
+                }
+
+                const auto firstSubresource = D3D12CalcSubresource(
+                    static_cast<UINT>(firstMip - topMip), static_cast<UINT>(slice), 0u,
+                    static_cast<UINT>(resourceMips), static_cast<UINT>(layout.GetArraySize()));
+
+                resourceUpload.Upload(resource, firstSubresource, subresources.data(), static_cast<uint32_t>(mipCount));
+            }
+        }
+    }
+}
@@ -20,7 +20,10 @@
 #include "PlatformHelpers.h"
 #include "DDS.h"
 #include "DirectXHelpers.h"
+#include "DDSStreamingHelpers.h"
 #include "LoaderHelpers.h"
+#include "ParallelHelpers.h"
+#include "PixelConversion.h"
 #include "ResourceUploadBatch.h"
 
 using namespace DirectX;
@@ -111,11 +114,7 @@ namespace
     }
 
     //--------------------------------------------------------------------------------------
-    HRESULT FillInitData(_In_ size_t width,
-        _In_ size_t height,
-        _In_ size_t depth,
-        _In_ size_t mipCount,
-        _In_ size_t arraySize,
+    HRESULT FillInitData(const MipChainLayout& layout,
         _In_ size_t numberOfPlanes,
         _In_ DXGI_FORMAT format,
         _In_ size_t maxsize,
@@ -137,47 +136,42 @@ namespace
         theight = 0;
         tdepth = 0;
 
-        size_t NumBytes = 0;
-        size_t RowBytes = 0;
-        const uint8_t* pEndBits = bitData + bitSize;
-
         initData.clear();
 
-        for (size_t p = 0; p < numberOfPlanes; ++p)
+        if (layout.GetFileSize() > bitSize)
         {
-            const uint8_t* pSrcBits = bitData;
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+
+        const size_t mipCount = layout.GetMipCount();
 
-            for (size_t j = 0; j < arraySize; j++)
+        for (size_t p = 0; p < numberOfPlanes; ++p)
+        {
+            for (size_t j = 0; j < layout.GetArraySize(); j++)
             {
-                size_t w = width;
-                size_t h = height;
-                size_t d = depth;
+                const uint8_t* pSliceBits = bitData + layout.GetDataOffset() + j * layout.GetSliceStride();
+
                 for (size_t i = 0; i < mipCount; i++)
                 {
-                    HRESULT hr = GetSurfaceInfo(w, h, format, &NumBytes, &RowBytes, nullptr);
-                    if (FAILED(hr))
-                        return hr;
-
-                    if (NumBytes > UINT32_MAX || RowBytes > UINT32_MAX)
-                        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+                    auto const& mip = layout.GetMip(i);
 
-                    if ((mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize))
+                    if ((mipCount <= 1) || !maxsize || (mip.width <= maxsize && mip.height <= maxsize && mip.depth <= maxsize))
                     {
                         if (!twidth)
                         {
-                            twidth = w;
-                            theight = h;
-                            tdepth = d;
+                            twidth = mip.width;
+                            theight = mip.height;
+                            tdepth = mip.depth;
                         }
 
                         D3D12_SUBRESOURCE_DATA res =
                         {
-                            pSrcBits,
-                            static_cast<LONG_PTR>(RowBytes),
-                            static_cast<LONG_PTR>(NumBytes)
+                            pSliceBits + mip.offset,
+                            static_cast<LONG_PTR>(mip.rowBytes),
+                            static_cast<LONG_PTR>(mip.surfaceBytes)
                         };
 
-                        AdjustPlaneResource(format, h, p, res);
+                        AdjustPlaneResource(format, mip.height, p, res);
 
                         initData.emplace_back(res);
                     }
@@ -186,29 +180,6 @@ namespace
                         // Count number of skipped mipmaps (first item only)
                         ++skipMip;
                     }
-
-                    if (pSrcBits + (NumBytes*d) > pEndBits)
-                    {
-                        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                    }
-
-                    pSrcBits += NumBytes * d;
-
-                    w = w >> 1;
-                    h = h >> 1;
-                    d = d >> 1;
-                    if (w == 0)
-                    {
-                        w = 1;
-                    }
-                    if (h == 0)
-                    {
-                        h = 1;
-                    }
-                    if (d == 0)
-                    {
-                        d = 1;
-                    }
                 }
             }
         }
@@ -287,235 +258,21 @@ namespace
         std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
         _Out_opt_ bool* outIsCubeMap) noexcept(false)
     {
-        HRESULT hr = S_OK;
-
-        const UINT width = header->width;
-        UINT height = header->height;
-        UINT depth = header->depth;
-
-        D3D12_RESOURCE_DIMENSION resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
-        UINT arraySize = 1;
-        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-        bool isCubeMap = false;
-
-        size_t mipCount = header->mipMapCount;
-        if (0 == mipCount)
-        {
-            mipCount = 1;
-        }
-
-        if ((header->ddspf.flags & DDS_FOURCC) &&
-            (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
-        {
-            auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>(reinterpret_cast<const char*>(header) + sizeof(DDS_HEADER));
-
-            arraySize = d3d10ext->arraySize;
-            if (arraySize == 0)
-            {
-                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-            }
-
-            switch (d3d10ext->dxgiFormat)
-            {
-            case DXGI_FORMAT_NV12:
-            case DXGI_FORMAT_P010:
-            case DXGI_FORMAT_P016:
-            case DXGI_FORMAT_420_OPAQUE:
-                if ((d3d10ext->resourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
-                    || (width % 2) != 0 || (height % 2) != 0)
-                {
-                    DebugTrace("ERROR: Video texture does not meet width/height requirements.\n");
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-
-            case DXGI_FORMAT_YUY2:
-            case DXGI_FORMAT_Y210:
-            case DXGI_FORMAT_Y216:
-            case DXGI_FORMAT_P208:
-                if ((width % 2) != 0)
-                {
-                    DebugTrace("ERROR: Video texture does not meet width requirements.\n");
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-
-            case DXGI_FORMAT_NV11:
-                if ((width % 4) != 0)
-                {
-                    DebugTrace("ERROR: Video texture does not meet width requirements.\n");
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-
-            case DXGI_FORMAT_AI44:
-            case DXGI_FORMAT_IA44:
-            case DXGI_FORMAT_P8:
-            case DXGI_FORMAT_A8P8:
-                DebugTrace("ERROR: Legacy stream video texture formats are not supported by Direct3D.\n");
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
-            case DXGI_FORMAT_V208:
-                if ((d3d10ext->resourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
-                    || (height % 2) != 0)
-                {
-                    DebugTrace("ERROR: Video texture does not meet height requirements.\n");
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-
-            default:
-                if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
-                {
-                    DebugTrace("ERROR: Unknown DXGI format (%u)\n", static_cast<uint32_t>(d3d10ext->dxgiFormat));
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-            }
-
-            format = d3d10ext->dxgiFormat;
-
-            switch (d3d10ext->resourceDimension)
-            {
-            case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
-                // D3DX writes 1D textures with a fixed Height of 1
-                if ((header->flags & DDS_HEIGHT) && height != 1)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-                }
-                height = depth = 1;
-                break;
-
-            case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
-                if (d3d10ext->miscFlag & 0x4 /* RESOURCE_MISC_TEXTURECUBE */)
-                {
-                    arraySize *= 6;
-                    isCubeMap = true;
-                }
-                depth = 1;
-                break;
-
-            case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
-                if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
-                {
-                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-                }
-
-                if (arraySize > 1)
-                {
-                    DebugTrace("ERROR: Volume textures are not texture arrays\n");
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-
-            case D3D12_RESOURCE_DIMENSION_BUFFER:
-                DebugTrace("ERROR: Resource dimension buffer type not supported for textures\n");
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
-            case D3D12_RESOURCE_DIMENSION_UNKNOWN:
-            default:
-                DebugTrace("ERROR: Unknown resource dimension (%u)\n", static_cast<uint32_t>(d3d10ext->resourceDimension));
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-
-            resDim = static_cast<D3D12_RESOURCE_DIMENSION>(d3d10ext->resourceDimension);
-        }
-        else
-        {
-            format = GetDXGIFormat(header->ddspf);
-
-            if (format == DXGI_FORMAT_UNKNOWN)
-            {
-                DebugTrace("ERROR: DDSTextureLoader does not support all legacy DDS formats. Consider using DirectXTex.\n");
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-
-            if (header->flags & DDS_HEADER_FLAGS_VOLUME)
-            {
-                resDim = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
-            }
-            else
-            {
-                if (header->caps2 & DDS_CUBEMAP)
-                {
-                    // We require all six faces to be defined
-                    if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
-                    {
-                        DebugTrace("ERROR: DirectX 12 does not support partial cubemaps\n");
-                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                    }
-
-                    arraySize = 6;
-                    isCubeMap = true;
-                }
-
-                depth = 1;
-                resDim = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-
-                // Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
-            }
-
-            assert(BitsPerPixel(format) != 0);
-        }
-
-        // Bound sizes (for security purposes we don't trust DDS file metadata larger than the Direct3D hardware requirements)
-        if (mipCount > D3D12_REQ_MIP_LEVELS)
-        {
-            DebugTrace("ERROR: Too many mipmap levels defined for DirectX 12 (%zu).\n", mipCount);
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
-
-        switch (resDim)
-        {
-        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
-            if ((arraySize > D3D12_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION) ||
-                (width > D3D12_REQ_TEXTURE1D_U_DIMENSION))
-            {
-                DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (1D: array %u, size %u)\n", arraySize, width);
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-            break;
-
-        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
-            if (isCubeMap)
-            {
-                // This is the right bound because we set arraySize to (NumCubes*6) above
-                if ((arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
-                    (width > D3D12_REQ_TEXTURECUBE_DIMENSION) ||
-                    (height > D3D12_REQ_TEXTURECUBE_DIMENSION))
-                {
-                    DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (2D cubemap: array %u, size %u by %u)\n", arraySize, width, height);
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-            }
-            else if ((arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
-                (width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION) ||
-                (height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION))
-            {
-                DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (2D: array %u, size %u by %u)\n", arraySize, width, height);
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-            break;
+        DDSTextureInfo info = {};
+        HRESULT hr = GetDDSTextureInfo(header, info);
+        if (FAILED(hr))
+            return hr;
 
-        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
-            if ((arraySize > 1) ||
-                (width > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
-                (height > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
-                (depth > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION))
-            {
-                DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (3D: array %u, size %u by %u by %u)\n", arraySize, width, height, depth);
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-            break;
+        // The callers have already expanded legacy 24bpp data
+        if (info.expandRGB24)
+            return E_UNEXPECTED;
 
-        case D3D12_RESOURCE_DIMENSION_BUFFER:
-            DebugTrace("ERROR: Resource dimension buffer type not supported for textures\n");
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
-        default:
-            DebugTrace("ERROR: Unknown resource dimension (%u)\n", static_cast<uint32_t>(resDim));
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
+        const D3D12_RESOURCE_DIMENSION resDim = info.resDim;
+        const UINT width = info.width;
+        const UINT height = info.height;
+        const UINT arraySize = info.arraySize;
+        const size_t mipCount = info.mipCount;
+        const DXGI_FORMAT format = info.format;
 
         const UINT numberOfPlanes = D3D12GetFormatPlaneCount(d3dDevice, format);
         if (!numberOfPlanes)
@@ -529,7 +286,7 @@ namespace
 
         if (outIsCubeMap != nullptr)
         {
-            *outIsCubeMap = isCubeMap;
+            *outIsCubeMap = info.isCubeMap;
         }
 
         // Create the texture
@@ -543,12 +300,16 @@ namespace
 
         subresources.reserve(numberOfResources);
 
+        MipChainLayout layout;
+        hr = GetDDSLayout(info, 0, layout);
+        if (FAILED(hr))
+            return hr;
+
         size_t skipMip = 0;
         size_t twidth = 0;
         size_t theight = 0;
         size_t tdepth = 0;
-        hr = FillInitData(width, height, depth, mipCount, arraySize,
-            numberOfPlanes, format,
+        hr = FillInitData(layout, numberOfPlanes, format,
             maxsize, bitSize, bitData,
             twidth, theight, tdepth, skipMip, subresources);
 
@@ -573,8 +334,7 @@ namespace
                     ? D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION
                     : D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
 
-                hr = FillInitData(width, height, depth, mipCount, arraySize,
-                    numberOfPlanes, format,
+                hr = FillInitData(layout, numberOfPlanes, format,
                     maxsize, bitSize, bitData,
                     twidth, theight, tdepth, skipMip, subresources);
                 if (SUCCEEDED(hr))
@@ -627,6 +387,89 @@ namespace
         else
             return GetDXGIFormat(header->ddspf);
     }
+
+    //--------------------------------------------------------------------------------------
+    // Direct3D 12 has no 24bpp formats, so legacy D3DFMT_R8G8B8 files are expanded to
+    // R8G8B8A8 on load. The header is rewritten in the new copy of the file data, which is
+    // returned in expandedData. The file loaders pass the buffer holding ddsData, which is freed.
+    HRESULT ExpandLegacyRGB24(
+        const uint8_t* ddsData,
+        std::unique_ptr<uint8_t[]>& expandedData,
+        const DDS_HEADER** header,
+        const uint8_t** bitData,
+        size_t* bitSize) noexcept
+    {
+        if (!IsLegacyRGB24((*header)->ddspf))
+            return S_FALSE;
+
+        // Every surface is tightly packed, so the whole payload converts as one run of pixels.
+        const size_t headerSize = static_cast<size_t>(*bitData - ddsData);
+        const size_t pixelCount = *bitSize / 3;
+
+        if (pixelCount > ((SIZE_MAX - headerSize) / 4))
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        std::unique_ptr<uint8_t[]> expanded(new (std::nothrow) uint8_t[headerSize + pixelCount * 4]);
+        if (!expanded)
+            return E_OUTOFMEMORY;
+
+        memcpy(expanded.get(), ddsData, headerSize);
+        PixelConversion::ConvertBGR24ToRGBA8(expanded.get() + headerSize, *bitData, pixelCount);
+
+        auto newHeader = reinterpret_cast<DDS_HEADER*>(expanded.get() + (reinterpret_cast<const uint8_t*>(*header) - ddsData));
+        memcpy(&newHeader->ddspf, &DDSPF_A8B8G8R8, sizeof(DDS_PIXELFORMAT));
+        if (newHeader->flags & DDS_HEADER_FLAGS_PITCH)
+        {
+            newHeader->pitchOrLinearSize = newHeader->width * 4;
+        }
+
+        *header = newHeader;
+        *bitData = expanded.get() + headerSize;
+        *bitSize = pixelCount * 4;
+        expandedData = std::move(expanded);
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Describes the texture from its header alone. bitSize is the number of bytes which
+    // follow the header, and must hold every surface the header describes.
+    HRESULT GetMetadataFromHeader(
+        _In_ const DDS_HEADER* header,
+        uint64_t bitSize,
+        DDSMetadata& metadata) noexcept
+    {
+        metadata = {};
+
+        DDSTextureInfo info = {};
+        HRESULT hr = GetDDSTextureInfo(header, info);
+        if (FAILED(hr))
+            return hr;
+
+        // Legacy 24bpp files are described as the loaders create them, expanded to R8G8B8A8,
+        // but their layout is the one stored in the file.
+        MipChainLayout layout;
+        hr = GetDDSLayout(info, 0, layout);
+        if (FAILED(hr))
+            return hr;
+
+        const uint64_t dataSize = layout.GetFileSize();
+        if (dataSize > bitSize)
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+        metadata.dimension = info.resDim;
+        metadata.width = info.width;
+        metadata.height = info.height;
+        metadata.depth = info.depth;
+        metadata.arraySize = info.arraySize;
+        metadata.mipLevels = static_cast<uint32_t>(info.mipCount);
+        metadata.format = info.format;
+        metadata.alphaMode = GetAlphaMode(header);
+        metadata.isCubeMap = info.isCubeMap;
+        metadata.dataSize = dataSize;
+
+        return S_OK;
+    }
 } // anonymous namespace
 
 
@@ -669,6 +512,63 @@ HRESULT DirectX::LoadDDSTextureFromMemoryEx(
     DDS_ALPHA_MODE* alphaMode,
     bool* isCubeMap)
 {
+    // The subresources of an expanded legacy 24bpp file point into decoded data which this
+    // version has no way to return, so those files need the decodedData overload.
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
+    size_t bitSize = 0;
+    if (ddsData
+        && SUCCEEDED(LoadTextureDataFromMemory(ddsData, ddsDataSize, &header, &bitData, &bitSize))
+        && IsLegacyRGB24(header->ddspf))
+    {
+        DebugTrace("ERROR: LoadDDSTextureFromMemoryEx requires the decodedData overload for 24bpp DDS files\n");
+
+        if (texture)
+        {
+            *texture = nullptr;
+        }
+        if (alphaMode)
+        {
+            *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+        }
+        if (isCubeMap)
+        {
+            *isCubeMap = false;
+        }
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    std::unique_ptr<uint8_t[]> decodedData;
+    return LoadDDSTextureFromMemoryEx(
+        d3dDevice,
+        ddsData,
+        ddsDataSize,
+        maxsize,
+        resFlags,
+        loadFlags,
+        texture,
+        decodedData,
+        subresources,
+        alphaMode,
+        isCubeMap);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::LoadDDSTextureFromMemoryEx(
+    ID3D12Device* d3dDevice,
+    const uint8_t* ddsData,
+    size_t ddsDataSize,
+    size_t maxsize,
+    D3D12_RESOURCE_FLAGS resFlags,
+    DDS_LOADER_FLAGS loadFlags,
+    ID3D12Resource** texture,
+    std::unique_ptr<uint8_t[]>& decodedData,
+    std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+    DDS_ALPHA_MODE* alphaMode,
+    bool* isCubeMap)
+{
+    decodedData.reset();
+
     if (texture)
     {
         *texture = nullptr;
@@ -703,6 +603,12 @@ HRESULT DirectX::LoadDDSTextureFromMemoryEx(
         return hr;
     }
 
+    hr = ExpandLegacyRGB24(ddsData, decodedData, &header, &bitData, &bitSize);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     hr = CreateTextureFromDDS(d3dDevice,
         header, bitData, bitSize, maxsize,
         resFlags, loadFlags,
@@ -790,6 +696,12 @@ HRESULT DirectX::LoadDDSTextureFromFileEx(
         return hr;
     }
 
+    hr = ExpandLegacyRGB24(ddsData.get(), ddsData, &header, &bitData, &bitSize);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     hr = CreateTextureFromDDS(d3dDevice,
         header, bitData, bitSize, maxsize,
         resFlags, loadFlags,
@@ -880,6 +792,14 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx(
         return hr;
     }
 
+    // The expanded data only has to outlive the Upload call, which copies it.
+    std::unique_ptr<uint8_t[]> decodedData;
+    hr = ExpandLegacyRGB24(ddsData, decodedData, &header, &bitData, &bitSize);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     if (loadFlags & DDS_LOADER_MIP_AUTOGEN)
     {
         const DXGI_FORMAT fmt = GetPixelFormat(header);
@@ -1002,6 +922,12 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(
         return hr;
     }
 
+    hr = ExpandLegacyRGB24(ddsData.get(), ddsData, &header, &bitData, &bitSize);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     if (loadFlags & DDS_LOADER_MIP_AUTOGEN)
     {
         const DXGI_FORMAT fmt = GetPixelFormat(header);
@@ -1054,6 +980,110 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(
 }
 
 
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GetDDSMetadataFromMemory(
+    const uint8_t* ddsData,
+    size_t ddsDataSize,
+    DDSMetadata& metadata) noexcept
+{
+    metadata = {};
+
+    if (!ddsData)
+        return E_INVALIDARG;
+
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
+    size_t bitSize = 0;
+    HRESULT hr = LoadTextureDataFromMemory(ddsData, ddsDataSize, &header, &bitData, &bitSize);
+    if (FAILED(hr))
+        return hr;
+
+    return GetMetadataFromHeader(header, bitSize, metadata);
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GetDDSMetadataFromFile(
+    const wchar_t* fileName,
+    DDSMetadata& metadata) noexcept
+{
+    metadata = {};
+
+    if (!fileName)
+        return E_INVALIDARG;
+
+    ScopedHandle hFile;
+    HRESULT hr = StreamingHelpers::OpenFile(fileName, hFile);
+    if (FAILED(hr))
+        return hr;
+
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    const auto fileSize = static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart);
+
+    // Read no more than the largest possible header
+    uint8_t headerData[StreamingHelpers::c_maxHeaderSize] = {};
+    const auto headerSize = static_cast<size_t>(std::min<uint64_t>(fileSize, StreamingHelpers::c_maxHeaderSize));
+
+    hr = StreamingHelpers::ReadAt(hFile.get(), 0, headerData, headerSize);
+    if (FAILED(hr))
+        return hr;
+
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
+    size_t bitSize = 0;
+    hr = LoadTextureDataFromMemory(headerData, headerSize, &header, &bitData, &bitSize);
+    if (FAILED(hr))
+        return hr;
+
+    return GetMetadataFromHeader(header, fileSize - static_cast<uint64_t>(bitData - headerData), metadata);
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GetDDSMetadataFromFiles(
+    const wchar_t* const* fileNames,
+    size_t count,
+    DDSMetadata* metadata,
+    HRESULT* results) noexcept
+{
+    if (!count)
+        return S_OK;
+
+    if (!fileNames || !metadata || !results)
+        return E_INVALIDARG;
+
+    // Each scan is a couple of small reads, so batches are kept short to spread slow files across workers
+    constexpr size_t c_minFilesPerTask = 16;
+
+    try
+    {
+        ParallelHelpers::ParallelFor(count, c_minFilesPerTask, [&](size_t begin, size_t end) noexcept
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    results[i] = GetDDSMetadataFromFile(fileNames[i], metadata[i]);
+                }
+            });
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+    catch (...)
+    {
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Adapters for /Zc:wchar_t- clients
 
@@ -1123,6 +1153,26 @@ namespace DirectX
             reinterpret_cast<const unsigned short*>(szFileName),
             maxsize, resFlags, loadFlags, texture, alphaMode, isCubeMap);
     }
+
+    HRESULT __cdecl GetDDSMetadataFromFile(
+        _In_z_ const __wchar_t* szFileName,
+        _Out_ DDSMetadata& metadata) noexcept
+    {
+        return GetDDSMetadataFromFile(
+            reinterpret_cast<const unsigned short*>(szFileName),
+            metadata);
+    }
+
+    HRESULT __cdecl GetDDSMetadataFromFiles(
+        _In_reads_(count) const __wchar_t* const* szFileNames,
+        size_t count,
+        _Out_writes_(count) DDSMetadata* metadata,
+        _Out_writes_(count) HRESULT* results) noexcept
+    {
+        return GetDDSMetadataFromFiles(
+            reinterpret_cast<const unsigned short* const*>(szFileNames),
+            count, metadata, results);
+    }
 }
 
 #endif // !_NATIVE_WCHAR_T_DEFINED
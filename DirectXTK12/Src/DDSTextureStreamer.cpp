@@ -0,0 +1,573 @@
+//--------------------------------------------------------------------------------------
+// File: DDSTextureStreamer.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "DDSTextureStreamer.h"
+
+#include "DDSStreamingHelpers.h"
+
+#include <condition_variable>
+#include <queue>
+
+using namespace DirectX;
+using namespace DirectX::StreamingHelpers;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_headerJob = size_t(-1);
+}
+
+
+// Internal DDSTextureStreamer implementation class.
+class DDSTextureStreamer::Impl
+{
+public:
+    Impl(_In_ ID3D12Device* device, size_t ioThreads, uint64_t uploadBudget, uint64_t tailSize);
+
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
+
+    ~Impl();
+
+    size_t Load(_In_z_ const wchar_t* fileName, size_t maxsize, DDS_LOADER_FLAGS loadFlags);
+    uint64_t Update(ResourceUploadBatch& resourceUpload);
+
+    void CreateShaderResourceView(size_t texture, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const;
+
+    struct StreamingTexture
+    {
+        std::wstring fileName;
+        size_t maxsize;
+        DDS_LOADER_FLAGS loadFlags;
+
+        HRESULT status;
+        ScopedHandle file;
+        ComPtr<ID3D12Resource> resource;
+        TextureInfo info;
+        DDS_ALPHA_MODE alphaMode;
+        MipChainLayout layout;
+        size_t topMip;
+
+        // Chunks are read by any I/O thread, but uploaded strictly in order.
+        std::vector<MipChainLayout::MipRange> chunks;
+        std::vector<std::unique_ptr<uint8_t[]>> chunkData;
+        size_t pendingReads;
+        size_t nextUpload;
+        uint32_t residentMip;
+    };
+
+    StreamingTexture const& GetTexture(size_t texture) const
+    {
+        return *mTextures.at(texture);
+    }
+
+    ComPtr<ID3D12Device> mDevice;
+    uint64_t mUploadBudget;
+    uint64_t mTailSize;
+
+    mutable std::mutex mMutex;
+    std::vector<std::unique_ptr<StreamingTexture>> mTextures;
+
+private:
+    struct Job
+    {
+        size_t texture;
+        size_t chunk;
+        uint64_t sequence;
+
+        // Headers first, then coarser chunks before finer ones, then first come first served.
+        bool operator< (Job const& other) const noexcept
+        {
+            if (chunk != other.chunk)
+                return (chunk == c_headerJob) ? false : (other.chunk == c_headerJob) ? true : (chunk > other.chunk);
+
+            return sequence > other.sequence;
+        }
+    };
+
+    void WorkerThread();
+    HRESULT ReadHeader(StreamingTexture& texture);
+    HRESULT ReadChunk(StreamingTexture& texture, size_t chunk, std::unique_ptr<uint8_t[]>& data);
+    void FinishRead(StreamingTexture& texture) noexcept;
+    void UploadChunk(ResourceUploadBatch& resourceUpload, StreamingTexture& texture, size_t chunk, uint8_t const* data);
+
+    std::condition_variable mWorkAvailable;
+    std::priority_queue<Job> mJobs;
+    uint64_t mJobSequence;
+    bool mShutdown;
+    std::vector<std::future<void>> mWorkers;
+};
+
+
+DDSTextureStreamer::Impl::Impl(_In_ ID3D12Device* device, size_t ioThreads, uint64_t uploadBudget, uint64_t tailSize) :
+    mDevice(device),
+    mUploadBudget(uploadBudget),
+    mTailSize(tailSize),
+    mJobSequence(0),
+    mShutdown(false)
+{
+    if (!device)
+        throw std::invalid_argument("Direct3D device is null");
+
+    if (!ioThreads)
+        throw std::invalid_argument("ioThreads must be greater than 0");
+
+    mWorkers.reserve(ioThreads);
+    for (size_t j = 0; j < ioThreads; ++j)
+    {
+        mWorkers.emplace_back(std::async(std::launch::async, [this]() { WorkerThread(); }));
+    }
+}
+
+
+DDSTextureStreamer::Impl::~Impl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+
+    mWorkAvailable.notify_all();
+
+    for (auto& it : mWorkers)
+    {
+        it.wait();
+    }
+}
+
+
+size_t DDSTextureStreamer::Impl::Load(_In_z_ const wchar_t* fileName, size_t maxsize, DDS_LOADER_FLAGS loadFlags)
+{
+    if (!fileName)
+        throw std::invalid_argument("fileName is null");
+
+    auto texture = std::make_unique<StreamingTexture>();
+    texture->fileName = fileName;
+    texture->maxsize = maxsize;
+    texture->loadFlags = loadFlags;
+    texture->status = S_FALSE;
+    texture->info = {};
+    texture->alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    texture->topMip = 0;
+    texture->pendingReads = 0;
+    texture->nextUpload = 0;
+    texture->residentMip = 0;
+
+    size_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        index = mTextures.size();
+        mTextures.emplace_back(std::move(texture));
+        mJobs.push(Job{ index, c_headerJob, mJobSequence++ });
+    }
+
+    mWorkAvailable.notify_one();
+
+    return index;
+}
+
+
+void DDSTextureStreamer::Impl::WorkerThread()
+{
+    for (;;)
+    {
+        Job job;
+        StreamingTexture* texture = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWorkAvailable.wait(lock, [this]() { return mShutdown || !mJobs.empty(); });
+
+            if (mShutdown)
+                return;
+
+            job = mJobs.top();
+            mJobs.pop();
+
+            texture = mTextures[job.texture].get();
+            if (FAILED(texture->status))
+            {
+                if (job.chunk != c_headerJob)
+                {
+                    FinishRead(*texture);
+                }
+                continue;
+            }
+        }
+
+        // Texture entries are never removed, their layout is fixed before any chunk jobs are
+        // queued, and the file stays open until the last chunk job for the texture has finished,
+        // so no lock is needed for the I/O itself.
+        if (job.chunk == c_headerJob)
+        {
+            HRESULT hr = ReadHeader(*texture);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if (FAILED(hr))
+            {
+                // No chunk jobs exist yet, so nothing else is using the file.
+                texture->status = hr;
+                texture->file.reset();
+                continue;
+            }
+
+            texture->pendingReads = texture->chunks.size();
+            for (size_t j = 0; j < texture->chunks.size(); ++j)
+            {
+                mJobs.push(Job{ job.texture, j, mJobSequence++ });
+            }
+            mWorkAvailable.notify_all();
+        }
+        else
+        {
+            std::unique_ptr<uint8_t[]> data;
+            HRESULT hr = ReadChunk(*texture, job.chunk, data);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if (FAILED(hr))
+            {
+                texture->status = hr;
+            }
+            else
+            {
+                texture->chunkData[job.chunk] = std::move(data);
+            }
+
+            FinishRead(*texture);
+        }
+    }
+}
+
+
+HRESULT DDSTextureStreamer::Impl::ReadHeader(StreamingTexture& texture)
+{
+    HRESULT hr = OpenFile(texture.fileName.c_str(), texture.file);
+    if (FAILED(hr))
+        return hr;
+
+    TextureInfo info = {};
+    MipChainLayout layout;
+    DDS_ALPHA_MODE alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    hr = ReadLayout(texture.file.get(), mDevice.Get(), info, layout, alphaMode);
+    if (FAILED(hr))
+        return hr;
+
+    const size_t topMip = GetTopMip(layout, texture.maxsize);
+
+    ComPtr<ID3D12Resource> resource;
+    hr = CreateTexture(mDevice.Get(), info, layout, topMip, texture.loadFlags, resource.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    SetDebugObjectName(resource.Get(), L"DDSTextureStreamer");
+
+    auto chunks = layout.PlanCoarsestFirst(topMip, mTailSize);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    texture.resource = std::move(resource);
+    texture.info = info;
+    texture.alphaMode = alphaMode;
+    texture.layout = std::move(layout);
+    texture.topMip = topMip;
+    texture.chunks = std::move(chunks);
+    texture.chunkData.resize(texture.chunks.size());
+    texture.residentMip = static_cast<uint32_t>(info.mipCount - topMip);
+
+    return S_OK;
+}
+
+
+HRESULT DDSTextureStreamer::Impl::ReadChunk(StreamingTexture& texture, size_t chunk, std::unique_ptr<uint8_t[]>& data)
+{
+    auto const& range = texture.chunks[chunk];
+    return ReadMips(texture.file.get(), texture.info, texture.layout, range.firstMip, range.mipCount, data);
+}
+
+
+// Called with mMutex held when a chunk job has finished or was skipped. Other I/O threads may still
+// be reading from the file, so a failed texture only closes it once its last chunk job is done.
+void DDSTextureStreamer::Impl::FinishRead(StreamingTexture& texture) noexcept
+{
+    assert(texture.pendingReads > 0);
+    if (--texture.pendingReads == 0 && FAILED(texture.status))
+    {
+        texture.file.reset();
+    }
+}
+
+
+uint64_t DDSTextureStreamer::Impl::Update(ResourceUploadBatch& resourceUpload)
+{
+    struct Candidate
+    {
+        StreamingTexture* texture;
+        size_t chunk;
+        std::unique_ptr<uint8_t[]> data;
+    };
+
+    std::vector<Candidate> candidates;
+    uint64_t uploaded = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto& it : mTextures)
+        {
+            if (FAILED(it->status) || !it->resource || it->nextUpload >= it->chunks.size())
+                continue;
+
+            if (it->chunkData[it->nextUpload])
+            {
+                candidates.emplace_back(Candidate{ it.get(), it->nextUpload, nullptr });
+            }
+        }
+
+        // Coarsest data first across all textures, so every texture gets a usable version before any gets detail.
+        std::stable_sort(candidates.begin(), candidates.end(), [](Candidate const& a, Candidate const& b) noexcept
+            {
+                return a.chunk < b.chunk;
+            });
+
+        // Always allow one chunk, so a tail larger than the budget still gets through.
+        size_t count = 0;
+        for (; count < candidates.size(); ++count)
+        {
+            auto& candidate = candidates[count];
+            auto const& range = candidate.texture->chunks[candidate.chunk];
+
+            const uint64_t bytes = GetLoadedBytes(candidate.texture->info, candidate.texture->layout.GetBytes(range.firstMip, range.mipCount));
+            if (count > 0 && uploaded + bytes > mUploadBudget)
+                break;
+
+            uploaded += bytes;
+            candidate.data = std::move(candidate.texture->chunkData[candidate.chunk]);
+        }
+
+        candidates.resize(count);
+    }
+
+    for (auto& it : candidates)
+    {
+        UploadChunk(resourceUpload, *it.texture, it.chunk, it.data.get());
+        it.data.reset();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto& texture = *it.texture;
+        texture.residentMip = static_cast<uint32_t>(texture.chunks[it.chunk].firstMip - texture.topMip);
+        if (++texture.nextUpload == texture.chunks.size())
+        {
+            texture.status = S_OK;
+            texture.file.reset();
+        }
+    }
+
+    return uploaded;
+}
+
+
+void DDSTextureStreamer::Impl::UploadChunk(ResourceUploadBatch& resourceUpload, StreamingTexture& texture, size_t chunk, uint8_t const* data)
+{
+    auto const& range = texture.chunks[chunk];
+    auto resource = texture.resource.Get();
+
+    if (chunk > 0)
+    {
+        resourceUpload.Transition(resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+
+    UploadMips(resourceUpload, resource, texture.info, texture.layout, texture.topMip, range.firstMip, range.mipCount, data);
+
+    resourceUpload.Transition(resource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+
+void DDSTextureStreamer::Impl::CreateShaderResourceView(size_t texture, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const
+{
+    ComPtr<ID3D12Resource> resource;
+    UINT mostDetailedMip = 0;
+    bool isCubeMap = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto const& it = GetTexture(texture);
+        resource = it.resource;
+        mostDetailedMip = it.residentMip;
+        isCubeMap = it.info.isCubeMap;
+    }
+
+    if (!resource)
+        throw std::logic_error("DDSTextureStreamer texture has not been created yet");
+
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = resource->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *resource->GetDesc(&tmpDesc);
+#endif
+
+    // Nothing resident yet: view the coarsest mip, which will be valid once the first chunk arrives.
+    mostDetailedMip = std::min<UINT>(mostDetailedMip, desc.MipLevels - 1u);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = desc.Format;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+    const UINT mipLevels = static_cast<UINT>(-1);
+
+    switch (desc.Dimension)
+    {
+    case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+        if (desc.DepthOrArraySize > 1)
+        {
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1DARRAY;
+            srvDesc.Texture1DArray.MostDetailedMip = mostDetailedMip;
+            srvDesc.Texture1DArray.MipLevels = mipLevels;
+            srvDesc.Texture1DArray.ArraySize = static_cast<UINT>(desc.DepthOrArraySize);
+        }
+        else
+        {
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1D;
+            srvDesc.Texture1D.MostDetailedMip = mostDetailedMip;
+            srvDesc.Texture1D.MipLevels = mipLevels;
+        }
+        break;
+
+    case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+        if (isCubeMap)
+        {
+            if (desc.DepthOrArraySize > 6)
+            {
+                srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+                srvDesc.TextureCubeArray.MostDetailedMip = mostDetailedMip;
+                srvDesc.TextureCubeArray.MipLevels = mipLevels;
+                srvDesc.TextureCubeArray.NumCubes = static_cast<UINT>(desc.DepthOrArraySize / 6);
+            }
+            else
+            {
+                srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+                srvDesc.TextureCube.MostDetailedMip = mostDetailedMip;
+                srvDesc.TextureCube.MipLevels = mipLevels;
+            }
+        }
+        else if (desc.DepthOrArraySize > 1)
+        {
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+            srvDesc.Texture2DArray.MostDetailedMip = mostDetailedMip;
+            srvDesc.Texture2DArray.MipLevels = mipLevels;
+            srvDesc.Texture2DArray.ArraySize = static_cast<UINT>(desc.DepthOrArraySize);
+        }
+        else
+        {
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MostDetailedMip = mostDetailedMip;
+            srvDesc.Texture2D.MipLevels = mipLevels;
+        }
+        break;
+
+    default:
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+        srvDesc.Texture3D.MostDetailedMip = mostDetailedMip;
+        srvDesc.Texture3D.MipLevels = mipLevels;
+        break;
+    }
+
+    mDevice->CreateShaderResourceView(resource.Get(), &srvDesc, srvDescriptor);
+}
+
+
+// Public constructor.
+DDSTextureStreamer::DDSTextureStreamer(_In_ ID3D12Device* device, size_t ioThreads, uint64_t uploadBudget, uint64_t tailSize)
+    : pImpl(std::make_unique<Impl>(device, ioThreads, uploadBudget, tailSize))
+{
+}
+
+
+DDSTextureStreamer::DDSTextureStreamer(DDSTextureStreamer&&) noexcept = default;
+DDSTextureStreamer& DDSTextureStreamer::operator= (DDSTextureStreamer&&) noexcept = default;
+DDSTextureStreamer::~DDSTextureStreamer() = default;
+
+
+_Use_decl_annotations_
+size_t DDSTextureStreamer::Load(const wchar_t* fileName, size_t maxsize, DDS_LOADER_FLAGS loadFlags)
+{
+    return pImpl->Load(fileName, maxsize, loadFlags);
+}
+
+
+uint64_t DDSTextureStreamer::Update(ResourceUploadBatch& resourceUpload)
+{
+    return pImpl->Update(resourceUpload);
+}
+
+
+void DDSTextureStreamer::SetUploadBudget(uint64_t bytesPerFrame) noexcept
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    pImpl->mUploadBudget = bytesPerFrame;
+}
+
+
+uint64_t DDSTextureStreamer::GetUploadBudget() const noexcept
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->mUploadBudget;
+}
+
+
+HRESULT DDSTextureStreamer::GetStatus(size_t texture) const
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->GetTexture(texture).status;
+}
+
+
+ID3D12Resource* DDSTextureStreamer::GetResource(size_t texture) const
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->GetTexture(texture).resource.Get();
+}
+
+
+uint32_t DDSTextureStreamer::GetResidentMip(size_t texture) const
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->GetTexture(texture).residentMip;
+}
+
+
+bool DDSTextureStreamer::IsCubeMap(size_t texture) const
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->GetTexture(texture).info.isCubeMap;
+}
+
+
+DDS_ALPHA_MODE DDSTextureStreamer::GetAlphaMode(size_t texture) const
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->GetTexture(texture).alphaMode;
+}
+
+
+size_t DDSTextureStreamer::GetTextureCount() const noexcept
+{
+    std::lock_guard<std::mutex> lock(pImpl->mMutex);
+    return pImpl->mTextures.size();
+}
+
+
+void DDSTextureStreamer::CreateShaderResourceView(size_t texture, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const
+{
+    pImpl->CreateShaderResourceView(texture, srvDescriptor);
+}
@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------------------
+// File: DirtyPageTracker.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Tracks which fixed-size pages of a CPU-side array have been modified since the last
+    // upload, and turns them into coalesced copy ranges. Has no Direct3D dependencies, so
+    // the bookkeeping can be exercised without a device.
+    class DirtyPageTracker
+    {
+    public:
+        // If more than fullUpdateThreshold (0..1) of the pages in use are dirty, a single full range is reported instead.
+        DirtyPageTracker(size_t itemCount, size_t itemsPerPage, float fullUpdateThreshold) :
+            mItemsPerPage(itemsPerPage),
+            mFullUpdateThreshold(fullUpdateThreshold),
+            mDirtyPageCount(0)
+        {
+            if (!itemsPerPage)
+                throw std::invalid_argument("itemsPerPage must be greater than 0");
+
+            if (!(fullUpdateThreshold >= 0.f && fullUpdateThreshold <= 1.f))
+                throw std::invalid_argument("fullUpdateThreshold must be between 0 and 1");
+
+            mDirty.resize((itemCount + itemsPerPage - 1) / itemsPerPage, 0);
+        }
+
+        DirtyPageTracker(DirtyPageTracker&&) = default;
+        DirtyPageTracker& operator= (DirtyPageTracker&&) = default;
+
+        DirtyPageTracker(DirtyPageTracker const&) = default;
+        DirtyPageTracker& operator= (DirtyPageTracker const&) = default;
+
+        void MarkDirty(size_t firstItem, size_t itemCount)
+        {
+            if (!itemCount)
+                return;
+
+            const size_t firstPage = firstItem / mItemsPerPage;
+            const size_t lastPage = (firstItem + itemCount - 1) / mItemsPerPage;
+
+            if (lastPage >= mDirty.size())
+                throw std::out_of_range("DirtyPageTracker::MarkDirty");
+
+            for (size_t page = firstPage; page <= lastPage; ++page)
+            {
+                if (!mDirty[page])
+                {
+                    mDirty[page] = 1;
+                    ++mDirtyPageCount;
+                }
+            }
+        }
+
+        void MarkAllDirty() noexcept
+        {
+            std::fill(mDirty.begin(), mDirty.end(), uint8_t(1));
+            mDirtyPageCount = mDirty.size();
+        }
+
+        void Clear() noexcept
+        {
+            if (mDirtyPageCount)
+            {
+                std::fill(mDirty.begin(), mDirty.end(), uint8_t(0));
+                mDirtyPageCount = 0;
+            }
+        }
+
+        bool IsDirty() const noexcept { return mDirtyPageCount != 0; }
+        size_t GetDirtyPageCount() const noexcept { return mDirtyPageCount; }
+        size_t GetPageCount() const noexcept { return mDirty.size(); }
+        size_t GetItemsPerPage() const noexcept { return mItemsPerPage; }
+
+        // True if the dirty pages within the first usedItems exceed the full update threshold.
+        bool IsFullUpdate(size_t usedItems) const noexcept
+        {
+            const size_t usedPages = std::min((usedItems + mItemsPerPage - 1) / mItemsPerPage, mDirty.size());
+            if (!usedPages)
+                return false;
+
+            size_t dirtyPages = mDirtyPageCount;
+            if (usedPages < mDirty.size())
+            {
+                dirtyPages = 0;
+                for (size_t page = 0; page < usedPages; ++page)
+                {
+                    dirtyPages += mDirty[page];
+                }
+            }
+
+            return float(dirtyPages) > mFullUpdateThreshold * float(usedPages);
+        }
+
+        // Invokes func(firstItem, itemCount) for each run of adjacent dirty pages, clipped to the first usedItems.
+        // Returns the total number of items covered.
+        template<typename TFunc>
+        size_t ForEachRange(size_t usedItems, TFunc&& func) const
+        {
+            if (!mDirtyPageCount || !usedItems)
+                return 0;
+
+            if (IsFullUpdate(usedItems))
+            {
+                func(size_t(0), usedItems);
+                return usedItems;
+            }
+
+            const size_t usedPages = std::min((usedItems + mItemsPerPage - 1) / mItemsPerPage, mDirty.size());
+
+            size_t total = 0;
+            size_t page = 0;
+            while (page < usedPages)
+            {
+                if (!mDirty[page])
+                {
+                    ++page;
+                    continue;
+                }
+
+                const size_t firstPage = page;
+                while (page < usedPages && mDirty[page])
+                {
+                    ++page;
+                }
+
+                const size_t firstItem = firstPage * mItemsPerPage;
+                const size_t lastItem = std::min(page * mItemsPerPage, usedItems);
+
+                func(firstItem, lastItem - firstItem);
+                total += lastItem - firstItem;
+            }
+
+            return total;
+        }
+
+    private:
+        size_t                  mItemsPerPage;
+        float                   mFullUpdateThreshold;
+        size_t                  mDirtyPageCount;
+        std::vector<uint8_t>    mDirty;
+    };
+}
@@ -10,9 +10,11 @@
 #include "pch.h"
 
 #include "Effects.h"
+#include "BinaryReader.h"
 #include "DirectXHelpers.h"
 #include "DDSTextureLoader.h"
 #include "DescriptorHeap.h"
+#include "ParallelHelpers.h"
 #include "PlatformHelpers.h"
 #include "ResourceUploadBatch.h"
 #include "WICTextureLoader.h"
@@ -24,6 +26,107 @@ using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
 
+namespace
+{
+    constexpr uint64_t c_prime1 = 11400714785074694791ULL;
+    constexpr uint64_t c_prime2 = 14029467366897019727ULL;
+    constexpr uint64_t c_prime3 = 1609587929392839161ULL;
+    constexpr uint64_t c_prime4 = 9650029242287828579ULL;
+    constexpr uint64_t c_prime5 = 2870177450012600261ULL;
+
+    inline uint64_t RotateLeft(uint64_t value, int shift) noexcept
+    {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    inline uint64_t Read64(const uint8_t* ptr) noexcept
+    {
+        uint64_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t HashRound(uint64_t acc, uint64_t input) noexcept
+    {
+        acc += input * c_prime2;
+        acc = RotateLeft(acc, 31);
+        return acc * c_prime1;
+    }
+
+    inline uint64_t HashMerge(uint64_t acc, uint64_t lane) noexcept
+    {
+        acc ^= HashRound(0, lane);
+        return acc * c_prime1 + c_prime4;
+    }
+
+    // xxHash64 (seed 0) of the file contents. Four independent lanes over 32-byte stripes keep it
+    // close to memory bandwidth. Collisions between different files are vanishingly unlikely, but
+    // as it is not cryptographic, matches are also required to have the same size.
+    uint64_t ComputeContentHash(_In_reads_bytes_(size) const uint8_t* data, size_t size) noexcept
+    {
+        const uint8_t* ptr = data;
+        const uint8_t* end = data + size;
+
+        uint64_t hash;
+        if (size >= 32)
+        {
+            uint64_t v1 = c_prime1 + c_prime2;
+            uint64_t v2 = c_prime2;
+            uint64_t v3 = 0;
+            uint64_t v4 = 0 - c_prime1;
+
+            for (; ptr + 32 <= end; ptr += 32)
+            {
+                v1 = HashRound(v1, Read64(ptr));
+                v2 = HashRound(v2, Read64(ptr + 8));
+                v3 = HashRound(v3, Read64(ptr + 16));
+                v4 = HashRound(v4, Read64(ptr + 24));
+            }
+
+            hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+            hash = HashMerge(hash, v1);
+            hash = HashMerge(hash, v2);
+            hash = HashMerge(hash, v3);
+            hash = HashMerge(hash, v4);
+        }
+        else
+        {
+            hash = c_prime5;
+        }
+
+        hash += static_cast<uint64_t>(size);
+
+        for (; ptr + 8 <= end; ptr += 8)
+        {
+            hash ^= HashRound(0, Read64(ptr));
+            hash = RotateLeft(hash, 27) * c_prime1 + c_prime4;
+        }
+
+        if (ptr + 4 <= end)
+        {
+            uint32_t value;
+            memcpy(&value, ptr, sizeof(value));
+            hash ^= static_cast<uint64_t>(value) * c_prime1;
+            hash = RotateLeft(hash, 23) * c_prime2 + c_prime3;
+            ptr += 4;
+        }
+
+        for (; ptr < end; ++ptr)
+        {
+            hash ^= static_cast<uint64_t>(*ptr) * c_prime5;
+            hash = RotateLeft(hash, 11) * c_prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= c_prime2;
+        hash ^= hash >> 29;
+        hash *= c_prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+}
+
+
 class EffectTextureFactory::Impl
 {
 public:
@@ -38,6 +141,10 @@ public:
 
     using TextureCache = std::map< std::wstring, TextureCacheEntry >;
 
+    // File contents hash, file size, and load flags, mapping to a slot in mResources
+    using ContentKey = std::tuple<uint64_t, size_t, uint32_t>;
+    using ContentCache = std::map< ContentKey, size_t >;
+
     Impl(
         _In_ ID3D12Device* device,
         ResourceUploadBatch& resourceUploadBatch,
@@ -46,7 +153,9 @@ public:
         , mTextureDescriptorHeap(descriptorHeap)
         , mDevice(device)
         , mResourceUploadBatch(resourceUploadBatch)
+        , mStatistics{}
         , mSharing(true)
+        , mContentSharing(false)
         , mForceSRGB(false)
         , mAutoGenMips(false)
     {
@@ -62,7 +171,9 @@ public:
         , mTextureDescriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, descriptorHeapFlags, numDescriptors)
         , mDevice(device)
         , mResourceUploadBatch(resourceUploadBatch)
+        , mStatistics{}
         , mSharing(true)
+        , mContentSharing(false)
         , mForceSRGB(false)
         , mAutoGenMips(false)
     {
@@ -70,24 +181,66 @@ public:
     }
 
     size_t CreateTexture(_In_z_ const wchar_t* name, int descriptorSlot);
+    void CreateTextures(_In_reads_(count) const wchar_t* const* names, size_t count, int descriptorOffset, _Out_writes_opt_(count) size_t* slots);
 
     void ReleaseCache();
     void SetSharing(bool enabled) noexcept { mSharing = enabled; }
+    void SetContentSharing(bool enabled) noexcept { mContentSharing = enabled; }
     void EnableForceSRGB(bool forceSRGB) noexcept { mForceSRGB = forceSRGB; }
     void EnableAutoGenMips(bool generateMips) noexcept { mAutoGenMips = generateMips; }
 
+    EffectTextureFactoryStatistics GetStatistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return mStatistics;
+    }
+
+    void ResetStatistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mStatistics = {};
+    }
+
     wchar_t mPath[MAX_PATH];
 
     ::DescriptorHeap               mTextureDescriptorHeap;
     std::vector<TextureCacheEntry> mResources; // flat list of unique resources so we can index into it
 
 private:
+    void FindTexture(_In_z_ const wchar_t* name, wchar_t (&fullName)[MAX_PATH]) const;
+
+    DDS_LOADER_FLAGS GetLoadFlags() const noexcept;
+
+    static ContentKey ReadContents(
+        _In_z_ const wchar_t* fullName,
+        DDS_LOADER_FLAGS loadFlags,
+        std::unique_ptr<uint8_t[]>& data,
+        size_t& dataSize);
+
+    void LoadTexture(
+        _In_z_ const wchar_t* fullName,
+        _In_reads_bytes_opt_(dataSize) const uint8_t* data,
+        size_t dataSize,
+        DDS_LOADER_FLAGS loadFlags,
+        TextureCacheEntry& textureEntry);
+
+    HRESULT LoadTextureConcurrent(
+        _In_z_ const wchar_t* fullName,
+        _In_reads_bytes_opt_(dataSize) const uint8_t* data,
+        size_t dataSize,
+        DDS_LOADER_FLAGS loadFlags,
+        TextureCacheEntry& textureEntry);
+
     ComPtr<ID3D12Device>           mDevice;
     ResourceUploadBatch&           mResourceUploadBatch;
 
     TextureCache                   mTextureCache;
+    ContentCache                   mContentCache;
+
+    EffectTextureFactoryStatistics mStatistics;
 
     bool                           mSharing;
+    bool                           mContentSharing;
     bool                           mForceSRGB;
     bool                           mAutoGenMips;
 
@@ -108,38 +261,344 @@ size_t EffectTextureFactory::Impl::CreateTexture(_In_z_ const wchar_t* name, int
     if (mSharing && it != mTextureCache.end())
     {
         textureEntry = it->second;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++mStatistics.nameMatches;
     }
     else
     {
         wchar_t fullName[MAX_PATH] = {};
-        wcscpy_s(fullName, mPath);
-        wcscat_s(fullName, name);
+        FindTexture(name, fullName);
 
-        WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
-        if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+        const DDS_LOADER_FLAGS loadFlags = GetLoadFlags();
+
+        if (mSharing && mContentSharing)
         {
-            // Try Current Working Directory (CWD)
-            wcscpy_s(fullName, name);
-            if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+            std::unique_ptr<uint8_t[]> data;
+            size_t dataSize = 0;
+            const ContentKey key = ReadContents(fullName, loadFlags, data, dataSize);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto cit = mContentCache.find(key);
+                if (cit != mContentCache.end())
+                {
+                    textureEntry = mResources[cit->second];
+                    mTextureCache.insert(TextureCache::value_type(name, textureEntry));
+                    ++mStatistics.contentMatches;
+                    mStatistics.bytesSaved += dataSize;
+                }
+            }
+
+            if (!textureEntry.mResource)
+            {
+                LoadTexture(fullName, data.get(), dataSize, loadFlags, textureEntry);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                textureEntry.slot = mResources.size();
+                mTextureCache.insert(TextureCache::value_type(name, textureEntry));
+                mContentCache.insert(ContentCache::value_type(key, textureEntry.slot));
+                mResources.push_back(textureEntry);
+                ++mStatistics.texturesCreated;
+            }
+        }
+        else
+        {
+            LoadTexture(fullName, nullptr, 0, loadFlags, textureEntry);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            textureEntry.slot = mResources.size();
+            if (mSharing)
             {
-                DebugTrace("ERROR: EffectTextureFactory could not find texture file '%ls'\n", name);
-                throw std::runtime_error("EffectTextureFactory::CreateTexture");
+                TextureCache::value_type v(name, textureEntry);
+                mTextureCache.insert(v);
             }
+            mResources.push_back(textureEntry);
+            ++mStatistics.texturesCreated;
         }
+    }
 
-        wchar_t ext[_MAX_EXT] = {};
-        _wsplitpath_s(name, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
-        const bool isdds = _wcsicmp(ext, L".dds") == 0;
+    assert(textureEntry.mResource != nullptr);
 
-        DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT;
-        if (mForceSRGB)
-            loadFlags |= DDS_LOADER_FORCE_SRGB;
-        if (mAutoGenMips)
-            loadFlags |= DDS_LOADER_MIP_AUTOGEN;
+    // bind a new descriptor in slot
+    auto const textureDescriptor = mTextureDescriptorHeap.GetCpuHandle(static_cast<size_t>(descriptorSlot));
+    DirectX::CreateShaderResourceView(mDevice.Get(), textureEntry.mResource.Get(), textureDescriptor, textureEntry.mIsCubeMap);
+
+    return textureEntry.slot;
+}
 
-        if (isdds)
+_Use_decl_annotations_
+void EffectTextureFactory::Impl::CreateTextures(const wchar_t* const* names, size_t count, int descriptorOffset, size_t* slots)
+{
+    if (!count)
+        return;
+
+    if (!names)
+        throw std::invalid_argument("names required for CreateTextures");
+
+    struct PendingTexture
+    {
+        const wchar_t* name;
+        wchar_t fullName[MAX_PATH];
+        std::unique_ptr<uint8_t[]> data;
+        size_t dataSize;
+        ContentKey key;
+        TextureCacheEntry entry;
+        size_t duplicateOf;
+        bool cached;
+    };
+
+    const DDS_LOADER_FLAGS loadFlags = GetLoadFlags();
+    const bool contentSharing = mSharing && mContentSharing;
+
+    // Resolve names which are already cached, and collect each distinct name which is not
+    std::vector<TextureCacheEntry> entries(count);
+    std::vector<size_t> sources(count, SIZE_MAX);
+    std::vector<PendingTexture> pending;
+    {
+        std::map<std::wstring, size_t> batchNames;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!names[i])
+                throw std::invalid_argument("name required for CreateTextures");
+
+            if (mSharing)
+            {
+                auto it = mTextureCache.find(names[i]);
+                if (it != mTextureCache.end())
+                {
+                    entries[i] = it->second;
+                    ++mStatistics.nameMatches;
+                    continue;
+                }
+
+                auto bit = batchNames.find(names[i]);
+                if (bit != batchNames.end())
+                {
+                    sources[i] = bit->second;
+                    ++mStatistics.nameMatches;
+                    continue;
+                }
+
+                batchNames.emplace(names[i], pending.size());
+            }
+
+            sources[i] = pending.size();
+
+            PendingTexture texture = {};
+            texture.name = names[i];
+            texture.duplicateOf = SIZE_MAX;
+            pending.emplace_back(std::move(texture));
+        }
+    }
+
+    // Find the files, and read and hash them if they can be shared by content
+    ParallelHelpers::ParallelForEach(pending.size(), [&](size_t index)
+        {
+            auto& texture = pending[index];
+            FindTexture(texture.name, texture.fullName);
+
+            if (contentSharing)
+            {
+                texture.key = ReadContents(texture.fullName, loadFlags, texture.data, texture.dataSize);
+            }
+        });
+
+    if (contentSharing)
+    {
+        std::map<ContentKey, size_t> batchContent;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t j = 0; j < pending.size(); ++j)
+        {
+            auto& texture = pending[j];
+
+            auto cit = mContentCache.find(texture.key);
+            if (cit != mContentCache.end())
+            {
+                texture.entry = mResources[cit->second];
+                texture.cached = true;
+            }
+            else
+            {
+                auto bit = batchContent.find(texture.key);
+                if (bit == batchContent.end())
+                {
+                    batchContent.emplace(texture.key, j);
+                    continue;
+                }
+
+                texture.duplicateOf = bit->second;
+            }
+
+            ++mStatistics.contentMatches;
+            mStatistics.bytesSaved += texture.dataSize;
+            texture.data.reset();
+        }
+    }
+
+    // Load and decode the rest in parallel
+    ParallelHelpers::ParallelForEach(pending.size(), [&](size_t index)
+        {
+            auto& texture = pending[index];
+            if (texture.cached || texture.duplicateOf != SIZE_MAX)
+                return;
+
+            // Runs on a worker thread, which needs COM for WIC.
+            const HRESULT hrInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+            HRESULT hr = E_FAIL;
+            try
+            {
+                hr = LoadTextureConcurrent(texture.fullName, texture.data.get(), texture.dataSize, loadFlags, texture.entry);
+            }
+            catch (...)
+            {
+                if (SUCCEEDED(hrInit))
+                {
+                    CoUninitialize();
+                }
+                throw;
+            }
+
+            if (SUCCEEDED(hrInit))
+            {
+                CoUninitialize();
+            }
+
+            texture.data.reset();
+
+            if (FAILED(hr))
+            {
+                DebugTrace("ERROR: EffectTextureFactory failed (%08X) to load '%ls'\n",
+                    static_cast<unsigned int>(hr), texture.fullName);
+                throw std::runtime_error("EffectTextureFactory::CreateTextures");
+            }
+        });
+
+    // Assign slots in the order of the names, so they don't depend on which load finished first
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& texture : pending)
+        {
+            if (texture.duplicateOf != SIZE_MAX)
+            {
+                texture.entry = pending[texture.duplicateOf].entry;
+            }
+            else if (!texture.cached)
+            {
+                texture.entry.slot = mResources.size();
+                mResources.push_back(texture.entry);
+                ++mStatistics.texturesCreated;
+
+                if (contentSharing)
+                {
+                    mContentCache.insert(ContentCache::value_type(texture.key, texture.entry.slot));
+                }
+            }
+
+            if (mSharing)
+            {
+                mTextureCache.insert(TextureCache::value_type(texture.name, texture.entry));
+            }
+        }
+    }
+
+    // bind the descriptors
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const& textureEntry = (sources[i] != SIZE_MAX) ? pending[sources[i]].entry : entries[i];
+        assert(textureEntry.mResource != nullptr);
+
+        auto const textureDescriptor = mTextureDescriptorHeap.GetCpuHandle(static_cast<size_t>(descriptorOffset) + i);
+        DirectX::CreateShaderResourceView(mDevice.Get(), textureEntry.mResource.Get(), textureDescriptor, textureEntry.mIsCubeMap);
+
+        if (slots)
         {
-            HRESULT hr = CreateDDSTextureFromFileEx(
+            slots[i] = textureEntry.slot;
+        }
+    }
+}
+
+// Looks for the file in the texture directory, then in the current working directory.
+_Use_decl_annotations_
+void EffectTextureFactory::Impl::FindTexture(const wchar_t* name, wchar_t (&fullName)[MAX_PATH]) const
+{
+    wcscpy_s(fullName, mPath);
+    wcscat_s(fullName, name);
+
+    WIN32_FILE_ATTRIBUTE_DATA fileAttr = {};
+    if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+    {
+        // Try Current Working Directory (CWD)
+        wcscpy_s(fullName, name);
+        if (!GetFileAttributesExW(fullName, GetFileExInfoStandard, &fileAttr))
+        {
+            DebugTrace("ERROR: EffectTextureFactory could not find texture file '%ls'\n", name);
+            throw std::runtime_error("EffectTextureFactory::CreateTexture");
+        }
+    }
+}
+
+DDS_LOADER_FLAGS EffectTextureFactory::Impl::GetLoadFlags() const noexcept
+{
+    DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT;
+    if (mForceSRGB)
+        loadFlags |= DDS_LOADER_FORCE_SRGB;
+    if (mAutoGenMips)
+        loadFlags |= DDS_LOADER_MIP_AUTOGEN;
+    return loadFlags;
+}
+
+// Reads the whole file and returns the key which identifies its contents.
+_Use_decl_annotations_
+EffectTextureFactory::Impl::ContentKey EffectTextureFactory::Impl::ReadContents(
+    const wchar_t* fullName,
+    DDS_LOADER_FLAGS loadFlags,
+    std::unique_ptr<uint8_t[]>& data,
+    size_t& dataSize)
+{
+    HRESULT hr = BinaryReader::ReadEntireFile(fullName, data, &dataSize);
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: EffectTextureFactory could not read texture file '%ls' (%08X)\n",
+            fullName, static_cast<unsigned int>(hr));
+        throw std::runtime_error("EffectTextureFactory::CreateTexture");
+    }
+
+    return ContentKey(ComputeContentHash(data.get(), dataSize), dataSize, static_cast<uint32_t>(loadFlags));
+}
+
+// Creates the texture from the file, or from its contents if they have already been read.
+_Use_decl_annotations_
+void EffectTextureFactory::Impl::LoadTexture(
+    const wchar_t* fullName,
+    const uint8_t* data,
+    size_t dataSize,
+    DDS_LOADER_FLAGS loadFlags,
+    TextureCacheEntry& textureEntry)
+{
+    wchar_t ext[_MAX_EXT] = {};
+    _wsplitpath_s(fullName, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+    const bool isdds = _wcsicmp(ext, L".dds") == 0;
+
+    if (isdds)
+    {
+        HRESULT hr = (data)
+            ? CreateDDSTextureFromMemoryEx(
+                mDevice.Get(),
+                mResourceUploadBatch,
+                data,
+                dataSize,
+                0u,
+                D3D12_RESOURCE_FLAG_NONE,
+                loadFlags,
+                textureEntry.mResource.ReleaseAndGetAddressOf(),
+                nullptr,
+                &textureEntry.mIsCubeMap)
+            : CreateDDSTextureFromFileEx(
                 mDevice.Get(),
                 mResourceUploadBatch,
                 fullName,
@@ -149,23 +608,33 @@ size_t EffectTextureFactory::Impl::CreateTexture(_In_z_ const wchar_t* name, int
                 textureEntry.mResource.ReleaseAndGetAddressOf(),
                 nullptr,
                 &textureEntry.mIsCubeMap);
-            if (FAILED(hr))
-            {
-                DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectTextureFactory::CreateDDSTextureFromFile");
-            }
-        }
-        else
+        if (FAILED(hr))
         {
-            static_assert(static_cast<int>(DDS_LOADER_DEFAULT) == static_cast<int>(WIC_LOADER_DEFAULT), "DDS/WIC Load flags mismatch");
-            static_assert(static_cast<int>(DDS_LOADER_FORCE_SRGB) == static_cast<int>(WIC_LOADER_FORCE_SRGB), "DDS/WIC Load flags mismatch");
-            static_assert(static_cast<int>(DDS_LOADER_MIP_AUTOGEN) == static_cast<int>(WIC_LOADER_MIP_AUTOGEN), "DDS/WIC Load flags mismatch");
-            static_assert(static_cast<int>(DDS_LOADER_MIP_RESERVE) == static_cast<int>(WIC_LOADER_MIP_RESERVE), "DDS/WIC Load flags mismatch");
+            DebugTrace("ERROR: CreateDDSTextureFromFile failed (%08X) for '%ls'\n",
+                static_cast<unsigned int>(hr), fullName);
+            throw std::runtime_error("EffectTextureFactory::CreateDDSTextureFromFile");
+        }
+    }
+    else
+    {
+        static_assert(static_cast<int>(DDS_LOADER_DEFAULT) == static_cast<int>(WIC_LOADER_DEFAULT), "DDS/WIC Load flags mismatch");
+        static_assert(static_cast<int>(DDS_LOADER_FORCE_SRGB) == static_cast<int>(WIC_LOADER_FORCE_SRGB), "DDS/WIC Load flags mismatch");
+        static_assert(static_cast<int>(DDS_LOADER_MIP_AUTOGEN) == static_cast<int>(WIC_LOADER_MIP_AUTOGEN), "DDS/WIC Load flags mismatch");
+        static_assert(static_cast<int>(DDS_LOADER_MIP_RESERVE) == static_cast<int>(WIC_LOADER_MIP_RESERVE), "DDS/WIC Load flags mismatch");
 
-            textureEntry.mIsCubeMap = false;
+        textureEntry.mIsCubeMap = false;
 
-            HRESULT hr = CreateWICTextureFromFileEx(
+        HRESULT hr = (data)
+            ? CreateWICTextureFromMemoryEx(
+                mDevice.Get(),
+                mResourceUploadBatch,
+                data,
+                dataSize,
+                0u,
+                D3D12_RESOURCE_FLAG_NONE,
+                static_cast<WIC_LOADER_FLAGS>(loadFlags),
+                textureEntry.mResource.ReleaseAndGetAddressOf())
+            : CreateWICTextureFromFileEx(
                 mDevice.Get(),
                 mResourceUploadBatch,
                 fullName,
@@ -173,41 +642,211 @@ size_t EffectTextureFactory::Impl::CreateTexture(_In_z_ const wchar_t* name, int
                 D3D12_RESOURCE_FLAG_NONE,
                 static_cast<WIC_LOADER_FLAGS>(loadFlags),
                 textureEntry.mResource.ReleaseAndGetAddressOf());
+        if (FAILED(hr))
+        {
+            DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
+                static_cast<unsigned int>(hr), fullName);
+            throw std::runtime_error("EffectTextureFactory::CreateWICTextureFromFile");
+        }
+    }
+}
+
+// Creates the texture on a worker thread. The device is free-threaded, so only recording the
+// upload into the shared ResourceUploadBatch is serialized.
+_Use_decl_annotations_
+HRESULT EffectTextureFactory::Impl::LoadTextureConcurrent(
+    const wchar_t* fullName,
+    const uint8_t* data,
+    size_t dataSize,
+    DDS_LOADER_FLAGS loadFlags,
+    TextureCacheEntry& textureEntry)
+{
+    wchar_t ext[_MAX_EXT] = {};
+    _wsplitpath_s(fullName, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+    const bool isdds = _wcsicmp(ext, L".dds") == 0;
+
+    std::unique_ptr<uint8_t[]> decodedData;
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+
+    HRESULT hr = S_OK;
+    if (isdds)
+    {
+        if (loadFlags & DDS_LOADER_MIP_AUTOGEN)
+        {
+            // As CreateDDSTextureFromFileEx, only reserve mips which the upload batch can generate
+            DDSMetadata metadata;
+            hr = (data)
+                ? GetDDSMetadataFromMemory(data, dataSize, metadata)
+                : GetDDSMetadataFromFile(fullName, metadata);
             if (FAILED(hr))
+                return hr;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!mResourceUploadBatch.IsSupportedForGenerateMips(metadata.format))
             {
-                DebugTrace("ERROR: CreateWICTextureFromFile failed (%08X) for '%ls'\n",
-                    static_cast<unsigned int>(hr), fullName);
-                throw std::runtime_error("EffectTextureFactory::CreateWICTextureFromFile");
+                DebugTrace("WARNING: Autogen of mips ignored (device doesn't support this format (%d) or trying to use a copy queue)\n", static_cast<int>(metadata.format));
+                loadFlags &= ~DDS_LOADER_MIP_AUTOGEN;
             }
         }
 
-        std::lock_guard<std::mutex> lock(mutex);
-        textureEntry.slot = mResources.size();
-        if (mSharing)
+        hr = (data)
+            ? LoadDDSTextureFromMemoryEx(
+                mDevice.Get(),
+                data,
+                dataSize,
+                0u,
+                D3D12_RESOURCE_FLAG_NONE,
+                loadFlags,
+                textureEntry.mResource.ReleaseAndGetAddressOf(),
+                decodedData,
+                subresources,
+                nullptr,
+                &textureEntry.mIsCubeMap)
+            : LoadDDSTextureFromFileEx(
+                mDevice.Get(),
+                fullName,
+                0u,
+                D3D12_RESOURCE_FLAG_NONE,
+                loadFlags,
+                textureEntry.mResource.ReleaseAndGetAddressOf(),
+                decodedData,
+                subresources,
+                nullptr,
+                &textureEntry.mIsCubeMap);
+    }
+    else
+    {
+        textureEntry.mIsCubeMap = false;
+
+        if (loadFlags & DDS_LOADER_MIP_AUTOGEN)
         {
-            TextureCache::value_type v(name, textureEntry);
-            mTextureCache.insert(v);
+            // As the DDS path, but a single level can also fall back to the CPU generator below
+            DXGI_FORMAT format;
+            hr = (data)
+                ? GetWICTextureFormatFromMemory(data, dataSize, &format)
+                : GetWICTextureFormatFromFile(fullName, &format);
+            if (FAILED(hr))
+                return hr;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!mResourceUploadBatch.IsSupportedForGenerateMips(format)
+                && !ResourceUploadBatch::IsSupportedForCpuGenerateMips(format))
+            {
+                DebugTrace("WARNING: Autogen of mips ignored for '%ls' (no generator supports format %d)\n", fullName, static_cast<int>(format));
+                loadFlags &= ~DDS_LOADER_MIP_AUTOGEN;
+            }
         }
-        mResources.push_back(textureEntry);
+
+        subresources.resize(1);
+        hr = (data)
+            ? LoadWICTextureFromMemoryEx(
+                mDevice.Get(),
+                data,
+                dataSize,
+                0u,
+                D3D12_RESOURCE_FLAG_NONE,
+                static_cast<WIC_LOADER_FLAGS>(loadFlags),
+                textureEntry.mResource.ReleaseAndGetAddressOf(),
+                decodedData,
+                subresources[0])
+            : LoadWICTextureFromFileEx(
+                mDevice.Get(),
+                fullName,
+                0u,
+                D3D12_RESOURCE_FLAG_NONE,
+                static_cast<WIC_LOADER_FLAGS>(loadFlags),
+                textureEntry.mResource.ReleaseAndGetAddressOf(),
+                decodedData,
+                subresources[0]);
     }
+    if (FAILED(hr))
+        return hr;
 
-    assert(textureEntry.mResource != nullptr);
+    auto texture = textureEntry.mResource.Get();
 
-    // bind a new descriptor in slot
-    auto const textureDescriptor = mTextureDescriptorHeap.GetCpuHandle(static_cast<size_t>(descriptorSlot));
-    DirectX::CreateShaderResourceView(mDevice.Get(), textureEntry.mResource.Get(), textureDescriptor, textureEntry.mIsCubeMap);
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = texture->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *texture->GetDesc(&tmpDesc);
+#endif
 
-    return textureEntry.slot;
+    const bool generateMips = (loadFlags & DDS_LOADER_MIP_AUTOGEN) && subresources.size() != desc.MipLevels;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (generateMips
+        && !mResourceUploadBatch.IsSupportedForGenerateMips(desc.Format)
+        && ResourceUploadBatch::IsSupportedForCpuGenerateMips(desc.Format)
+        && subresources.size() == 1)
+    {
+        // WIC images have a single level, so the CPU generator can fill in the reserved mips
+        mResourceUploadBatch.UploadAndGenerateMips(texture, subresources.data(), 1);
+
+        mResourceUploadBatch.Transition(
+            texture,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        return S_OK;
+    }
+
+    mResourceUploadBatch.Upload(
+        texture,
+        0,
+        subresources.data(),
+        static_cast<UINT>(subresources.size()));
+
+    mResourceUploadBatch.Transition(
+        texture,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    if (generateMips)
+    {
+        if (mResourceUploadBatch.IsSupportedForGenerateMips(desc.Format))
+        {
+            mResourceUploadBatch.GenerateMips(texture);
+        }
+        else
+        {
+            DebugTrace("WARNING: Autogen of mips ignored for '%ls' (format %d)\n", fullName, static_cast<int>(desc.Format));
+        }
+    }
+
+    return S_OK;
 }
 
 void EffectTextureFactory::Impl::ReleaseCache()
 {
     std::lock_guard<std::mutex> lock(mutex);
     mTextureCache.clear();
+    mContentCache.clear();
 }
 
 
 
+//--------------------------------------------------------------------------------------
+// IEffectTextureFactory
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+void IEffectTextureFactory::CreateTextures(const wchar_t* const* names, size_t count, int descriptorOffset, size_t* slots)
+{
+    if (!names && count > 0)
+        throw std::invalid_argument("names required for CreateTextures");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t slot = CreateTexture(names[i], descriptorOffset + static_cast<int>(i));
+        if (slots)
+        {
+            slots[i] = slot;
+        }
+    }
+}
+
+
 //--------------------------------------------------------------------------------------
 // EffectTextureFactory
 //--------------------------------------------------------------------------------------
@@ -244,6 +883,13 @@ size_t EffectTextureFactory::CreateTexture(_In_z_ const wchar_t* name, int descr
 }
 
 
+_Use_decl_annotations_
+void EffectTextureFactory::CreateTextures(const wchar_t* const* names, size_t count, int descriptorOffset, size_t* slots)
+{
+    pImpl->CreateTextures(names, count, descriptorOffset, slots);
+}
+
+
 void EffectTextureFactory::ReleaseCache()
 {
     pImpl->ReleaseCache();
@@ -256,6 +902,11 @@ void EffectTextureFactory::SetSharing(bool enabled) noexcept
     pImpl->SetSharing(enabled);
 }
 
+void EffectTextureFactory::SetContentSharing(bool enabled) noexcept
+{
+    pImpl->SetContentSharing(enabled);
+}
+
 void EffectTextureFactory::EnableForceSRGB(bool forceSRGB) noexcept
 {
     pImpl->EnableForceSRGB(forceSRGB);
@@ -322,3 +973,13 @@ void EffectTextureFactory::GetResource(size_t slot, ID3D12Resource** resource, b
         *isCubeMap = textureEntry.mIsCubeMap;
     }
 }
+
+EffectTextureFactoryStatistics EffectTextureFactory::GetStatistics() const
+{
+    return pImpl->GetStatistics();
+}
+
+void EffectTextureFactory::ResetStatistics()
+{
+    pImpl->ResetStatistics();
+}
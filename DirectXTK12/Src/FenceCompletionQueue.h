@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------
+// File: FenceCompletionQueue.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Pending work items, each waiting for a fence to reach a value. Every fence is a timeline:
+    // items must be pushed with increasing values per fence, so they complete in order.
+    // TFence is only compared and passed back to the caller, so a simulated fence can stand
+    // in for ID3D12Fence* when exercising the bookkeeping without a device.
+    template<typename TFence, typename TPayload>
+    class FenceCompletionQueue
+    {
+    public:
+        FenceCompletionQueue() = default;
+
+        FenceCompletionQueue(FenceCompletionQueue&&) = default;
+        FenceCompletionQueue& operator= (FenceCompletionQueue&&) = default;
+
+        FenceCompletionQueue(FenceCompletionQueue const&) = delete;
+        FenceCompletionQueue& operator= (FenceCompletionQueue const&) = delete;
+
+        void Push(TFence fence, uint64_t value, TPayload&& payload)
+        {
+            mPending.emplace_back(Entry{ fence, value, std::move(payload) });
+        }
+
+        // Moves every item whose fence has reached its value into retired, keeping the rest in submission order.
+        // getCompletedValue(fence) is called at most once per distinct fence.
+        template<typename TGetCompletedValue>
+        size_t Retire(TGetCompletedValue&& getCompletedValue, std::vector<TPayload>& retired)
+        {
+            std::vector<std::pair<TFence, uint64_t>> completed;
+
+            auto out = mPending.begin();
+            for (auto it = mPending.begin(); it != mPending.end(); ++it)
+            {
+                uint64_t completedValue = 0;
+
+                auto cached = completed.cbegin();
+                for (; cached != completed.cend(); ++cached)
+                {
+                    if (cached->first == it->fence)
+                        break;
+                }
+
+                if (cached != completed.cend())
+                {
+                    completedValue = cached->second;
+                }
+                else
+                {
+                    completedValue = getCompletedValue(it->fence);
+                    completed.emplace_back(it->fence, completedValue);
+                }
+
+                if (completedValue >= it->value)
+                {
+                    retired.emplace_back(std::move(it->payload));
+                }
+                else
+                {
+                    if (out != it)
+                    {
+                        *out = std::move(*it);
+                    }
+                    ++out;
+                }
+            }
+
+            const auto count = static_cast<size_t>(mPending.end() - out);
+            mPending.erase(out, mPending.end());
+            return count;
+        }
+
+        // Invokes func(fence, value) with the lowest pending value of each fence, which is what a waiter should block on.
+        template<typename TFunc>
+        void ForEachWaitTarget(TFunc&& func) const
+        {
+            std::vector<TFence> seen;
+
+            for (auto const& it : mPending)
+            {
+                bool found = false;
+                for (auto const& fence : seen)
+                {
+                    if (fence == it.fence)
+                    {
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found)
+                {
+                    seen.push_back(it.fence);
+                    func(it.fence, it.value);
+                }
+            }
+        }
+
+        // Removes all pending items without waiting, e.g. to fail them after an error.
+        void Drain(std::vector<TPayload>& retired)
+        {
+            for (auto& it : mPending)
+            {
+                retired.emplace_back(std::move(it.payload));
+            }
+            mPending.clear();
+        }
+
+        bool empty() const noexcept { return mPending.empty(); }
+        size_t size() const noexcept { return mPending.size(); }
+
+    private:
+        struct Entry
+        {
+            TFence      fence;
+            uint64_t    value;
+            TPayload    payload;
+        };
+
+        std::deque<Entry> mPending;
+    };
+}
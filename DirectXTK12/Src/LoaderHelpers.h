@@ -14,6 +14,7 @@
 
 #include "DDS.h"
 #include "DDSTextureLoader.h"
+#include "MipChainLayout.h"
 #include "PlatformHelpers.h"
 
 
@@ -983,6 +984,320 @@ namespace DirectX
             return DDS_ALPHA_MODE_UNKNOWN;
         }
 
+        //--------------------------------------------------------------------------------------
+        // Direct3D 12 has no 24bpp formats, so the loaders expand legacy D3DFMT_R8G8B8 to R8G8B8A8
+        //--------------------------------------------------------------------------------------
+        inline bool IsLegacyRGB24(const DDS_PIXELFORMAT& ddpf) noexcept
+        {
+            return !(ddpf.flags & DDS_FOURCC)
+                && (ddpf.flags & DDS_RGB)
+                && ddpf.RGBBitCount == 24
+                && ddpf.RBitMask == 0xff0000
+                && ddpf.GBitMask == 0x00ff00
+                && ddpf.BBitMask == 0x0000ff;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Describes and validates a DDS header. This is the one place the loaders, GetDDSMetadata
+        // and the streaming loaders decide whether a file is supported.
+        //--------------------------------------------------------------------------------------
+        struct DDSTextureInfo
+        {
+            D3D12_RESOURCE_DIMENSION resDim;
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t arraySize;     // Includes the six faces of each cubemap.
+            size_t mipCount;
+            DXGI_FORMAT format;
+            bool isCubeMap;
+            bool expandRGB24;       // Stored as 24bpp, loaded as format (R8G8B8A8_UNORM).
+        };
+
+        inline HRESULT GetDDSTextureInfo(_In_ const DDS_HEADER* header, DDSTextureInfo& info) noexcept
+        {
+            info.resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+            info.width = header->width;
+            info.height = header->height;
+            info.depth = header->depth;
+            info.arraySize = 1;
+            info.mipCount = std::max<size_t>(header->mipMapCount, 1);
+            info.format = DXGI_FORMAT_UNKNOWN;
+            info.isCubeMap = false;
+            info.expandRGB24 = false;
+
+            if ((header->ddspf.flags & DDS_FOURCC) &&
+                (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+            {
+                auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>(reinterpret_cast<const char*>(header) + sizeof(DDS_HEADER));
+
+                info.arraySize = d3d10ext->arraySize;
+                if (info.arraySize == 0)
+                {
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                }
+
+                switch (d3d10ext->dxgiFormat)
+                {
+                case DXGI_FORMAT_NV12:
+                case DXGI_FORMAT_P010:
+                case DXGI_FORMAT_P016:
+                case DXGI_FORMAT_420_OPAQUE:
+                    if ((d3d10ext->resourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+                        || (info.width % 2) != 0 || (info.height % 2) != 0)
+                    {
+                        DebugTrace("ERROR: Video texture does not meet width/height requirements.\n");
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                    break;
+
+                case DXGI_FORMAT_YUY2:
+                case DXGI_FORMAT_Y210:
+                case DXGI_FORMAT_Y216:
+                case DXGI_FORMAT_P208:
+                    if ((info.width % 2) != 0)
+                    {
+                        DebugTrace("ERROR: Video texture does not meet width requirements.\n");
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                    break;
+
+                case DXGI_FORMAT_NV11:
+                    if ((info.width % 4) != 0)
+                    {
+                        DebugTrace("ERROR: Video texture does not meet width requirements.\n");
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                    break;
+
+                case DXGI_FORMAT_AI44:
+                case DXGI_FORMAT_IA44:
+                case DXGI_FORMAT_P8:
+                case DXGI_FORMAT_A8P8:
+                    DebugTrace("ERROR: Legacy stream video texture formats are not supported by Direct3D.\n");
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+                case DXGI_FORMAT_V208:
+                    if ((d3d10ext->resourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+                        || (info.height % 2) != 0)
+                    {
+                        DebugTrace("ERROR: Video texture does not meet height requirements.\n");
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                    break;
+
+                default:
+                    if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
+                    {
+                        DebugTrace("ERROR: Unknown DXGI format (%u)\n", static_cast<uint32_t>(d3d10ext->dxgiFormat));
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                    break;
+                }
+
+                info.format = d3d10ext->dxgiFormat;
+
+                switch (d3d10ext->resourceDimension)
+                {
+                case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+                    // D3DX writes 1D textures with a fixed Height of 1
+                    if ((header->flags & DDS_HEIGHT) && info.height != 1)
+                    {
+                        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                    }
+                    info.height = info.depth = 1;
+                    break;
+
+                case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+                    if (d3d10ext->miscFlag & 0x4 /* RESOURCE_MISC_TEXTURECUBE */)
+                    {
+                        info.arraySize *= 6;
+                        info.isCubeMap = true;
+                    }
+                    info.depth = 1;
+                    break;
+
+                case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+                    if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
+                    {
+                        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                    }
+
+                    if (info.arraySize > 1)
+                    {
+                        DebugTrace("ERROR: Volume textures are not texture arrays\n");
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                    break;
+
+                case D3D12_RESOURCE_DIMENSION_BUFFER:
+                    DebugTrace("ERROR: Resource dimension buffer type not supported for textures\n");
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+                case D3D12_RESOURCE_DIMENSION_UNKNOWN:
+                default:
+                    DebugTrace("ERROR: Unknown resource dimension (%u)\n", static_cast<uint32_t>(d3d10ext->resourceDimension));
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+
+                info.resDim = static_cast<D3D12_RESOURCE_DIMENSION>(d3d10ext->resourceDimension);
+            }
+            else
+            {
+                if (IsLegacyRGB24(header->ddspf))
+                {
+                    info.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                    info.expandRGB24 = true;
+                }
+                else
+                {
+                    info.format = GetDXGIFormat(header->ddspf);
+                }
+
+                if (info.format == DXGI_FORMAT_UNKNOWN)
+                {
+                    DebugTrace("ERROR: DDSTextureLoader does not support all legacy DDS formats. Consider using DirectXTex.\n");
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+
+                if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+                {
+                    info.resDim = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+                }
+                else
+                {
+                    if (header->caps2 & DDS_CUBEMAP)
+                    {
+                        // We require all six faces to be defined
+                        if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+                        {
+                            DebugTrace("ERROR: DirectX 12 does not support partial cubemaps\n");
+                            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                        }
+
+                        info.arraySize = 6;
+                        info.isCubeMap = true;
+                    }
+
+                    info.depth = 1;
+                    info.resDim = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+                    // Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
+                }
+
+                assert(BitsPerPixel(info.format) != 0);
+            }
+
+            // Bound sizes (for security purposes we don't trust DDS file metadata larger than the Direct3D hardware requirements)
+            if (info.mipCount > D3D12_REQ_MIP_LEVELS)
+            {
+                DebugTrace("ERROR: Too many mipmap levels defined for DirectX 12 (%zu).\n", info.mipCount);
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+
+            switch (info.resDim)
+            {
+            case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+                if ((info.arraySize > D3D12_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION) ||
+                    (info.width > D3D12_REQ_TEXTURE1D_U_DIMENSION))
+                {
+                    DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (1D: array %u, size %u)\n", info.arraySize, info.width);
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+                break;
+
+            case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+                if (info.isCubeMap)
+                {
+                    // This is the right bound because we set arraySize to (NumCubes*6) above
+                    if ((info.arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
+                        (info.width > D3D12_REQ_TEXTURECUBE_DIMENSION) ||
+                        (info.height > D3D12_REQ_TEXTURECUBE_DIMENSION))
+                    {
+                        DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (2D cubemap: array %u, size %u by %u)\n", info.arraySize, info.width, info.height);
+                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                    }
+                }
+                else if ((info.arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
+                    (info.width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION) ||
+                    (info.height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION))
+                {
+                    DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (2D: array %u, size %u by %u)\n", info.arraySize, info.width, info.height);
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+                break;
+
+            case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+                if ((info.arraySize > 1) ||
+                    (info.width > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
+                    (info.height > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
+                    (info.depth > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION))
+                {
+                    DebugTrace("ERROR: Resource dimensions too large for DirectX 12 (3D: array %u, size %u by %u by %u)\n", info.arraySize, info.width, info.height, info.depth);
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+                break;
+
+            default:
+                DebugTrace("ERROR: Unknown resource dimension (%u)\n", static_cast<uint32_t>(info.resDim));
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+
+            // Planar formats multiply this again; the loaders check that total
+            const size_t subresources = info.mipCount * ((info.resDim == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? 1u : info.arraySize);
+            if (subresources > D3D12_REQ_SUBRESOURCES)
+                return E_INVALIDARG;
+
+            return S_OK;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Computes where every surface is stored, with dataOffset bytes before the first one
+        //--------------------------------------------------------------------------------------
+        inline HRESULT GetDDSLayout(DDSTextureInfo const& info, uint64_t dataOffset, MipChainLayout& layout) noexcept
+        {
+            const size_t arraySize = (info.resDim == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? 1u : info.arraySize;
+
+            layout = MipChainLayout(dataOffset, arraySize);
+
+            size_t w = info.width;
+            size_t h = info.height;
+            size_t d = info.depth;
+            for (size_t i = 0; i < info.mipCount; ++i)
+            {
+                size_t numBytes = 0;
+                size_t rowBytes = 0;
+                HRESULT hr = GetSurfaceInfo(w, h, info.format, &numBytes, &rowBytes, nullptr);
+                if (FAILED(hr))
+                    return hr;
+
+                if (numBytes > UINT32_MAX || rowBytes > UINT32_MAX)
+                    return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+                if (info.expandRGB24)
+                {
+                    // The file stores 3 of every 4 bytes the loaded surface has
+                    numBytes = numBytes / 4 * 3;
+                    rowBytes = rowBytes / 4 * 3;
+                }
+
+                try
+                {
+                    layout.AddMip(static_cast<uint32_t>(w), static_cast<uint32_t>(h), static_cast<uint32_t>(d), rowBytes, numBytes);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    return E_OUTOFMEMORY;
+                }
+
+                w = std::max<size_t>(w >> 1, 1);
+                h = std::max<size_t>(h >> 1, 1);
+                d = std::max<size_t>(d >> 1, 1);
+            }
+
+            return S_OK;
+        }
+
         //--------------------------------------------------------------------------------------
         class auto_delete_file
         {
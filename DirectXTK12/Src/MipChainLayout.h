@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------
+// File: MipChainLayout.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DirectX
+{
+    // File layout of the surfaces in a DDS file: each array slice stores its full mip chain,
+    // finest first, so any run of adjacent mips within one slice is a single contiguous byte
+    // range. Sizes come from LoaderHelpers::GetSurfaceInfo; this class only does the offset
+    // arithmetic, so it has no Direct3D dependencies.
+    class MipChainLayout
+    {
+    public:
+        struct MipLevel
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint64_t rowBytes;
+            uint64_t surfaceBytes;  // One depth slice.
+            uint64_t offset;        // From the start of the array slice.
+            uint64_t size;          // All depth slices.
+        };
+
+        struct ByteRange
+        {
+            uint64_t offset;        // From the start of the file.
+            uint64_t size;
+        };
+
+        struct MipRange
+        {
+            size_t firstMip;
+            size_t mipCount;
+        };
+
+        MipChainLayout() noexcept :
+            mDataOffset(0),
+            mArraySize(0),
+            mSliceStride(0)
+        {
+        }
+
+        MipChainLayout(uint64_t dataOffset, size_t arraySize) noexcept :
+            mDataOffset(dataOffset),
+            mArraySize(arraySize),
+            mSliceStride(0)
+        {
+        }
+
+        // Mips must be added finest first, in file order.
+        void AddMip(uint32_t width, uint32_t height, uint32_t depth, uint64_t rowBytes, uint64_t surfaceBytes)
+        {
+            MipLevel mip = { width, height, depth, rowBytes, surfaceBytes, mSliceStride, surfaceBytes * depth };
+            mMips.push_back(mip);
+            mSliceStride += mip.size;
+        }
+
+        size_t GetMipCount() const noexcept { return mMips.size(); }
+        size_t GetArraySize() const noexcept { return mArraySize; }
+        uint64_t GetSliceStride() const noexcept { return mSliceStride; }
+        uint64_t GetDataOffset() const noexcept { return mDataOffset; }
+        uint64_t GetFileSize() const noexcept { return mDataOffset + mSliceStride * mArraySize; }
+
+        MipLevel const& GetMip(size_t mip) const { return mMips.at(mip); }
+
+        // Bytes of mips [firstMip, firstMip + mipCount) in one array slice.
+        ByteRange GetRange(size_t slice, size_t firstMip, size_t mipCount) const
+        {
+            if (slice >= mArraySize || !mipCount || firstMip + mipCount > mMips.size())
+                throw std::out_of_range("MipChainLayout::GetRange");
+
+            auto const& last = mMips[firstMip + mipCount - 1];
+            const uint64_t start = mMips[firstMip].offset;
+
+            return ByteRange{ mDataOffset + slice * mSliceStride + start, last.offset + last.size - start };
+        }
+
+        // Bytes of mips [firstMip, firstMip + mipCount) across every array slice.
+        uint64_t GetBytes(size_t firstMip, size_t mipCount) const
+        {
+            if (!mipCount)
+                return 0;
+
+            return GetRange(0, firstMip, mipCount).size * mArraySize;
+        }
+
+        // Splits mips [topMip, GetMipCount()) into chunks to be delivered coarsest first. The smallest mips are grouped
+        // into a single first chunk of up to tailBytes, so a low resolution version is available after one read; every
+        // finer mip is then a chunk of its own.
+        std::vector<MipRange> PlanCoarsestFirst(size_t topMip, uint64_t tailBytes) const
+        {
+            std::vector<MipRange> chunks;
+
+            if (topMip >= mMips.size())
+                return chunks;
+
+            size_t tailStart = mMips.size() - 1;
+            while (tailStart > topMip && GetBytes(tailStart - 1, mMips.size() - tailStart + 1) <= tailBytes)
+            {
+                --tailStart;
+            }
+
+            chunks.push_back(MipRange{ tailStart, mMips.size() - tailStart });
+
+            for (size_t mip = tailStart; mip > topMip; --mip)
+            {
+                chunks.push_back(MipRange{ mip - 1, 1 });
+            }
+
+            return chunks;
+        }
+
+    private:
+        uint64_t                mDataOffset;
+        size_t                  mArraySize;
+        uint64_t                mSliceStride;
+        std::vector<MipLevel>   mMips;
+    };
+}
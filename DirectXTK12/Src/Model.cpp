@@ -278,11 +278,15 @@ Model& Model::operator= (Model const& rhs)
 // Load texture resources.
 int Model::LoadTextures(IEffectTextureFactory& texFactory, int destinationDescriptorOffset) const
 {
-    for (size_t i = 0; i < textureNames.size(); ++i)
+    std::vector<const wchar_t*> names;
+    names.reserve(textureNames.size());
+    for (const auto& it : textureNames)
     {
-        texFactory.CreateTexture(textureNames[i].c_str(), destinationDescriptorOffset + static_cast<int>(i));
+        names.push_back(it.c_str());
     }
 
+    texFactory.CreateTextures(names.data(), names.size(), destinationDescriptorOffset, nullptr);
+
     return static_cast<int>(textureNames.size());
 }
 
@@ -0,0 +1,71 @@
+//--------------------------------------------------------------------------------------
+// File: ParallelHelpers.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <thread>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace ParallelHelpers
+    {
+        // Runs func(begin, end) over [0, count) split across the available cores, with at least
+        // minPerTask items in each task. The calling thread runs the first range itself.
+        template<typename TFunc>
+        void ParallelFor(size_t count, size_t minPerTask, TFunc&& func)
+        {
+            const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            const size_t tasks = std::min(cores, (count + minPerTask - 1) / minPerTask);
+            if (tasks <= 1)
+            {
+                func(size_t(0), count);
+                return;
+            }
+
+            const size_t perTask = (count + tasks - 1) / tasks;
+
+            std::vector<std::future<void>> workers;
+            workers.reserve(tasks - 1);
+            for (size_t begin = perTask; begin < count; begin += perTask)
+            {
+                const size_t end = std::min(begin + perTask, count);
+                workers.emplace_back(std::async(std::launch::async, [&func, begin, end]() { func(begin, end); }));
+            }
+
+            func(size_t(0), std::min(perTask, count));
+
+            // get() rethrows any exception from a worker.
+            for (auto& it : workers)
+            {
+                it.get();
+            }
+        }
+
+        // Runs func(index) for each index in [0, count) across the available cores, handing out one index
+        // at a time. Suits a few items of widely varying cost, such as file loads.
+        template<typename TFunc>
+        void ParallelForEach(size_t count, TFunc&& func)
+        {
+            std::atomic<size_t> next(0);
+            ParallelFor(count, 1, [&](size_t, size_t)
+                {
+                    for (size_t index = next++; index < count; index = next++)
+                    {
+                        func(index);
+                    }
+                });
+        }
+    }
+}
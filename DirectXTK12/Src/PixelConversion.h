@@ -0,0 +1,373 @@
+//--------------------------------------------------------------------------------------
+// File: PixelConversion.h
+//
+// Pixel format conversion kernels for the texture loaders and screen grabber
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#if defined(_XM_SSE_INTRINSICS_) && (defined(_XM_SSE4_INTRINSICS_) || defined(__SSSE3__))
+#define DIRECTX_PIXELCONVERSION_SSSE3
+#include <tmmintrin.h>
+#endif
+
+
+namespace DirectX
+{
+    namespace PixelConversion
+    {
+        // Every function converts count pixels, and the destination may be the source when the pixel size
+        // is unchanged. The 8-bit 4-channel kernels work on either RGBA or BGRA channel order.
+
+        //--------------------------------------------------------------------------------------
+        // 24bpp to 32bpp, with alpha set to opaque
+        //--------------------------------------------------------------------------------------
+        namespace Internal
+        {
+            template<bool TSwapRedBlue>
+            inline void Expand24To32(uint8_t* dest, const uint8_t* src, size_t count) noexcept
+            {
+                size_t i = 0;
+
+            #ifdef DIRECTX_PIXELCONVERSION_SSSE3
+                // Each 16-byte load holds four whole pixels; stop while a full load is still inside the source.
+                const __m128i shuffle = TSwapRedBlue
+                    ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                    : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+                const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+                for (; i + 6 <= count; i += 4)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+                }
+            #endif
+
+                for (; i < count; ++i)
+                {
+                    const uint8_t* s = src + i * 3;
+                    uint8_t* d = dest + i * 4;
+                    d[0] = TSwapRedBlue ? s[2] : s[0];
+                    d[1] = s[1];
+                    d[2] = TSwapRedBlue ? s[0] : s[2];
+                    d[3] = 0xFF;
+                }
+            }
+
+            template<bool TSwapRedBlue>
+            inline void Pack32To24(uint8_t* dest, const uint8_t* src, size_t count) noexcept
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const uint8_t* s = src + i * 4;
+                    uint8_t* d = dest + i * 3;
+                    d[0] = TSwapRedBlue ? s[2] : s[0];
+                    d[1] = s[1];
+                    d[2] = TSwapRedBlue ? s[0] : s[2];
+                }
+            }
+        }
+
+        // WIC 24bppBGR (DDS D3DFMT_R8G8B8) to R8G8B8A8.
+        inline void ConvertBGR24ToRGBA8(_Out_writes_bytes_(count * 4) uint8_t* dest, _In_reads_bytes_(count * 3) const uint8_t* src, size_t count) noexcept
+        {
+            Internal::Expand24To32<true>(dest, src, count);
+        }
+
+        // WIC 24bppRGB to R8G8B8A8.
+        inline void ConvertRGB24ToRGBA8(_Out_writes_bytes_(count * 4) uint8_t* dest, _In_reads_bytes_(count * 3) const uint8_t* src, size_t count) noexcept
+        {
+            Internal::Expand24To32<false>(dest, src, count);
+        }
+
+        // R8G8B8A8 to WIC 24bppBGR, dropping alpha.
+        inline void ConvertRGBA8ToBGR24(_Out_writes_bytes_(count * 3) uint8_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count) noexcept
+        {
+            Internal::Pack32To24<true>(dest, src, count);
+        }
+
+        // B8G8R8A8 to WIC 24bppBGR, dropping alpha.
+        inline void ConvertBGRA8ToBGR24(_Out_writes_bytes_(count * 3) uint8_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count) noexcept
+        {
+            Internal::Pack32To24<false>(dest, src, count);
+        }
+
+        //--------------------------------------------------------------------------------------
+        // BGRA <-> RGBA
+        //--------------------------------------------------------------------------------------
+        inline void SwapRedBlue8(_Out_writes_bytes_(count * 4) uint8_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count, bool forceOpaque = false) noexcept
+        {
+            const uint32_t alpha = forceOpaque ? 0xFF000000u : 0;
+            size_t i = 0;
+
+        #ifdef _XM_SSE_INTRINSICS_
+            const __m128i maskGA = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+            const __m128i maskRB = _mm_set1_epi32(0x00FF00FF);
+            const __m128i alpha4 = _mm_set1_epi32(static_cast<int>(alpha));
+
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                const __m128i rb = _mm_and_si128(v, maskRB);
+                __m128i r = _mm_or_si128(_mm_and_si128(v, maskGA), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+                r = _mm_or_si128(r, alpha4);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), r);
+            }
+        #endif
+
+            for (; i < count; ++i)
+            {
+                uint32_t v;
+                memcpy(&v, src + i * 4, sizeof(v));
+                v = (v & 0xFF00FF00u) | ((v & 0xFFu) << 16) | ((v >> 16) & 0xFFu) | alpha;
+                memcpy(dest + i * 4, &v, sizeof(v));
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // 16bpp to R8G8B8A8, replicating the high bits into the low ones so full scale stays full scale
+        //--------------------------------------------------------------------------------------
+        inline void ConvertB5G6R5ToRGBA8(_Out_writes_(count * 4) uint8_t* dest, _In_reads_(count) const uint16_t* src, size_t count) noexcept
+        {
+            size_t i = 0;
+
+        #ifdef _XM_SSE_INTRINSICS_
+            const __m128i mask5 = _mm_set1_epi16(0x1F);
+            const __m128i mask6 = _mm_set1_epi16(0x3F);
+            const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+                __m128i r = _mm_srli_epi16(v, 11);
+                __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+                __m128i b = _mm_and_si128(v, mask5);
+
+                r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+                g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+                b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+                const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+                const __m128i ba = _mm_or_si128(b, alpha);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_unpacklo_epi16(rg, ba));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+            }
+        #endif
+
+            for (; i < count; ++i)
+            {
+                const uint32_t v = src[i];
+                const uint32_t r = v >> 11;
+                const uint32_t g = (v >> 5) & 0x3F;
+                const uint32_t b = v & 0x1F;
+
+                uint8_t* d = dest + i * 4;
+                d[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+                d[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+                d[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+                d[3] = 0xFF;
+            }
+        }
+
+        inline void ConvertB5G5R5A1ToRGBA8(_Out_writes_(count * 4) uint8_t* dest, _In_reads_(count) const uint16_t* src, size_t count) noexcept
+        {
+            size_t i = 0;
+
+        #ifdef _XM_SSE_INTRINSICS_
+            const __m128i mask5 = _mm_set1_epi16(0x1F);
+
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+                __m128i r = _mm_and_si128(_mm_srli_epi16(v, 10), mask5);
+                __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask5);
+                __m128i b = _mm_and_si128(v, mask5);
+                const __m128i a = _mm_slli_epi16(_mm_srai_epi16(v, 15), 8);
+
+                r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+                g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+                b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+                const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+                const __m128i ba = _mm_or_si128(b, a);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_unpacklo_epi16(rg, ba));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+            }
+        #endif
+
+            for (; i < count; ++i)
+            {
+                const uint32_t v = src[i];
+                const uint32_t r = (v >> 10) & 0x1F;
+                const uint32_t g = (v >> 5) & 0x1F;
+                const uint32_t b = v & 0x1F;
+
+                uint8_t* d = dest + i * 4;
+                d[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+                d[1] = static_cast<uint8_t>((g << 3) | (g >> 2));
+                d[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+                d[3] = (v & 0x8000) ? 0xFF : 0;
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // Premultiplies color by alpha, rounding to nearest
+        //--------------------------------------------------------------------------------------
+        inline void PremultiplyAlpha8(_Out_writes_bytes_(count * 4) uint8_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count) noexcept
+        {
+            size_t i = 0;
+
+        #ifdef _XM_SSE_INTRINSICS_
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i half = _mm_set1_epi16(128);
+            const __m128i alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+
+                __m128i lanes[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+                for (auto& x : lanes)
+                {
+                    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+                    // (x * a + 128) * 257 >> 16 is x * a / 255 rounded.
+                    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), half);
+                    t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+
+                    x = _mm_or_si128(_mm_andnot_si128(alphaMask, t), _mm_and_si128(alphaMask, x));
+                }
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_packus_epi16(lanes[0], lanes[1]));
+            }
+        #endif
+
+            for (; i < count; ++i)
+            {
+                const uint8_t* s = src + i * 4;
+                uint8_t* d = dest + i * 4;
+                const uint32_t a = s[3];
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    const uint32_t t = s[c] * a + 128;
+                    d[c] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+                }
+                d[3] = static_cast<uint8_t>(a);
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // sRGB <-> linear. Alpha is never changed.
+        //--------------------------------------------------------------------------------------
+        namespace Internal
+        {
+            struct SRGBTables
+            {
+                uint8_t toLinear[256];
+                uint8_t toSRGB[256];
+
+                SRGBTables() noexcept
+                {
+                    for (uint32_t j = 0; j < 256; ++j)
+                    {
+                        const XMVECTOR v = XMVectorReplicate(static_cast<float>(j) / 255.f);
+
+                        toLinear[j] = static_cast<uint8_t>(XMVectorGetX(XMColorSRGBToRGB(v)) * 255.f + 0.5f);
+                        toSRGB[j] = static_cast<uint8_t>(XMVectorGetX(XMColorRGBToSRGB(v)) * 255.f + 0.5f);
+                    }
+                }
+            };
+
+            inline const SRGBTables& GetSRGBTables() noexcept
+            {
+                static const SRGBTables s_tables;
+                return s_tables;
+            }
+
+            inline void ApplyTable8(uint8_t* dest, const uint8_t* src, size_t count, const uint8_t* table) noexcept
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const uint8_t* s = src + i * 4;
+                    uint8_t* d = dest + i * 4;
+                    d[0] = table[s[0]];
+                    d[1] = table[s[1]];
+                    d[2] = table[s[2]];
+                    d[3] = s[3];
+                }
+            }
+        }
+
+        // 8 bits are not enough for linear data in the darks; use the float versions where precision matters.
+        inline void ConvertSRGBToLinear8(_Out_writes_bytes_(count * 4) uint8_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count) noexcept
+        {
+            Internal::ApplyTable8(dest, src, count, Internal::GetSRGBTables().toLinear);
+        }
+
+        inline void ConvertLinearToSRGB8(_Out_writes_bytes_(count * 4) uint8_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count) noexcept
+        {
+            Internal::ApplyTable8(dest, src, count, Internal::GetSRGBTables().toSRGB);
+        }
+
+        inline void ConvertSRGBToLinear(_Inout_updates_(count) XMFLOAT4* pixels, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                XMStoreFloat4(&pixels[i], XMColorSRGBToRGB(XMLoadFloat4(&pixels[i])));
+            }
+        }
+
+        inline void ConvertLinearToSRGB(_Inout_updates_(count) XMFLOAT4* pixels, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                XMStoreFloat4(&pixels[i], XMColorRGBToSRGB(XMLoadFloat4(&pixels[i])));
+            }
+        }
+
+        //--------------------------------------------------------------------------------------
+        // R8G8B8A8_UNORM to R16G16B16A16_FLOAT. With fromSRGB, the color channels are decoded
+        // to linear in float so the darks keep their precision.
+        //--------------------------------------------------------------------------------------
+        inline void ConvertRGBA8ToRGBA16F(_Out_writes_(count * 4) uint16_t* dest, _In_reads_bytes_(count * 4) const uint8_t* src, size_t count, bool fromSRGB = false) noexcept
+        {
+            constexpr size_t c_chunk = 64;
+            XMFLOAT4 temp[c_chunk];
+
+            for (size_t i = 0; i < count; i += c_chunk)
+            {
+                const size_t n = (count - i < c_chunk) ? (count - i) : c_chunk;
+
+                for (size_t j = 0; j < n; ++j)
+                {
+                    XMStoreFloat4(&temp[j], PackedVector::XMLoadUByteN4(reinterpret_cast<const PackedVector::XMUBYTEN4*>(src + (i + j) * 4)));
+                }
+
+                if (fromSRGB)
+                {
+                    ConvertSRGBToLinear(temp, n);
+                }
+
+                // The stream conversion uses F16C when it is available.
+                PackedVector::XMConvertFloatToHalfStream(dest + i * 4, sizeof(uint16_t),
+                    reinterpret_cast<const float*>(temp), sizeof(float), n * 4);
+            }
+        }
+    }
+}
@@ -27,10 +27,13 @@ public:
     void Begin(_In_ ID3D12GraphicsCommandList* cmdList);
     void End();
 
-    void Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, _In_opt_count_(indexCount) uint16_t const* indices, size_t indexCount, size_t vertexCount, _Outptr_ void** pMappedVertices);
+    void Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, _In_opt_ void const* indices, size_t indexSize, size_t indexCount, size_t vertexCount, _Outptr_ void** pMappedVertices);
+    size_t Append(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, _Outptr_ void** pMappedVertices);
 
 private:
     void FlushBatch();
+    void StartBatch(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, size_t indexSize) noexcept;
+    void AllocateVertexPage();
 
     GraphicsResource mVertexSegment;
     GraphicsResource mIndexSegment;
@@ -42,16 +45,17 @@ private:
     size_t mMaxVertices;
     size_t mVertexSize;
     size_t mVertexPageSize;
-    size_t mIndexPageSize;
 
     D3D_PRIMITIVE_TOPOLOGY mCurrentTopology;
     bool mInBeginEndPair;
     bool mCurrentlyIndexed;
+    size_t mCurrentIndexSize;
 
-    size_t mIndexCount;
+    // Pages are kept across flushes, so each batch starts where the previous one ended.
+    size_t mIndexOffset;
     size_t mVertexCount;
 
-    size_t mBaseIndex;
+    size_t mBaseIndexOffset;
     size_t mBaseVertex;
 };
 
@@ -64,13 +68,13 @@ PrimitiveBatchBase::Impl::Impl(_In_ ID3D12Device* device, size_t maxIndices, siz
     mMaxVertices(maxVertices),
     mVertexSize(vertexSize),
     mVertexPageSize(maxVertices * vertexSize),
-    mIndexPageSize(maxIndices * sizeof(uint16_t)),
     mCurrentTopology(D3D_PRIMITIVE_TOPOLOGY_UNDEFINED),
     mInBeginEndPair(false),
     mCurrentlyIndexed(false),
-    mIndexCount(0),
+    mCurrentIndexSize(sizeof(uint16_t)),
+    mIndexOffset(0),
     mVertexCount(0),
-    mBaseIndex(0),
+    mBaseIndexOffset(0),
     mBaseVertex(0)
 {
     if (!maxVertices)
@@ -79,7 +83,8 @@ PrimitiveBatchBase::Impl::Impl(_In_ ID3D12Device* device, size_t maxIndices, siz
     if (vertexSize > D3D12_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
         throw std::invalid_argument("Vertex size is too large for DirectX 12");
 
-    if ((uint64_t(maxIndices) * sizeof(uint16_t)) > uint64_t(D3D12_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u))
+    // Index pages may hold 32-bit indices, so validate against the larger size.
+    if ((uint64_t(maxIndices) * sizeof(uint32_t)) > uint64_t(D3D12_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u))
         throw std::invalid_argument("IB too large for DirectX 12");
 
     if ((uint64_t(maxVertices) * uint64_t(vertexSize)) > uint64_t(D3D12_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u))
@@ -96,6 +101,11 @@ void PrimitiveBatchBase::Impl::Begin(_In_ ID3D12GraphicsCommandList* cmdList)
 
     mCommandList = cmdList;
     mInBeginEndPair = true;
+
+    mIndexOffset = 0;
+    mVertexCount = 0;
+    mBaseIndexOffset = 0;
+    mBaseVertex = 0;
 }
 
 
@@ -136,9 +146,22 @@ static bool CanBatchPrimitives(D3D_PRIMITIVE_TOPOLOGY topology) noexcept
 }
 
 
+// Number of vertices in each primitive of a list topology, or zero for strips.
+static size_t GetVerticesPerPrimitive(D3D_PRIMITIVE_TOPOLOGY topology) noexcept
+{
+    switch (topology)
+    {
+    case D3D_PRIMITIVE_TOPOLOGY_POINTLIST:      return 1;
+    case D3D_PRIMITIVE_TOPOLOGY_LINELIST:       return 2;
+    case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST:   return 3;
+    default:                                    return 0;
+    }
+}
+
+
 // Adds new geometry to the batch.
 _Use_decl_annotations_
-void PrimitiveBatchBase::Impl::Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, uint16_t const* indices, size_t indexCount, size_t vertexCount, void** pMappedVertices)
+void PrimitiveBatchBase::Impl::Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, void const* indices, size_t indexSize, size_t indexCount, size_t vertexCount, void** pMappedVertices)
 {
     if (isIndexed && !indices)
         throw std::invalid_argument("Indices cannot be null");
@@ -149,53 +172,84 @@ void PrimitiveBatchBase::Impl::Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isInde
     if (vertexCount >= mMaxVertices)
         throw std::invalid_argument("Too many vertices");
 
+    if (isIndexed && indexSize == sizeof(uint16_t) && vertexCount > UINT16_MAX + 1u)
+        throw std::invalid_argument("Too many vertices for 16-bit indices");
+
     if (!mInBeginEndPair)
         throw std::logic_error("Begin must be called before Draw");
 
     assert(pMappedVertices != nullptr);
 
+    const size_t indexBytes = indexCount * indexSize;
+
     // Can we merge this primitive in with an existing batch, or must we flush first?
-    const bool wrapIndexBuffer = (mIndexCount + indexCount > mMaxIndices);
-    const bool wrapVertexBuffer = (mVertexCount + vertexCount > mMaxVertices);
+    const bool wrapIndexBuffer = isIndexed && (!mIndexSegment || (AlignUp(mIndexOffset, indexSize) + indexBytes > mIndexSegment.Size()));
+    const bool wrapVertexBuffer = !mVertexSegment || (mVertexCount + vertexCount > mMaxVertices);
+
+    // 16-bit indices can only address the first 64K vertices of the batch.
+    const bool wrapIndexRange = isIndexed && (indexSize == sizeof(uint16_t)) && (mVertexCount + vertexCount - mBaseVertex > UINT16_MAX + 1u);
 
     if ((topology != mCurrentTopology) ||
         (isIndexed != mCurrentlyIndexed) ||
+        (isIndexed && indexSize != mCurrentIndexSize) ||
         !CanBatchPrimitives(topology) ||
-        wrapIndexBuffer || wrapVertexBuffer)
+        wrapIndexBuffer || wrapVertexBuffer || wrapIndexRange)
     {
         FlushBatch();
     }
 
-    // If we are not already in a batch, lock the buffers.
+    // If we are not already in a batch, start a new one, only allocating pages once the current ones are full.
     if (mCurrentTopology == D3D_PRIMITIVE_TOPOLOGY_UNDEFINED)
     {
-        mIndexCount = 0;
-        mVertexCount = 0;
-        mBaseIndex = 0;
-        mBaseVertex = 0;
-        mCurrentTopology = topology;
-        mCurrentlyIndexed = isIndexed;
-
-        // Allocate a page for the primitive data
         if (isIndexed)
         {
-            mIndexSegment = GraphicsMemory::Get(mDevice.Get()).Allocate(mIndexPageSize, 16, GraphicsMemory::TAG_INDEX);
+            if (wrapIndexBuffer)
+            {
+                mIndexSegment = GraphicsMemory::Get(mDevice.Get()).Allocate(mMaxIndices * indexSize, 16, GraphicsMemory::TAG_INDEX);
+                mIndexOffset = 0;
+            }
+            else
+            {
+                mIndexOffset = AlignUp(mIndexOffset, indexSize);
+            }
+        }
+
+        if (wrapVertexBuffer)
+        {
+            AllocateVertexPage();
         }
 
-        mVertexSegment = GraphicsMemory::Get(mDevice.Get()).Allocate(mVertexPageSize, 16, GraphicsMemory::TAG_VERTEX);
+        StartBatch(topology, isIndexed, indexSize);
     }
 
     // Copy over the index data.
     if (isIndexed)
     {
-        auto outputIndices = static_cast<uint16_t*>(mIndexSegment.Memory()) + mIndexCount;
+        const size_t vertexOffset = mVertexCount - mBaseVertex;
+        auto outputIndices = static_cast<uint8_t*>(mIndexSegment.Memory()) + mIndexOffset;
 
-        for (size_t i = 0; i < indexCount; i++)
+        if (indexSize == sizeof(uint32_t))
         {
-            outputIndices[i] = static_cast<uint16_t>(indices[i] + mVertexCount - mBaseIndex);
+            auto src = static_cast<uint32_t const*>(indices);
+            auto dest = reinterpret_cast<uint32_t*>(outputIndices);
+
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                dest[i] = static_cast<uint32_t>(src[i] + vertexOffset);
+            }
+        }
+        else
+        {
+            auto src = static_cast<uint16_t const*>(indices);
+            auto dest = reinterpret_cast<uint16_t*>(outputIndices);
+
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                dest[i] = static_cast<uint16_t>(src[i] + vertexOffset);
+            }
         }
 
-        mIndexCount += indexCount;
+        mIndexOffset += indexBytes;
     }
 
     // Return the output vertex data location.
@@ -205,6 +259,75 @@ void PrimitiveBatchBase::Impl::Draw(D3D_PRIMITIVE_TOPOLOGY topology, bool isInde
 }
 
 
+// Reserves space for as many whole list primitives as fit in the current vertex page.
+_Use_decl_annotations_
+size_t PrimitiveBatchBase::Impl::Append(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, void** pMappedVertices)
+{
+    const size_t primitiveSize = GetVerticesPerPrimitive(topology);
+
+    if (!primitiveSize)
+        throw std::invalid_argument("DrawList requires a point, line, or triangle list topology");
+
+    if (!vertexCount || (vertexCount % primitiveSize) != 0)
+        throw std::invalid_argument("Vertex count must be a whole number of primitives");
+
+    if (mMaxVertices < primitiveSize)
+        throw std::invalid_argument("Too many vertices");
+
+    if (!mInBeginEndPair)
+        throw std::logic_error("Begin must be called before Draw");
+
+    assert(pMappedVertices != nullptr);
+
+    const bool wrapVertexBuffer = !mVertexSegment || (mMaxVertices - mVertexCount < primitiveSize);
+
+    if ((topology != mCurrentTopology) || mCurrentlyIndexed || wrapVertexBuffer)
+    {
+        FlushBatch();
+    }
+
+    if (mCurrentTopology == D3D_PRIMITIVE_TOPOLOGY_UNDEFINED)
+    {
+        if (wrapVertexBuffer)
+        {
+            AllocateVertexPage();
+        }
+
+        StartBatch(topology, false, 0);
+    }
+
+    const size_t available = ((mMaxVertices - mVertexCount) / primitiveSize) * primitiveSize;
+    const size_t count = std::min(vertexCount, available);
+
+    *pMappedVertices = static_cast<uint8_t*>(mVertexSegment.Memory()) + mVertexSize * mVertexCount;
+
+    mVertexCount += count;
+
+    return count;
+}
+
+
+void PrimitiveBatchBase::Impl::StartBatch(D3D_PRIMITIVE_TOPOLOGY topology, bool isIndexed, size_t indexSize) noexcept
+{
+    mCurrentTopology = topology;
+    mCurrentlyIndexed = isIndexed;
+    if (isIndexed)
+    {
+        mCurrentIndexSize = indexSize;
+    }
+
+    mBaseIndexOffset = mIndexOffset;
+    mBaseVertex = mVertexCount;
+}
+
+
+void PrimitiveBatchBase::Impl::AllocateVertexPage()
+{
+    mVertexSegment = GraphicsMemory::Get(mDevice.Get()).Allocate(mVertexPageSize, 16, GraphicsMemory::TAG_VERTEX);
+    mVertexCount = 0;
+}
+
+
 // Sends queued primitives to the graphics device.
 void PrimitiveBatchBase::Impl::FlushBatch()
 {
@@ -216,7 +339,7 @@ void PrimitiveBatchBase::Impl::FlushBatch()
 
     // Set the vertex buffer view
     D3D12_VERTEX_BUFFER_VIEW vbv;
-    vbv.BufferLocation = mVertexSegment.GpuAddress();
+    vbv.BufferLocation = mVertexSegment.GpuAddress() + mVertexSize * mBaseVertex;
     vbv.SizeInBytes = static_cast<UINT>(mVertexSize * (mVertexCount - mBaseVertex));
     vbv.StrideInBytes = static_cast<UINT>(mVertexSize);
     mCommandList->IASetVertexBuffers(0, 1, &vbv);
@@ -225,13 +348,13 @@ void PrimitiveBatchBase::Impl::FlushBatch()
     {
         // Set the index buffer view
         D3D12_INDEX_BUFFER_VIEW ibv;
-        ibv.BufferLocation = mIndexSegment.GpuAddress();
-        ibv.Format = DXGI_FORMAT_R16_UINT;
-        ibv.SizeInBytes = static_cast<UINT>(mIndexCount - mBaseIndex) * sizeof(uint16_t);
+        ibv.BufferLocation = mIndexSegment.GpuAddress() + mBaseIndexOffset;
+        ibv.Format = (mCurrentIndexSize == sizeof(uint32_t)) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+        ibv.SizeInBytes = static_cast<UINT>(mIndexOffset - mBaseIndexOffset);
         mCommandList->IASetIndexBuffer(&ibv);
 
         // Draw indexed geometry.
-        mCommandList->DrawIndexedInstanced(static_cast<UINT>(mIndexCount - mBaseIndex), 1, 0, 0, 0);
+        mCommandList->DrawIndexedInstanced(static_cast<UINT>((mIndexOffset - mBaseIndexOffset) / mCurrentIndexSize), 1, 0, 0, 0);
     }
     else
     {
@@ -270,5 +393,19 @@ void PrimitiveBatchBase::End()
 _Use_decl_annotations_
 void PrimitiveBatchBase::Draw(D3D12_PRIMITIVE_TOPOLOGY topology, bool isIndexed, uint16_t const* indices, size_t indexCount, size_t vertexCount, void** pMappedVertices)
 {
-    pImpl->Draw(topology, isIndexed, indices, indexCount, vertexCount, pMappedVertices);
+    pImpl->Draw(topology, isIndexed, indices, sizeof(uint16_t), indexCount, vertexCount, pMappedVertices);
+}
+
+
+_Use_decl_annotations_
+void PrimitiveBatchBase::Draw(D3D12_PRIMITIVE_TOPOLOGY topology, uint32_t const* indices, size_t indexCount, size_t vertexCount, void** pMappedVertices)
+{
+    pImpl->Draw(topology, true, indices, sizeof(uint32_t), indexCount, vertexCount, pMappedVertices);
+}
+
+
+_Use_decl_annotations_
+size_t PrimitiveBatchBase::Append(D3D12_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, void** pMappedVertices)
+{
+    return pImpl->Append(topology, vertexCount, pMappedVertices);
 }
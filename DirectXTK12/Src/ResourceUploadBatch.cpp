@@ -10,9 +10,12 @@
 #include "pch.h"
 #include "ResourceUploadBatch.h"
 
+#include "CpuMipGenerator.h"
 #include "DirectXHelpers.h"
+#include "FenceCompletionQueue.h"
 #include "LoaderHelpers.h"
 #include "PlatformHelpers.h"
+#include "SharedResourcePool.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -34,6 +37,35 @@ namespace
 #include "GenerateMips_main.inc"
 #endif
 
+    bool GetCpuMipsFormat(DXGI_FORMAT format, CpuMips::Format& result) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            result = CpuMips::Format::R8G8B8A8_UNORM;
+            return true;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            result = CpuMips::Format::R8G8B8A8_UNORM_SRGB;
+            return true;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            result = CpuMips::Format::R16G16B16A16_FLOAT;
+            return true;
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            result = CpuMips::Format::R32G32B32A32_FLOAT;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
     bool FormatIsUAVCompatible(_In_ ID3D12Device* device, bool typedUAVLoadAdditionalFormats, DXGI_FORMAT format) noexcept
     {
         switch (format)
@@ -290,6 +322,179 @@ namespace
             return pso;
         }
     };
+
+    // Objects kept alive until the GPU has finished executing an upload.
+    struct UploadBatch
+    {
+        std::vector<ComPtr<ID3D12DeviceChild>>  TrackedObjects;
+        std::vector<SharedGraphicsResource>     TrackedMemoryResources;
+        ComPtr<ID3D12CommandAllocator>          CommandAllocator;
+        ComPtr<ID3D12GraphicsCommandList>       CommandList;
+
+        UploadBatch() noexcept {}
+    };
+
+    // Retires submitted upload batches for all ResourceUploadBatch instances on a device.
+    // Each command queue gets one timeline fence, signaled with increasing values, and a
+    // single worker thread waits on all of them rather than one thread and fence per End.
+    class UploadCompletionService
+    {
+    public:
+        explicit UploadCompletionService(_In_ ID3D12Device* device) :
+            mDevice(device),
+            mShutdown(false)
+        {
+            mFenceEvent.reset(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+            if (!mFenceEvent)
+                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+
+            mWakeEvent.reset(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+            if (!mWakeEvent)
+                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+
+            mWorker = std::async(std::launch::async, [this]() { WorkerThread(); });
+        }
+
+        UploadCompletionService(UploadCompletionService const&) = delete;
+        UploadCompletionService& operator= (UploadCompletionService const&) = delete;
+
+        // Waits for all outstanding batches to retire.
+        ~UploadCompletionService()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mShutdown = true;
+            }
+
+            SetEvent(mWakeEvent.get());
+
+            if (mWorker.valid())
+            {
+                mWorker.wait();
+            }
+        }
+
+        // Signals the next fence value for this queue after the work already submitted to it.
+        std::future<void> Submit(_In_ ID3D12CommandQueue* commandQueue, std::unique_ptr<UploadBatch> batch)
+        {
+            PendingBatch pending;
+            pending.Batch = std::move(batch);
+            std::future<void> future = pending.Completed.get_future();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                auto& timeline = mTimelines[commandQueue];
+                if (!timeline.Fence)
+                {
+                    ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(timeline.Fence.GetAddressOf())));
+
+                    SetDebugObjectName(timeline.Fence.Get(), L"ResourceUploadBatch");
+                }
+
+                const uint64_t value = timeline.LastValue + 1;
+                ThrowIfFailed(commandQueue->Signal(timeline.Fence.Get(), value));
+                timeline.LastValue = value;
+
+                mPending.Push(timeline.Fence.Get(), value, std::move(pending));
+            }
+
+            SetEvent(mWakeEvent.get());
+
+            return future;
+        }
+
+    private:
+        struct PendingBatch
+        {
+            std::unique_ptr<UploadBatch>    Batch;
+            std::promise<void>              Completed;
+        };
+
+        struct QueueTimeline
+        {
+            ComPtr<ID3D12Fence>             Fence;
+            uint64_t                        LastValue = 0;
+        };
+
+        void WorkerThread()
+        {
+            std::vector<PendingBatch> retired;
+
+            for (;;)
+            {
+                bool exit = false;
+                HRESULT hr = S_OK;
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+
+                    mPending.Retire([](ID3D12Fence* fence) { return fence->GetCompletedValue(); }, retired);
+
+                    // Any of the fences reaching its next value wakes us up again.
+                    mPending.ForEachWaitTarget([&](ID3D12Fence* fence, uint64_t value)
+                        {
+                            if (SUCCEEDED(hr))
+                            {
+                                hr = fence->SetEventOnCompletion(value, mFenceEvent.get());
+                            }
+                        });
+
+                    if (FAILED(hr))
+                    {
+                        mPending.Drain(retired);
+                    }
+
+                    exit = mShutdown && mPending.empty();
+                }
+
+                // Release the resources before signaling, so they are gone once the future is ready.
+                for (auto& it : retired)
+                {
+                    it.Batch.reset();
+
+                    if (FAILED(hr))
+                    {
+                        it.Completed.set_exception(std::make_exception_ptr(com_exception(hr)));
+                    }
+                    else
+                    {
+                        it.Completed.set_value();
+                    }
+                }
+                retired.clear();
+
+                if (exit)
+                    break;
+
+                HANDLE events[2] = { mFenceEvent.get(), mWakeEvent.get() };
+                const DWORD wr = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+                if (wr != WAIT_OBJECT_0 && wr != WAIT_OBJECT_0 + 1)
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+
+                    mPending.Drain(retired);
+                    auto error = std::make_exception_ptr(std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "WaitForMultipleObjects"));
+                    for (auto& it : retired)
+                    {
+                        it.Batch.reset();
+                        it.Completed.set_exception(error);
+                    }
+                    retired.clear();
+                }
+            }
+        }
+
+        ID3D12Device*                                           mDevice;
+
+        std::mutex                                              mMutex;
+        std::map<ID3D12CommandQueue*, QueueTimeline>            mTimelines;
+        FenceCompletionQueue<ID3D12Fence*, PendingBatch>        mPending;
+        bool                                                    mShutdown;
+
+        ScopedHandle                                            mFenceEvent;
+        ScopedHandle                                            mWakeEvent;
+        std::future<void>                                       mWorker;
+    };
 } // anonymous namespace
 
 class ResourceUploadBatch::Impl
@@ -404,6 +609,47 @@ public:
         mTrackedMemoryResources.push_back(buffer);
     }
 
+    // Asynchronously copies subresources from another texture.
+    // The resource must be in the COPY_DEST state.
+    void CopySubresources(
+        _In_ ID3D12Resource* resource,
+        uint32_t destSubresourceStart,
+        _In_ ID3D12Resource* source,
+        uint32_t sourceSubresourceStart,
+        uint32_t numSubresources,
+        D3D12_RESOURCE_STATES sourceState)
+    {
+        if (!mInBeginEndBlock)
+            throw std::logic_error("Can't call CopySubresources on a closed ResourceUploadBatch.");
+
+        if (!resource || !source)
+            throw std::invalid_argument("Direct3D resource is null");
+
+        // Copy queues only see COMMON and copy states, and the source is promoted to COPY_SOURCE implicitly.
+        const bool transition = (mCommandType != D3D12_COMMAND_LIST_TYPE_COPY)
+            && (sourceState != D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+        if (transition)
+        {
+            TransitionResource(mList.Get(), source, sourceState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        }
+
+        for (uint32_t j = 0; j < numSubresources; ++j)
+        {
+            const CD3DX12_TEXTURE_COPY_LOCATION src(source, sourceSubresourceStart + j);
+            const CD3DX12_TEXTURE_COPY_LOCATION dst(resource, destSubresourceStart + j);
+            mList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        }
+
+        if (transition)
+        {
+            TransitionResource(mList.Get(), source, D3D12_RESOURCE_STATE_COPY_SOURCE, sourceState);
+        }
+
+        // Keep the source alive until the copy has executed
+        mTrackedObjects.push_back(source);
+    }
+
     // Asynchronously generate mips from a resource.
     // Resource must be in the PIXEL_SHADER_RESOURCE state
     void GenerateMips(_In_ ID3D12Resource* resource)
@@ -487,6 +733,75 @@ public:
         }
     }
 
+    // Generates the mip chain on the CPU, then uploads it like any other data.
+    void UploadAndGenerateMips(
+        _In_ ID3D12Resource* resource,
+        _In_reads_(numSlices) const D3D12_SUBRESOURCE_DATA* subRes,
+        uint32_t numSlices,
+        CpuMipFilter filter)
+    {
+        if (!resource || !subRes)
+        {
+            throw std::invalid_argument("Nullptr passed to UploadAndGenerateMips");
+        }
+
+        if (!mInBeginEndBlock)
+            throw std::logic_error("Can't call UploadAndGenerateMips on a closed ResourceUploadBatch.");
+
+    #if defined(_MSC_VER) || !defined(_WIN32)
+        const auto desc = resource->GetDesc();
+    #else
+        D3D12_RESOURCE_DESC tmpDesc;
+        const auto& desc = *resource->GetDesc(&tmpDesc);
+    #endif
+
+        if (desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+        {
+            throw std::runtime_error("UploadAndGenerateMips only supports Texture2D resources");
+        }
+        if (numSlices != desc.DepthOrArraySize)
+        {
+            throw std::invalid_argument("UploadAndGenerateMips needs mip 0 of every array slice");
+        }
+        if (desc.Width > UINT32_MAX)
+        {
+            throw std::invalid_argument("UploadAndGenerateMips texture is too large");
+        }
+
+        CpuMips::Format format = {};
+        if (!GetCpuMipsFormat(desc.Format, format))
+        {
+            DebugTrace("ERROR: UploadAndGenerateMips doesn't support format %u\n", static_cast<unsigned int>(desc.Format));
+            throw std::runtime_error("UploadAndGenerateMips doesn't support this texture format");
+        }
+
+        std::vector<CpuMips::Image> images(numSlices);
+        for (uint32_t slice = 0; slice < numSlices; ++slice)
+        {
+            images[slice].width = static_cast<uint32_t>(desc.Width);
+            images[slice].height = desc.Height;
+            images[slice].rowPitch = static_cast<size_t>(subRes[slice].RowPitch);
+            images[slice].pixels = subRes[slice].pData;
+        }
+
+        CpuMips::MipChain chain;
+        CpuMips::GenerateMipChain(images.data(), numSlices, desc.MipLevels, format,
+            (filter == CpuMipFilter::Kaiser) ? CpuMips::Filter::Kaiser : CpuMips::Filter::Box,
+            chain);
+
+        std::vector<D3D12_SUBRESOURCE_DATA> initData(chain.surfaces.size());
+        for (size_t j = 0; j < initData.size(); ++j)
+        {
+            auto const& surface = chain.surfaces[j];
+            initData[j].pData = chain.GetPixels(j);
+            initData[j].RowPitch = static_cast<LONG_PTR>(surface.rowPitch);
+            initData[j].SlicePitch = static_cast<LONG_PTR>(surface.rowPitch * surface.height);
+        }
+
+        // Upload copies the data into its own buffer, so the chain can be freed on return.
+        Upload(resource, 0, initData.data(), static_cast<uint32_t>(initData.size()));
+    }
+
     // Transition a resource once you're done with it
     void Transition(
         _In_ ID3D12Resource* resource,
@@ -544,52 +859,21 @@ public:
         // Submit the job to the GPU
         commandQueue->ExecuteCommandLists(1, CommandListCast(mList.GetAddressOf()));
 
-        // Set an event so we get notified when the GPU has completed all its work
-        ComPtr<ID3D12Fence> fence;
-        ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(fence.GetAddressOf())));
-
-        SetDebugObjectName(fence.Get(), L"ResourceUploadBatch");
-
-        HANDLE gpuCompletedEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE);
-        if (!gpuCompletedEvent)
-            throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
-
-        ThrowIfFailed(commandQueue->Signal(fence.Get(), 1ULL));
-        ThrowIfFailed(fence->SetEventOnCompletion(1ULL, gpuCompletedEvent));
+        // Hand the batch to the per-device completion thread, which releases it once the GPU is done.
+        if (!mCompletionService)
+        {
+            mCompletionService = completionServicePool.DemandCreate(mDevice.Get());
+        }
 
-        // Create a packet of data that'll be passed to our waiting upload thread
-        auto uploadBatch = new UploadBatch();
+        auto uploadBatch = std::make_unique<UploadBatch>();
+        uploadBatch->CommandAllocator = mCmdAlloc;
         uploadBatch->CommandList = mList;
-        uploadBatch->Fence = fence;
-        uploadBatch->GpuCompleteEvent.reset(gpuCompletedEvent);
         std::swap(mTrackedObjects, uploadBatch->TrackedObjects);
         std::swap(mTrackedMemoryResources, uploadBatch->TrackedMemoryResources);
 
-        // Kick off a thread that waits for the upload to complete on the GPU timeline.
-        // Let the thread run autonomously, but provide a future the user can wait on.
-        std::future<void> future = std::async(std::launch::async, [uploadBatch]()
-            {
-                // Wait on the GPU-complete notification
-                const DWORD wr = WaitForSingleObject(uploadBatch->GpuCompleteEvent.get(), INFINITE);
-                if (wr != WAIT_OBJECT_0)
-                {
-                    if (wr == WAIT_FAILED)
-                    {
-                        throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "WaitForSingleObject");
-                    }
-                    else
-                    {
-                        throw std::runtime_error("WaitForSingleObject");
-                    }
-                }
-
-                // Delete the batch
-                // Because the vectors contain smart-pointers, their destructors will
-                // fire and the resources will be released.
-                delete uploadBatch;
-            });
+        std::future<void> future = mCompletionService->Submit(commandQueue, std::move(uploadBatch));
 
-            // Reset our state
+        // Reset our state
         mCommandType = D3D12_COMMAND_LIST_TYPE_DIRECT;
         mInBeginEndBlock = false;
         mList.Reset();
@@ -1034,21 +1318,11 @@ private:
         mTrackedObjects.push_back(resource);
     }
 
-    struct UploadBatch
-    {
-        std::vector<ComPtr<ID3D12DeviceChild>>  TrackedObjects;
-        std::vector<SharedGraphicsResource>     TrackedMemoryResources;
-        ComPtr<ID3D12GraphicsCommandList>       CommandList;
-        ComPtr<ID3D12Fence>                     Fence;
-        ScopedHandle                            GpuCompleteEvent;
-
-        UploadBatch() noexcept {}
-    };
-
     ComPtr<ID3D12Device>                        mDevice;
     ComPtr<ID3D12CommandAllocator>              mCmdAlloc;
     ComPtr<ID3D12GraphicsCommandList>           mList;
     std::unique_ptr<GenerateMipsResources>      mGenMipsResources;
+    std::shared_ptr<UploadCompletionService>    mCompletionService;
 
     std::vector<ComPtr<ID3D12DeviceChild>>      mTrackedObjects;
     std::vector<SharedGraphicsResource>         mTrackedMemoryResources;
@@ -1057,9 +1331,15 @@ private:
     bool                                        mInBeginEndBlock;
     bool                                        mTypedUAVLoadAdditionalFormats;
     bool                                        mStandardSwizzle64KBSupported;
+
+    static SharedResourcePool<ID3D12Device*, UploadCompletionService> completionServicePool;
 };
 
 
+// Global pool of per-device completion services.
+SharedResourcePool<ID3D12Device*, UploadCompletionService> ResourceUploadBatch::Impl::completionServicePool;
+
+
 
 // Public constructor.
 ResourceUploadBatch::ResourceUploadBatch(_In_ ID3D12Device* device) noexcept(false)
@@ -1100,6 +1380,19 @@ void ResourceUploadBatch::Upload(
 }
 
 
+_Use_decl_annotations_
+void ResourceUploadBatch::CopySubresources(
+    ID3D12Resource* resource,
+    uint32_t destSubresourceStart,
+    ID3D12Resource* source,
+    uint32_t sourceSubresourceStart,
+    uint32_t numSubresources,
+    D3D12_RESOURCE_STATES sourceState)
+{
+    pImpl->CopySubresources(resource, destSubresourceStart, source, sourceSubresourceStart, numSubresources, sourceState);
+}
+
+
 
 void ResourceUploadBatch::GenerateMips(_In_ ID3D12Resource* resource)
 {
@@ -1107,6 +1400,17 @@ void ResourceUploadBatch::GenerateMips(_In_ ID3D12Resource* resource)
 }
 
 
+_Use_decl_annotations_
+void ResourceUploadBatch::UploadAndGenerateMips(
+    ID3D12Resource* resource,
+    const D3D12_SUBRESOURCE_DATA* subRes,
+    uint32_t numSlices,
+    CpuMipFilter filter)
+{
+    pImpl->UploadAndGenerateMips(resource, subRes, numSlices, filter);
+}
+
+
 _Use_decl_annotations_
 void ResourceUploadBatch::Transition(
     ID3D12Resource* resource,
@@ -1127,3 +1431,10 @@ bool ResourceUploadBatch::IsSupportedForGenerateMips(DXGI_FORMAT format) noexcep
 {
     return pImpl->IsSupportedForGenerateMips(format);
 }
+
+
+bool ResourceUploadBatch::IsSupportedForCpuGenerateMips(DXGI_FORMAT format) noexcept
+{
+    CpuMips::Format cpuFormat = {};
+    return GetCpuMipsFormat(format, cpuFormat);
+}
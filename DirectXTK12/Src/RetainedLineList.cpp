@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------
+// File: RetainedLineList.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "RetainedLineList.h"
+
+#include "DirectXHelpers.h"
+#include "DirtyPageTracker.h"
+#include "GraphicsMemory.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+using namespace DirectX::DX12::Private;
+using Microsoft::WRL::ComPtr;
+
+
+// Internal RetainedLineList implementation class.
+class RetainedLineListBase::Impl
+{
+public:
+    Impl(_In_ ID3D12Device* device, size_t maxLines, size_t linesPerPage, float fullUpdateThreshold, size_t vertexSize);
+
+    void Update(_In_ ID3D12GraphicsCommandList* commandList);
+    void Draw(_In_ ID3D12GraphicsCommandList* commandList) const;
+
+    void* Write(size_t firstLine, size_t lineCount);
+    void SetLineCount(size_t lineCount);
+
+    ComPtr<ID3D12Device> mDevice;
+    ComPtr<ID3D12Resource> mVertexBuffer;
+    D3D12_RESOURCE_STATES mState;
+
+    size_t mMaxLines;
+    size_t mLineCount;
+    size_t mVertexSize;
+    size_t mLineSize;
+
+    // CPU copy of every line, so dirty pages can be re-uploaded whole.
+    std::vector<uint8_t> mVertices;
+
+    DirtyPageTracker mDirty;
+};
+
+
+// Constructor.
+RetainedLineListBase::Impl::Impl(_In_ ID3D12Device* device, size_t maxLines, size_t linesPerPage, float fullUpdateThreshold, size_t vertexSize)
+    : mDevice(device),
+    mState(c_initialCopyTargetState),
+    mMaxLines(maxLines),
+    mLineCount(0),
+    mVertexSize(vertexSize),
+    mLineSize(vertexSize * 2),
+    mDirty(maxLines, linesPerPage, fullUpdateThreshold)
+{
+    if (!maxLines)
+        throw std::invalid_argument("maxLines must be greater than 0");
+
+    if (vertexSize > D3D12_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
+        throw std::invalid_argument("Vertex size is too large for DirectX 12");
+
+    const uint64_t sizeInBytes = uint64_t(maxLines) * uint64_t(mLineSize);
+    if (sizeInBytes > uint64_t(D3D12_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024u * 1024u))
+        throw std::invalid_argument("VB too large for DirectX 12");
+
+    mVertices.resize(static_cast<size_t>(sizeInBytes));
+
+    const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+
+    auto const desc = CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes);
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &desc,
+        c_initialCopyTargetState,
+        nullptr,
+        IID_GRAPHICS_PPV_ARGS(mVertexBuffer.ReleaseAndGetAddressOf())
+    ));
+
+    SetDebugObjectName(mVertexBuffer.Get(), L"RetainedLineList");
+}
+
+
+// Uploads the dirty pages, coalescing adjacent ones into a single copy.
+void RetainedLineListBase::Impl::Update(_In_ ID3D12GraphicsCommandList* commandList)
+{
+    if (!mDirty.IsDirty())
+        return;
+
+    const size_t uploadSize = mDirty.ForEachRange(mLineCount, [](size_t, size_t) noexcept {}) * mLineSize;
+
+    if (uploadSize > 0)
+    {
+        auto upload = GraphicsMemory::Get(mDevice.Get()).Allocate(uploadSize, 16, GraphicsMemory::TAG_VERTEX);
+
+        TransitionResource(commandList, mVertexBuffer.Get(), mState, D3D12_RESOURCE_STATE_COPY_DEST);
+
+        size_t uploadOffset = 0;
+        mDirty.ForEachRange(mLineCount, [&](size_t firstLine, size_t lineCount)
+            {
+                const size_t offset = firstLine * mLineSize;
+                const size_t size = lineCount * mLineSize;
+
+                memcpy(static_cast<uint8_t*>(upload.Memory()) + uploadOffset, mVertices.data() + offset, size);
+
+                commandList->CopyBufferRegion(mVertexBuffer.Get(), offset,
+                    upload.Resource(), upload.ResourceOffset() + uploadOffset, size);
+
+                uploadOffset += size;
+            });
+
+        TransitionResource(commandList, mVertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+        mState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+    }
+
+    mDirty.Clear();
+}
+
+
+void RetainedLineListBase::Impl::Draw(_In_ ID3D12GraphicsCommandList* commandList) const
+{
+    if (!mLineCount)
+        return;
+
+    if (mState != D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)
+        throw std::logic_error("Update must be called before Draw");
+
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    vbv.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
+    vbv.SizeInBytes = static_cast<UINT>(mLineSize * mLineCount);
+    vbv.StrideInBytes = static_cast<UINT>(mVertexSize);
+
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
+    commandList->IASetVertexBuffers(0, 1, &vbv);
+    commandList->DrawInstanced(static_cast<UINT>(mLineCount * 2), 1, 0, 0);
+}
+
+
+void* RetainedLineListBase::Impl::Write(size_t firstLine, size_t lineCount)
+{
+    if (firstLine > mLineCount)
+        throw std::out_of_range("Lines must be added without gaps");
+
+    if (lineCount > mMaxLines - firstLine)
+        throw std::out_of_range("Too many lines");
+
+    mDirty.MarkDirty(firstLine, lineCount);
+    mLineCount = std::max(mLineCount, firstLine + lineCount);
+
+    return mVertices.data() + firstLine * mLineSize;
+}
+
+
+void RetainedLineListBase::Impl::SetLineCount(size_t lineCount)
+{
+    if (lineCount > mLineCount)
+        throw std::out_of_range("SetLineCount can only remove lines");
+
+    mLineCount = lineCount;
+}
+
+
+// Public constructor.
+RetainedLineListBase::RetainedLineListBase(_In_ ID3D12Device* device, size_t maxLines, size_t linesPerPage, float fullUpdateThreshold, size_t vertexSize)
+    : pImpl(std::make_unique<Impl>(device, maxLines, linesPerPage, fullUpdateThreshold, vertexSize))
+{
+}
+
+
+RetainedLineListBase::RetainedLineListBase(RetainedLineListBase&&) noexcept = default;
+RetainedLineListBase& RetainedLineListBase::operator= (RetainedLineListBase&&) noexcept = default;
+RetainedLineListBase::~RetainedLineListBase() = default;
+
+
+void RetainedLineListBase::Update(_In_ ID3D12GraphicsCommandList* commandList)
+{
+    pImpl->Update(commandList);
+}
+
+
+void RetainedLineListBase::Draw(_In_ ID3D12GraphicsCommandList* commandList) const
+{
+    pImpl->Draw(commandList);
+}
+
+
+size_t RetainedLineListBase::GetLineCount() const noexcept
+{
+    return pImpl->mLineCount;
+}
+
+
+size_t RetainedLineListBase::GetMaxLines() const noexcept
+{
+    return pImpl->mMaxLines;
+}
+
+
+size_t RetainedLineListBase::GetDirtyPageCount() const noexcept
+{
+    return pImpl->mDirty.GetDirtyPageCount();
+}
+
+
+void RetainedLineListBase::SetLineCount(size_t lineCount)
+{
+    pImpl->SetLineCount(lineCount);
+}
+
+
+void RetainedLineListBase::Clear() noexcept
+{
+    pImpl->mLineCount = 0;
+    pImpl->mDirty.Clear();
+}
+
+
+void* RetainedLineListBase::Write(size_t firstLine, size_t lineCount)
+{
+    return pImpl->Write(firstLine, lineCount);
+}
+
+
+void const* RetainedLineListBase::GetVertices() const noexcept
+{
+    return pImpl->mVertices.data();
+}
@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------------------
+// File: SALFallback.h
+//
+// Lets the platform-neutral helpers build without the Windows SDK. The Windows SDK and
+// the non-Windows DirectXMath package both supply <sal.h>; without one, the annotations
+// those helpers use expand to nothing.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _WIN32
+#include <sal.h>
+#elif __has_include(<sal.h>)
+#include <sal.h>
+#endif
+
+#ifndef _In_
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _Inexpressible_(s)
+#define _In_reads_(s)
+#define _In_reads_opt_(s)
+#define _In_reads_bytes_(s)
+#define _Inout_
+#define _Inout_updates_(s)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(s)
+#define _Out_writes_opt_(s)
+#define _Out_writes_bytes_(s)
+#define _Out_writes_all_(s)
+#define _Outptr_
+#define _Outptr_result_maybenull_
+#define _Ret_maybenull_
+#define _Use_decl_annotations_
+#define _Analysis_assume_(e)
+#endif
@@ -28,31 +28,83 @@
 #include "PlatformHelpers.h"
 #include "DDS.h"
 #include "LoaderHelpers.h"
+#include "PixelConversion.h"
+#include "BCEncoder.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 using namespace DirectX::LoaderHelpers;
 
+namespace DirectX
+{
+    inline namespace DX12
+    {
+        namespace Internal
+        {
+            extern IWICImagingFactory2* GetWIC() noexcept;
+        }
+    }
+}
+
 namespace
 {
+    constexpr size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+    // Image rows are repacked and written in bands of about this size, so the whole image is never copied.
+    constexpr size_t c_writeBandSize = 1024 * 1024;
+
+    // Compressed captures are expanded to RGBA8 for the encoder in bands of about this size.
+    constexpr size_t c_encodeBandSize = 4 * 1024 * 1024;
+
     //--------------------------------------------------------------------------------------
-    HRESULT CaptureTexture(_In_ ID3D12Device* device,
-        _In_ ID3D12CommandQueue* pCommandQ,
-        _In_ ID3D12Resource* pSource,
-        UINT64 srcPitch,
+    HRESULT GetReadbackPitch(
+        _In_ ID3D12Device* device,
         const D3D12_RESOURCE_DESC& desc,
-        _COM_Outptr_ ID3D12Resource** pStaging,
-        D3D12_RESOURCE_STATES beforeState,
-        D3D12_RESOURCE_STATES afterState) noexcept
+        _Out_ UINT64& dstRowPitch,
+        _Out_ UINT& rowCount) noexcept
     {
-        if (pStaging)
-        {
-            *pStaging = nullptr;
-        }
+        dstRowPitch = 0;
+        rowCount = 0;
 
-        if (!pCommandQ || !pSource || !pStaging)
+        if (desc.Width > UINT32_MAX)
             return E_INVALIDARG;
 
+        UINT64 totalResourceSize = 0;
+        UINT64 fpRowPitch = 0;
+        UINT fpRowCount = 0;
+        // Get the rowcount, pitch and size of the top mip
+        device->GetCopyableFootprints(
+            &desc,
+            0,
+            1,
+            0,
+            nullptr,
+            &fpRowCount,
+            &fpRowPitch,
+            &totalResourceSize);
+
+    #if (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
+        // Round up the srcPitch to multiples of 1024
+        dstRowPitch = (fpRowPitch + static_cast<uint64_t>(D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT) - 1u) & ~(static_cast<uint64_t>(D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT) - 1u);
+    #else
+        // Round up the srcPitch to multiples of 256 (D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)
+        dstRowPitch = (fpRowPitch + 255) & ~0xFFu;
+    #endif
+
+        if (dstRowPitch > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        rowCount = fpRowCount;
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    HRESULT ValidateCapture(
+        _In_ ID3D12Device* device,
+        const D3D12_RESOURCE_DESC& desc,
+        UINT64 srcPitch) noexcept
+    {
         if (desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
         {
             DebugTrace("ERROR: ScreenGrab does not support 1D or volume textures. Consider using DirectXTex instead.\n");
@@ -71,43 +123,23 @@ namespace
         if (numberOfPlanes != 1)
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-        D3D12_HEAP_PROPERTIES sourceHeapProperties;
-        HRESULT hr = pSource->GetHeapProperties(&sourceHeapProperties, nullptr);
-        if (SUCCEEDED(hr) && sourceHeapProperties.Type == D3D12_HEAP_TYPE_READBACK)
-        {
-            // Handle case where the source is already a staging texture we can use directly
-            *pStaging = pSource;
-            pSource->AddRef();
-            return S_OK;
-        }
-
-        // Create a command allocator
-        ComPtr<ID3D12CommandAllocator> commandAlloc;
-        hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_GRAPHICS_PPV_ARGS(commandAlloc.GetAddressOf()));
-        if (FAILED(hr))
-            return hr;
-
-        SetDebugObjectName(commandAlloc.Get(), L"ScreenGrab");
-
-        // Spin up a new command list
-        ComPtr<ID3D12GraphicsCommandList> commandList;
-        hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAlloc.Get(), nullptr, IID_GRAPHICS_PPV_ARGS(commandList.GetAddressOf()));
-        if (FAILED(hr))
-            return hr;
-
-        SetDebugObjectName(commandList.Get(), L"ScreenGrab");
-
-        // Create a fence
-        ComPtr<ID3D12Fence> fence;
-        hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(fence.GetAddressOf()));
-        if (FAILED(hr))
-            return hr;
-
-        SetDebugObjectName(fence.Get(), L"ScreenGrab");
+        return S_OK;
+    }
 
-        assert((srcPitch & 0xFF) == 0);
+    //--------------------------------------------------------------------------------------
+    bool IsReadbackResource(_In_ ID3D12Resource* pSource) noexcept
+    {
+        D3D12_HEAP_PROPERTIES sourceHeapProperties;
+        const HRESULT hr = pSource->GetHeapProperties(&sourceHeapProperties, nullptr);
+        return SUCCEEDED(hr) && sourceHeapProperties.Type == D3D12_HEAP_TYPE_READBACK;
+    }
 
-        const CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+    //--------------------------------------------------------------------------------------
+    HRESULT CreateReadbackBuffer(
+        _In_ ID3D12Device* device,
+        UINT64 size,
+        _COM_Outptr_ ID3D12Resource** pStaging) noexcept
+    {
         const CD3DX12_HEAP_PROPERTIES readBackHeapProperties(D3D12_HEAP_TYPE_READBACK);
 
         // Readback resources must be buffers
@@ -117,14 +149,50 @@ namespace
         bufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
         bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
         bufferDesc.Height = 1;
-        bufferDesc.Width = srcPitch * desc.Height;
+        bufferDesc.Width = size;
         bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
         bufferDesc.MipLevels = 1;
         bufferDesc.SampleDesc.Count = 1;
 
+        // Create a staging texture
+        const HRESULT hr = device->CreateCommittedResource(
+            &readBackHeapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &bufferDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_GRAPHICS_PPV_ARGS(pStaging));
+        if (FAILED(hr))
+            return hr;
+
+        SetDebugObjectName(*pStaging, L"ScreenGrab staging");
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Records the copy of the top surface into a readback buffer. MSAA sources are resolved first
+    // into pResolved, which must be kept alive until the command list has executed.
+    HRESULT RecordCapture(
+        _In_ ID3D12Device* device,
+        _In_ ID3D12GraphicsCommandList* commandList,
+        _In_ ID3D12Resource* pSource,
+        UINT64 srcPitch,
+        const D3D12_RESOURCE_DESC& desc,
+        _In_ ID3D12Resource* pStaging,
+        D3D12_RESOURCE_STATES beforeState,
+        D3D12_RESOURCE_STATES afterState,
+        _COM_Outptr_result_maybenull_ ID3D12Resource** pResolved) noexcept
+    {
+        *pResolved = nullptr;
+
+        assert((srcPitch & 0xFF) == 0);
+
         ComPtr<ID3D12Resource> copySource(pSource);
         if (desc.SampleDesc.Count > 1)
         {
+            const CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+
             // MSAA content must be resolved before being copied to a staging texture
             auto descCopy = desc;
             descCopy.SampleDesc.Count = 1;
@@ -132,7 +200,7 @@ namespace
             descCopy.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
 
             ComPtr<ID3D12Resource> pTemp;
-            hr = device->CreateCommittedResource(
+            HRESULT hr = device->CreateCommittedResource(
                 &defaultHeapProperties,
                 D3D12_HEAP_FLAG_NONE,
                 &descCopy,
@@ -166,25 +234,11 @@ namespace
             }
 
             copySource = pTemp;
+            *pResolved = pTemp.Detach();
         }
 
-        // Create a staging texture
-        hr = device->CreateCommittedResource(
-            &readBackHeapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &bufferDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_GRAPHICS_PPV_ARGS(pStaging));
-        if (FAILED(hr))
-            return hr;
-
-        SetDebugObjectName(*pStaging, L"ScreenGrab staging");
-
-        assert(*pStaging);
-
         // Transition the resource if necessary
-        TransitionResource(commandList.Get(), pSource, beforeState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        TransitionResource(commandList, pSource, beforeState, D3D12_RESOURCE_STATE_COPY_SOURCE);
 
         // Get the copy target location
         D3D12_PLACED_SUBRESOURCE_FOOTPRINT bufferFootprint = {};
@@ -194,14 +248,82 @@ namespace
         bufferFootprint.Footprint.RowPitch = static_cast<UINT>(srcPitch);
         bufferFootprint.Footprint.Format = desc.Format;
 
-        const CD3DX12_TEXTURE_COPY_LOCATION copyDest(*pStaging, bufferFootprint);
+        const CD3DX12_TEXTURE_COPY_LOCATION copyDest(pStaging, bufferFootprint);
         const CD3DX12_TEXTURE_COPY_LOCATION copySrc(copySource.Get(), 0);
 
         // Copy the texture
         commandList->CopyTextureRegion(&copyDest, 0, 0, 0, &copySrc, nullptr);
 
         // Transition the resource to the next state
-        TransitionResource(commandList.Get(), pSource, D3D12_RESOURCE_STATE_COPY_SOURCE, afterState);
+        TransitionResource(commandList, pSource, D3D12_RESOURCE_STATE_COPY_SOURCE, afterState);
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    HRESULT CaptureTexture(_In_ ID3D12Device* device,
+        _In_ ID3D12CommandQueue* pCommandQ,
+        _In_ ID3D12Resource* pSource,
+        UINT64 srcPitch,
+        const D3D12_RESOURCE_DESC& desc,
+        _COM_Outptr_ ID3D12Resource** pStaging,
+        D3D12_RESOURCE_STATES beforeState,
+        D3D12_RESOURCE_STATES afterState) noexcept
+    {
+        if (pStaging)
+        {
+            *pStaging = nullptr;
+        }
+
+        if (!pCommandQ || !pSource || !pStaging)
+            return E_INVALIDARG;
+
+        HRESULT hr = ValidateCapture(device, desc, srcPitch);
+        if (FAILED(hr))
+            return hr;
+
+        if (IsReadbackResource(pSource))
+        {
+            // Handle case where the source is already a staging texture we can use directly
+            *pStaging = pSource;
+            pSource->AddRef();
+            return S_OK;
+        }
+
+        // Create a command allocator
+        ComPtr<ID3D12CommandAllocator> commandAlloc;
+        hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_GRAPHICS_PPV_ARGS(commandAlloc.GetAddressOf()));
+        if (FAILED(hr))
+            return hr;
+
+        SetDebugObjectName(commandAlloc.Get(), L"ScreenGrab");
+
+        // Spin up a new command list
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAlloc.Get(), nullptr, IID_GRAPHICS_PPV_ARGS(commandList.GetAddressOf()));
+        if (FAILED(hr))
+            return hr;
+
+        SetDebugObjectName(commandList.Get(), L"ScreenGrab");
+
+        // Create a fence
+        ComPtr<ID3D12Fence> fence;
+        hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(fence.GetAddressOf()));
+        if (FAILED(hr))
+            return hr;
+
+        SetDebugObjectName(fence.Get(), L"ScreenGrab");
+
+        hr = CreateReadbackBuffer(device, srcPitch * desc.Height, pStaging);
+        if (FAILED(hr))
+            return hr;
+
+        assert(*pStaging);
+
+        ComPtr<ID3D12Resource> resolved;
+        hr = RecordCapture(device, commandList.Get(), pSource, srcPitch, desc, *pStaging, beforeState, afterState, resolved.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
 
         hr = commandList->Close();
         if (FAILED(hr))
@@ -221,235 +343,942 @@ namespace
 
         return S_OK;
     }
-} // anonymous namespace
 
+    //--------------------------------------------------------------------------------------
+    HRESULT GetDDSHeader(
+        const D3D12_RESOURCE_DESC& desc,
+        _Out_writes_bytes_(MAX_HEADER_SIZE) uint8_t* fileHeader,
+        _Out_ size_t& headerSize) noexcept
+    {
+        memset(fileHeader, 0, MAX_HEADER_SIZE);
 
-//--------------------------------------------------------------------------------------
-_Use_decl_annotations_
-HRESULT DirectX::SaveDDSTextureToFile(
-    ID3D12CommandQueue* pCommandQ,
-    ID3D12Resource* pSource,
-    const wchar_t* fileName,
-    D3D12_RESOURCE_STATES beforeState,
-    D3D12_RESOURCE_STATES afterState) noexcept
-{
-    if (!fileName)
-        return E_INVALIDARG;
+        *reinterpret_cast<uint32_t*>(&fileHeader[0]) = DDS_MAGIC;
 
-    ComPtr<ID3D12Device> device;
-    pCommandQ->GetDevice(IID_GRAPHICS_PPV_ARGS(device.GetAddressOf()));
+        auto header = reinterpret_cast<DDS_HEADER*>(&fileHeader[0] + sizeof(uint32_t));
+        headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        header->size = sizeof(DDS_HEADER);
+        header->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+        header->height = desc.Height;
+        header->width = static_cast<uint32_t>(desc.Width);
+        header->mipMapCount = 1;
+        header->caps = DDS_SURFACE_FLAGS_TEXTURE;
 
-    // Get the size of the image
-#if defined(_MSC_VER) || !defined(_WIN32)
-    const auto desc = pSource->GetDesc();
-#else
-    D3D12_RESOURCE_DESC tmpDesc;
-    const auto& desc = *pSource->GetDesc(&tmpDesc);
-#endif
+        // Try to use a legacy .DDS pixel format for better tools support, otherwise fallback to 'DX10' header extension
+        DDS_HEADER_DXT10* extHeader = nullptr;
+        switch (desc.Format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:        memcpy(&header->ddspf, &DDSPF_A8B8G8R8, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_R16G16_UNORM:          memcpy(&header->ddspf, &DDSPF_G16R16, sizeof(DDS_PIXELFORMAT));      break;
+        case DXGI_FORMAT_R8G8_UNORM:            memcpy(&header->ddspf, &DDSPF_A8L8, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_R16_UNORM:             memcpy(&header->ddspf, &DDSPF_L16, sizeof(DDS_PIXELFORMAT));         break;
+        case DXGI_FORMAT_R8_UNORM:              memcpy(&header->ddspf, &DDSPF_L8, sizeof(DDS_PIXELFORMAT));          break;
+        case DXGI_FORMAT_A8_UNORM:              memcpy(&header->ddspf, &DDSPF_A8, sizeof(DDS_PIXELFORMAT));          break;
+        case DXGI_FORMAT_R8G8_B8G8_UNORM:       memcpy(&header->ddspf, &DDSPF_R8G8_B8G8, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_G8R8_G8B8_UNORM:       memcpy(&header->ddspf, &DDSPF_G8R8_G8B8, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC1_UNORM:             memcpy(&header->ddspf, &DDSPF_DXT1, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_BC2_UNORM:             memcpy(&header->ddspf, &DDSPF_DXT3, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_BC3_UNORM:             memcpy(&header->ddspf, &DDSPF_DXT5, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_BC4_UNORM:             memcpy(&header->ddspf, &DDSPF_BC4_UNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC4_SNORM:             memcpy(&header->ddspf, &DDSPF_BC4_SNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC5_UNORM:             memcpy(&header->ddspf, &DDSPF_BC5_UNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_BC5_SNORM:             memcpy(&header->ddspf, &DDSPF_BC5_SNORM, sizeof(DDS_PIXELFORMAT));   break;
+        case DXGI_FORMAT_B5G6R5_UNORM:          memcpy(&header->ddspf, &DDSPF_R5G6B5, sizeof(DDS_PIXELFORMAT));      break;
+        case DXGI_FORMAT_B5G5R5A1_UNORM:        memcpy(&header->ddspf, &DDSPF_A1R5G5B5, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_R8G8_SNORM:            memcpy(&header->ddspf, &DDSPF_V8U8, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_R8G8B8A8_SNORM:        memcpy(&header->ddspf, &DDSPF_Q8W8V8U8, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_R16G16_SNORM:          memcpy(&header->ddspf, &DDSPF_V16U16, sizeof(DDS_PIXELFORMAT));      break;
+        case DXGI_FORMAT_B8G8R8A8_UNORM:        memcpy(&header->ddspf, &DDSPF_A8R8G8B8, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_B8G8R8X8_UNORM:        memcpy(&header->ddspf, &DDSPF_X8R8G8B8, sizeof(DDS_PIXELFORMAT));    break;
+        case DXGI_FORMAT_YUY2:                  memcpy(&header->ddspf, &DDSPF_YUY2, sizeof(DDS_PIXELFORMAT));        break;
+        case DXGI_FORMAT_B4G4R4A4_UNORM:        memcpy(&header->ddspf, &DDSPF_A4R4G4B4, sizeof(DDS_PIXELFORMAT));    break;
+
+            // Legacy D3DX formats using D3DFMT enum value as FourCC
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 116; break; // D3DFMT_A32B32G32R32F
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 113; break; // D3DFMT_A16B16G16R16F
+        case DXGI_FORMAT_R16G16B16A16_UNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 36;  break; // D3DFMT_A16B16G16R16
+        case DXGI_FORMAT_R16G16B16A16_SNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 110; break; // D3DFMT_Q16W16V16U16
+        case DXGI_FORMAT_R32G32_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 115; break; // D3DFMT_G32R32F
+        case DXGI_FORMAT_R16G16_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 112; break; // D3DFMT_G16R16F
+        case DXGI_FORMAT_R32_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 114; break; // D3DFMT_R32F
+        case DXGI_FORMAT_R16_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 111; break; // D3DFMT_R16F
+
+        case DXGI_FORMAT_AI44:
+        case DXGI_FORMAT_IA44:
+        case DXGI_FORMAT_P8:
+        case DXGI_FORMAT_A8P8:
+            DebugTrace("ERROR: ScreenGrab does not support video textures. Consider using DirectXTex.\n");
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-    if (desc.Width > UINT32_MAX)
-        return E_INVALIDARG;
+        default:
+            memcpy(&header->ddspf, &DDSPF_DX10, sizeof(DDS_PIXELFORMAT));
 
-    UINT64 totalResourceSize = 0;
-    UINT64 fpRowPitch = 0;
-    UINT fpRowCount = 0;
-    // Get the rowcount, pitch and size of the top mip
-    device->GetCopyableFootprints(
-        &desc,
-        0,
-        1,
-        0,
-        nullptr,
-        &fpRowCount,
-        &fpRowPitch,
-        &totalResourceSize);
-
-#if (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
-    // Round up the srcPitch to multiples of 1024
-    const UINT64 dstRowPitch = (fpRowPitch + static_cast<uint64_t>(D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT) - 1u) & ~(static_cast<uint64_t>(D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT) - 1u);
-#else
-    // Round up the srcPitch to multiples of 256
-    const UINT64 dstRowPitch = (fpRowPitch + 255) & ~0xFFu;
-#endif
+            headerSize += sizeof(DDS_HEADER_DXT10);
+            extHeader = reinterpret_cast<DDS_HEADER_DXT10*>(fileHeader + sizeof(uint32_t) + sizeof(DDS_HEADER));
+            extHeader->dxgiFormat = desc.Format;
+            extHeader->resourceDimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+            extHeader->arraySize = 1;
+            break;
+        }
 
-    if (dstRowPitch > UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+        size_t rowPitch, slicePitch, rowCount;
+        const HRESULT hr = GetSurfaceInfo(static_cast<size_t>(desc.Width), desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
+        if (FAILED(hr))
+            return hr;
 
-    ComPtr<ID3D12Resource> pStaging;
-    HRESULT hr = CaptureTexture(device.Get(), pCommandQ, pSource, dstRowPitch, desc, pStaging.GetAddressOf(), beforeState, afterState);
-    if (FAILED(hr))
-        return hr;
+        if (rowPitch > UINT32_MAX || slicePitch > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-    // Create file
-    ScopedHandle hFile(safe_handle(CreateFile2(
-        fileName,
-        GENERIC_WRITE, 0, CREATE_ALWAYS,
-        nullptr)));
-    if (!hFile)
-        return HRESULT_FROM_WIN32(GetLastError());
+        if (IsCompressed(desc.Format))
+        {
+            header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
+            header->pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
+        }
+        else
+        {
+            header->flags |= DDS_HEADER_FLAGS_PITCH;
+            header->pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
+        }
 
-    auto_delete_file delonfail(hFile.get());
+        return S_OK;
+    }
 
-    // Setup header
-    constexpr size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
-    uint8_t fileHeader[MAX_HEADER_SIZE] = {};
-
-    *reinterpret_cast<uint32_t*>(&fileHeader[0]) = DDS_MAGIC;
-
-    auto header = reinterpret_cast<DDS_HEADER*>(&fileHeader[0] + sizeof(uint32_t));
-    size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
-    header->size = sizeof(DDS_HEADER);
-    header->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
-    header->height = desc.Height;
-    header->width = static_cast<uint32_t>(desc.Width);
-    header->mipMapCount = 1;
-    header->caps = DDS_SURFACE_FLAGS_TEXTURE;
-
-    // Try to use a legacy .DDS pixel format for better tools support, otherwise fallback to 'DX10' header extension
-    DDS_HEADER_DXT10* extHeader = nullptr;
-    switch (desc.Format)
+    //--------------------------------------------------------------------------------------
+    // Writes the top surface of desc from an image in memory whose rows are srcPitch bytes apart.
+    HRESULT WriteDDSFile(
+        _In_z_ const wchar_t* fileName,
+        const D3D12_RESOURCE_DESC& desc,
+        _In_reads_bytes_(headerSize) const uint8_t* fileHeader,
+        size_t headerSize,
+        _In_ const uint8_t* pixels,
+        size_t srcPitch) noexcept
     {
-    case DXGI_FORMAT_R8G8B8A8_UNORM:        memcpy(&header->ddspf, &DDSPF_A8B8G8R8, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_R16G16_UNORM:          memcpy(&header->ddspf, &DDSPF_G16R16, sizeof(DDS_PIXELFORMAT));      break;
-    case DXGI_FORMAT_R8G8_UNORM:            memcpy(&header->ddspf, &DDSPF_A8L8, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_R16_UNORM:             memcpy(&header->ddspf, &DDSPF_L16, sizeof(DDS_PIXELFORMAT));         break;
-    case DXGI_FORMAT_R8_UNORM:              memcpy(&header->ddspf, &DDSPF_L8, sizeof(DDS_PIXELFORMAT));          break;
-    case DXGI_FORMAT_A8_UNORM:              memcpy(&header->ddspf, &DDSPF_A8, sizeof(DDS_PIXELFORMAT));          break;
-    case DXGI_FORMAT_R8G8_B8G8_UNORM:       memcpy(&header->ddspf, &DDSPF_R8G8_B8G8, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_G8R8_G8B8_UNORM:       memcpy(&header->ddspf, &DDSPF_G8R8_G8B8, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC1_UNORM:             memcpy(&header->ddspf, &DDSPF_DXT1, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_BC2_UNORM:             memcpy(&header->ddspf, &DDSPF_DXT3, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_BC3_UNORM:             memcpy(&header->ddspf, &DDSPF_DXT5, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_BC4_UNORM:             memcpy(&header->ddspf, &DDSPF_BC4_UNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC4_SNORM:             memcpy(&header->ddspf, &DDSPF_BC4_SNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC5_UNORM:             memcpy(&header->ddspf, &DDSPF_BC5_UNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_BC5_SNORM:             memcpy(&header->ddspf, &DDSPF_BC5_SNORM, sizeof(DDS_PIXELFORMAT));   break;
-    case DXGI_FORMAT_B5G6R5_UNORM:          memcpy(&header->ddspf, &DDSPF_R5G6B5, sizeof(DDS_PIXELFORMAT));      break;
-    case DXGI_FORMAT_B5G5R5A1_UNORM:        memcpy(&header->ddspf, &DDSPF_A1R5G5B5, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_R8G8_SNORM:            memcpy(&header->ddspf, &DDSPF_V8U8, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_R8G8B8A8_SNORM:        memcpy(&header->ddspf, &DDSPF_Q8W8V8U8, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_R16G16_SNORM:          memcpy(&header->ddspf, &DDSPF_V16U16, sizeof(DDS_PIXELFORMAT));      break;
-    case DXGI_FORMAT_B8G8R8A8_UNORM:        memcpy(&header->ddspf, &DDSPF_A8R8G8B8, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_B8G8R8X8_UNORM:        memcpy(&header->ddspf, &DDSPF_X8R8G8B8, sizeof(DDS_PIXELFORMAT));    break;
-    case DXGI_FORMAT_YUY2:                  memcpy(&header->ddspf, &DDSPF_YUY2, sizeof(DDS_PIXELFORMAT));        break;
-    case DXGI_FORMAT_B4G4R4A4_UNORM:        memcpy(&header->ddspf, &DDSPF_A4R4G4B4, sizeof(DDS_PIXELFORMAT));    break;
-
-        // Legacy D3DX formats using D3DFMT enum value as FourCC
-    case DXGI_FORMAT_R32G32B32A32_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 116; break; // D3DFMT_A32B32G32R32F
-    case DXGI_FORMAT_R16G16B16A16_FLOAT:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 113; break; // D3DFMT_A16B16G16R16F
-    case DXGI_FORMAT_R16G16B16A16_UNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 36;  break; // D3DFMT_A16B16G16R16
-    case DXGI_FORMAT_R16G16B16A16_SNORM:    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 110; break; // D3DFMT_Q16W16V16U16
-    case DXGI_FORMAT_R32G32_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 115; break; // D3DFMT_G32R32F
-    case DXGI_FORMAT_R16G16_FLOAT:          header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 112; break; // D3DFMT_G16R16F
-    case DXGI_FORMAT_R32_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 114; break; // D3DFMT_R32F
-    case DXGI_FORMAT_R16_FLOAT:             header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 111; break; // D3DFMT_R16F
-
-    case DXGI_FORMAT_AI44:
-    case DXGI_FORMAT_IA44:
-    case DXGI_FORMAT_P8:
-    case DXGI_FORMAT_A8P8:
-        DebugTrace("ERROR: ScreenGrab does not support video textures. Consider using DirectXTex.\n");
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
-    default:
-        memcpy(&header->ddspf, &DDSPF_DX10, sizeof(DDS_PIXELFORMAT));
-
-        headerSize += sizeof(DDS_HEADER_DXT10);
-        extHeader = reinterpret_cast<DDS_HEADER_DXT10*>(fileHeader + sizeof(uint32_t) + sizeof(DDS_HEADER));
-        extHeader->dxgiFormat = desc.Format;
-        extHeader->resourceDimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-        extHeader->arraySize = 1;
-        break;
-    }
+        size_t rowPitch, slicePitch, rowCount;
+        HRESULT hr = GetSurfaceInfo(static_cast<size_t>(desc.Width), desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
+        if (FAILED(hr))
+            return hr;
 
-    size_t rowPitch, slicePitch, rowCount;
-    hr = GetSurfaceInfo(static_cast<size_t>(desc.Width), desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount);
-    if (FAILED(hr))
-        return hr;
+        // Create file
+        ScopedHandle hFile(safe_handle(CreateFile2(
+            fileName,
+            GENERIC_WRITE, 0, CREATE_ALWAYS,
+            nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
 
-    if (rowPitch > UINT32_MAX || slicePitch > UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+        auto_delete_file delonfail(hFile.get());
 
-    if (IsCompressed(desc.Format))
-    {
-        header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
-        header->pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
-    }
-    else
-    {
-        header->flags |= DDS_HEADER_FLAGS_PITCH;
-        header->pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
-    }
+        // Write header
+        DWORD bytesWritten;
+        if (!WriteFile(hFile.get(), fileHeader, static_cast<DWORD>(headerSize), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
 
-    // Setup pixels
-    std::unique_ptr<uint8_t[]> pixels(new (std::nothrow) uint8_t[slicePitch]);
-    if (!pixels)
-        return E_OUTOFMEMORY;
+        if (bytesWritten != headerSize)
+            return E_FAIL;
 
-    assert(fpRowCount == rowCount);
-    assert(fpRowPitch == rowPitch);
+        // Write pixels, dropping the row padding a band at a time
+        const size_t bandRows = std::min(std::max<size_t>(c_writeBandSize / rowPitch, 1), rowCount);
+        std::unique_ptr<uint8_t[]> band(new (std::nothrow) uint8_t[bandRows * rowPitch]);
+        if (!band)
+            return E_OUTOFMEMORY;
 
-    const UINT64 imageSize = dstRowPitch * UINT64(rowCount);
-    if (imageSize > UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+        assert(rowPitch <= srcPitch);
+        const size_t msize = std::min(rowPitch, srcPitch);
 
-    void* pMappedMemory = nullptr;
-    D3D12_RANGE readRange = { 0, static_cast<SIZE_T>(imageSize) };
-    D3D12_RANGE writeRange = { 0, 0 };
-    hr = pStaging->Map(0, &readRange, &pMappedMemory);
-    if (FAILED(hr))
-        return hr;
+        const uint8_t* sptr = pixels;
+        for (size_t h = 0; h < rowCount; h += bandRows)
+        {
+            const size_t rows = std::min(bandRows, rowCount - h);
 
-    auto sptr = static_cast<const uint8_t*>(pMappedMemory);
-    if (!sptr)
-    {
-        pStaging->Unmap(0, &writeRange);
-        return E_POINTER;
-    }
+            uint8_t* dptr = band.get();
+            for (size_t j = 0; j < rows; ++j)
+            {
+                memcpy(dptr, sptr, msize);
+                sptr += srcPitch;
+                dptr += rowPitch;
+            }
 
-    uint8_t* dptr = pixels.get();
+            const auto bytes = static_cast<DWORD>(rows * rowPitch);
+            if (!WriteFile(hFile.get(), band.get(), bytes, &bytesWritten, nullptr))
+                return HRESULT_FROM_WIN32(GetLastError());
 
-    const size_t msize = std::min<size_t>(rowPitch, size_t(dstRowPitch));
-    for (size_t h = 0; h < rowCount; ++h)
-    {
-        memcpy(dptr, sptr, msize);
-        sptr += dstRowPitch;
-        dptr += rowPitch;
-    }
+            if (bytesWritten != bytes)
+                return E_FAIL;
+        }
 
-    pStaging->Unmap(0, &writeRange);
+        delonfail.clear();
 
-    // Write header & pixels
-    DWORD bytesWritten;
-    if (!WriteFile(hFile.get(), fileHeader, static_cast<DWORD>(headerSize), &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Validates a compressed capture of desc and builds the header for it. The block format is
+    // given the _SRGB variant when the source is sRGB, since the pixels are encoded unconverted.
+    HRESULT GetCompressedDDSHeader(
+        const D3D12_RESOURCE_DESC& desc,
+        DXGI_FORMAT compressFormat,
+        _Out_ BCEncode::Format& bcFormat,
+        _Out_writes_bytes_(MAX_HEADER_SIZE) uint8_t* fileHeader,
+        _Out_ size_t& headerSize) noexcept
+    {
+        bcFormat = BCEncode::Format::BC1;
+        headerSize = 0;
+
+        bool srgb = false;
+        switch (desc.Format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            srgb = true;
+            break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            break;
+
+        default:
+            DebugTrace("ERROR: ScreenGrab can only compress 8-bit RGBA/BGRA or float RGBA textures (DXGI_FORMAT %u)\n",
+                static_cast<uint32_t>(desc.Format));
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        DXGI_FORMAT targetFormat = DXGI_FORMAT_UNKNOWN;
+        switch (compressFormat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            bcFormat = BCEncode::Format::BC1;
+            targetFormat = srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+            break;
+
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            bcFormat = BCEncode::Format::BC3;
+            targetFormat = srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+            break;
+
+        case DXGI_FORMAT_BC4_UNORM:
+            bcFormat = BCEncode::Format::BC4;
+            targetFormat = DXGI_FORMAT_BC4_UNORM;
+            break;
+
+        case DXGI_FORMAT_BC5_UNORM:
+            bcFormat = BCEncode::Format::BC5;
+            targetFormat = DXGI_FORMAT_BC5_UNORM;
+            break;
+
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            bcFormat = BCEncode::Format::BC7;
+            targetFormat = srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+            break;
+
+        default:
+            DebugTrace("ERROR: ScreenGrab can only compress to BC1, BC3, BC4, BC5, or BC7 (DXGI_FORMAT %u)\n",
+                static_cast<uint32_t>(compressFormat));
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        D3D12_RESOURCE_DESC targetDesc = desc;
+        targetDesc.Format = targetFormat;
+        return GetDDSHeader(targetDesc, fileHeader, headerSize);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Converts a row of one of the formats accepted by GetCompressedDDSHeader to RGBA8.
+    void ConvertRowToRGBA8(
+        DXGI_FORMAT format,
+        _Out_writes_bytes_(width * 4) uint8_t* dest,
+        _In_ const uint8_t* src,
+        size_t width) noexcept
+    {
+        using namespace DirectX::PackedVector;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            PixelConversion::SwapRedBlue8(dest, src, width);
+            break;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            PixelConversion::SwapRedBlue8(dest, src, width, true);
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            {
+                auto sptr = reinterpret_cast<const XMHALF4*>(src);
+                auto dptr = reinterpret_cast<XMUBYTEN4*>(dest);
+                for (size_t i = 0; i < width; ++i)
+                {
+                    XMStoreUByteN4(dptr++, XMLoadHalf4(sptr++));
+                }
+            }
+            break;
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            {
+                auto sptr = reinterpret_cast<const XMFLOAT4*>(src);
+                auto dptr = reinterpret_cast<XMUBYTEN4*>(dest);
+                for (size_t i = 0; i < width; ++i)
+                {
+                    XMStoreUByteN4(dptr++, XMLoadFloat4(sptr++));
+                }
+            }
+            break;
+
+        default:
+            memcpy(dest, src, width * 4);
+            break;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Block-compresses the top surface of desc as it is written, a band of block rows at a time.
+    HRESULT WriteCompressedDDSFile(
+        _In_z_ const wchar_t* fileName,
+        const D3D12_RESOURCE_DESC& desc,
+        BCEncode::Format bcFormat,
+        _In_reads_bytes_(headerSize) const uint8_t* fileHeader,
+        size_t headerSize,
+        _In_ const uint8_t* pixels,
+        size_t srcPitch) noexcept
+    {
+        const auto width = static_cast<size_t>(desc.Width);
+        const size_t height = desc.Height;
+        const size_t blockRowPitch = ((width + 3) / 4) * BCEncode::BlockSize(bcFormat);
+        const size_t blockRows = (height + 3) / 4;
+        const size_t rgbaPitch = width * 4;
+
+        // Create file
+        ScopedHandle hFile(safe_handle(CreateFile2(
+            fileName,
+            GENERIC_WRITE, 0, CREATE_ALWAYS,
+            nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        auto_delete_file delonfail(hFile.get());
+
+        // Write header
+        DWORD bytesWritten;
+        if (!WriteFile(hFile.get(), fileHeader, static_cast<DWORD>(headerSize), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != headerSize)
+            return E_FAIL;
+
+        // Each band is large enough to keep every core busy encoding
+        const size_t bandRows = std::min(std::max<size_t>(c_encodeBandSize / (rgbaPitch * 4), 1), blockRows);
+        std::unique_ptr<uint8_t[]> rgba(new (std::nothrow) uint8_t[bandRows * 4 * rgbaPitch]);
+        std::unique_ptr<uint8_t[]> band(new (std::nothrow) uint8_t[bandRows * blockRowPitch]);
+        if (!rgba || !band)
+            return E_OUTOFMEMORY;
+
+        for (size_t by = 0; by < blockRows; by += bandRows)
+        {
+            const size_t rows = std::min(bandRows, blockRows - by);
+            const size_t pixelRows = std::min(rows * 4, height - by * 4);
+
+            const uint8_t* sptr = pixels + by * 4 * srcPitch;
+            for (size_t j = 0; j < pixelRows; ++j)
+            {
+                ConvertRowToRGBA8(desc.Format, rgba.get() + j * rgbaPitch, sptr, width);
+                sptr += srcPitch;
+            }
+
+            try
+            {
+                BCEncode::EncodeImage(bcFormat, rgba.get(), width, pixelRows, rgbaPitch, band.get(), blockRowPitch);
+            }
+            catch (const std::bad_alloc&)
+            {
+                return E_OUTOFMEMORY;
+            }
+            catch (...)
+            {
+                return E_FAIL;
+            }
+
+            const auto bytes = static_cast<DWORD>(rows * blockRowPitch);
+            if (!WriteFile(hFile.get(), band.get(), bytes, &bytesWritten, nullptr))
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            if (bytesWritten != bytes)
+                return E_FAIL;
+        }
+
+        delonfail.clear();
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Determine source format's WIC equivalent
+    HRESULT GetWICPixelFormat(
+        const D3D12_RESOURCE_DESC& desc,
+        bool forceSRGB,
+        _Out_ WICPixelFormatGUID& pfGuid,
+        _Out_ bool& sRGB) noexcept
+    {
+        pfGuid = {};
+        sRGB = forceSRGB;
+
+        switch (desc.Format)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:            pfGuid = GUID_WICPixelFormat128bppRGBAFloat; break;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:            pfGuid = GUID_WICPixelFormat64bppRGBAHalf; break;
+        case DXGI_FORMAT_R16G16B16A16_UNORM:            pfGuid = GUID_WICPixelFormat64bppRGBA; break;
+        case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:    pfGuid = GUID_WICPixelFormat32bppRGBA1010102XR; break;
+        case DXGI_FORMAT_R10G10B10A2_UNORM:             pfGuid = GUID_WICPixelFormat32bppRGBA1010102; break;
+        case DXGI_FORMAT_B5G5R5A1_UNORM:                pfGuid = GUID_WICPixelFormat16bppBGRA5551; break;
+        case DXGI_FORMAT_B5G6R5_UNORM:                  pfGuid = GUID_WICPixelFormat16bppBGR565; break;
+        case DXGI_FORMAT_R32_FLOAT:                     pfGuid = GUID_WICPixelFormat32bppGrayFloat; break;
+        case DXGI_FORMAT_R16_FLOAT:                     pfGuid = GUID_WICPixelFormat16bppGrayHalf; break;
+        case DXGI_FORMAT_R16_UNORM:                     pfGuid = GUID_WICPixelFormat16bppGray; break;
+        case DXGI_FORMAT_R8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppGray; break;
+        case DXGI_FORMAT_A8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppAlpha; break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            pfGuid = GUID_WICPixelFormat32bppRGBA;
+            break;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            pfGuid = GUID_WICPixelFormat32bppRGBA;
+            sRGB = true;
+            break;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            pfGuid = GUID_WICPixelFormat32bppBGRA;
+            break;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            pfGuid = GUID_WICPixelFormat32bppBGRA;
+            sRGB = true;
+            break;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            pfGuid = GUID_WICPixelFormat32bppBGR;
+            break;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            pfGuid = GUID_WICPixelFormat32bppBGR;
+            sRGB = true;
+            break;
+
+        default:
+            DebugTrace("ERROR: ScreenGrab does not support all DXGI formats (%u). Consider using DirectXTex.\n", static_cast<uint32_t>(desc.Format));
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Conversions from the readback formats done without IWICFormatConverter
+    using PixelConvertFunc = void(*)(uint8_t* dest, const uint8_t* src, size_t count);
+
+    template<bool TForceOpaque>
+    void ConvertBGRA8ToRGBA16F(uint8_t* dest, const uint8_t* src, size_t count) noexcept
+    {
+        constexpr size_t c_chunk = 256;
+        uint8_t temp[c_chunk * 4];
+
+        for (size_t i = 0; i < count; i += c_chunk)
+        {
+            const size_t n = std::min(count - i, c_chunk);
+            PixelConversion::SwapRedBlue8(temp, src + i * 4, n, TForceOpaque);
+            PixelConversion::ConvertRGBA8ToRGBA16F(reinterpret_cast<uint16_t*>(dest + i * 8), temp, n, true);
+        }
+    }
+
+    PixelConvertFunc GetFastConvert(const GUID& source, const GUID& target, _Out_ size_t& targetBpp) noexcept
+    {
+        targetBpp = 0;
+
+        if (memcmp(&target, &GUID_WICPixelFormat24bppBGR, sizeof(GUID)) == 0)
+        {
+            targetBpp = 24;
+
+            if (memcmp(&source, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0)
+                return PixelConversion::ConvertRGBA8ToBGR24;
+
+            if (memcmp(&source, &GUID_WICPixelFormat32bppBGRA, sizeof(GUID)) == 0
+                || memcmp(&source, &GUID_WICPixelFormat32bppBGR, sizeof(GUID)) == 0)
+                return PixelConversion::ConvertBGRA8ToBGR24;
+        }
+        else if ((memcmp(&source, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0
+                    && memcmp(&target, &GUID_WICPixelFormat32bppBGRA, sizeof(GUID)) == 0)
+                || (memcmp(&source, &GUID_WICPixelFormat32bppBGRA, sizeof(GUID)) == 0
+                    && memcmp(&target, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0))
+        {
+            targetBpp = 32;
+            return [](uint8_t* dest, const uint8_t* src, size_t count) { PixelConversion::SwapRedBlue8(dest, src, count); };
+        }
+        else if (memcmp(&target, &GUID_WICPixelFormat32bppPRGBA, sizeof(GUID)) == 0
+            || memcmp(&target, &GUID_WICPixelFormat32bppPBGRA, sizeof(GUID)) == 0)
+        {
+            targetBpp = 32;
+
+            const bool targetBGR = memcmp(&target, &GUID_WICPixelFormat32bppPBGRA, sizeof(GUID)) == 0;
+            if (memcmp(&source, targetBGR ? &GUID_WICPixelFormat32bppBGRA : &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0)
+                return PixelConversion::PremultiplyAlpha8;
+
+            if (memcmp(&source, targetBGR ? &GUID_WICPixelFormat32bppRGBA : &GUID_WICPixelFormat32bppBGRA, sizeof(GUID)) == 0)
+            {
+                return [](uint8_t* dest, const uint8_t* src, size_t count)
+                {
+                    PixelConversion::SwapRedBlue8(dest, src, count);
+                    PixelConversion::PremultiplyAlpha8(dest, dest, count);
+                };
+            }
+        }
+        else if (memcmp(&target, &GUID_WICPixelFormat64bppRGBAHalf, sizeof(GUID)) == 0)
+        {
+            // IWICFormatConverter treats 8-bit channels as sRGB and half channels as linear, so these decode the same way
+            targetBpp = 64;
+
+            if (memcmp(&source, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0)
+            {
+                return [](uint8_t* dest, const uint8_t* src, size_t count)
+                { PixelConversion::ConvertRGBA8ToRGBA16F(reinterpret_cast<uint16_t*>(dest), src, count, true); };
+            }
+
+            if (memcmp(&source, &GUID_WICPixelFormat32bppBGRA, sizeof(GUID)) == 0
+                || memcmp(&source, &GUID_WICPixelFormat32bppBGR, sizeof(GUID)) == 0)
+            {
+                const bool opaque = memcmp(&source, &GUID_WICPixelFormat32bppBGR, sizeof(GUID)) == 0;
+                return opaque ? ConvertBGRA8ToRGBA16F<true> : ConvertBGRA8ToRGBA16F<false>;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Encodes the top surface of desc from an image in memory whose rows are srcPitch bytes apart.
+    HRESULT WriteWICFile(
+        _In_z_ const wchar_t* fileName,
+        REFGUID guidContainerFormat,
+        const D3D12_RESOURCE_DESC& desc,
+        const WICPixelFormatGUID& pfGuid,
+        bool sRGB,
+        _In_opt_ const GUID* targetFormat,
+        const std::function<void __cdecl(IPropertyBag2*)>& setCustomProps,
+        _In_ const uint8_t* pixels,
+        size_t srcPitch)
+    {
+        using namespace DirectX::DX12::Internal;
+
+        HRESULT hr;
+
+        auto pWIC = GetWIC();
+        if (!pWIC)
+            return E_NOINTERFACE;
+
+        ComPtr<IWICStream> stream;
+        hr = pWIC->CreateStream(stream.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        hr = stream->InitializeFromFilename(fileName, GENERIC_WRITE);
+        if (FAILED(hr))
+            return hr;
+
+        auto_delete_file_wic delonfail(stream, fileName);
+
+        ComPtr<IWICBitmapEncoder> encoder;
+        hr = pWIC->CreateEncoder(guidContainerFormat, nullptr, encoder.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        hr = encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
+        if (FAILED(hr))
+            return hr;
+
+        ComPtr<IWICBitmapFrameEncode> frame;
+        ComPtr<IPropertyBag2> props;
+        hr = encoder->CreateNewFrame(frame.GetAddressOf(), props.GetAddressOf());
+        if (FAILED(hr))
+            return hr;
+
+        if (targetFormat && memcmp(&guidContainerFormat, &GUID_ContainerFormatBmp, sizeof(WICPixelFormatGUID)) == 0)
+        {
+            // Opt-in to the WIC2 support for writing 32-bit Windows BMP files with an alpha channel
+            PROPBAG2 option = {};
+            option.pstrName = const_cast<wchar_t*>(L"EnableV5Header32bppBGRA");
+
+            VARIANT varValue;
+            varValue.vt = VT_BOOL;
+            varValue.boolVal = VARIANT_TRUE;
+            std::ignore = props->Write(1, &option, &varValue);
+        }
+
+        if (setCustomProps)
+        {
+            setCustomProps(props.Get());
+        }
+
+        hr = frame->Initialize(props.Get());
+        if (FAILED(hr))
+            return hr;
+
+        hr = frame->SetSize(static_cast<UINT>(desc.Width), desc.Height);
+        if (FAILED(hr))
+            return hr;
+
+        hr = frame->SetResolution(72, 72);
+        if (FAILED(hr))
+            return hr;
+
+        // Pick a target format
+        WICPixelFormatGUID targetGuid = {};
+        if (targetFormat)
+        {
+            targetGuid = *targetFormat;
+        }
+        else
+        {
+            // Screenshots don't typically include the alpha channel of the render target
+            switch (desc.Format)
+            {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                targetGuid = GUID_WICPixelFormat96bppRGBFloat; // WIC 2
+                break;
+
+            case DXGI_FORMAT_R16G16B16A16_UNORM: targetGuid = GUID_WICPixelFormat48bppBGR; break;
+            case DXGI_FORMAT_B5G5R5A1_UNORM:     targetGuid = GUID_WICPixelFormat16bppBGR555; break;
+            case DXGI_FORMAT_B5G6R5_UNORM:       targetGuid = GUID_WICPixelFormat16bppBGR565; break;
+
+            case DXGI_FORMAT_R32_FLOAT:
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_A8_UNORM:
+                targetGuid = GUID_WICPixelFormat8bppGray;
+                break;
+
+            default:
+                targetGuid = GUID_WICPixelFormat24bppBGR;
+                break;
+            }
+        }
+
+        hr = frame->SetPixelFormat(&targetGuid);
+        if (FAILED(hr))
+            return hr;
+
+        if (targetFormat && memcmp(targetFormat, &targetGuid, sizeof(WICPixelFormatGUID)) != 0)
+        {
+            // Requested output pixel format is not supported by the WIC codec
+            return E_FAIL;
+        }
+
+        // Encode WIC metadata
+        ComPtr<IWICMetadataQueryWriter> metawriter;
+        if (SUCCEEDED(frame->GetMetadataQueryWriter(metawriter.GetAddressOf())))
+        {
+            PROPVARIANT value;
+            PropVariantInit(&value);
+
+            value.vt = VT_LPSTR;
+            value.pszVal = const_cast<char*>("DirectXTK");
+
+            if (memcmp(&guidContainerFormat, &GUID_ContainerFormatPng, sizeof(GUID)) == 0)
+            {
+                // Set Software name
+                std::ignore = metawriter->SetMetadataByName(L"/tEXt/{str=Software}", &value);
+
+                // Set sRGB chunk
+                if (sRGB)
+                {
+                    value.vt = VT_UI1;
+                    value.bVal = 0;
+                    std::ignore = metawriter->SetMetadataByName(L"/sRGB/RenderingIntent", &value);
+                }
+                else
+                {
+                    // add gAMA chunk with gamma 1.0
+                    value.vt = VT_UI4;
+                    value.uintVal = 100000; // gama value * 100,000 -- i.e. gamma 1.0
+                    std::ignore = metawriter->SetMetadataByName(L"/gAMA/ImageGamma", &value);
+
+                    // remove sRGB chunk which is added by default.
+                    std::ignore = metawriter->RemoveMetadataByName(L"/sRGB/RenderingIntent");
+                }
+            }
+        #if (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
+            else if (memcmp(&guidContainerFormat, &GUID_ContainerFormatJpeg, sizeof(GUID)) == 0)
+            {
+                // Set Software name
+                std::ignore = metawriter->SetMetadataByName(L"/app1/ifd/{ushort=305}", &value);
+
+                if (sRGB)
+                {
+                    // Set EXIF Colorspace of sRGB
+                    value.vt = VT_UI2;
+                    value.uiVal = 1;
+                    std::ignore = metawriter->SetMetadataByName(L"/app1/ifd/exif/{ushort=40961}", &value);
+                }
+            }
+            else if (memcmp(&guidContainerFormat, &GUID_ContainerFormatTiff, sizeof(GUID)) == 0)
+            {
+                // Set Software name
+                std::ignore = metawriter->SetMetadataByName(L"/ifd/{ushort=305}", &value);
+
+                if (sRGB)
+                {
+                    // Set EXIF Colorspace of sRGB
+                    value.vt = VT_UI2;
+                    value.uiVal = 1;
+                    std::ignore = metawriter->SetMetadataByName(L"/ifd/exif/{ushort=40961}", &value);
+                }
+            }
+        #else
+            else
+            {
+                // Set Software name
+                std::ignore = metawriter->SetMetadataByName(L"System.ApplicationName", &value);
+
+                if (sRGB)
+                {
+                    // Set EXIF Colorspace of sRGB
+                    value.vt = VT_UI2;
+                    value.uiVal = 1;
+                    std::ignore = metawriter->SetMetadataByName(L"System.Image.ColorSpace", &value);
+                }
+            }
+        #endif
+        }
+
+        const UINT64 imageSize = UINT64(srcPitch) * UINT64(desc.Height);
+        if (imageSize > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        size_t fastBpp = 0;
+        auto fastConvert = GetFastConvert(pfGuid, targetGuid, fastBpp);
+
+        if (fastConvert)
+        {
+            // Conversion required to write, done a band of rows at a time
+            const size_t convertedRowPitch = (static_cast<size_t>(desc.Width) * fastBpp + 7u) / 8u;
+            const UINT bandRows = static_cast<UINT>(std::min<size_t>(std::max<size_t>(c_writeBandSize / convertedRowPitch, 1), desc.Height));
+
+            std::unique_ptr<uint8_t[]> converted(new (std::nothrow) uint8_t[bandRows * convertedRowPitch]);
+            if (!converted)
+                return E_OUTOFMEMORY;
+
+            const uint8_t* sptr = pixels;
+            for (UINT h = 0; h < desc.Height; h += bandRows)
+            {
+                const UINT rows = std::min(bandRows, desc.Height - h);
+
+                uint8_t* dptr = converted.get();
+                for (UINT j = 0; j < rows; ++j)
+                {
+                    fastConvert(dptr, sptr, static_cast<size_t>(desc.Width));
+                    sptr += srcPitch;
+                    dptr += convertedRowPitch;
+                }
+
+                hr = frame->WritePixels(rows, static_cast<UINT>(convertedRowPitch), static_cast<UINT>(rows * convertedRowPitch), converted.get());
+                if (FAILED(hr))
+                    return hr;
+            }
+        }
+        else if (memcmp(&targetGuid, &pfGuid, sizeof(WICPixelFormatGUID)) != 0)
+        {
+            // Conversion required to write
+            ComPtr<IWICBitmap> source;
+            hr = pWIC->CreateBitmapFromMemory(static_cast<UINT>(desc.Width), desc.Height,
+                pfGuid,
+                static_cast<UINT>(srcPitch), static_cast<UINT>(imageSize),
+                const_cast<BYTE*>(pixels), source.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
+
+            ComPtr<IWICFormatConverter> FC;
+            hr = pWIC->CreateFormatConverter(FC.GetAddressOf());
+            if (FAILED(hr))
+                return hr;
+
+            BOOL canConvert = FALSE;
+            hr = FC->CanConvert(pfGuid, targetGuid, &canConvert);
+            if (FAILED(hr) || !canConvert)
+            {
+                return E_UNEXPECTED;
+            }
+
+            hr = FC->Initialize(source.Get(), targetGuid, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeMedianCut);
+            if (FAILED(hr))
+                return hr;
 
-    if (bytesWritten != headerSize)
-        return E_FAIL;
+            WICRect rect = { 0, 0, static_cast<INT>(desc.Width), static_cast<INT>(desc.Height) };
+            hr = frame->WriteSource(FC.Get(), &rect);
+            if (FAILED(hr))
+                return hr;
+        }
+        else
+        {
+            // No conversion required
+            hr = frame->WritePixels(desc.Height, static_cast<UINT>(srcPitch), static_cast<UINT>(imageSize), const_cast<BYTE*>(pixels));
+            if (FAILED(hr))
+                return hr;
+        }
 
-    if (!WriteFile(hFile.get(), pixels.get(), static_cast<DWORD>(slicePitch), &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
+        hr = frame->Commit();
+        if (FAILED(hr))
+            return hr;
+
+        hr = encoder->Commit();
+        if (FAILED(hr))
+            return hr;
+
+        delonfail.clear();
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Maps the readback buffer and hands the image to write.
+    template<typename TWrite>
+    HRESULT WriteFromReadback(
+        _In_ ID3D12Resource* pStaging,
+        UINT64 srcPitch,
+        UINT rowCount,
+        TWrite&& write)
+    {
+        const UINT64 imageSize = srcPitch * UINT64(rowCount);
+        if (imageSize > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        void* pMappedMemory = nullptr;
+        D3D12_RANGE readRange = { 0, static_cast<SIZE_T>(imageSize) };
+        D3D12_RANGE writeRange = { 0, 0 };
+        HRESULT hr = pStaging->Map(0, &readRange, &pMappedMemory);
+        if (FAILED(hr))
+            return hr;
+
+        auto sptr = static_cast<const uint8_t*>(pMappedMemory);
+        if (!sptr)
+        {
+            pStaging->Unmap(0, &writeRange);
+            return E_POINTER;
+        }
+
+        hr = write(sptr, static_cast<size_t>(srcPitch));
+
+        pStaging->Unmap(0, &writeRange);
+
+        return hr;
+    }
+} // anonymous namespace
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveDDSTextureToFile(
+    ID3D12CommandQueue* pCommandQ,
+    ID3D12Resource* pSource,
+    const wchar_t* fileName,
+    D3D12_RESOURCE_STATES beforeState,
+    D3D12_RESOURCE_STATES afterState) noexcept
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    ComPtr<ID3D12Device> device;
+    pCommandQ->GetDevice(IID_GRAPHICS_PPV_ARGS(device.GetAddressOf()));
+
+    // Get the size of the image
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = pSource->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *pSource->GetDesc(&tmpDesc);
+#endif
+
+    UINT64 dstRowPitch = 0;
+    UINT rowCount = 0;
+    HRESULT hr = GetReadbackPitch(device.Get(), desc, dstRowPitch, rowCount);
+    if (FAILED(hr))
+        return hr;
+
+    // Setup header
+    uint8_t fileHeader[MAX_HEADER_SIZE];
+    size_t headerSize = 0;
+    hr = GetDDSHeader(desc, fileHeader, headerSize);
+    if (FAILED(hr))
+        return hr;
+
+    ComPtr<ID3D12Resource> pStaging;
+    hr = CaptureTexture(device.Get(), pCommandQ, pSource, dstRowPitch, desc, pStaging.GetAddressOf(), beforeState, afterState);
+    if (FAILED(hr))
+        return hr;
+
+    return WriteFromReadback(pStaging.Get(), dstRowPitch, rowCount,
+        [&](const uint8_t* pixels, size_t srcPitch) noexcept
+        {
+            return WriteDDSFile(fileName, desc, fileHeader, headerSize, pixels, srcPitch);
+        });
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::SaveDDSTextureToFile(
+    ID3D12CommandQueue* pCommandQ,
+    ID3D12Resource* pSource,
+    const wchar_t* fileName,
+    DXGI_FORMAT compressFormat,
+    D3D12_RESOURCE_STATES beforeState,
+    D3D12_RESOURCE_STATES afterState) noexcept
+{
+    if (!fileName)
+        return E_INVALIDARG;
+
+    ComPtr<ID3D12Device> device;
+    pCommandQ->GetDevice(IID_GRAPHICS_PPV_ARGS(device.GetAddressOf()));
+
+    // Get the size of the image
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = pSource->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *pSource->GetDesc(&tmpDesc);
+#endif
 
-    if (bytesWritten != slicePitch)
-        return E_FAIL;
+    UINT64 dstRowPitch = 0;
+    UINT rowCount = 0;
+    HRESULT hr = GetReadbackPitch(device.Get(), desc, dstRowPitch, rowCount);
+    if (FAILED(hr))
+        return hr;
 
-    delonfail.clear();
+    // Setup header
+    uint8_t fileHeader[MAX_HEADER_SIZE];
+    size_t headerSize = 0;
+    BCEncode::Format bcFormat;
+    hr = GetCompressedDDSHeader(desc, compressFormat, bcFormat, fileHeader, headerSize);
+    if (FAILED(hr))
+        return hr;
 
-    return S_OK;
-}
+    ComPtr<ID3D12Resource> pStaging;
+    hr = CaptureTexture(device.Get(), pCommandQ, pSource, dstRowPitch, desc, pStaging.GetAddressOf(), beforeState, afterState);
+    if (FAILED(hr))
+        return hr;
 
-//--------------------------------------------------------------------------------------
-namespace DirectX
-{
-    inline namespace DX12
-    {
-        namespace Internal
+    return WriteFromReadback(pStaging.Get(), dstRowPitch, rowCount,
+        [&](const uint8_t* pixels, size_t srcPitch) noexcept
         {
-            extern IWICImagingFactory2* GetWIC() noexcept;
-        }
-    }
+            return WriteCompressedDDSFile(fileName, desc, bcFormat, fileHeader, headerSize, pixels, srcPitch);
+        });
 }
 
+//--------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::SaveWICTextureToFile(
     ID3D12CommandQueue* pCommandQ,
@@ -462,8 +1291,6 @@ HRESULT DirectX::SaveWICTextureToFile(
     std::function<void(IPropertyBag2*)> setCustomProps,
     bool forceSRGB)
 {
-    using namespace DirectX::DX12::Internal;
-
     if (!fileName)
         return E_INVALIDARG;
 
@@ -478,342 +1305,475 @@ HRESULT DirectX::SaveWICTextureToFile(
     const auto& desc = *pSource->GetDesc(&tmpDesc);
 #endif
 
-    if (desc.Width > UINT32_MAX)
-        return E_INVALIDARG;
-
-    UINT64 totalResourceSize = 0;
-    UINT64 fpRowPitch = 0;
-    UINT fpRowCount = 0;
-    // Get the rowcount, pitch and size of the top mip
-    device->GetCopyableFootprints(
-        &desc,
-        0,
-        1,
-        0,
-        nullptr,
-        &fpRowCount,
-        &fpRowPitch,
-        &totalResourceSize);
-
-#if (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
-    // Round up the srcPitch to multiples of 1024
-    UINT64 dstRowPitch = (fpRowPitch + static_cast<uint64_t>(D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT) - 1u) & ~(static_cast<uint64_t>(D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT) - 1u);
-#else
-    // Round up the srcPitch to multiples of 256 (D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)
-    const UINT64 dstRowPitch = (fpRowPitch + 255) & ~0xFFu;
-#endif
+    UINT64 dstRowPitch = 0;
+    UINT rowCount = 0;
+    HRESULT hr = GetReadbackPitch(device.Get(), desc, dstRowPitch, rowCount);
+    if (FAILED(hr))
+        return hr;
 
-    if (dstRowPitch > UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    WICPixelFormatGUID pfGuid;
+    bool sRGB;
+    hr = GetWICPixelFormat(desc, forceSRGB, pfGuid, sRGB);
+    if (FAILED(hr))
+        return hr;
 
     ComPtr<ID3D12Resource> pStaging;
-    HRESULT hr = CaptureTexture(device.Get(), pCommandQ, pSource, dstRowPitch, desc, pStaging.GetAddressOf(), beforeState, afterState);
+    hr = CaptureTexture(device.Get(), pCommandQ, pSource, dstRowPitch, desc, pStaging.GetAddressOf(), beforeState, afterState);
     if (FAILED(hr))
         return hr;
 
-    // Determine source format's WIC equivalent
-    WICPixelFormatGUID pfGuid = {};
-    bool sRGB = forceSRGB;
-    switch (desc.Format)
-    {
-    case DXGI_FORMAT_R32G32B32A32_FLOAT:            pfGuid = GUID_WICPixelFormat128bppRGBAFloat; break;
-    case DXGI_FORMAT_R16G16B16A16_FLOAT:            pfGuid = GUID_WICPixelFormat64bppRGBAHalf; break;
-    case DXGI_FORMAT_R16G16B16A16_UNORM:            pfGuid = GUID_WICPixelFormat64bppRGBA; break;
-    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:    pfGuid = GUID_WICPixelFormat32bppRGBA1010102XR; break;
-    case DXGI_FORMAT_R10G10B10A2_UNORM:             pfGuid = GUID_WICPixelFormat32bppRGBA1010102; break;
-    case DXGI_FORMAT_B5G5R5A1_UNORM:                pfGuid = GUID_WICPixelFormat16bppBGRA5551; break;
-    case DXGI_FORMAT_B5G6R5_UNORM:                  pfGuid = GUID_WICPixelFormat16bppBGR565; break;
-    case DXGI_FORMAT_R32_FLOAT:                     pfGuid = GUID_WICPixelFormat32bppGrayFloat; break;
-    case DXGI_FORMAT_R16_FLOAT:                     pfGuid = GUID_WICPixelFormat16bppGrayHalf; break;
-    case DXGI_FORMAT_R16_UNORM:                     pfGuid = GUID_WICPixelFormat16bppGray; break;
-    case DXGI_FORMAT_R8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppGray; break;
-    case DXGI_FORMAT_A8_UNORM:                      pfGuid = GUID_WICPixelFormat8bppAlpha; break;
-
-    case DXGI_FORMAT_R8G8B8A8_UNORM:
-        pfGuid = GUID_WICPixelFormat32bppRGBA;
-        break;
-
-    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        pfGuid = GUID_WICPixelFormat32bppRGBA;
-        sRGB = true;
-        break;
-
-    case DXGI_FORMAT_B8G8R8A8_UNORM:
-        pfGuid = GUID_WICPixelFormat32bppBGRA;
-        break;
-
-    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-        pfGuid = GUID_WICPixelFormat32bppBGRA;
-        sRGB = true;
-        break;
-
-    case DXGI_FORMAT_B8G8R8X8_UNORM:
-        pfGuid = GUID_WICPixelFormat32bppBGR;
-        break;
-
-    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-        pfGuid = GUID_WICPixelFormat32bppBGR;
-        sRGB = true;
-        break;
-
-    default:
-        DebugTrace("ERROR: ScreenGrab does not support all DXGI formats (%u). Consider using DirectXTex.\n", static_cast<uint32_t>(desc.Format));
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-    }
+    return WriteFromReadback(pStaging.Get(), dstRowPitch, rowCount,
+        [&](const uint8_t* pixels, size_t srcPitch)
+        {
+            return WriteWICFile(fileName, guidContainerFormat, desc, pfGuid, sRGB, targetFormat, setCustomProps, pixels, srcPitch);
+        });
+}
 
-    auto pWIC = GetWIC();
-    if (!pWIC)
-        return E_NOINTERFACE;
 
-    ComPtr<IWICStream> stream;
-    hr = pWIC->CreateStream(stream.GetAddressOf());
-    if (FAILED(hr))
-        return hr;
+//======================================================================================
+// AsyncScreenGrab
+//======================================================================================
 
-    hr = stream->InitializeFromFilename(fileName, GENERIC_WRITE);
-    if (FAILED(hr))
-        return hr;
+class AsyncScreenGrab::Impl
+{
+public:
+    using WriteFunc = std::function<HRESULT(const uint8_t* pixels, size_t srcPitch)>;
+    using CompletionFunc = std::function<void __cdecl(HRESULT)>;
+
+    Impl(_In_ ID3D12Device* device, size_t ringSize) :
+        mDevice(device),
+        mFenceValue(0),
+        mSlots(ringSize)
+    {
+        if (!device || !ringSize)
+            throw std::invalid_argument("AsyncScreenGrab");
 
-    auto_delete_file_wic delonfail(stream, fileName);
+        ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(mFence.ReleaseAndGetAddressOf())));
 
-    ComPtr<IWICBitmapEncoder> encoder;
-    hr = pWIC->CreateEncoder(guidContainerFormat, nullptr, encoder.GetAddressOf());
-    if (FAILED(hr))
-        return hr;
+        SetDebugObjectName(mFence.Get(), L"AsyncScreenGrab");
 
-    hr = encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
-    if (FAILED(hr))
-        return hr;
+        for (auto& slot : mSlots)
+        {
+            ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_GRAPHICS_PPV_ARGS(slot.commandAlloc.ReleaseAndGetAddressOf())));
 
-    ComPtr<IWICBitmapFrameEncode> frame;
-    ComPtr<IPropertyBag2> props;
-    hr = encoder->CreateNewFrame(frame.GetAddressOf(), props.GetAddressOf());
-    if (FAILED(hr))
-        return hr;
+            SetDebugObjectName(slot.commandAlloc.Get(), L"AsyncScreenGrab");
 
-    if (targetFormat && memcmp(&guidContainerFormat, &GUID_ContainerFormatBmp, sizeof(WICPixelFormatGUID)) == 0)
-    {
-        // Opt-in to the WIC2 support for writing 32-bit Windows BMP files with an alpha channel
-        PROPBAG2 option = {};
-        option.pstrName = const_cast<wchar_t*>(L"EnableV5Header32bppBGRA");
-
-        VARIANT varValue;
-        varValue.vt = VT_BOOL;
-        varValue.boolVal = VARIANT_TRUE;
-        std::ignore = props->Write(1, &option, &varValue);
-    }
+            ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, slot.commandAlloc.Get(), nullptr, IID_GRAPHICS_PPV_ARGS(slot.commandList.ReleaseAndGetAddressOf())));
 
-    if (setCustomProps)
-    {
-        setCustomProps(props.Get());
-    }
+            SetDebugObjectName(slot.commandList.Get(), L"AsyncScreenGrab");
 
-    hr = frame->Initialize(props.Get());
-    if (FAILED(hr))
-        return hr;
+            ThrowIfFailed(slot.commandList->Close());
+        }
+    }
 
-    hr = frame->SetSize(static_cast<UINT>(desc.Width), desc.Height);
-    if (FAILED(hr))
-        return hr;
+    Impl(Impl&&) = delete;
+    Impl& operator= (Impl&&) = delete;
 
-    hr = frame->SetResolution(72, 72);
-    if (FAILED(hr))
-        return hr;
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
 
-    // Pick a target format
-    WICPixelFormatGUID targetGuid = {};
-    if (targetFormat)
+    ~Impl()
     {
-        targetGuid = *targetFormat;
+        // The workers reference the readback buffers, so they must all finish first.
+        for (auto& slot : mSlots)
+        {
+            if (slot.pending.valid())
+                slot.pending.wait();
+        }
     }
-    else
+
+    HRESULT Capture(
+        _In_ ID3D12CommandQueue* pCommandQ,
+        _In_ ID3D12Resource* pSource,
+        const D3D12_RESOURCE_DESC& desc,
+        UINT64 srcPitch,
+        UINT rowCount,
+        D3D12_RESOURCE_STATES beforeState,
+        D3D12_RESOURCE_STATES afterState,
+        WriteFunc write,
+        CompletionFunc onComplete)
     {
-        // Screenshots don't typically include the alpha channel of the render target
-        switch (desc.Format)
+        HRESULT hr = ValidateCapture(mDevice.Get(), desc, srcPitch);
+        if (FAILED(hr))
+            return hr;
+
+        const std::lock_guard<std::mutex> lock(mMutex);
+
+        Slot* slot = AcquireSlot();
+        if (!slot)
+            return HRESULT_FROM_WIN32(ERROR_BUSY);
+
+        ComPtr<ID3D12Resource> staging;
+        if (IsReadbackResource(pSource))
         {
-        case DXGI_FORMAT_R32G32B32A32_FLOAT:
-        case DXGI_FORMAT_R16G16B16A16_FLOAT:
-            targetGuid = GUID_WICPixelFormat96bppRGBFloat; // WIC 2
-            break;
+            // Handle case where the source is already a staging texture we can use directly
+            staging = pSource;
+        }
+        else
+        {
+            const UINT64 bufferSize = srcPitch * desc.Height;
+            if (slot->readbackSize < bufferSize)
+            {
+                slot->readback.Reset();
+                slot->readbackSize = 0;
 
-        case DXGI_FORMAT_R16G16B16A16_UNORM: targetGuid = GUID_WICPixelFormat48bppBGR; break;
-        case DXGI_FORMAT_B5G5R5A1_UNORM:     targetGuid = GUID_WICPixelFormat16bppBGR555; break;
-        case DXGI_FORMAT_B5G6R5_UNORM:       targetGuid = GUID_WICPixelFormat16bppBGR565; break;
+                hr = CreateReadbackBuffer(mDevice.Get(), bufferSize, slot->readback.GetAddressOf());
+                if (FAILED(hr))
+                    return hr;
 
-        case DXGI_FORMAT_R32_FLOAT:
-        case DXGI_FORMAT_R16_FLOAT:
-        case DXGI_FORMAT_R16_UNORM:
-        case DXGI_FORMAT_R8_UNORM:
-        case DXGI_FORMAT_A8_UNORM:
-            targetGuid = GUID_WICPixelFormat8bppGray;
-            break;
+                slot->readbackSize = bufferSize;
+            }
 
-        default:
-            targetGuid = GUID_WICPixelFormat24bppBGR;
-            break;
+            // The slot's previous capture has completed on the GPU, so its allocator can be reused.
+            slot->resolved.Reset();
+
+            hr = slot->commandAlloc->Reset();
+            if (FAILED(hr))
+                return hr;
+
+            hr = slot->commandList->Reset(slot->commandAlloc.Get(), nullptr);
+            if (FAILED(hr))
+                return hr;
+
+            hr = RecordCapture(mDevice.Get(), slot->commandList.Get(), pSource, srcPitch, desc, slot->readback.Get(),
+                beforeState, afterState, slot->resolved.ReleaseAndGetAddressOf());
+
+            const HRESULT hrClose = slot->commandList->Close();
+            if (FAILED(hr))
+                return hr;
+            if (FAILED(hrClose))
+                return hrClose;
+
+            pCommandQ->ExecuteCommandLists(1, CommandListCast(slot->commandList.GetAddressOf()));
+
+            staging = slot->readback;
         }
-    }
 
-    hr = frame->SetPixelFormat(&targetGuid);
-    if (FAILED(hr))
-        return hr;
+        const uint64_t fenceValue = ++mFenceValue;
+        hr = pCommandQ->Signal(mFence.Get(), fenceValue);
+        if (FAILED(hr))
+        {
+            if (staging.Get() != pSource)
+            {
+                // There is no way to tell when the GPU is done with the slot's command list and readback buffer.
+                DebugTrace("ERROR: AsyncScreenGrab failed to signal its fence (%08X); the capture slot is no longer used\n",
+                    static_cast<unsigned int>(hr));
+                slot->lost = true;
+            }
+            return hr;
+        }
+
+        ComPtr<ID3D12Fence> fence = mFence;
+        slot->pending = std::async(std::launch::async,
+            [fence, fenceValue, staging, srcPitch, rowCount, write = std::move(write), onComplete = std::move(onComplete)]()
+            {
+                WaitForFence(fence.Get(), fenceValue);
+
+                HRESULT result = S_OK;
+                try
+                {
+                    result = WriteFromReadback(staging.Get(), srcPitch, rowCount, write);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    result = E_OUTOFMEMORY;
+                }
+                catch (...)
+                {
+                    result = E_FAIL;
+                }
+
+                // An exception from onComplete is kept in the future for WaitForCompletion.
+                if (onComplete)
+                {
+                    onComplete(result);
+                }
+            });
+
+        return S_OK;
+    }
 
-    if (targetFormat && memcmp(targetFormat, &targetGuid, sizeof(WICPixelFormatGUID)) != 0)
+    size_t GetPendingCount() const
     {
-        // Requested output pixel format is not supported by the WIC codec
-        return E_FAIL;
+        const std::lock_guard<std::mutex> lock(mMutex);
+
+        size_t count = 0;
+        for (auto const& slot : mSlots)
+        {
+            if (slot.pending.valid() && slot.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                ++count;
+        }
+
+        return count;
     }
 
-    // Encode WIC metadata
-    ComPtr<IWICMetadataQueryWriter> metawriter;
-    if (SUCCEEDED(frame->GetMetadataQueryWriter(metawriter.GetAddressOf())))
+    void WaitForCompletion()
     {
-        PROPVARIANT value;
-        PropVariantInit(&value);
+        // Held while waiting so no capture can reuse a slot whose worker is still reading it.
+        const std::lock_guard<std::mutex> lock(mMutex);
 
-        value.vt = VT_LPSTR;
-        value.pszVal = const_cast<char*>("DirectXTK");
+        std::exception_ptr error = std::move(mCallbackError);
+        mCallbackError = nullptr;
 
-        if (memcmp(&guidContainerFormat, &GUID_ContainerFormatPng, sizeof(GUID)) == 0)
+        for (auto& slot : mSlots)
         {
-            // Set Software name
-            std::ignore = metawriter->SetMetadataByName(L"/tEXt/{str=Software}", &value);
+            if (!slot.pending.valid())
+                continue;
 
-            // Set sRGB chunk
-            if (sRGB)
+            try
             {
-                value.vt = VT_UI1;
-                value.bVal = 0;
-                std::ignore = metawriter->SetMetadataByName(L"/sRGB/RenderingIntent", &value);
+                slot.pending.get();
             }
-            else
+            catch (...)
             {
-                // add gAMA chunk with gamma 1.0
-                value.vt = VT_UI4;
-                value.uintVal = 100000; // gama value * 100,000 -- i.e. gamma 1.0
-                std::ignore = metawriter->SetMetadataByName(L"/gAMA/ImageGamma", &value);
-
-                // remove sRGB chunk which is added by default.
-                std::ignore = metawriter->RemoveMetadataByName(L"/sRGB/RenderingIntent");
+                if (!error)
+                    error = std::current_exception();
             }
         }
-    #if (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
-        else if (memcmp(&guidContainerFormat, &GUID_ContainerFormatJpeg, sizeof(GUID)) == 0)
-        {
-            // Set Software name
-            std::ignore = metawriter->SetMetadataByName(L"/app1/ifd/{ushort=305}", &value);
 
-            if (sRGB)
-            {
-                // Set EXIF Colorspace of sRGB
-                value.vt = VT_UI2;
-                value.uiVal = 1;
-                std::ignore = metawriter->SetMetadataByName(L"/app1/ifd/exif/{ushort=40961}", &value);
-            }
-        }
-        else if (memcmp(&guidContainerFormat, &GUID_ContainerFormatTiff, sizeof(GUID)) == 0)
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    ComPtr<ID3D12Device> mDevice;
+
+private:
+    struct Slot
+    {
+        ComPtr<ID3D12CommandAllocator>      commandAlloc;
+        ComPtr<ID3D12GraphicsCommandList>   commandList;
+        ComPtr<ID3D12Resource>              readback;
+        UINT64                              readbackSize;
+        ComPtr<ID3D12Resource>              resolved;
+        std::future<void>                   pending;
+        bool                                lost;
+
+        Slot() noexcept : readbackSize(0), lost(false) {}
+    };
+
+    // Returns a slot whose previous capture has been written, or null if all are busy. Called with mMutex held.
+    Slot* AcquireSlot()
+    {
+        for (auto& slot : mSlots)
         {
-            // Set Software name
-            std::ignore = metawriter->SetMetadataByName(L"/ifd/{ushort=305}", &value);
+            if (slot.lost)
+                continue;
 
-            if (sRGB)
+            if (!slot.pending.valid())
+                return &slot;
+
+            if (slot.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
             {
-                // Set EXIF Colorspace of sRGB
-                value.vt = VT_UI2;
-                value.uiVal = 1;
-                std::ignore = metawriter->SetMetadataByName(L"/ifd/exif/{ushort=40961}", &value);
+                // A callback exception belongs to the earlier capture, so hold it for WaitForCompletion.
+                try
+                {
+                    slot.pending.get();
+                }
+                catch (...)
+                {
+                    if (!mCallbackError)
+                        mCallbackError = std::current_exception();
+                }
+                return &slot;
             }
         }
-    #else
-        else
-        {
-            // Set Software name
-            std::ignore = metawriter->SetMetadataByName(L"System.ApplicationName", &value);
 
-            if (sRGB)
-            {
-                // Set EXIF Colorspace of sRGB
-                value.vt = VT_UI2;
-                value.uiVal = 1;
-                std::ignore = metawriter->SetMetadataByName(L"System.Image.ColorSpace", &value);
-            }
+        return nullptr;
+    }
+
+    static void WaitForFence(_In_ ID3D12Fence* fence, uint64_t fenceValue) noexcept
+    {
+        if (fence->GetCompletedValue() >= fenceValue)
+            return;
+
+        ScopedHandle event(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+        if (event && SUCCEEDED(fence->SetEventOnCompletion(fenceValue, event.get())))
+        {
+            std::ignore = WaitForSingleObject(event.get(), INFINITE);
         }
-    #endif
+
+        while (fence->GetCompletedValue() < fenceValue)
+            SwitchToThread();
     }
 
-    const UINT64 imageSize = dstRowPitch * UINT64(desc.Height);
-    if (imageSize > UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    // Guards the slots, fence value, and callback error against callers on different threads.
+    // The workers only touch their own future, so they never take it.
+    mutable std::mutex  mMutex;
+    ComPtr<ID3D12Fence> mFence;
+    uint64_t            mFenceValue;
+    std::vector<Slot>   mSlots;
+    std::exception_ptr  mCallbackError;
+};
+
+
+// Public constructor.
+_Use_decl_annotations_
+AsyncScreenGrab::AsyncScreenGrab(ID3D12Device* device, size_t ringSize)
+    : pImpl(std::make_unique<Impl>(device, ringSize))
+{
+}
+
+
+AsyncScreenGrab::AsyncScreenGrab(AsyncScreenGrab&&) noexcept = default;
+AsyncScreenGrab& AsyncScreenGrab::operator= (AsyncScreenGrab&&) noexcept = default;
+AsyncScreenGrab::~AsyncScreenGrab() = default;
+
+
+_Use_decl_annotations_
+HRESULT AsyncScreenGrab::SaveDDSTextureToFile(
+    ID3D12CommandQueue* pCommandQueue,
+    ID3D12Resource* pSource,
+    const wchar_t* fileName,
+    D3D12_RESOURCE_STATES beforeState,
+    D3D12_RESOURCE_STATES afterState,
+    std::function<void(HRESULT)> onComplete)
+{
+    if (!pCommandQueue || !pSource || !fileName)
+        return E_INVALIDARG;
+
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = pSource->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *pSource->GetDesc(&tmpDesc);
+#endif
 
-    void* pMappedMemory = nullptr;
-    D3D12_RANGE readRange = { 0, static_cast<SIZE_T>(imageSize) };
-    D3D12_RANGE writeRange = { 0, 0 };
-    hr = pStaging->Map(0, &readRange, &pMappedMemory);
+    UINT64 dstRowPitch = 0;
+    UINT rowCount = 0;
+    HRESULT hr = GetReadbackPitch(pImpl->mDevice.Get(), desc, dstRowPitch, rowCount);
     if (FAILED(hr))
         return hr;
 
-    if (memcmp(&targetGuid, &pfGuid, sizeof(WICPixelFormatGUID)) != 0)
-    {
-        // Conversion required to write
-        ComPtr<IWICBitmap> source;
-        hr = pWIC->CreateBitmapFromMemory(static_cast<UINT>(desc.Width), desc.Height,
-            pfGuid,
-            static_cast<UINT>(dstRowPitch), static_cast<UINT>(imageSize),
-            static_cast<BYTE*>(pMappedMemory), source.GetAddressOf());
-        if (FAILED(hr))
-        {
-            pStaging->Unmap(0, &writeRange);
-            return hr;
-        }
+    std::array<uint8_t, MAX_HEADER_SIZE> fileHeader;
+    size_t headerSize = 0;
+    hr = GetDDSHeader(desc, fileHeader.data(), headerSize);
+    if (FAILED(hr))
+        return hr;
 
-        ComPtr<IWICFormatConverter> FC;
-        hr = pWIC->CreateFormatConverter(FC.GetAddressOf());
-        if (FAILED(hr))
-        {
-            pStaging->Unmap(0, &writeRange);
-            return hr;
-        }
+    std::wstring name(fileName);
 
-        BOOL canConvert = FALSE;
-        hr = FC->CanConvert(pfGuid, targetGuid, &canConvert);
-        if (FAILED(hr) || !canConvert)
+    return pImpl->Capture(pCommandQueue, pSource, desc, dstRowPitch, rowCount, beforeState, afterState,
+        [desc, name, fileHeader, headerSize](const uint8_t* pixels, size_t srcPitch) noexcept
         {
-            pStaging->Unmap(0, &writeRange);
-            return E_UNEXPECTED;
-        }
+            return WriteDDSFile(name.c_str(), desc, fileHeader.data(), headerSize, pixels, srcPitch);
+        },
+        std::move(onComplete));
+}
 
-        hr = FC->Initialize(source.Get(), targetGuid, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeMedianCut);
-        if (FAILED(hr))
-        {
-            pStaging->Unmap(0, &writeRange);
-            return hr;
-        }
 
-        WICRect rect = { 0, 0, static_cast<INT>(desc.Width), static_cast<INT>(desc.Height) };
-        hr = frame->WriteSource(FC.Get(), &rect);
-    }
-    else
-    {
-        // No conversion required
-        hr = frame->WritePixels(desc.Height, static_cast<UINT>(dstRowPitch), static_cast<UINT>(imageSize), static_cast<BYTE*>(pMappedMemory));
-    }
 
-    pStaging->Unmap(0, &writeRange);
+_Use_decl_annotations_
+HRESULT AsyncScreenGrab::SaveDDSTextureToFile(
+    ID3D12CommandQueue* pCommandQueue,
+    ID3D12Resource* pSource,
+    const wchar_t* fileName,
+    DXGI_FORMAT compressFormat,
+    D3D12_RESOURCE_STATES beforeState,
+    D3D12_RESOURCE_STATES afterState,
+    std::function<void(HRESULT)> onComplete)
+{
+    if (!pCommandQueue || !pSource || !fileName)
+        return E_INVALIDARG;
+
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = pSource->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *pSource->GetDesc(&tmpDesc);
+#endif
+
+    UINT64 dstRowPitch = 0;
+    UINT rowCount = 0;
+    HRESULT hr = GetReadbackPitch(pImpl->mDevice.Get(), desc, dstRowPitch, rowCount);
+    if (FAILED(hr))
+        return hr;
 
+    std::array<uint8_t, MAX_HEADER_SIZE> fileHeader;
+    size_t headerSize = 0;
+    BCEncode::Format bcFormat;
+    hr = GetCompressedDDSHeader(desc, compressFormat, bcFormat, fileHeader.data(), headerSize);
     if (FAILED(hr))
         return hr;
 
-    hr = frame->Commit();
+    std::wstring name(fileName);
+
+    return pImpl->Capture(pCommandQueue, pSource, desc, dstRowPitch, rowCount, beforeState, afterState,
+        [desc, name, bcFormat, fileHeader, headerSize](const uint8_t* pixels, size_t srcPitch) noexcept
+        {
+            return WriteCompressedDDSFile(name.c_str(), desc, bcFormat, fileHeader.data(), headerSize, pixels, srcPitch);
+        },
+        std::move(onComplete));
+}
+
+_Use_decl_annotations_
+HRESULT AsyncScreenGrab::SaveWICTextureToFile(
+    ID3D12CommandQueue* pCommandQueue,
+    ID3D12Resource* pSource,
+    REFGUID guidContainerFormat,
+    const wchar_t* fileName,
+    D3D12_RESOURCE_STATES beforeState,
+    D3D12_RESOURCE_STATES afterState,
+    const GUID* targetFormat,
+    std::function<void(IPropertyBag2*)> setCustomProps,
+    bool forceSRGB,
+    std::function<void(HRESULT)> onComplete)
+{
+    if (!pCommandQueue || !pSource || !fileName)
+        return E_INVALIDARG;
+
+#if defined(_MSC_VER) || !defined(_WIN32)
+    const auto desc = pSource->GetDesc();
+#else
+    D3D12_RESOURCE_DESC tmpDesc;
+    const auto& desc = *pSource->GetDesc(&tmpDesc);
+#endif
+
+    UINT64 dstRowPitch = 0;
+    UINT rowCount = 0;
+    HRESULT hr = GetReadbackPitch(pImpl->mDevice.Get(), desc, dstRowPitch, rowCount);
     if (FAILED(hr))
         return hr;
 
-    hr = encoder->Commit();
+    WICPixelFormatGUID pfGuid;
+    bool sRGB;
+    hr = GetWICPixelFormat(desc, forceSRGB, pfGuid, sRGB);
     if (FAILED(hr))
         return hr;
 
-    delonfail.clear();
+    std::wstring name(fileName);
+    const GUID container = guidContainerFormat;
+    const bool hasTarget = (targetFormat != nullptr);
+    const GUID target = hasTarget ? *targetFormat : GUID{};
+
+    return pImpl->Capture(pCommandQueue, pSource, desc, dstRowPitch, rowCount, beforeState, afterState,
+        [=](const uint8_t* pixels, size_t srcPitch)
+        {
+            // Runs on a worker thread, which needs COM for WIC.
+            const HRESULT hrInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+            const HRESULT result = WriteWICFile(name.c_str(), container, desc, pfGuid, sRGB,
+                hasTarget ? &target : nullptr, setCustomProps, pixels, srcPitch);
+
+            if (SUCCEEDED(hrInit))
+            {
+                CoUninitialize();
+            }
+
+            return result;
+        },
+        std::move(onComplete));
+}
+
+
+size_t AsyncScreenGrab::GetPendingCount() const
+{
+    return pImpl->GetPendingCount();
+}
 
-    return S_OK;
+
+void AsyncScreenGrab::WaitForCompletion()
+{
+    pImpl->WaitForCompletion();
 }
 
 
@@ -10,6 +10,9 @@
 #include "pch.h"
 
 #include <algorithm>
+#include <cfloat>
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 #include "SpriteFont.h"
@@ -39,13 +42,19 @@ public:
         size_t glyphCount,
         float lineSpacing) noexcept(false);
 
-    Glyph const* FindGlyph(wchar_t character) const;
+    Glyph const* FindGlyph(uint32_t character) const;
 
     void SetDefaultCharacter(wchar_t character);
 
     template<typename TAction>
     void ForEachGlyph(_In_z_ wchar_t const* text, TAction action, bool ignoreWhitespace) const;
 
+    template<typename TAction>
+    void ForEachGlyph(_In_z_ char const* text, TAction action, bool ignoreWhitespace) const;
+
+    template<typename TAction>
+    void LayoutCharacter(uint32_t character, float& x, float& y, TAction& action, bool ignoreWhitespace) const;
+
     void CreateTextureResource(_In_ ID3D12Device* device,
         ResourceUploadBatch& upload,
         uint32_t width, uint32_t height,
@@ -53,7 +62,25 @@ public:
         uint32_t stride, uint32_t rows,
         _In_reads_(stride * rows) const uint8_t* data) noexcept(false);
 
-    const wchar_t* ConvertUTF8(_In_z_ const char *text) noexcept(false);
+    template<typename TChar>
+    void XM_CALLCONV DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ TChar const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth);
+
+    void XM_CALLCONV DrawLayout(_In_ SpriteBatch* spriteBatch, TextLayout const& layout, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const;
+
+    template<typename TChar>
+    XMVECTOR MeasureString(_In_z_ TChar const* text, bool ignoreWhitespace);
+
+    template<typename TChar>
+    RECT MeasureDrawBounds(_In_z_ TChar const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const;
+
+    template<typename TChar>
+    void PrepareLayout(_In_z_ TChar const* text, TextLayout& layout) const;
+
+    template<typename TChar>
+    std::shared_ptr<const TextLayout> GetCachedLayout(_In_z_ TChar const* text);
+
+    void SetLayoutCacheSize(size_t maxEntries);
+    void ClearLayoutCache() noexcept;
 
     // Fields.
     ComPtr<ID3D12Resource> textureResource;
@@ -61,12 +88,26 @@ public:
     XMUINT2 textureSize;
     std::vector<Glyph> glyphs;
     std::vector<uint32_t> glyphsIndex;
+    std::array<Glyph const*, 128> asciiGlyphs;
     Glyph const* defaultGlyph;
     float lineSpacing;
+    std::atomic<size_t> layoutCacheSize;
 
 private:
-    size_t utfBufferSize;
-    std::unique_ptr<wchar_t[]> utfBuffer;
+    void BuildGlyphIndex();
+
+    struct LayoutCacheEntry
+    {
+        std::string key;
+        std::shared_ptr<const TextLayout> layout;
+    };
+
+    using LayoutCacheList = std::list<LayoutCacheEntry>;
+
+    // Most recently used entry is at the front, indexed by a hash of its key.
+    std::mutex layoutCacheLock;
+    LayoutCacheList layoutCacheList;
+    std::unordered_multimap<uint64_t, LayoutCacheList::iterator> layoutCacheIndex;
 };
 
 
@@ -75,6 +116,176 @@ const XMFLOAT2 SpriteFont::Float2Zero(0, 0);
 
 static const char spriteFontMagic[] = "DXTKfont";
 
+namespace
+{
+    // Glyph characters are full code points, but wint_t is only 16 bits on Windows. No whitespace lies outside the BMP.
+    inline bool IsWhitespace(uint32_t character) noexcept
+    {
+        return (character <= 0xFFFF) && iswspace(static_cast<wint_t>(character));
+    }
+
+    static_assert(SpriteEffects_FlipHorizontally == 1 &&
+        SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
+
+    // Lookup table indicates which way to move along each axis per SpriteEffects enum value.
+    const XMVECTORF32 axisDirectionTable[4] =
+    {
+        { { { -1, -1, 0, 0 } } },
+        { { {  1, -1, 0, 0 } } },
+        { { { -1,  1, 0, 0 } } },
+        { { {  1,  1, 0, 0 } } },
+    };
+
+    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
+    const XMVECTORF32 axisIsMirroredTable[4] =
+    {
+        { { { 0, 0, 0, 0 } } },
+        { { { 1, 0, 0, 0 } } },
+        { { { 0, 1, 0, 0 } } },
+        { { { 1, 1, 0, 0 } } },
+    };
+
+    // Layout cache keys are the raw bytes of the text prefixed by the size of its code units,
+    // so UTF-8 and UTF-16 strings never collide.
+    template<typename TChar>
+    std::string MakeCacheKey(_In_reads_(length) TChar const* text, size_t length)
+    {
+        std::string key;
+        key.reserve(length * sizeof(TChar) + 1);
+        key.push_back(static_cast<char>(sizeof(TChar)));
+        key.append(reinterpret_cast<const char*>(text), length * sizeof(TChar));
+        return key;
+    }
+
+    // FNV-1a hash of a layout cache key.
+    inline uint64_t HashBytes(_In_reads_bytes_(size) const void* data, size_t size, uint64_t hash = 14695981039346656037ull) noexcept
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for (size_t j = 0; j < size; ++j)
+        {
+            hash ^= bytes[j];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    inline uint64_t HashKey(std::string const& key) noexcept
+    {
+        return HashBytes(key.data(), key.size());
+    }
+
+    template<typename TChar>
+    uint64_t HashKey(_In_reads_(length) TChar const* text, size_t length) noexcept
+    {
+        const auto prefix = static_cast<char>(sizeof(TChar));
+        return HashBytes(text, length * sizeof(TChar), HashBytes(&prefix, 1));
+    }
+
+    template<typename TChar>
+    bool MatchesKey(std::string const& key, _In_reads_(length) TChar const* text, size_t length) noexcept
+    {
+        return key.size() == (length * sizeof(TChar) + 1)
+            && key[0] == static_cast<char>(sizeof(TChar))
+            && memcmp(key.data() + 1, text, length * sizeof(TChar)) == 0;
+    }
+
+    inline size_t TextLength(_In_z_ wchar_t const* text) noexcept { return wcslen(text); }
+    inline size_t TextLength(_In_z_ char const* text) noexcept { return strlen(text); }
+
+    // Returns the number of leading bytes which are 7-bit ASCII, testing a vector's worth of bytes at a time.
+    inline size_t CountASCII(_In_reads_(end - ptr) const uint8_t* ptr, const uint8_t* end) noexcept
+    {
+        const uint8_t* start = ptr;
+
+    #if defined(_XM_AVX2_INTRINSICS_)
+        for (; (end - ptr) >= 32; ptr += 32)
+        {
+            if (_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr))) != 0)
+                break;
+        }
+    #endif
+
+    #if defined(_XM_SSE_INTRINSICS_)
+        for (; (end - ptr) >= 16; ptr += 16)
+        {
+            if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))) != 0)
+                break;
+        }
+    #else
+        for (; (end - ptr) >= 8; ptr += 8)
+        {
+            uint64_t block;
+            memcpy(&block, ptr, sizeof(block));
+            if (block & 0x8080808080808080ull)
+                break;
+        }
+    #endif
+
+        // Finish the tail, or locate the first non-ASCII byte in the failing block.
+        while (ptr < end && *ptr < 0x80)
+            ++ptr;
+
+        return static_cast<size_t>(ptr - start);
+    }
+
+    // Decodes one UTF-8 sequence, advancing ptr past it. Malformed input yields U+FFFD and consumes the lead byte.
+    inline uint32_t DecodeUTF8(_Inout_ const uint8_t*& ptr, _In_ const uint8_t* end) noexcept
+    {
+        constexpr uint32_t c_replacementCharacter = 0xFFFD;
+
+        const uint32_t lead = *ptr++;
+        if (lead < 0x80)
+            return lead;
+
+        size_t trailing;
+        uint32_t codepoint;
+        uint32_t minimum;
+        if ((lead & 0xE0) == 0xC0)
+        {
+            trailing = 1;
+            codepoint = lead & 0x1F;
+            minimum = 0x80;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            trailing = 2;
+            codepoint = lead & 0x0F;
+            minimum = 0x800;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            trailing = 3;
+            codepoint = lead & 0x07;
+            minimum = 0x10000;
+        }
+        else
+        {
+            return c_replacementCharacter;
+        }
+
+        if (static_cast<size_t>(end - ptr) < trailing)
+            return c_replacementCharacter;
+
+        for (size_t j = 0; j < trailing; ++j)
+        {
+            const uint32_t next = ptr[j];
+            if ((next & 0xC0) != 0x80)
+                return c_replacementCharacter;
+
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+
+        // Reject overlong encodings, UTF-16 surrogates, and values beyond the Unicode range.
+        if (codepoint < minimum
+            || (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+            || codepoint > 0x10FFFF)
+            return c_replacementCharacter;
+
+        ptr += trailing;
+        return codepoint;
+    }
+}
+
 
 // Comparison operators make our sorted glyph vector work with std::binary_search and lower_bound.
 namespace DirectX
@@ -107,9 +318,10 @@ SpriteFont::Impl::Impl(
     bool forceSRGB) noexcept(false) :
     texture{},
     textureSize{},
+    asciiGlyphs{},
     defaultGlyph(nullptr),
     lineSpacing(0),
-    utfBufferSize(0)
+    layoutCacheSize(0)
 {
     // Validate the header.
     for (char const* magic = spriteFontMagic; *magic; magic++)
@@ -126,12 +338,8 @@ SpriteFont::Impl::Impl(
     auto glyphData = reader->ReadArray<Glyph>(glyphCount);
 
     glyphs.assign(glyphData, glyphData + glyphCount);
-    glyphsIndex.reserve(glyphs.size());
 
-    for (auto& glyph : glyphs)
-    {
-        glyphsIndex.emplace_back(glyph.Character);
-    }
+    BuildGlyphIndex();
 
     // Read font properties.
     lineSpacing = reader->Read<float>();
@@ -190,27 +398,48 @@ SpriteFont::Impl::Impl(
     texture(itexture),
     textureSize(itextureSize),
     glyphs(iglyphs, iglyphs + glyphCount),
+    asciiGlyphs{},
     defaultGlyph(nullptr),
     lineSpacing(ilineSpacing),
-    utfBufferSize(0)
+    layoutCacheSize(0)
 {
     if (!std::is_sorted(iglyphs, iglyphs + glyphCount))
     {
         throw std::runtime_error("Glyphs must be in ascending codepoint order");
     }
 
+    BuildGlyphIndex();
+}
+
+
+// Builds the search index for FindGlyph, plus a direct lookup table for the ASCII range.
+void SpriteFont::Impl::BuildGlyphIndex()
+{
+    glyphsIndex.clear();
     glyphsIndex.reserve(glyphs.size());
 
+    asciiGlyphs.fill(nullptr);
+
     for (auto& glyph : glyphs)
     {
         glyphsIndex.emplace_back(glyph.Character);
+
+        if (glyph.Character < asciiGlyphs.size())
+        {
+            asciiGlyphs[glyph.Character] = &glyph;
+        }
     }
 }
 
 
 // Looks up the requested glyph, falling back to the default character if it is not in the font.
-SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
+SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(uint32_t character) const
 {
+    if (character < asciiGlyphs.size() && asciiGlyphs[character])
+    {
+        return asciiGlyphs[character];
+    }
+
     // Rather than use std::lower_bound (which includes a slow debug path when built for _DEBUG),
     // we implement a binary search inline to ensure sufficient Debug build performance to be useful
     // for text-heavy applications.
@@ -277,42 +506,73 @@ void SpriteFont::Impl::ForEachGlyph(_In_z_ wchar_t const* text, TAction action,
 
     for (; *text; text++)
     {
-        const wchar_t character = *text;
+        LayoutCharacter(static_cast<uint32_t>(*text), x, y, action, ignoreWhitespace);
+    }
+}
+
 
-        switch (character)
+// UTF-8 text is decoded in place, so no intermediate wide string or shared buffer is required.
+template<typename TAction>
+void SpriteFont::Impl::ForEachGlyph(_In_z_ char const* text, TAction action, bool ignoreWhitespace) const
+{
+    float x = 0;
+    float y = 0;
+
+    auto ptr = reinterpret_cast<const uint8_t*>(text);
+    auto const end = ptr + strlen(text);
+
+    while (ptr < end)
+    {
+        // Runs of ASCII map directly to code points.
+        for (auto const run = ptr + CountASCII(ptr, end); ptr < run; ++ptr)
         {
-        case '\r':
-            // Skip carriage returns.
-            continue;
+            LayoutCharacter(*ptr, x, y, action, ignoreWhitespace);
+        }
 
-        case '\n':
-            // New line.
-            x = 0;
-            y += lineSpacing;
-            break;
+        if (ptr < end)
+        {
+            LayoutCharacter(DecodeUTF8(ptr, end), x, y, action, ignoreWhitespace);
+        }
+    }
+}
 
-        default:
-            // Output this character.
-            auto glyph = FindGlyph(character);
 
-            x += glyph->XOffset;
+template<typename TAction>
+void SpriteFont::Impl::LayoutCharacter(uint32_t character, float& x, float& y, TAction& action, bool ignoreWhitespace) const
+{
+    switch (character)
+    {
+    case '\r':
+        // Skip carriage returns.
+        break;
 
-            if (x < 0)
-                x = 0;
+    case '\n':
+        // New line.
+        x = 0;
+        y += lineSpacing;
+        break;
 
-            const float advance = float(glyph->Subrect.right) - float(glyph->Subrect.left) + glyph->XAdvance;
+    default:
+        // Output this character.
+        auto glyph = FindGlyph(character);
 
-            if (!ignoreWhitespace
-                || !iswspace(character)
-                || ((glyph->Subrect.right - glyph->Subrect.left) > 1)
-                || ((glyph->Subrect.bottom - glyph->Subrect.top) > 1))
-            {
-                action(glyph, x, y, advance);
-            }
+        x += glyph->XOffset;
 
-            x += advance;
-            break;
+        if (x < 0)
+            x = 0;
+
+        const float advance = float(glyph->Subrect.right) - float(glyph->Subrect.left) + glyph->XAdvance;
+
+        if (!ignoreWhitespace
+            || !IsWhitespace(character)
+            || ((glyph->Subrect.right - glyph->Subrect.left) > 1)
+            || ((glyph->Subrect.bottom - glyph->Subrect.top) > 1))
+        {
+            action(glyph, x, y, advance);
         }
+
+        x += advance;
+        break;
     }
 }
 
@@ -369,123 +629,29 @@ void SpriteFont::Impl::CreateTextureResource(
 }
 
 
-const wchar_t* SpriteFont::Impl::ConvertUTF8(_In_z_ const char *text) noexcept(false)
+template<typename TChar>
+void XM_CALLCONV SpriteFont::Impl::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ TChar const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth)
 {
-    if (!utfBuffer)
-    {
-        utfBufferSize = 1024;
-        utfBuffer.reset(new wchar_t[1024]);
-    }
-
-    int result = MultiByteToWideChar(CP_UTF8, 0, text, -1, utfBuffer.get(), static_cast<int>(utfBufferSize));
-    if (!result && (GetLastError() == ERROR_INSUFFICIENT_BUFFER))
-    {
-        // Compute required buffer size
-        result = MultiByteToWideChar(CP_UTF8, 0, text, -1, nullptr, 0);
-        utfBufferSize = AlignUp(static_cast<size_t>(result), 1024u);
-        utfBuffer.reset(new wchar_t[utfBufferSize]);
-
-        // Retry conversion
-        result = MultiByteToWideChar(CP_UTF8, 0, text, -1, utfBuffer.get(), static_cast<int>(utfBufferSize));
-    }
-
-    if (!result)
+    if (layoutCacheSize > 0)
     {
-        DebugTrace("ERROR: MultiByteToWideChar failed with error %u.\n", GetLastError());
-        throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "MultiByteToWideChar");
+        auto layout = GetCachedLayout(text);
+        DrawLayout(spriteBatch, *layout, position, color, rotation, origin, scale, effects, layerDepth);
+        return;
     }
 
-    return utfBuffer.get();
-}
-
-
-// Construct from a binary file created by the MakeSpriteFont utility.
-_Use_decl_annotations_
-SpriteFont::SpriteFont(ID3D12Device* device, ResourceUploadBatch& upload, wchar_t const* fileName, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorDest, D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptorDest, bool forceSRGB)
-{
-    BinaryReader reader(fileName);
-
-    pImpl = std::make_unique<Impl>(device, upload, &reader, cpuDescriptorDest, gpuDescriptorDest, forceSRGB);
-}
-
-
-// Construct from a binary blob created by the MakeSpriteFont utility and already loaded into memory.
-_Use_decl_annotations_
-SpriteFont::SpriteFont(ID3D12Device* device, ResourceUploadBatch& upload, uint8_t const* dataBlob, size_t dataSize, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorDest, D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptorDest, bool forceSRGB)
-{
-    BinaryReader reader(dataBlob, dataSize);
-
-    pImpl = std::make_unique<Impl>(device, upload, &reader, cpuDescriptorDest, gpuDescriptorDest, forceSRGB);
-}
-
-
-// Construct from arbitrary user specified glyph data (for those not using the MakeSpriteFont utility).
-_Use_decl_annotations_
-SpriteFont::SpriteFont(D3D12_GPU_DESCRIPTOR_HANDLE texture, XMUINT2 textureSize, Glyph const* glyphs, size_t glyphCount, float lineSpacing)
-    : pImpl(std::make_unique<Impl>(texture, textureSize, glyphs, glyphCount, lineSpacing))
-{
-}
-
-
-SpriteFont::SpriteFont(SpriteFont&&) noexcept = default;
-SpriteFont& SpriteFont::operator= (SpriteFont&&) noexcept = default;
-SpriteFont::~SpriteFont() = default;
-
-// Wide-character / UTF-16LE
-void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth) const
-{
-    DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
-}
-
-
-void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects, float layerDepth) const
-{
-    DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
-}
-
-
-void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth) const
-{
-    DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
-}
-
-
-void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
-{
-    static_assert(SpriteEffects_FlipHorizontally == 1 &&
-        SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
-
-// Lookup table indicates which way to move along each axis per SpriteEffects enum value.
-    static XMVECTORF32 axisDirectionTable[4] =
-    {
-        { { { -1, -1, 0, 0 } } },
-        { { {  1, -1, 0, 0 } } },
-        { { { -1,  1, 0, 0 } } },
-        { { {  1,  1, 0, 0 } } },
-    };
-
-    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
-    static XMVECTORF32 axisIsMirroredTable[4] =
-    {
-        { { { 0, 0, 0, 0 } } },
-        { { { 1, 0, 0, 0 } } },
-        { { { 0, 1, 0, 0 } } },
-        { { { 1, 1, 0, 0 } } },
-    };
-
     XMVECTOR baseOffset = origin;
 
     // If the text is mirrored, offset the start position accordingly.
     if (effects)
     {
         baseOffset = XMVectorNegativeMultiplySubtract(
-            MeasureString(text),
+            MeasureString(text, true),
             axisIsMirroredTable[effects & 3],
             baseOffset);
     }
 
     // Draw each character in turn.
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
+    ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
         {
             UNREFERENCED_PARAMETER(advance);
 
@@ -502,25 +668,59 @@ void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wc
                 offset = XMVectorMultiplyAdd(glyphRect, axisIsMirroredTable[effects & 3], offset);
             }
 
-            spriteBatch->Draw(pImpl->texture, pImpl->textureSize, position, &glyph->Subrect, color, rotation, offset, scale, effects, layerDepth);
+            spriteBatch->Draw(texture, textureSize, position, &glyph->Subrect, color, rotation, offset, scale, effects, layerDepth);
         }, true);
 }
 
 
-XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ wchar_t const* text, bool ignoreWhitespace) const
+void XM_CALLCONV SpriteFont::Impl::DrawLayout(_In_ SpriteBatch* spriteBatch, TextLayout const& layout, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
+{
+    const XMVECTOR axisDirection = axisDirectionTable[effects & 3];
+    const XMVECTOR axisIsMirrored = axisIsMirroredTable[effects & 3];
+
+    XMVECTOR baseOffset = origin;
+
+    // If the text is mirrored, offset the start position accordingly.
+    if (effects)
+    {
+        baseOffset = XMVectorNegativeMultiplySubtract(XMLoadFloat2(&layout.size), axisIsMirrored, baseOffset);
+    }
+
+    for (auto const& item : layout.items)
+    {
+        XMVECTOR offset = XMVectorMultiplyAdd(XMLoadFloat2(&item.offset), axisDirection, baseOffset);
+
+        if (effects)
+        {
+            // For mirrored characters, specify bottom and/or right instead of top left.
+            offset = XMVectorMultiplyAdd(XMLoadFloat2(&item.extent), axisIsMirrored, offset);
+        }
+
+        spriteBatch->Draw(texture, textureSize, position, &item.subrect, color, rotation, offset, scale, effects, layerDepth);
+    }
+}
+
+
+template<typename TChar>
+XMVECTOR SpriteFont::Impl::MeasureString(_In_z_ TChar const* text, bool ignoreWhitespace)
 {
+    if (ignoreWhitespace && layoutCacheSize > 0)
+    {
+        return GetCachedLayout(text)->GetSize();
+    }
+
     XMVECTOR result = XMVectorZero();
 
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
+    ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
         {
             UNREFERENCED_PARAMETER(advance);
 
             auto const w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
             auto h = static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top) + glyph->YOffset;
 
-            h = iswspace(wchar_t(glyph->Character)) ?
-                pImpl->lineSpacing :
-                std::max(h, pImpl->lineSpacing);
+            h = IsWhitespace(glyph->Character) ?
+                lineSpacing :
+                std::max(h, lineSpacing);
 
             result = XMVectorMax(result, XMVectorSet(x + w, y + h, 0, 0));
         }, ignoreWhitespace);
@@ -529,16 +729,17 @@ XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ wchar_t const* text, bool
 }
 
 
-RECT SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
+template<typename TChar>
+RECT SpriteFont::Impl::MeasureDrawBounds(_In_z_ TChar const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
 {
     RECT result = { LONG_MAX, LONG_MAX, 0, 0 };
 
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance) noexcept
+    ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance) noexcept
         {
-            auto const isWhitespace = iswspace(wchar_t(glyph->Character));
+            auto const isWhitespace = IsWhitespace(glyph->Character);
             auto const w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
             auto const h = isWhitespace ?
-                pImpl->lineSpacing :
+                lineSpacing :
                 static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top);
 
             const float minX = position.x + x;
@@ -570,49 +771,223 @@ RECT SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, XMFLOAT2 const& p
 }
 
 
+// Runs the glyph layout once, recording everything DrawString, MeasureString, and MeasureDrawBounds need.
+template<typename TChar>
+void SpriteFont::Impl::PrepareLayout(_In_z_ TChar const* text, TextLayout& layout) const
+{
+    layout.items.clear();
+
+    XMVECTOR size = XMVectorZero();
+    XMVECTOR minBounds = XMVectorReplicate(FLT_MAX);
+    XMVECTOR maxBounds = XMVectorReplicate(-FLT_MAX);
+
+    ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
+        {
+            auto const isWhitespace = IsWhitespace(glyph->Character);
+            auto const w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
+            auto const h = static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top);
+
+            TextLayout::Item item;
+            item.subrect = glyph->Subrect;
+            item.offset = XMFLOAT2(x, y + glyph->YOffset);
+            item.extent = XMFLOAT2(w, h);
+            layout.items.emplace_back(item);
+
+            // See MeasureString.
+            auto const mh = isWhitespace ? lineSpacing : std::max(h + glyph->YOffset, lineSpacing);
+            size = XMVectorMax(size, XMVectorSet(x + w, y + mh, 0, 0));
+
+            // See MeasureDrawBounds.
+            const float minY = y + (isWhitespace ? 0.0f : glyph->YOffset);
+            const float maxY = minY + (isWhitespace ? lineSpacing : h);
+            minBounds = XMVectorMin(minBounds, XMVectorSet(x, minY, 0, 0));
+            maxBounds = XMVectorMax(maxBounds, XMVectorSet(std::max(x + advance, x + w), maxY, 0, 0));
+        }, true);
+
+    XMStoreFloat2(&layout.size, size);
+    XMStoreFloat4(&layout.bounds, XMVectorPermute<0, 1, 4, 5>(minBounds, maxBounds));
+}
+
+
+// Returns the layout for the text from the cache, preparing and inserting it on a miss.
+template<typename TChar>
+std::shared_ptr<const SpriteFont::TextLayout> SpriteFont::Impl::GetCachedLayout(_In_z_ TChar const* text)
+{
+    const size_t length = TextLength(text);
+    const uint64_t hash = HashKey(text, length);
+
+    std::lock_guard<std::mutex> lock(layoutCacheLock);
+
+    auto range = layoutCacheIndex.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        auto entry = it->second;
+        if (MatchesKey(entry->key, text, length))
+        {
+            layoutCacheList.splice(layoutCacheList.begin(), layoutCacheList, entry);
+            return entry->layout;
+        }
+    }
+
+    auto layout = std::make_shared<TextLayout>();
+    PrepareLayout(text, *layout);
+
+    layoutCacheList.emplace_front(LayoutCacheEntry{ MakeCacheKey(text, length), layout });
+    layoutCacheIndex.emplace(hash, layoutCacheList.begin());
+
+    // Evict least recently used entries.
+    while (layoutCacheList.size() > layoutCacheSize)
+    {
+        auto last = std::prev(layoutCacheList.end());
+
+        range = layoutCacheIndex.equal_range(HashKey(last->key));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == last)
+            {
+                layoutCacheIndex.erase(it);
+                break;
+            }
+        }
+
+        layoutCacheList.erase(last);
+    }
+
+    return layout;
+}
+
+
+void SpriteFont::Impl::SetLayoutCacheSize(size_t maxEntries)
+{
+    std::lock_guard<std::mutex> lock(layoutCacheLock);
+
+    layoutCacheSize = maxEntries;
+    layoutCacheList.clear();
+    layoutCacheIndex.clear();
+}
+
+
+void SpriteFont::Impl::ClearLayoutCache() noexcept
+{
+    std::lock_guard<std::mutex> lock(layoutCacheLock);
+
+    layoutCacheList.clear();
+    layoutCacheIndex.clear();
+}
+
+
+// Construct from a binary file created by the MakeSpriteFont utility.
+_Use_decl_annotations_
+SpriteFont::SpriteFont(ID3D12Device* device, ResourceUploadBatch& upload, wchar_t const* fileName, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorDest, D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptorDest, bool forceSRGB)
+{
+    BinaryReader reader(fileName);
+
+    pImpl = std::make_unique<Impl>(device, upload, &reader, cpuDescriptorDest, gpuDescriptorDest, forceSRGB);
+}
+
+
+// Construct from a binary blob created by the MakeSpriteFont utility and already loaded into memory.
+_Use_decl_annotations_
+SpriteFont::SpriteFont(ID3D12Device* device, ResourceUploadBatch& upload, uint8_t const* dataBlob, size_t dataSize, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorDest, D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptorDest, bool forceSRGB)
+{
+    BinaryReader reader(dataBlob, dataSize);
+
+    pImpl = std::make_unique<Impl>(device, upload, &reader, cpuDescriptorDest, gpuDescriptorDest, forceSRGB);
+}
+
+
+// Construct from arbitrary user specified glyph data (for those not using the MakeSpriteFont utility).
+_Use_decl_annotations_
+SpriteFont::SpriteFont(D3D12_GPU_DESCRIPTOR_HANDLE texture, XMUINT2 textureSize, Glyph const* glyphs, size_t glyphCount, float lineSpacing)
+    : pImpl(std::make_unique<Impl>(texture, textureSize, glyphs, glyphCount, lineSpacing))
+{
+}
+
+
+SpriteFont::SpriteFont(SpriteFont&&) noexcept = default;
+SpriteFont& SpriteFont::operator= (SpriteFont&&) noexcept = default;
+SpriteFont::~SpriteFont() = default;
+
+// Wide-character / UTF-16LE
+void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth) const
+{
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects, float layerDepth) const
+{
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth) const
+{
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
+{
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects, layerDepth);
+}
+
+
+XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ wchar_t const* text, bool ignoreWhitespace) const
+{
+    return pImpl->MeasureString(text, ignoreWhitespace);
+}
+
+
+RECT SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
+{
+    return pImpl->MeasureDrawBounds(text, position, ignoreWhitespace);
+}
+
+
 RECT XM_CALLCONV SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, FXMVECTOR position, bool ignoreWhitespace) const
 {
     XMFLOAT2 pos;
     XMStoreFloat2(&pos, position);
 
-    return MeasureDrawBounds(text, pos, ignoreWhitespace);
+    return pImpl->MeasureDrawBounds(text, pos, ignoreWhitespace);
 }
 
 
 // UTF-8
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, XMFLOAT2 const& scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMLoadFloat2(&scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, float scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, XMVectorReplicate(scale), effects, layerDepth);
 }
 
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ char const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
 {
-    DrawString(spriteBatch, pImpl->ConvertUTF8(text), position, color, rotation, origin, scale, effects, layerDepth);
+    pImpl->DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects, layerDepth);
 }
 
 
 XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ char const* text, bool ignoreWhitespace) const
 {
-    return MeasureString(pImpl->ConvertUTF8(text), ignoreWhitespace);
+    return pImpl->MeasureString(text, ignoreWhitespace);
 }
 
 
 RECT SpriteFont::MeasureDrawBounds(_In_z_ char const* text, XMFLOAT2 const& position, bool ignoreWhitespace) const
 {
-    return MeasureDrawBounds(pImpl->ConvertUTF8(text), position, ignoreWhitespace);
+    return pImpl->MeasureDrawBounds(text, position, ignoreWhitespace);
 }
 
 
@@ -621,7 +996,7 @@ RECT XM_CALLCONV SpriteFont::MeasureDrawBounds(_In_z_ char const* text, FXMVECTO
     XMFLOAT2 pos;
     XMStoreFloat2(&pos, position);
 
-    return MeasureDrawBounds(pImpl->ConvertUTF8(text), pos, ignoreWhitespace);
+    return pImpl->MeasureDrawBounds(text, pos, ignoreWhitespace);
 }
 
 
@@ -635,6 +1010,7 @@ float SpriteFont::GetLineSpacing() const noexcept
 void SpriteFont::SetLineSpacing(float spacing)
 {
     pImpl->lineSpacing = spacing;
+    pImpl->ClearLayoutCache();
 }
 
 
@@ -648,6 +1024,7 @@ wchar_t SpriteFont::GetDefaultCharacter() const noexcept
 void SpriteFont::SetDefaultCharacter(wchar_t character)
 {
     pImpl->SetDefaultCharacter(character);
+    pImpl->ClearLayoutCache();
 }
 
 
@@ -676,6 +1053,88 @@ XMUINT2 SpriteFont::GetSpriteSheetSize() const noexcept
 }
 
 
+// Pre-computed layout
+SpriteFont::TextLayout SpriteFont::PrepareString(_In_z_ wchar_t const* text) const
+{
+    TextLayout layout;
+    pImpl->PrepareLayout(text, layout);
+    return layout;
+}
+
+
+SpriteFont::TextLayout SpriteFont::PrepareString(_In_z_ char const* text) const
+{
+    TextLayout layout;
+    pImpl->PrepareLayout(text, layout);
+    return layout;
+}
+
+
+void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, TextLayout const& layout, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, SpriteEffects effects, float layerDepth) const
+{
+    DrawString(spriteBatch, layout, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), effects, layerDepth);
+}
+
+
+void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, TextLayout const& layout, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
+{
+    pImpl->DrawLayout(spriteBatch, layout, position, color, rotation, origin, scale, effects, layerDepth);
+}
+
+
+void SpriteFont::SetLayoutCacheSize(size_t maxEntries)
+{
+    pImpl->SetLayoutCacheSize(maxEntries);
+}
+
+
+size_t SpriteFont::GetLayoutCacheSize() const noexcept
+{
+    return pImpl->layoutCacheSize;
+}
+
+
+void SpriteFont::ClearLayoutCache() noexcept
+{
+    pImpl->ClearLayoutCache();
+}
+
+
+//--------------------------------------------------------------------------------------
+// SpriteFont::TextLayout
+
+SpriteFont::TextLayout::TextLayout() noexcept :
+    size{},
+    bounds{}
+{
+}
+
+
+XMVECTOR XM_CALLCONV SpriteFont::TextLayout::GetSize() const noexcept
+{
+    return XMLoadFloat2(&size);
+}
+
+
+RECT SpriteFont::TextLayout::GetDrawBounds(XMFLOAT2 const& position) const noexcept
+{
+    if (items.empty())
+    {
+        return RECT{ 0, 0, 0, 0 };
+    }
+
+    const float maxX = position.x + bounds.z;
+    const float maxY = position.y + bounds.w;
+
+    RECT result;
+    result.left = long(position.x + bounds.x);
+    result.top = long(position.y + bounds.y);
+    result.right = (maxX > 0) ? long(maxX) : 0;
+    result.bottom = (maxY > 0) ? long(maxY) : 0;
+    return result;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Adapters for /Zc:wchar_t- clients
 
@@ -737,7 +1196,7 @@ RECT SpriteFont::MeasureDrawBounds(_In_z_ __wchar_t const* text, FXMVECTOR posit
 
 void SpriteFont::SetDefaultCharacter(__wchar_t character)
 {
-    pImpl->SetDefaultCharacter(static_cast<unsigned short>(character));
+    SetDefaultCharacter(static_cast<wchar_t>(character));
 }
 
 bool SpriteFont::ContainsCharacter(__wchar_t character) const
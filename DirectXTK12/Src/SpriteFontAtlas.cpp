@@ -0,0 +1,240 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteFontAtlas.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "SpriteFontAtlas.h"
+#include "AtlasPacker.h"
+#include "BinaryReader.h"
+#include "BufferHelpers.h"
+#include "DirectXHelpers.h"
+#include "PlatformHelpers.h"
+
+using namespace DirectX;
+
+static_assert(sizeof(SpriteFont::Glyph) == sizeof(AtlasPacker::Glyph), "Glyph layout mismatch");
+static_assert(offsetof(SpriteFont::Glyph, Subrect) == offsetof(AtlasPacker::Glyph, Subrect), "Glyph layout mismatch");
+static_assert(offsetof(SpriteFont::Glyph, XAdvance) == offsetof(AtlasPacker::Glyph, XAdvance), "Glyph layout mismatch");
+static_assert(sizeof(RECT) == sizeof(AtlasPacker::Rect), "RECT layout mismatch");
+
+
+// Internal SpriteFontAtlas implementation class.
+class SpriteFontAtlas::Impl
+{
+public:
+    Impl(uint32_t imaxSize, uint32_t ipadding) noexcept :
+        maxSize(imaxSize),
+        padding(ipadding),
+        packed(false),
+        atlas{}
+    {
+    }
+
+    size_t AddFont(AtlasPacker::Font&& font)
+    {
+        if (packed)
+            throw std::logic_error("SpriteFontAtlas already packed");
+
+        fonts.emplace_back(std::move(font));
+        return fonts.size() - 1;
+    }
+
+    void CheckPacked() const
+    {
+        if (!packed)
+            throw std::logic_error("SpriteFontAtlas::Pack must be called first");
+    }
+
+    uint32_t maxSize;
+    uint32_t padding;
+    bool packed;
+
+    std::vector<AtlasPacker::Font> fonts;
+    std::vector<AtlasPacker::Image> images;
+
+    AtlasPacker::Image atlas;
+    std::vector<AtlasPacker::Rect> imageRects;
+};
+
+
+SpriteFontAtlas::SpriteFontAtlas(uint32_t maxTextureSize, uint32_t padding) :
+    pImpl(std::make_unique<Impl>(maxTextureSize, padding))
+{
+}
+
+
+SpriteFontAtlas::SpriteFontAtlas(SpriteFontAtlas&&) noexcept = default;
+SpriteFontAtlas& SpriteFontAtlas::operator= (SpriteFontAtlas&&) noexcept = default;
+SpriteFontAtlas::~SpriteFontAtlas() = default;
+
+
+_Use_decl_annotations_
+size_t SpriteFontAtlas::AddFont(wchar_t const* fileName)
+{
+    std::unique_ptr<uint8_t[]> data;
+    size_t dataSize = 0;
+    ThrowIfFailed(BinaryReader::ReadEntireFile(fileName, data, &dataSize));
+
+    return AddFont(data.get(), dataSize);
+}
+
+
+_Use_decl_annotations_
+size_t SpriteFontAtlas::AddFont(uint8_t const* dataBlob, size_t dataSize)
+{
+    try
+    {
+        return pImpl->AddFont(AtlasPacker::ParseSpriteFont(dataBlob, dataSize));
+    }
+    catch (std::runtime_error const&)
+    {
+        DebugTrace("ERROR: SpriteFontAtlas provided with an invalid .spritefont file\n");
+        throw;
+    }
+}
+
+
+_Use_decl_annotations_
+size_t SpriteFontAtlas::AddImage(uint32_t width, uint32_t height, DXGI_FORMAT format, uint32_t stride, uint8_t const* pixels)
+{
+    if (pImpl->packed)
+        throw std::logic_error("SpriteFontAtlas already packed");
+
+    const uint32_t bpp = AtlasPacker::BytesPerPixel(static_cast<uint32_t>(format));
+    if (!bpp || uint64_t(stride) < uint64_t(width) * bpp)
+        throw std::invalid_argument("SpriteFontAtlas images must be uncompressed with a valid stride");
+
+    AtlasPacker::Image image;
+    image.width = width;
+    image.height = height;
+    image.format = static_cast<uint32_t>(format);
+    image.stride = stride;
+    image.pixels.assign(pixels, pixels + size_t(stride) * height);
+
+    pImpl->images.emplace_back(std::move(image));
+    return pImpl->images.size() - 1;
+}
+
+
+void SpriteFontAtlas::Pack()
+{
+    if (pImpl->packed)
+        throw std::logic_error("SpriteFontAtlas already packed");
+
+    AtlasPacker::Pack(pImpl->fonts, pImpl->images, pImpl->padding, pImpl->maxSize, pImpl->atlas, pImpl->imageRects);
+
+    pImpl->images.clear();
+    pImpl->packed = true;
+}
+
+
+XMUINT2 SpriteFontAtlas::GetTextureSize() const noexcept
+{
+    return XMUINT2(pImpl->atlas.width, pImpl->atlas.height);
+}
+
+
+DXGI_FORMAT SpriteFontAtlas::GetTextureFormat() const noexcept
+{
+    return static_cast<DXGI_FORMAT>(pImpl->atlas.format);
+}
+
+
+_Use_decl_annotations_
+SpriteFont::Glyph const* SpriteFontAtlas::GetGlyphs(size_t font, size_t* glyphCount) const
+{
+    pImpl->CheckPacked();
+
+    auto const& glyphs = pImpl->fonts.at(font).glyphs;
+    *glyphCount = glyphs.size();
+    return reinterpret_cast<SpriteFont::Glyph const*>(glyphs.data());
+}
+
+
+float SpriteFontAtlas::GetLineSpacing(size_t font) const
+{
+    return pImpl->fonts.at(font).lineSpacing;
+}
+
+
+wchar_t SpriteFontAtlas::GetDefaultCharacter(size_t font) const
+{
+    return static_cast<wchar_t>(pImpl->fonts.at(font).defaultCharacter);
+}
+
+
+RECT SpriteFontAtlas::GetImageRect(size_t image) const
+{
+    pImpl->CheckPacked();
+
+    auto const& r = pImpl->imageRects.at(image);
+    return RECT{ r.left, r.top, r.right, r.bottom };
+}
+
+
+_Use_decl_annotations_
+HRESULT SpriteFontAtlas::CreateTextureResource(ID3D12Device* device, ResourceUploadBatch& upload, ID3D12Resource** texture) const noexcept
+{
+    if (!texture)
+        return E_INVALIDARG;
+
+    *texture = nullptr;
+
+    if (!pImpl->packed)
+        return E_UNEXPECTED;
+
+    auto const& atlas = pImpl->atlas;
+
+    D3D12_SUBRESOURCE_DATA initData = {
+        atlas.pixels.data(),
+        static_cast<LONG_PTR>(atlas.stride),
+        static_cast<LONG_PTR>(atlas.pixels.size())
+    };
+
+    HRESULT hr = CreateTextureFromMemory(device, upload,
+        atlas.width, atlas.height,
+        static_cast<DXGI_FORMAT>(atlas.format),
+        initData,
+        texture);
+    if (SUCCEEDED(hr))
+    {
+        SetDebugObjectName(*texture, L"SpriteFontAtlas:Texture");
+    }
+
+    return hr;
+}
+
+
+std::unique_ptr<SpriteFont> SpriteFontAtlas::CreateSpriteFont(size_t font, D3D12_GPU_DESCRIPTOR_HANDLE texture) const
+{
+    size_t glyphCount = 0;
+    auto glyphs = GetGlyphs(font, &glyphCount);
+
+    auto result = std::make_unique<SpriteFont>(texture, GetTextureSize(), glyphs, glyphCount, GetLineSpacing(font));
+    result->SetDefaultCharacter(GetDefaultCharacter(font));
+
+    return result;
+}
+
+
+_Use_decl_annotations_
+SpriteFontAtlas::BatchStatistics SpriteFontAtlas::EstimateBatches(TextRun const* runs, size_t runCount) const
+{
+    std::vector<AtlasPacker::TextRun> packerRuns;
+    packerRuns.reserve(runCount);
+
+    for (size_t j = 0; j < runCount; ++j)
+    {
+        packerRuns.emplace_back(AtlasPacker::TextRun{ runs[j].font, runs[j].text });
+    }
+
+    auto const estimate = AtlasPacker::EstimateBatches(pImpl->fonts, packerRuns.data(), packerRuns.size());
+
+    return BatchStatistics{ estimate.separateTextures, estimate.sharedAtlas };
+}
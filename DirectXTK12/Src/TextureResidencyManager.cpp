@@ -0,0 +1,469 @@
+//--------------------------------------------------------------------------------------
+// File: TextureResidencyManager.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "TextureResidencyManager.h"
+
+#include "DDSStreamingHelpers.h"
+#include "FenceCompletionQueue.h"
+#include "TextureResidencyPolicy.h"
+
+using namespace DirectX;
+using namespace DirectX::StreamingHelpers;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_notResident = size_t(-1);
+}
+
+
+// Internal TextureResidencyManager implementation class.
+class TextureResidencyManager::Impl
+{
+public:
+    Impl(_In_ ID3D12Device* device, uint64_t memoryBudget, uint64_t uploadBudget, uint64_t tailSize);
+
+    Impl(Impl&&) = delete;
+    Impl& operator= (Impl&&) = delete;
+
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
+
+    ~Impl();
+
+    size_t Load(_In_z_ const wchar_t* fileName, size_t maxsize, DDS_LOADER_FLAGS loadFlags);
+    uint64_t Update(ResourceUploadBatch& resourceUpload, _Out_opt_ std::vector<size_t>* rebuiltTextures);
+    void Commit(_In_ ID3D12CommandQueue* commandQueue);
+
+    struct ResidentTexture
+    {
+        ScopedHandle file;
+        DDS_LOADER_FLAGS loadFlags;
+        TextureInfo info;
+        DDS_ALPHA_MODE alphaMode;
+        MipChainLayout layout;
+        size_t coarsestMip;
+
+        ComPtr<ID3D12Resource> resource;
+        size_t topMip;
+    };
+
+    ResidentTexture const& GetTexture(size_t texture) const
+    {
+        return *mTextures.at(texture);
+    }
+
+    ComPtr<ID3D12Device> mDevice;
+    uint64_t mMemoryBudget;
+    uint64_t mUploadBudget;
+    uint64_t mTailSize;
+    uint64_t mResidentBytes;
+
+    TextureResidencyPolicy mPolicy;
+    std::vector<std::unique_ptr<ResidentTexture>> mTextures;
+
+private:
+    static size_t GetReadMips(ResidentTexture const& texture, size_t topMip) noexcept;
+    void Rebuild(ResourceUploadBatch& resourceUpload, size_t index, size_t topMip);
+
+    struct QueueFence
+    {
+        ComPtr<ID3D12Fence> Fence;
+        uint64_t LastValue;
+    };
+
+    std::vector<size_t> mTargets;
+
+    // Replaced resources wait in mRetired for the next Commit, then for the fence that Commit signals.
+    std::vector<ComPtr<ID3D12Resource>> mRetired;
+    std::map<ID3D12CommandQueue*, QueueFence> mFences;
+    FenceCompletionQueue<ID3D12Fence*, ComPtr<ID3D12Resource>> mReleases;
+};
+
+
+TextureResidencyManager::Impl::Impl(_In_ ID3D12Device* device, uint64_t memoryBudget, uint64_t uploadBudget, uint64_t tailSize) :
+    mDevice(device),
+    mMemoryBudget(memoryBudget),
+    mUploadBudget(uploadBudget),
+    mTailSize(tailSize),
+    mResidentBytes(0)
+{
+    if (!device)
+        throw std::invalid_argument("Direct3D device is null");
+}
+
+
+// Replaced resources may still be in use by submitted frames, so wait for the last fence signaled on each queue
+// before releasing them. Resources retired since the last Commit were never signaled; they can only still be in use
+// by upload batches, which hold their own references.
+TextureResidencyManager::Impl::~Impl()
+{
+    if (mReleases.empty())
+        return;
+
+    ScopedHandle event(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+
+    for (auto const& it : mFences)
+    {
+        auto fence = it.second.Fence.Get();
+        if (!fence || fence->GetCompletedValue() >= it.second.LastValue)
+            continue;
+
+        if (event && SUCCEEDED(fence->SetEventOnCompletion(it.second.LastValue, event.get())))
+        {
+            std::ignore = WaitForSingleObject(event.get(), INFINITE);
+        }
+
+        while (fence->GetCompletedValue() < it.second.LastValue)
+            SwitchToThread();
+    }
+
+    std::vector<ComPtr<ID3D12Resource>> released;
+    mReleases.Drain(released);
+}
+
+
+size_t TextureResidencyManager::Impl::Load(_In_z_ const wchar_t* fileName, size_t maxsize, DDS_LOADER_FLAGS loadFlags)
+{
+    if (!fileName)
+        throw std::invalid_argument("fileName is null");
+
+    auto texture = std::make_unique<ResidentTexture>();
+    texture->loadFlags = loadFlags;
+    texture->info = {};
+    texture->alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    texture->topMip = c_notResident;
+
+    HRESULT hr = OpenFile(fileName, texture->file);
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadLayout(texture->file.get(), mDevice.Get(), texture->info, texture->layout, texture->alphaMode);
+    }
+
+    if (FAILED(hr))
+    {
+        DebugTrace("ERROR: TextureResidencyManager failed to load %ls (%08X)\n", fileName, static_cast<unsigned int>(hr));
+        throw com_exception(hr);
+    }
+
+    auto const& layout = texture->layout;
+
+    const size_t finestMip = StreamingHelpers::GetTopMip(layout, maxsize);
+    texture->coarsestMip = layout.PlanCoarsestFirst(finestMip, mTailSize).front().firstMip;
+
+    std::vector<uint64_t> residentBytes(layout.GetMipCount());
+    for (size_t mip = 0; mip < residentBytes.size(); ++mip)
+    {
+        residentBytes[mip] = StreamingHelpers::GetLoadedBytes(texture->info, layout.GetBytes(mip, layout.GetMipCount() - mip));
+    }
+
+    const size_t index = mPolicy.AddTexture(std::move(residentBytes), finestMip, texture->coarsestMip);
+    mTextures.emplace_back(std::move(texture));
+
+    assert(index == mTextures.size() - 1);
+    return index;
+}
+
+
+// Rebuilds the textures furthest from their target first. New textures start with just their mip tail, which
+// is cheap, and are promoted on later updates. Textures losing mips are rebuilt before those gaining them,
+// so memory is freed before more is used.
+uint64_t TextureResidencyManager::Impl::Update(ResourceUploadBatch& resourceUpload, _Out_opt_ std::vector<size_t>* rebuiltTextures)
+{
+    mPolicy.Compute(mMemoryBudget, mTargets);
+
+    struct Change
+    {
+        size_t texture;
+        size_t topMip;
+        int order;
+        size_t distance;
+    };
+
+    std::vector<Change> changes;
+    for (size_t j = 0; j < mTextures.size(); ++j)
+    {
+        auto const& texture = *mTextures[j];
+        const size_t target = mTargets[j];
+
+        if (texture.topMip == c_notResident)
+        {
+            changes.emplace_back(Change{ j, texture.coarsestMip, 0, 0 });
+        }
+        else if (target > texture.topMip)
+        {
+            changes.emplace_back(Change{ j, target, 1, target - texture.topMip });
+        }
+        else if (target < texture.topMip)
+        {
+            changes.emplace_back(Change{ j, target, 2, texture.topMip - target });
+        }
+    }
+
+    std::stable_sort(changes.begin(), changes.end(), [](Change const& a, Change const& b) noexcept
+        {
+            if (a.order != b.order)
+                return a.order < b.order;
+
+            return a.distance > b.distance;
+        });
+
+    // Always allow one rebuild, so a texture larger than the budget still gets through.
+    uint64_t uploaded = 0;
+    for (auto const& it : changes)
+    {
+        auto const& texture = *mTextures[it.texture];
+        auto const& layout = texture.layout;
+
+        const uint64_t bytes = GetLoadedBytes(texture.info, layout.GetBytes(it.topMip, GetReadMips(texture, it.topMip)));
+        if (uploaded > 0 && uploaded + bytes > mUploadBudget)
+            break;
+
+        Rebuild(resourceUpload, it.texture, it.topMip);
+        uploaded += bytes;
+
+        if (rebuiltTextures)
+        {
+            rebuiltTextures->push_back(it.texture);
+        }
+    }
+
+    return uploaded;
+}
+
+
+// Number of mips from topMip down that are not resident and must be read from the file.
+size_t TextureResidencyManager::Impl::GetReadMips(ResidentTexture const& texture, size_t topMip) noexcept
+{
+    if (!texture.resource)
+        return texture.layout.GetMipCount() - topMip;
+
+    return (texture.topMip > topMip) ? texture.topMip - topMip : 0;
+}
+
+
+// Resources cannot change their mip count, so a rebuild creates a new texture. Mips that are already resident
+// are copied from the old resource on the GPU; only the byte ranges of the new mips are read from the file.
+void TextureResidencyManager::Impl::Rebuild(ResourceUploadBatch& resourceUpload, size_t index, size_t topMip)
+{
+    auto& texture = *mTextures[index];
+    auto const& layout = texture.layout;
+    const size_t mipCount = layout.GetMipCount() - topMip;
+    const size_t readMips = GetReadMips(texture, topMip);
+
+    std::unique_ptr<uint8_t[]> data;
+    if (readMips > 0)
+    {
+        ThrowIfFailed(ReadMips(texture.file.get(), texture.info, layout, topMip, readMips, data));
+    }
+
+    ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(CreateTexture(mDevice.Get(), texture.info, layout, topMip, texture.loadFlags, resource.GetAddressOf()));
+
+    SetDebugObjectName(resource.Get(), L"TextureResidencyManager");
+
+    if (readMips > 0)
+    {
+        UploadMips(resourceUpload, resource.Get(), texture.info, layout, topMip, topMip, readMips, data.get());
+    }
+
+    if (readMips < mipCount)
+    {
+        // The old resource holds mips [texture.topMip, end), which covers every mip not read above.
+        const size_t firstMip = topMip + readMips;
+        const auto arraySize = static_cast<UINT>(layout.GetArraySize());
+        const auto oldMips = static_cast<UINT>(layout.GetMipCount() - texture.topMip);
+
+        for (UINT slice = 0; slice < arraySize; ++slice)
+        {
+            resourceUpload.CopySubresources(
+                resource.Get(),
+                D3D12CalcSubresource(static_cast<UINT>(firstMip - topMip), slice, 0u, static_cast<UINT>(mipCount), arraySize),
+                texture.resource.Get(),
+                D3D12CalcSubresource(static_cast<UINT>(firstMip - texture.topMip), slice, 0u, oldMips, arraySize),
+                static_cast<uint32_t>(mipCount - readMips));
+        }
+    }
+
+    resourceUpload.Transition(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    if (texture.resource)
+    {
+        mResidentBytes -= mPolicy.GetResidentBytes(index, texture.topMip);
+        mRetired.emplace_back(std::move(texture.resource));
+    }
+
+    texture.resource = std::move(resource);
+    texture.topMip = topMip;
+    mResidentBytes += mPolicy.GetResidentBytes(index, topMip);
+}
+
+
+void TextureResidencyManager::Impl::Commit(_In_ ID3D12CommandQueue* commandQueue)
+{
+    if (!commandQueue)
+        throw std::invalid_argument("Direct3D command queue is null");
+
+    if (!mRetired.empty())
+    {
+        auto& queueFence = mFences[commandQueue];
+        if (!queueFence.Fence)
+        {
+            ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(queueFence.Fence.GetAddressOf())));
+
+            SetDebugObjectName(queueFence.Fence.Get(), L"TextureResidencyManager");
+        }
+
+        const uint64_t value = queueFence.LastValue + 1;
+        ThrowIfFailed(commandQueue->Signal(queueFence.Fence.Get(), value));
+        queueFence.LastValue = value;
+
+        for (auto& it : mRetired)
+        {
+            mReleases.Push(queueFence.Fence.Get(), value, std::move(it));
+        }
+        mRetired.clear();
+    }
+
+    if (!mReleases.empty())
+    {
+        std::vector<ComPtr<ID3D12Resource>> released;
+        mReleases.Retire([](ID3D12Fence* fence) { return fence->GetCompletedValue(); }, released);
+    }
+}
+
+
+// Public constructor.
+TextureResidencyManager::TextureResidencyManager(_In_ ID3D12Device* device, uint64_t memoryBudget, uint64_t uploadBudget, uint64_t tailSize)
+    : pImpl(std::make_unique<Impl>(device, memoryBudget, uploadBudget, tailSize))
+{
+}
+
+
+TextureResidencyManager::TextureResidencyManager(TextureResidencyManager&&) noexcept = default;
+TextureResidencyManager& TextureResidencyManager::operator= (TextureResidencyManager&&) noexcept = default;
+TextureResidencyManager::~TextureResidencyManager() = default;
+
+
+_Use_decl_annotations_
+size_t TextureResidencyManager::Load(const wchar_t* fileName, size_t maxsize, DDS_LOADER_FLAGS loadFlags)
+{
+    return pImpl->Load(fileName, maxsize, loadFlags);
+}
+
+
+void TextureResidencyManager::SetScreenSize(size_t texture, float screenWidth, float screenHeight, float priority)
+{
+    auto const& top = pImpl->GetTexture(texture).layout.GetMip(0);
+
+    pImpl->mPolicy.SetDemand(texture,
+        TextureResidencyPolicy::GetMipForScreenSize(top.width, top.height, screenWidth, screenHeight),
+        priority);
+}
+
+
+void TextureResidencyManager::SetDesiredMip(size_t texture, uint32_t mip, float priority)
+{
+    pImpl->mPolicy.SetDemand(texture, mip, priority);
+}
+
+
+void TextureResidencyManager::ClearDemand() noexcept
+{
+    pImpl->mPolicy.ClearDemand();
+}
+
+
+_Use_decl_annotations_
+uint64_t TextureResidencyManager::Update(ResourceUploadBatch& resourceUpload, std::vector<size_t>* rebuiltTextures)
+{
+    return pImpl->Update(resourceUpload, rebuiltTextures);
+}
+
+
+_Use_decl_annotations_
+void TextureResidencyManager::Commit(ID3D12CommandQueue* commandQueue)
+{
+    pImpl->Commit(commandQueue);
+}
+
+
+void TextureResidencyManager::SetMemoryBudget(uint64_t bytes) noexcept
+{
+    pImpl->mMemoryBudget = bytes;
+}
+
+
+uint64_t TextureResidencyManager::GetMemoryBudget() const noexcept
+{
+    return pImpl->mMemoryBudget;
+}
+
+
+void TextureResidencyManager::SetUploadBudget(uint64_t bytesPerUpdate) noexcept
+{
+    pImpl->mUploadBudget = bytesPerUpdate;
+}
+
+
+uint64_t TextureResidencyManager::GetUploadBudget() const noexcept
+{
+    return pImpl->mUploadBudget;
+}
+
+
+uint64_t TextureResidencyManager::GetResidentBytes() const noexcept
+{
+    return pImpl->mResidentBytes;
+}
+
+
+ID3D12Resource* TextureResidencyManager::GetResource(size_t texture) const
+{
+    return pImpl->GetTexture(texture).resource.Get();
+}
+
+
+uint32_t TextureResidencyManager::GetTopMip(size_t texture) const
+{
+    auto const& it = pImpl->GetTexture(texture);
+    if (!it.resource)
+        throw std::logic_error("TextureResidencyManager texture is not resident yet");
+
+    return static_cast<uint32_t>(it.topMip);
+}
+
+
+bool TextureResidencyManager::IsCubeMap(size_t texture) const
+{
+    return pImpl->GetTexture(texture).info.isCubeMap;
+}
+
+
+DDS_ALPHA_MODE TextureResidencyManager::GetAlphaMode(size_t texture) const
+{
+    return pImpl->GetTexture(texture).alphaMode;
+}
+
+
+size_t TextureResidencyManager::GetTextureCount() const noexcept
+{
+    return pImpl->mTextures.size();
+}
+
+
+void TextureResidencyManager::CreateShaderResourceView(size_t texture, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const
+{
+    auto const& it = pImpl->GetTexture(texture);
+    if (!it.resource)
+        throw std::logic_error("TextureResidencyManager texture is not resident yet");
+
+    DirectX::CreateShaderResourceView(pImpl->mDevice.Get(), it.resource.Get(), srvDescriptor, it.info.isCubeMap);
+}
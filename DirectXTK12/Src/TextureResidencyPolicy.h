@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------
+// File: TextureResidencyPolicy.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Chooses the top resident mip of each texture from the demand reported by the app, so
+    // that the total stays within a memory budget. Textures are described only by the bytes
+    // each choice of top mip would occupy, so this has no Direct3D dependencies.
+    class TextureResidencyPolicy
+    {
+    public:
+        TextureResidencyPolicy() = default;
+
+        TextureResidencyPolicy(TextureResidencyPolicy&&) = default;
+        TextureResidencyPolicy& operator= (TextureResidencyPolicy&&) = default;
+
+        TextureResidencyPolicy(TextureResidencyPolicy const&) = default;
+        TextureResidencyPolicy& operator= (TextureResidencyPolicy const&) = default;
+
+        // residentBytes[mip] is the memory needed when mips [mip, residentBytes.size()) are resident, so it must not
+        // increase with mip. The top mip is kept within [finestMip, coarsestMip]; coarsestMip is never evicted.
+        size_t AddTexture(std::vector<uint64_t> residentBytes, size_t finestMip, size_t coarsestMip)
+        {
+            if (residentBytes.empty() || finestMip > coarsestMip || coarsestMip >= residentBytes.size())
+                throw std::invalid_argument("TextureResidencyPolicy::AddTexture");
+
+            Texture texture = {};
+            texture.residentBytes = std::move(residentBytes);
+            texture.finestMip = finestMip;
+            texture.coarsestMip = coarsestMip;
+            texture.desiredMip = coarsestMip;
+            texture.priority = 1.f;
+
+            mTextures.emplace_back(std::move(texture));
+            return mTextures.size() - 1;
+        }
+
+        size_t GetTextureCount() const noexcept { return mTextures.size(); }
+
+        // Requests mips from desiredMip down; priority weights the texture against others when the budget is short.
+        void SetDemand(size_t texture, size_t desiredMip, float priority = 1.f)
+        {
+            auto& it = mTextures.at(texture);
+            it.desiredMip = std::min(std::max(desiredMip, it.finestMip), it.coarsestMip);
+            it.priority = std::max(priority, 1e-6f);
+        }
+
+        // Drops every texture back to its coarsest mip until demand is reported again.
+        void ClearDemand() noexcept
+        {
+            for (auto& it : mTextures)
+            {
+                it.desiredMip = it.coarsestMip;
+                it.priority = 1.f;
+            }
+        }
+
+        size_t GetDesiredMip(size_t texture) const { return mTextures.at(texture).desiredMip; }
+
+        uint64_t GetResidentBytes(size_t texture, size_t topMip) const { return mTextures.at(texture).residentBytes.at(topMip); }
+
+        // Sets targets[i] to the top mip texture i should have resident. Each texture starts at its desired mip, then
+        // the one which frees the most memory per unit of priority drops a mip until the total fits the budget. If
+        // every texture is at its coarsest mip the result can still exceed the budget. Returns the total bytes.
+        uint64_t Compute(uint64_t budget, std::vector<size_t>& targets) const
+        {
+            targets.resize(mTextures.size());
+
+            uint64_t total = 0;
+            for (size_t j = 0; j < mTextures.size(); ++j)
+            {
+                targets[j] = mTextures[j].desiredMip;
+                total += mTextures[j].residentBytes[targets[j]];
+            }
+
+            if (total <= budget)
+                return total;
+
+            std::priority_queue<std::pair<double, size_t>> candidates;
+            for (size_t j = 0; j < mTextures.size(); ++j)
+            {
+                if (targets[j] < mTextures[j].coarsestMip)
+                {
+                    candidates.emplace(GetEvictionScore(mTextures[j], targets[j]), j);
+                }
+            }
+
+            while (total > budget && !candidates.empty())
+            {
+                const size_t j = candidates.top().second;
+                candidates.pop();
+
+                auto const& texture = mTextures[j];
+                total -= texture.residentBytes[targets[j]] - texture.residentBytes[targets[j] + 1];
+                ++targets[j];
+
+                if (targets[j] < texture.coarsestMip)
+                {
+                    candidates.emplace(GetEvictionScore(texture, targets[j]), j);
+                }
+            }
+
+            return total;
+        }
+
+        // Top mip at which one texel maps to roughly one pixel, for a texture of width x height drawn over
+        // screenWidth x screenHeight pixels.
+        static size_t GetMipForScreenSize(uint64_t width, uint64_t height, float screenWidth, float screenHeight) noexcept
+        {
+            if (!(screenWidth > 0.f) || !(screenHeight > 0.f))
+                return SIZE_MAX;
+
+            const double ratio = std::max(double(width) / double(screenWidth), double(height) / double(screenHeight));
+            if (ratio <= 1.0)
+                return 0;
+
+            return static_cast<size_t>(std::floor(std::log2(ratio)));
+        }
+
+    private:
+        struct Texture
+        {
+            std::vector<uint64_t> residentBytes;
+            size_t finestMip;
+            size_t coarsestMip;
+            size_t desiredMip;
+            float priority;
+        };
+
+        static double GetEvictionScore(Texture const& texture, size_t topMip) noexcept
+        {
+            const uint64_t freed = texture.residentBytes[topMip] - texture.residentBytes[topMip + 1];
+            return double(freed) / double(texture.priority);
+        }
+
+        std::vector<Texture> mTextures;
+    };
+}
@@ -27,6 +27,7 @@
 #include "DirectXHelpers.h"
 #include "PlatformHelpers.h"
 #include "LoaderHelpers.h"
+#include "PixelConversion.h"
 #include "ResourceUploadBatch.h"
 
 using namespace DirectX;
@@ -140,6 +141,40 @@ namespace
         // We don't support n-channel formats
     };
 
+    //-------------------------------------------------------------------------------------
+    // Conversions done with PixelConversion.h rather than IWICFormatConverter
+    //-------------------------------------------------------------------------------------
+
+    using PixelConvertFunc = void(*)(uint8_t* dest, const uint8_t* src, size_t count);
+
+    struct WICFastConvert
+    {
+        const GUID&         source;
+        const GUID&         target;
+        size_t              sourceBpp;
+        PixelConvertFunc    convert;
+    };
+
+    const WICFastConvert g_WICFastConvert[] =
+    {
+        { GUID_WICPixelFormat24bppBGR,      GUID_WICPixelFormat32bppRGBA, 24,
+            [](uint8_t* dest, const uint8_t* src, size_t count) { PixelConversion::ConvertBGR24ToRGBA8(dest, src, count); } },
+        { GUID_WICPixelFormat24bppRGB,      GUID_WICPixelFormat32bppRGBA, 24,
+            [](uint8_t* dest, const uint8_t* src, size_t count) { PixelConversion::ConvertRGB24ToRGBA8(dest, src, count); } },
+        { GUID_WICPixelFormat32bppBGRA,     GUID_WICPixelFormat32bppRGBA, 32,
+            [](uint8_t* dest, const uint8_t* src, size_t count) { PixelConversion::SwapRedBlue8(dest, src, count); } },
+        { GUID_WICPixelFormat32bppBGR,      GUID_WICPixelFormat32bppRGBA, 32,
+            [](uint8_t* dest, const uint8_t* src, size_t count) { PixelConversion::SwapRedBlue8(dest, src, count, true); } },
+        { GUID_WICPixelFormat16bppBGR565,   GUID_WICPixelFormat32bppRGBA, 16,
+            [](uint8_t* dest, const uint8_t* src, size_t count)
+            { PixelConversion::ConvertB5G6R5ToRGBA8(dest, reinterpret_cast<const uint16_t*>(src), count); } },
+        { GUID_WICPixelFormat16bppBGRA5551, GUID_WICPixelFormat32bppRGBA, 16,
+            [](uint8_t* dest, const uint8_t* src, size_t count)
+            { PixelConversion::ConvertB5G5R5A1ToRGBA8(dest, reinterpret_cast<const uint16_t*>(src), count); } },
+        { GUID_WICPixelFormat32bppPBGRA,    GUID_WICPixelFormat32bppPRGBA, 32,
+            [](uint8_t* dest, const uint8_t* src, size_t count) { PixelConversion::SwapRedBlue8(dest, src, count); } },
+    };
+
     BOOL WINAPI InitializeWICFactory(PINIT_ONCE, PVOID, PVOID *ifactory) noexcept
     {
         return SUCCEEDED(CoCreateInstance(
@@ -197,6 +232,53 @@ namespace
         return DXGI_FORMAT_UNKNOWN;
     }
 
+    //---------------------------------------------------------------------------------
+    const WICFastConvert* GetFastConvert(const GUID& source, const GUID& target) noexcept
+    {
+        for (size_t i = 0; i < std::size(g_WICFastConvert); ++i)
+        {
+            if (memcmp(&g_WICFastConvert[i].source, &source, sizeof(GUID)) == 0
+                && memcmp(&g_WICFastConvert[i].target, &target, sizeof(GUID)) == 0)
+                return &g_WICFastConvert[i];
+        }
+
+        return nullptr;
+    }
+
+    //---------------------------------------------------------------------------------
+    HRESULT CopyPixelsFastConvert(
+        _In_ IWICBitmapSource* source,
+        const WICFastConvert& conversion,
+        UINT width,
+        UINT height,
+        size_t rowPitch,
+        _Out_writes_bytes_(rowPitch * height) uint8_t* pixels) noexcept
+    {
+        const uint64_t srcRowBytes = (uint64_t(width) * conversion.sourceBpp + 7u) / 8u;
+        const uint64_t srcBytes = srcRowBytes * height;
+        if (srcBytes > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[static_cast<size_t>(srcBytes)]);
+        if (!temp)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = source->CopyPixels(nullptr, static_cast<UINT>(srcRowBytes), static_cast<UINT>(srcBytes), temp.get());
+        if (FAILED(hr))
+            return hr;
+
+        const uint8_t* sptr = temp.get();
+        uint8_t* dptr = pixels;
+        for (UINT y = 0; y < height; ++y)
+        {
+            conversion.convert(dptr, sptr, width);
+            sptr += srcRowBytes;
+            dptr += rowPitch;
+        }
+
+        return S_OK;
+    }
+
     //---------------------------------------------------------------------------------
     size_t WICBitsPerPixel(REFGUID targetGuid) noexcept
     {
@@ -327,6 +409,42 @@ namespace
             bpp = 32;
         }
 
+        // 8:8:8:8 images are decoded as RGBA and expanded to half with PixelConversion; WIC converts the rest
+        bool expandToHalf = false;
+        if (loadFlags & WIC_LOADER_FORCE_RGBA16F)
+        {
+            if (bpp == 32
+                && (format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM))
+            {
+                memcpy_s(&convertGUID, sizeof(WICPixelFormatGUID), &GUID_WICPixelFormat32bppRGBA, sizeof(GUID));
+                format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                expandToHalf = true;
+            }
+            else
+            {
+                memcpy_s(&convertGUID, sizeof(WICPixelFormatGUID), &GUID_WICPixelFormat64bppRGBAHalf, sizeof(GUID));
+                format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+                bpp = 64;
+            }
+        }
+
+        // Images that are already premultiplied are decoded as they are rather than through straight alpha
+        bool premultiply = false;
+        if ((loadFlags & WIC_LOADER_PREMULTIPLY_ALPHA)
+            && (format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM))
+        {
+            if (memcmp(&convertGUID, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0
+                && (memcmp(&pixelFormat, &GUID_WICPixelFormat32bppPRGBA, sizeof(GUID)) == 0
+                    || memcmp(&pixelFormat, &GUID_WICPixelFormat32bppPBGRA, sizeof(GUID)) == 0))
+            {
+                memcpy_s(&convertGUID, sizeof(WICPixelFormatGUID), &GUID_WICPixelFormat32bppPRGBA, sizeof(GUID));
+            }
+            else
+            {
+                premultiply = true;
+            }
+        }
+
         if (!bpp)
             return E_FAIL;
 
@@ -414,8 +532,8 @@ namespace
         if (rowBytes > UINT32_MAX || numBytes > UINT32_MAX)
             return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-        auto const rowPitch = static_cast<size_t>(rowBytes);
-        auto const imageSize = static_cast<size_t>(numBytes);
+        auto rowPitch = static_cast<size_t>(rowBytes);
+        auto imageSize = static_cast<size_t>(numBytes);
 
         decodedData.reset(new (std::nothrow) uint8_t[imageSize]);
         if (!decodedData)
@@ -459,6 +577,12 @@ namespace
                 if (FAILED(hr))
                     return hr;
             }
+            else if (auto fastConvert = GetFastConvert(pfScaler, convertGUID))
+            {
+                hr = CopyPixelsFastConvert(scaler.Get(), *fastConvert, twidth, theight, rowPitch, decodedData.get());
+                if (FAILED(hr))
+                    return hr;
+            }
             else
             {
                 ComPtr<IWICFormatConverter> FC;
@@ -482,6 +606,13 @@ namespace
                     return hr;
             }
         }
+        else if (auto fastConvert = GetFastConvert(pixelFormat, convertGUID))
+        {
+            // Format conversion but no resize, done without WIC
+            hr = CopyPixelsFastConvert(frame, *fastConvert, twidth, theight, rowPitch, decodedData.get());
+            if (FAILED(hr))
+                return hr;
+        }
         else
         {
             // Format conversion but no resize
@@ -510,6 +641,45 @@ namespace
                 return hr;
         }
 
+        if (premultiply)
+        {
+            // Done on the stored values, so sRGB images are premultiplied in gamma space
+            uint8_t* pixels = decodedData.get();
+            for (UINT y = 0; y < theight; ++y, pixels += rowPitch)
+            {
+                PixelConversion::PremultiplyAlpha8(pixels, pixels, twidth);
+            }
+        }
+
+        if (expandToHalf)
+        {
+            const uint64_t halfRowBytes = uint64_t(twidth) * 8u;
+            const uint64_t halfBytes = halfRowBytes * uint64_t(theight);
+            if (halfBytes > UINT32_MAX)
+                return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+            std::unique_ptr<uint8_t[]> expanded(new (std::nothrow) uint8_t[static_cast<size_t>(halfBytes)]);
+            if (!expanded)
+                return E_OUTOFMEMORY;
+
+            // WIC_LOADER_FORCE_SRGB and sRGB metadata can't pick an _SRGB half format, so the data is linearized instead
+            const bool fromSRGB = (format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+
+            const uint8_t* sptr = decodedData.get();
+            uint8_t* dptr = expanded.get();
+            for (UINT y = 0; y < theight; ++y)
+            {
+                PixelConversion::ConvertRGBA8ToRGBA16F(reinterpret_cast<uint16_t*>(dptr), sptr, twidth, fromSRGB);
+                sptr += rowPitch;
+                dptr += halfRowBytes;
+            }
+
+            decodedData = std::move(expanded);
+            rowPitch = static_cast<size_t>(halfRowBytes);
+            imageSize = static_cast<size_t>(halfBytes);
+            format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        }
+
         // Count the number of mips
         const uint32_t mipCount = (loadFlags & (WIC_LOADER_MIP_AUTOGEN | WIC_LOADER_MIP_RESERVE))
             ? LoaderHelpers::CountMips(twidth, theight) : 1u;
@@ -974,6 +1144,90 @@ HRESULT DirectX::CreateWICTextureFromFileEx(
 }
 
 
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GetWICTextureFormatFromMemory(
+    const uint8_t* wicData,
+    size_t wicDataSize,
+    DXGI_FORMAT* format) noexcept
+{
+    if (format)
+    {
+        *format = DXGI_FORMAT_UNKNOWN;
+    }
+
+    if (!wicData || !format)
+        return E_INVALIDARG;
+
+    if (!wicDataSize)
+        return E_FAIL;
+
+    if (wicDataSize > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+    auto pWIC = GetWIC();
+    if (!pWIC)
+        return E_NOINTERFACE;
+
+    ComPtr<IWICStream> stream;
+    HRESULT hr = pWIC->CreateStream(stream.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    hr = stream->InitializeFromMemory(const_cast<uint8_t*>(wicData), static_cast<DWORD>(wicDataSize));
+    if (FAILED(hr))
+        return hr;
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    hr = pWIC->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    ComPtr<IWICBitmapFrameDecode> frame;
+    hr = decoder->GetFrame(0, frame.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    *format = GetPixelFormat(frame.Get());
+    return (*format == DXGI_FORMAT_UNKNOWN) ? HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) : S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::GetWICTextureFormatFromFile(
+    const wchar_t* fileName,
+    DXGI_FORMAT* format) noexcept
+{
+    if (format)
+    {
+        *format = DXGI_FORMAT_UNKNOWN;
+    }
+
+    if (!fileName || !format)
+        return E_INVALIDARG;
+
+    auto pWIC = GetWIC();
+    if (!pWIC)
+        return E_NOINTERFACE;
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    HRESULT hr = pWIC->CreateDecoderFromFilename(fileName,
+        nullptr,
+        GENERIC_READ,
+        WICDecodeMetadataCacheOnDemand,
+        decoder.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    ComPtr<IWICBitmapFrameDecode> frame;
+    hr = decoder->GetFrame(0, frame.GetAddressOf());
+    if (FAILED(hr))
+        return hr;
+
+    *format = GetPixelFormat(frame.Get());
+    return (*format == DXGI_FORMAT_UNKNOWN) ? HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) : S_OK;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Adapters for /Zc:wchar_t- clients
 
@@ -1035,6 +1289,15 @@ namespace DirectX
             reinterpret_cast<const unsigned short*>(szFileName),
             maxsize, resFlags, loadFlags, texture);
     }
+
+    HRESULT __cdecl GetWICTextureFormatFromFile(
+        _In_z_ const __wchar_t* szFileName,
+        _Out_ DXGI_FORMAT* format) noexcept
+    {
+        return GetWICTextureFormatFromFile(
+            reinterpret_cast<const unsigned short*>(szFileName),
+            format);
+    }
 }
 
 #endif // !_NATIVE_WCHAR_T_DEFINED